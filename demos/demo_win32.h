@@ -306,7 +306,52 @@ static inline unsigned int demo_wait_event(HANDLE event, unsigned int ms)
     return WaitForSingleObject(event, ms);
 }
 
+static inline void demo_signal_event(HANDLE event)
+{
+    SetEvent(event);
+}
+
 static inline void demo_destroy_event(HANDLE event)
 {
     CloseHandle(event);
 }
+
+struct demo_thread
+{
+    HANDLE handle;
+    void (*main_pfn)(void *data);
+    void *data;
+};
+
+static inline DWORD WINAPI demo_thread_main(void *arg)
+{
+    struct demo_thread *thread = arg;
+
+    thread->main_pfn(thread->data);
+    return 0;
+}
+
+static inline struct demo_thread *demo_create_thread(void (*main_pfn)(void *data), void *data)
+{
+    struct demo_thread *thread;
+
+    if (!(thread = malloc(sizeof(*thread))))
+        return NULL;
+
+    thread->main_pfn = main_pfn;
+    thread->data = data;
+    if (!(thread->handle = CreateThread(NULL, 0, demo_thread_main, thread, 0, NULL)))
+    {
+        free(thread);
+        return NULL;
+    }
+
+    return thread;
+}
+
+static inline void demo_join_thread(struct demo_thread *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
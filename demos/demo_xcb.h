@@ -30,6 +30,7 @@
 #include <fcntl.h>
 #include <stdbool.h>
 #include <dlfcn.h>
+#include <pthread.h>
 
 #define SYMBOL(x) static PFN_vk##x x
 SYMBOL(CreateXcbSurfaceKHR);
@@ -604,7 +605,51 @@ static inline unsigned int demo_wait_event(HANDLE event, unsigned int ms)
     return vkd3d_wait_event(event, ms);
 }
 
+static inline void demo_signal_event(HANDLE event)
+{
+    vkd3d_signal_event(event);
+}
+
 static inline void demo_destroy_event(HANDLE event)
 {
     vkd3d_destroy_event(event);
 }
+
+struct demo_thread
+{
+    pthread_t thread;
+    void (*main_pfn)(void *data);
+    void *data;
+};
+
+static inline void *demo_thread_main(void *arg)
+{
+    struct demo_thread *thread = arg;
+
+    thread->main_pfn(thread->data);
+    return NULL;
+}
+
+static inline struct demo_thread *demo_create_thread(void (*main_pfn)(void *data), void *data)
+{
+    struct demo_thread *thread;
+
+    if (!(thread = malloc(sizeof(*thread))))
+        return NULL;
+
+    thread->main_pfn = main_pfn;
+    thread->data = data;
+    if (pthread_create(&thread->thread, NULL, demo_thread_main, thread))
+    {
+        free(thread);
+        return NULL;
+    }
+
+    return thread;
+}
+
+static inline void demo_join_thread(struct demo_thread *thread)
+{
+    pthread_join(thread->thread, NULL);
+    free(thread);
+}
@@ -103,6 +103,70 @@ struct cxg_draw
     size_t smooth_index_count;
 };
 
+/* Draw-call scaling mode, selected through VKD3D_GEARS_BENCHMARK. Command lists
+ * are recorded every frame with VKD3D_GEARS_DRAWS draws, which makes recording
+ * cost per draw visible. Frame times are limited by the swapchain's vsync. */
+#define CXG_MAX_THREADS 16
+#define CXG_BUNDLE_DRAW_COUNT 256
+#define CXG_SRV_COUNT 64
+
+enum cxg_benchmark_mode
+{
+    CXG_BENCHMARK_NONE,
+    CXG_BENCHMARK_DRAWS,
+    CXG_BENCHMARK_ROOT_CONSTANTS,
+    CXG_BENCHMARK_DESCRIPTOR_TABLES,
+    CXG_BENCHMARK_PSO_SWITCHES,
+    CXG_BENCHMARK_BUNDLES,
+    CXG_BENCHMARK_THREADS,
+};
+
+static const char * const cxg_benchmark_mode_names[] =
+{
+    NULL,
+    "draws",
+    "root_constants",
+    "descriptor_tables",
+    "pso_switches",
+    "bundles",
+    "threads",
+};
+
+struct cxg_worker
+{
+    struct cx_gears *cxg;
+    unsigned int index;
+    struct demo_thread *thread;
+    HANDLE start_event;
+    HANDLE done_event;
+    ID3D12CommandAllocator *command_allocator[3];
+    ID3D12GraphicsCommandList *command_list[3];
+};
+
+struct cxg_benchmark
+{
+    enum cxg_benchmark_mode mode;
+    unsigned int draw_count;
+    unsigned int thread_count;
+
+    ID3D12DescriptorHeap *srv_heap;
+    unsigned int srv_descriptor_size;
+
+    ID3D12CommandAllocator *bundle_allocator;
+    ID3D12GraphicsCommandList **bundles;
+    unsigned int bundle_count;
+
+    struct cxg_worker workers[CXG_MAX_THREADS];
+    bool exit;
+
+    double report_time;
+    double record_time;
+    double frame_time;
+    double frame_time_min;
+    double frame_time_max;
+    unsigned int frame_count;
+};
+
 struct cx_gears
 {
     struct demo demo;
@@ -142,6 +206,8 @@ struct cx_gears
     struct cxg_cb_data *cb_data;
     struct cxg_instance_data *instance_data;
     struct cxg_draw draws[3];
+
+    struct cxg_benchmark benchmark;
 };
 
 static void cxg_populate_command_list(struct cx_gears *cxg, unsigned int rt_idx)
@@ -207,6 +273,241 @@ static void cxg_populate_command_list(struct cx_gears *cxg, unsigned int rt_idx)
     assert(SUCCEEDED(hr));
 }
 
+static void cxg_transition_render_target(ID3D12GraphicsCommandList *command_list,
+        ID3D12Resource *render_target, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+{
+    D3D12_RESOURCE_BARRIER barrier;
+
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.Transition.pResource = render_target;
+    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+    barrier.Transition.StateBefore = before;
+    barrier.Transition.StateAfter = after;
+    ID3D12GraphicsCommandList_ResourceBarrier(command_list, 1, &barrier);
+}
+
+static void cxg_benchmark_set_state(struct cx_gears *cxg,
+        ID3D12GraphicsCommandList *command_list, unsigned int rt_idx)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle, dsv_handle;
+
+    ID3D12GraphicsCommandList_SetDescriptorHeaps(command_list, 1, &cxg->benchmark.srv_heap);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, cxg->root_signature);
+    ID3D12GraphicsCommandList_SetGraphicsRootConstantBufferView(command_list, 0,
+            ID3D12Resource_GetGPUVirtualAddress(cxg->cb));
+    ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstant(command_list, 1, 0, 0);
+    ID3D12GraphicsCommandList_SetGraphicsRootDescriptorTable(command_list, 2,
+            ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(cxg->benchmark.srv_heap));
+
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &cxg->vp);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &cxg->scissor_rect);
+
+    rtv_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cxg->rtv_heap);
+    rtv_handle.ptr += rt_idx * cxg->rtv_descriptor_size;
+    dsv_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cxg->dsv_heap);
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &rtv_handle, FALSE, &dsv_handle);
+
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_IASetIndexBuffer(command_list, &cxg->ibv);
+    ID3D12GraphicsCommandList_IASetVertexBuffers(command_list, 0, 2, cxg->vbv);
+}
+
+static void cxg_benchmark_record_draws(struct cx_gears *cxg,
+        ID3D12GraphicsCommandList *command_list, unsigned int first, unsigned int end)
+{
+    const struct cxg_benchmark *benchmark = &cxg->benchmark;
+    D3D12_GPU_DESCRIPTOR_HANDLE table_start, table;
+    const struct cxg_draw *draw;
+    unsigned int i;
+
+    table_start = ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(benchmark->srv_heap);
+
+    /* Only the inward faces of each gear are drawn, to keep the GPU out of the way. */
+    for (i = first; i < end; ++i)
+    {
+        draw = &cxg->draws[i % ARRAY_SIZE(cxg->draws)];
+
+        switch (benchmark->mode)
+        {
+            case CXG_BENCHMARK_ROOT_CONSTANTS:
+                ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstant(command_list, 1, i, 0);
+                break;
+
+            case CXG_BENCHMARK_DESCRIPTOR_TABLES:
+                table.ptr = table_start.ptr + (i % CXG_SRV_COUNT) * benchmark->srv_descriptor_size;
+                ID3D12GraphicsCommandList_SetGraphicsRootDescriptorTable(command_list, 2, table);
+                break;
+
+            case CXG_BENCHMARK_PSO_SWITCHES:
+                ID3D12GraphicsCommandList_SetPipelineState(command_list,
+                        (i & 1) ? cxg->pipeline_state_smooth : cxg->pipeline_state_flat);
+                break;
+
+            default:
+                break;
+        }
+
+        ID3D12GraphicsCommandList_DrawIndexedInstanced(command_list, draw->smooth_index_count,
+                1, draw->smooth_index_idx, draw->vertex_idx, i % ARRAY_SIZE(cxg->draws));
+    }
+}
+
+static void cxg_worker_record(struct cxg_worker *worker)
+{
+    struct cx_gears *cxg = worker->cxg;
+    const struct cxg_benchmark *benchmark = &cxg->benchmark;
+    unsigned int rt_idx = cxg->rt_idx, first, end;
+    ID3D12GraphicsCommandList *command_list;
+    HRESULT hr;
+
+    command_list = worker->command_list[rt_idx];
+    first = benchmark->draw_count * worker->index / benchmark->thread_count;
+    end = benchmark->draw_count * (worker->index + 1) / benchmark->thread_count;
+
+    hr = ID3D12CommandAllocator_Reset(worker->command_allocator[rt_idx]);
+    assert(SUCCEEDED(hr));
+    hr = ID3D12GraphicsCommandList_Reset(command_list, worker->command_allocator[rt_idx], cxg->pipeline_state_flat);
+    assert(SUCCEEDED(hr));
+
+    cxg_benchmark_set_state(cxg, command_list, rt_idx);
+    cxg_benchmark_record_draws(cxg, command_list, first, end);
+
+    /* The last list in submission order hands the back buffer to the swapchain. */
+    if (worker->index == benchmark->thread_count - 1)
+    {
+        cxg_transition_render_target(command_list, cxg->render_targets[rt_idx],
+                D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    }
+
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    assert(SUCCEEDED(hr));
+}
+
+static void cxg_worker_main(void *data)
+{
+    struct cxg_worker *worker = data;
+
+    for (;;)
+    {
+        demo_wait_event(worker->start_event, INFINITE);
+        if (worker->cxg->benchmark.exit)
+            break;
+
+        cxg_worker_record(worker);
+        demo_signal_event(worker->done_event);
+    }
+}
+
+static void cxg_benchmark_populate_command_list(struct cx_gears *cxg, unsigned int rt_idx)
+{
+    ID3D12GraphicsCommandList *command_list = cxg->command_list[rt_idx];
+    static const float clear_colour[] = {0.0f, 0.0f, 0.0f, 1.0f};
+    struct cxg_benchmark *benchmark = &cxg->benchmark;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv_handle, dsv_handle;
+    unsigned int i;
+    HRESULT hr;
+
+    hr = ID3D12CommandAllocator_Reset(cxg->command_allocator[rt_idx]);
+    assert(SUCCEEDED(hr));
+
+    hr = ID3D12GraphicsCommandList_Reset(command_list, cxg->command_allocator[rt_idx], cxg->pipeline_state_flat);
+    assert(SUCCEEDED(hr));
+
+    cxg_benchmark_set_state(cxg, command_list, rt_idx);
+    cxg_transition_render_target(command_list, cxg->render_targets[rt_idx],
+            D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    rtv_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cxg->rtv_heap);
+    rtv_handle.ptr += rt_idx * cxg->rtv_descriptor_size;
+    dsv_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cxg->dsv_heap);
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, rtv_handle, clear_colour, 0, NULL);
+    ID3D12GraphicsCommandList_ClearDepthStencilView(command_list,
+            dsv_handle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, NULL);
+
+    switch (benchmark->mode)
+    {
+        case CXG_BENCHMARK_BUNDLES:
+            for (i = 0; i < benchmark->bundle_count; ++i)
+                ID3D12GraphicsCommandList_ExecuteBundle(command_list, benchmark->bundles[i]);
+            break;
+
+        case CXG_BENCHMARK_THREADS:
+            /* The workers record the draws into lists that are submitted after this one. */
+            break;
+
+        default:
+            cxg_benchmark_record_draws(cxg, command_list, 0, benchmark->draw_count);
+            break;
+    }
+
+    if (benchmark->mode != CXG_BENCHMARK_THREADS)
+    {
+        cxg_transition_render_target(command_list, cxg->render_targets[rt_idx],
+                D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+    }
+
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    assert(SUCCEEDED(hr));
+
+    if (benchmark->mode == CXG_BENCHMARK_THREADS)
+    {
+        for (i = 0; i < benchmark->thread_count; ++i)
+            demo_signal_event(benchmark->workers[i].start_event);
+        for (i = 0; i < benchmark->thread_count; ++i)
+            demo_wait_event(benchmark->workers[i].done_event, INFINITE);
+    }
+}
+
+static void cxg_benchmark_execute(struct cx_gears *cxg)
+{
+    ID3D12CommandList *command_lists[CXG_MAX_THREADS + 1];
+    const struct cxg_benchmark *benchmark = &cxg->benchmark;
+    unsigned int i, count = 0;
+
+    command_lists[count++] = (ID3D12CommandList *)cxg->command_list[cxg->rt_idx];
+    if (benchmark->mode == CXG_BENCHMARK_THREADS)
+    {
+        for (i = 0; i < benchmark->thread_count; ++i)
+            command_lists[count++] = (ID3D12CommandList *)benchmark->workers[i].command_list[cxg->rt_idx];
+    }
+
+    ID3D12CommandQueue_ExecuteCommandLists(cxg->command_queue, count, command_lists);
+}
+
+static void cxg_benchmark_update_stats(struct cx_gears *cxg, double frame_time, double record_time, double t)
+{
+    struct cxg_benchmark *benchmark = &cxg->benchmark;
+
+    if (frame_time > 0.0)
+    {
+        if (!benchmark->frame_count || frame_time < benchmark->frame_time_min)
+            benchmark->frame_time_min = frame_time;
+        if (!benchmark->frame_count || frame_time > benchmark->frame_time_max)
+            benchmark->frame_time_max = frame_time;
+        benchmark->frame_time += frame_time;
+        benchmark->record_time += record_time;
+        ++benchmark->frame_count;
+    }
+
+    if (benchmark->report_time <= 0.0)
+        benchmark->report_time = t;
+    if (t - benchmark->report_time < 1.0 || !benchmark->frame_count)
+        return;
+
+    printf("%s: %u draws, %u frames, %.1f ns/draw recording, frame time %.3f ms (min %.3f ms, max %.3f ms).\n",
+            cxg_benchmark_mode_names[benchmark->mode], benchmark->draw_count, benchmark->frame_count,
+            1e9 * benchmark->record_time / ((double)benchmark->frame_count * benchmark->draw_count),
+            1e3 * benchmark->frame_time / benchmark->frame_count,
+            1e3 * benchmark->frame_time_min, 1e3 * benchmark->frame_time_max);
+    fflush(stdout);
+
+    benchmark->report_time = t;
+    benchmark->record_time = 0.0;
+    benchmark->frame_time = 0.0;
+    benchmark->frame_count = 0;
+}
+
 static void cxg_wait_for_previous_frame(struct cx_gears *cxg)
 {
     struct cxg_fence *fence = &cxg->fence;
@@ -292,7 +593,7 @@ static double cxg_get_time(void)
 static void cxg_render_frame(struct cx_gears *cxg)
 {
     static double t_prev = -1.0;
-    double dt, t;
+    double dt, t, record_start, record_time;
     float a;
 
     t = cxg_get_time();
@@ -315,6 +616,20 @@ static void cxg_render_frame(struct cx_gears *cxg)
     a = (-2.0f * cxg->alpha) - 25.0f * M_PI / 180.0;
     demo_vec4_set(&cxg->instance_data[2].transform, cosf(a), sinf(a), -3.1f,  4.2f);
 
+    if (cxg->benchmark.mode)
+    {
+        record_start = cxg_get_time();
+        cxg_benchmark_populate_command_list(cxg, cxg->rt_idx);
+        record_time = cxg_get_time() - record_start;
+
+        cxg_benchmark_execute(cxg);
+        demo_swapchain_present(cxg->swapchain);
+        cxg_wait_for_previous_frame(cxg);
+
+        cxg_benchmark_update_stats(cxg, dt, record_time, t);
+        return;
+    }
+
     ID3D12CommandQueue_ExecuteCommandLists(cxg->command_queue, 1,
             (ID3D12CommandList **)&cxg->command_list[cxg->rt_idx]);
     demo_swapchain_present(cxg->swapchain);
@@ -677,7 +992,8 @@ static void cxg_load_assets(struct cx_gears *cxg)
     D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
     D3D12_GRAPHICS_PIPELINE_STATE_DESC pso_desc;
     D3D12_CPU_DESCRIPTOR_HANDLE dsv_handle;
-    D3D12_ROOT_PARAMETER root_parameter;
+    D3D12_ROOT_PARAMETER root_parameters[3];
+    D3D12_DESCRIPTOR_RANGE srv_range;
     D3D12_RESOURCE_DESC resource_desc;
     D3D12_HEAP_PROPERTIES heap_desc;
     D3D12_RANGE read_range = {0, 0};
@@ -685,14 +1001,32 @@ static void cxg_load_assets(struct cx_gears *cxg)
     unsigned int i;
     HRESULT hr;
 
-    root_parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
-    root_parameter.Descriptor.ShaderRegister = 0;
-    root_parameter.Descriptor.RegisterSpace = 0;
-    root_parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+    root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_CBV;
+    root_parameters[0].Descriptor.ShaderRegister = 0;
+    root_parameters[0].Descriptor.RegisterSpace = 0;
+    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+    /* The benchmark mode adds parameters for the per-draw root constant and
+     * descriptor table updates. The shaders don't access them. */
+    root_parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    root_parameters[1].Constants.ShaderRegister = 1;
+    root_parameters[1].Constants.RegisterSpace = 0;
+    root_parameters[1].Constants.Num32BitValues = 1;
+    root_parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
+
+    srv_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    srv_range.NumDescriptors = 1;
+    srv_range.BaseShaderRegister = 0;
+    srv_range.RegisterSpace = 0;
+    srv_range.OffsetInDescriptorsFromTableStart = 0;
+    root_parameters[2].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_parameters[2].DescriptorTable.NumDescriptorRanges = 1;
+    root_parameters[2].DescriptorTable.pDescriptorRanges = &srv_range;
+    root_parameters[2].ShaderVisibility = D3D12_SHADER_VISIBILITY_VERTEX;
 
     memset(&root_signature_desc, 0, sizeof(root_signature_desc));
-    root_signature_desc.NumParameters = 1;
-    root_signature_desc.pParameters = &root_parameter;
+    root_signature_desc.NumParameters = cxg->benchmark.mode ? ARRAY_SIZE(root_parameters) : 1;
+    root_signature_desc.pParameters = root_parameters;
     root_signature_desc.Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
             | D3D12_ROOT_SIGNATURE_FLAG_DENY_HULL_SHADER_ROOT_ACCESS
             | D3D12_ROOT_SIGNATURE_FLAG_DENY_DOMAIN_SHADER_ROOT_ACCESS
@@ -807,6 +1141,174 @@ static void cxg_load_assets(struct cx_gears *cxg)
     cxg_wait_for_previous_frame(cxg);
 }
 
+static void cxg_benchmark_init(struct cx_gears *cxg)
+{
+    struct cxg_benchmark *benchmark = &cxg->benchmark;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
+    D3D12_DESCRIPTOR_HEAP_DESC heap_desc;
+    D3D12_CPU_DESCRIPTOR_HANDLE srv_handle;
+    ID3D12GraphicsCommandList *bundle;
+    struct cxg_worker *worker;
+    unsigned int i, j, end;
+    HRESULT hr;
+
+    memset(&heap_desc, 0, sizeof(heap_desc));
+    heap_desc.NumDescriptors = CXG_SRV_COUNT;
+    heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    hr = ID3D12Device_CreateDescriptorHeap(cxg->device, &heap_desc,
+            &IID_ID3D12DescriptorHeap, (void **)&benchmark->srv_heap);
+    assert(SUCCEEDED(hr));
+
+    benchmark->srv_descriptor_size = ID3D12Device_GetDescriptorHandleIncrementSize(cxg->device,
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Texture2D.MipLevels = 1;
+    srv_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(benchmark->srv_heap);
+    for (i = 0; i < CXG_SRV_COUNT; ++i)
+    {
+        ID3D12Device_CreateShaderResourceView(cxg->device, NULL, &srv_desc, srv_handle);
+        srv_handle.ptr += benchmark->srv_descriptor_size;
+    }
+
+    if (benchmark->mode == CXG_BENCHMARK_BUNDLES)
+    {
+        hr = ID3D12Device_CreateCommandAllocator(cxg->device, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+                &IID_ID3D12CommandAllocator, (void **)&benchmark->bundle_allocator);
+        assert(SUCCEEDED(hr));
+
+        benchmark->bundle_count = (benchmark->draw_count + CXG_BUNDLE_DRAW_COUNT - 1) / CXG_BUNDLE_DRAW_COUNT;
+        benchmark->bundles = calloc(benchmark->bundle_count, sizeof(*benchmark->bundles));
+        assert(benchmark->bundles);
+
+        /* Bundles inherit the root arguments and render targets of the calling
+         * list, but not the pipeline state or the primitive topology. */
+        for (i = 0; i < benchmark->bundle_count; ++i)
+        {
+            hr = ID3D12Device_CreateCommandList(cxg->device, 0, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+                    benchmark->bundle_allocator, cxg->pipeline_state_flat,
+                    &IID_ID3D12GraphicsCommandList, (void **)&bundle);
+            assert(SUCCEEDED(hr));
+
+            ID3D12GraphicsCommandList_IASetPrimitiveTopology(bundle, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            ID3D12GraphicsCommandList_IASetIndexBuffer(bundle, &cxg->ibv);
+            ID3D12GraphicsCommandList_IASetVertexBuffers(bundle, 0, 2, cxg->vbv);
+
+            end = (i + 1) * CXG_BUNDLE_DRAW_COUNT;
+            if (end > benchmark->draw_count)
+                end = benchmark->draw_count;
+            cxg_benchmark_record_draws(cxg, bundle, i * CXG_BUNDLE_DRAW_COUNT, end);
+
+            hr = ID3D12GraphicsCommandList_Close(bundle);
+            assert(SUCCEEDED(hr));
+            benchmark->bundles[i] = bundle;
+        }
+    }
+
+    if (benchmark->mode == CXG_BENCHMARK_THREADS)
+    {
+        for (i = 0; i < benchmark->thread_count; ++i)
+        {
+            worker = &benchmark->workers[i];
+            worker->cxg = cxg;
+            worker->index = i;
+
+            for (j = 0; j < ARRAY_SIZE(worker->command_list); ++j)
+            {
+                hr = ID3D12Device_CreateCommandAllocator(cxg->device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+                        &IID_ID3D12CommandAllocator, (void **)&worker->command_allocator[j]);
+                assert(SUCCEEDED(hr));
+                hr = ID3D12Device_CreateCommandList(cxg->device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+                        worker->command_allocator[j], cxg->pipeline_state_flat,
+                        &IID_ID3D12GraphicsCommandList, (void **)&worker->command_list[j]);
+                assert(SUCCEEDED(hr));
+                hr = ID3D12GraphicsCommandList_Close(worker->command_list[j]);
+                assert(SUCCEEDED(hr));
+            }
+
+            worker->start_event = demo_create_event();
+            assert(worker->start_event);
+            worker->done_event = demo_create_event();
+            assert(worker->done_event);
+            worker->thread = demo_create_thread(cxg_worker_main, worker);
+            assert(worker->thread);
+        }
+    }
+
+    printf("Benchmark mode %s, %u draws per frame", cxg_benchmark_mode_names[benchmark->mode],
+            benchmark->draw_count);
+    if (benchmark->mode == CXG_BENCHMARK_THREADS)
+        printf(" on %u threads", benchmark->thread_count);
+    printf(".\n");
+}
+
+static void cxg_benchmark_destroy(struct cx_gears *cxg)
+{
+    struct cxg_benchmark *benchmark = &cxg->benchmark;
+    struct cxg_worker *worker;
+    unsigned int i, j;
+
+    if (benchmark->mode == CXG_BENCHMARK_THREADS)
+    {
+        benchmark->exit = true;
+        for (i = 0; i < benchmark->thread_count; ++i)
+        {
+            worker = &benchmark->workers[i];
+            demo_signal_event(worker->start_event);
+            demo_join_thread(worker->thread);
+            demo_destroy_event(worker->done_event);
+            demo_destroy_event(worker->start_event);
+            for (j = 0; j < ARRAY_SIZE(worker->command_list); ++j)
+            {
+                ID3D12GraphicsCommandList_Release(worker->command_list[j]);
+                ID3D12CommandAllocator_Release(worker->command_allocator[j]);
+            }
+        }
+    }
+
+    for (i = 0; i < benchmark->bundle_count; ++i)
+        ID3D12GraphicsCommandList_Release(benchmark->bundles[i]);
+    free(benchmark->bundles);
+    if (benchmark->bundle_allocator)
+        ID3D12CommandAllocator_Release(benchmark->bundle_allocator);
+    ID3D12DescriptorHeap_Release(benchmark->srv_heap);
+}
+
+static void cxg_benchmark_parse_env(struct cxg_benchmark *benchmark)
+{
+    const char *mode, *value;
+    unsigned int i;
+
+    if (!(mode = getenv("VKD3D_GEARS_BENCHMARK")))
+        return;
+
+    for (i = 1; i < ARRAY_SIZE(cxg_benchmark_mode_names); ++i)
+    {
+        if (!strcmp(mode, cxg_benchmark_mode_names[i]))
+            benchmark->mode = i;
+    }
+
+    if (!benchmark->mode)
+    {
+        fprintf(stderr, "Unknown benchmark mode \"%s\".\n", mode);
+        return;
+    }
+
+    benchmark->draw_count = 10000;
+    if ((value = getenv("VKD3D_GEARS_DRAWS")) && atoi(value) > 0)
+        benchmark->draw_count = atoi(value);
+
+    benchmark->thread_count = 4;
+    if ((value = getenv("VKD3D_GEARS_THREADS")) && atoi(value) > 0)
+        benchmark->thread_count = atoi(value);
+    if (benchmark->thread_count > CXG_MAX_THREADS)
+        benchmark->thread_count = CXG_MAX_THREADS;
+}
+
 static void cxg_key_press(struct demo_window *window, demo_key key, void *user_data)
 {
     struct cx_gears *cxg = user_data;
@@ -880,15 +1382,27 @@ static int cxg_main(void)
     cxg.scissor_rect.right = width;
     cxg.scissor_rect.bottom = height;
 
+    cxg_benchmark_parse_env(&cxg.benchmark);
+
     cxg_load_pipeline(&cxg);
     cxg_load_assets(&cxg);
-    cxg_populate_command_list(&cxg, 0);
-    cxg_populate_command_list(&cxg, 1);
-    cxg_populate_command_list(&cxg, 2);
+    if (cxg.benchmark.mode)
+    {
+        /* Command lists are recorded every frame. */
+        cxg_benchmark_init(&cxg);
+    }
+    else
+    {
+        cxg_populate_command_list(&cxg, 0);
+        cxg_populate_command_list(&cxg, 1);
+        cxg_populate_command_list(&cxg, 2);
+    }
 
     demo_process_events(&cxg.demo);
 
     cxg_wait_for_previous_frame(&cxg);
+    if (cxg.benchmark.mode)
+        cxg_benchmark_destroy(&cxg);
     cxg_destroy_assets(&cxg);
     cxg_destroy_pipeline(&cxg);
     demo_cleanup(&cxg.demo);
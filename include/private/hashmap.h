@@ -25,6 +25,10 @@
 
 #include "vkd3d_memory.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 enum hash_map_entry_flag
 {
     HASH_MAP_ENTRY_OCCUPIED = (1 << 0),
@@ -39,17 +43,28 @@ struct hash_map_entry
 typedef uint32_t (*pfn_hash_func)(const void* key);
 typedef bool (*pfn_hash_compare_func)(const void *key, const struct hash_map_entry *entry);
 
-/* Open-addressing hash table */
+/* Open-addressing hash table with linear probing over a power-of-two number of entries.
+ * Next to the entries, a control byte per entry holds either HASH_MAP_CTRL_EMPTY or
+ * seven bits of the entry's hash, so that probing scans control bytes in groups of
+ * HASH_MAP_GROUP_SIZE and only touches entries which are likely to match. The first
+ * HASH_MAP_GROUP_SIZE - 1 control bytes are mirrored past the end of the array so that
+ * groups can be loaded at any index without wrapping around. */
 struct hash_map
 {
     pfn_hash_func hash_func;
     pfn_hash_compare_func compare_func;
     void *entries;
+    uint8_t *ctrl;
     size_t entry_size;
     uint32_t entry_count;
     uint32_t used_count;
+    uint32_t hash_shift;
 };
 
+#define HASH_MAP_GROUP_SIZE 16u
+#define HASH_MAP_CTRL_EMPTY 0x80u
+#define HASH_MAP_MIN_SIZE 16u
+
 static inline struct hash_map_entry *hash_map_get_entry(const struct hash_map *hash_map, uint32_t entry_idx)
 {
     return void_ptr_offset(hash_map->entries, hash_map->entry_size * entry_idx);
@@ -57,38 +72,85 @@ static inline struct hash_map_entry *hash_map_get_entry(const struct hash_map *h
 
 static inline uint32_t hash_map_get_entry_idx(const struct hash_map *hash_map, uint32_t hash_value)
 {
-    return hash_value % hash_map->entry_count;
+    /* Fibonacci hashing, so that weak hash functions with poor
+     * low bits still spread out over the power-of-two table. */
+    return (uint32_t)(((uint64_t)hash_value * 0x9e3779b97f4a7c15ull) >> hash_map->hash_shift);
+}
+
+static inline uint8_t hash_map_get_ctrl(uint32_t hash_value)
+{
+    /* Use a multiplier unrelated to the index so that neighbouring entries get different tags. */
+    return (uint8_t)((hash_value * 0x85ebca6bu) >> 25);
 }
 
 static inline uint32_t hash_map_next_entry_idx(const struct hash_map *hash_map, uint32_t entry_idx)
 {
-    uint32_t next_idx = entry_idx + 1;
-    return next_idx < hash_map->entry_count ? next_idx : 0;
+    return (entry_idx + 1) & (hash_map->entry_count - 1);
+}
+
+static inline void hash_map_set_ctrl(struct hash_map *hash_map, uint32_t entry_idx, uint8_t ctrl)
+{
+    hash_map->ctrl[entry_idx] = ctrl;
+    if (entry_idx < HASH_MAP_GROUP_SIZE - 1)
+        hash_map->ctrl[hash_map->entry_count + entry_idx] = ctrl;
+}
+
+/* Returns a bit mask of the control bytes in the group starting at entry_idx which are equal to ctrl. */
+static inline uint32_t hash_map_match_group(const struct hash_map *hash_map, uint32_t entry_idx, uint8_t ctrl)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)&hash_map->ctrl[entry_idx]);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)ctrl)));
+#else
+    uint32_t mask = 0, i;
+
+    for (i = 0; i < HASH_MAP_GROUP_SIZE; i++)
+    {
+        if (hash_map->ctrl[entry_idx + i] == ctrl)
+            mask |= 1u << i;
+    }
+
+    return mask;
+#endif
 }
 
 static inline uint32_t hash_map_next_size(uint32_t old_size)
 {
-    /* This yields a sequence of primes and numbers with two
-     * relatively large prime factors for any reasonable hash
-     * table size */
-    return old_size ? (old_size * 2 + 5) : 37;
+    return old_size ? old_size * 2 : HASH_MAP_MIN_SIZE;
 }
 
-static inline bool hash_map_grow(struct hash_map *hash_map)
+static inline uint32_t hash_map_find_empty_idx(const struct hash_map *hash_map, uint32_t entry_idx)
 {
-    uint32_t i, old_count, new_count;
+    uint32_t empty_mask;
+
+    /* We never allow the hash table to be completely
+     * populated, so this is guaranteed to return */
+    while (!(empty_mask = hash_map_match_group(hash_map, entry_idx, HASH_MAP_CTRL_EMPTY)))
+        entry_idx = (entry_idx + HASH_MAP_GROUP_SIZE) & (hash_map->entry_count - 1);
+
+    return (entry_idx + vkd3d_bitmask_tzcnt32(empty_mask)) & (hash_map->entry_count - 1);
+}
+
+static inline bool hash_map_resize(struct hash_map *hash_map, uint32_t new_count)
+{
+    uint32_t i, old_count, entry_idx;
     void *new_entries, *old_entries;
+    uint8_t *new_ctrl;
 
     old_count = hash_map->entry_count;
     old_entries = hash_map->entries;
 
-    new_count = hash_map_next_size(hash_map->entry_count);
-
-    if (!(new_entries = vkd3d_calloc(new_count, hash_map->entry_size)))
+    /* Control bytes live in the same allocation, right after the entries. */
+    if (!(new_entries = vkd3d_calloc(1, new_count * hash_map->entry_size + new_count + HASH_MAP_GROUP_SIZE - 1)))
         return false;
 
+    new_ctrl = void_ptr_offset(new_entries, new_count * hash_map->entry_size);
+    memset(new_ctrl, HASH_MAP_CTRL_EMPTY, new_count + HASH_MAP_GROUP_SIZE - 1);
+
     hash_map->entry_count = new_count;
     hash_map->entries = new_entries;
+    hash_map->ctrl = new_ctrl;
+    hash_map->hash_shift = 64 - vkd3d_log2i(new_count);
 
     for (i = 0; i < old_count; i++)
     {
@@ -97,16 +159,9 @@ static inline bool hash_map_grow(struct hash_map *hash_map)
 
         if (old_entry->flags & HASH_MAP_ENTRY_OCCUPIED)
         {
-            uint32_t entry_idx = hash_map_get_entry_idx(hash_map, old_entry->hash_value);
-            struct hash_map_entry *new_entry = hash_map_get_entry(hash_map, entry_idx);
-
-            while (new_entry->flags & HASH_MAP_ENTRY_OCCUPIED)
-            {
-                entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
-                new_entry = hash_map_get_entry(hash_map, entry_idx);
-            }
-
-            memcpy(new_entry, old_entry, hash_map->entry_size);
+            entry_idx = hash_map_find_empty_idx(hash_map, hash_map_get_entry_idx(hash_map, old_entry->hash_value));
+            memcpy(hash_map_get_entry(hash_map, entry_idx), old_entry, hash_map->entry_size);
+            hash_map_set_ctrl(hash_map, entry_idx, hash_map_get_ctrl(old_entry->hash_value));
         }
     }
 
@@ -114,41 +169,89 @@ static inline bool hash_map_grow(struct hash_map *hash_map)
     return true;
 }
 
+static inline bool hash_map_grow(struct hash_map *hash_map)
+{
+    return hash_map_resize(hash_map, hash_map_next_size(hash_map->entry_count));
+}
+
 static inline bool hash_map_should_grow_before_insert(struct hash_map *hash_map)
 {
     /* Allow a load factor of 0.7 for performance reasons */
     return 10 * hash_map->used_count >= 7 * hash_map->entry_count;
 }
 
-static inline struct hash_map_entry *hash_map_find(const struct hash_map *hash_map, const void *key)
+/* Sizes the table up front so that inserting count additional
+ * entries does not rehash the table over and over again. */
+static inline bool hash_map_reserve(struct hash_map *hash_map, uint32_t count)
 {
-    uint32_t hash_value, entry_idx;
+    uint64_t used_count = (uint64_t)hash_map->used_count + count;
+    uint32_t new_count = hash_map->entry_count;
 
-    if (!hash_map->entries)
-        return NULL;
+    if (!count)
+        return true;
+
+    while (10 * used_count >= 7 * (uint64_t)new_count)
+        new_count = hash_map_next_size(new_count);
+
+    if (new_count == hash_map->entry_count)
+        return true;
+
+    return hash_map_resize(hash_map, new_count);
+}
+
+/* Returns the matching entry, or NULL along with the first empty index on the probe sequence. */
+static inline struct hash_map_entry *hash_map_probe(const struct hash_map *hash_map,
+        const void *key, uint32_t hash_value, uint32_t *empty_idx)
+{
+    uint32_t entry_idx, match_mask, empty_mask, idx;
+    struct hash_map_entry *entry;
+    uint8_t ctrl;
 
-    hash_value = hash_map->hash_func(key);
     entry_idx = hash_map_get_entry_idx(hash_map, hash_value);
+    ctrl = hash_map_get_ctrl(hash_value);
 
     /* We never allow the hash table to be completely
      * populated, so this is guaranteed to return */
     while (true)
     {
-        struct hash_map_entry *entry = hash_map_get_entry(hash_map, entry_idx);
+        match_mask = hash_map_match_group(hash_map, entry_idx, ctrl);
+        empty_mask = hash_map_match_group(hash_map, entry_idx, HASH_MAP_CTRL_EMPTY);
 
-        if (!(entry->flags & HASH_MAP_ENTRY_OCCUPIED))
-            return NULL;
+        /* The probe sequence ends at the first empty entry. */
+        if (empty_mask)
+            match_mask &= (empty_mask & -empty_mask) - 1;
+
+        while (match_mask)
+        {
+            idx = (entry_idx + vkd3d_bitmask_iter32(&match_mask)) & (hash_map->entry_count - 1);
+            entry = hash_map_get_entry(hash_map, idx);
 
-        if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
-            return entry;
+            if (entry->hash_value == hash_value && hash_map->compare_func(key, entry))
+                return entry;
+        }
 
-        entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
+        if (empty_mask)
+        {
+            if (empty_idx)
+                *empty_idx = (entry_idx + vkd3d_bitmask_tzcnt32(empty_mask)) & (hash_map->entry_count - 1);
+            return NULL;
+        }
+
+        entry_idx = (entry_idx + HASH_MAP_GROUP_SIZE) & (hash_map->entry_count - 1);
     }
 }
 
+static inline struct hash_map_entry *hash_map_find(const struct hash_map *hash_map, const void *key)
+{
+    if (!hash_map->entries)
+        return NULL;
+
+    return hash_map_probe(hash_map, key, hash_map->hash_func(key), NULL);
+}
+
 static inline struct hash_map_entry *hash_map_insert(struct hash_map *hash_map, const void *key, const struct hash_map_entry *entry)
 {
-    struct hash_map_entry *target = NULL;
+    struct hash_map_entry *target;
     uint32_t hash_value, entry_idx;
 
     if (hash_map_should_grow_before_insert(hash_map))
@@ -158,31 +261,60 @@ static inline struct hash_map_entry *hash_map_insert(struct hash_map *hash_map,
     }
 
     hash_value = hash_map->hash_func(key);
-    entry_idx = hash_map_get_entry_idx(hash_map, hash_value);
 
-    while (!target)
-    {
-        struct hash_map_entry *current = hash_map_get_entry(hash_map, entry_idx);
+    /* If we already have an entry in the hashmap, return the old one.
+     * Caller is responsible for cleaning up the node we attempted to add. */
+    if ((target = hash_map_probe(hash_map, key, hash_value, &entry_idx)))
+        return target;
+
+    target = hash_map_get_entry(hash_map, entry_idx);
+    hash_map->used_count += 1;
+    target->flags = HASH_MAP_ENTRY_OCCUPIED;
+    target->hash_value = hash_value;
+    memcpy(target + 1, entry + 1, hash_map->entry_size - sizeof(*entry));
+    hash_map_set_ctrl(hash_map, entry_idx, hash_map_get_ctrl(hash_value));
+    return target;
+}
 
-        if (!(current->flags & HASH_MAP_ENTRY_OCCUPIED) ||
-                (current->hash_value == hash_value && hash_map->compare_func(key, current)))
-            target = current;
-        else
-            entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
-    }
+static inline void hash_map_remove(struct hash_map *hash_map, struct hash_map_entry *entry)
+{
+    uint32_t hole_idx, entry_idx, ideal_idx;
+    struct hash_map_entry *current;
+    bool can_move;
+
+    hole_idx = (uint32_t)(((char *)entry - (char *)hash_map->entries) / hash_map->entry_size);
+    entry->flags = 0;
+    hash_map_set_ctrl(hash_map, hole_idx, HASH_MAP_CTRL_EMPTY);
+    hash_map->used_count -= 1;
+
+    /* Backward-shift deletion so that lookups never need tombstones. Walk the probe
+     * sequence and move back any entry whose ideal slot does not lie between the
+     * hole and its current position. */
+    entry_idx = hole_idx;
 
-    if (!(target->flags & HASH_MAP_ENTRY_OCCUPIED))
+    while (true)
     {
-        hash_map->used_count += 1;
-        target->flags = HASH_MAP_ENTRY_OCCUPIED;
-        target->hash_value = hash_value;
-        memcpy(target + 1, entry + 1, hash_map->entry_size - sizeof(*entry));
-    }
+        entry_idx = hash_map_next_entry_idx(hash_map, entry_idx);
+        if (hash_map->ctrl[entry_idx] == HASH_MAP_CTRL_EMPTY)
+            break;
 
-    /* If target is occupied, we already have an entry in the hashmap.
-     * Return old one, caller is responsible for cleaning up the node we attempted to add. */
+        current = hash_map_get_entry(hash_map, entry_idx);
+        ideal_idx = hash_map_get_entry_idx(hash_map, current->hash_value);
 
-    return target;
+        if (entry_idx > hole_idx)
+            can_move = ideal_idx <= hole_idx || ideal_idx > entry_idx;
+        else
+            can_move = ideal_idx <= hole_idx && ideal_idx > entry_idx;
+
+        if (can_move)
+        {
+            memcpy(hash_map_get_entry(hash_map, hole_idx), current, hash_map->entry_size);
+            hash_map_set_ctrl(hash_map, hole_idx, hash_map->ctrl[entry_idx]);
+            current->flags = 0;
+            hash_map_set_ctrl(hash_map, entry_idx, HASH_MAP_CTRL_EMPTY);
+            hole_idx = entry_idx;
+        }
+    }
 }
 
 static inline void hash_map_init(struct hash_map *hash_map, pfn_hash_func hash_func, pfn_hash_compare_func compare_func, size_t entry_size)
@@ -190,9 +322,11 @@ static inline void hash_map_init(struct hash_map *hash_map, pfn_hash_func hash_f
     hash_map->hash_func = hash_func;
     hash_map->compare_func = compare_func;
     hash_map->entries = NULL;
+    hash_map->ctrl = NULL;
     hash_map->entry_size = entry_size;
     hash_map->entry_count = 0;
     hash_map->used_count = 0;
+    hash_map->hash_shift = 0;
     assert(entry_size > sizeof(struct hash_map_entry));
 }
 
@@ -200,8 +334,21 @@ static inline void hash_map_clear(struct hash_map *hash_map)
 {
     vkd3d_free(hash_map->entries);
     hash_map->entries = NULL;
+    hash_map->ctrl = NULL;
     hash_map->entry_count = 0;
     hash_map->used_count = 0;
+    hash_map->hash_shift = 0;
+}
+
+/* Removes all entries, but keeps the allocation around for reuse. */
+static inline void hash_map_reset(struct hash_map *hash_map)
+{
+    if (hash_map->used_count)
+    {
+        memset(hash_map->entries, 0, hash_map->entry_count * hash_map->entry_size);
+        memset(hash_map->ctrl, HASH_MAP_CTRL_EMPTY, hash_map->entry_count + HASH_MAP_GROUP_SIZE - 1);
+    }
+    hash_map->used_count = 0;
 }
 
 static inline uint32_t hash_combine(uint32_t old_hash, uint32_t new_hash) {
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_MEMCPY_H
+#define __VKD3D_MEMCPY_H
+
+/* Copy kernels for mapped memory without HOST_CACHED, which is
+ * write-combined or uncached in practice. Without SSE2, both fall
+ * back to memcpy. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* SSE4.1 is not part of the x86-64 baseline, so streaming loads are compiled
+ * for it separately and only used if the CPU reports support at runtime. */
+#if defined(__SSE4_1__)
+#define VKD3D_MEMCPY_HAVE_STREAM_LOAD
+#define VKD3D_MEMCPY_STREAM_LOAD_TARGET
+#elif defined(__SSE2__) && defined(__GNUC__)
+#define VKD3D_MEMCPY_HAVE_STREAM_LOAD
+#define VKD3D_MEMCPY_STREAM_LOAD_TARGET __attribute__((target("sse4.1")))
+#endif
+
+#ifdef VKD3D_MEMCPY_HAVE_STREAM_LOAD
+#include <smmintrin.h>
+#endif
+
+/* Non-temporal stores in full cache lines, so that write-combined memory never
+ * sees partial writes and the destination does not pollute the cache. The caller
+ * must issue vkd3d_memcpy_stream_store_fence() before the data is consumed. */
+static inline void vkd3d_memcpy_stream_store(void *dst_ptr, const void *src_ptr, size_t size)
+{
+#ifdef __SSE2__
+    const uint8_t *src = src_ptr;
+    uint8_t *dst = dst_ptr;
+    __m128i r0, r1, r2, r3;
+    size_t head;
+
+    head = (16 - ((uintptr_t)dst & 15)) & 15;
+
+    if (size < 64 + head)
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    while (size >= 64)
+    {
+        r0 = _mm_loadu_si128((const __m128i *)src + 0);
+        r1 = _mm_loadu_si128((const __m128i *)src + 1);
+        r2 = _mm_loadu_si128((const __m128i *)src + 2);
+        r3 = _mm_loadu_si128((const __m128i *)src + 3);
+        _mm_stream_si128((__m128i *)dst + 0, r0);
+        _mm_stream_si128((__m128i *)dst + 1, r1);
+        _mm_stream_si128((__m128i *)dst + 2, r2);
+        _mm_stream_si128((__m128i *)dst + 3, r3);
+        dst += 64;
+        src += 64;
+        size -= 64;
+    }
+
+    memcpy(dst, src, size);
+#else
+    memcpy(dst_ptr, src_ptr, size);
+#endif
+}
+
+static inline void vkd3d_memcpy_stream_store_fence(void)
+{
+#ifdef __SSE2__
+    _mm_sfence();
+#endif
+}
+
+#ifdef VKD3D_MEMCPY_HAVE_STREAM_LOAD
+static inline VKD3D_MEMCPY_STREAM_LOAD_TARGET void vkd3d_memcpy_stream_load_sse41(uint8_t *dst,
+        const uint8_t *src, size_t size)
+{
+    __m128i r0, r1, r2, r3;
+    size_t head;
+
+    head = (16 - ((uintptr_t)src & 15)) & 15;
+
+    if (size < 64 + head)
+    {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    /* Older headers take a non-const pointer here. */
+    while (size >= 64)
+    {
+        r0 = _mm_stream_load_si128((__m128i *)src + 0);
+        r1 = _mm_stream_load_si128((__m128i *)src + 1);
+        r2 = _mm_stream_load_si128((__m128i *)src + 2);
+        r3 = _mm_stream_load_si128((__m128i *)src + 3);
+        _mm_storeu_si128((__m128i *)dst + 0, r0);
+        _mm_storeu_si128((__m128i *)dst + 1, r1);
+        _mm_storeu_si128((__m128i *)dst + 2, r2);
+        _mm_storeu_si128((__m128i *)dst + 3, r3);
+        dst += 64;
+        src += 64;
+        size -= 64;
+    }
+
+    memcpy(dst, src, size);
+}
+#endif
+
+static inline bool vkd3d_memcpy_stream_load_supported(void)
+{
+#if defined(__SSE4_1__)
+    return true;
+#elif defined(VKD3D_MEMCPY_HAVE_STREAM_LOAD)
+    return __builtin_cpu_supports("sse4.1");
+#else
+    return false;
+#endif
+}
+
+/* Regular loads from uncached memory are not combined and go out one at a time.
+ * Streaming loads fetch whole lines into a fill buffer instead. They are weakly
+ * ordered, so the caller must issue vkd3d_memcpy_stream_load_fence() first, after
+ * whatever established that the data is ready. */
+static inline void vkd3d_memcpy_stream_load(void *dst, const void *src, size_t size, bool supported)
+{
+#ifdef VKD3D_MEMCPY_HAVE_STREAM_LOAD
+    if (supported)
+    {
+        vkd3d_memcpy_stream_load_sse41(dst, src, size);
+        return;
+    }
+#else
+    (void)supported;
+#endif
+
+    memcpy(dst, src, size);
+}
+
+static inline void vkd3d_memcpy_stream_load_fence(void)
+{
+#ifdef __SSE2__
+    _mm_mfence();
+#endif
+}
+
+#endif  /* __VKD3D_MEMCPY_H */
@@ -75,4 +75,12 @@ static inline void vkd3d_free_aligned(void *ptr)
 #endif
 }
 
+/* Allocations of at least this size are eligible for huge pages. */
+#define VKD3D_HUGE_PAGE_SIZE (2u << 20)
+
+/* Returns aligned memory which is backed by huge pages if the system allows it.
+ * huge_pages reports whether that was the case, and must be passed to vkd3d_free_huge(). */
+void *vkd3d_malloc_huge(size_t size, size_t alignment, bool *huge_pages);
+void vkd3d_free_huge(void *ptr, bool huge_pages);
+
 #endif  /* __VKD3D_MEMORY_H */
@@ -21,10 +21,9 @@
 
 #include "vkd3d_windows.h"
 #include "vkd3d_spinlock.h"
+#include "vkd3d_rw_spinlock.h"
 #include <stdint.h>
 
-#ifdef VKD3D_ENABLE_PROFILING
-
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -32,11 +31,7 @@
 #include <time.h>
 #endif
 
-void vkd3d_init_profiling(void);
-bool vkd3d_uses_profiling(void);
-unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock, uint32_t *latch);
-void vkd3d_profiling_notify_work(unsigned int index, uint64_t start_ticks, uint64_t end_ticks, unsigned int iteration_count);
-
+/* Monotonic time in nanoseconds. Also used for timeouts outside of profiling builds. */
 static inline uint64_t vkd3d_profiling_get_tick_count(void)
 {
 #ifdef _WIN32
@@ -54,12 +49,21 @@ static inline uint64_t vkd3d_profiling_get_tick_count(void)
 #endif
 }
 
+#ifdef VKD3D_ENABLE_PROFILING
+
+void vkd3d_init_profiling(void);
+bool vkd3d_uses_profiling(void);
+bool vkd3d_uses_detailed_profiling(void);
+unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock, uint32_t *latch);
+void vkd3d_profiling_notify_work(unsigned int index, uint64_t start_ticks, uint64_t end_ticks, unsigned int iteration_count);
+void vkd3d_profiling_notify_lock(const char *site, uint64_t start_ticks, uint64_t end_ticks, unsigned int spin_count);
+
 #define VKD3D_REGION_DECL(name) \
     static uint32_t _vkd3d_region_latch_##name; \
     static spinlock_t _vkd3d_region_lock_##name; \
-    uint64_t _vkd3d_region_begin_tick_##name; \
+    uint64_t _vkd3d_region_begin_tick_##name = 0; \
     uint64_t _vkd3d_region_end_tick_##name; \
-    unsigned int _vkd3d_region_index_##name
+    unsigned int _vkd3d_region_index_##name = 0
 
 #define VKD3D_REGION_BEGIN(name) \
     do { \
@@ -74,6 +78,93 @@ static inline uint64_t vkd3d_profiling_get_tick_count(void)
         vkd3d_profiling_notify_work(_vkd3d_region_index_##name, _vkd3d_region_begin_tick_##name, _vkd3d_region_end_tick_##name, iter); \
     } while(0)
 
+/* Regions for internal stages, which are only recorded with VKD3D_PROFILE_DETAIL
+ * since they are hit far more often than the API entry points. */
+#define VKD3D_REGION_BEGIN_DETAIL(name) \
+    do { \
+        if (vkd3d_uses_detailed_profiling()) \
+            VKD3D_REGION_BEGIN(name); \
+    } while(0)
+
+#define VKD3D_REGION_END_DETAIL(name) \
+    do { \
+        if (_vkd3d_region_index_##name) \
+            VKD3D_REGION_END(name); \
+    } while(0)
+
+/* Contended lock acquires are recorded per call site as a region named lock@file:line.
+ * Uncontended acquires only cost the extra try-lock. The iteration count of a region is
+ * the number of spin and sleep iterations for spinlocks and the number of contended
+ * acquires for mutexes. */
+#ifndef VKD3D_PROFILING_NO_LOCK_SITES
+#define VKD3D_LOCK_SITE_STRING(x) #x
+#define VKD3D_LOCK_SITE_LINE(x) VKD3D_LOCK_SITE_STRING(x)
+#define VKD3D_LOCK_SITE __FILE__ ":" VKD3D_LOCK_SITE_LINE(__LINE__)
+
+static inline void spinlock_acquire_profiled(spinlock_t *lock, const char *site)
+{
+    unsigned int spin_count;
+    uint64_t start_ticks;
+
+    if (spinlock_try_acquire(lock))
+        return;
+
+    start_ticks = vkd3d_profiling_get_tick_count();
+    spin_count = spinlock_acquire_slow(lock);
+    vkd3d_profiling_notify_lock(site, start_ticks, vkd3d_profiling_get_tick_count(), spin_count);
+}
+
+static inline void rw_spinlock_acquire_read_profiled(spinlock_t *spinlock, const char *site)
+{
+    uint32_t count = vkd3d_atomic_uint32_add(spinlock, VKD3D_RW_SPINLOCK_READ, vkd3d_memory_order_acquire);
+    unsigned int spin_count = 0;
+    uint64_t start_ticks;
+
+    if (!(count & VKD3D_RW_SPINLOCK_WRITE))
+        return;
+
+    start_ticks = vkd3d_profiling_get_tick_count();
+    while (count & VKD3D_RW_SPINLOCK_WRITE)
+    {
+        vkd3d_pause();
+        spin_count++;
+        count = vkd3d_atomic_uint32_load_explicit(spinlock, vkd3d_memory_order_acquire);
+    }
+
+    vkd3d_profiling_notify_lock(site, start_ticks, vkd3d_profiling_get_tick_count(), spin_count);
+}
+
+static inline bool rw_spinlock_try_acquire_write_profiled(spinlock_t *spinlock)
+{
+    return vkd3d_atomic_uint32_load_explicit(spinlock, vkd3d_memory_order_relaxed) == VKD3D_RW_SPINLOCK_IDLE &&
+            vkd3d_atomic_uint32_compare_exchange(spinlock,
+                    VKD3D_RW_SPINLOCK_IDLE, VKD3D_RW_SPINLOCK_WRITE,
+                    vkd3d_memory_order_acquire, vkd3d_memory_order_relaxed) == VKD3D_RW_SPINLOCK_IDLE;
+}
+
+static inline void rw_spinlock_acquire_write_profiled(spinlock_t *spinlock, const char *site)
+{
+    unsigned int spin_count = 0;
+    uint64_t start_ticks;
+
+    if (rw_spinlock_try_acquire_write_profiled(spinlock))
+        return;
+
+    start_ticks = vkd3d_profiling_get_tick_count();
+    do
+    {
+        vkd3d_pause();
+        spin_count++;
+    } while (!rw_spinlock_try_acquire_write_profiled(spinlock));
+
+    vkd3d_profiling_notify_lock(site, start_ticks, vkd3d_profiling_get_tick_count(), spin_count);
+}
+
+#define spinlock_acquire(lock) spinlock_acquire_profiled(lock, VKD3D_LOCK_SITE)
+#define rw_spinlock_acquire_read(lock) rw_spinlock_acquire_read_profiled(lock, VKD3D_LOCK_SITE)
+#define rw_spinlock_acquire_write(lock) rw_spinlock_acquire_write_profiled(lock, VKD3D_LOCK_SITE)
+#endif /* VKD3D_PROFILING_NO_LOCK_SITES */
+
 #else
 static inline void vkd3d_init_profiling(void)
 {
@@ -81,6 +172,8 @@ static inline void vkd3d_init_profiling(void)
 #define VKD3D_REGION_DECL(name) ((void)0)
 #define VKD3D_REGION_BEGIN(name) ((void)0)
 #define VKD3D_REGION_END_ITERATIONS(name, iter) ((void)0)
+#define VKD3D_REGION_BEGIN_DETAIL(name) ((void)0)
+#define VKD3D_REGION_END_DETAIL(name) ((void)0)
 #endif /* VKD3D_ENABLE_PROFILING */
 
 #define VKD3D_REGION_END(name) VKD3D_REGION_END_ITERATIONS(name, 1)
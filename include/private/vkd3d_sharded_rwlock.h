@@ -0,0 +1,94 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_SHARDED_RWLOCK_H
+#define __VKD3D_SHARDED_RWLOCK_H
+
+#include "vkd3d_threads.h"
+#include "vkd3d_atomic.h"
+
+/* Reader-biased lock for read-mostly data. Each thread counts itself as a reader
+ * in one of several shards, each on its own cache line, so concurrent readers do
+ * not bounce a shared counter. Writers are expensive since they have to wait for
+ * every shard to drain, and readers back off while a writer is pending. */
+#define VKD3D_SHARDED_RWLOCK_SHARD_COUNT 16
+
+struct vkd3d_sharded_rwlock_shard
+{
+    uint32_t reader_count;
+    uint8_t padding[64 - sizeof(uint32_t)];
+};
+
+typedef struct sharded_rwlock
+{
+    struct vkd3d_sharded_rwlock_shard shards[VKD3D_SHARDED_RWLOCK_SHARD_COUNT];
+    uint32_t writer_active;
+    pthread_mutex_t write_mutex;
+} sharded_rwlock_t;
+
+extern VKD3D_THREAD_LOCAL uint32_t vkd3d_sharded_rwlock_thread_shard;
+unsigned int vkd3d_sharded_rwlock_assign_thread_shard(void);
+void sharded_rwlock_lock_read_slow(sharded_rwlock_t *lock, struct vkd3d_sharded_rwlock_shard *shard);
+
+static inline struct vkd3d_sharded_rwlock_shard *sharded_rwlock_get_thread_shard(sharded_rwlock_t *lock)
+{
+    /* Shard indices are stored off by one so that zero means unassigned. */
+    unsigned int index = vkd3d_sharded_rwlock_thread_shard;
+
+    if (!index)
+        index = vkd3d_sharded_rwlock_assign_thread_shard();
+    return &lock->shards[index - 1];
+}
+
+static inline int sharded_rwlock_init(sharded_rwlock_t *lock)
+{
+    memset(lock, 0, sizeof(*lock));
+    return pthread_mutex_init(&lock->write_mutex, NULL);
+}
+
+static inline int sharded_rwlock_lock_read(sharded_rwlock_t *lock)
+{
+    struct vkd3d_sharded_rwlock_shard *shard = sharded_rwlock_get_thread_shard(lock);
+
+    /* Both sides publish their own state before checking the other side's,
+     * which needs sequential consistency for the store-load ordering. */
+    vkd3d_atomic_uint32_add(&shard->reader_count, 1, vkd3d_memory_order_seq_cst);
+    if (vkd3d_atomic_uint32_load_explicit(&lock->writer_active, vkd3d_memory_order_seq_cst))
+        sharded_rwlock_lock_read_slow(lock, shard);
+    return 0;
+}
+
+static inline int sharded_rwlock_unlock_read(sharded_rwlock_t *lock)
+{
+    struct vkd3d_sharded_rwlock_shard *shard = sharded_rwlock_get_thread_shard(lock);
+
+    if (!vkd3d_atomic_uint32_sub(&shard->reader_count, 1, vkd3d_memory_order_seq_cst) &&
+            vkd3d_atomic_uint32_load_explicit(&lock->writer_active, vkd3d_memory_order_seq_cst))
+        vkd3d_futex_wake_all(&shard->reader_count);
+    return 0;
+}
+
+int sharded_rwlock_lock_write(sharded_rwlock_t *lock);
+int sharded_rwlock_unlock_write(sharded_rwlock_t *lock);
+
+static inline int sharded_rwlock_destroy(sharded_rwlock_t *lock)
+{
+    return pthread_mutex_destroy(&lock->write_mutex);
+}
+
+#endif
@@ -35,17 +35,31 @@ static inline void vkd3d_pause(void)
 #endif
 }
 
+/* Spinlocks spin for a short while and then sleep on the lock word, so that
+ * waiters do not burn whole time slices when the owner got preempted. */
+#define VKD3D_SPINLOCK_UNLOCKED 0u
+#define VKD3D_SPINLOCK_LOCKED 1u
+/* Locked and there may be sleeping waiters, which the owner needs to wake up. */
+#define VKD3D_SPINLOCK_CONTENDED 2u
+
 #define vkd3d_spinlock_try_lock(lock) \
-    (!vkd3d_atomic_uint32_load_explicit(lock, vkd3d_memory_order_relaxed) && \
-     !vkd3d_atomic_uint32_exchange_explicit(lock, 1u, vkd3d_memory_order_acquire))
+    (vkd3d_atomic_uint32_load_explicit(lock, vkd3d_memory_order_relaxed) == VKD3D_SPINLOCK_UNLOCKED && \
+     vkd3d_atomic_uint32_compare_exchange(lock, VKD3D_SPINLOCK_UNLOCKED, VKD3D_SPINLOCK_LOCKED, \
+             vkd3d_memory_order_acquire, vkd3d_memory_order_relaxed) == VKD3D_SPINLOCK_UNLOCKED)
 
-#define vkd3d_spinlock_unlock(lock) vkd3d_atomic_uint32_store_explicit(lock, 0u, vkd3d_memory_order_release)
+#define vkd3d_spinlock_unlock(lock) \
+    (vkd3d_atomic_uint32_exchange_explicit(lock, VKD3D_SPINLOCK_UNLOCKED, vkd3d_memory_order_release) == \
+     VKD3D_SPINLOCK_CONTENDED)
 
 typedef uint32_t spinlock_t;
 
+/* Returns the number of spin and sleep iterations it took to acquire the lock. */
+unsigned int spinlock_acquire_slow(spinlock_t *lock);
+void spinlock_wake(spinlock_t *lock);
+
 static inline void spinlock_init(spinlock_t *lock)
 {
-    *lock = 0;
+    *lock = VKD3D_SPINLOCK_UNLOCKED;
 }
 
 static inline bool spinlock_try_acquire(spinlock_t *lock)
@@ -55,13 +69,14 @@ static inline bool spinlock_try_acquire(spinlock_t *lock)
 
 static inline void spinlock_acquire(spinlock_t *lock)
 {
-    while (!spinlock_try_acquire(lock))
-        vkd3d_pause();
+    if (!spinlock_try_acquire(lock))
+        spinlock_acquire_slow(lock);
 }
 
 static inline void spinlock_release(spinlock_t *lock)
 {
-    vkd3d_spinlock_unlock(lock);
+    if (vkd3d_spinlock_unlock(lock))
+        spinlock_wake(lock);
 }
 
 #endif
@@ -25,6 +25,7 @@
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <errno.h>
 
 /* pthread_t is passed by value in some functions,
  * which implies we need pthread_t to be a pointer type here. */
@@ -105,6 +106,11 @@ static inline int pthread_mutex_lock(pthread_mutex_t *lock)
     return 0;
 }
 
+static inline int pthread_mutex_trylock(pthread_mutex_t *lock)
+{
+    return TryAcquireSRWLockExclusive(&lock->lock) ? 0 : EBUSY;
+}
+
 static inline int pthread_mutex_unlock(pthread_mutex_t *lock)
 {
     ReleaseSRWLockExclusive(&lock->lock);
@@ -215,6 +221,25 @@ static inline int condvar_reltime_wait_timeout_seconds(condvar_reltime_t *cond,
         return -1;
 }
 
+static inline int condvar_reltime_wait(condvar_reltime_t *cond, pthread_mutex_t *lock)
+{
+    return pthread_cond_wait(cond, lock);
+}
+
+static inline int condvar_reltime_wait_timeout_ns(condvar_reltime_t *cond, pthread_mutex_t *lock, uint64_t timeout_ns)
+{
+    /* Round up so that waiters do not wake up before the timeout has passed. */
+    uint64_t timeout_ms = (timeout_ns + 999999) / 1000000;
+    BOOL ret = SleepConditionVariableSRW(&cond->cond, &lock->lock,
+            timeout_ms < INFINITE ? (DWORD)timeout_ms : INFINITE - 1, 0);
+    if (ret)
+        return 0;
+    else if (GetLastError() == ERROR_TIMEOUT)
+        return 1;
+    else
+        return -1;
+}
+
 static inline void vkd3d_set_thread_name(const char *name)
 {
     (void)name;
@@ -328,6 +353,32 @@ static inline int condvar_reltime_wait_timeout_seconds(condvar_reltime_t *cond,
         return -1;
 }
 
+static inline int condvar_reltime_wait(condvar_reltime_t *cond, pthread_mutex_t *lock)
+{
+    return pthread_cond_wait(&cond->cond, lock);
+}
+
+static inline int condvar_reltime_wait_timeout_ns(condvar_reltime_t *cond, pthread_mutex_t *lock, uint64_t timeout_ns)
+{
+    struct timespec ts;
+    int rc;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    timeout_ns += ts.tv_nsec;
+    ts.tv_sec += timeout_ns / 1000000000ull;
+    ts.tv_nsec = timeout_ns % 1000000000ull;
+
+    /* This is absolute time. */
+    rc = pthread_cond_timedwait(&cond->cond, lock, &ts);
+
+    if (rc == ETIMEDOUT)
+        return 1;
+    else if (rc == 0)
+        return 0;
+    else
+        return -1;
+}
+
 #define PTHREAD_ONCE_CALLBACK
 #endif
 
@@ -335,8 +386,67 @@ static inline int condvar_reltime_wait_timeout_seconds(condvar_reltime_t *cond,
 #include <sys/types.h>
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#elif !defined(_WIN32)
+#include <sched.h>
 #endif
 
+#define VKD3D_FUTEX_INFINITE (~0u)
+
+/* Blocks while *addr == expected. Spurious wakeups are possible, so callers must re-check their condition.
+ * Returns 0 when woken up, 1 on timeout. */
+static inline int vkd3d_futex_wait(uint32_t *addr, uint32_t expected, unsigned int milliseconds)
+{
+#ifdef _WIN32
+    if (WaitOnAddress(addr, &expected, sizeof(expected), milliseconds == VKD3D_FUTEX_INFINITE ? INFINITE : milliseconds))
+        return 0;
+    return GetLastError() == ERROR_TIMEOUT ? 1 : 0;
+#elif defined(__linux__)
+    struct timespec ts;
+
+    if (milliseconds != VKD3D_FUTEX_INFINITE)
+    {
+        ts.tv_sec = milliseconds / 1000;
+        ts.tv_nsec = (milliseconds % 1000) * 1000000;
+    }
+
+    /* FUTEX_WAIT takes a relative timeout. */
+    if (syscall(__NR_futex, addr, FUTEX_WAIT_PRIVATE, expected,
+            milliseconds != VKD3D_FUTEX_INFINITE ? &ts : NULL, NULL, 0) < 0 && errno == ETIMEDOUT)
+        return 1;
+    return 0;
+#else
+    (void)addr;
+    (void)expected;
+    (void)milliseconds;
+    sched_yield();
+    return 0;
+#endif
+}
+
+static inline void vkd3d_futex_wake_one(uint32_t *addr)
+{
+#ifdef _WIN32
+    WakeByAddressSingle(addr);
+#elif defined(__linux__)
+    syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#else
+    (void)addr;
+#endif
+}
+
+static inline void vkd3d_futex_wake_all(uint32_t *addr)
+{
+#ifdef _WIN32
+    WakeByAddressAll(addr);
+#elif defined(__linux__)
+    syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    (void)addr;
+#endif
+}
+
 static inline unsigned int vkd3d_get_current_thread_id(void)
 {
 #ifdef _WIN32
@@ -348,4 +458,22 @@ static inline unsigned int vkd3d_get_current_thread_id(void)
 #endif
 }
 
+#if defined(VKD3D_ENABLE_PROFILING) && !defined(VKD3D_PROFILING_NO_LOCK_SITES)
+static inline int pthread_mutex_lock_profiled(pthread_mutex_t *lock, const char *site)
+{
+    uint64_t start_ticks;
+    int rc;
+
+    if (!pthread_mutex_trylock(lock))
+        return 0;
+
+    start_ticks = vkd3d_profiling_get_tick_count();
+    rc = pthread_mutex_lock(lock);
+    vkd3d_profiling_notify_lock(site, start_ticks, vkd3d_profiling_get_tick_count(), 1);
+    return rc;
+}
+
+#define pthread_mutex_lock(lock) pthread_mutex_lock_profiled(lock, VKD3D_LOCK_SITE)
+#endif
+
 #endif /* __VKD3D_THREADS_H */
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2022 Hans-Kristian Arntzen for Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef __VKD3D_VARINT_H
+#define __VKD3D_VARINT_H
+
+/* LEB128-style varint codec used to compress SPIR-V in pipeline caches and libraries. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "vkd3d_common.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static inline size_t vkd3d_compute_size_varint(const uint32_t *words, size_t word_count)
+{
+    size_t size = 0;
+    uint32_t w;
+    size_t i;
+
+    for (i = 0; i < word_count; i++)
+    {
+        w = words[i];
+        if (w < (1u << 7))
+            size += 1;
+        else if (w < (1u << 14))
+            size += 2;
+        else if (w < (1u << 21))
+            size += 3;
+        else if (w < (1u << 28))
+            size += 4;
+        else
+            size += 5;
+    }
+    return size;
+}
+
+static inline uint8_t *vkd3d_encode_varint(uint8_t *buffer, const uint32_t *words, size_t word_count)
+{
+    uint32_t w;
+    size_t i;
+    for (i = 0; i < word_count; i++)
+    {
+        w = words[i];
+        if (w < (1u << 7))
+            *buffer++ = w;
+        else if (w < (1u << 14))
+        {
+            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
+            *buffer++ = (w >> 7) & 0x7f;
+        }
+        else if (w < (1u << 21))
+        {
+            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
+            *buffer++ = 0x80u | ((w >> 7) & 0x7f);
+            *buffer++ = (w >> 14) & 0x7f;
+        }
+        else if (w < (1u << 28))
+        {
+            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
+            *buffer++ = 0x80u | ((w >> 7) & 0x7f);
+            *buffer++ = 0x80u | ((w >> 14) & 0x7f);
+            *buffer++ = (w >> 21) & 0x7f;
+        }
+        else
+        {
+            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
+            *buffer++ = 0x80u | ((w >> 7) & 0x7f);
+            *buffer++ = 0x80u | ((w >> 14) & 0x7f);
+            *buffer++ = 0x80u | ((w >> 21) & 0x7f);
+            *buffer++ = (w >> 28) & 0x7f;
+        }
+    }
+
+    return buffer;
+}
+
+/* Reference decoder. Rejects truncated and over-long encodings as well as trailing bytes. */
+static inline bool vkd3d_decode_varint_scalar(uint32_t *words, size_t words_size,
+        const uint8_t *buffer, size_t buffer_size)
+{
+    size_t offset = 0;
+    uint32_t shift;
+    uint32_t *w;
+    size_t i;
+
+    for (i = 0; i < words_size; i++)
+    {
+        w = &words[i];
+        *w = 0;
+
+        shift = 0;
+        do
+        {
+            if (offset >= buffer_size || shift >= 32u)
+                return false;
+
+            *w |= (buffer[offset] & 0x7f) << shift;
+            shift += 7;
+        } while (buffer[offset++] & 0x80);
+    }
+
+    return buffer_size == offset;
+}
+
+static inline bool vkd3d_decode_varint(uint32_t *words, size_t words_size, const uint8_t *buffer, size_t buffer_size)
+{
+    size_t offset = 0;
+    size_t i = 0;
+
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int mask, count, length, j;
+    __m128i bytes, lo, hi;
+    uint32_t value;
+
+    /* As long as a full 16 byte window is available, continuation bits can be
+     * pulled out with a single movemask and no per-byte bounds checks are needed.
+     * SPIR-V has long runs of small IDs and literals, which expand without branching. */
+    while (words_size - i >= 16 && buffer_size - offset >= 16)
+    {
+        bytes = _mm_loadu_si128((const __m128i *)&buffer[offset]);
+        mask = _mm_movemask_epi8(bytes);
+
+        if (!mask)
+        {
+            lo = _mm_unpacklo_epi8(bytes, zero);
+            hi = _mm_unpackhi_epi8(bytes, zero);
+            _mm_storeu_si128((__m128i *)&words[i + 0], _mm_unpacklo_epi16(lo, zero));
+            _mm_storeu_si128((__m128i *)&words[i + 4], _mm_unpackhi_epi16(lo, zero));
+            _mm_storeu_si128((__m128i *)&words[i + 8], _mm_unpacklo_epi16(hi, zero));
+            _mm_storeu_si128((__m128i *)&words[i + 12], _mm_unpackhi_epi16(hi, zero));
+            i += 16;
+            offset += 16;
+            continue;
+        }
+
+        /* Single byte words up to the first multi-byte word. */
+        count = vkd3d_bitmask_tzcnt32(mask);
+        for (j = 0; j < count; j++)
+            words[i++] = buffer[offset++];
+
+        /* The multi-byte word ends at the first clear continuation bit.
+         * Over-long encodings are rejected by the scalar path below. */
+        length = vkd3d_bitmask_tzcnt32(~(mask >> count)) + 1;
+        if (length > 5)
+            break;
+
+        /* If the word crosses the end of the window, reload at the new offset. */
+        if (count + length > 16)
+            continue;
+
+        value = 0;
+        for (j = 0; j < length; j++)
+            value |= (buffer[offset + j] & 0x7f) << (7 * j);
+
+        words[i++] = value;
+        offset += length;
+    }
+#endif
+
+    return vkd3d_decode_varint_scalar(words + i, words_size - i, buffer + offset, buffer_size - offset);
+}
+
+#endif  /* __VKD3D_VARINT_H */
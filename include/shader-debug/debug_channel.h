@@ -30,7 +30,7 @@ layout(buffer_reference, std430, buffer_reference_align = 4) buffer ControlBlock
 	uint instance_counter;
 };
 
-layout(buffer_reference, std430, buffer_reference_align = 4) buffer RingBuffer
+layout(buffer_reference, std430, buffer_reference_align = 4) coherent buffer RingBuffer
 {
 	uint data[];
 };
@@ -81,13 +81,23 @@ uint DEBUG_CHANNEL_ALLOCATE(uint words)
 	return offset;
 }
 
+// The last word of each message holds its offset in the ring. It is written after
+// everything else, so that the reader can tell complete messages from partial ones.
+void DEBUG_CHANNEL_COMMIT(RingBuffer buf, uint offset, uint num_words)
+{
+	memoryBarrierBuffer();
+	buf.data[(offset + num_words - 1) & DEBUG_SHADER_RING_MASK] = offset;
+}
+
 void DEBUG_CHANNEL_MSG_()
 {
 	if (!DEBUG_SHADER_RING_ACTIVE)
 		return;
-	uint words = 8;
+	RingBuffer buf = RingBuffer(DEBUG_SHADER_RING_BDA);
+	uint words = 9;
 	uint offset = DEBUG_CHANNEL_ALLOCATE(words);
-	DEBUG_CHANNEL_WRITE_HEADER(RingBuffer(DEBUG_SHADER_RING_BDA), offset, words, 0);
+	DEBUG_CHANNEL_WRITE_HEADER(buf, offset, words, 0);
+	DEBUG_CHANNEL_COMMIT(buf, offset, words);
 }
 
 void DEBUG_CHANNEL_MSG_(uint fmt, uint v0)
@@ -95,10 +105,11 @@ void DEBUG_CHANNEL_MSG_(uint fmt, uint v0)
 	if (!DEBUG_SHADER_RING_ACTIVE)
 		return;
 	RingBuffer buf = RingBuffer(DEBUG_SHADER_RING_BDA);
-	uint words = 9;
+	uint words = 10;
 	uint offset = DEBUG_CHANNEL_ALLOCATE(words);
 	DEBUG_CHANNEL_WRITE_HEADER(buf, offset, words, fmt);
 	buf.data[(offset + 8) & DEBUG_SHADER_RING_MASK] = v0;
+	DEBUG_CHANNEL_COMMIT(buf, offset, words);
 }
 
 void DEBUG_CHANNEL_MSG_(uint fmt, uint v0, uint v1)
@@ -106,11 +117,12 @@ void DEBUG_CHANNEL_MSG_(uint fmt, uint v0, uint v1)
 	if (!DEBUG_SHADER_RING_ACTIVE)
 		return;
 	RingBuffer buf = RingBuffer(DEBUG_SHADER_RING_BDA);
-	uint words = 10;
+	uint words = 11;
 	uint offset = DEBUG_CHANNEL_ALLOCATE(words);
 	DEBUG_CHANNEL_WRITE_HEADER(buf, offset, words, fmt);
 	buf.data[(offset + 8) & DEBUG_SHADER_RING_MASK] = v0;
 	buf.data[(offset + 9) & DEBUG_SHADER_RING_MASK] = v1;
+	DEBUG_CHANNEL_COMMIT(buf, offset, words);
 }
 
 void DEBUG_CHANNEL_MSG_(uint fmt, uint v0, uint v1, uint v2)
@@ -118,12 +130,13 @@ void DEBUG_CHANNEL_MSG_(uint fmt, uint v0, uint v1, uint v2)
 	if (!DEBUG_SHADER_RING_ACTIVE)
 		return;
 	RingBuffer buf = RingBuffer(DEBUG_SHADER_RING_BDA);
-	uint words = 11;
+	uint words = 12;
 	uint offset = DEBUG_CHANNEL_ALLOCATE(words);
 	DEBUG_CHANNEL_WRITE_HEADER(buf, offset, words, fmt);
 	buf.data[(offset + 8) & DEBUG_SHADER_RING_MASK] = v0;
 	buf.data[(offset + 9) & DEBUG_SHADER_RING_MASK] = v1;
 	buf.data[(offset + 10) & DEBUG_SHADER_RING_MASK] = v2;
+	DEBUG_CHANNEL_COMMIT(buf, offset, words);
 }
 
 void DEBUG_CHANNEL_MSG_(uint fmt, uint v0, uint v1, uint v2, uint v3)
@@ -131,13 +144,14 @@ void DEBUG_CHANNEL_MSG_(uint fmt, uint v0, uint v1, uint v2, uint v3)
 	if (!DEBUG_SHADER_RING_ACTIVE)
 		return;
 	RingBuffer buf = RingBuffer(DEBUG_SHADER_RING_BDA);
-	uint words = 12;
+	uint words = 13;
 	uint offset = DEBUG_CHANNEL_ALLOCATE(words);
 	DEBUG_CHANNEL_WRITE_HEADER(buf, offset, words, fmt);
 	buf.data[(offset + 8) & DEBUG_SHADER_RING_MASK] = v0;
 	buf.data[(offset + 9) & DEBUG_SHADER_RING_MASK] = v1;
 	buf.data[(offset + 10) & DEBUG_SHADER_RING_MASK] = v2;
 	buf.data[(offset + 11) & DEBUG_SHADER_RING_MASK] = v3;
+	DEBUG_CHANNEL_COMMIT(buf, offset, words);
 }
 
 void DEBUG_CHANNEL_MSG()
@@ -86,8 +86,24 @@ enum vkd3d_config_flags
     VKD3D_CONFIG_FLAG_MEMORY_ALLOCATOR_SKIP_CLEAR = 0x00800000,
     VKD3D_CONFIG_FLAG_RECYCLE_COMMAND_POOLS = 0x01000000,
     VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_IGNORE_MISMATCH_DRIVER = 0x02000000,
+    VKD3D_CONFIG_FLAG_DEFERRED_COMMAND_LIST_TRANSLATION = 0x04000000,
+    VKD3D_CONFIG_FLAG_BAKE_BUNDLES = 0x08000000,
+    VKD3D_CONFIG_FLAG_SMALL_BUFFER_SLABS = 0x10000000,
+    VKD3D_CONFIG_FLAG_RECYCLE_COMMITTED_RESOURCES = 0x20000000,
+    VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE = 0x40000000,
 };
 
+/* Enumerators have to fit in an int, so later flags are plain 64-bit constants. */
+#define VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_COMPRESS (1ull << 31)
+#define VKD3D_CONFIG_FLAG_PIPELINE_WARMUP (1ull << 32)
+#define VKD3D_CONFIG_FLAG_OPTIMIZE_SPIRV (1ull << 33)
+#define VKD3D_CONFIG_FLAG_META_PREWARM (1ull << 34)
+#define VKD3D_CONFIG_FLAG_LOW_LATENCY (1ull << 35)
+#define VKD3D_CONFIG_FLAG_EVENT_PROFILE (1ull << 36)
+#define VKD3D_CONFIG_FLAG_TRANSFER_OFFLOAD (1ull << 37)
+#define VKD3D_CONFIG_FLAG_HOIST_SRV_UAV (1ull << 38)
+#define VKD3D_CONFIG_FLAG_HUGE_PAGES (1ull << 39)
+
 typedef HRESULT (*PFN_vkd3d_signal_event)(HANDLE event);
 
 typedef void * (*PFN_vkd3d_thread)(void *data);
@@ -79,6 +79,8 @@ struct vkd3d_shader_code
 };
 
 vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader);
+/* Faster, but not interchangeable with vkd3d_shader_hash(). Suitable for internal cache keys. */
+vkd3d_shader_hash_t vkd3d_shader_hash_fast(const struct vkd3d_shader_code *shader);
 
 enum vkd3d_shader_descriptor_type
 {
@@ -105,6 +107,8 @@ enum vkd3d_shader_binding_flag
     VKD3D_SHADER_BINDING_FLAG_BINDLESS   = 0x00000008,
     VKD3D_SHADER_BINDING_FLAG_RAW_VA     = 0x00000010,
     VKD3D_SHADER_BINDING_FLAG_RAW_SSBO   = 0x00000020,
+    /* Only matches raw and structured buffers which are not arrayed. */
+    VKD3D_SHADER_BINDING_FLAG_RAW_BUFFER_ONLY = 0x00000040,
 
     VKD3D_FORCE_32_BIT_ENUM(VKD3D_SHADER_BINDING_FLAG),
 };
@@ -751,6 +755,10 @@ void vkd3d_shader_free_shader_code(struct vkd3d_shader_code *code);
 int vkd3d_shader_parse_root_signature(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_versioned_root_signature_desc *root_signature);
 void vkd3d_shader_free_root_signature(struct vkd3d_versioned_root_signature_desc *root_signature);
+/* Returns a view on the RTS0 chunk inside the container, without copying it. The chunk alone
+ * identifies the root signature, even if it is embedded in different shaders. */
+int vkd3d_shader_extract_root_signature(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_shader_code *chunk);
 
 /* FIXME: Add support for returning error messages (ID3DBlob). */
 int vkd3d_shader_serialize_root_signature(const struct vkd3d_versioned_root_signature_desc *root_signature,
@@ -796,6 +804,25 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
         const struct vkd3d_shader_interface_local_info *shader_interface_local_info,
         const struct vkd3d_shader_compile_arguments *compiler_args);
 
+/* A DXIL library parsed once, so that many exports can be compiled from it
+ * without re-parsing the module. The parsed module lives in a thread-local
+ * allocator context, so a library must be created, used and freed on the same
+ * thread, and no other DXIL compilation may happen on that thread while it is alive. */
+struct vkd3d_shader_dxil_library;
+
+int vkd3d_shader_dxil_library_create(const struct vkd3d_shader_code *dxil,
+        struct vkd3d_shader_dxil_library **library);
+void vkd3d_shader_dxil_library_free(struct vkd3d_shader_dxil_library *library);
+int vkd3d_shader_compile_dxil_library_export(const struct vkd3d_shader_dxil_library *library,
+        const char *export,
+        struct vkd3d_shader_code *spirv,
+        const struct vkd3d_shader_interface_info *shader_interface_info,
+        const struct vkd3d_shader_interface_local_info *shader_interface_local_info,
+        const struct vkd3d_shader_compile_arguments *compiler_args);
+
+/* Strips debug information and removes unreferenced types, constants and variables in place. */
+int vkd3d_shader_optimize_spirv(struct vkd3d_shader_code *spirv);
+
 uint32_t vkd3d_shader_compile_arguments_select_quirks(
         const struct vkd3d_shader_compile_arguments *args, vkd3d_shader_hash_t hash);
 
@@ -815,6 +842,8 @@ typedef void (*PFN_vkd3d_shader_free_shader_code)(struct vkd3d_shader_code *code
 typedef int (*PFN_vkd3d_shader_parse_root_signature)(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_versioned_root_signature_desc *root_signature);
 typedef void (*PFN_vkd3d_shader_free_root_signature)(struct vkd3d_versioned_root_signature_desc *root_signature);
+typedef int (*PFN_vkd3d_shader_extract_root_signature)(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_shader_code *chunk);
 
 typedef int (*PFN_vkd3d_shader_serialize_root_signature)(
         const struct vkd3d_versioned_root_signature_desc *root_signature, struct vkd3d_shader_code *dxbc);
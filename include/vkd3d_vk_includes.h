@@ -54,5 +54,72 @@ typedef struct D3D12_UAV_INFO
     UINT64 gpuVASize;  
 } D3D12_UAV_INFO;
 
+#define D3D12_VK_WRITE_WATCH_FLAG_RESET 0x1
+
+#define D3D12_VK_MAX_MEMORY_TYPES 32
+#define D3D12_VK_MEMORY_ALLOCATOR_STATS_VERSION 1
+
+typedef struct D3D12_VK_MEMORY_TYPE_STATS
+{
+    UINT32 heapIndex;
+    UINT32 propertyFlags;
+    /* All device memory of this type, including chunks */
+    UINT64 allocatedBytes;
+    UINT64 usedBytes;
+    /* Memory that was allocated here after a preferred type ran out */
+    UINT64 fallbackBytes;
+    UINT32 deviceAllocationCount;
+    UINT32 chunkCount;
+    UINT64 chunkBytes;
+    UINT64 chunkFreeBytes;
+    UINT64 largestFreeBlock;
+    UINT32 freeBlockCount;
+    UINT32 suballocationCount;
+} D3D12_VK_MEMORY_TYPE_STATS;
+
+typedef struct D3D12_VK_MEMORY_ALLOCATOR_STATS
+{
+    UINT32 version;
+    UINT32 memoryTypeCount;
+    UINT64 clearBytesPending;
+    UINT32 clearAllocationsPending;
+    D3D12_VK_MEMORY_TYPE_STATS memoryTypes[D3D12_VK_MAX_MEMORY_TYPES];
+} D3D12_VK_MEMORY_ALLOCATOR_STATS;
+
+#define D3D12_VK_GPU_EVENT_NAME_LENGTH 64
+#define D3D12_VK_GPU_EVENT_ALL_FRAMES (~(UINT64)0)
+
+typedef struct D3D12_VK_GPU_EVENT_TIMING
+{
+    /* Number of frames presented before the region was recorded */
+    UINT64 frameIndex;
+    UINT32 commandListType;
+    /* Nesting depth of the region within its command list */
+    UINT32 depth;
+    /* Start of the region in GetClockCalibration CPU ticks, 0 if calibration is not available */
+    UINT64 cpuTimestamp;
+    /* Start of the region in GPU ticks */
+    UINT64 gpuTimestamp;
+    UINT64 durationNs;
+    char name[D3D12_VK_GPU_EVENT_NAME_LENGTH];
+} D3D12_VK_GPU_EVENT_TIMING;
+
+typedef struct D3D12_VK_UPLOAD_RING_T *D3D12_VK_UPLOAD_RING;
+
+typedef enum D3D12_VK_UPLOAD_RING_PLACEMENT
+{
+    /* The GPU reads directly from host-visible VRAM (resizable BAR or UMA) */
+    D3D12_VK_UPLOAD_RING_PLACEMENT_DEVICE_LOCAL = 0,
+    /* CPU writes land in system memory and FlushUploadRing copies them to VRAM */
+    D3D12_VK_UPLOAD_RING_PLACEMENT_SYSTEM_MEMORY_COPY = 1
+} D3D12_VK_UPLOAD_RING_PLACEMENT;
+
+typedef struct D3D12_VK_UPLOAD_RING_ALLOCATION
+{
+    void *cpuAddress;
+    UINT64 gpuAddress;
+    UINT64 size;
+} D3D12_VK_UPLOAD_RING_ALLOCATION;
+
 #endif  // __VKD3D_VK_INCLUDES_H
 
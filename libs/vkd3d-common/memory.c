@@ -21,6 +21,13 @@
 
 #include "vkd3d_memory.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <errno.h>
+#include <sys/mman.h>
+#endif
+
 bool vkd3d_array_reserve(void **elements, size_t *capacity, size_t element_count, size_t element_size)
 {
     size_t new_capacity, max_capacity;
@@ -48,3 +55,65 @@ bool vkd3d_array_reserve(void **elements, size_t *capacity, size_t element_count
 
     return true;
 }
+
+void *vkd3d_malloc_huge(size_t size, size_t alignment, bool *huge_pages)
+{
+#ifdef _WIN32
+    SIZE_T large_page_size;
+#endif
+    void *ptr;
+
+    *huge_pages = false;
+
+    if (size < VKD3D_HUGE_PAGE_SIZE)
+        return vkd3d_malloc_aligned(size, alignment);
+
+#ifdef _WIN32
+    /* Large pages are only granted with SeLockMemoryPrivilege, and their
+     * allocations cannot be aligned beyond the large page size. */
+    large_page_size = GetLargePageMinimum();
+    if (large_page_size && alignment <= large_page_size)
+    {
+        size = align(size, large_page_size);
+        if ((ptr = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)))
+        {
+            *huge_pages = true;
+            return ptr;
+        }
+
+        TRACE("Failed to allocate %zu bytes of large pages, error %lu.\n", size, GetLastError());
+    }
+
+    return vkd3d_malloc_aligned(size, alignment);
+#else
+    alignment = max(alignment, VKD3D_HUGE_PAGE_SIZE);
+    size = align(size, alignment);
+
+    if (!(ptr = vkd3d_malloc_aligned(size, alignment)))
+        return NULL;
+
+#ifdef MADV_HUGEPAGE
+    /* This is only a hint, transparent huge pages may be disabled system-wide.
+     * The memory is untouched at this point, so it can be backed by huge pages on first use. */
+    if (!madvise(ptr, size, MADV_HUGEPAGE))
+        *huge_pages = true;
+    else
+        TRACE("madvise(MADV_HUGEPAGE) failed, errno %d.\n", errno);
+#endif
+
+    return ptr;
+#endif
+}
+
+void vkd3d_free_huge(void *ptr, bool huge_pages)
+{
+#ifdef _WIN32
+    if (huge_pages)
+    {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+        return;
+    }
+#endif
+
+    vkd3d_free_aligned(ptr);
+}
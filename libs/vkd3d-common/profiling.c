@@ -19,10 +19,14 @@
 #ifdef VKD3D_ENABLE_PROFILING
 
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+/* Locks taken by the profiler itself must not recurse into it. */
+#define VKD3D_PROFILING_NO_LOCK_SITES
 
 #include "vkd3d_profiling.h"
 #include "vkd3d_threads.h"
 #include "vkd3d_debug.h"
+#include "vkd3d_common.h"
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -38,20 +42,81 @@
 #endif
 
 static pthread_once_t profiling_block_once = PTHREAD_ONCE_INIT;
+static bool profiling_detail;
 static unsigned int profiling_region_count;
 static spinlock_t profiling_lock;
 
+/* Log-scale latency buckets, five per decade. Bucket 0 counts calls below 100 ns,
+ * bucket i counts calls below vkd3d_profiling_bucket_limits[i] and the last bucket
+ * counts everything from 100 ms. vkd3d-profile.py uses the same limits. */
+#define VKD3D_PROFILING_HISTOGRAM_BUCKETS 32
+
+static const uint64_t vkd3d_profiling_bucket_limits[VKD3D_PROFILING_HISTOGRAM_BUCKETS - 1] =
+{
+    100, 158, 251, 398, 631,
+    1000, 1585, 2512, 3981, 6310,
+    10000, 15849, 25119, 39811, 63096,
+    100000, 158489, 251189, 398107, 630957,
+    1000000, 1584893, 2511886, 3981072, 6309573,
+    10000000, 15848932, 25118864, 39810717, 63095734,
+    100000000,
+};
+
 struct vkd3d_profiling_block
 {
     uint64_t ticks_total;
     uint64_t iteration_total;
-    char name[64 - 2 * sizeof(uint64_t)];
+    uint64_t ticks_max;
+    uint32_t histogram[VKD3D_PROFILING_HISTOGRAM_BUCKETS];
+    char name[256 - 3 * sizeof(uint64_t) - VKD3D_PROFILING_HISTOGRAM_BUCKETS * sizeof(uint32_t)];
 };
 
 static struct vkd3d_profiling_block *mapped_blocks;
 
-#define VKD3D_MAX_PROFILING_REGIONS 256
+#define VKD3D_MAX_PROFILING_REGIONS 1024
 static spinlock_t region_locks[VKD3D_MAX_PROFILING_REGIONS];
+static char region_names[VKD3D_MAX_PROFILING_REGIONS][sizeof(mapped_blocks->name)];
+
+/* Lock sites are string literals, so the pointer identifies the site. */
+#define VKD3D_MAX_PROFILING_LOCK_SITES 1024
+
+struct vkd3d_profiling_lock_site
+{
+    const char *site;
+    uint32_t latch;
+    spinlock_t lock;
+};
+
+static struct vkd3d_profiling_lock_site lock_sites[VKD3D_MAX_PROFILING_LOCK_SITES];
+
+/* With VKD3D_PROFILE_TRACE, every region instance is also recorded as a trace event.
+ * Each thread owns a ring of events which only it writes to. Whoever flushes events,
+ * either the owning thread once its ring is full or the exit handler, holds trace_lock,
+ * so the owning thread only needs to synchronize with the flushed count. */
+#define VKD3D_PROFILING_TRACE_EVENT_COUNT 4096
+
+struct vkd3d_profiling_trace_event
+{
+    uint64_t begin_ticks;
+    uint64_t end_ticks;
+    uint32_t index;
+    uint32_t iteration_count;
+};
+
+struct vkd3d_profiling_trace_thread
+{
+    struct vkd3d_profiling_trace_event events[VKD3D_PROFILING_TRACE_EVENT_COUNT];
+    uint32_t write_count;
+    uint32_t flush_count;
+    unsigned int tid;
+    struct vkd3d_profiling_trace_thread *next;
+};
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file;
+static unsigned int trace_pid;
+static struct vkd3d_profiling_trace_thread *trace_threads;
+static VKD3D_THREAD_LOCAL struct vkd3d_profiling_trace_thread *trace_thread;
 
 #ifdef _WIN32
 static void vkd3d_init_profiling_path(const char *path)
@@ -122,11 +187,138 @@ static void vkd3d_init_profiling_path(const char *path)
 }
 #endif
 
+/* Must be called with trace_lock held. */
+static void vkd3d_profiling_trace_flush_thread(struct vkd3d_profiling_trace_thread *thread)
+{
+    const struct vkd3d_profiling_trace_event *event;
+    uint32_t write_count, i;
+
+    write_count = vkd3d_atomic_uint32_load_explicit(&thread->write_count, vkd3d_memory_order_acquire);
+
+    for (i = thread->flush_count; i != write_count; i++)
+    {
+        event = &thread->events[i % VKD3D_PROFILING_TRACE_EVENT_COUNT];
+
+        /* Chrome trace timestamps are in microseconds. */
+        fprintf(trace_file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+                "\"ts\":%"PRIu64".%03u,\"dur\":%"PRIu64".%03u,\"args\":{\"iterations\":%u}},\n",
+                region_names[event->index], trace_pid, thread->tid,
+                event->begin_ticks / 1000, (unsigned int)(event->begin_ticks % 1000),
+                (event->end_ticks - event->begin_ticks) / 1000,
+                (unsigned int)((event->end_ticks - event->begin_ticks) % 1000),
+                event->iteration_count);
+    }
+
+    /* Release the ring slots back to the owning thread. */
+    vkd3d_atomic_uint32_store_explicit(&thread->flush_count, write_count, vkd3d_memory_order_release);
+}
+
+static void vkd3d_profiling_trace_exit(void)
+{
+    struct vkd3d_profiling_trace_thread *thread;
+
+    pthread_mutex_lock(&trace_lock);
+
+    for (thread = trace_threads; thread; thread = thread->next)
+        vkd3d_profiling_trace_flush_thread(thread);
+
+    /* The array format does not require the closing bracket, but write it for strict parsers. */
+    fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+            "\"args\":{\"name\":\"vkd3d-proton\"}}\n]\n", trace_pid);
+    fclose(trace_file);
+    trace_file = NULL;
+
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void vkd3d_init_profiling_trace(const char *path)
+{
+    char path_pid[1024];
+
+#ifdef _WIN32
+    trace_pid = GetCurrentProcessId();
+#else
+    trace_pid = getpid();
+#endif
+
+    snprintf(path_pid, sizeof(path_pid), "%s.%u.json", path, trace_pid);
+    if (!(trace_file = fopen(path_pid, "w")))
+    {
+        ERR("Failed to open trace file %s.\n", path_pid);
+        return;
+    }
+
+    fprintf(trace_file, "[\n");
+    atexit(vkd3d_profiling_trace_exit);
+}
+
+static struct vkd3d_profiling_trace_thread *vkd3d_profiling_trace_get_thread(void)
+{
+    struct vkd3d_profiling_trace_thread *thread;
+
+    if ((thread = trace_thread))
+        return thread;
+
+    if (!(thread = vkd3d_calloc(1, sizeof(*thread))))
+        return NULL;
+
+    thread->tid = vkd3d_get_current_thread_id();
+
+    /* Threads are never unregistered, so events of threads which have
+     * exited are still written out by the exit handler. */
+    pthread_mutex_lock(&trace_lock);
+    thread->next = trace_threads;
+    trace_threads = thread;
+    pthread_mutex_unlock(&trace_lock);
+
+    trace_thread = thread;
+    return thread;
+}
+
+static void vkd3d_profiling_trace_event(unsigned int index,
+        uint64_t start_ticks, uint64_t end_ticks, unsigned int iteration_count)
+{
+    struct vkd3d_profiling_trace_event *event;
+    struct vkd3d_profiling_trace_thread *thread;
+    uint32_t flush_count;
+
+    if (!(thread = vkd3d_profiling_trace_get_thread()))
+        return;
+
+    flush_count = vkd3d_atomic_uint32_load_explicit(&thread->flush_count, vkd3d_memory_order_acquire);
+
+    if (thread->write_count - flush_count >= VKD3D_PROFILING_TRACE_EVENT_COUNT)
+    {
+        pthread_mutex_lock(&trace_lock);
+        /* The file is closed once the exit handler ran. */
+        if (trace_file)
+            vkd3d_profiling_trace_flush_thread(thread);
+        pthread_mutex_unlock(&trace_lock);
+
+        if (thread->write_count != vkd3d_atomic_uint32_load_explicit(&thread->flush_count, vkd3d_memory_order_acquire))
+            return;
+    }
+
+    event = &thread->events[thread->write_count % VKD3D_PROFILING_TRACE_EVENT_COUNT];
+    event->begin_ticks = start_ticks;
+    event->end_ticks = end_ticks;
+    event->index = index;
+    event->iteration_count = iteration_count;
+
+    vkd3d_atomic_uint32_store_explicit(&thread->write_count, thread->write_count + 1, vkd3d_memory_order_release);
+}
+
 static void vkd3d_init_profiling_once(void)
 {
     const char *path = getenv("VKD3D_PROFILE_PATH");
     if (path)
         vkd3d_init_profiling_path(path);
+
+    if ((path = getenv("VKD3D_PROFILE_TRACE")))
+        vkd3d_init_profiling_trace(path);
+
+    if (vkd3d_uses_profiling() && (path = getenv("VKD3D_PROFILE_DETAIL")))
+        profiling_detail = !!atoi(path);
 }
 
 void vkd3d_init_profiling(void)
@@ -136,13 +328,18 @@ void vkd3d_init_profiling(void)
 
 bool vkd3d_uses_profiling(void)
 {
-    return mapped_blocks != NULL;
+    return mapped_blocks != NULL || trace_file != NULL;
+}
+
+bool vkd3d_uses_detailed_profiling(void)
+{
+    return profiling_detail;
 }
 
 unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock, uint32_t *latch)
 {
     unsigned int index;
-    if (!mapped_blocks)
+    if (!vkd3d_uses_profiling())
         return 0;
 
     spinlock_acquire(lock);
@@ -154,7 +351,9 @@ unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock,
         index = ++profiling_region_count;
         if (index <= VKD3D_MAX_PROFILING_REGIONS)
         {
-            strncpy(mapped_blocks[index - 1].name, name, sizeof(mapped_blocks[index - 1].name) - 1);
+            strncpy(region_names[index - 1], name, sizeof(region_names[index - 1]) - 1);
+            if (mapped_blocks)
+                strncpy(mapped_blocks[index - 1].name, name, sizeof(mapped_blocks[index - 1].name) - 1);
             /* Important to store with release semantics after we've initialized the block. */
             vkd3d_atomic_uint32_store_explicit(latch, index, vkd3d_memory_order_release);
         }
@@ -172,24 +371,108 @@ unsigned int vkd3d_profiling_register_region(const char *name, spinlock_t *lock,
     return index;
 }
 
+static unsigned int vkd3d_profiling_get_bucket(uint64_t ticks)
+{
+    unsigned int lo = 0, hi = ARRAY_SIZE(vkd3d_profiling_bucket_limits), mid;
+
+    /* Find the first limit which is larger than the sample. */
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (ticks < vkd3d_profiling_bucket_limits[mid])
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return lo;
+}
+
 void vkd3d_profiling_notify_work(unsigned int index,
         uint64_t start_ticks, uint64_t end_ticks,
         unsigned int iteration_count)
 {
     struct vkd3d_profiling_block *block;
+    unsigned int bucket;
     spinlock_t *lock;
+    uint64_t ticks;
 
-    if (index == 0 || index > VKD3D_MAX_PROFILING_REGIONS || !mapped_blocks)
+    if (index == 0 || index > VKD3D_MAX_PROFILING_REGIONS)
         return;
     index--;
 
+    if (trace_file)
+        vkd3d_profiling_trace_event(index, start_ticks, end_ticks, iteration_count);
+
+    if (!mapped_blocks)
+        return;
+
     lock = &region_locks[index];
     block = &mapped_blocks[index];
+    ticks = end_ticks - start_ticks;
+    bucket = vkd3d_profiling_get_bucket(ticks);
 
+    /* The histogram counts calls, not iterations. */
     spinlock_acquire(lock);
     block->iteration_total += iteration_count;
-    block->ticks_total += end_ticks - start_ticks;
+    block->ticks_total += ticks;
+    if (ticks > block->ticks_max)
+        block->ticks_max = ticks;
+    block->histogram[bucket]++;
     spinlock_release(lock);
 }
 
+static unsigned int vkd3d_profiling_register_lock_site(const char *site)
+{
+    struct vkd3d_profiling_lock_site *entry;
+    unsigned int i, index;
+    const char *file, *sep;
+    char name[64];
+    uint64_t hash;
+    void *cur;
+
+    hash = ((uint64_t)(uintptr_t)site * 0x9e3779b97f4a7c15ull) >> 32;
+
+    for (i = 0; i < VKD3D_MAX_PROFILING_LOCK_SITES; i++)
+    {
+        entry = &lock_sites[(hash + i) % VKD3D_MAX_PROFILING_LOCK_SITES];
+
+        if (!(cur = vkd3d_atomic_ptr_load_explicit(&entry->site, vkd3d_memory_order_acquire)))
+        {
+            if (!(cur = vkd3d_atomic_ptr_compare_exchange(&entry->site, NULL, (void *)site,
+                    vkd3d_memory_order_acq_rel, vkd3d_memory_order_acquire)))
+                cur = (void *)site;
+        }
+
+        if (cur != site)
+            continue;
+
+        if ((index = vkd3d_atomic_uint32_load_explicit(&entry->latch, vkd3d_memory_order_acquire)))
+            return index;
+
+        /* Strip the directory, the file name and line are enough to find the site. */
+        file = site;
+        if ((sep = strrchr(file, '/')))
+            file = sep + 1;
+        if ((sep = strrchr(file, '\\')))
+            file = sep + 1;
+
+        snprintf(name, sizeof(name), "lock@%s", file);
+        return vkd3d_profiling_register_region(name, &entry->lock, &entry->latch);
+    }
+
+    return 0;
+}
+
+void vkd3d_profiling_notify_lock(const char *site, uint64_t start_ticks, uint64_t end_ticks, unsigned int spin_count)
+{
+    unsigned int index;
+
+    if (!vkd3d_uses_profiling())
+        return;
+
+    if ((index = vkd3d_profiling_register_lock_site(site)))
+        vkd3d_profiling_notify_work(index, start_ticks, end_ticks, spin_count);
+}
+
 #endif /* VKD3D_ENABLE_PROFILING */
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_sharded_rwlock.h"
+
+VKD3D_THREAD_LOCAL uint32_t vkd3d_sharded_rwlock_thread_shard;
+static uint32_t vkd3d_sharded_rwlock_shard_counter;
+
+unsigned int vkd3d_sharded_rwlock_assign_thread_shard(void)
+{
+    /* Round robin keeps threads apart as long as there are fewer threads than shards. */
+    uint32_t index = vkd3d_atomic_uint32_increment(&vkd3d_sharded_rwlock_shard_counter, vkd3d_memory_order_relaxed);
+
+    vkd3d_sharded_rwlock_thread_shard = (index % VKD3D_SHARDED_RWLOCK_SHARD_COUNT) + 1;
+    return vkd3d_sharded_rwlock_thread_shard;
+}
+
+void sharded_rwlock_lock_read_slow(sharded_rwlock_t *lock, struct vkd3d_sharded_rwlock_shard *shard)
+{
+    do
+    {
+        /* Back off so that the writer can drain this shard. */
+        if (!vkd3d_atomic_uint32_sub(&shard->reader_count, 1, vkd3d_memory_order_seq_cst))
+            vkd3d_futex_wake_all(&shard->reader_count);
+
+        while (vkd3d_atomic_uint32_load_explicit(&lock->writer_active, vkd3d_memory_order_acquire))
+            vkd3d_futex_wait(&lock->writer_active, 1, VKD3D_FUTEX_INFINITE);
+
+        vkd3d_atomic_uint32_add(&shard->reader_count, 1, vkd3d_memory_order_seq_cst);
+    } while (vkd3d_atomic_uint32_load_explicit(&lock->writer_active, vkd3d_memory_order_seq_cst));
+}
+
+int sharded_rwlock_lock_write(sharded_rwlock_t *lock)
+{
+    uint32_t count;
+    unsigned int i;
+    int rc;
+
+    /* Writers are serialized among themselves, so only one of them waits for readers. */
+    if ((rc = pthread_mutex_lock(&lock->write_mutex)))
+        return rc;
+
+    vkd3d_atomic_uint32_store_explicit(&lock->writer_active, 1, vkd3d_memory_order_seq_cst);
+
+    for (i = 0; i < ARRAY_SIZE(lock->shards); i++)
+    {
+        while ((count = vkd3d_atomic_uint32_load_explicit(&lock->shards[i].reader_count, vkd3d_memory_order_seq_cst)))
+            vkd3d_futex_wait(&lock->shards[i].reader_count, count, VKD3D_FUTEX_INFINITE);
+    }
+
+    return 0;
+}
+
+int sharded_rwlock_unlock_write(sharded_rwlock_t *lock)
+{
+    vkd3d_atomic_uint32_store_explicit(&lock->writer_active, 0, vkd3d_memory_order_release);
+    vkd3d_futex_wake_all(&lock->writer_active);
+    return pthread_mutex_unlock(&lock->write_mutex);
+}
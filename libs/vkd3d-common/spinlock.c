@@ -0,0 +1,58 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_threads.h"
+#include "vkd3d_spinlock.h"
+
+/* Spinlocks usually protect a handful of instructions, so spin with exponentially growing
+ * pauses first, which adds up to a few microseconds, before going to sleep. */
+#define VKD3D_SPINLOCK_MAX_PAUSE_COUNT 64u
+
+unsigned int spinlock_acquire_slow(spinlock_t *lock)
+{
+    unsigned int spin_count = 0, pause_count, i;
+
+    for (pause_count = 1; pause_count <= VKD3D_SPINLOCK_MAX_PAUSE_COUNT; pause_count *= 2)
+    {
+        for (i = 0; i < pause_count; i++)
+            vkd3d_pause();
+
+        spin_count++;
+        if (spinlock_try_acquire(lock))
+            return spin_count;
+    }
+
+    /* Mark the lock as contended before sleeping so that the owner wakes us up. We cannot
+     * know whether other waiters are still sleeping, so keep the lock marked as contended
+     * once we own it. This may cause a redundant wakeup, but never a lost one. */
+    while (vkd3d_atomic_uint32_exchange_explicit(lock, VKD3D_SPINLOCK_CONTENDED,
+            vkd3d_memory_order_acquire) != VKD3D_SPINLOCK_UNLOCKED)
+    {
+        vkd3d_futex_wait(lock, VKD3D_SPINLOCK_CONTENDED, VKD3D_FUTEX_INFINITE);
+        spin_count++;
+    }
+
+    return spin_count;
+}
+
+void spinlock_wake(spinlock_t *lock)
+{
+    vkd3d_futex_wake_one(lock);
+}
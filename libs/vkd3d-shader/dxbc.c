@@ -511,6 +511,7 @@ struct vkd3d_sm4_data
     struct vkd3d_shader_dst_param dst_param[2];
     struct list src_free;
     struct list src;
+    bool retain_src_params;
     struct vkd3d_shader_immediate_constant_buffer icb;
 };
 
@@ -1493,6 +1494,7 @@ void *shader_sm4_init(const DWORD *byte_code, size_t byte_code_size,
 
     list_init(&priv->src_free);
     list_init(&priv->src);
+    priv->retain_src_params = false;
 
     return priv;
 }
@@ -1902,7 +1904,8 @@ void shader_sm4_read_instruction(void *data, const DWORD **ptr, struct vkd3d_sha
     const DWORD *p;
     DWORD precise;
 
-    list_move_head(&priv->src_free, &priv->src);
+    if (!priv->retain_src_params)
+        list_move_head(&priv->src_free, &priv->src);
 
     if (*ptr >= priv->end)
     {
@@ -2003,6 +2006,12 @@ fail:
     return;
 }
 
+void shader_sm4_retain_src_params(void *data)
+{
+    struct vkd3d_sm4_data *priv = data;
+    priv->retain_src_params = true;
+}
+
 bool shader_sm4_is_end(void *data, const DWORD **ptr)
 {
     struct vkd3d_sm4_data *priv = data;
@@ -2109,7 +2118,7 @@ static int parse_dxbc(const char *data, size_t data_size,
         return VKD3D_ERROR_INVALID_ARGUMENT;
     }
 
-    WARN("Ignoring DXBC checksum.\n");
+    TRACE("Ignoring DXBC checksum.\n");
     skip_dword_unknown(&ptr, 4);
 
     read_dword(&ptr, &version);
@@ -2865,6 +2874,32 @@ int vkd3d_shader_parse_root_signature(const struct vkd3d_shader_code *dxbc,
     return VKD3D_OK;
 }
 
+static int rts0_extract_handler(const char *data, DWORD data_size, DWORD tag, void *context)
+{
+    struct vkd3d_shader_code *chunk = context;
+
+    if (tag != TAG_RTS0)
+        return VKD3D_OK;
+
+    chunk->code = data;
+    chunk->size = data_size;
+    return VKD3D_OK;
+}
+
+int vkd3d_shader_extract_root_signature(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_shader_code *chunk)
+{
+    int ret;
+
+    TRACE("dxbc {%p, %zu}, chunk %p.\n", dxbc->code, dxbc->size, chunk);
+
+    memset(chunk, 0, sizeof(*chunk));
+    if ((ret = parse_dxbc(dxbc->code, dxbc->size, rts0_extract_handler, chunk)) < 0)
+        return ret;
+
+    return chunk->code ? VKD3D_OK : VKD3D_ERROR_INVALID_ARGUMENT;
+}
+
 static unsigned int versioned_root_signature_get_parameter_count(const struct vkd3d_versioned_root_signature_desc *desc)
 {
     if (desc->version == VKD3D_ROOT_SIGNATURE_VERSION_1_0)
@@ -106,6 +106,17 @@ static bool dxil_resource_is_in_range(const struct vkd3d_shader_resource_binding
            ((d3d_binding->register_index - binding->register_index) < binding->register_count);
 }
 
+static bool dxil_resource_matches_raw_buffer_only(const struct vkd3d_shader_resource_binding *binding,
+        const dxil_spv_d3d_binding *d3d_binding)
+{
+    if (!(binding->flags & VKD3D_SHADER_BINDING_FLAG_RAW_BUFFER_ONLY))
+        return true;
+
+    return d3d_binding->range_size == 1 &&
+            (d3d_binding->kind == DXIL_SPV_RESOURCE_KIND_RAW_BUFFER ||
+            d3d_binding->kind == DXIL_SPV_RESOURCE_KIND_STRUCTURED_BUFFER);
+}
+
 static bool vkd3d_shader_binding_is_root_descriptor(const struct vkd3d_shader_resource_binding *binding)
 {
     const uint32_t relevant_flags = VKD3D_SHADER_BINDING_FLAG_RAW_VA |
@@ -148,7 +159,8 @@ static dxil_spv_bool dxil_remap_inner(
         if (binding->type == descriptor_type &&
             dxil_resource_is_in_range(binding, d3d_binding) &&
             (match_flags & resource_flags) == resource_flags &&
-            dxil_match_shader_visibility(binding->shader_visibility, d3d_binding->stage))
+            dxil_match_shader_visibility(binding->shader_visibility, d3d_binding->stage) &&
+            dxil_resource_matches_raw_buffer_only(binding, d3d_binding))
         {
             memset(vk_binding, 0, sizeof(*vk_binding));
 
@@ -256,6 +268,10 @@ static dxil_spv_bool dxil_srv_remap(void *userdata, const dxil_spv_d3d_binding *
     if (use_ssbo && dxil_remap(remap, VKD3D_SHADER_DESCRIPTOR_TYPE_SRV,
             d3d_binding, &vk_binding->buffer_binding, resource_flags_ssbo))
     {
+        /* Hoisted table descriptors resolve to BDA in the SSBO pass as well. */
+        if (vk_binding->buffer_binding.descriptor_type == DXIL_SPV_VULKAN_DESCRIPTOR_TYPE_BUFFER_DEVICE_ADDRESS)
+            return DXIL_SPV_TRUE;
+
         vk_binding->buffer_binding.descriptor_type = DXIL_SPV_VULKAN_DESCRIPTOR_TYPE_SSBO;
         if (shader_interface_info->flags & VKD3D_SHADER_INTERFACE_SSBO_OFFSET_BUFFER)
         {
@@ -365,11 +381,15 @@ static dxil_spv_bool dxil_uav_remap(void *userdata, const dxil_spv_uav_d3d_bindi
         if (dxil_remap(remap, VKD3D_SHADER_DESCRIPTOR_TYPE_UAV, &d3d_binding->d3d_binding,
                 &vk_binding->buffer_binding, resource_flags_ssbo))
         {
-            vk_binding->buffer_binding.descriptor_type = DXIL_SPV_VULKAN_DESCRIPTOR_TYPE_SSBO;
-            if (shader_interface_info->flags & VKD3D_SHADER_INTERFACE_SSBO_OFFSET_BUFFER)
+            /* Hoisted table descriptors resolve to BDA in the SSBO pass as well. */
+            if (vk_binding->buffer_binding.descriptor_type != DXIL_SPV_VULKAN_DESCRIPTOR_TYPE_BUFFER_DEVICE_ADDRESS)
             {
-                vk_binding->offset_binding.set = shader_interface_info->offset_buffer_binding->set;
-                vk_binding->offset_binding.binding = shader_interface_info->offset_buffer_binding->binding;
+                vk_binding->buffer_binding.descriptor_type = DXIL_SPV_VULKAN_DESCRIPTOR_TYPE_SSBO;
+                if (shader_interface_info->flags & VKD3D_SHADER_INTERFACE_SSBO_OFFSET_BUFFER)
+                {
+                    vk_binding->offset_binding.set = shader_interface_info->offset_buffer_binding->set;
+                    vk_binding->offset_binding.binding = shader_interface_info->offset_buffer_binding->binding;
+                }
             }
         }
         else if (!dxil_remap(remap, VKD3D_SHADER_DESCRIPTOR_TYPE_UAV, &d3d_binding->d3d_binding,
@@ -879,7 +899,51 @@ end:
     return ret;
 }
 
-int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
+struct vkd3d_shader_dxil_library
+{
+    dxil_spv_parsed_blob blob;
+    vkd3d_shader_hash_t hash;
+};
+
+int vkd3d_shader_dxil_library_create(const struct vkd3d_shader_code *dxil,
+        struct vkd3d_shader_dxil_library **library)
+{
+    struct vkd3d_shader_dxil_library *object;
+
+    if (!(object = vkd3d_calloc(1, sizeof(*object))))
+        return VKD3D_ERROR_OUT_OF_MEMORY;
+
+    dxil_spv_set_thread_log_callback(vkd3d_dxil_log_callback, NULL);
+
+    /* The parsed module is allocated from the thread allocator context,
+     * so the context has to stay alive until the library is freed. */
+    dxil_spv_begin_thread_allocator_context();
+
+    object->hash = vkd3d_shader_hash(dxil);
+    vkd3d_shader_dump_shader(object->hash, dxil, "lib.dxil");
+
+    if (dxil_spv_parse_dxil_blob(dxil->code, dxil->size, &object->blob) != DXIL_SPV_SUCCESS)
+    {
+        dxil_spv_end_thread_allocator_context();
+        vkd3d_free(object);
+        return VKD3D_ERROR_INVALID_SHADER;
+    }
+
+    *library = object;
+    return VKD3D_OK;
+}
+
+void vkd3d_shader_dxil_library_free(struct vkd3d_shader_dxil_library *library)
+{
+    if (!library)
+        return;
+
+    dxil_spv_parsed_blob_free(library->blob);
+    dxil_spv_end_thread_allocator_context();
+    vkd3d_free(library);
+}
+
+int vkd3d_shader_compile_dxil_library_export(const struct vkd3d_shader_dxil_library *library,
         const char *export,
         struct vkd3d_shader_code *spirv,
         const struct vkd3d_shader_interface_info *shader_interface_info,
@@ -895,7 +959,6 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
     unsigned int num_root_descriptors = 0;
     unsigned int root_constant_words = 0;
     dxil_spv_converter converter = NULL;
-    dxil_spv_parsed_blob blob = NULL;
     dxil_spv_compiled_spirv compiled;
     unsigned int i, j, max_size;
     vkd3d_shader_hash_t hash;
@@ -906,7 +969,7 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
     dxil_spv_set_thread_log_callback(vkd3d_dxil_log_callback, NULL);
 
     memset(&spirv->meta, 0, sizeof(spirv->meta));
-    hash = vkd3d_shader_hash(dxil);
+    hash = library->hash;
     spirv->meta.hash = hash;
     demangled_export = vkd3d_dup_demangled_entry_point_ascii(export);
     if (demangled_export)
@@ -919,17 +982,7 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
         }
     }
 
-    dxil_spv_begin_thread_allocator_context();
-
-    vkd3d_shader_dump_shader(hash, dxil, "lib.dxil");
-
-    if (dxil_spv_parse_dxil_blob(dxil->code, dxil->size, &blob) != DXIL_SPV_SUCCESS)
-    {
-        ret = VKD3D_ERROR_INVALID_SHADER;
-        goto end;
-    }
-
-    if (dxil_spv_create_converter(blob, &converter) != DXIL_SPV_SUCCESS)
+    if (dxil_spv_create_converter(library->blob, &converter) != DXIL_SPV_SUCCESS)
     {
         ret = VKD3D_ERROR_INVALID_ARGUMENT;
         goto end;
@@ -1297,12 +1350,29 @@ int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
 
 end:
     dxil_spv_converter_free(converter);
-    dxil_spv_parsed_blob_free(blob);
-    dxil_spv_end_thread_allocator_context();
     vkd3d_free(demangled_export);
     return ret;
 }
 
+int vkd3d_shader_compile_dxil_export(const struct vkd3d_shader_code *dxil,
+        const char *export,
+        struct vkd3d_shader_code *spirv,
+        const struct vkd3d_shader_interface_info *shader_interface_info,
+        const struct vkd3d_shader_interface_local_info *shader_interface_local_info,
+        const struct vkd3d_shader_compile_arguments *compiler_args)
+{
+    struct vkd3d_shader_dxil_library *library;
+    int ret;
+
+    if ((ret = vkd3d_shader_dxil_library_create(dxil, &library)) < 0)
+        return ret;
+
+    ret = vkd3d_shader_compile_dxil_library_export(library, export, spirv,
+            shader_interface_info, shader_interface_local_info, compiler_args);
+    vkd3d_shader_dxil_library_free(library);
+    return ret;
+}
+
 void vkd3d_shader_dxil_free_library_entry_points(struct vkd3d_shader_library_entry_point *entry_points, size_t count)
 {
     size_t i;
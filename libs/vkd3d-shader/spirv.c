@@ -73,6 +73,71 @@ static enum vkd3d_shader_input_sysval_semantic vkd3d_siv_from_sysval(enum vkd3d_
 #define VKD3D_SPIRV_GENERATOR_VERSION 1
 #define VKD3D_SPIRV_GENERATOR_MAGIC ((VKD3D_SPIRV_GENERATOR_ID << 16) | VKD3D_SPIRV_GENERATOR_VERSION)
 
+/* Bump allocator for the many small objects a compile creates, e.g. declarations
+ * and symbols. Nothing is freed individually, the whole arena goes at once. */
+#define VKD3D_SPIRV_ARENA_BLOCK_SIZE (64 * 1024)
+#define VKD3D_SPIRV_ARENA_ALIGNMENT 16
+
+struct vkd3d_spirv_arena_block
+{
+    struct vkd3d_spirv_arena_block *prev;
+    size_t size;
+    size_t offset;
+};
+
+struct vkd3d_spirv_arena
+{
+    struct vkd3d_spirv_arena_block *block;
+};
+
+static void *vkd3d_spirv_arena_alloc(struct vkd3d_spirv_arena *arena, size_t size)
+{
+    const size_t header_size = align(sizeof(struct vkd3d_spirv_arena_block), VKD3D_SPIRV_ARENA_ALIGNMENT);
+    struct vkd3d_spirv_arena_block *block = arena->block;
+    size_t block_size;
+    void *ptr;
+
+    size = align(size, VKD3D_SPIRV_ARENA_ALIGNMENT);
+
+    if (!block || block->offset + size > block->size)
+    {
+        block_size = max(size + header_size, VKD3D_SPIRV_ARENA_BLOCK_SIZE);
+        if (!(block = vkd3d_malloc(block_size)))
+            return NULL;
+
+        block->prev = arena->block;
+        block->size = block_size;
+        block->offset = header_size;
+        arena->block = block;
+    }
+
+    ptr = (uint8_t *)block + block->offset;
+    block->offset += size;
+    return ptr;
+}
+
+static void *vkd3d_spirv_arena_calloc(struct vkd3d_spirv_arena *arena, size_t size)
+{
+    void *ptr;
+
+    if ((ptr = vkd3d_spirv_arena_alloc(arena, size)))
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+static void vkd3d_spirv_arena_free(struct vkd3d_spirv_arena *arena)
+{
+    struct vkd3d_spirv_arena_block *block, *prev;
+
+    for (block = arena->block; block; block = prev)
+    {
+        prev = block->prev;
+        vkd3d_free(block);
+    }
+
+    arena->block = NULL;
+}
+
 struct vkd3d_spirv_stream
 {
     uint32_t *words;
@@ -199,6 +264,7 @@ struct vkd3d_spirv_builder
 
     uint32_t current_id;
     uint32_t main_function_id;
+    struct vkd3d_spirv_arena arena;
     struct rb_tree declarations;
     uint32_t type_sampler_id;
     uint32_t type_bool_id;
@@ -381,13 +447,6 @@ static int vkd3d_spirv_declaration_compare(const void *key, const struct rb_entr
     return memcmp(&a->parameters, &b->parameters, a->parameter_count * sizeof(*a->parameters));
 }
 
-static void vkd3d_spirv_declaration_free(struct rb_entry *entry, void *context)
-{
-    struct vkd3d_spirv_declaration *d = RB_ENTRY_VALUE(entry, struct vkd3d_spirv_declaration, entry);
-
-    vkd3d_free(d);
-}
-
 static void vkd3d_spirv_insert_declaration(struct vkd3d_spirv_builder *builder,
         const struct vkd3d_spirv_declaration *declaration)
 {
@@ -395,14 +454,11 @@ static void vkd3d_spirv_insert_declaration(struct vkd3d_spirv_builder *builder,
 
     assert(declaration->parameter_count <= ARRAY_SIZE(declaration->parameters));
 
-    if (!(d = vkd3d_malloc(sizeof(*d))))
+    if (!(d = vkd3d_spirv_arena_alloc(&builder->arena, sizeof(*d))))
         return;
     memcpy(d, declaration, sizeof(*d));
     if (rb_put(&builder->declarations, d, &d->entry) == -1)
-    {
         ERR("Failed to insert declaration entry.\n");
-        vkd3d_free(d);
-    }
 }
 
 static uint32_t vkd3d_spirv_build_once_v(struct vkd3d_spirv_builder *builder,
@@ -1745,6 +1801,7 @@ static void vkd3d_spirv_builder_init(struct vkd3d_spirv_builder *builder)
 
     builder->current_id = 1;
 
+    builder->arena.block = NULL;
     rb_init(&builder->declarations, vkd3d_spirv_declaration_compare);
 
     builder->main_function_id = vkd3d_spirv_alloc_id(builder);
@@ -1775,10 +1832,12 @@ static void vkd3d_spirv_builder_free(struct vkd3d_spirv_builder *builder)
 
     vkd3d_spirv_stream_free(&builder->insertion_stream);
 
-    rb_destroy(&builder->declarations, vkd3d_spirv_declaration_free, NULL);
+    rb_destroy(&builder->declarations, NULL, NULL);
 
     vkd3d_free(builder->capabilities);
     vkd3d_free(builder->iface);
+
+    vkd3d_spirv_arena_free(&builder->arena);
 }
 
 enum vkd3d_spirv_extension
@@ -2052,20 +2111,6 @@ static int vkd3d_sm51_symbol_compare(const void *key, const struct rb_entry *ent
     return memcmp(a, &b->key, sizeof(*a));
 }
 
-static void vkd3d_symbol_free(struct rb_entry *entry, void *context)
-{
-    struct vkd3d_symbol *s = RB_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
-
-    vkd3d_free(s);
-}
-
-static void vkd3d_sm51_symbol_free(struct rb_entry *entry, void *context)
-{
-    struct vkd3d_sm51_symbol *s = RB_ENTRY_VALUE(entry, struct vkd3d_sm51_symbol, entry);
-
-    vkd3d_free(s);
-}
-
 static void vkd3d_symbol_make_register(struct vkd3d_symbol *symbol,
         const struct vkd3d_shader_register *reg)
 {
@@ -2103,11 +2148,12 @@ static void vkd3d_symbol_make_resource(struct vkd3d_symbol *symbol,
     symbol->key.resource.idx = reg->idx[0].offset;
 }
 
-static struct vkd3d_symbol *vkd3d_symbol_dup(const struct vkd3d_symbol *symbol)
+static struct vkd3d_symbol *vkd3d_symbol_dup(struct vkd3d_spirv_arena *arena,
+        const struct vkd3d_symbol *symbol)
 {
     struct vkd3d_symbol *s;
 
-    if (!(s = vkd3d_malloc(sizeof(*s))))
+    if (!(s = vkd3d_spirv_arena_alloc(arena, sizeof(*s))))
         return NULL;
 
     return memcpy(s, symbol, sizeof(*s));
@@ -2629,12 +2675,10 @@ static void vkd3d_dxbc_compiler_put_symbol(struct vkd3d_dxbc_compiler *compiler,
 {
     struct vkd3d_symbol *s;
 
-    s = vkd3d_symbol_dup(symbol);
+    if (!(s = vkd3d_symbol_dup(&compiler->spirv_builder.arena, symbol)))
+        return;
     if (rb_put(&compiler->symbol_table, s, &s->entry) == -1)
-    {
         ERR("Failed to insert symbol entry (%s).\n", debug_vkd3d_symbol(symbol));
-        vkd3d_free(s);
-    }
 }
 
 static uint32_t vkd3d_dxbc_compiler_get_constant(struct vkd3d_dxbc_compiler *compiler,
@@ -6394,13 +6438,15 @@ static void vkd3d_dxbc_compiler_emit_dcl_constant_buffer(struct vkd3d_dxbc_compi
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
-        sym->key.idx = reg->idx[0].offset;
-        sym->key.descriptor_type = VKD3D_SHADER_DESCRIPTOR_TYPE_CBV;
-        sym->register_space = instruction->declaration.cb.register_space;
-        sym->resource_idx = instruction->declaration.cb.register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+
+        if ((sym = vkd3d_spirv_arena_calloc(&compiler->spirv_builder.arena, sizeof(*sym))))
+        {
+            sym->key.idx = reg->idx[0].offset;
+            sym->key.descriptor_type = VKD3D_SHADER_DESCRIPTOR_TYPE_CBV;
+            sym->register_space = instruction->declaration.cb.register_space;
+            sym->resource_idx = instruction->declaration.cb.register_index;
+            rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
+        }
     }
 
     if ((push_cb = vkd3d_dxbc_compiler_find_push_constant_buffer(compiler, cb)))
@@ -6515,13 +6561,15 @@ static void vkd3d_dxbc_compiler_emit_dcl_sampler(struct vkd3d_dxbc_compiler *com
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
-        sym->key.idx = reg->idx[0].offset;
-        sym->key.descriptor_type = VKD3D_SHADER_DESCRIPTOR_TYPE_SAMPLER;
-        sym->register_space = instruction->declaration.sampler.register_space;
-        sym->resource_idx = instruction->declaration.sampler.register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+
+        if ((sym = vkd3d_spirv_arena_calloc(&compiler->spirv_builder.arena, sizeof(*sym))))
+        {
+            sym->key.idx = reg->idx[0].offset;
+            sym->key.descriptor_type = VKD3D_SHADER_DESCRIPTOR_TYPE_SAMPLER;
+            sym->register_space = instruction->declaration.sampler.register_space;
+            sym->resource_idx = instruction->declaration.sampler.register_index;
+            rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
+        }
     }
 
     binding = vkd3d_dxbc_compiler_get_resource_binding(compiler, reg,
@@ -6857,13 +6905,15 @@ static void vkd3d_dxbc_compiler_emit_dcl_resource(struct vkd3d_dxbc_compiler *co
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
-        sym->key.idx = semantic->reg.reg.idx[0].offset;
-        sym->key.descriptor_type = semantic->reg.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
-        sym->register_space = semantic->register_space;
-        sym->resource_idx = semantic->register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+
+        if ((sym = vkd3d_spirv_arena_calloc(&compiler->spirv_builder.arena, sizeof(*sym))))
+        {
+            sym->key.idx = semantic->reg.reg.idx[0].offset;
+            sym->key.descriptor_type = semantic->reg.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+            sym->register_space = semantic->register_space;
+            sym->resource_idx = semantic->register_index;
+            rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
+        }
     }
 
     vkd3d_dxbc_compiler_emit_resource_declaration(compiler, instruction, &semantic->reg.reg,
@@ -6878,13 +6928,15 @@ static void vkd3d_dxbc_compiler_emit_dcl_resource_raw(struct vkd3d_dxbc_compiler
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
-        sym->key.idx = resource->dst.reg.idx[0].offset;
-        sym->key.descriptor_type = resource->dst.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
-        sym->register_space = resource->register_space;
-        sym->resource_idx = resource->register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+
+        if ((sym = vkd3d_spirv_arena_calloc(&compiler->spirv_builder.arena, sizeof(*sym))))
+        {
+            sym->key.idx = resource->dst.reg.idx[0].offset;
+            sym->key.descriptor_type = resource->dst.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+            sym->register_space = resource->register_space;
+            sym->resource_idx = resource->register_index;
+            rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
+        }
     }
 
     vkd3d_dxbc_compiler_emit_resource_declaration(compiler, instruction, &resource->dst.reg,
@@ -6901,13 +6953,15 @@ static void vkd3d_dxbc_compiler_emit_dcl_resource_structured(struct vkd3d_dxbc_c
     if (shader_is_sm_5_1(compiler))
     {
         struct vkd3d_sm51_symbol *sym;
-        sym = vkd3d_calloc(1, sizeof(*sym));
-        sym->key.idx = resource->reg.reg.idx[0].offset;
-        sym->key.descriptor_type = resource->reg.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
-        sym->register_space = resource->register_space;
-        sym->resource_idx = resource->register_index;
-        if (rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry) == -1)
-            vkd3d_free(sym);
+
+        if ((sym = vkd3d_spirv_arena_calloc(&compiler->spirv_builder.arena, sizeof(*sym))))
+        {
+            sym->key.idx = resource->reg.reg.idx[0].offset;
+            sym->key.descriptor_type = resource->reg.reg.type == VKD3DSPR_UAV ? VKD3D_SHADER_DESCRIPTOR_TYPE_UAV : VKD3D_SHADER_DESCRIPTOR_TYPE_SRV;
+            sym->register_space = resource->register_space;
+            sym->resource_idx = resource->register_index;
+            rb_put(&compiler->sm51_resource_table, &sym->key, &sym->entry);
+        }
     }
 
     vkd3d_dxbc_compiler_emit_resource_declaration(compiler, instruction, reg,
@@ -7294,10 +7348,7 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
                 symbol->info.reg.is_aggregate = false;
 
                 if (rb_put(&compiler->symbol_table, symbol, entry) == -1)
-                {
                     ERR("Failed to insert vocp symbol entry (%s).\n", debug_vkd3d_symbol(symbol));
-                    vkd3d_symbol_free(entry, NULL);
-                }
             }
         }
     }
@@ -7320,7 +7371,6 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
             if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
             {
                 rb_remove(&compiler->symbol_table, entry);
-                vkd3d_symbol_free(entry, NULL);
             }
         }
     }
@@ -7333,7 +7383,6 @@ static void vkd3d_dxbc_compiler_leave_shader_phase(struct vkd3d_dxbc_compiler *c
         if ((entry = rb_get(&compiler->symbol_table, &reg_symbol)))
         {
             rb_remove(&compiler->symbol_table, entry);
-            vkd3d_symbol_free(entry, NULL);
         }
     }
 }
@@ -8828,6 +8877,10 @@ static const struct vkd3d_symbol *vkd3d_dxbc_compiler_find_resource(struct vkd3d
     return RB_ENTRY_VALUE(entry, struct vkd3d_symbol, entry);
 }
 
+/* The offset of a range within its table is known from the root signature and is folded into
+ * the index as a constant. The table base only becomes known at SetRoot*DescriptorTable time and
+ * changes between draws, so it has to come from push constants rather than being specialized into
+ * the pipeline. */
 static uint32_t vkd3d_dxbc_compiler_load_descriptor_table_offset(struct vkd3d_dxbc_compiler *compiler,
         unsigned int descriptor_table)
 {
@@ -11159,8 +11212,8 @@ void vkd3d_dxbc_compiler_destroy(struct vkd3d_dxbc_compiler *compiler)
 
     vkd3d_spirv_builder_free(&compiler->spirv_builder);
 
-    rb_destroy(&compiler->symbol_table, vkd3d_symbol_free, NULL);
-    rb_destroy(&compiler->sm51_resource_table, vkd3d_sm51_symbol_free, NULL);
+    rb_destroy(&compiler->symbol_table, NULL, NULL);
+    rb_destroy(&compiler->sm51_resource_table, NULL, NULL);
 
     vkd3d_free(compiler->shader_phases);
     vkd3d_free(compiler->spec_constants);
@@ -0,0 +1,239 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_SHADER
+
+#include "vkd3d_shader_private.h"
+
+#include "spirv/unified1/spirv.h"
+
+/* A small cleanup pass over finished SPIR-V modules. It strips debug instructions and removes
+ * types, constants and local or private variables which nothing refers to. Operand layouts are
+ * not decoded: every operand word which could be an ID counts as a use, so literals can only
+ * keep something alive, never remove anything that is live. */
+
+#define VKD3D_SPIRV_HEADER_SIZE 5
+
+static bool vkd3d_spirv_opt_is_debug_op(SpvOp op)
+{
+    switch (op)
+    {
+        case SpvOpNop:
+        case SpvOpSourceContinued:
+        case SpvOpSource:
+        case SpvOpSourceExtension:
+        case SpvOpName:
+        case SpvOpMemberName:
+        case SpvOpLine:
+        case SpvOpNoLine:
+        case SpvOpModuleProcessed:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool vkd3d_spirv_opt_is_decoration_op(SpvOp op)
+{
+    switch (op)
+    {
+        case SpvOpDecorate:
+        case SpvOpMemberDecorate:
+        case SpvOpDecorateString:
+        case SpvOpMemberDecorateString:
+        case SpvOpDecorateId:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/* Returns the word index of the result ID for instructions which may be removed when unused, or 0. */
+static unsigned int vkd3d_spirv_opt_removable_result_index(const uint32_t *insn)
+{
+    unsigned int length = insn[0] >> SpvWordCountShift;
+    SpvOp op = insn[0] & SpvOpCodeMask;
+
+    switch (op)
+    {
+        case SpvOpString:
+        case SpvOpTypeVoid:
+        case SpvOpTypeBool:
+        case SpvOpTypeInt:
+        case SpvOpTypeFloat:
+        case SpvOpTypeVector:
+        case SpvOpTypeMatrix:
+        case SpvOpTypeImage:
+        case SpvOpTypeSampler:
+        case SpvOpTypeSampledImage:
+        case SpvOpTypeArray:
+        case SpvOpTypeRuntimeArray:
+        case SpvOpTypeStruct:
+        case SpvOpTypePointer:
+        case SpvOpTypeFunction:
+            return length > 1 ? 1 : 0;
+
+        case SpvOpUndef:
+        case SpvOpConstantTrue:
+        case SpvOpConstantFalse:
+        case SpvOpConstant:
+        case SpvOpConstantComposite:
+        case SpvOpConstantNull:
+            return length > 2 ? 2 : 0;
+
+        case SpvOpVariable:
+            if (length > 3 && (insn[3] == SpvStorageClassFunction || insn[3] == SpvStorageClassPrivate))
+                return 2;
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+static bool vkd3d_spirv_opt_is_dead(const uint32_t *insn, const bool *dead, uint32_t bound)
+{
+    SpvOp op = insn[0] & SpvOpCodeMask;
+    unsigned int index;
+
+    if (vkd3d_spirv_opt_is_decoration_op(op))
+        return (insn[0] >> SpvWordCountShift) > 1 && insn[1] < bound && dead[insn[1]];
+
+    if ((index = vkd3d_spirv_opt_removable_result_index(insn)))
+        return insn[index] < bound && dead[insn[index]];
+
+    return false;
+}
+
+static bool vkd3d_spirv_opt_validate(const uint32_t *words, size_t word_count)
+{
+    size_t offset = VKD3D_SPIRV_HEADER_SIZE;
+    unsigned int length;
+
+    if (word_count < VKD3D_SPIRV_HEADER_SIZE || words[0] != SpvMagicNumber)
+        return false;
+
+    while (offset < word_count)
+    {
+        length = words[offset] >> SpvWordCountShift;
+        if (!length || length > word_count - offset)
+            return false;
+        offset += length;
+    }
+
+    return true;
+}
+
+int vkd3d_shader_optimize_spirv(struct vkd3d_shader_code *spirv)
+{
+    size_t word_count = spirv->size / sizeof(uint32_t);
+    size_t offset, out_offset, removed_count;
+    const uint32_t *words = spirv->code;
+    unsigned int length, index, i;
+    uint32_t *use_counts = NULL;
+    uint32_t *out_words = NULL;
+    bool *dead = NULL;
+    uint32_t bound;
+    bool progress;
+    SpvOp op;
+
+    if ((spirv->size & 3) || !vkd3d_spirv_opt_validate(words, word_count))
+    {
+        WARN("Not optimizing malformed SPIR-V module.\n");
+        return VKD3D_ERROR_INVALID_SHADER;
+    }
+
+    bound = words[3];
+    if (!(use_counts = vkd3d_malloc(bound * sizeof(*use_counts))) ||
+            !(dead = vkd3d_calloc(bound, sizeof(*dead))) ||
+            !(out_words = vkd3d_malloc(spirv->size)))
+    {
+        vkd3d_free(use_counts);
+        vkd3d_free(dead);
+        return VKD3D_ERROR_OUT_OF_MEMORY;
+    }
+
+    /* Removing an instruction can make its operands unused, so iterate until nothing changes. */
+    do
+    {
+        memset(use_counts, 0, bound * sizeof(*use_counts));
+
+        for (offset = VKD3D_SPIRV_HEADER_SIZE; offset < word_count; offset += length)
+        {
+            length = words[offset] >> SpvWordCountShift;
+            op = words[offset] & SpvOpCodeMask;
+
+            if (vkd3d_spirv_opt_is_debug_op(op) || vkd3d_spirv_opt_is_dead(&words[offset], dead, bound))
+                continue;
+
+            /* The target of a decoration is not a use, but ID operands of OpDecorateId are. */
+            i = vkd3d_spirv_opt_is_decoration_op(op) ? 2 : 1;
+            index = vkd3d_spirv_opt_removable_result_index(&words[offset]);
+
+            for (; i < length; i++)
+            {
+                if (i != index && words[offset + i] < bound)
+                    use_counts[words[offset + i]]++;
+            }
+        }
+
+        progress = false;
+        for (offset = VKD3D_SPIRV_HEADER_SIZE; offset < word_count; offset += length)
+        {
+            length = words[offset] >> SpvWordCountShift;
+            index = vkd3d_spirv_opt_removable_result_index(&words[offset]);
+
+            if (index && words[offset + index] < bound && !dead[words[offset + index]] &&
+                    !use_counts[words[offset + index]])
+            {
+                dead[words[offset + index]] = true;
+                progress = true;
+            }
+        }
+    } while (progress);
+
+    memcpy(out_words, words, VKD3D_SPIRV_HEADER_SIZE * sizeof(*words));
+    out_offset = VKD3D_SPIRV_HEADER_SIZE;
+    removed_count = 0;
+
+    for (offset = VKD3D_SPIRV_HEADER_SIZE; offset < word_count; offset += length)
+    {
+        length = words[offset] >> SpvWordCountShift;
+        op = words[offset] & SpvOpCodeMask;
+
+        if (vkd3d_spirv_opt_is_debug_op(op) || vkd3d_spirv_opt_is_dead(&words[offset], dead, bound))
+        {
+            removed_count++;
+            continue;
+        }
+
+        memcpy(&out_words[out_offset], &words[offset], length * sizeof(*words));
+        out_offset += length;
+    }
+
+    TRACE("Removed %zu instructions, %zu -> %zu bytes.\n",
+            removed_count, spirv->size, out_offset * sizeof(*words));
+
+    vkd3d_free((void *)spirv->code);
+    spirv->code = out_words;
+    spirv->size = out_offset * sizeof(*words);
+
+    vkd3d_free(use_counts);
+    vkd3d_free(dead);
+    return VKD3D_OK;
+}
@@ -19,16 +19,50 @@
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_SHADER
 
 #include "vkd3d_shader_private.h"
+#include "vkd3d_threads.h"
 
 #include <stdio.h>
 #include <inttypes.h>
+#ifndef _WIN32
+#include <dirent.h>
+#endif
 
-static void vkd3d_shader_dump_blob(const char *path, vkd3d_shader_hash_t hash, const void *data, size_t size, const char *ext)
+/* Dumps are handed off to a writer thread so that PSO creation does not stall on disk I/O.
+ * If too much data is already in flight, the dump is written out synchronously instead. */
+#define VKD3D_SHADER_DUMP_QUEUE_MAX_SIZE (64u << 20)
+
+struct vkd3d_shader_dump_request
 {
+    struct list entry;
     char filename[1024];
-    FILE *f;
+    size_t size;
+    uint8_t data[];
+};
 
-    snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".%s", path, hash, ext);
+static struct
+{
+    char dump_path[1024];
+    bool dump_enabled;
+
+    char override_path[1024];
+    bool override_enabled;
+    /* Sorted file names found in the override directory at startup. */
+    char **override_files;
+    size_t override_files_size;
+    size_t override_file_count;
+
+    pthread_mutex_t dump_lock;
+    pthread_cond_t dump_cond;
+    struct list dump_queue;
+    size_t dump_queue_size;
+    bool dump_thread_running;
+} vkd3d_shader_io;
+
+static pthread_once_t vkd3d_shader_io_once = PTHREAD_ONCE_INIT;
+
+static void vkd3d_shader_write_blob(const char *filename, const void *data, size_t size)
+{
+    FILE *f;
 
     INFO("Dumping blob to %s.\n", filename);
 
@@ -42,6 +76,167 @@ static void vkd3d_shader_dump_blob(const char *path, vkd3d_shader_hash_t hash, c
     }
 }
 
+static void *vkd3d_shader_dump_thread_main(void *userdata)
+{
+    struct vkd3d_shader_dump_request *request;
+
+    (void)userdata;
+    vkd3d_set_thread_name("vkd3d_dump");
+
+    for (;;)
+    {
+        pthread_mutex_lock(&vkd3d_shader_io.dump_lock);
+        while (list_empty(&vkd3d_shader_io.dump_queue))
+            pthread_cond_wait(&vkd3d_shader_io.dump_cond, &vkd3d_shader_io.dump_lock);
+
+        request = LIST_ENTRY(list_head(&vkd3d_shader_io.dump_queue), struct vkd3d_shader_dump_request, entry);
+        list_remove(&request->entry);
+        pthread_mutex_unlock(&vkd3d_shader_io.dump_lock);
+
+        vkd3d_shader_write_blob(request->filename, request->data, request->size);
+
+        pthread_mutex_lock(&vkd3d_shader_io.dump_lock);
+        vkd3d_shader_io.dump_queue_size -= request->size;
+        pthread_mutex_unlock(&vkd3d_shader_io.dump_lock);
+        vkd3d_free(request);
+    }
+
+    return NULL;
+}
+
+static bool vkd3d_shader_add_override_file(const char *name)
+{
+    size_t len = strlen(name);
+    char *copy;
+
+    if (len < 4 || strcmp(name + len - 4, ".spv"))
+        return true;
+
+    if (!vkd3d_array_reserve((void **)&vkd3d_shader_io.override_files, &vkd3d_shader_io.override_files_size,
+            vkd3d_shader_io.override_file_count + 1, sizeof(*vkd3d_shader_io.override_files)))
+        return false;
+
+    if (!(copy = vkd3d_malloc(len + 1)))
+        return false;
+    memcpy(copy, name, len + 1);
+    vkd3d_shader_io.override_files[vkd3d_shader_io.override_file_count++] = copy;
+    return true;
+}
+
+static int vkd3d_shader_compare_override_file(const void *a, const void *b)
+{
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+static void vkd3d_shader_load_override_index(const char *path)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA find_data;
+    char pattern[1024];
+    HANDLE handle;
+
+    snprintf(pattern, ARRAY_SIZE(pattern), "%s/*.spv", path);
+    if ((handle = FindFirstFileA(pattern, &find_data)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("No override shaders found in %s.\n", path);
+        return;
+    }
+
+    do
+    {
+        if (!vkd3d_shader_add_override_file(find_data.cFileName))
+            break;
+    } while (FindNextFileA(handle, &find_data));
+    FindClose(handle);
+#else
+    struct dirent *dirent;
+    DIR *dir;
+
+    if (!(dir = opendir(path)))
+    {
+        ERR("Failed to open shader override directory %s.\n", path);
+        return;
+    }
+
+    while ((dirent = readdir(dir)))
+    {
+        if (!vkd3d_shader_add_override_file(dirent->d_name))
+            break;
+    }
+    closedir(dir);
+#endif
+
+    qsort(vkd3d_shader_io.override_files, vkd3d_shader_io.override_file_count,
+            sizeof(*vkd3d_shader_io.override_files), vkd3d_shader_compare_override_file);
+    INFO("Found %zu override shaders in %s.\n", vkd3d_shader_io.override_file_count, path);
+}
+
+static void vkd3d_shader_io_init_once(void)
+{
+    pthread_t thread;
+    const char *path;
+
+    if ((path = getenv("VKD3D_SHADER_DUMP_PATH")))
+    {
+        snprintf(vkd3d_shader_io.dump_path, ARRAY_SIZE(vkd3d_shader_io.dump_path), "%s", path);
+        vkd3d_shader_io.dump_enabled = true;
+
+        list_init(&vkd3d_shader_io.dump_queue);
+        pthread_mutex_init(&vkd3d_shader_io.dump_lock, NULL);
+        pthread_cond_init(&vkd3d_shader_io.dump_cond, NULL);
+
+        /* The writer lives for the remainder of the process. */
+        if (!pthread_create(&thread, NULL, vkd3d_shader_dump_thread_main, NULL))
+            vkd3d_shader_io.dump_thread_running = true;
+        else
+            ERR("Failed to create shader dump thread, dumping synchronously.\n");
+    }
+
+    if ((path = getenv("VKD3D_SHADER_OVERRIDE")))
+    {
+        snprintf(vkd3d_shader_io.override_path, ARRAY_SIZE(vkd3d_shader_io.override_path), "%s", path);
+        vkd3d_shader_io.override_enabled = true;
+        vkd3d_shader_load_override_index(path);
+    }
+}
+
+static void vkd3d_shader_io_init(void)
+{
+    pthread_once(&vkd3d_shader_io_once, vkd3d_shader_io_init_once);
+}
+
+static void vkd3d_shader_dump_blob(vkd3d_shader_hash_t hash, const void *data, size_t size, const char *ext)
+{
+    struct vkd3d_shader_dump_request *request;
+    char filename[1024];
+    bool queued = false;
+
+    snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".%s", vkd3d_shader_io.dump_path, hash, ext);
+
+    if (vkd3d_shader_io.dump_thread_running && (request = vkd3d_malloc(sizeof(*request) + size)))
+    {
+        memcpy(request->filename, filename, sizeof(filename));
+        memcpy(request->data, data, size);
+        request->size = size;
+
+        pthread_mutex_lock(&vkd3d_shader_io.dump_lock);
+        if (vkd3d_shader_io.dump_queue_size + size <= VKD3D_SHADER_DUMP_QUEUE_MAX_SIZE)
+        {
+            list_add_tail(&vkd3d_shader_io.dump_queue, &request->entry);
+            vkd3d_shader_io.dump_queue_size += size;
+            pthread_cond_signal(&vkd3d_shader_io.dump_cond);
+            queued = true;
+        }
+        pthread_mutex_unlock(&vkd3d_shader_io.dump_lock);
+
+        if (!queued)
+            vkd3d_free(request);
+    }
+
+    if (!queued)
+        vkd3d_shader_write_blob(filename, data, size);
+}
+
 static bool vkd3d_shader_replace_path(const char *filename, vkd3d_shader_hash_t hash, const void **data, size_t *size)
 {
     void *buffer = NULL;
@@ -78,96 +273,73 @@ err:
     return false;
 }
 
-bool vkd3d_shader_replace(vkd3d_shader_hash_t hash, const void **data, size_t *size)
+static bool vkd3d_shader_replace_name(const char *name, vkd3d_shader_hash_t hash, const void **data, size_t *size)
 {
-    static bool enabled = true;
     char filename[1024];
-    const char *path;
-
-    if (!enabled)
-        return false;
 
-    if (!(path = getenv("VKD3D_SHADER_OVERRIDE")))
-    {
-        enabled = false;
+    /* Only touch the file system for shaders we know have an override. */
+    if (!vkd3d_shader_io.override_file_count || !bsearch(&name, vkd3d_shader_io.override_files,
+            vkd3d_shader_io.override_file_count, sizeof(*vkd3d_shader_io.override_files),
+            vkd3d_shader_compare_override_file))
         return false;
-    }
 
-    snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".spv", path, hash);
+    snprintf(filename, ARRAY_SIZE(filename), "%s/%s", vkd3d_shader_io.override_path, name);
     return vkd3d_shader_replace_path(filename, hash, data, size);
 }
 
-bool vkd3d_shader_replace_export(vkd3d_shader_hash_t hash, const void **data, size_t *size, const char *export)
+bool vkd3d_shader_replace(vkd3d_shader_hash_t hash, const void **data, size_t *size)
 {
-    static bool enabled = true;
-    char filename[1024];
-    const char *path;
+    char name[64];
 
-    if (!enabled)
+    vkd3d_shader_io_init();
+    if (!vkd3d_shader_io.override_enabled)
         return false;
 
-    if (!(path = getenv("VKD3D_SHADER_OVERRIDE")))
-    {
-        enabled = false;
+    snprintf(name, ARRAY_SIZE(name), "%016"PRIx64".spv", hash);
+    return vkd3d_shader_replace_name(name, hash, data, size);
+}
+
+bool vkd3d_shader_replace_export(vkd3d_shader_hash_t hash, const void **data, size_t *size, const char *export)
+{
+    char name[1024];
+
+    vkd3d_shader_io_init();
+    if (!vkd3d_shader_io.override_enabled)
         return false;
-    }
 
-    snprintf(filename, ARRAY_SIZE(filename), "%s/%016"PRIx64".lib.%s.spv", path, hash, export);
-    return vkd3d_shader_replace_path(filename, hash, data, size);
+    snprintf(name, ARRAY_SIZE(name), "%016"PRIx64".lib.%s.spv", hash, export);
+    return vkd3d_shader_replace_name(name, hash, data, size);
 }
 
 void vkd3d_shader_dump_shader(vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *shader, const char *ext)
 {
-    static bool enabled = true;
-    const char *path;
-
-    if (!enabled)
+    vkd3d_shader_io_init();
+    if (!vkd3d_shader_io.dump_enabled)
         return;
 
-    if (!(path = getenv("VKD3D_SHADER_DUMP_PATH")))
-    {
-        enabled = false;
-        return;
-    }
-
-    vkd3d_shader_dump_blob(path, hash, shader->code, shader->size, ext);
+    vkd3d_shader_dump_blob(hash, shader->code, shader->size, ext);
 }
 
 void vkd3d_shader_dump_spirv_shader(vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *shader)
 {
-    static bool enabled = true;
-    const char *path;
-
-    if (!enabled)
+    vkd3d_shader_io_init();
+    if (!vkd3d_shader_io.dump_enabled)
         return;
 
-    if (!(path = getenv("VKD3D_SHADER_DUMP_PATH")))
-    {
-        enabled = false;
-        return;
-    }
-
-    vkd3d_shader_dump_blob(path, hash, shader->code, shader->size, "spv");
+    vkd3d_shader_dump_blob(hash, shader->code, shader->size, "spv");
 }
 
 void vkd3d_shader_dump_spirv_shader_export(vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *shader,
         const char *export)
 {
-    static bool enabled = true;
-    const char *path;
     char tag[1024];
 
-    if (!enabled)
+    vkd3d_shader_io_init();
+    if (!vkd3d_shader_io.dump_enabled)
         return;
 
-    if (!(path = getenv("VKD3D_SHADER_DUMP_PATH")))
-    {
-        enabled = false;
-        return;
-    }
-
     snprintf(tag, sizeof(tag), "lib.%s.spv", export);
-    vkd3d_shader_dump_blob(path, hash, shader->code, shader->size, tag);
+    vkd3d_shader_dump_blob(hash, shader->code, shader->size, tag);
 }
 
 struct vkd3d_shader_parser
@@ -319,16 +491,112 @@ static int vkd3d_shader_validate_shader_type(enum vkd3d_shader_type type, VkShad
     return 0;
 }
 
+/* Decoded instructions of a shader, so that multiple passes do not have to
+ * decode the token stream again. */
+struct vkd3d_shader_instruction_array
+{
+    struct vkd3d_shader_instruction *instructions;
+    size_t instructions_size;
+    size_t instruction_count;
+
+    struct vkd3d_shader_dst_param *dst_params;
+    size_t dst_params_size;
+    size_t dst_param_count;
+
+    struct vkd3d_shader_src_param *src_params;
+    size_t src_params_size;
+    size_t src_param_count;
+};
+
+static void vkd3d_shader_instruction_array_destroy(struct vkd3d_shader_instruction_array *array)
+{
+    vkd3d_free(array->instructions);
+    vkd3d_free(array->dst_params);
+    vkd3d_free(array->src_params);
+}
+
+static int vkd3d_shader_instruction_array_init(struct vkd3d_shader_instruction_array *array,
+        struct vkd3d_shader_parser *parser)
+{
+    struct vkd3d_shader_instruction *instruction;
+    size_t dst_index = 0, src_index = 0;
+    size_t i;
+
+    memset(array, 0, sizeof(*array));
+
+    /* Relative addressing parameters are owned by the parser, so they have to
+     * outlive individual reads. Parameter arrays are copied out below. */
+    shader_sm4_retain_src_params(parser->data);
+
+    while (!shader_sm4_is_end(parser->data, &parser->ptr))
+    {
+        if (!vkd3d_array_reserve((void **)&array->instructions, &array->instructions_size,
+                array->instruction_count + 1, sizeof(*array->instructions)))
+            goto fail_oom;
+
+        instruction = &array->instructions[array->instruction_count];
+        shader_sm4_read_instruction(parser->data, &parser->ptr, instruction);
+
+        if (instruction->handler_idx == VKD3DSIH_INVALID)
+        {
+            WARN("Encountered unrecognized or invalid instruction.\n");
+            vkd3d_shader_instruction_array_destroy(array);
+            return VKD3D_ERROR_INVALID_ARGUMENT;
+        }
+
+        if (!vkd3d_array_reserve((void **)&array->dst_params, &array->dst_params_size,
+                array->dst_param_count + instruction->dst_count, sizeof(*array->dst_params)) ||
+                !vkd3d_array_reserve((void **)&array->src_params, &array->src_params_size,
+                array->src_param_count + instruction->src_count, sizeof(*array->src_params)))
+            goto fail_oom;
+
+        if (instruction->dst_count)
+        {
+            memcpy(&array->dst_params[array->dst_param_count], instruction->dst,
+                    instruction->dst_count * sizeof(*instruction->dst));
+        }
+        if (instruction->src_count)
+        {
+            memcpy(&array->src_params[array->src_param_count], instruction->src,
+                    instruction->src_count * sizeof(*instruction->src));
+        }
+        array->dst_param_count += instruction->dst_count;
+        array->src_param_count += instruction->src_count;
+        array->instruction_count++;
+    }
+
+    /* The parameter arrays have stopped moving, so pointers can be resolved now. */
+    for (i = 0; i < array->instruction_count; i++)
+    {
+        instruction = &array->instructions[i];
+        instruction->dst = &array->dst_params[dst_index];
+        instruction->src = &array->src_params[src_index];
+        dst_index += instruction->dst_count;
+        src_index += instruction->src_count;
+    }
+
+    return VKD3D_OK;
+
+fail_oom:
+    ERR("Failed to allocate instruction array.\n");
+    vkd3d_shader_instruction_array_destroy(array);
+    return VKD3D_ERROR_OUT_OF_MEMORY;
+}
+
+static void vkd3d_shader_scan_instruction(struct vkd3d_shader_scan_info *scan_info,
+        const struct vkd3d_shader_instruction *instruction);
+
 int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_shader_code *spirv, unsigned int compiler_options,
         const struct vkd3d_shader_interface_info *shader_interface_info,
         const struct vkd3d_shader_compile_arguments *compile_args)
 {
-    struct vkd3d_shader_instruction instruction;
+    struct vkd3d_shader_instruction_array instructions;
     struct vkd3d_dxbc_compiler *spirv_compiler;
     struct vkd3d_shader_scan_info scan_info;
     struct vkd3d_shader_parser parser;
     vkd3d_shader_hash_t hash;
+    size_t i;
     int ret;
 
     TRACE("dxbc {%p, %zu}, spirv %p, compiler_options %#x, shader_interface_info %p, compile_args %p.\n",
@@ -353,31 +621,31 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
         return VKD3D_OK;
     }
 
-    vkd3d_shader_scan_init(&scan_info);
-
-    if ((ret = vkd3d_shader_scan_dxbc(dxbc, &scan_info)) < 0)
-    {
-        vkd3d_shader_scan_destroy(&scan_info);
-        return ret;
-    }
-
-    spirv->meta.patch_vertex_count = scan_info.patch_vertex_count;
-
     if ((ret = vkd3d_shader_parser_init(&parser, dxbc)) < 0)
-    {
-        vkd3d_shader_scan_destroy(&scan_info);
         return ret;
-    }
 
     if (shader_interface_info)
     {
         if ((ret = vkd3d_shader_validate_shader_type(parser.shader_version.type, shader_interface_info->stage)) < 0)
         {
-            vkd3d_shader_scan_destroy(&scan_info);
+            vkd3d_shader_parser_destroy(&parser);
             return ret;
         }
     }
 
+    /* Decode once, both the scan and the compiler walk the same instructions. */
+    if ((ret = vkd3d_shader_instruction_array_init(&instructions, &parser)) < 0)
+    {
+        vkd3d_shader_parser_destroy(&parser);
+        return ret;
+    }
+
+    vkd3d_shader_scan_init(&scan_info);
+    for (i = 0; i < instructions.instruction_count; i++)
+        vkd3d_shader_scan_instruction(&scan_info, &instructions.instructions[i]);
+
+    spirv->meta.patch_vertex_count = scan_info.patch_vertex_count;
+
     vkd3d_shader_dump_shader(hash, dxbc, "dxbc");
 
     if (TRACE_ON())
@@ -389,24 +657,14 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
     {
         ERR("Failed to create DXBC compiler.\n");
         vkd3d_shader_scan_destroy(&scan_info);
+        vkd3d_shader_instruction_array_destroy(&instructions);
         vkd3d_shader_parser_destroy(&parser);
         return VKD3D_ERROR;
     }
 
-    while (!shader_sm4_is_end(parser.data, &parser.ptr))
+    for (i = 0; i < instructions.instruction_count; i++)
     {
-        shader_sm4_read_instruction(parser.data, &parser.ptr, &instruction);
-
-        if (instruction.handler_idx == VKD3DSIH_INVALID)
-        {
-            WARN("Encountered unrecognized or invalid instruction.\n");
-            vkd3d_dxbc_compiler_destroy(spirv_compiler);
-            vkd3d_shader_scan_destroy(&scan_info);
-            vkd3d_shader_parser_destroy(&parser);
-            return VKD3D_ERROR_INVALID_ARGUMENT;
-        }
-
-        if ((ret = vkd3d_dxbc_compiler_handle_instruction(spirv_compiler, &instruction)) < 0)
+        if ((ret = vkd3d_dxbc_compiler_handle_instruction(spirv_compiler, &instructions.instructions[i])) < 0)
             break;
     }
 
@@ -418,6 +676,7 @@ int vkd3d_shader_compile_dxbc(const struct vkd3d_shader_code *dxbc,
 
     vkd3d_dxbc_compiler_destroy(spirv_compiler);
     vkd3d_shader_scan_destroy(&scan_info);
+    vkd3d_shader_instruction_array_destroy(&instructions);
     vkd3d_shader_parser_destroy(&parser);
     return ret;
 }
@@ -722,6 +981,110 @@ vkd3d_shader_hash_t vkd3d_shader_hash(const struct vkd3d_shader_code *shader)
     return h;
 }
 
+#define VKD3D_HASH_FAST_PRIME1 0x9e3779b185ebca87ull
+#define VKD3D_HASH_FAST_PRIME2 0xc2b2ae3d27d4eb4full
+#define VKD3D_HASH_FAST_PRIME3 0x165667b19e3779f9ull
+#define VKD3D_HASH_FAST_PRIME4 0x85ebca77c2b2ae63ull
+#define VKD3D_HASH_FAST_PRIME5 0x27d4eb2f165667c5ull
+
+static inline uint64_t vkd3d_hash_fast_rotl(uint64_t v, unsigned int r)
+{
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t vkd3d_hash_fast_read_u64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t vkd3d_hash_fast_read_u32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t vkd3d_hash_fast_round(uint64_t acc, uint64_t input)
+{
+    acc += input * VKD3D_HASH_FAST_PRIME2;
+    acc = vkd3d_hash_fast_rotl(acc, 31);
+    return acc * VKD3D_HASH_FAST_PRIME1;
+}
+
+static inline uint64_t vkd3d_hash_fast_merge(uint64_t acc, uint64_t lane)
+{
+    acc ^= vkd3d_hash_fast_round(0, lane);
+    return acc * VKD3D_HASH_FAST_PRIME1 + VKD3D_HASH_FAST_PRIME4;
+}
+
+/* XXH64. FNV-1 consumes one byte per dependent multiply, while this runs four
+ * independent 64-bit lanes, which is several times faster on large DXIL blobs.
+ * Only meant for in-memory and cache keys; dump and override file names keep
+ * using vkd3d_shader_hash(). */
+vkd3d_shader_hash_t vkd3d_shader_hash_fast(const struct vkd3d_shader_code *shader)
+{
+    const uint8_t *p = shader->code;
+    const uint8_t *end = p + shader->size;
+    uint64_t v1, v2, v3, v4, h;
+
+    if (shader->size >= 32)
+    {
+        v1 = VKD3D_HASH_FAST_PRIME1 + VKD3D_HASH_FAST_PRIME2;
+        v2 = VKD3D_HASH_FAST_PRIME2;
+        v3 = 0;
+        v4 = 0 - VKD3D_HASH_FAST_PRIME1;
+
+        do
+        {
+            v1 = vkd3d_hash_fast_round(v1, vkd3d_hash_fast_read_u64(p));
+            v2 = vkd3d_hash_fast_round(v2, vkd3d_hash_fast_read_u64(p + 8));
+            v3 = vkd3d_hash_fast_round(v3, vkd3d_hash_fast_read_u64(p + 16));
+            v4 = vkd3d_hash_fast_round(v4, vkd3d_hash_fast_read_u64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+
+        h = vkd3d_hash_fast_rotl(v1, 1) + vkd3d_hash_fast_rotl(v2, 7) +
+                vkd3d_hash_fast_rotl(v3, 12) + vkd3d_hash_fast_rotl(v4, 18);
+        h = vkd3d_hash_fast_merge(h, v1);
+        h = vkd3d_hash_fast_merge(h, v2);
+        h = vkd3d_hash_fast_merge(h, v3);
+        h = vkd3d_hash_fast_merge(h, v4);
+    }
+    else
+        h = VKD3D_HASH_FAST_PRIME5;
+
+    h += shader->size;
+
+    while (end - p >= 8)
+    {
+        h ^= vkd3d_hash_fast_round(0, vkd3d_hash_fast_read_u64(p));
+        h = vkd3d_hash_fast_rotl(h, 27) * VKD3D_HASH_FAST_PRIME1 + VKD3D_HASH_FAST_PRIME4;
+        p += 8;
+    }
+
+    if (end - p >= 4)
+    {
+        h ^= (uint64_t)vkd3d_hash_fast_read_u32(p) * VKD3D_HASH_FAST_PRIME1;
+        h = vkd3d_hash_fast_rotl(h, 23) * VKD3D_HASH_FAST_PRIME2 + VKD3D_HASH_FAST_PRIME3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        h ^= *p++ * VKD3D_HASH_FAST_PRIME5;
+        h = vkd3d_hash_fast_rotl(h, 11) * VKD3D_HASH_FAST_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= VKD3D_HASH_FAST_PRIME2;
+    h ^= h >> 29;
+    h *= VKD3D_HASH_FAST_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
 uint32_t vkd3d_shader_compile_arguments_select_quirks(
         const struct vkd3d_shader_compile_arguments *compile_args, vkd3d_shader_hash_t shader_hash)
 {
@@ -773,6 +773,9 @@ void shader_sm4_read_header(void *data, const DWORD **ptr,
 void shader_sm4_read_instruction(void *data, const DWORD **ptr,
         struct vkd3d_shader_instruction *ins);
 bool shader_sm4_is_end(void *data, const DWORD **ptr);
+/* Keeps relative addressing parameters alive until the parser is freed, so
+ * decoded instructions stay valid across later reads. */
+void shader_sm4_retain_src_params(void *data);
 
 int shader_extract_from_dxbc(const void *dxbc, size_t dxbc_length,
         struct vkd3d_shader_desc *desc);
@@ -117,92 +117,86 @@ VKD3D_UTILS_EXPORT HRESULT WINAPI D3D12SerializeVersionedRootSignature(const D3D
 VKD3D_UTILS_EXPORT HANDLE vkd3d_create_event(void)
 {
     struct vkd3d_event *event;
-    int rc;
 
     TRACE(".\n");
 
     if (!(event = vkd3d_malloc(sizeof(*event))))
         return NULL;
 
-    if ((rc = pthread_mutex_init(&event->mutex, NULL)))
-    {
-        ERR("Failed to initialize mutex, error %d.\n", rc);
-        vkd3d_free(event);
-        return NULL;
-    }
-    if ((rc = pthread_cond_init(&event->cond, NULL)))
-    {
-        ERR("Failed to initialize condition variable, error %d.\n", rc);
-        pthread_mutex_destroy(&event->mutex);
-        vkd3d_free(event);
-        return NULL;
-    }
-
-    event->is_signaled = false;
+    event->is_signaled = 0;
+    event->waiter_count = 0;
 
     TRACE("Created event %p.\n", event);
 
     return event;
 }
 
+static bool vkd3d_event_try_consume(struct vkd3d_event *event)
+{
+    return vkd3d_atomic_uint32_compare_exchange(&event->is_signaled, 1, 0,
+            vkd3d_memory_order_acquire, vkd3d_memory_order_relaxed) == 1;
+}
+
 VKD3D_UTILS_EXPORT unsigned int vkd3d_wait_event(HANDLE event, unsigned int milliseconds)
 {
     struct vkd3d_event *impl = event;
-    int rc;
+    uint64_t deadline_ns = 0, now_ns;
+    unsigned int timeout_ms;
+    unsigned int ret;
 
     TRACE("event %p, milliseconds %u.\n", event, milliseconds);
 
-    if ((rc = pthread_mutex_lock(&impl->mutex)))
-    {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        return VKD3D_WAIT_FAILED;
-    }
+    if (vkd3d_event_try_consume(impl))
+        return VKD3D_WAIT_OBJECT_0;
+    if (!milliseconds)
+        return VKD3D_WAIT_TIMEOUT;
 
-    if (impl->is_signaled || !milliseconds)
-    {
-        bool is_signaled = impl->is_signaled;
-        impl->is_signaled = false;
-        pthread_mutex_unlock(&impl->mutex);
-        return is_signaled ? VKD3D_WAIT_OBJECT_0 : VKD3D_WAIT_TIMEOUT;
-    }
+    if (milliseconds != VKD3D_INFINITE)
+        deadline_ns = vkd3d_profiling_get_tick_count() + milliseconds * 1000000ull;
 
-    if (milliseconds == VKD3D_INFINITE)
+    vkd3d_atomic_uint32_increment(&impl->waiter_count, vkd3d_memory_order_seq_cst);
+
+    for (;;)
     {
-        do
+        if (milliseconds == VKD3D_INFINITE)
+            timeout_ms = VKD3D_FUTEX_INFINITE;
+        else
         {
-            if ((rc = pthread_cond_wait(&impl->cond, &impl->mutex)))
-            {
-                ERR("Failed to wait on condition variable, error %d.\n", rc);
-                pthread_mutex_unlock(&impl->mutex);
-                return VKD3D_WAIT_FAILED;
-            }
-        } while (!impl->is_signaled);
-
-        impl->is_signaled = false;
-        pthread_mutex_unlock(&impl->mutex);
-        return VKD3D_WAIT_OBJECT_0;
+            now_ns = vkd3d_profiling_get_tick_count();
+            timeout_ms = now_ns < deadline_ns ? (deadline_ns - now_ns + 999999) / 1000000 : 0;
+        }
+
+        if (timeout_ms)
+            vkd3d_futex_wait(&impl->is_signaled, 0, timeout_ms);
+
+        if (vkd3d_event_try_consume(impl))
+        {
+            ret = VKD3D_WAIT_OBJECT_0;
+            break;
+        }
+
+        if (!timeout_ms)
+        {
+            ret = VKD3D_WAIT_TIMEOUT;
+            break;
+        }
     }
 
-    pthread_mutex_unlock(&impl->mutex);
-    FIXME("Timed wait not implemented yet.\n");
-    return VKD3D_WAIT_FAILED;
+    vkd3d_atomic_uint32_decrement(&impl->waiter_count, vkd3d_memory_order_seq_cst);
+    return ret;
 }
 
 VKD3D_UTILS_EXPORT HRESULT vkd3d_signal_event(HANDLE event)
 {
     struct vkd3d_event *impl = event;
-    int rc;
 
     TRACE("event %p.\n", event);
 
-    if ((rc = pthread_mutex_lock(&impl->mutex)))
-    {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        return E_FAIL;
-    }
-    impl->is_signaled = true;
-    pthread_cond_signal(&impl->cond);
-    pthread_mutex_unlock(&impl->mutex);
+    /* Waiters register themselves before blocking, and the futex wait re-checks is_signaled,
+     * so the wake can be skipped entirely when nobody is waiting. */
+    vkd3d_atomic_uint32_store_explicit(&impl->is_signaled, 1, vkd3d_memory_order_seq_cst);
+    if (vkd3d_atomic_uint32_load_explicit(&impl->waiter_count, vkd3d_memory_order_seq_cst))
+        vkd3d_futex_wake_one(&impl->is_signaled);
 
     return S_OK;
 }
@@ -210,13 +204,8 @@ VKD3D_UTILS_EXPORT HRESULT vkd3d_signal_event(HANDLE event)
 VKD3D_UTILS_EXPORT void vkd3d_destroy_event(HANDLE event)
 {
     struct vkd3d_event *impl = event;
-    int rc;
 
     TRACE("event %p.\n", event);
 
-    if ((rc = pthread_mutex_destroy(&impl->mutex)))
-        ERR("Failed to destroy mutex, error %d.\n", rc);
-    if ((rc = pthread_cond_destroy(&impl->cond)))
-        ERR("Failed to destroy condition variable, error %d.\n", rc);
     vkd3d_free(impl);
 }
@@ -28,11 +28,11 @@
 #include "vkd3d_memory.h"
 #include <vkd3d_utils.h>
 
+/* Auto-reset event. is_signaled doubles as the futex word waiters block on. */
 struct vkd3d_event
 {
-    pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    BOOL is_signaled;
+    uint32_t is_signaled;
+    uint32_t waiter_count;
 };
 
 #endif  /* __VKD3D_UTILS_PRIVATE_H */
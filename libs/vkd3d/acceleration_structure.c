@@ -229,21 +229,24 @@ static void vkd3d_acceleration_structure_end_barrier(struct d3d12_command_list *
             1, &barrier, 0, NULL, 0, NULL));
 }
 
+/* Writes post-build info for count structures into consecutive slots of the destination,
+ * using one query write and one resolve copy per query pool chunk. */
 static void vkd3d_acceleration_structure_write_postbuild_info(
         struct d3d12_command_list *list,
         const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *desc,
         VkDeviceSize desc_offset,
-        VkAccelerationStructureKHR vk_acceleration_structure)
+        const VkAccelerationStructureKHR *vk_acceleration_structures, uint32_t count)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
     const struct vkd3d_unique_resource *resource;
+    uint32_t vk_query_index, vk_query_count, i;
     VkQueryPool vk_query_pool;
     VkQueryType vk_query_type;
-    uint32_t vk_query_index;
+    VkMemoryBarrier barrier;
     VkDeviceSize stride;
     uint32_t type_index;
     VkBuffer vk_buffer;
-    uint32_t offset;
+    VkDeviceSize offset;
 
     resource = vkd3d_va_map_deref(&list->device->memory_allocator.va_map, desc->DestBuffer);
     if (!resource)
@@ -266,8 +269,20 @@ static void vkd3d_acceleration_structure_write_postbuild_info(
     {
         vk_query_type = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR;
         type_index = VKD3D_QUERY_TYPE_INDEX_RT_SERIALIZE_SIZE;
-        stride = sizeof(uint64_t);
+        stride = 2 * sizeof(uint64_t);
         FIXME("NumBottomLevelPointers will always return 0.\n");
+
+        /* TODO: We'll need some way to store these values for later use and copy them here instead.
+         * Clear the whole range once, the resolve below then fills in the sizes. */
+        VK_CALL(vkCmdFillBuffer(list->vk_command_buffer, vk_buffer, offset, count * stride, 0));
+
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.pNext = NULL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                1, &barrier, 0, NULL, 0, NULL));
     }
     else
     {
@@ -276,31 +291,35 @@ static void vkd3d_acceleration_structure_write_postbuild_info(
          * we'll need to keep around a buffer to handle this.
          * For now, just clear to 0. */
         VK_CALL(vkCmdFillBuffer(list->vk_command_buffer, vk_buffer, offset,
-                sizeof(uint64_t), 0));
+                count * sizeof(uint64_t), 0));
         return;
     }
 
-    if (!d3d12_command_allocator_allocate_query_from_type_index(list->allocator,
-            type_index, &vk_query_pool, &vk_query_index))
+    while (count)
     {
-        ERR("Failed to allocate query.\n");
-        return;
-    }
+        if (!d3d12_command_allocator_allocate_queries_from_type_index(list->allocator,
+                type_index, count, &vk_query_pool, &vk_query_index, &vk_query_count))
+        {
+            ERR("Failed to allocate query.\n");
+            return;
+        }
 
-    d3d12_command_list_reset_query(list, vk_query_pool, vk_query_index);
+        if (!d3d12_device_use_host_query_reset(list->device))
+        {
+            for (i = 0; i < vk_query_count; i++)
+                d3d12_command_list_reset_query(list, vk_query_pool, vk_query_index + i);
+        }
 
-    VK_CALL(vkCmdWriteAccelerationStructuresPropertiesKHR(list->vk_command_buffer,
-            1, &vk_acceleration_structure, vk_query_type, vk_query_pool, vk_query_index));
-    VK_CALL(vkCmdCopyQueryPoolResults(list->vk_command_buffer,
-            vk_query_pool, vk_query_index, 1,
-            vk_buffer, offset, stride,
-            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+        VK_CALL(vkCmdWriteAccelerationStructuresPropertiesKHR(list->vk_command_buffer,
+                vk_query_count, vk_acceleration_structures, vk_query_type, vk_query_pool, vk_query_index));
+        VK_CALL(vkCmdCopyQueryPoolResults(list->vk_command_buffer,
+                vk_query_pool, vk_query_index, vk_query_count,
+                vk_buffer, offset, stride,
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
 
-    if (desc->InfoType == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_SERIALIZATION)
-    {
-        /* TODO: We'll need some way to store these values for later use and copy them here instead. */
-        VK_CALL(vkCmdFillBuffer(list->vk_command_buffer, vk_buffer, offset + sizeof(uint64_t),
-                sizeof(uint64_t), 0));
+        vk_acceleration_structures += vk_query_count;
+        offset += vk_query_count * stride;
+        count -= vk_query_count;
     }
 }
 
@@ -311,10 +330,11 @@ void vkd3d_acceleration_structure_emit_postbuild_info(
         const D3D12_GPU_VIRTUAL_ADDRESS *addresses)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
-    VkAccelerationStructureKHR vk_acceleration_structure;
+    VkAccelerationStructureKHR vk_acceleration_structure_stack[64];
+    VkAccelerationStructureKHR *vk_acceleration_structures;
+    uint32_t i, run_start, run_count;
     VkMemoryBarrier barrier;
     VkDeviceSize stride;
-    uint32_t i;
 
     barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
     barrier.pNext = NULL;
@@ -330,16 +350,42 @@ void vkd3d_acceleration_structure_emit_postbuild_info(
     stride = desc->InfoType == D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_SERIALIZATION ?
             2 * sizeof(uint64_t) : sizeof(uint64_t);
 
-    for (i = 0; i < count; i++)
+    if (count <= ARRAY_SIZE(vk_acceleration_structure_stack))
+        vk_acceleration_structures = vk_acceleration_structure_stack;
+    else if (!(vk_acceleration_structures = vkd3d_malloc(count * sizeof(*vk_acceleration_structures))))
     {
-        vk_acceleration_structure = vkd3d_va_map_place_acceleration_structure(
-                &list->device->memory_allocator.va_map, list->device, addresses[i]);
-        if (vk_acceleration_structure)
-            vkd3d_acceleration_structure_write_postbuild_info(list, desc, i * stride, vk_acceleration_structure);
-        else
+        ERR("Failed to allocate acceleration structure array.\n");
+        return;
+    }
+
+    /* Structures which fail to resolve leave their slot untouched,
+     * so each run of valid structures is written in one go. */
+    for (i = 0, run_start = 0, run_count = 0; i <= count; i++)
+    {
+        if (i < count && (vk_acceleration_structures[i] = vkd3d_va_map_place_acceleration_structure_cached(
+                &list->device->memory_allocator.va_map, list->device,
+                &list->acceleration_structure_cache, addresses[i])))
+        {
+            run_count++;
+            continue;
+        }
+
+        if (i < count)
             ERR("Failed to query acceleration structure for VA 0x%"PRIx64".\n", addresses[i]);
+
+        if (run_count)
+        {
+            vkd3d_acceleration_structure_write_postbuild_info(list, desc, run_start * stride,
+                    &vk_acceleration_structures[run_start], run_count);
+        }
+
+        run_start = i + 1;
+        run_count = 0;
     }
 
+    if (vk_acceleration_structures != vk_acceleration_structure_stack)
+        vkd3d_free(vk_acceleration_structures);
+
     vkd3d_acceleration_structure_end_barrier(list);
 }
 
@@ -369,9 +415,9 @@ void vkd3d_acceleration_structure_emit_immediate_postbuild_info(
             VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR | VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
             1, &barrier, 0, NULL, 0, NULL));
 
-    /* Could optimize a bit by batching more aggressively, but no idea if it's going to help in practice. */
+    /* Each desc may target a different buffer, so these are written one by one. */
     for (i = 0; i < count; i++)
-        vkd3d_acceleration_structure_write_postbuild_info(list, &desc[i], 0, vk_acceleration_structure);
+        vkd3d_acceleration_structure_write_postbuild_info(list, &desc[i], 0, &vk_acceleration_structure, 1);
 
     vkd3d_acceleration_structure_end_barrier(list);
 }
@@ -403,14 +449,16 @@ void vkd3d_acceleration_structure_copy(
     VkAccelerationStructureKHR dst_as, src_as;
     VkCopyAccelerationStructureInfoKHR info;
 
-    dst_as = vkd3d_va_map_place_acceleration_structure(&list->device->memory_allocator.va_map, list->device, dst);
+    dst_as = vkd3d_va_map_place_acceleration_structure_cached(&list->device->memory_allocator.va_map,
+            list->device, &list->acceleration_structure_cache, dst);
     if (dst_as == VK_NULL_HANDLE)
     {
         ERR("Invalid dst address #%"PRIx64" for RTAS copy.\n", dst);
         return;
     }
 
-    src_as = vkd3d_va_map_place_acceleration_structure(&list->device->memory_allocator.va_map, list->device, src);
+    src_as = vkd3d_va_map_place_acceleration_structure_cached(&list->device->memory_allocator.va_map,
+            list->device, &list->acceleration_structure_cache, src);
     if (src_as == VK_NULL_HANDLE)
     {
         ERR("Invalid src address #%"PRIx64" for RTAS copy.\n", src);
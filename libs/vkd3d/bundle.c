@@ -26,6 +26,42 @@ static inline struct d3d12_bundle_allocator *impl_from_ID3D12CommandAllocator(ID
     return CONTAINING_RECORD(iface, struct d3d12_bundle_allocator, ID3D12CommandAllocator_iface);
 }
 
+static void *d3d12_device_acquire_bundle_chunk(struct d3d12_device *device)
+{
+    struct vkd3d_cached_bundle_chunks *cached = &device->cached_bundle_chunks;
+    void *chunk = NULL;
+
+    if (pthread_mutex_lock(&device->mutex) == 0)
+    {
+        if (cached->chunk_count)
+            chunk = cached->chunks[--cached->chunk_count];
+        pthread_mutex_unlock(&device->mutex);
+    }
+
+    return chunk ? chunk : vkd3d_malloc(VKD3D_BUNDLE_CHUNK_SIZE);
+}
+
+/* Chunks which do not fit into the device cache are freed. */
+static void d3d12_device_release_bundle_chunks(struct d3d12_device *device, void **chunks, size_t count)
+{
+    struct vkd3d_cached_bundle_chunks *cached = &device->cached_bundle_chunks;
+    size_t accepted = 0, i;
+
+    if (!count)
+        return;
+
+    if (pthread_mutex_lock(&device->mutex) == 0)
+    {
+        accepted = min(count, ARRAY_SIZE(cached->chunks) - cached->chunk_count);
+        memcpy(&cached->chunks[cached->chunk_count], chunks, accepted * sizeof(*chunks));
+        cached->chunk_count += accepted;
+        pthread_mutex_unlock(&device->mutex);
+    }
+
+    for (i = accepted; i < count; i++)
+        vkd3d_free(chunks[i]);
+}
+
 static void *d3d12_bundle_allocator_alloc_chunk_data(struct d3d12_bundle_allocator *allocator, size_t size)
 {
     size_t chunk_offset = 0;
@@ -33,22 +69,35 @@ static void *d3d12_bundle_allocator_alloc_chunk_data(struct d3d12_bundle_allocat
 
     size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
 
-    if (allocator->chunks_count)
+    if (allocator->chunks_used)
     {
-        chunk = allocator->chunks[allocator->chunks_count - 1];
+        chunk = allocator->chunks[allocator->chunks_used - 1];
         chunk_offset = allocator->chunk_offset;
     }
 
-    if (!chunk || chunk_offset + size > VKD3D_BUNDLE_CHUNK_SIZE)
+    if (!chunk || d3d12_bundle_chunk_needs_continuation(chunk_offset, size))
     {
-        if (!vkd3d_array_reserve((void **)&allocator->chunks, &allocator->chunks_size,
-                allocator->chunks_count + 1, sizeof(*allocator->chunks)))
-            return NULL;
+        void *new_chunk;
+
+        if (allocator->chunks_used == allocator->chunks_count)
+        {
+            if (!vkd3d_array_reserve((void **)&allocator->chunks, &allocator->chunks_size,
+                    allocator->chunks_count + 1, sizeof(*allocator->chunks)))
+                return NULL;
+
+            if (!(new_chunk = d3d12_device_acquire_bundle_chunk(allocator->device)))
+                return NULL;
+
+            allocator->chunks[allocator->chunks_count++] = new_chunk;
+        }
+
+        new_chunk = allocator->chunks[allocator->chunks_used++];
 
-        if (!(chunk = vkd3d_malloc(VKD3D_BUNDLE_CHUNK_SIZE)))
-            return NULL;
+        /* Commands recorded so far continue in the new chunk. */
+        if (chunk)
+            d3d12_bundle_chunk_terminate(chunk, chunk_offset, new_chunk);
 
-        allocator->chunks[allocator->chunks_count++] = chunk;
+        chunk = new_chunk;
         allocator->chunk_offset = chunk_offset = 0;
     }
 
@@ -56,17 +105,27 @@ static void *d3d12_bundle_allocator_alloc_chunk_data(struct d3d12_bundle_allocat
     return void_ptr_offset(chunk, chunk_offset);
 }
 
-static void d3d12_bundle_allocator_free_chunks(struct d3d12_bundle_allocator *allocator)
+static void d3d12_bundle_allocator_reset_chunks(struct d3d12_bundle_allocator *allocator)
 {
-    size_t i;
+    /* Keep as many chunks as the last recording cycle needed. Anything
+     * above that high-water mark goes back to the device for other allocators. */
+    d3d12_device_release_bundle_chunks(allocator->device, &allocator->chunks[allocator->chunks_used],
+            allocator->chunks_count - allocator->chunks_used);
+
+    allocator->chunks_count = allocator->chunks_used;
+    allocator->chunks_used = 0;
+    allocator->chunk_offset = 0;
+}
 
-    for (i = 0; i < allocator->chunks_count; i++)
-        vkd3d_free(allocator->chunks[i]);
+static void d3d12_bundle_allocator_free_chunks(struct d3d12_bundle_allocator *allocator)
+{
+    d3d12_device_release_bundle_chunks(allocator->device, allocator->chunks, allocator->chunks_count);
 
     vkd3d_free(allocator->chunks);
     allocator->chunks = NULL;
     allocator->chunks_size = 0;
     allocator->chunks_count = 0;
+    allocator->chunks_used = 0;
     allocator->chunk_offset = 0;
 }
 
@@ -111,8 +170,13 @@ static ULONG STDMETHODCALLTYPE d3d12_bundle_allocator_Release(ID3D12CommandAlloc
 
     if (!refcount)
     {
+        struct d3d12_device *device = allocator->device;
+
+        vkd3d_private_store_destroy(&allocator->private_store);
         d3d12_bundle_allocator_free_chunks(allocator);
         vkd3d_free(allocator);
+
+        d3d12_device_release(device);
     }
 
     return refcount;
@@ -174,9 +238,11 @@ static HRESULT STDMETHODCALLTYPE d3d12_bundle_allocator_Reset(ID3D12CommandAlloc
 
         bundle->head = NULL;
         bundle->tail = NULL;
+        bundle->is_bakeable = false;
+        bundle->state_command_count = 0;
     }
 
-    d3d12_bundle_allocator_free_chunks(allocator);
+    d3d12_bundle_allocator_reset_chunks(allocator);
     return S_OK;
 }
 
@@ -216,6 +282,9 @@ HRESULT d3d12_bundle_allocator_create(struct d3d12_device *device,
         return hr;
     }
 
+    /* Chunks go back to the device cache on release, so keep the device alive. */
+    d3d12_device_add_ref(device);
+
     *allocator = object;
     return S_OK;
 }
@@ -239,17 +308,22 @@ void *d3d12_bundle_add_command(struct d3d12_bundle *bundle, pfn_d3d12_bundle_com
     struct d3d12_bundle_command *command = d3d12_bundle_allocator_alloc_chunk_data(bundle->allocator, size);
 
     command->proc = proc;
-    command->next = NULL;
+    command->size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
 
-    if (bundle->tail)
-        bundle->tail->next = command;
-    else
+    if (!bundle->head)
         bundle->head = command;
 
     bundle->tail = command;
     return command;
 }
 
+static void *d3d12_bundle_get_overridable_command(struct d3d12_bundle *bundle, pfn_d3d12_bundle_command proc)
+{
+    /* Nothing can observe state which is overwritten by the very next command,
+     * so the previous command is updated in place instead of growing the stream. */
+    return bundle->tail && bundle->tail->proc == proc ? bundle->tail : NULL;
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_bundle_QueryInterface(d3d12_command_list_iface *iface,
         REFIID iid, void **object)
 {
@@ -288,6 +362,22 @@ static ULONG STDMETHODCALLTYPE d3d12_bundle_AddRef(d3d12_command_list_iface *ifa
     return refcount;
 }
 
+static void d3d12_bundle_free_baked_variants(struct d3d12_bundle *bundle)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &bundle->device->vk_procs;
+    size_t i;
+
+    /* Baked command buffers are not tracked by the allocator, so free them explicitly. */
+    for (i = 0; i < bundle->baked_variant_count; i++)
+    {
+        if (bundle->baked_variants[i].vk_command_buffer)
+            VK_CALL(vkFreeCommandBuffers(bundle->device->vk_device, bundle->bake_allocator->vk_command_pool,
+                    1, &bundle->baked_variants[i].vk_command_buffer));
+    }
+
+    bundle->baked_variant_count = 0;
+}
+
 static ULONG STDMETHODCALLTYPE d3d12_bundle_Release(d3d12_command_list_iface *iface)
 {
     struct d3d12_bundle *bundle = impl_from_ID3D12GraphicsCommandList(iface);
@@ -300,6 +390,15 @@ static ULONG STDMETHODCALLTYPE d3d12_bundle_Release(d3d12_command_list_iface *if
         if (bundle->allocator && bundle->allocator->current_bundle == bundle)
             bundle->allocator->current_bundle = NULL;
 
+        d3d12_bundle_free_baked_variants(bundle);
+        if (bundle->bake_list)
+            ID3D12GraphicsCommandList6_Release(&bundle->bake_list->ID3D12GraphicsCommandList_iface);
+        if (bundle->bake_allocator)
+            ID3D12CommandAllocator_Release(&bundle->bake_allocator->ID3D12CommandAllocator_iface);
+        vkd3d_free(bundle->baked_variants);
+        vkd3d_free(bundle->state_commands);
+        pthread_mutex_destroy(&bundle->bake_mutex);
+
         d3d12_device_release(bundle->device);
         vkd3d_free(bundle);
     }
@@ -355,6 +454,8 @@ static D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE d3d12_bundle_GetType(d3d12_comm
     return D3D12_COMMAND_LIST_TYPE_BUNDLE;
 }
 
+static void d3d12_bundle_classify_commands(struct d3d12_bundle *bundle);
+
 static HRESULT STDMETHODCALLTYPE d3d12_bundle_Close(d3d12_command_list_iface *iface)
 {
     struct d3d12_bundle *bundle = impl_from_ID3D12GraphicsCommandList(iface);
@@ -368,6 +469,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_bundle_Close(d3d12_command_list_iface *if
     }
 
     bundle->is_recording = false;
+    d3d12_bundle_classify_commands(bundle);
     return S_OK;
 }
 
@@ -402,6 +504,16 @@ static HRESULT STDMETHODCALLTYPE d3d12_bundle_Reset(d3d12_command_list_iface *if
     bundle->allocator = bundle_allocator;
     bundle->head = NULL;
     bundle->tail = NULL;
+    bundle->is_bakeable = false;
+    bundle->state_command_count = 0;
+
+    /* The application must not reset a bundle which is still referenced by pending
+     * command lists, so previously baked command buffers can be dropped here. */
+    if (bundle->baked_variant_count)
+    {
+        d3d12_bundle_free_baked_variants(bundle);
+        ID3D12CommandAllocator_Reset(&bundle->bake_allocator->ID3D12CommandAllocator_iface);
+    }
 
     bundle_allocator->current_bundle = bundle;
 
@@ -417,16 +529,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_ClearState(d3d12_command_list_iface *
     WARN("iface %p, pipeline_state %p ignored!\n", iface, pipeline_state);
 }
 
-struct d3d12_draw_instanced_command
-{
-    struct d3d12_bundle_command head;
-    UINT vertex_count;
-    UINT instance_count;
-    UINT first_vertex;
-    UINT first_instance;
-};
-
-static void d3d12_bundle_exec_draw_instanced(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_draw_instanced(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_draw_instanced_command *args = args_v;
 
@@ -453,17 +556,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_DrawInstanced(d3d12_command_list_ifac
     args->first_instance = start_instance_location;
 }
 
-struct d3d12_draw_indexed_instanced_command
-{
-    struct d3d12_bundle_command head;
-    UINT index_count;
-    UINT instance_count;
-    UINT first_index;
-    UINT vertex_offset;
-    UINT first_instance;
-};
-
-static void d3d12_bundle_exec_draw_indexed_instanced(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_draw_indexed_instanced(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_draw_indexed_instanced_command *args = args_v;
 
@@ -492,13 +585,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_DrawIndexedInstanced(d3d12_command_li
     args->first_instance = start_instance_location;
 }
 
-struct d3d12_dispatch_command
-{
-    struct d3d12_bundle_command head;
-    UINT x, y, z;
-};
-
-static void d3d12_bundle_exec_dispatch(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_dispatch(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_dispatch_command *args = args_v;
 
@@ -560,13 +647,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_ResolveSubresource(d3d12_command_list
             "format %#x ignored!\n", iface, dst, dst_sub_resource_idx, src, src_sub_resource_idx, format);
 }
 
-struct d3d12_ia_set_primitive_topology_command
-{
-    struct d3d12_bundle_command command;
-    D3D12_PRIMITIVE_TOPOLOGY topology;
-};
-
-static void d3d12_bundle_exec_ia_set_primitive_topology(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_ia_set_primitive_topology(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_ia_set_primitive_topology_command *args = args_v;
 
@@ -581,7 +662,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_IASetPrimitiveTopology(d3d12_command_
 
     TRACE("iface %p, topology %#x.\n", iface, topology);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_primitive_topology, sizeof(*args));
+    if (!(args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_ia_set_primitive_topology)))
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_ia_set_primitive_topology, sizeof(*args));
     args->topology = topology;
 }
 
@@ -597,13 +679,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_RSSetScissorRects(d3d12_command_list_
     WARN("iface %p, rect_count %u, rects %p ignored!\n", iface, rect_count, rects);
 }
 
-struct d3d12_om_set_blend_factor_command
-{
-    struct d3d12_bundle_command command;
-    FLOAT blend_factor[4];
-};
-
-static void d3d12_bundle_exec_om_set_blend_factor(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_om_set_blend_factor(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_om_set_blend_factor_command *args = args_v;
 
@@ -619,19 +695,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetBlendFactor(d3d12_command_list_i
 
     TRACE("iface %p, blend_factor %p.\n", iface, blend_factor);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_blend_factor, sizeof(*args));
+    if (!(args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_om_set_blend_factor)))
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_blend_factor, sizeof(*args));
 
     for (i = 0; i < 4; i++)
         args->blend_factor[i] = blend_factor[i];
 }
 
-struct d3d12_om_set_stencil_ref_command
-{
-    struct d3d12_bundle_command command;
-    UINT stencil_ref;
-};
-
-static void d3d12_bundle_exec_om_set_stencil_ref(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_om_set_stencil_ref(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_om_set_stencil_ref_command *args = args_v;
 
@@ -646,17 +717,12 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetStencilRef(d3d12_command_list_if
 
     TRACE("iface %p, stencil_ref %u.\n", iface, stencil_ref);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_stencil_ref, sizeof(*args));
+    if (!(args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_om_set_stencil_ref)))
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_stencil_ref, sizeof(*args));
     args->stencil_ref = stencil_ref;
 }
 
-struct d3d12_set_pipeline_state_command
-{
-    struct d3d12_bundle_command command;
-    ID3D12PipelineState *pipeline_state;
-};
-
-static void d3d12_bundle_exec_set_pipeline_state(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_pipeline_state(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_pipeline_state_command *args = args_v;
 
@@ -671,7 +737,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetPipelineState(d3d12_command_list_i
 
     TRACE("iface %p, pipeline_state %p.\n", iface, pipeline_state);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_pipeline_state, sizeof(*args));
+    if (!(args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_pipeline_state)))
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_pipeline_state, sizeof(*args));
     args->pipeline_state = pipeline_state;
 }
 
@@ -694,13 +761,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetDescriptorHeaps(d3d12_command_list
     /* Apparently it is legal to call this method, but behaves like a no-op */
 }
 
-struct d3d12_set_root_signature_command
-{
-    struct d3d12_bundle_command command;
-    ID3D12RootSignature *root_signature;
-};
-
-static void d3d12_bundle_exec_set_compute_root_signature(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_signature(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_signature_command *args = args_v;
 
@@ -719,7 +780,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootSignature(d3d12_command
     args->root_signature = root_signature;
 }
 
-static void d3d12_bundle_exec_set_graphics_root_signature(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_signature(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_signature_command *args = args_v;
 
@@ -738,14 +799,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootSignature(d3d12_comman
     args->root_signature = root_signature;
 }
 
-struct d3d12_set_root_descriptor_table_command
-{
-    struct d3d12_bundle_command command;
-    UINT parameter_index;
-    D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor;
-};
-
-static void d3d12_bundle_exec_set_compute_root_descriptor_table(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_descriptor_table(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_table_command *args = args_v;
 
@@ -761,12 +815,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootDescriptorTable(d3d12_c
     TRACE("iface %p, root_parameter_index %u, base_descriptor %#"PRIx64".\n",
             iface, root_parameter_index, base_descriptor.ptr);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_descriptor_table, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_compute_root_descriptor_table);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_descriptor_table, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->base_descriptor = base_descriptor;
 }
 
-static void d3d12_bundle_exec_set_graphics_root_descriptor_table(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_descriptor_table(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_table_command *args = args_v;
 
@@ -782,20 +838,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootDescriptorTable(d3d12_
     TRACE("iface %p, root_parameter_index %u, base_descriptor %#"PRIx64".\n",
             iface, root_parameter_index, base_descriptor.ptr);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_descriptor_table, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_graphics_root_descriptor_table);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_descriptor_table, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->base_descriptor = base_descriptor;
 }
 
-struct d3d12_set_root_32bit_constant_command
-{
-    struct d3d12_bundle_command command;
-    UINT parameter_index;
-    UINT data;
-    UINT offset;
-};
-
-static void d3d12_bundle_exec_set_compute_root_32bit_constant(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_32bit_constant(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_32bit_constant_command *args = args_v;
 
@@ -811,13 +861,15 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRoot32BitConstant(d3d12_com
     TRACE("iface %p, root_parameter_index %u, data 0x%08x, dst_offset %u.\n",
             iface, root_parameter_index, data, dst_offset);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constant, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constant);
+    if (!args || args->parameter_index != root_parameter_index || args->offset != dst_offset)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constant, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->data = data;
     args->offset = dst_offset;
 }
 
-static void d3d12_bundle_exec_set_graphics_root_32bit_constant(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_32bit_constant(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_32bit_constant_command *args = args_v;
 
@@ -833,22 +885,15 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRoot32BitConstant(d3d12_co
     TRACE("iface %p, root_parameter_index %u, data 0x%08x, dst_offset %u.\n",
             iface, root_parameter_index, data, dst_offset);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constant, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constant);
+    if (!args || args->parameter_index != root_parameter_index || args->offset != dst_offset)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constant, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->data = data;
     args->offset = dst_offset;
 }
 
-struct d3d12_set_root_32bit_constants_command
-{
-    struct d3d12_bundle_command command;
-    UINT parameter_index;
-    UINT constant_count;
-    UINT offset;
-    UINT data[];
-};
-
-static void d3d12_bundle_exec_set_compute_root_32bit_constants(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_32bit_constants(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_32bit_constants_command *args = args_v;
 
@@ -868,15 +913,20 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRoot32BitConstants(d3d12_co
     if (!constant_count)
         return;
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constants,
-            sizeof(*args) + sizeof(UINT) * constant_count);
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constants);
+    if (!args || args->parameter_index != root_parameter_index ||
+            args->constant_count != constant_count || args->offset != dst_offset)
+    {
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_32bit_constants,
+                sizeof(*args) + sizeof(UINT) * constant_count);
+    }
     args->parameter_index = root_parameter_index;
     args->constant_count = constant_count;
     args->offset = dst_offset;
     memcpy(args->data, data, sizeof(UINT) * constant_count);
 }
 
-static void d3d12_bundle_exec_set_graphics_root_32bit_constants(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_32bit_constants(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_32bit_constants_command *args = args_v;
 
@@ -896,22 +946,20 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRoot32BitConstants(d3d12_c
     if (!constant_count)
         return;
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constants,
-            sizeof(*args) + sizeof(UINT) * constant_count);
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constants);
+    if (!args || args->parameter_index != root_parameter_index ||
+            args->constant_count != constant_count || args->offset != dst_offset)
+    {
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_32bit_constants,
+                sizeof(*args) + sizeof(UINT) * constant_count);
+    }
     args->parameter_index = root_parameter_index;
     args->constant_count = constant_count;
     args->offset = dst_offset;
     memcpy(args->data, data, sizeof(UINT) * constant_count);
 }
 
-struct d3d12_set_root_descriptor_command
-{
-    struct d3d12_bundle_command command;
-    UINT parameter_index;
-    D3D12_GPU_VIRTUAL_ADDRESS address;
-};
-
-static void d3d12_bundle_exec_set_compute_root_cbv(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_cbv(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_command *args = args_v;
 
@@ -927,12 +975,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootConstantBufferView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_cbv, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_compute_root_cbv);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_cbv, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
 
-static void d3d12_bundle_exec_set_graphics_root_cbv(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_cbv(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_command *args = args_v;
 
@@ -948,12 +998,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootConstantBufferView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_cbv, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_graphics_root_cbv);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_cbv, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
 
-static void d3d12_bundle_exec_set_compute_root_srv(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_srv(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_command *args = args_v;
 
@@ -969,12 +1021,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootShaderResourceView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_srv, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_compute_root_srv);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_srv, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
 
-static void d3d12_bundle_exec_set_graphics_root_srv(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_srv(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_command *args = args_v;
 
@@ -990,12 +1044,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootShaderResourceView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_srv, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_graphics_root_srv);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_srv, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
 
-static void d3d12_bundle_exec_set_compute_root_uav(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_compute_root_uav(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_command *args = args_v;
 
@@ -1011,12 +1067,14 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetComputeRootUnorderedAccessView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_uav, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_compute_root_uav);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_compute_root_uav, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
 
-static void d3d12_bundle_exec_set_graphics_root_uav(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_graphics_root_uav(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_root_descriptor_command *args = args_v;
 
@@ -1032,23 +1090,19 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetGraphicsRootUnorderedAccessView(
     TRACE("iface %p, root_parameter_index %u, address %#"PRIx64".\n",
             iface, root_parameter_index, address);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_uav, sizeof(*args));
+    args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_set_graphics_root_uav);
+    if (!args || args->parameter_index != root_parameter_index)
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_set_graphics_root_uav, sizeof(*args));
     args->parameter_index = root_parameter_index;
     args->address = address;
 }
 
-struct d3d12_ia_set_index_buffer_command
-{
-    struct d3d12_bundle_command command;
-    D3D12_INDEX_BUFFER_VIEW view;
-};
-
-static void d3d12_bundle_exec_ia_set_index_buffer_null(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_ia_set_index_buffer_null(d3d12_command_list_iface *list, const void *args_v)
 {
     ID3D12GraphicsCommandList6_IASetIndexBuffer(list, NULL);
 }
 
-static void d3d12_bundle_exec_ia_set_index_buffer(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_ia_set_index_buffer(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_ia_set_index_buffer_command *args = args_v;
 
@@ -1075,15 +1129,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_IASetIndexBuffer(d3d12_command_list_i
     }
 }
 
-struct d3d12_ia_set_vertex_buffers_command
-{
-    struct d3d12_bundle_command command;
-    UINT start_slot;
-    UINT view_count;
-    D3D12_VERTEX_BUFFER_VIEW views[];
-};
-
-static void d3d12_bundle_exec_ia_set_vertex_buffers(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_ia_set_vertex_buffers(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_ia_set_vertex_buffers_command *args = args_v;
 
@@ -1190,15 +1236,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetPredication(d3d12_command_list_ifa
             iface, buffer, aligned_buffer_offset, operation);
 }
 
-struct d3d12_debug_marker_command
-{
-    struct d3d12_bundle_command command;
-    UINT metadata;
-    UINT data_size;
-    char data[];
-};
-
-static void d3d12_bundle_exec_set_marker(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_marker(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_debug_marker_command *args = args_v;
 
@@ -1219,7 +1257,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetMarker(d3d12_command_list_iface *i
     memcpy(args->data, data, size);
 }
 
-static void d3d12_bundle_exec_begin_event(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_begin_event(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_debug_marker_command *args = args_v;
 
@@ -1240,7 +1278,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_BeginEvent(d3d12_command_list_iface *
     memcpy(args->data, data, size);
 }
 
-static void d3d12_bundle_exec_end_event(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_end_event(d3d12_command_list_iface *list, const void *args_v)
 {
     ID3D12GraphicsCommandList6_EndEvent(list);
 }
@@ -1254,18 +1292,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_EndEvent(d3d12_command_list_iface *if
     d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_end_event, sizeof(struct d3d12_bundle_command));
 }
 
-struct d3d12_execute_indirect_command
-{
-    struct d3d12_bundle_command command;
-    ID3D12CommandSignature *signature;
-    UINT max_count;
-    ID3D12Resource *arg_buffer;
-    UINT64 arg_offset;
-    ID3D12Resource *count_buffer;
-    UINT64 count_offset;
-};
-
-static void d3d12_bundle_exec_execute_indirect(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_execute_indirect(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_execute_indirect_command *args = args_v;
 
@@ -1320,14 +1347,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_AtomicCopyBufferUINT64(d3d12_command_
             dependent_resource_count, dependent_resources, dependent_sub_resource_ranges);
 }
 
-struct d3d12_om_set_depth_bounds_command
-{
-    struct d3d12_bundle_command command;
-    FLOAT min;
-    FLOAT max;
-};
-
-static void d3d12_bundle_exec_om_set_depth_bounds(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_om_set_depth_bounds(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_om_set_depth_bounds_command *args = args_v;
 
@@ -1342,7 +1362,8 @@ static void STDMETHODCALLTYPE d3d12_bundle_OMSetDepthBounds(d3d12_command_list_i
 
     TRACE("iface %p, min %.8e, max %.8e.\n", iface, min, max);
 
-    args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_depth_bounds, sizeof(*args));
+    if (!(args = d3d12_bundle_get_overridable_command(bundle, &d3d12_bundle_exec_om_set_depth_bounds)))
+        args = d3d12_bundle_add_command(bundle, &d3d12_bundle_exec_om_set_depth_bounds, sizeof(*args));
     args->min = min;
     args->max = max;
 }
@@ -1417,15 +1438,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetViewInstanceMask(d3d12_command_lis
     args->mask = mask;
 }
 
-struct d3d12_write_buffer_immediate_command
-{
-    struct d3d12_bundle_command command;
-    UINT count;
-    D3D12_WRITEBUFFERIMMEDIATE_PARAMETER *parameters;
-    D3D12_WRITEBUFFERIMMEDIATE_MODE *modes;
-};
-
-static void d3d12_bundle_exec_write_buffer_immediate(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_write_buffer_immediate(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_write_buffer_immediate_command *args = args_v;
 
@@ -1515,13 +1528,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_CopyRaytracingAccelerationStructure(d
           iface, dst_data, src_data, mode);
 }
 
-struct d3d12_set_pipeline_state1_command
-{
-    struct d3d12_bundle_command command;
-    ID3D12StateObject *state_object;
-};
-
-static void d3d12_bundle_exec_set_pipeline_state1(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_set_pipeline_state1(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_set_pipeline_state1_command *args = args_v;
 
@@ -1540,13 +1547,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_SetPipelineState1(d3d12_command_list_
     args->state_object = state_object;
 }
 
-struct d3d12_dispatch_rays_command
-{
-    struct d3d12_bundle_command command;
-    D3D12_DISPATCH_RAYS_DESC desc;
-};
-
-static void d3d12_bundle_exec_dispatch_rays(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_dispatch_rays(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_dispatch_rays_command *args = args_v;
 
@@ -1628,7 +1629,7 @@ static void STDMETHODCALLTYPE d3d12_bundle_RSSetShadingRateImage(d3d12_command_l
     args->image = image;
 }
 
-static void d3d12_bundle_exec_dispatch_mesh(d3d12_command_list_iface *list, const void *args_v)
+void d3d12_bundle_exec_dispatch_mesh(d3d12_command_list_iface *list, const void *args_v)
 {
     const struct d3d12_dispatch_command *args = args_v;
 
@@ -1743,11 +1744,150 @@ static CONST_VTBL struct ID3D12GraphicsCommandList6Vtbl d3d12_bundle_vtbl =
     d3d12_bundle_DispatchMesh,
 };
 
+static const struct d3d12_bundle_command *d3d12_bundle_next_command(const struct d3d12_bundle *bundle,
+        const struct d3d12_bundle_command *command)
+{
+    return command == bundle->tail ? NULL : d3d12_bundle_command_next(command);
+}
+
+static bool d3d12_bundle_command_is_draw(pfn_d3d12_bundle_command proc)
+{
+    return proc == &d3d12_bundle_exec_draw_instanced ||
+            proc == &d3d12_bundle_exec_draw_indexed_instanced;
+}
+
+static bool d3d12_bundle_command_sets_graphics_root_arguments(pfn_d3d12_bundle_command proc)
+{
+    return proc == &d3d12_bundle_exec_set_graphics_root_descriptor_table ||
+            proc == &d3d12_bundle_exec_set_graphics_root_32bit_constant ||
+            proc == &d3d12_bundle_exec_set_graphics_root_32bit_constants ||
+            proc == &d3d12_bundle_exec_set_graphics_root_cbv ||
+            proc == &d3d12_bundle_exec_set_graphics_root_srv ||
+            proc == &d3d12_bundle_exec_set_graphics_root_uav;
+}
+
+static bool d3d12_bundle_command_is_bakeable_state(pfn_d3d12_bundle_command proc)
+{
+    /* State which is either dynamic or only affects pipeline and descriptor selection.
+     * Anything which changes attachments or needs to leave the render pass is excluded. */
+    return d3d12_bundle_command_sets_graphics_root_arguments(proc) ||
+            proc == &d3d12_bundle_exec_set_pipeline_state ||
+            proc == &d3d12_bundle_exec_set_graphics_root_signature ||
+            proc == &d3d12_bundle_exec_set_compute_root_signature ||
+            proc == &d3d12_bundle_exec_set_compute_root_descriptor_table ||
+            proc == &d3d12_bundle_exec_set_compute_root_32bit_constant ||
+            proc == &d3d12_bundle_exec_set_compute_root_32bit_constants ||
+            proc == &d3d12_bundle_exec_set_compute_root_cbv ||
+            proc == &d3d12_bundle_exec_set_compute_root_srv ||
+            proc == &d3d12_bundle_exec_set_compute_root_uav ||
+            proc == &d3d12_bundle_exec_ia_set_primitive_topology ||
+            proc == &d3d12_bundle_exec_ia_set_index_buffer_null ||
+            proc == &d3d12_bundle_exec_ia_set_index_buffer ||
+            proc == &d3d12_bundle_exec_ia_set_vertex_buffers ||
+            proc == &d3d12_bundle_exec_om_set_blend_factor ||
+            proc == &d3d12_bundle_exec_om_set_stencil_ref ||
+            proc == &d3d12_bundle_exec_om_set_depth_bounds ||
+            proc == &d3d12_bundle_exec_rs_set_shading_rate ||
+            proc == &d3d12_bundle_exec_rs_set_shading_rate_base;
+}
+
+static void d3d12_bundle_classify_commands(struct d3d12_bundle *bundle)
+{
+    const struct d3d12_set_root_signature_command *root_signature_args;
+    const struct d3d12_set_pipeline_state_command *pipeline_args;
+    struct d3d12_pipeline_state *pipeline_state = NULL;
+    const struct d3d12_bundle_command *command;
+    bool sets_graphics_root_arguments = false;
+    bool sets_pipeline_state = false;
+    unsigned int event_depth = 0;
+    bool has_draw = false;
+
+    bundle->is_bakeable = false;
+    bundle->bake_pipeline_state = NULL;
+    bundle->bake_root_signature = NULL;
+    bundle->state_command_count = 0;
+
+    /* Secondary command buffers can only inherit dynamic rendering state. */
+    if (!(vkd3d_config_flags & VKD3D_CONFIG_FLAG_BAKE_BUNDLES) ||
+            !d3d12_device_use_dynamic_rendering(bundle->device))
+        return;
+
+    for (command = bundle->head; command; command = d3d12_bundle_next_command(bundle, command))
+    {
+        if (d3d12_bundle_command_is_draw(command->proc))
+        {
+            if (sets_pipeline_state && (!pipeline_state || !d3d12_pipeline_state_is_graphics(pipeline_state)))
+                return;
+
+            if (!has_draw)
+                bundle->bake_pipeline_state = pipeline_state;
+            has_draw = true;
+            continue;
+        }
+
+        /* Debug labels are recorded into the baked command buffer as-is. */
+        if (command->proc == &d3d12_bundle_exec_set_marker)
+            continue;
+
+        if (command->proc == &d3d12_bundle_exec_begin_event)
+        {
+            event_depth++;
+            continue;
+        }
+
+        if (command->proc == &d3d12_bundle_exec_end_event)
+        {
+            if (!event_depth--)
+                return;
+            continue;
+        }
+
+        if (!d3d12_bundle_command_is_bakeable_state(command->proc))
+            return;
+
+        if (command->proc == &d3d12_bundle_exec_set_pipeline_state)
+        {
+            pipeline_args = (const struct d3d12_set_pipeline_state_command *)command;
+            pipeline_state = impl_from_ID3D12PipelineState(pipeline_args->pipeline_state);
+            sets_pipeline_state = true;
+
+            /* Transform feedback has to be paused and resumed around render passes. */
+            if (pipeline_state && d3d12_pipeline_state_is_graphics(pipeline_state) &&
+                    pipeline_state->graphics.xfb_enabled)
+                return;
+        }
+        else if (command->proc == &d3d12_bundle_exec_set_graphics_root_signature)
+        {
+            /* A root signature set before any root argument decides whether arguments are inherited. */
+            if (!sets_graphics_root_arguments && !has_draw)
+            {
+                root_signature_args = (const struct d3d12_set_root_signature_command *)command;
+                bundle->bake_root_signature = impl_from_ID3D12RootSignature(root_signature_args->root_signature);
+            }
+            sets_graphics_root_arguments = true;
+        }
+        else if (d3d12_bundle_command_sets_graphics_root_arguments(command->proc))
+            sets_graphics_root_arguments = true;
+
+        if (!vkd3d_array_reserve((void **)&bundle->state_commands, &bundle->state_commands_size,
+                bundle->state_command_count + 1, sizeof(*bundle->state_commands)))
+            return;
+
+        bundle->state_commands[bundle->state_command_count++] = command;
+    }
+
+    bundle->is_bakeable = has_draw && !event_depth;
+
+    if (bundle->is_bakeable)
+        TRACE("Bundle %p can be baked, %zu state commands.\n", bundle, bundle->state_command_count);
+}
+
 HRESULT d3d12_bundle_create(struct d3d12_device *device,
         UINT node_mask, D3D12_COMMAND_LIST_TYPE type, struct d3d12_bundle **bundle)
 {
     struct d3d12_bundle *object;
     HRESULT hr;
+    int rc;
 
     if (!(object = vkd3d_calloc(1, sizeof(*object))))
         return E_OUTOFMEMORY;
@@ -1756,8 +1896,16 @@ HRESULT d3d12_bundle_create(struct d3d12_device *device,
     object->refcount = 1;
     object->device = device;
 
+    if ((rc = pthread_mutex_init(&object->bake_mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        vkd3d_free(object);
+        return hresult_from_errno(rc);
+    }
+
     if (FAILED(hr = vkd3d_private_store_init(&object->private_store)))
     {
+        pthread_mutex_destroy(&object->bake_mutex);
         vkd3d_free(object);
         return hr;
     }
@@ -1769,13 +1917,18 @@ HRESULT d3d12_bundle_create(struct d3d12_device *device,
 
 void d3d12_bundle_execute(struct d3d12_bundle *bundle, d3d12_command_list_iface *list)
 {
-    struct d3d12_bundle_command *command = bundle->head;
+    const struct d3d12_bundle_command *command;
 
-    while (command)
-    {
+    for (command = bundle->head; command; command = d3d12_bundle_next_command(bundle, command))
         command->proc(list, command);
-        command = command->next;
-    }
+}
+
+void d3d12_bundle_execute_state_commands(struct d3d12_bundle *bundle, d3d12_command_list_iface *list)
+{
+    size_t i;
+
+    for (i = 0; i < bundle->state_command_count; i++)
+        bundle->state_commands[i]->proc(list, bundle->state_commands[i]);
 }
 
 struct d3d12_bundle *d3d12_bundle_from_iface(ID3D12GraphicsCommandList *iface)
@@ -21,6 +21,15 @@
 
 #include "vkd3d_private.h"
 #include "vkd3d_shader.h"
+#include "vkd3d_varint.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
 
 struct vkd3d_cached_pipeline_key
 {
@@ -61,93 +70,162 @@ struct vkd3d_cached_pipeline_entry
 #define VKD3D_PIPELINE_BLOB_ALIGN 8
 #define VKD3D_PIPELINE_BLOB_CHUNK_ALIGN 8
 
-static size_t vkd3d_compute_size_varint(const uint32_t *words, size_t word_count)
+/* Simple LZ77 byte codec for internal library blobs. The stream is a sequence of
+ * { token, [literal length], literals, u16 offset, [match length] }, where the token holds
+ * 4 bits of literal length and 4 bits of match length, extended with 255-terminated bytes.
+ * The final sequence only contains literals. */
+#define VKD3D_LZ_MIN_MATCH 4
+#define VKD3D_LZ_MAX_OFFSET 0xffff
+#define VKD3D_LZ_HASH_BITS 12
+
+static size_t vkd3d_lz_compress_bound(size_t size)
 {
-    size_t size = 0;
-    uint32_t w;
-    size_t i;
+    return size + size / 255 + 16;
+}
 
-    for (i = 0; i < word_count; i++)
-    {
-        w = words[i];
-        if (w < (1u << 7))
-            size += 1;
-        else if (w < (1u << 14))
-            size += 2;
-        else if (w < (1u << 21))
-            size += 3;
-        else if (w < (1u << 28))
-            size += 4;
-        else
-            size += 5;
+static uint8_t *vkd3d_lz_write_length(uint8_t *buffer, size_t length)
+{
+    while (length >= 255)
+    {
+        *buffer++ = 255;
+        length -= 255;
     }
-    return size;
+
+    *buffer++ = length;
+    return buffer;
 }
 
-static uint8_t *vkd3d_encode_varint(uint8_t *buffer, const uint32_t *words, size_t word_count)
+static uint8_t *vkd3d_lz_write_sequence(uint8_t *buffer, const uint8_t *literals, size_t literal_length,
+        size_t offset, size_t match_length)
 {
-    uint32_t w;
-    size_t i;
-    for (i = 0; i < word_count; i++)
+    uint8_t *token = buffer++;
+
+    *token = min(literal_length, 15) << 4;
+    if (literal_length >= 15)
+        buffer = vkd3d_lz_write_length(buffer, literal_length - 15);
+
+    memcpy(buffer, literals, literal_length);
+    buffer += literal_length;
+
+    if (match_length)
     {
-        w = words[i];
-        if (w < (1u << 7))
-            *buffer++ = w;
-        else if (w < (1u << 14))
-        {
-            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
-            *buffer++ = (w >> 7) & 0x7f;
-        }
-        else if (w < (1u << 21))
-        {
-            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
-            *buffer++ = 0x80u | ((w >> 7) & 0x7f);
-            *buffer++ = (w >> 14) & 0x7f;
-        }
-        else if (w < (1u << 28))
-        {
-            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
-            *buffer++ = 0x80u | ((w >> 7) & 0x7f);
-            *buffer++ = 0x80u | ((w >> 14) & 0x7f);
-            *buffer++ = (w >> 21) & 0x7f;
-        }
-        else
+        *buffer++ = offset & 0xff;
+        *buffer++ = offset >> 8;
+
+        match_length -= VKD3D_LZ_MIN_MATCH;
+        *token |= min(match_length, 15);
+        if (match_length >= 15)
+            buffer = vkd3d_lz_write_length(buffer, match_length - 15);
+    }
+
+    return buffer;
+}
+
+/* Output must hold at least vkd3d_lz_compress_bound(size) bytes. */
+static size_t vkd3d_lz_compress(uint8_t *buffer, const uint8_t *data, size_t size)
+{
+    uint32_t table[1u << VKD3D_LZ_HASH_BITS];
+    const uint8_t *end = data + size;
+    const uint8_t *literals = data;
+    const uint8_t *match_limit;
+    const uint8_t *ptr = data;
+    uint8_t *out = buffer;
+    size_t match_length;
+    const uint8_t *ref;
+    uint32_t word, h;
+
+    memset(table, 0xff, sizeof(table));
+    match_limit = size > VKD3D_LZ_MIN_MATCH ? end - VKD3D_LZ_MIN_MATCH : data;
+
+    while (ptr < match_limit)
+    {
+        memcpy(&word, ptr, sizeof(word));
+        h = (word * 2654435761u) >> (32 - VKD3D_LZ_HASH_BITS);
+        ref = table[h] != UINT32_MAX ? data + table[h] : NULL;
+        table[h] = ptr - data;
+
+        if (!ref || ptr - ref > VKD3D_LZ_MAX_OFFSET || memcmp(ref, ptr, VKD3D_LZ_MIN_MATCH))
         {
-            *buffer++ = 0x80u | ((w >> 0) & 0x7f);
-            *buffer++ = 0x80u | ((w >> 7) & 0x7f);
-            *buffer++ = 0x80u | ((w >> 14) & 0x7f);
-            *buffer++ = 0x80u | ((w >> 21) & 0x7f);
-            *buffer++ = (w >> 28) & 0x7f;
+            ptr++;
+            continue;
         }
+
+        match_length = VKD3D_LZ_MIN_MATCH;
+        while (ptr + match_length < end && ref[match_length] == ptr[match_length])
+            match_length++;
+
+        out = vkd3d_lz_write_sequence(out, literals, ptr - literals, ptr - ref, match_length);
+        ptr += match_length;
+        literals = ptr;
     }
 
-    return buffer;
+    out = vkd3d_lz_write_sequence(out, literals, end - literals, 0, 0);
+    return out - buffer;
 }
 
-static bool vkd3d_decode_varint(uint32_t *words, size_t words_size, const uint8_t *buffer, size_t buffer_size)
+static bool vkd3d_lz_read_length(const uint8_t **inout_ptr, const uint8_t *end, size_t *length)
 {
-    size_t offset = 0;
-    uint32_t shift;
-    uint32_t *w;
-    size_t i;
+    const uint8_t *ptr = *inout_ptr;
+    uint8_t b;
 
-    for (i = 0; i < words_size; i++)
+    do
     {
-        w = &words[i];
-        *w = 0;
+        if (ptr >= end)
+            return false;
+        b = *ptr++;
+        *length += b;
+    } while (b == 255);
+
+    *inout_ptr = ptr;
+    return true;
+}
 
-        shift = 0;
-        do
-        {
-            if (offset >= buffer_size || shift >= 32u)
-                return false;
+static bool vkd3d_lz_decompress(uint8_t *data, size_t size, const uint8_t *buffer, size_t buffer_size)
+{
+    const uint8_t *end = buffer + buffer_size;
+    const uint8_t *ptr = buffer;
+    uint8_t *out = data;
+    size_t length, offset;
+    uint8_t token;
+    size_t i;
 
-            *w |= (buffer[offset] & 0x7f) << shift;
-            shift += 7;
-        } while (buffer[offset++] & 0x80);
+    while (ptr < end)
+    {
+        token = *ptr++;
+
+        length = token >> 4;
+        if (length == 15 && !vkd3d_lz_read_length(&ptr, end, &length))
+            return false;
+        if (length > (size_t)(end - ptr) || length > size - (size_t)(out - data))
+            return false;
+
+        memcpy(out, ptr, length);
+        out += length;
+        ptr += length;
+
+        if (ptr == end)
+            break;
+
+        if (end - ptr < 2)
+            return false;
+        offset = ptr[0] | (ptr[1] << 8);
+        ptr += 2;
+
+        length = token & 0xf;
+        if (length == 15 && !vkd3d_lz_read_length(&ptr, end, &length))
+            return false;
+        length += VKD3D_LZ_MIN_MATCH;
+
+        if (!offset || offset > (size_t)(out - data) || length > size - (size_t)(out - data))
+            return false;
+
+        /* Matches may overlap their own output. */
+        for (i = 0; i < length; i++)
+            out[i] = out[i - offset];
+        out += length;
     }
 
-    return buffer_size == offset;
+    return out == data + size;
 }
 
 VkResult vkd3d_create_pipeline_cache(struct d3d12_device *device,
@@ -165,7 +243,7 @@ VkResult vkd3d_create_pipeline_cache(struct d3d12_device *device,
     return VK_CALL(vkCreatePipelineCache(device->vk_device, &info, NULL, cache));
 }
 
-#define VKD3D_CACHE_BLOB_VERSION MAKE_MAGIC('V','K','B',3)
+#define VKD3D_CACHE_BLOB_VERSION MAKE_MAGIC('V','K','B',4)
 
 enum vkd3d_pipeline_blob_chunk_type
 {
@@ -232,13 +310,30 @@ struct vkd3d_pipeline_blob
     uint8_t data[]; /* vkd3d_pipeline_blob_chunks laid out one after the other with u32 alignment. */
 };
 
+enum vkd3d_pipeline_blob_internal_flag
+{
+    /* data[] is a vkd3d_pipeline_blob_compressed wrapping the actual payload. */
+    VKD3D_PIPELINE_BLOB_INTERNAL_FLAG_COMPRESSED = (1 << 0),
+};
+
 /* Used for de-duplicated pipeline cache and SPIR-V hashmaps. */
 struct vkd3d_pipeline_blob_internal
 {
     uint32_t checksum; /* Simple checksum for data[] as a sanity check. */
+    uint32_t flags; /* vkd3d_pipeline_blob_internal_flag. */
     uint8_t data[]; /* Either raw uint8_t for pipeline cache, or vkd3d_pipeline_blob_chunk_spirv. */
 };
 
+struct vkd3d_pipeline_blob_compressed
+{
+    uint32_t decompressed_size;
+    uint32_t reserved;
+    uint8_t data[]; /* LZ compressed payload. */
+};
+
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_internal) == 8);
+STATIC_ASSERT(sizeof(struct vkd3d_pipeline_blob_compressed) == 8);
+
 STATIC_ASSERT(offsetof(struct vkd3d_pipeline_blob, data) == (32 + VK_UUID_SIZE));
 STATIC_ASSERT(offsetof(struct vkd3d_pipeline_blob, data) == sizeof(struct vkd3d_pipeline_blob));
 
@@ -247,7 +342,7 @@ static uint32_t vkd3d_pipeline_blob_compute_data_checksum(const uint8_t *data, s
     const struct vkd3d_shader_code code = { data, size };
     vkd3d_shader_hash_t h;
 
-    h = vkd3d_shader_hash(&code);
+    h = vkd3d_shader_hash_fast(&code);
     return hash_uint64(h);
 }
 
@@ -366,8 +461,80 @@ static struct vkd3d_pipeline_blob_chunk *finish_and_iterate_blob_chunk(struct vk
     return (struct vkd3d_pipeline_blob_chunk *)&chunk->data[aligned_size];
 }
 
+/* Compresses an internal blob in place if the result is meaningfully smaller.
+ * The checksum has to be computed afterwards, since it covers the stored data. */
+static void vkd3d_pipeline_blob_internal_compress(struct vkd3d_cached_pipeline_entry *entry)
+{
+    struct vkd3d_pipeline_blob_internal *internal = (struct vkd3d_pipeline_blob_internal *)entry->data.blob;
+    struct vkd3d_pipeline_blob_internal *compressed_internal;
+    struct vkd3d_pipeline_blob_compressed *compressed;
+    size_t payload_size, compressed_size;
+    void *ptr;
+
+    if (!(vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_COMPRESS))
+        return;
+
+    payload_size = entry->data.blob_length - sizeof(*internal);
+    if (payload_size > UINT32_MAX)
+        return;
+
+    if (!(compressed_internal = vkd3d_malloc(sizeof(*compressed_internal) + sizeof(*compressed) +
+            vkd3d_lz_compress_bound(payload_size))))
+        return;
+
+    compressed = (struct vkd3d_pipeline_blob_compressed *)compressed_internal->data;
+    compressed_size = sizeof(*compressed) + vkd3d_lz_compress(compressed->data, internal->data, payload_size);
+
+    /* Not worth paying for decompression on load. */
+    if (compressed_size >= payload_size - payload_size / 8)
+    {
+        vkd3d_free(compressed_internal);
+        return;
+    }
+
+    compressed_internal->flags = VKD3D_PIPELINE_BLOB_INTERNAL_FLAG_COMPRESSED;
+    compressed->decompressed_size = payload_size;
+    compressed->reserved = 0;
+
+    entry->data.blob_length = sizeof(*compressed_internal) + compressed_size;
+    if ((ptr = vkd3d_realloc(compressed_internal, entry->data.blob_length)))
+        compressed_internal = ptr;
+
+    vkd3d_free(internal);
+    entry->data.blob = compressed_internal;
+}
+
+static bool vkd3d_pipeline_blob_internal_decompress(const void **data, size_t *size, void **decompressed)
+{
+    const struct vkd3d_pipeline_blob_compressed *compressed = *data;
+
+    if (*size < sizeof(*compressed))
+    {
+        FIXME("Compressed blob length is too small.\n");
+        return false;
+    }
+
+    if (!(*decompressed = vkd3d_malloc(compressed->decompressed_size)))
+        return false;
+
+    if (!vkd3d_lz_decompress(*decompressed, compressed->decompressed_size,
+            compressed->data, *size - sizeof(*compressed)))
+    {
+        FIXME("Failed to decompress internal blob.\n");
+        vkd3d_free(*decompressed);
+        *decompressed = NULL;
+        return false;
+    }
+
+    *data = *decompressed;
+    *size = compressed->decompressed_size;
+    return true;
+}
+
+/* If the blob is stored compressed, *decompressed receives an allocation
+ * backing *data which the caller must free. */
 static bool d3d12_pipeline_library_find_internal_blob(struct d3d12_pipeline_library *pipeline_library,
-        const struct hash_map *map, uint64_t hash, const void **data, size_t *size)
+        const struct hash_map *map, uint64_t hash, const void **data, size_t *size, void **decompressed)
 {
     const struct vkd3d_pipeline_blob_internal *internal;
     const struct vkd3d_cached_pipeline_entry *entry;
@@ -375,8 +542,10 @@ static bool d3d12_pipeline_library_find_internal_blob(struct d3d12_pipeline_libr
     uint32_t checksum;
     bool ret = false;
 
+    *decompressed = NULL;
+
     /* We are called from within D3D12 PSO creation, and we won't have read locks active here. */
-    if (rwlock_lock_read(&pipeline_library->mutex))
+    if (sharded_rwlock_lock_read(&pipeline_library->mutex))
         return false;
 
     key.name_length = 0;
@@ -402,11 +571,15 @@ static bool d3d12_pipeline_library_find_internal_blob(struct d3d12_pipeline_libr
             goto out;
         }
 
+        if ((internal->flags & VKD3D_PIPELINE_BLOB_INTERNAL_FLAG_COMPRESSED) &&
+                !vkd3d_pipeline_blob_internal_decompress(data, size, decompressed))
+            goto out;
+
         ret = true;
     }
 
 out:
-    rwlock_unlock_read(&pipeline_library->mutex);
+    sharded_rwlock_unlock_read(&pipeline_library->mutex);
     return ret;
 }
 
@@ -416,6 +589,7 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
     const struct vkd3d_pipeline_blob *blob = state->blob.pCachedBlob;
     const struct vkd3d_pipeline_blob_chunk_link *link;
     const struct vkd3d_pipeline_blob_chunk *chunk;
+    void *decompressed = NULL;
     size_t payload_size;
     const void *data;
     size_t size;
@@ -445,7 +619,7 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
         link = CONST_CAST_CHUNK_DATA(chunk, link);
 
         if (!d3d12_pipeline_library_find_internal_blob(state->library,
-                &state->library->driver_cache_map, link->hash, &data, &size))
+                &state->library->driver_cache_map, link->hash, &data, &size, &decompressed))
         {
             if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_LOG)
                 INFO("Did not find internal PSO cache reference %016"PRIx64".\n", link->hash);
@@ -461,6 +635,7 @@ HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
     }
 
     vr = vkd3d_create_pipeline_cache(device, size, data, cache);
+    vkd3d_free(decompressed);
     return hresult_from_vk_result(vr);
 }
 
@@ -474,6 +649,7 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
     const struct vkd3d_pipeline_blob_chunk_spirv *spirv;
     const struct vkd3d_pipeline_blob_chunk_link *link;
     const struct vkd3d_pipeline_blob_chunk *chunk;
+    void *decompressed = NULL;
     size_t internal_blob_size;
     size_t payload_size;
     void *duped_code;
@@ -504,7 +680,7 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
     {
         link = CONST_CAST_CHUNK_DATA(chunk, link);
         if (!d3d12_pipeline_library_find_internal_blob(state->library, &state->library->spirv_cache_map,
-                link->hash, (const void **)&spirv, &internal_blob_size))
+                link->hash, (const void **)&spirv, &internal_blob_size, &decompressed))
         {
             FIXME("Did not find internal SPIR-V reference %016"PRIx64".\n", link->hash);
             spirv = NULL;
@@ -523,11 +699,17 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
         spirv = NULL;
 
     if (!spirv)
+    {
+        vkd3d_free(decompressed);
         return E_FAIL;
+    }
 
     duped_code = vkd3d_malloc(spirv->decompressed_spirv_size);
     if (!duped_code)
+    {
+        vkd3d_free(decompressed);
         return E_OUTOFMEMORY;
+    }
 
     if (!vkd3d_decode_varint(duped_code,
             spirv->decompressed_spirv_size / sizeof(uint32_t),
@@ -535,9 +717,12 @@ HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
     {
         FIXME("Failed to decode VARINT.\n");
         vkd3d_free(duped_code);
+        vkd3d_free(decompressed);
         return E_INVALIDARG;
     }
 
+    vkd3d_free(decompressed);
+
     spirv_code->code = duped_code;
     spirv_code->size = spirv->decompressed_spirv_size;
 
@@ -655,9 +840,13 @@ static void vkd3d_shader_code_serialize_referenced(struct d3d12_pipeline_library
         entry.data.blob = internal;
         blob.code = spirv->data;
         blob.size = varint_size;
-        entry.key.internal_key_hash = vkd3d_shader_hash(&blob);
+        entry.key.internal_key_hash = vkd3d_shader_hash_fast(&blob);
 
-        internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(internal->data, wrapped_varint_size);
+        internal->flags = 0;
+        vkd3d_pipeline_blob_internal_compress(&entry);
+        internal = (struct vkd3d_pipeline_blob_internal *)entry.data.blob;
+        internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(internal->data,
+                entry.data.blob_length - sizeof(*internal));
 
         /* For duplicate, we won't insert. Just free the blob. */
         if (!d3d12_pipeline_library_insert_hash_map_blob(pipeline_library,
@@ -776,8 +965,13 @@ static VkResult vkd3d_serialize_pipeline_state_referenced(struct d3d12_pipeline_
 
         blob.code = internal->data;
         blob.size = vk_pipeline_cache_size;
-        entry.key.internal_key_hash = vkd3d_shader_hash(&blob);
-        internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(blob.code, blob.size);
+        entry.key.internal_key_hash = vkd3d_shader_hash_fast(&blob);
+
+        internal->flags = 0;
+        vkd3d_pipeline_blob_internal_compress(&entry);
+        internal = (struct vkd3d_pipeline_blob_internal *)entry.data.blob;
+        internal->checksum = vkd3d_pipeline_blob_compute_data_checksum(internal->data,
+                entry.data.blob_length - sizeof(*internal));
 
         /* For duplicate, we won't insert. Just free the blob. */
         if (!d3d12_pipeline_library_insert_hash_map_blob(pipeline_library,
@@ -952,7 +1146,7 @@ struct vkd3d_serialized_pipeline_toc_entry
 };
 STATIC_ASSERT(sizeof(struct vkd3d_serialized_pipeline_toc_entry) == 16);
 
-#define VKD3D_PIPELINE_LIBRARY_VERSION MAKE_MAGIC('V','K','L',3)
+#define VKD3D_PIPELINE_LIBRARY_VERSION MAKE_MAGIC('V','K','L',5)
 
 struct vkd3d_serialized_pipeline_library
 {
@@ -1029,8 +1223,6 @@ static void d3d12_pipeline_library_serialize_entry(
         memcpy(data + name_offset, entry->key.name, entry->key.name_length);
     else
         memcpy(data + name_offset, &entry->key.internal_key_hash, sizeof(entry->key.internal_key_hash));
-
-    memcpy(data + blob_offset, entry->data.blob, entry->data.blob_length);
 }
 
 static void d3d12_pipeline_library_cleanup_map(struct hash_map *map)
@@ -1058,7 +1250,7 @@ static void d3d12_pipeline_library_cleanup(struct d3d12_pipeline_library *pipeli
     d3d12_pipeline_library_cleanup_map(&pipeline_library->spirv_cache_map);
 
     vkd3d_private_store_destroy(&pipeline_library->private_store);
-    rwlock_destroy(&pipeline_library->mutex);
+    sharded_rwlock_destroy(&pipeline_library->mutex);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_QueryInterface(d3d12_pipeline_library_iface *iface,
@@ -1167,7 +1359,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_StorePipeline(d3d12_pipe
     if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_LOG)
         INFO("Serializing pipeline to library.\n");
 
-    if ((rc = rwlock_lock_write(&pipeline_library->mutex)))
+    if ((rc = sharded_rwlock_lock_write(&pipeline_library->mutex)))
     {
         ERR("Failed to lock mutex, rc %d.\n", rc);
         return hresult_from_errno(rc);
@@ -1180,14 +1372,14 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_StorePipeline(d3d12_pipe
     if (hash_map_find(&pipeline_library->pso_map, &entry.key))
     {
         WARN("Pipeline %s already exists.\n", debugstr_w(name));
-        rwlock_unlock_write(&pipeline_library->mutex);
+        sharded_rwlock_unlock_write(&pipeline_library->mutex);
         return E_INVALIDARG;
     }
 
     /* We need to allocate persistent storage for the name */
     if (!(new_name = malloc(entry.key.name_length)))
     {
-        rwlock_unlock_write(&pipeline_library->mutex);
+        sharded_rwlock_unlock_write(&pipeline_library->mutex);
         return E_OUTOFMEMORY;
     }
 
@@ -1197,14 +1389,14 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_StorePipeline(d3d12_pipe
     if (FAILED(vr = vkd3d_serialize_pipeline_state(pipeline_library, pipeline_state, &entry.data.blob_length, NULL)))
     {
         vkd3d_free(new_name);
-        rwlock_unlock_write(&pipeline_library->mutex);
+        sharded_rwlock_unlock_write(&pipeline_library->mutex);
         return hresult_from_vk_result(vr);
     }
 
     if (!(new_blob = malloc(entry.data.blob_length)))
     {
         vkd3d_free(new_name);
-        rwlock_unlock_write(&pipeline_library->mutex);
+        sharded_rwlock_unlock_write(&pipeline_library->mutex);
         return E_OUTOFMEMORY;
     }
 
@@ -1212,7 +1404,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_StorePipeline(d3d12_pipe
     {
         vkd3d_free(new_name);
         vkd3d_free(new_blob);
-        rwlock_unlock_write(&pipeline_library->mutex);
+        sharded_rwlock_unlock_write(&pipeline_library->mutex);
         return hresult_from_vk_result(vr);
     }
 
@@ -1223,11 +1415,11 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_StorePipeline(d3d12_pipe
     {
         vkd3d_free(new_name);
         vkd3d_free(new_blob);
-        rwlock_unlock_write(&pipeline_library->mutex);
+        sharded_rwlock_unlock_write(&pipeline_library->mutex);
         return E_OUTOFMEMORY;
     }
 
-    rwlock_unlock_write(&pipeline_library->mutex);
+    sharded_rwlock_unlock_write(&pipeline_library->mutex);
     return S_OK;
 }
 
@@ -1238,7 +1430,7 @@ static HRESULT d3d12_pipeline_library_load_pipeline(struct d3d12_pipeline_librar
     struct vkd3d_cached_pipeline_key key;
     int rc;
 
-    if ((rc = rwlock_lock_read(&pipeline_library->mutex)))
+    if ((rc = sharded_rwlock_lock_read(&pipeline_library->mutex)))
     {
         ERR("Failed to lock mutex, rc %d.\n", rc);
         return hresult_from_errno(rc);
@@ -1250,14 +1442,14 @@ static HRESULT d3d12_pipeline_library_load_pipeline(struct d3d12_pipeline_librar
     if (!(e = (const struct vkd3d_cached_pipeline_entry*)hash_map_find(&pipeline_library->pso_map, &key)))
     {
         WARN("Pipeline %s does not exist.\n", debugstr_w(name));
-        rwlock_unlock_read(&pipeline_library->mutex);
+        sharded_rwlock_unlock_read(&pipeline_library->mutex);
         return E_INVALIDARG;
     }
 
     desc->cached_pso.blob.CachedBlobSizeInBytes = e->data.blob_length;
     desc->cached_pso.blob.pCachedBlob = e->data.blob;
     desc->cached_pso.library = pipeline_library;
-    rwlock_unlock_read(&pipeline_library->mutex);
+    sharded_rwlock_unlock_read(&pipeline_library->mutex);
 
     return d3d12_pipeline_state_create(pipeline_library->device, bind_point, desc, state);
 }
@@ -1339,7 +1531,7 @@ static SIZE_T STDMETHODCALLTYPE d3d12_pipeline_library_GetSerializedSize(d3d12_p
 
     TRACE("iface %p.\n", iface);
 
-    if ((rc = rwlock_lock_read(&pipeline_library->mutex)))
+    if ((rc = sharded_rwlock_lock_read(&pipeline_library->mutex)))
     {
         ERR("Failed to lock mutex, rc %d.\n", rc);
         return 0;
@@ -1347,17 +1539,18 @@ static SIZE_T STDMETHODCALLTYPE d3d12_pipeline_library_GetSerializedSize(d3d12_p
 
     total_size = d3d12_pipeline_library_get_serialized_size(pipeline_library);
 
-    rwlock_unlock_read(&pipeline_library->mutex);
+    sharded_rwlock_unlock_read(&pipeline_library->mutex);
     return total_size;
 }
 
 static void d3d12_pipeline_library_serialize_hash_map(const struct hash_map *map,
-        struct vkd3d_serialized_pipeline_toc_entry **inout_toc_entries, uint8_t *serialized_data,
-        size_t *inout_name_offset, size_t *inout_blob_offset)
+        struct vkd3d_serialized_pipeline_toc_entry **inout_toc_entries, const void ***inout_blobs,
+        uint8_t *serialized_data, size_t *inout_name_offset, size_t *inout_blob_offset)
 {
     struct vkd3d_serialized_pipeline_toc_entry *toc_entries = *inout_toc_entries;
     size_t name_offset = *inout_name_offset;
     size_t blob_offset = *inout_blob_offset;
+    const void **blobs = *inout_blobs;
     uint32_t i;
 
     for (i = 0; i < map->entry_count; i++)
@@ -1367,6 +1560,13 @@ static void d3d12_pipeline_library_serialize_hash_map(const struct hash_map *map
         if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
         {
             d3d12_pipeline_library_serialize_entry(e, toc_entries, serialized_data, name_offset, blob_offset);
+
+            /* Blob data is copied separately unless we failed to allocate the blob list. */
+            if (blobs)
+                *blobs++ = e->data.blob;
+            else
+                memcpy(serialized_data + blob_offset, e->data.blob, e->data.blob_length);
+
             toc_entries++;
             name_offset += e->key.name_length ? e->key.name_length : sizeof(e->key.internal_key_hash);
             blob_offset += align(e->data.blob_length, VKD3D_PIPELINE_BLOB_ALIGN);
@@ -1374,10 +1574,93 @@ static void d3d12_pipeline_library_serialize_hash_map(const struct hash_map *map
     }
 
     *inout_toc_entries = toc_entries;
+    *inout_blobs = blobs;
     *inout_name_offset = name_offset;
     *inout_blob_offset = blob_offset;
 }
 
+/* Copying blob data dominates serialization of large libraries,
+ * so split it across a few threads once there is enough data. */
+#define VKD3D_PIPELINE_LIBRARY_SERIALIZE_THREAD_COUNT 4
+#define VKD3D_PIPELINE_LIBRARY_SERIALIZE_PARALLEL_THRESHOLD (32 * 1024 * 1024)
+
+struct vkd3d_pipeline_library_copy_job
+{
+    const struct vkd3d_serialized_pipeline_toc_entry *toc_entries;
+    const void * const *blobs;
+    uint8_t *serialized_data;
+    size_t begin, end;
+};
+
+static void vkd3d_pipeline_library_copy_blobs(const struct vkd3d_pipeline_library_copy_job *job)
+{
+    size_t i;
+
+    for (i = job->begin; i < job->end; i++)
+    {
+        memcpy(job->serialized_data + job->toc_entries[i].blob_offset,
+                job->blobs[i], job->toc_entries[i].blob_length);
+    }
+}
+
+static void *vkd3d_pipeline_library_copy_blobs_main(void *arg)
+{
+    vkd3d_set_thread_name("vkd3d_serialize");
+    vkd3d_pipeline_library_copy_blobs(arg);
+    return NULL;
+}
+
+static void d3d12_pipeline_library_copy_blobs(struct d3d12_pipeline_library *pipeline_library,
+        const struct vkd3d_serialized_pipeline_toc_entry *toc_entries, const void * const *blobs,
+        size_t count, uint8_t *serialized_data)
+{
+    struct vkd3d_pipeline_library_copy_job jobs[VKD3D_PIPELINE_LIBRARY_SERIALIZE_THREAD_COUNT];
+    union vkd3d_thread_handle threads[VKD3D_PIPELINE_LIBRARY_SERIALIZE_THREAD_COUNT];
+    bool thread_valid[VKD3D_PIPELINE_LIBRARY_SERIALIZE_THREAD_COUNT];
+    struct vkd3d_instance *instance = pipeline_library->device->vkd3d_instance;
+    size_t job_count, target_size, copied_size, i, j;
+
+    job_count = pipeline_library->total_blob_size >= VKD3D_PIPELINE_LIBRARY_SERIALIZE_PARALLEL_THRESHOLD ?
+            VKD3D_PIPELINE_LIBRARY_SERIALIZE_THREAD_COUNT : 1;
+
+    /* Split entries into ranges of roughly equal byte size. */
+    copied_size = 0;
+
+    for (i = 0, j = 0; i < job_count; i++)
+    {
+        jobs[i].toc_entries = toc_entries;
+        jobs[i].blobs = blobs;
+        jobs[i].serialized_data = serialized_data;
+        jobs[i].begin = j;
+
+        target_size = i + 1 == job_count ? SIZE_MAX :
+                (pipeline_library->total_blob_size / job_count) * (i + 1);
+
+        while (j < count && copied_size < target_size)
+            copied_size += toc_entries[j++].blob_length;
+
+        jobs[i].end = j;
+    }
+
+    /* The calling thread handles the first range itself. */
+    for (i = 1; i < job_count; i++)
+    {
+        thread_valid[i] = jobs[i].begin != jobs[i].end &&
+                SUCCEEDED(vkd3d_create_thread(instance, vkd3d_pipeline_library_copy_blobs_main, &jobs[i], &threads[i]));
+
+        if (!thread_valid[i])
+            vkd3d_pipeline_library_copy_blobs(&jobs[i]);
+    }
+
+    vkd3d_pipeline_library_copy_blobs(&jobs[0]);
+
+    for (i = 1; i < job_count; i++)
+    {
+        if (thread_valid[i])
+            vkd3d_join_thread(instance, &threads[i]);
+    }
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_Serialize(d3d12_pipeline_library_iface *iface,
         void *data, SIZE_T data_size)
 {
@@ -1392,12 +1675,14 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_Serialize(d3d12_pipeline
     uint64_t spirv_size;
     size_t name_offset;
     size_t blob_offset;
+    const void **blobs;
     uint64_t pso_size;
+    const void **b;
     int rc;
 
     TRACE("iface %p.\n", iface);
 
-    if ((rc = rwlock_lock_read(&pipeline_library->mutex)))
+    if ((rc = sharded_rwlock_lock_read(&pipeline_library->mutex)))
     {
         ERR("Failed to lock mutex, rc %d.\n", rc);
         return 0;
@@ -1406,7 +1691,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_Serialize(d3d12_pipeline
     required_size = d3d12_pipeline_library_get_serialized_size(pipeline_library);
     if (data_size < required_size)
     {
-        rwlock_unlock_read(&pipeline_library->mutex);
+        sharded_rwlock_unlock_read(&pipeline_library->mutex);
         return E_INVALIDARG;
     }
 
@@ -1427,21 +1712,31 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_Serialize(d3d12_pipeline
     name_offset = 0;
     blob_offset = d3d12_pipeline_library_get_aligned_name_table_size(pipeline_library);
 
+    /* Write the TOC and name table first, then copy blob data in bulk. */
+    b = blobs = vkd3d_malloc(total_toc_entries * sizeof(*blobs));
+
     spirv_size = blob_offset;
-    d3d12_pipeline_library_serialize_hash_map(&pipeline_library->spirv_cache_map, &toc_entries,
+    d3d12_pipeline_library_serialize_hash_map(&pipeline_library->spirv_cache_map, &toc_entries, &b,
             serialized_data, &name_offset, &blob_offset);
     spirv_size = blob_offset - spirv_size;
 
     driver_cache_size = blob_offset;
-    d3d12_pipeline_library_serialize_hash_map(&pipeline_library->driver_cache_map, &toc_entries,
+    d3d12_pipeline_library_serialize_hash_map(&pipeline_library->driver_cache_map, &toc_entries, &b,
             serialized_data, &name_offset, &blob_offset);
     driver_cache_size = blob_offset - driver_cache_size;
 
     pso_size = blob_offset;
-    d3d12_pipeline_library_serialize_hash_map(&pipeline_library->pso_map, &toc_entries,
+    d3d12_pipeline_library_serialize_hash_map(&pipeline_library->pso_map, &toc_entries, &b,
             serialized_data, &name_offset, &blob_offset);
     pso_size = blob_offset - pso_size;
 
+    if (blobs)
+    {
+        d3d12_pipeline_library_copy_blobs(pipeline_library, header->entries, blobs,
+                total_toc_entries, serialized_data);
+        vkd3d_free(blobs);
+    }
+
     if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_LOG)
     {
         INFO("Serializing pipeline library (%"PRIu64" bytes):\n"
@@ -1458,7 +1753,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_pipeline_library_Serialize(d3d12_pipeline
                 header->driver_cache_count, driver_cache_size);
     }
 
-    rwlock_unlock_read(&pipeline_library->mutex);
+    sharded_rwlock_unlock_read(&pipeline_library->mutex);
     return S_OK;
 }
 
@@ -1521,6 +1816,9 @@ static HRESULT d3d12_pipeline_library_unserialize_hash_map(
     const uint8_t *name_table = *inout_name_table;
     uint32_t i;
 
+    if (entries_count > UINT32_MAX || !hash_map_reserve(map, entries_count))
+        return E_OUTOFMEMORY;
+
     /* The application is not allowed to free the blob, so we
      * can safely use pointers without copying the data first. */
     for (i = 0; i < entries_count; i++)
@@ -1671,8 +1969,9 @@ static HRESULT d3d12_pipeline_library_read_blob(struct d3d12_pipeline_library *p
     return S_OK;
 }
 
+/* Internal libraries do not hold a device reference, since the device owns them. */
 static HRESULT d3d12_pipeline_library_init(struct d3d12_pipeline_library *pipeline_library,
-        struct d3d12_device *device, const void *blob, size_t blob_length)
+        struct d3d12_device *device, const void *blob, size_t blob_length, bool internal)
 {
     HRESULT hr;
     int rc;
@@ -1684,7 +1983,7 @@ static HRESULT d3d12_pipeline_library_init(struct d3d12_pipeline_library *pipeli
     if (!blob_length && blob)
         return E_INVALIDARG;
 
-    if ((rc = rwlock_init(&pipeline_library->mutex)))
+    if ((rc = sharded_rwlock_init(&pipeline_library->mutex)))
         return hresult_from_errno(rc);
 
     hash_map_init(&pipeline_library->spirv_cache_map, vkd3d_cached_pipeline_hash_internal,
@@ -1717,7 +2016,9 @@ static HRESULT d3d12_pipeline_library_init(struct d3d12_pipeline_library *pipeli
     if (FAILED(hr = vkd3d_private_store_init(&pipeline_library->private_store)))
         goto cleanup_mutex;
 
-    d3d12_device_add_ref(pipeline_library->device = device);
+    pipeline_library->device = device;
+    if (!internal)
+        d3d12_device_add_ref(device);
     return hr;
 
 cleanup_hash_map:
@@ -1725,7 +2026,7 @@ cleanup_hash_map:
     hash_map_clear(&pipeline_library->spirv_cache_map);
     hash_map_clear(&pipeline_library->driver_cache_map);
 cleanup_mutex:
-    rwlock_destroy(&pipeline_library->mutex);
+    sharded_rwlock_destroy(&pipeline_library->mutex);
     return hr;
 }
 
@@ -1738,7 +2039,7 @@ HRESULT d3d12_pipeline_library_create(struct d3d12_device *device, const void *b
     if (!(object = vkd3d_malloc(sizeof(*object))))
         return E_OUTOFMEMORY;
 
-    if (FAILED(hr = d3d12_pipeline_library_init(object, device, blob, blob_length)))
+    if (FAILED(hr = d3d12_pipeline_library_init(object, device, blob, blob_length, false)))
     {
         vkd3d_free(object);
         return hr;
@@ -1892,3 +2193,1012 @@ void vkd3d_pipeline_cache_compat_from_state_desc(struct vkd3d_pipeline_cache_com
         }
     }
 }
+
+/* Seconds to wait after the first new entry before writing the disk cache,
+ * so that bursts of PSO creation end up in a single write. */
+#define VKD3D_DISK_CACHE_WRITE_DELAY_SECONDS 10
+#define VKD3D_DISK_CACHE_DEFAULT_MAX_SIZE_MB 512
+
+static void vkd3d_disk_cache_write(struct vkd3d_disk_cache *cache)
+{
+    d3d12_pipeline_library_iface *iface = &cache->library->ID3D12PipelineLibrary_iface;
+    char tmp_path[VKD3D_PATH_MAX];
+    size_t size, written;
+    void *data;
+    FILE *file;
+
+    size = d3d12_pipeline_library_GetSerializedSize(iface);
+
+    if (!(data = vkd3d_malloc(size)))
+    {
+        ERR("Failed to allocate %zu bytes for disk cache.\n", size);
+        return;
+    }
+
+    if (FAILED(d3d12_pipeline_library_Serialize(iface, data, size)))
+    {
+        ERR("Failed to serialize disk cache.\n");
+        vkd3d_free(data);
+        return;
+    }
+
+    /* Write to a temporary file first, so that a crash cannot leave a truncated cache behind. */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache->path);
+
+    if (!(file = fopen(tmp_path, "wb")))
+    {
+        WARN("Failed to open %s for writing.\n", tmp_path);
+        vkd3d_free(data);
+        return;
+    }
+
+    written = fwrite(data, 1, size, file);
+    fclose(file);
+    vkd3d_free(data);
+
+    if (written != size)
+    {
+        WARN("Failed to write disk cache to %s.\n", tmp_path);
+        remove(tmp_path);
+        return;
+    }
+
+    /* rename() does not replace existing files on Windows. */
+    if (rename(tmp_path, cache->path))
+    {
+        remove(cache->path);
+        if (rename(tmp_path, cache->path))
+        {
+            WARN("Failed to replace disk cache %s.\n", cache->path);
+            remove(tmp_path);
+            return;
+        }
+    }
+
+    TRACE("Wrote %zu bytes to disk cache %s.\n", size, cache->path);
+}
+
+static void *vkd3d_disk_cache_main(void *arg)
+{
+    struct vkd3d_disk_cache *cache = arg;
+    bool dirty;
+
+    vkd3d_set_thread_name("vkd3d_cache");
+
+    pthread_mutex_lock(&cache->mutex);
+
+    while (!cache->should_exit)
+    {
+        if (!cache->dirty)
+        {
+            condvar_reltime_wait_timeout_seconds(&cache->cond, &cache->mutex, VKD3D_DISK_CACHE_WRITE_DELAY_SECONDS);
+            continue;
+        }
+
+        /* Give the application some time to create more pipelines before writing. */
+        condvar_reltime_wait_timeout_seconds(&cache->cond, &cache->mutex, VKD3D_DISK_CACHE_WRITE_DELAY_SECONDS);
+
+        dirty = cache->dirty;
+        cache->dirty = false;
+        pthread_mutex_unlock(&cache->mutex);
+
+        if (dirty)
+            vkd3d_disk_cache_write(cache);
+
+        pthread_mutex_lock(&cache->mutex);
+    }
+
+    dirty = cache->dirty;
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (dirty)
+        vkd3d_disk_cache_write(cache);
+
+    return NULL;
+}
+
+#ifndef _WIN32
+static bool vkd3d_disk_cache_map_file(struct vkd3d_disk_cache *cache)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    if ((fd = open(cache->path, O_RDONLY)) < 0)
+        return false;
+
+    if (fstat(fd, &st) || st.st_size <= 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    /* Once the cache fills up, start over so that only pipelines
+     * the application still uses end up in the next file. */
+    if ((uint64_t)st.st_size >= cache->max_size)
+    {
+        INFO("Disk cache %s exceeds %"PRIu64" bytes, discarding.\n", cache->path, cache->max_size);
+        close(fd);
+        return false;
+    }
+
+    /* Pipeline library entries point straight into the mapping, so only the
+     * pages of pipelines which are actually looked up are ever read in.
+     * Writes replace the file through rename(), which leaves this mapping intact. */
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        WARN("Failed to map disk cache %s, errno %d.\n", cache->path, errno);
+        return false;
+    }
+
+    cache->file_data = data;
+    cache->file_size = st.st_size;
+    return true;
+}
+
+static void vkd3d_disk_cache_unmap_file(struct vkd3d_disk_cache *cache)
+{
+    if (cache->file_data)
+        munmap(cache->file_data, cache->file_size);
+    cache->file_data = NULL;
+    cache->file_size = 0;
+}
+#else
+/* On Windows, a mapped file cannot be replaced while the mapping
+ * is alive, so read the file into memory instead. */
+static bool vkd3d_disk_cache_map_file(struct vkd3d_disk_cache *cache)
+{
+    long file_size;
+    FILE *file;
+
+    if (!(file = fopen(cache->path, "rb")))
+        return false;
+
+    if (fseek(file, 0, SEEK_END) || (file_size = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET))
+    {
+        fclose(file);
+        return false;
+    }
+
+    if ((uint64_t)file_size >= cache->max_size)
+    {
+        INFO("Disk cache %s exceeds %"PRIu64" bytes, discarding.\n", cache->path, cache->max_size);
+        fclose(file);
+        return false;
+    }
+
+    if (!(cache->file_data = vkd3d_malloc(file_size)))
+    {
+        fclose(file);
+        return false;
+    }
+
+    if (fread(cache->file_data, 1, file_size, file) != (size_t)file_size)
+    {
+        WARN("Failed to read disk cache %s.\n", cache->path);
+        vkd3d_free(cache->file_data);
+        cache->file_data = NULL;
+        fclose(file);
+        return false;
+    }
+
+    fclose(file);
+    cache->file_size = file_size;
+    return true;
+}
+
+static void vkd3d_disk_cache_unmap_file(struct vkd3d_disk_cache *cache)
+{
+    vkd3d_free(cache->file_data);
+    cache->file_data = NULL;
+    cache->file_size = 0;
+}
+#endif
+
+void vkd3d_disk_cache_init(struct vkd3d_disk_cache *cache, struct d3d12_device *device)
+{
+    const char *path, *env;
+    HRESULT hr;
+    int rc;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if (!(path = getenv("VKD3D_SHADER_CACHE_PATH")) || !*path || !strcmp(path, "0"))
+        return;
+
+    cache->max_size = VKD3D_DISK_CACHE_DEFAULT_MAX_SIZE_MB;
+    if ((env = getenv("VKD3D_SHADER_CACHE_MAX_SIZE_MB")))
+        cache->max_size = strtoull(env, NULL, 0);
+    cache->max_size *= 1024 * 1024;
+
+    if (!cache->max_size)
+        return;
+
+    if (snprintf(cache->path, sizeof(cache->path), "%s/vkd3d-proton.cache", path) >= (int)sizeof(cache->path))
+    {
+        WARN("Disk cache path %s is too long.\n", path);
+        return;
+    }
+
+    if (!(cache->library = vkd3d_malloc(sizeof(*cache->library))))
+        return;
+
+    hr = E_FAIL;
+    if (vkd3d_disk_cache_map_file(cache))
+    {
+        if (FAILED(hr = d3d12_pipeline_library_init(cache->library, device,
+                cache->file_data, cache->file_size, true)))
+            INFO("Disk cache %s does not match current device or build, hr %#x.\n", cache->path, hr);
+    }
+
+    if (FAILED(hr))
+    {
+        vkd3d_disk_cache_unmap_file(cache);
+
+        if (FAILED(hr = d3d12_pipeline_library_init(cache->library, device, NULL, 0, true)))
+            goto fail_library;
+    }
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        goto fail_mutex;
+    }
+
+    if ((rc = condvar_reltime_init(&cache->cond)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        goto fail_cond;
+    }
+
+    if (FAILED(vkd3d_create_thread(device->vkd3d_instance, vkd3d_disk_cache_main, cache, &cache->thread)))
+        goto fail_thread;
+
+    INFO("Using disk cache %s (%zu bytes loaded).\n", cache->path, cache->file_size);
+    return;
+
+fail_thread:
+    condvar_reltime_destroy(&cache->cond);
+fail_cond:
+    pthread_mutex_destroy(&cache->mutex);
+fail_mutex:
+    d3d12_pipeline_library_cleanup(cache->library, device);
+fail_library:
+    vkd3d_free(cache->library);
+    vkd3d_disk_cache_unmap_file(cache);
+    cache->library = NULL;
+}
+
+void vkd3d_disk_cache_cleanup(struct vkd3d_disk_cache *cache, struct d3d12_device *device)
+{
+    if (!vkd3d_disk_cache_is_active(cache))
+        return;
+
+    /* The thread flushes any pending entries before exiting. */
+    pthread_mutex_lock(&cache->mutex);
+    cache->should_exit = true;
+    condvar_reltime_signal(&cache->cond);
+    pthread_mutex_unlock(&cache->mutex);
+
+    vkd3d_join_thread(device->vkd3d_instance, &cache->thread);
+
+    condvar_reltime_destroy(&cache->cond);
+    pthread_mutex_destroy(&cache->mutex);
+
+    d3d12_pipeline_library_cleanup(cache->library, device);
+    vkd3d_free(cache->library);
+    vkd3d_disk_cache_unmap_file(cache);
+    cache->library = NULL;
+}
+
+static void vkd3d_disk_cache_get_pipeline_name(const struct vkd3d_pipeline_cache_compatibility *compat,
+        WCHAR name[17])
+{
+    uint64_t hash = hash_fnv1_init();
+    unsigned int i;
+
+    hash = hash_fnv1_iterate_u64(hash, compat->state_desc_compat_hash);
+    hash = hash_fnv1_iterate_u64(hash, compat->root_signature_compat_hash);
+    for (i = 0; i < ARRAY_SIZE(compat->dxbc_blob_hashes); i++)
+        hash = hash_fnv1_iterate_u64(hash, compat->dxbc_blob_hashes[i]);
+
+    for (i = 0; i < 16; i++)
+        name[i] = "0123456789abcdef"[(hash >> (60 - 4 * i)) & 0xf];
+    name[16] = 0;
+}
+
+bool vkd3d_disk_cache_find_pipeline(struct vkd3d_disk_cache *cache,
+        const struct vkd3d_pipeline_cache_compatibility *compat, struct d3d12_cached_pipeline_state *cached_state)
+{
+    struct d3d12_pipeline_library *library = cache->library;
+    const struct vkd3d_cached_pipeline_entry *e;
+    struct vkd3d_cached_pipeline_key key;
+    WCHAR name[17];
+
+    if (!vkd3d_disk_cache_is_active(cache))
+        return false;
+
+    vkd3d_disk_cache_get_pipeline_name(compat, name);
+    key.name_length = 16 * sizeof(WCHAR);
+    key.name = name;
+    key.internal_key_hash = 0;
+
+    sharded_rwlock_lock_read(&library->mutex);
+    if ((e = (const struct vkd3d_cached_pipeline_entry *)hash_map_find(&library->pso_map, &key)))
+    {
+        /* Blobs are never freed while the library is alive. */
+        cached_state->blob.CachedBlobSizeInBytes = e->data.blob_length;
+        cached_state->blob.pCachedBlob = e->data.blob;
+        cached_state->library = library;
+    }
+    sharded_rwlock_unlock_read(&library->mutex);
+
+    return !!e;
+}
+
+static void vkd3d_disk_cache_mark_dirty(struct vkd3d_disk_cache *cache)
+{
+    /* Only wake the thread for the first new entry, it then batches up the rest. */
+    pthread_mutex_lock(&cache->mutex);
+    if (!cache->dirty)
+    {
+        cache->dirty = true;
+        condvar_reltime_signal(&cache->cond);
+    }
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void vkd3d_disk_cache_store_pipeline(struct vkd3d_disk_cache *cache, struct d3d12_pipeline_state *state)
+{
+    struct d3d12_pipeline_library *library = cache->library;
+    WCHAR name[17];
+    size_t size;
+
+    if (!vkd3d_disk_cache_is_active(cache))
+        return;
+
+    sharded_rwlock_lock_read(&library->mutex);
+    size = d3d12_pipeline_library_get_serialized_size(library);
+    sharded_rwlock_unlock_read(&library->mutex);
+
+    if (size >= cache->max_size)
+        return;
+
+    vkd3d_disk_cache_get_pipeline_name(&state->pipeline_cache_compat, name);
+
+    /* Fails harmlessly if another thread stored the same pipeline first. */
+    if (FAILED(d3d12_pipeline_library_StorePipeline(&library->ID3D12PipelineLibrary_iface,
+            name, &state->ID3D12PipelineState_iface)))
+        return;
+
+    vkd3d_disk_cache_mark_dirty(cache);
+}
+
+/* Pipeline warm-up log. Every pipeline description created while the disk cache is active is
+ * recorded into the disk cache library under its own name, and replayed on a background
+ * thread at the next device creation. Records are self-contained: root signature and shader
+ * blobs are stored inline, and pointers in the description are replaced by offsets. */
+#define VKD3D_PIPELINE_WARMUP_RECORD_VERSION MAKE_MAGIC('V','K','W',1)
+#define VKD3D_PIPELINE_WARMUP_MAX_VIEW_INSTANCES 4
+#define VKD3D_PIPELINE_WARMUP_NAME_LENGTH 17
+
+enum vkd3d_pipeline_warmup_blob
+{
+    VKD3D_PIPELINE_WARMUP_BLOB_ROOT_SIGNATURE = 0,
+    VKD3D_PIPELINE_WARMUP_BLOB_VS,
+    VKD3D_PIPELINE_WARMUP_BLOB_PS,
+    VKD3D_PIPELINE_WARMUP_BLOB_DS,
+    VKD3D_PIPELINE_WARMUP_BLOB_HS,
+    VKD3D_PIPELINE_WARMUP_BLOB_GS,
+    VKD3D_PIPELINE_WARMUP_BLOB_CS,
+    VKD3D_PIPELINE_WARMUP_BLOB_COUNT
+};
+
+struct vkd3d_pipeline_warmup_input_element
+{
+    uint32_t semantic_name_offset;
+    uint32_t semantic_index;
+    uint32_t format;
+    uint32_t input_slot;
+    uint32_t aligned_byte_offset;
+    uint32_t input_slot_class;
+    uint32_t instance_data_step_rate;
+};
+
+struct vkd3d_pipeline_warmup_so_entry
+{
+    uint32_t stream;
+    uint32_t semantic_name_offset; /* UINT32_MAX for gaps. */
+    uint32_t semantic_index;
+    uint32_t start_component;
+    uint32_t component_count;
+    uint32_t output_slot;
+};
+
+struct vkd3d_pipeline_warmup_record
+{
+    uint32_t version;
+    uint32_t bind_point;
+    uint32_t blob_sizes[VKD3D_PIPELINE_WARMUP_BLOB_COUNT];
+    uint32_t input_element_count;
+    uint32_t so_entry_count;
+    uint32_t so_stride_count;
+    uint32_t so_rasterized_stream;
+    uint32_t string_table_size;
+    uint32_t sample_mask;
+    uint32_t strip_cut_value;
+    uint32_t primitive_topology_type;
+    uint32_t dsv_format;
+    uint32_t node_mask;
+    uint32_t flags;
+    uint32_t view_instance_count;
+    uint32_t view_instancing_flags;
+    D3D12_VIEW_INSTANCE_LOCATION view_instance_locations[VKD3D_PIPELINE_WARMUP_MAX_VIEW_INSTANCES];
+    D3D12_BLEND_DESC blend_state;
+    D3D12_RASTERIZER_DESC rasterizer_state;
+    D3D12_DEPTH_STENCIL_DESC1 depth_stencil_state;
+    D3D12_RT_FORMAT_ARRAY rtv_formats;
+    DXGI_SAMPLE_DESC sample_desc;
+    /* Blobs in vkd3d_pipeline_warmup_blob order, input elements, stream output
+     * entries, stream output strides and the string table, each 4 byte aligned. */
+    uint8_t data[];
+};
+
+static VKD3D_THREAD_LOCAL struct vkd3d_pipeline_warmup *vkd3d_pipeline_warmup_current;
+
+static void vkd3d_pipeline_warmup_get_name(const struct vkd3d_pipeline_cache_compatibility *compat,
+        WCHAR name[VKD3D_PIPELINE_WARMUP_NAME_LENGTH + 1])
+{
+    /* Distinct from pipeline names, which are plain 16 digit hashes. */
+    name[0] = 'W';
+    vkd3d_disk_cache_get_pipeline_name(compat, name + 1);
+}
+
+static void vkd3d_pipeline_warmup_get_blobs(const struct d3d12_pipeline_state_desc *desc,
+        const void **blobs, size_t *sizes)
+{
+    const struct d3d12_root_signature *root_signature = NULL;
+
+    if (desc->root_signature)
+        root_signature = impl_from_ID3D12RootSignature(desc->root_signature);
+
+    blobs[VKD3D_PIPELINE_WARMUP_BLOB_ROOT_SIGNATURE] = root_signature ? root_signature->blob : NULL;
+    sizes[VKD3D_PIPELINE_WARMUP_BLOB_ROOT_SIGNATURE] = root_signature ? root_signature->blob_size : 0;
+#define VKD3D_WARMUP_SHADER(stage, member) \
+    blobs[VKD3D_PIPELINE_WARMUP_BLOB_##stage] = desc->member.pShaderBytecode; \
+    sizes[VKD3D_PIPELINE_WARMUP_BLOB_##stage] = desc->member.BytecodeLength
+    VKD3D_WARMUP_SHADER(VS, vs);
+    VKD3D_WARMUP_SHADER(PS, ps);
+    VKD3D_WARMUP_SHADER(DS, ds);
+    VKD3D_WARMUP_SHADER(HS, hs);
+    VKD3D_WARMUP_SHADER(GS, gs);
+    VKD3D_WARMUP_SHADER(CS, cs);
+#undef VKD3D_WARMUP_SHADER
+}
+
+static uint8_t *vkd3d_pipeline_warmup_write(uint8_t *ptr, const void *data, size_t size)
+{
+    size_t aligned_size = align(size, sizeof(uint32_t));
+
+    if (size)
+        memcpy(ptr, data, size);
+    memset(ptr + size, 0, aligned_size - size);
+    return ptr + aligned_size;
+}
+
+static uint32_t vkd3d_pipeline_warmup_add_string(char *string_table, uint32_t *offset, const char *str)
+{
+    uint32_t str_offset = *offset;
+    size_t length = strlen(str) + 1;
+
+    memcpy(string_table + str_offset, str, length);
+    *offset += length;
+    return str_offset;
+}
+
+static void *vkd3d_pipeline_warmup_create_record(VkPipelineBindPoint bind_point,
+        const struct d3d12_pipeline_state_desc *desc, size_t *out_size)
+{
+    const D3D12_STREAM_OUTPUT_DESC *so_desc = &desc->stream_output;
+    const D3D12_INPUT_LAYOUT_DESC *il_desc = &desc->input_layout;
+    struct vkd3d_pipeline_warmup_input_element *input_elements;
+    const void *blobs[VKD3D_PIPELINE_WARMUP_BLOB_COUNT];
+    struct vkd3d_pipeline_warmup_so_entry *so_entries;
+    size_t sizes[VKD3D_PIPELINE_WARMUP_BLOB_COUNT];
+    struct vkd3d_pipeline_warmup_record *record;
+    uint32_t string_offset = 0;
+    size_t string_table_size;
+    char *string_table;
+    size_t total_size;
+    unsigned int i;
+    uint8_t *ptr;
+
+    if (desc->view_instancing_desc.ViewInstanceCount > VKD3D_PIPELINE_WARMUP_MAX_VIEW_INSTANCES)
+        return NULL;
+
+    vkd3d_pipeline_warmup_get_blobs(desc, blobs, sizes);
+
+    string_table_size = 0;
+    for (i = 0; i < il_desc->NumElements; i++)
+        string_table_size += strlen(il_desc->pInputElementDescs[i].SemanticName) + 1;
+    for (i = 0; i < so_desc->NumEntries; i++)
+    {
+        if (so_desc->pSODeclaration[i].SemanticName)
+            string_table_size += strlen(so_desc->pSODeclaration[i].SemanticName) + 1;
+    }
+
+    total_size = sizeof(*record);
+    for (i = 0; i < VKD3D_PIPELINE_WARMUP_BLOB_COUNT; i++)
+    {
+        if (sizes[i] > UINT32_MAX)
+            return NULL;
+        total_size += align(sizes[i], sizeof(uint32_t));
+    }
+    total_size += il_desc->NumElements * sizeof(*input_elements);
+    total_size += so_desc->NumEntries * sizeof(*so_entries);
+    total_size += so_desc->NumStrides * sizeof(uint32_t);
+    total_size += align(string_table_size, sizeof(uint32_t));
+
+    if (!(record = vkd3d_calloc(1, total_size)))
+        return NULL;
+
+    record->version = VKD3D_PIPELINE_WARMUP_RECORD_VERSION;
+    record->bind_point = bind_point;
+    for (i = 0; i < VKD3D_PIPELINE_WARMUP_BLOB_COUNT; i++)
+        record->blob_sizes[i] = sizes[i];
+    record->input_element_count = il_desc->NumElements;
+    record->so_entry_count = so_desc->NumEntries;
+    record->so_stride_count = so_desc->NumStrides;
+    record->so_rasterized_stream = so_desc->RasterizedStream;
+    record->string_table_size = string_table_size;
+    record->sample_mask = desc->sample_mask;
+    record->strip_cut_value = desc->strip_cut_value;
+    record->primitive_topology_type = desc->primitive_topology_type;
+    record->dsv_format = desc->dsv_format;
+    record->node_mask = desc->node_mask;
+    record->flags = desc->flags;
+    record->view_instance_count = desc->view_instancing_desc.ViewInstanceCount;
+    record->view_instancing_flags = desc->view_instancing_desc.Flags;
+    for (i = 0; i < desc->view_instancing_desc.ViewInstanceCount; i++)
+        record->view_instance_locations[i] = desc->view_instancing_desc.pViewInstanceLocations[i];
+    record->blend_state = desc->blend_state;
+    record->rasterizer_state = desc->rasterizer_state;
+    record->depth_stencil_state = desc->depth_stencil_state;
+    record->rtv_formats = desc->rtv_formats;
+    record->sample_desc = desc->sample_desc;
+
+    ptr = record->data;
+    for (i = 0; i < VKD3D_PIPELINE_WARMUP_BLOB_COUNT; i++)
+        ptr = vkd3d_pipeline_warmup_write(ptr, blobs[i], sizes[i]);
+
+    input_elements = (struct vkd3d_pipeline_warmup_input_element *)ptr;
+    ptr += il_desc->NumElements * sizeof(*input_elements);
+    so_entries = (struct vkd3d_pipeline_warmup_so_entry *)ptr;
+    ptr += so_desc->NumEntries * sizeof(*so_entries);
+    ptr = vkd3d_pipeline_warmup_write(ptr, so_desc->pBufferStrides, so_desc->NumStrides * sizeof(uint32_t));
+    string_table = (char *)ptr;
+
+    for (i = 0; i < il_desc->NumElements; i++)
+    {
+        const D3D12_INPUT_ELEMENT_DESC *e = &il_desc->pInputElementDescs[i];
+        input_elements[i].semantic_name_offset = vkd3d_pipeline_warmup_add_string(string_table,
+                &string_offset, e->SemanticName);
+        input_elements[i].semantic_index = e->SemanticIndex;
+        input_elements[i].format = e->Format;
+        input_elements[i].input_slot = e->InputSlot;
+        input_elements[i].aligned_byte_offset = e->AlignedByteOffset;
+        input_elements[i].input_slot_class = e->InputSlotClass;
+        input_elements[i].instance_data_step_rate = e->InstanceDataStepRate;
+    }
+
+    for (i = 0; i < so_desc->NumEntries; i++)
+    {
+        const D3D12_SO_DECLARATION_ENTRY *e = &so_desc->pSODeclaration[i];
+        so_entries[i].stream = e->Stream;
+        so_entries[i].semantic_name_offset = e->SemanticName ?
+                vkd3d_pipeline_warmup_add_string(string_table, &string_offset, e->SemanticName) : UINT32_MAX;
+        so_entries[i].semantic_index = e->SemanticIndex;
+        so_entries[i].start_component = e->StartComponent;
+        so_entries[i].component_count = e->ComponentCount;
+        so_entries[i].output_slot = e->OutputSlot;
+    }
+
+    *out_size = total_size;
+    return record;
+}
+
+struct vkd3d_pipeline_warmup_desc
+{
+    VkPipelineBindPoint bind_point;
+    const void *root_signature_blob;
+    size_t root_signature_size;
+    struct d3d12_pipeline_state_desc desc;
+    D3D12_VIEW_INSTANCE_LOCATION view_instance_locations[VKD3D_PIPELINE_WARMUP_MAX_VIEW_INSTANCES];
+    D3D12_INPUT_ELEMENT_DESC *input_elements;
+    D3D12_SO_DECLARATION_ENTRY *so_entries;
+};
+
+static const void *vkd3d_pipeline_warmup_read(const uint8_t **ptr, const uint8_t *end, size_t size)
+{
+    const uint8_t *data = *ptr;
+
+    if ((size_t)(end - data) < size)
+        return NULL;
+
+    *ptr += min(align(size, sizeof(uint32_t)), (size_t)(end - data));
+    return data;
+}
+
+static const char *vkd3d_pipeline_warmup_get_string(const char *string_table, uint32_t size, uint32_t offset)
+{
+    return offset < size ? &string_table[offset] : NULL;
+}
+
+static bool vkd3d_pipeline_warmup_parse_record(struct vkd3d_pipeline_warmup_desc *warmup_desc,
+        const void *blob, size_t blob_size)
+{
+    const struct vkd3d_pipeline_warmup_input_element *input_elements;
+    const struct vkd3d_pipeline_warmup_so_entry *so_entries;
+    const struct vkd3d_pipeline_warmup_record *record = blob;
+    struct d3d12_pipeline_state_desc *desc = &warmup_desc->desc;
+    const void *blobs[VKD3D_PIPELINE_WARMUP_BLOB_COUNT];
+    const uint8_t *end = (const uint8_t *)blob + blob_size;
+    const char *string_table;
+    const uint32_t *strides;
+    const uint8_t *ptr;
+    unsigned int i;
+
+    memset(warmup_desc, 0, sizeof(*warmup_desc));
+
+    if (blob_size < sizeof(*record) || record->version != VKD3D_PIPELINE_WARMUP_RECORD_VERSION)
+        return false;
+
+    if (record->bind_point != VK_PIPELINE_BIND_POINT_GRAPHICS && record->bind_point != VK_PIPELINE_BIND_POINT_COMPUTE)
+        return false;
+
+    if (record->view_instance_count > VKD3D_PIPELINE_WARMUP_MAX_VIEW_INSTANCES)
+        return false;
+
+    ptr = record->data;
+    for (i = 0; i < VKD3D_PIPELINE_WARMUP_BLOB_COUNT; i++)
+    {
+        if (!(blobs[i] = vkd3d_pipeline_warmup_read(&ptr, end, record->blob_sizes[i])))
+            return false;
+    }
+
+    if (!(input_elements = vkd3d_pipeline_warmup_read(&ptr, end,
+            (size_t)record->input_element_count * sizeof(*input_elements))) ||
+            !(so_entries = vkd3d_pipeline_warmup_read(&ptr, end,
+            (size_t)record->so_entry_count * sizeof(*so_entries))) ||
+            !(strides = vkd3d_pipeline_warmup_read(&ptr, end,
+            (size_t)record->so_stride_count * sizeof(*strides))) ||
+            !(string_table = vkd3d_pipeline_warmup_read(&ptr, end, record->string_table_size)))
+        return false;
+
+    /* Ensures that every string offset inside the table is terminated. */
+    if (record->string_table_size && string_table[record->string_table_size - 1])
+        return false;
+
+    warmup_desc->bind_point = record->bind_point;
+    warmup_desc->root_signature_blob = blobs[VKD3D_PIPELINE_WARMUP_BLOB_ROOT_SIGNATURE];
+    warmup_desc->root_signature_size = record->blob_sizes[VKD3D_PIPELINE_WARMUP_BLOB_ROOT_SIGNATURE];
+
+#define VKD3D_WARMUP_SHADER(stage, member) \
+    desc->member.pShaderBytecode = record->blob_sizes[VKD3D_PIPELINE_WARMUP_BLOB_##stage] ? \
+            blobs[VKD3D_PIPELINE_WARMUP_BLOB_##stage] : NULL; \
+    desc->member.BytecodeLength = record->blob_sizes[VKD3D_PIPELINE_WARMUP_BLOB_##stage]
+    VKD3D_WARMUP_SHADER(VS, vs);
+    VKD3D_WARMUP_SHADER(PS, ps);
+    VKD3D_WARMUP_SHADER(DS, ds);
+    VKD3D_WARMUP_SHADER(HS, hs);
+    VKD3D_WARMUP_SHADER(GS, gs);
+    VKD3D_WARMUP_SHADER(CS, cs);
+#undef VKD3D_WARMUP_SHADER
+
+    if (record->input_element_count)
+    {
+        if (!(warmup_desc->input_elements = vkd3d_calloc(record->input_element_count,
+                sizeof(*warmup_desc->input_elements))))
+            return false;
+
+        for (i = 0; i < record->input_element_count; i++)
+        {
+            D3D12_INPUT_ELEMENT_DESC *e = &warmup_desc->input_elements[i];
+
+            if (!(e->SemanticName = vkd3d_pipeline_warmup_get_string(string_table,
+                    record->string_table_size, input_elements[i].semantic_name_offset)))
+                return false;
+            e->SemanticIndex = input_elements[i].semantic_index;
+            e->Format = input_elements[i].format;
+            e->InputSlot = input_elements[i].input_slot;
+            e->AlignedByteOffset = input_elements[i].aligned_byte_offset;
+            e->InputSlotClass = input_elements[i].input_slot_class;
+            e->InstanceDataStepRate = input_elements[i].instance_data_step_rate;
+        }
+    }
+
+    if (record->so_entry_count)
+    {
+        if (!(warmup_desc->so_entries = vkd3d_calloc(record->so_entry_count, sizeof(*warmup_desc->so_entries))))
+            return false;
+
+        for (i = 0; i < record->so_entry_count; i++)
+        {
+            D3D12_SO_DECLARATION_ENTRY *e = &warmup_desc->so_entries[i];
+
+            e->Stream = so_entries[i].stream;
+            if (so_entries[i].semantic_name_offset != UINT32_MAX &&
+                    !(e->SemanticName = vkd3d_pipeline_warmup_get_string(string_table,
+                    record->string_table_size, so_entries[i].semantic_name_offset)))
+                return false;
+            e->SemanticIndex = so_entries[i].semantic_index;
+            e->StartComponent = so_entries[i].start_component;
+            e->ComponentCount = so_entries[i].component_count;
+            e->OutputSlot = so_entries[i].output_slot;
+        }
+    }
+
+    desc->input_layout.pInputElementDescs = warmup_desc->input_elements;
+    desc->input_layout.NumElements = record->input_element_count;
+    desc->stream_output.pSODeclaration = warmup_desc->so_entries;
+    desc->stream_output.NumEntries = record->so_entry_count;
+    desc->stream_output.pBufferStrides = record->so_stride_count ? strides : NULL;
+    desc->stream_output.NumStrides = record->so_stride_count;
+    desc->stream_output.RasterizedStream = record->so_rasterized_stream;
+    desc->sample_mask = record->sample_mask;
+    desc->strip_cut_value = record->strip_cut_value;
+    desc->primitive_topology_type = record->primitive_topology_type;
+    desc->dsv_format = record->dsv_format;
+    desc->node_mask = record->node_mask;
+    desc->flags = record->flags;
+    memcpy(warmup_desc->view_instance_locations, record->view_instance_locations,
+            sizeof(warmup_desc->view_instance_locations));
+    desc->view_instancing_desc.ViewInstanceCount = record->view_instance_count;
+    desc->view_instancing_desc.pViewInstanceLocations = warmup_desc->view_instance_locations;
+    desc->view_instancing_desc.Flags = record->view_instancing_flags;
+    desc->blend_state = record->blend_state;
+    desc->rasterizer_state = record->rasterizer_state;
+    desc->depth_stencil_state = record->depth_stencil_state;
+    desc->rtv_formats = record->rtv_formats;
+    desc->sample_desc = record->sample_desc;
+    return true;
+}
+
+static void vkd3d_pipeline_warmup_desc_cleanup(struct vkd3d_pipeline_warmup_desc *warmup_desc)
+{
+    vkd3d_free(warmup_desc->input_elements);
+    vkd3d_free(warmup_desc->so_entries);
+}
+
+void vkd3d_pipeline_warmup_record(struct vkd3d_disk_cache *cache, VkPipelineBindPoint bind_point,
+        const struct d3d12_pipeline_state_desc *desc, const struct vkd3d_pipeline_cache_compatibility *compat)
+{
+    struct d3d12_pipeline_library *library = cache->library;
+    WCHAR name[VKD3D_PIPELINE_WARMUP_NAME_LENGTH + 1];
+    struct vkd3d_cached_pipeline_entry entry;
+    bool inserted = false;
+    size_t size;
+
+    if (!vkd3d_disk_cache_is_active(cache) || !(vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_WARMUP))
+        return;
+
+    /* Replayed pipelines are already in the log. */
+    if (vkd3d_pipeline_warmup_current)
+        return;
+
+    vkd3d_pipeline_warmup_get_name(compat, name);
+    entry.key.name_length = VKD3D_PIPELINE_WARMUP_NAME_LENGTH * sizeof(WCHAR);
+    entry.key.name = name;
+    entry.key.internal_key_hash = 0;
+
+    sharded_rwlock_lock_read(&library->mutex);
+    size = d3d12_pipeline_library_get_serialized_size(library);
+    inserted = hash_map_find(&library->pso_map, &entry.key) || size >= cache->max_size;
+    sharded_rwlock_unlock_read(&library->mutex);
+
+    if (inserted)
+        return;
+
+    if (!(entry.data.blob = vkd3d_pipeline_warmup_create_record(bind_point, desc, &entry.data.blob_length)))
+        return;
+
+    if (!(entry.key.name = vkd3d_malloc(entry.key.name_length)))
+    {
+        vkd3d_free((void *)entry.data.blob);
+        return;
+    }
+
+    memcpy((void *)entry.key.name, name, entry.key.name_length);
+    entry.data.is_new = 1;
+
+    sharded_rwlock_lock_write(&library->mutex);
+    inserted = d3d12_pipeline_library_insert_hash_map_blob(library, &library->pso_map, &entry);
+    sharded_rwlock_unlock_write(&library->mutex);
+
+    if (!inserted)
+    {
+        vkd3d_free((void *)entry.key.name);
+        vkd3d_free((void *)entry.data.blob);
+        return;
+    }
+
+    vkd3d_disk_cache_mark_dirty(cache);
+}
+
+static bool vkd3d_pipeline_warmup_try_add_device_ref(struct d3d12_device *device)
+{
+    uint32_t cur_refcount, cas_refcount;
+
+    /* Never resurrect a device which is already being destroyed. */
+    cur_refcount = vkd3d_atomic_uint32_load_explicit((uint32_t*)&device->refcount, vkd3d_memory_order_relaxed);
+
+    while (cur_refcount)
+    {
+        cas_refcount = vkd3d_atomic_uint32_compare_exchange((uint32_t*)&device->refcount, cur_refcount,
+                cur_refcount + 1, vkd3d_memory_order_acquire, vkd3d_memory_order_relaxed);
+
+        if (cas_refcount == cur_refcount)
+            return true;
+
+        cur_refcount = cas_refcount;
+    }
+
+    return false;
+}
+
+/* Returns false if the device is gone and the thread has to exit without touching it. */
+static bool vkd3d_pipeline_warmup_replay(struct vkd3d_pipeline_warmup *warmup, const void *blob, size_t size)
+{
+    struct d3d12_device *device = warmup->device;
+    struct vkd3d_pipeline_warmup_desc warmup_desc;
+    struct d3d12_root_signature *root_signature;
+    struct d3d12_pipeline_state *state;
+
+    /* Objects we create hold device references. Holding one of our own for the duration
+     * of the replay prevents those from being the last ones, and prevents the device
+     * from being resurrected if its destruction already started on another thread. */
+    if (!vkd3d_pipeline_warmup_try_add_device_ref(device))
+        return false;
+
+    root_signature = NULL;
+    state = NULL;
+
+    if (vkd3d_pipeline_warmup_parse_record(&warmup_desc, blob, size))
+    {
+        if (warmup_desc.root_signature_size)
+        {
+            if (SUCCEEDED(d3d12_root_signature_create(device, warmup_desc.root_signature_blob,
+                    warmup_desc.root_signature_size, &root_signature)))
+                warmup_desc.desc.root_signature = &root_signature->ID3D12RootSignature_iface;
+        }
+
+        if (!warmup_desc.root_signature_size || root_signature)
+            d3d12_pipeline_state_create(device, warmup_desc.bind_point, &warmup_desc.desc, &state);
+    }
+    else
+        WARN("Ignoring invalid pipeline warm-up record.\n");
+
+    vkd3d_pipeline_warmup_desc_cleanup(&warmup_desc);
+
+    if (state)
+        ID3D12PipelineState_Release(&state->ID3D12PipelineState_iface);
+    if (root_signature)
+        ID3D12RootSignature_Release(&root_signature->ID3D12RootSignature_iface);
+
+    /* If the application released the device in the meantime, this destroys it,
+     * and vkd3d_pipeline_warmup_stop() lets us know. */
+    d3d12_device_release(device);
+    return vkd3d_pipeline_warmup_current == warmup;
+}
+
+static void *vkd3d_pipeline_warmup_main(void *arg)
+{
+    struct vkd3d_pipeline_warmup *warmup = arg;
+    struct d3d12_pipeline_library *library;
+    const struct vkd3d_cached_pipeline_entry *e;
+    struct vkd3d_cached_pipeline_data *records;
+    size_t record_count, i;
+    uint32_t entry_index;
+
+    vkd3d_set_thread_name("vkd3d_warmup");
+    vkd3d_pipeline_warmup_current = warmup;
+
+    library = warmup->device->disk_cache.library;
+    records = NULL;
+    record_count = 0;
+
+    /* Blobs stay alive for as long as the library does, so only hold the lock while collecting them. */
+    sharded_rwlock_lock_read(&library->mutex);
+
+    if ((records = vkd3d_malloc(library->pso_map.used_count * sizeof(*records))))
+    {
+        for (entry_index = 0; entry_index < library->pso_map.entry_count; entry_index++)
+        {
+            e = (const struct vkd3d_cached_pipeline_entry *)hash_map_get_entry(&library->pso_map, entry_index);
+
+            if ((e->entry.flags & HASH_MAP_ENTRY_OCCUPIED) &&
+                    e->key.name_length == VKD3D_PIPELINE_WARMUP_NAME_LENGTH * sizeof(WCHAR) &&
+                    *(const WCHAR *)e->key.name == 'W')
+                records[record_count++] = e->data;
+        }
+    }
+
+    sharded_rwlock_unlock_read(&library->mutex);
+
+    vkd3d_atomic_uint32_store_explicit(&warmup->total_count, record_count, vkd3d_memory_order_relaxed);
+    INFO("Warming up %zu pipelines.\n", record_count);
+
+    for (i = 0; i < record_count; i++)
+    {
+        if (vkd3d_atomic_uint32_load_explicit(&warmup->should_exit, vkd3d_memory_order_relaxed))
+            break;
+
+        if (!vkd3d_pipeline_warmup_replay(warmup, records[i].blob, records[i].blob_length))
+        {
+            /* The device, possibly including this structure, is gone. */
+            vkd3d_pipeline_warmup_current = NULL;
+            vkd3d_free(records);
+            return NULL;
+        }
+
+        vkd3d_atomic_uint32_increment(&warmup->completed_count, vkd3d_memory_order_relaxed);
+    }
+
+    if (i == record_count)
+        INFO("Pipeline warm-up finished.\n");
+
+    vkd3d_pipeline_warmup_current = NULL;
+    vkd3d_free(records);
+    return NULL;
+}
+
+HRESULT vkd3d_pipeline_warmup_start(struct vkd3d_pipeline_warmup *warmup, struct d3d12_device *device)
+{
+    HRESULT hr;
+
+    memset(warmup, 0, sizeof(*warmup));
+
+    if (!vkd3d_disk_cache_is_active(&device->disk_cache) || !(vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_WARMUP))
+        return S_OK;
+
+    warmup->device = device;
+
+    if (FAILED(hr = vkd3d_create_thread(device->vkd3d_instance, vkd3d_pipeline_warmup_main, warmup, &warmup->thread)))
+        return hr;
+
+    warmup->active = true;
+    return S_OK;
+}
+
+void vkd3d_pipeline_warmup_stop(struct vkd3d_pipeline_warmup *warmup, struct d3d12_device *device)
+{
+    if (!warmup->active)
+        return;
+
+    warmup->active = false;
+
+    /* If the warm-up thread released the last device reference, it cannot join itself.
+     * It exits without touching the device once the release returns. */
+    if (vkd3d_pipeline_warmup_current == warmup)
+    {
+        vkd3d_pipeline_warmup_current = NULL;
+#ifndef _WIN32
+        if (!device->vkd3d_instance->join_thread)
+            pthread_detach(warmup->thread.pthread);
+#endif
+        return;
+    }
+
+    vkd3d_atomic_uint32_store_explicit(&warmup->should_exit, 1, vkd3d_memory_order_relaxed);
+    vkd3d_join_thread(device->vkd3d_instance, &warmup->thread);
+}
+
+void vkd3d_pipeline_warmup_get_progress(struct vkd3d_pipeline_warmup *warmup,
+        uint32_t *completed_count, uint32_t *total_count)
+{
+    *completed_count = vkd3d_atomic_uint32_load_explicit(&warmup->completed_count, vkd3d_memory_order_relaxed);
+    *total_count = vkd3d_atomic_uint32_load_explicit(&warmup->total_count, vkd3d_memory_order_relaxed);
+}
@@ -0,0 +1,1688 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_private.h"
+
+/* Deferred translation mode. Instead of translating D3D12 commands to Vulkan
+ * as they are recorded, command lists store them in a compact stream which is
+ * replayed on a translator thread once the list is closed. The stream uses
+ * the same command layout as bundles, and commands which bundles can record
+ * share their layouts and replay thunks.
+ *
+ * Everything a command reads from application memory must be captured at
+ * record time, including RTV and DSV descriptors which D3D12 consumes when
+ * the command is recorded. Commands which are not worth capturing flush the
+ * stream and are translated directly on the application thread, which keeps
+ * ordering intact since no translator thread touches the list before Close(). */
+
+static inline struct d3d12_command_list *impl_from_ID3D12GraphicsCommandList(d3d12_command_list_iface *iface)
+{
+    return CONTAINING_RECORD(iface, struct d3d12_command_list, ID3D12GraphicsCommandList_iface);
+}
+
+extern CONST_VTBL struct ID3D12GraphicsCommandList6Vtbl d3d12_command_list_vtbl;
+
+extern HRESULT STDMETHODCALLTYPE d3d12_command_list_QueryInterface(d3d12_command_list_iface *iface,
+        REFIID iid, void **object);
+extern ULONG STDMETHODCALLTYPE d3d12_command_list_AddRef(d3d12_command_list_iface *iface);
+extern ULONG STDMETHODCALLTYPE d3d12_command_list_Release(d3d12_command_list_iface *iface);
+extern HRESULT STDMETHODCALLTYPE d3d12_command_list_GetPrivateData(d3d12_command_list_iface *iface,
+        REFGUID guid, UINT *data_size, void *data);
+extern HRESULT STDMETHODCALLTYPE d3d12_command_list_SetPrivateData(d3d12_command_list_iface *iface,
+        REFGUID guid, UINT data_size, const void *data);
+extern HRESULT STDMETHODCALLTYPE d3d12_command_list_SetPrivateDataInterface(d3d12_command_list_iface *iface,
+        REFGUID guid, const IUnknown *data);
+extern HRESULT STDMETHODCALLTYPE d3d12_command_list_GetDevice(d3d12_command_list_iface *iface,
+        REFIID iid, void **device);
+extern D3D12_COMMAND_LIST_TYPE STDMETHODCALLTYPE d3d12_command_list_GetType(d3d12_command_list_iface *iface);
+
+static void *d3d12_command_list_deferred_stream_alloc(struct d3d12_command_list_deferred_stream *stream, size_t size)
+{
+    void *chunk;
+
+    size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
+
+    if (d3d12_bundle_chunk_needs_continuation(0, size))
+        return NULL;
+
+    if (!stream->chunks_used || d3d12_bundle_chunk_needs_continuation(stream->chunk_offset, size))
+    {
+        /* Chunks are kept around across Reset() so that steady state recording does not allocate. */
+        if (stream->chunks_used == stream->chunks_count)
+        {
+            if (!vkd3d_array_reserve((void **)&stream->chunks, &stream->chunks_size,
+                    stream->chunks_count + 1, sizeof(*stream->chunks)))
+                return NULL;
+
+            if (!(chunk = vkd3d_malloc(VKD3D_BUNDLE_CHUNK_SIZE)))
+                return NULL;
+
+            stream->chunks[stream->chunks_count++] = chunk;
+        }
+
+        /* Commands recorded so far continue in the new chunk. */
+        if (stream->chunks_used)
+        {
+            d3d12_bundle_chunk_terminate(stream->chunks[stream->chunks_used - 1],
+                    stream->chunk_offset, stream->chunks[stream->chunks_used]);
+        }
+
+        stream->chunks_used++;
+        stream->chunk_offset = 0;
+    }
+
+    chunk = void_ptr_offset(stream->chunks[stream->chunks_used - 1], stream->chunk_offset);
+    stream->chunk_offset += size;
+    return chunk;
+}
+
+void d3d12_command_list_deferred_stream_cleanup(struct d3d12_command_list_deferred_stream *stream)
+{
+    size_t i;
+
+    for (i = 0; i < stream->chunks_count; i++)
+        vkd3d_free(stream->chunks[i]);
+
+    vkd3d_free(stream->chunks);
+}
+
+void d3d12_command_list_flush_deferred_commands(struct d3d12_command_list *list)
+{
+    struct d3d12_command_list_deferred_stream *stream = &list->deferred;
+    const struct d3d12_bundle_command *command;
+
+    /* Replayed bundle thunks call back into the recording methods. */
+    if (stream->is_replaying)
+        return;
+
+    stream->is_replaying = true;
+
+    for (command = stream->head; command; command = command != stream->tail ? d3d12_bundle_command_next(command) : NULL)
+        command->proc(&list->ID3D12GraphicsCommandList_iface, command);
+
+    stream->is_replaying = false;
+    stream->head = NULL;
+    stream->tail = NULL;
+    stream->chunks_used = 0;
+    stream->chunk_offset = 0;
+}
+
+static void *d3d12_command_list_deferred_add_command(struct d3d12_command_list *list,
+        pfn_d3d12_bundle_command proc, size_t size)
+{
+    struct d3d12_command_list_deferred_stream *stream = &list->deferred;
+    struct d3d12_bundle_command *command;
+
+    /* Translate replayed commands directly rather than recording them again. */
+    if (stream->is_replaying)
+        return NULL;
+
+    if (!(command = d3d12_command_list_deferred_stream_alloc(stream, size)))
+    {
+        /* The caller translates the command directly, so everything before it must be translated first. */
+        d3d12_command_list_flush_deferred_commands(list);
+        return NULL;
+    }
+
+    command->proc = proc;
+    command->size = align(size, VKD3D_BUNDLE_COMMAND_ALIGNMENT);
+
+    if (!stream->head)
+        stream->head = command;
+
+    stream->tail = command;
+    return command;
+}
+
+void d3d12_command_list_translate_deferred(struct d3d12_command_list *list)
+{
+    VKD3D_REGION_DECL(translate_command_list);
+    VKD3D_REGION_BEGIN(translate_command_list);
+
+    d3d12_command_list_flush_deferred_commands(list);
+    list->deferred.close_hr = d3d12_command_list_vtbl.Close(&list->ID3D12GraphicsCommandList_iface);
+
+    VKD3D_REGION_END(translate_command_list);
+}
+
+static D3D12_CPU_DESCRIPTOR_HANDLE d3d12_command_list_deferred_capture_rtv(struct d3d12_command_list *list,
+        struct d3d12_rtv_desc *dst, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+{
+    const struct d3d12_rtv_desc *src = d3d12_rtv_desc_from_cpu_handle(handle);
+
+    if (!src)
+        return handle;
+
+    *dst = *src;
+
+    /* The descriptor may be overwritten before the list is translated, so keep the view alive. */
+    if (dst->view && !d3d12_command_allocator_add_view(list->allocator, dst->view))
+        ERR("Failed to add view.\n");
+
+    handle.ptr = (SIZE_T)dst;
+    return handle;
+}
+
+static struct d3d12_rtv_desc *d3d12_command_list_deferred_rtv_storage(void *ptr)
+{
+    return (struct d3d12_rtv_desc *)align((uintptr_t)ptr, D3D12_DESC_ALIGNMENT);
+}
+
+#define COMMAND_LIST_DEFERRED_FALLBACK(name, ...) \
+    d3d12_command_list_flush_deferred_commands(impl_from_ID3D12GraphicsCommandList(iface)); \
+    d3d12_command_list_vtbl.name(__VA_ARGS__)
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_list_Close_deferred(d3d12_command_list_iface *iface)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct vkd3d_command_list_translator *translator = &list->device->command_list_translator;
+
+    TRACE("iface %p.\n", iface);
+
+    vkd3d_command_list_translator_wait(translator, &list->deferred.pending_translation);
+
+    if (!list->is_recording)
+    {
+        WARN("Command list is not in the recording state.\n");
+        return E_FAIL;
+    }
+
+    /* Invalid API usage is validated while recording, so report it here.
+     * Only internal failures during translation are left for submission time. */
+    if (!list->is_valid || !vkd3d_command_list_translator_enqueue(translator, list))
+    {
+        d3d12_command_list_flush_deferred_commands(list);
+        return d3d12_command_list_vtbl.Close(iface);
+    }
+
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_list_Reset_deferred(d3d12_command_list_iface *iface,
+        ID3D12CommandAllocator *allocator, ID3D12PipelineState *initial_pipeline_state)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+
+    vkd3d_command_list_translator_wait(&list->device->command_list_translator,
+            &list->deferred.pending_translation);
+
+    list->deferred.close_hr = S_OK;
+    return d3d12_command_list_vtbl.Reset(iface, allocator, initial_pipeline_state);
+}
+
+struct d3d12_deferred_clear_state_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12PipelineState *pipeline_state;
+};
+
+static void d3d12_deferred_exec_clear_state(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_clear_state_command *args = args_v;
+
+    d3d12_command_list_vtbl.ClearState(iface, args->pipeline_state);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ClearState_deferred(d3d12_command_list_iface *iface,
+        ID3D12PipelineState *pipeline_state)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_clear_state_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_clear_state, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.ClearState(iface, pipeline_state);
+        return;
+    }
+
+    args->pipeline_state = pipeline_state;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_DrawInstanced_deferred(d3d12_command_list_iface *iface,
+        UINT vertex_count_per_instance, UINT instance_count, UINT start_vertex_location,
+        UINT start_instance_location)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_draw_instanced_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_bundle_exec_draw_instanced, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.DrawInstanced(iface, vertex_count_per_instance, instance_count,
+                start_vertex_location, start_instance_location);
+        return;
+    }
+
+    args->vertex_count = vertex_count_per_instance;
+    args->instance_count = instance_count;
+    args->first_vertex = start_vertex_location;
+    args->first_instance = start_instance_location;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_DrawIndexedInstanced_deferred(d3d12_command_list_iface *iface,
+        UINT index_count_per_instance, UINT instance_count, UINT start_vertex_location,
+        INT base_vertex_location, UINT start_instance_location)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_draw_indexed_instanced_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_draw_indexed_instanced, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.DrawIndexedInstanced(iface, index_count_per_instance, instance_count,
+                start_vertex_location, base_vertex_location, start_instance_location);
+        return;
+    }
+
+    args->index_count = index_count_per_instance;
+    args->instance_count = instance_count;
+    args->first_index = start_vertex_location;
+    args->vertex_offset = base_vertex_location;
+    args->first_instance = start_instance_location;
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_dispatch)(d3d12_command_list_iface *iface, UINT x, UINT y, UINT z);
+
+static void d3d12_command_list_deferred_dispatch(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_dispatch direct, UINT x, UINT y, UINT z)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_dispatch_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc, sizeof(*args))))
+    {
+        direct(iface, x, y, z);
+        return;
+    }
+
+    args->x = x;
+    args->y = y;
+    args->z = z;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_Dispatch_deferred(d3d12_command_list_iface *iface,
+        UINT x, UINT y, UINT z)
+{
+    d3d12_command_list_deferred_dispatch(iface, d3d12_bundle_exec_dispatch,
+            d3d12_command_list_vtbl.Dispatch, x, y, z);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_DispatchMesh_deferred(d3d12_command_list_iface *iface,
+        UINT x, UINT y, UINT z)
+{
+    d3d12_command_list_deferred_dispatch(iface, d3d12_bundle_exec_dispatch_mesh,
+            d3d12_command_list_vtbl.DispatchMesh, x, y, z);
+}
+
+struct d3d12_deferred_copy_buffer_region_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12Resource *dst;
+    UINT64 dst_offset;
+    ID3D12Resource *src;
+    UINT64 src_offset;
+    UINT64 byte_count;
+};
+
+static void d3d12_deferred_exec_copy_buffer_region(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_copy_buffer_region_command *args = args_v;
+
+    d3d12_command_list_vtbl.CopyBufferRegion(iface, args->dst, args->dst_offset,
+            args->src, args->src_offset, args->byte_count);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_CopyBufferRegion_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *dst, UINT64 dst_offset, ID3D12Resource *src, UINT64 src_offset, UINT64 byte_count)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_copy_buffer_region_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_deferred_exec_copy_buffer_region, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.CopyBufferRegion(iface, dst, dst_offset, src, src_offset, byte_count);
+        return;
+    }
+
+    args->dst = dst;
+    args->dst_offset = dst_offset;
+    args->src = src;
+    args->src_offset = src_offset;
+    args->byte_count = byte_count;
+}
+
+struct d3d12_deferred_copy_texture_region_command
+{
+    struct d3d12_bundle_command command;
+    D3D12_TEXTURE_COPY_LOCATION dst;
+    D3D12_TEXTURE_COPY_LOCATION src;
+    UINT dst_x, dst_y, dst_z;
+    bool has_src_box;
+    D3D12_BOX src_box;
+};
+
+static void d3d12_deferred_exec_copy_texture_region(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_copy_texture_region_command *args = args_v;
+
+    d3d12_command_list_vtbl.CopyTextureRegion(iface, &args->dst, args->dst_x, args->dst_y, args->dst_z,
+            &args->src, args->has_src_box ? &args->src_box : NULL);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_CopyTextureRegion_deferred(d3d12_command_list_iface *iface,
+        const D3D12_TEXTURE_COPY_LOCATION *dst, UINT dst_x, UINT dst_y, UINT dst_z,
+        const D3D12_TEXTURE_COPY_LOCATION *src, const D3D12_BOX *src_box)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_copy_texture_region_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_deferred_exec_copy_texture_region, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.CopyTextureRegion(iface, dst, dst_x, dst_y, dst_z, src, src_box);
+        return;
+    }
+
+    args->dst = *dst;
+    args->src = *src;
+    args->dst_x = dst_x;
+    args->dst_y = dst_y;
+    args->dst_z = dst_z;
+
+    if ((args->has_src_box = !!src_box))
+        args->src_box = *src_box;
+}
+
+struct d3d12_deferred_copy_resource_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12Resource *dst;
+    ID3D12Resource *src;
+};
+
+static void d3d12_deferred_exec_copy_resource(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_copy_resource_command *args = args_v;
+
+    d3d12_command_list_vtbl.CopyResource(iface, args->dst, args->src);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_CopyResource_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *dst, ID3D12Resource *src)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_copy_resource_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_copy_resource, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.CopyResource(iface, dst, src);
+        return;
+    }
+
+    args->dst = dst;
+    args->src = src;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_CopyTiles_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *tiled_resource, const D3D12_TILED_RESOURCE_COORDINATE *region_coord,
+        const D3D12_TILE_REGION_SIZE *region_size, ID3D12Resource *buffer, UINT64 buffer_offset,
+        D3D12_TILE_COPY_FLAGS flags)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(CopyTiles, iface, tiled_resource, region_coord,
+            region_size, buffer, buffer_offset, flags);
+}
+
+struct d3d12_deferred_resolve_subresource_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12Resource *dst;
+    UINT dst_sub_resource_idx;
+    ID3D12Resource *src;
+    UINT src_sub_resource_idx;
+    DXGI_FORMAT format;
+};
+
+static void d3d12_deferred_exec_resolve_subresource(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_resolve_subresource_command *args = args_v;
+
+    d3d12_command_list_vtbl.ResolveSubresource(iface, args->dst, args->dst_sub_resource_idx,
+            args->src, args->src_sub_resource_idx, args->format);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ResolveSubresource_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *dst, UINT dst_sub_resource_idx,
+        ID3D12Resource *src, UINT src_sub_resource_idx, DXGI_FORMAT format)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_resolve_subresource_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_deferred_exec_resolve_subresource, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.ResolveSubresource(iface, dst, dst_sub_resource_idx,
+                src, src_sub_resource_idx, format);
+        return;
+    }
+
+    args->dst = dst;
+    args->dst_sub_resource_idx = dst_sub_resource_idx;
+    args->src = src;
+    args->src_sub_resource_idx = src_sub_resource_idx;
+    args->format = format;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_IASetPrimitiveTopology_deferred(d3d12_command_list_iface *iface,
+        D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_ia_set_primitive_topology_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_ia_set_primitive_topology, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.IASetPrimitiveTopology(iface, topology);
+        return;
+    }
+
+    args->topology = topology;
+}
+
+struct d3d12_deferred_rs_set_viewports_command
+{
+    struct d3d12_bundle_command command;
+    UINT viewport_count;
+    D3D12_VIEWPORT viewports[];
+};
+
+static void d3d12_deferred_exec_rs_set_viewports(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_rs_set_viewports_command *args = args_v;
+
+    d3d12_command_list_vtbl.RSSetViewports(iface, args->viewport_count, args->viewports);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_RSSetViewports_deferred(d3d12_command_list_iface *iface,
+        UINT viewport_count, const D3D12_VIEWPORT *viewports)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_rs_set_viewports_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_rs_set_viewports,
+            sizeof(*args) + viewport_count * sizeof(*viewports))))
+    {
+        d3d12_command_list_vtbl.RSSetViewports(iface, viewport_count, viewports);
+        return;
+    }
+
+    args->viewport_count = viewport_count;
+    memcpy(args->viewports, viewports, viewport_count * sizeof(*viewports));
+}
+
+struct d3d12_deferred_rs_set_scissor_rects_command
+{
+    struct d3d12_bundle_command command;
+    UINT rect_count;
+    D3D12_RECT rects[];
+};
+
+static void d3d12_deferred_exec_rs_set_scissor_rects(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_rs_set_scissor_rects_command *args = args_v;
+
+    d3d12_command_list_vtbl.RSSetScissorRects(iface, args->rect_count, args->rects);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_RSSetScissorRects_deferred(d3d12_command_list_iface *iface,
+        UINT rect_count, const D3D12_RECT *rects)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_rs_set_scissor_rects_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_rs_set_scissor_rects,
+            sizeof(*args) + rect_count * sizeof(*rects))))
+    {
+        d3d12_command_list_vtbl.RSSetScissorRects(iface, rect_count, rects);
+        return;
+    }
+
+    args->rect_count = rect_count;
+    memcpy(args->rects, rects, rect_count * sizeof(*rects));
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_OMSetBlendFactor_deferred(d3d12_command_list_iface *iface,
+        const FLOAT blend_factor[4])
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_om_set_blend_factor_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_om_set_blend_factor, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.OMSetBlendFactor(iface, blend_factor);
+        return;
+    }
+
+    memcpy(args->blend_factor, blend_factor, sizeof(args->blend_factor));
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_OMSetStencilRef_deferred(d3d12_command_list_iface *iface,
+        UINT stencil_ref)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_om_set_stencil_ref_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_om_set_stencil_ref, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.OMSetStencilRef(iface, stencil_ref);
+        return;
+    }
+
+    args->stencil_ref = stencil_ref;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetPipelineState_deferred(d3d12_command_list_iface *iface,
+        ID3D12PipelineState *pipeline_state)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_pipeline_state_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_set_pipeline_state, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.SetPipelineState(iface, pipeline_state);
+        return;
+    }
+
+    args->pipeline_state = pipeline_state;
+}
+
+struct d3d12_deferred_resource_barrier_command
+{
+    struct d3d12_bundle_command command;
+    UINT barrier_count;
+    D3D12_RESOURCE_BARRIER barriers[];
+};
+
+static void d3d12_deferred_exec_resource_barrier(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_resource_barrier_command *args = args_v;
+
+    d3d12_command_list_vtbl.ResourceBarrier(iface, args->barrier_count, args->barriers);
+}
+
+static void d3d12_command_list_deferred_validate_barriers(struct d3d12_command_list *list,
+        UINT barrier_count, const D3D12_RESOURCE_BARRIER *barriers)
+{
+    const D3D12_RESOURCE_TRANSITION_BARRIER *transition;
+    unsigned int i;
+
+    for (i = 0; i < barrier_count; ++i)
+    {
+        if (barriers[i].Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+            continue;
+
+        transition = &barriers[i].Transition;
+
+        if (!is_valid_resource_state(transition->StateBefore))
+            d3d12_command_list_mark_as_invalid(list,
+                    "Invalid StateBefore %#x (barrier %u).", transition->StateBefore, i);
+        else if (!is_valid_resource_state(transition->StateAfter))
+            d3d12_command_list_mark_as_invalid(list,
+                    "Invalid StateAfter %#x (barrier %u).", transition->StateAfter, i);
+        else if (!transition->pResource)
+            d3d12_command_list_mark_as_invalid(list, "A resource pointer is NULL.");
+    }
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ResourceBarrier_deferred(d3d12_command_list_iface *iface,
+        UINT barrier_count, const D3D12_RESOURCE_BARRIER *barriers)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_resource_barrier_command *args;
+
+    d3d12_command_list_deferred_validate_barriers(list, barrier_count, barriers);
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_resource_barrier,
+            sizeof(*args) + barrier_count * sizeof(*barriers))))
+    {
+        d3d12_command_list_vtbl.ResourceBarrier(iface, barrier_count, barriers);
+        return;
+    }
+
+    args->barrier_count = barrier_count;
+    memcpy(args->barriers, barriers, barrier_count * sizeof(*barriers));
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ExecuteBundle_deferred(d3d12_command_list_iface *iface,
+        ID3D12GraphicsCommandList *command_list)
+{
+    struct d3d12_bundle *bundle;
+
+    TRACE("iface %p, command_list %p.\n", iface, command_list);
+
+    if (!(bundle = d3d12_bundle_from_iface(command_list)))
+    {
+        WARN("Command list %p not a bundle.\n", command_list);
+        return;
+    }
+
+    /* Bundles replay through the vtable, so this records their commands into our stream. */
+    d3d12_bundle_execute(bundle, iface);
+}
+
+struct d3d12_deferred_set_descriptor_heaps_command
+{
+    struct d3d12_bundle_command command;
+    UINT heap_count;
+    ID3D12DescriptorHeap *heaps[];
+};
+
+static void d3d12_deferred_exec_set_descriptor_heaps(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_set_descriptor_heaps_command *args = args_v;
+
+    d3d12_command_list_vtbl.SetDescriptorHeaps(iface, args->heap_count, args->heaps);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetDescriptorHeaps_deferred(d3d12_command_list_iface *iface,
+        UINT heap_count, ID3D12DescriptorHeap *const *heaps)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_set_descriptor_heaps_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_set_descriptor_heaps,
+            sizeof(*args) + heap_count * sizeof(*heaps))))
+    {
+        d3d12_command_list_vtbl.SetDescriptorHeaps(iface, heap_count, heaps);
+        return;
+    }
+
+    args->heap_count = heap_count;
+    memcpy(args->heaps, heaps, heap_count * sizeof(*heaps));
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_set_root_signature)(d3d12_command_list_iface *iface,
+        ID3D12RootSignature *root_signature);
+
+static void d3d12_command_list_deferred_set_root_signature(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_set_root_signature direct, ID3D12RootSignature *root_signature)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_root_signature_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc, sizeof(*args))))
+    {
+        direct(iface, root_signature);
+        return;
+    }
+
+    args->root_signature = root_signature;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootSignature_deferred(d3d12_command_list_iface *iface,
+        ID3D12RootSignature *root_signature)
+{
+    d3d12_command_list_deferred_set_root_signature(iface, d3d12_bundle_exec_set_compute_root_signature,
+            d3d12_command_list_vtbl.SetComputeRootSignature, root_signature);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRootSignature_deferred(d3d12_command_list_iface *iface,
+        ID3D12RootSignature *root_signature)
+{
+    d3d12_command_list_deferred_set_root_signature(iface, d3d12_bundle_exec_set_graphics_root_signature,
+            d3d12_command_list_vtbl.SetGraphicsRootSignature, root_signature);
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_set_root_descriptor_table)(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor);
+
+static void d3d12_command_list_deferred_set_root_descriptor_table(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_set_root_descriptor_table direct,
+        UINT root_parameter_index, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_root_descriptor_table_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc, sizeof(*args))))
+    {
+        direct(iface, root_parameter_index, base_descriptor);
+        return;
+    }
+
+    args->parameter_index = root_parameter_index;
+    args->base_descriptor = base_descriptor;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootDescriptorTable_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor)
+{
+    d3d12_command_list_deferred_set_root_descriptor_table(iface, d3d12_bundle_exec_set_compute_root_descriptor_table,
+            d3d12_command_list_vtbl.SetComputeRootDescriptorTable, root_parameter_index, base_descriptor);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRootDescriptorTable_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor)
+{
+    d3d12_command_list_deferred_set_root_descriptor_table(iface, d3d12_bundle_exec_set_graphics_root_descriptor_table,
+            d3d12_command_list_vtbl.SetGraphicsRootDescriptorTable, root_parameter_index, base_descriptor);
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_set_root_constant)(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, UINT data, UINT dst_offset);
+
+static void d3d12_command_list_deferred_set_root_constant(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_set_root_constant direct,
+        UINT root_parameter_index, UINT data, UINT dst_offset)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_root_32bit_constant_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc, sizeof(*args))))
+    {
+        direct(iface, root_parameter_index, data, dst_offset);
+        return;
+    }
+
+    args->parameter_index = root_parameter_index;
+    args->data = data;
+    args->offset = dst_offset;
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_set_root_constants)(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, UINT constant_count, const void *data, UINT dst_offset);
+
+static void d3d12_command_list_deferred_set_root_constants(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_set_root_constants direct,
+        UINT root_parameter_index, UINT constant_count, const void *data, UINT dst_offset)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_root_32bit_constants_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc,
+            sizeof(*args) + constant_count * sizeof(*args->data))))
+    {
+        direct(iface, root_parameter_index, constant_count, data, dst_offset);
+        return;
+    }
+
+    args->parameter_index = root_parameter_index;
+    args->constant_count = constant_count;
+    args->offset = dst_offset;
+    memcpy(args->data, data, constant_count * sizeof(*args->data));
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRoot32BitConstant_deferred(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, UINT data, UINT dst_offset)
+{
+    d3d12_command_list_deferred_set_root_constant(iface, d3d12_bundle_exec_set_compute_root_32bit_constant,
+            d3d12_command_list_vtbl.SetComputeRoot32BitConstant, root_parameter_index, data, dst_offset);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRoot32BitConstant_deferred(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, UINT data, UINT dst_offset)
+{
+    d3d12_command_list_deferred_set_root_constant(iface, d3d12_bundle_exec_set_graphics_root_32bit_constant,
+            d3d12_command_list_vtbl.SetGraphicsRoot32BitConstant, root_parameter_index, data, dst_offset);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRoot32BitConstants_deferred(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, UINT constant_count, const void *data, UINT dst_offset)
+{
+    d3d12_command_list_deferred_set_root_constants(iface, d3d12_bundle_exec_set_compute_root_32bit_constants,
+            d3d12_command_list_vtbl.SetComputeRoot32BitConstants, root_parameter_index, constant_count, data, dst_offset);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRoot32BitConstants_deferred(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, UINT constant_count, const void *data, UINT dst_offset)
+{
+    d3d12_command_list_deferred_set_root_constants(iface, d3d12_bundle_exec_set_graphics_root_32bit_constants,
+            d3d12_command_list_vtbl.SetGraphicsRoot32BitConstants, root_parameter_index, constant_count, data, dst_offset);
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_set_root_descriptor)(d3d12_command_list_iface *iface,
+        UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address);
+
+static void d3d12_command_list_deferred_set_root_descriptor(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_set_root_descriptor direct,
+        UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_root_descriptor_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc, sizeof(*args))))
+    {
+        direct(iface, root_parameter_index, address);
+        return;
+    }
+
+    args->parameter_index = root_parameter_index;
+    args->address = address;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootConstantBufferView_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    d3d12_command_list_deferred_set_root_descriptor(iface, d3d12_bundle_exec_set_compute_root_cbv,
+            d3d12_command_list_vtbl.SetComputeRootConstantBufferView, root_parameter_index, address);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRootConstantBufferView_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    d3d12_command_list_deferred_set_root_descriptor(iface, d3d12_bundle_exec_set_graphics_root_cbv,
+            d3d12_command_list_vtbl.SetGraphicsRootConstantBufferView, root_parameter_index, address);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootShaderResourceView_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    d3d12_command_list_deferred_set_root_descriptor(iface, d3d12_bundle_exec_set_compute_root_srv,
+            d3d12_command_list_vtbl.SetComputeRootShaderResourceView, root_parameter_index, address);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRootShaderResourceView_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    d3d12_command_list_deferred_set_root_descriptor(iface, d3d12_bundle_exec_set_graphics_root_srv,
+            d3d12_command_list_vtbl.SetGraphicsRootShaderResourceView, root_parameter_index, address);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootUnorderedAccessView_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    d3d12_command_list_deferred_set_root_descriptor(iface, d3d12_bundle_exec_set_compute_root_uav,
+            d3d12_command_list_vtbl.SetComputeRootUnorderedAccessView, root_parameter_index, address);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetGraphicsRootUnorderedAccessView_deferred(
+        d3d12_command_list_iface *iface, UINT root_parameter_index, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    d3d12_command_list_deferred_set_root_descriptor(iface, d3d12_bundle_exec_set_graphics_root_uav,
+            d3d12_command_list_vtbl.SetGraphicsRootUnorderedAccessView, root_parameter_index, address);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_IASetIndexBuffer_deferred(d3d12_command_list_iface *iface,
+        const D3D12_INDEX_BUFFER_VIEW *view)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_ia_set_index_buffer_command *args;
+
+    if (!view)
+    {
+        if (!d3d12_command_list_deferred_add_command(list,
+                d3d12_bundle_exec_ia_set_index_buffer_null, sizeof(struct d3d12_bundle_command)))
+            d3d12_command_list_vtbl.IASetIndexBuffer(iface, NULL);
+        return;
+    }
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_ia_set_index_buffer, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.IASetIndexBuffer(iface, view);
+        return;
+    }
+
+    args->view = *view;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_IASetVertexBuffers_deferred(d3d12_command_list_iface *iface,
+        UINT start_slot, UINT view_count, const D3D12_VERTEX_BUFFER_VIEW *views)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_ia_set_vertex_buffers_command *args;
+
+    /* The shared command layout cannot express unbinding. */
+    if (!views)
+    {
+        COMMAND_LIST_DEFERRED_FALLBACK(IASetVertexBuffers, iface, start_slot, view_count, views);
+        return;
+    }
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_bundle_exec_ia_set_vertex_buffers,
+            sizeof(*args) + view_count * sizeof(*views))))
+    {
+        d3d12_command_list_vtbl.IASetVertexBuffers(iface, start_slot, view_count, views);
+        return;
+    }
+
+    args->start_slot = start_slot;
+    args->view_count = view_count;
+    memcpy(args->views, views, view_count * sizeof(*views));
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SOSetTargets_deferred(d3d12_command_list_iface *iface,
+        UINT start_slot, UINT view_count, const D3D12_STREAM_OUTPUT_BUFFER_VIEW *views)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(SOSetTargets, iface, start_slot, view_count, views);
+}
+
+struct d3d12_deferred_om_set_render_targets_command
+{
+    struct d3d12_bundle_command command;
+    UINT rt_count;
+    bool has_dsv;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+    char storage[];
+};
+
+static void d3d12_deferred_exec_om_set_render_targets(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_om_set_render_targets_command *args = args_v;
+
+    d3d12_command_list_vtbl.OMSetRenderTargets(iface, args->rt_count, args->rtvs,
+            FALSE, args->has_dsv ? &args->dsv : NULL);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_OMSetRenderTargets_deferred(d3d12_command_list_iface *iface,
+        UINT render_target_descriptor_count, const D3D12_CPU_DESCRIPTOR_HANDLE *render_target_descriptors,
+        BOOL single_descriptor_handle, const D3D12_CPU_DESCRIPTOR_HANDLE *depth_stencil_descriptor)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_om_set_render_targets_command *args;
+    D3D12_CPU_DESCRIPTOR_HANDLE handle;
+    struct d3d12_rtv_desc *descs;
+    unsigned int i;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_om_set_render_targets,
+            sizeof(*args) + (ARRAY_SIZE(args->rtvs) + 1) * sizeof(*descs) + D3D12_DESC_ALIGNMENT)))
+    {
+        d3d12_command_list_vtbl.OMSetRenderTargets(iface, render_target_descriptor_count,
+                render_target_descriptors, single_descriptor_handle, depth_stencil_descriptor);
+        return;
+    }
+
+    descs = d3d12_command_list_deferred_rtv_storage(args->storage);
+    args->rt_count = min(render_target_descriptor_count, ARRAY_SIZE(args->rtvs));
+
+    for (i = 0; i < args->rt_count; i++)
+    {
+        if (single_descriptor_handle)
+        {
+            if ((handle = *render_target_descriptors).ptr)
+                handle.ptr += i * sizeof(*descs);
+        }
+        else
+            handle = render_target_descriptors[i];
+
+        args->rtvs[i] = d3d12_command_list_deferred_capture_rtv(list, &descs[i], handle);
+    }
+
+    if ((args->has_dsv = !!depth_stencil_descriptor))
+    {
+        args->dsv = d3d12_command_list_deferred_capture_rtv(list,
+                &descs[ARRAY_SIZE(args->rtvs)], *depth_stencil_descriptor);
+    }
+}
+
+struct d3d12_deferred_clear_depth_stencil_view_command
+{
+    struct d3d12_bundle_command command;
+    D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+    D3D12_CLEAR_FLAGS flags;
+    float depth;
+    UINT8 stencil;
+    UINT rect_count;
+    D3D12_RECT rects[];
+};
+
+static void d3d12_deferred_exec_clear_depth_stencil_view(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_clear_depth_stencil_view_command *args = args_v;
+
+    d3d12_command_list_vtbl.ClearDepthStencilView(iface, args->dsv, args->flags, args->depth,
+            args->stencil, args->rect_count, args->rect_count ? args->rects : NULL);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ClearDepthStencilView_deferred(d3d12_command_list_iface *iface,
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS flags, float depth, UINT8 stencil,
+        UINT rect_count, const D3D12_RECT *rects)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_clear_depth_stencil_view_command *args;
+
+    if (!rects)
+        rect_count = 0;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_clear_depth_stencil_view,
+            sizeof(*args) + rect_count * sizeof(*rects) + sizeof(struct d3d12_rtv_desc) + D3D12_DESC_ALIGNMENT)))
+    {
+        d3d12_command_list_vtbl.ClearDepthStencilView(iface, dsv, flags, depth, stencil, rect_count, rects);
+        return;
+    }
+
+    args->flags = flags;
+    args->depth = depth;
+    args->stencil = stencil;
+    args->rect_count = rect_count;
+    memcpy(args->rects, rects, rect_count * sizeof(*rects));
+
+    args->dsv = d3d12_command_list_deferred_capture_rtv(list,
+            d3d12_command_list_deferred_rtv_storage(&args->rects[rect_count]), dsv);
+}
+
+struct d3d12_deferred_clear_render_target_view_command
+{
+    struct d3d12_bundle_command command;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+    FLOAT color[4];
+    UINT rect_count;
+    D3D12_RECT rects[];
+};
+
+static void d3d12_deferred_exec_clear_render_target_view(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_clear_render_target_view_command *args = args_v;
+
+    d3d12_command_list_vtbl.ClearRenderTargetView(iface, args->rtv, args->color,
+            args->rect_count, args->rect_count ? args->rects : NULL);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ClearRenderTargetView_deferred(d3d12_command_list_iface *iface,
+        D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT color[4], UINT rect_count, const D3D12_RECT *rects)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_clear_render_target_view_command *args;
+
+    if (!rects)
+        rect_count = 0;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_clear_render_target_view,
+            sizeof(*args) + rect_count * sizeof(*rects) + sizeof(struct d3d12_rtv_desc) + D3D12_DESC_ALIGNMENT)))
+    {
+        d3d12_command_list_vtbl.ClearRenderTargetView(iface, rtv, color, rect_count, rects);
+        return;
+    }
+
+    memcpy(args->color, color, sizeof(args->color));
+    args->rect_count = rect_count;
+    memcpy(args->rects, rects, rect_count * sizeof(*rects));
+
+    args->rtv = d3d12_command_list_deferred_capture_rtv(list,
+            d3d12_command_list_deferred_rtv_storage(&args->rects[rect_count]), rtv);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ClearUnorderedAccessViewUint_deferred(d3d12_command_list_iface *iface,
+        D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle, ID3D12Resource *resource,
+        const UINT values[4], UINT rect_count, const D3D12_RECT *rects)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(ClearUnorderedAccessViewUint, iface, gpu_handle, cpu_handle,
+            resource, values, rect_count, rects);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ClearUnorderedAccessViewFloat_deferred(d3d12_command_list_iface *iface,
+        D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle, D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle, ID3D12Resource *resource,
+        const float values[4], UINT rect_count, const D3D12_RECT *rects)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(ClearUnorderedAccessViewFloat, iface, gpu_handle, cpu_handle,
+            resource, values, rect_count, rects);
+}
+
+struct d3d12_deferred_discard_resource_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12Resource *resource;
+    bool has_region;
+    D3D12_DISCARD_REGION region;
+    D3D12_RECT rects[];
+};
+
+static void d3d12_deferred_exec_discard_resource(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_discard_resource_command *args = args_v;
+    D3D12_DISCARD_REGION region;
+
+    if (args->has_region)
+    {
+        region = args->region;
+        region.pRects = region.NumRects ? args->rects : NULL;
+    }
+
+    d3d12_command_list_vtbl.DiscardResource(iface, args->resource, args->has_region ? &region : NULL);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_DiscardResource_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *resource, const D3D12_DISCARD_REGION *region)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_discard_resource_command *args;
+    UINT rect_count;
+
+    rect_count = region && region->pRects ? region->NumRects : 0;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_discard_resource,
+            sizeof(*args) + rect_count * sizeof(*args->rects))))
+    {
+        d3d12_command_list_vtbl.DiscardResource(iface, resource, region);
+        return;
+    }
+
+    args->resource = resource;
+
+    if ((args->has_region = !!region))
+    {
+        args->region = *region;
+        args->region.NumRects = rect_count;
+        memcpy(args->rects, region->pRects, rect_count * sizeof(*args->rects));
+    }
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_query)(d3d12_command_list_iface *iface,
+        ID3D12QueryHeap *heap, D3D12_QUERY_TYPE type, UINT index);
+
+struct d3d12_deferred_query_command
+{
+    struct d3d12_bundle_command command;
+    pfn_d3d12_query proc;
+    ID3D12QueryHeap *heap;
+    D3D12_QUERY_TYPE type;
+    UINT index;
+};
+
+static void d3d12_deferred_exec_query(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_query_command *args = args_v;
+
+    args->proc(iface, args->heap, args->type, args->index);
+}
+
+static void d3d12_command_list_deferred_query(d3d12_command_list_iface *iface,
+        pfn_d3d12_query proc, ID3D12QueryHeap *heap, D3D12_QUERY_TYPE type, UINT index)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_query_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_deferred_exec_query, sizeof(*args))))
+    {
+        proc(iface, heap, type, index);
+        return;
+    }
+
+    args->proc = proc;
+    args->heap = heap;
+    args->type = type;
+    args->index = index;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_BeginQuery_deferred(d3d12_command_list_iface *iface,
+        ID3D12QueryHeap *heap, D3D12_QUERY_TYPE type, UINT index)
+{
+    d3d12_command_list_deferred_query(iface, d3d12_command_list_vtbl.BeginQuery, heap, type, index);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_EndQuery_deferred(d3d12_command_list_iface *iface,
+        ID3D12QueryHeap *heap, D3D12_QUERY_TYPE type, UINT index)
+{
+    d3d12_command_list_deferred_query(iface, d3d12_command_list_vtbl.EndQuery, heap, type, index);
+}
+
+struct d3d12_deferred_resolve_query_data_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12QueryHeap *heap;
+    D3D12_QUERY_TYPE type;
+    UINT start_index;
+    UINT query_count;
+    ID3D12Resource *dst_buffer;
+    UINT64 aligned_dst_buffer_offset;
+};
+
+static void d3d12_deferred_exec_resolve_query_data(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_resolve_query_data_command *args = args_v;
+
+    d3d12_command_list_vtbl.ResolveQueryData(iface, args->heap, args->type, args->start_index,
+            args->query_count, args->dst_buffer, args->aligned_dst_buffer_offset);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ResolveQueryData_deferred(d3d12_command_list_iface *iface,
+        ID3D12QueryHeap *heap, D3D12_QUERY_TYPE type, UINT start_index, UINT query_count,
+        ID3D12Resource *dst_buffer, UINT64 aligned_dst_buffer_offset)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_resolve_query_data_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_deferred_exec_resolve_query_data, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.ResolveQueryData(iface, heap, type, start_index,
+                query_count, dst_buffer, aligned_dst_buffer_offset);
+        return;
+    }
+
+    args->heap = heap;
+    args->type = type;
+    args->start_index = start_index;
+    args->query_count = query_count;
+    args->dst_buffer = dst_buffer;
+    args->aligned_dst_buffer_offset = aligned_dst_buffer_offset;
+}
+
+struct d3d12_deferred_set_predication_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12Resource *buffer;
+    UINT64 aligned_buffer_offset;
+    D3D12_PREDICATION_OP operation;
+};
+
+static void d3d12_deferred_exec_set_predication(d3d12_command_list_iface *iface, const void *args_v)
+{
+    const struct d3d12_deferred_set_predication_command *args = args_v;
+
+    d3d12_command_list_vtbl.SetPredication(iface, args->buffer, args->aligned_buffer_offset, args->operation);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetPredication_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *buffer, UINT64 aligned_buffer_offset, D3D12_PREDICATION_OP operation)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_deferred_set_predication_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_deferred_exec_set_predication, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.SetPredication(iface, buffer, aligned_buffer_offset, operation);
+        return;
+    }
+
+    args->buffer = buffer;
+    args->aligned_buffer_offset = aligned_buffer_offset;
+    args->operation = operation;
+}
+
+typedef void (STDMETHODCALLTYPE *pfn_d3d12_debug_event)(d3d12_command_list_iface *iface,
+        UINT metadata, const void *data, UINT size);
+
+static void d3d12_command_list_deferred_debug_event(d3d12_command_list_iface *iface,
+        pfn_d3d12_bundle_command proc, pfn_d3d12_debug_event direct, UINT metadata, const void *data, UINT size)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_debug_marker_command *args;
+
+    if (!data)
+        size = 0;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, proc, sizeof(*args) + size)))
+    {
+        direct(iface, metadata, data, size);
+        return;
+    }
+
+    args->metadata = metadata;
+    args->data_size = size;
+    memcpy(args->data, data, size);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetMarker_deferred(d3d12_command_list_iface *iface,
+        UINT metadata, const void *data, UINT size)
+{
+    d3d12_command_list_deferred_debug_event(iface, d3d12_bundle_exec_set_marker,
+            d3d12_command_list_vtbl.SetMarker, metadata, data, size);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_BeginEvent_deferred(d3d12_command_list_iface *iface,
+        UINT metadata, const void *data, UINT size)
+{
+    d3d12_command_list_deferred_debug_event(iface, d3d12_bundle_exec_begin_event,
+            d3d12_command_list_vtbl.BeginEvent, metadata, data, size);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_EndEvent_deferred(d3d12_command_list_iface *iface)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+
+    if (!d3d12_command_list_deferred_add_command(list, d3d12_bundle_exec_end_event,
+            sizeof(struct d3d12_bundle_command)))
+        d3d12_command_list_vtbl.EndEvent(iface);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ExecuteIndirect_deferred(d3d12_command_list_iface *iface,
+        ID3D12CommandSignature *command_signature, UINT max_command_count, ID3D12Resource *arg_buffer,
+        UINT64 arg_buffer_offset, ID3D12Resource *count_buffer, UINT64 count_buffer_offset)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_execute_indirect_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_execute_indirect, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.ExecuteIndirect(iface, command_signature, max_command_count,
+                arg_buffer, arg_buffer_offset, count_buffer, count_buffer_offset);
+        return;
+    }
+
+    args->signature = command_signature;
+    args->max_count = max_command_count;
+    args->arg_buffer = arg_buffer;
+    args->arg_offset = arg_buffer_offset;
+    args->count_buffer = count_buffer;
+    args->count_offset = count_buffer_offset;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_AtomicCopyBufferUINT_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *dst_buffer, UINT64 dst_offset,
+        ID3D12Resource *src_buffer, UINT64 src_offset,
+        UINT dependent_resource_count, ID3D12Resource * const *dependent_resources,
+        const D3D12_SUBRESOURCE_RANGE_UINT64 *dependent_sub_resource_ranges)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(AtomicCopyBufferUINT, iface, dst_buffer, dst_offset, src_buffer, src_offset,
+            dependent_resource_count, dependent_resources, dependent_sub_resource_ranges);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_AtomicCopyBufferUINT64_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *dst_buffer, UINT64 dst_offset,
+        ID3D12Resource *src_buffer, UINT64 src_offset,
+        UINT dependent_resource_count, ID3D12Resource * const *dependent_resources,
+        const D3D12_SUBRESOURCE_RANGE_UINT64 *dependent_sub_resource_ranges)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(AtomicCopyBufferUINT64, iface, dst_buffer, dst_offset, src_buffer, src_offset,
+            dependent_resource_count, dependent_resources, dependent_sub_resource_ranges);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_OMSetDepthBounds_deferred(d3d12_command_list_iface *iface,
+        FLOAT min, FLOAT max)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_om_set_depth_bounds_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_om_set_depth_bounds, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.OMSetDepthBounds(iface, min, max);
+        return;
+    }
+
+    args->min = min;
+    args->max = max;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetSamplePositions_deferred(d3d12_command_list_iface *iface,
+        UINT sample_count, UINT pixel_count, D3D12_SAMPLE_POSITION *sample_positions)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(SetSamplePositions, iface, sample_count, pixel_count, sample_positions);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ResolveSubresourceRegion_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *dst, UINT dst_sub_resource_idx, UINT dst_x, UINT dst_y,
+        ID3D12Resource *src, UINT src_sub_resource_idx,
+        D3D12_RECT *src_rect, DXGI_FORMAT format, D3D12_RESOLVE_MODE mode)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(ResolveSubresourceRegion, iface, dst, dst_sub_resource_idx, dst_x, dst_y,
+            src, src_sub_resource_idx, src_rect, format, mode);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetViewInstanceMask_deferred(d3d12_command_list_iface *iface,
+        UINT mask)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(SetViewInstanceMask, iface, mask);
+}
+
+static void d3d12_command_list_deferred_validate_write_buffer_immediate(struct d3d12_command_list *list,
+        UINT count, const D3D12_WRITEBUFFERIMMEDIATE_PARAMETER *parameters,
+        const D3D12_WRITEBUFFERIMMEDIATE_MODE *modes)
+{
+    VkPipelineStageFlagBits stage;
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (!vkd3d_va_map_deref(&list->device->memory_allocator.va_map, parameters[i].Dest))
+        {
+            d3d12_command_list_mark_as_invalid(list, "Invalid target address %p.\n", parameters[i].Dest);
+            return;
+        }
+
+        if (modes && !vk_pipeline_stage_from_wbi_mode(modes[i], &stage))
+        {
+            d3d12_command_list_mark_as_invalid(list, "Invalid mode %u.\n", modes[i]);
+            return;
+        }
+    }
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_WriteBufferImmediate_deferred(d3d12_command_list_iface *iface,
+        UINT count, const D3D12_WRITEBUFFERIMMEDIATE_PARAMETER *parameters,
+        const D3D12_WRITEBUFFERIMMEDIATE_MODE *modes)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_write_buffer_immediate_command *args;
+    size_t size;
+
+    size = sizeof(*args) + count * sizeof(*parameters);
+    if (modes)
+        size += count * sizeof(*modes);
+
+    if (!(args = d3d12_command_list_deferred_add_command(list, d3d12_bundle_exec_write_buffer_immediate, size)))
+    {
+        d3d12_command_list_vtbl.WriteBufferImmediate(iface, count, parameters, modes);
+        return;
+    }
+
+    /* Replay goes through the vtable again and lands in the direct path above,
+     * so this only validates commands which are actually deferred. */
+    d3d12_command_list_deferred_validate_write_buffer_immediate(list, count, parameters, modes);
+
+    args->count = count;
+    args->parameters = void_ptr_offset(args, sizeof(*args));
+    memcpy(args->parameters, parameters, count * sizeof(*parameters));
+
+    if (modes)
+    {
+        args->modes = void_ptr_offset(args->parameters, count * sizeof(*parameters));
+        memcpy(args->modes, modes, count * sizeof(*modes));
+    }
+    else
+        args->modes = NULL;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetProtectedResourceSession_deferred(d3d12_command_list_iface *iface,
+        ID3D12ProtectedResourceSession *protected_session)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(SetProtectedResourceSession, iface, protected_session);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_BeginRenderPass_deferred(d3d12_command_list_iface *iface,
+        UINT rt_count, const D3D12_RENDER_PASS_RENDER_TARGET_DESC *render_targets,
+        const D3D12_RENDER_PASS_DEPTH_STENCIL_DESC *depth_stencil, D3D12_RENDER_PASS_FLAGS flags)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(BeginRenderPass, iface, rt_count, render_targets, depth_stencil, flags);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_EndRenderPass_deferred(d3d12_command_list_iface *iface)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(EndRenderPass, iface);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_InitializeMetaCommand_deferred(d3d12_command_list_iface *iface,
+        ID3D12MetaCommand *meta_command, const void *parameter_data, SIZE_T parameter_size)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(InitializeMetaCommand, iface, meta_command, parameter_data, parameter_size);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_ExecuteMetaCommand_deferred(d3d12_command_list_iface *iface,
+        ID3D12MetaCommand *meta_command, const void *parameter_data, SIZE_T parameter_size)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(ExecuteMetaCommand, iface, meta_command, parameter_data, parameter_size);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_BuildRaytracingAccelerationStructure_deferred(
+        d3d12_command_list_iface *iface, const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC *desc,
+        UINT num_postbuild_info_descs, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *postbuild_info_descs)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(BuildRaytracingAccelerationStructure, iface, desc,
+            num_postbuild_info_descs, postbuild_info_descs);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_EmitRaytracingAccelerationStructurePostbuildInfo_deferred(
+        d3d12_command_list_iface *iface, const D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC *desc,
+        UINT num_acceleration_structures, const D3D12_GPU_VIRTUAL_ADDRESS *src_data)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(EmitRaytracingAccelerationStructurePostbuildInfo, iface, desc,
+            num_acceleration_structures, src_data);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_CopyRaytracingAccelerationStructure_deferred(
+        d3d12_command_list_iface *iface, D3D12_GPU_VIRTUAL_ADDRESS dst_data, D3D12_GPU_VIRTUAL_ADDRESS src_data,
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE mode)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(CopyRaytracingAccelerationStructure, iface, dst_data, src_data, mode);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_SetPipelineState1_deferred(d3d12_command_list_iface *iface,
+        ID3D12StateObject *state_object)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_set_pipeline_state1_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_set_pipeline_state1, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.SetPipelineState1(iface, state_object);
+        return;
+    }
+
+    args->state_object = state_object;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_DispatchRays_deferred(d3d12_command_list_iface *iface,
+        const D3D12_DISPATCH_RAYS_DESC *desc)
+{
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList(iface);
+    struct d3d12_dispatch_rays_command *args;
+
+    if (!(args = d3d12_command_list_deferred_add_command(list,
+            d3d12_bundle_exec_dispatch_rays, sizeof(*args))))
+    {
+        d3d12_command_list_vtbl.DispatchRays(iface, desc);
+        return;
+    }
+
+    args->desc = *desc;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_RSSetShadingRate_deferred(d3d12_command_list_iface *iface,
+        D3D12_SHADING_RATE base, const D3D12_SHADING_RATE_COMBINER *combiners)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(RSSetShadingRate, iface, base, combiners);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_list_RSSetShadingRateImage_deferred(d3d12_command_list_iface *iface,
+        ID3D12Resource *image)
+{
+    COMMAND_LIST_DEFERRED_FALLBACK(RSSetShadingRateImage, iface, image);
+}
+
+CONST_VTBL struct ID3D12GraphicsCommandList6Vtbl d3d12_command_list_vtbl_deferred =
+{
+    /* IUnknown methods */
+    d3d12_command_list_QueryInterface,
+    d3d12_command_list_AddRef,
+    d3d12_command_list_Release,
+    /* ID3D12Object methods */
+    d3d12_command_list_GetPrivateData,
+    d3d12_command_list_SetPrivateData,
+    d3d12_command_list_SetPrivateDataInterface,
+    (void *)d3d12_object_SetName,
+    /* ID3D12DeviceChild methods */
+    d3d12_command_list_GetDevice,
+    /* ID3D12CommandList methods */
+    d3d12_command_list_GetType,
+    /* ID3D12GraphicsCommandList methods */
+    d3d12_command_list_Close_deferred,
+    d3d12_command_list_Reset_deferred,
+    d3d12_command_list_ClearState_deferred,
+    d3d12_command_list_DrawInstanced_deferred,
+    d3d12_command_list_DrawIndexedInstanced_deferred,
+    d3d12_command_list_Dispatch_deferred,
+    d3d12_command_list_CopyBufferRegion_deferred,
+    d3d12_command_list_CopyTextureRegion_deferred,
+    d3d12_command_list_CopyResource_deferred,
+    d3d12_command_list_CopyTiles_deferred,
+    d3d12_command_list_ResolveSubresource_deferred,
+    d3d12_command_list_IASetPrimitiveTopology_deferred,
+    d3d12_command_list_RSSetViewports_deferred,
+    d3d12_command_list_RSSetScissorRects_deferred,
+    d3d12_command_list_OMSetBlendFactor_deferred,
+    d3d12_command_list_OMSetStencilRef_deferred,
+    d3d12_command_list_SetPipelineState_deferred,
+    d3d12_command_list_ResourceBarrier_deferred,
+    d3d12_command_list_ExecuteBundle_deferred,
+    d3d12_command_list_SetDescriptorHeaps_deferred,
+    d3d12_command_list_SetComputeRootSignature_deferred,
+    d3d12_command_list_SetGraphicsRootSignature_deferred,
+    d3d12_command_list_SetComputeRootDescriptorTable_deferred,
+    d3d12_command_list_SetGraphicsRootDescriptorTable_deferred,
+    d3d12_command_list_SetComputeRoot32BitConstant_deferred,
+    d3d12_command_list_SetGraphicsRoot32BitConstant_deferred,
+    d3d12_command_list_SetComputeRoot32BitConstants_deferred,
+    d3d12_command_list_SetGraphicsRoot32BitConstants_deferred,
+    d3d12_command_list_SetComputeRootConstantBufferView_deferred,
+    d3d12_command_list_SetGraphicsRootConstantBufferView_deferred,
+    d3d12_command_list_SetComputeRootShaderResourceView_deferred,
+    d3d12_command_list_SetGraphicsRootShaderResourceView_deferred,
+    d3d12_command_list_SetComputeRootUnorderedAccessView_deferred,
+    d3d12_command_list_SetGraphicsRootUnorderedAccessView_deferred,
+    d3d12_command_list_IASetIndexBuffer_deferred,
+    d3d12_command_list_IASetVertexBuffers_deferred,
+    d3d12_command_list_SOSetTargets_deferred,
+    d3d12_command_list_OMSetRenderTargets_deferred,
+    d3d12_command_list_ClearDepthStencilView_deferred,
+    d3d12_command_list_ClearRenderTargetView_deferred,
+    d3d12_command_list_ClearUnorderedAccessViewUint_deferred,
+    d3d12_command_list_ClearUnorderedAccessViewFloat_deferred,
+    d3d12_command_list_DiscardResource_deferred,
+    d3d12_command_list_BeginQuery_deferred,
+    d3d12_command_list_EndQuery_deferred,
+    d3d12_command_list_ResolveQueryData_deferred,
+    d3d12_command_list_SetPredication_deferred,
+    d3d12_command_list_SetMarker_deferred,
+    d3d12_command_list_BeginEvent_deferred,
+    d3d12_command_list_EndEvent_deferred,
+    d3d12_command_list_ExecuteIndirect_deferred,
+    /* ID3D12GraphicsCommandList1 methods */
+    d3d12_command_list_AtomicCopyBufferUINT_deferred,
+    d3d12_command_list_AtomicCopyBufferUINT64_deferred,
+    d3d12_command_list_OMSetDepthBounds_deferred,
+    d3d12_command_list_SetSamplePositions_deferred,
+    d3d12_command_list_ResolveSubresourceRegion_deferred,
+    d3d12_command_list_SetViewInstanceMask_deferred,
+    /* ID3D12GraphicsCommandList2 methods */
+    d3d12_command_list_WriteBufferImmediate_deferred,
+    /* ID3D12GraphicsCommandList3 methods */
+    d3d12_command_list_SetProtectedResourceSession_deferred,
+    /* ID3D12GraphicsCommandList4 methods */
+    d3d12_command_list_BeginRenderPass_deferred,
+    d3d12_command_list_EndRenderPass_deferred,
+    d3d12_command_list_InitializeMetaCommand_deferred,
+    d3d12_command_list_ExecuteMetaCommand_deferred,
+    d3d12_command_list_BuildRaytracingAccelerationStructure_deferred,
+    d3d12_command_list_EmitRaytracingAccelerationStructurePostbuildInfo_deferred,
+    d3d12_command_list_CopyRaytracingAccelerationStructure_deferred,
+    d3d12_command_list_SetPipelineState1_deferred,
+    d3d12_command_list_DispatchRays_deferred,
+    /* ID3D12GraphicsCommandList5 methods */
+    d3d12_command_list_RSSetShadingRate_deferred,
+    d3d12_command_list_RSSetShadingRateImage_deferred,
+    /* ID3D12GraphicsCommandList6 methods */
+    d3d12_command_list_DispatchMesh_deferred,
+};
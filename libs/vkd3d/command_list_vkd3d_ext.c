@@ -60,6 +60,8 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_list_vkd3d_ext_GetVulkanHandle(ID
     if (!pVkCommandBuffer)
         return E_INVALIDARG;
 
+    /* The application records into the command buffer directly from here on. */
+    d3d12_command_list_flush_deferred_commands(command_list);
     *pVkCommandBuffer = command_list->vk_command_buffer;
     return S_OK;
 }
@@ -97,6 +99,8 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_list_vkd3d_ext_LaunchCubinShader(
     launchInfo.extraCount = 1;
     launchInfo.pExtras = config;
     
+    d3d12_command_list_flush_deferred_commands(command_list);
+
     vk_procs = &command_list->device->vk_procs;
     VK_CALL(vkCmdCuLaunchKernelNVX(command_list->vk_command_buffer, &launchInfo));
     return S_OK;
@@ -53,120 +53,241 @@ void vkd3d_shader_debug_ring_init_spec_constant(struct d3d12_device *device,
     info->map_entries[3].size = sizeof(uint32_t);
 }
 
+/* Messages end with a word holding the ring offset they were allocated at,
+ * which shaders write last. Until it matches, the message is still being
+ * written, or is left over from an earlier pass over the ring. */
+#define VKD3D_SHADER_DEBUG_RING_HEADER_WORDS 8u
+#define VKD3D_SHADER_DEBUG_RING_MAX_PAYLOAD_WORDS 16u
+#define VKD3D_SHADER_DEBUG_RING_MIN_MESSAGE_WORDS (VKD3D_SHADER_DEBUG_RING_HEADER_WORDS + 1u)
+#define VKD3D_SHADER_DEBUG_RING_MAX_MESSAGE_WORDS (VKD3D_SHADER_DEBUG_RING_MIN_MESSAGE_WORDS + VKD3D_SHADER_DEBUG_RING_MAX_PAYLOAD_WORDS)
+/* Number of wakeups a message may stay incomplete before it is considered lost. */
+#define VKD3D_SHADER_DEBUG_RING_MAX_STALLS 64u
+
+static bool vkd3d_shader_debug_ring_message_is_complete(const uint32_t *ring_base, uint32_t ring_mask,
+        uint32_t offset, uint32_t available_words, uint32_t *word_count)
+{
+    uint32_t count = ring_base[offset & ring_mask];
+
+    if (count < VKD3D_SHADER_DEBUG_RING_MIN_MESSAGE_WORDS || count > VKD3D_SHADER_DEBUG_RING_MAX_MESSAGE_WORDS ||
+            count > available_words)
+        return false;
+
+    *word_count = count;
+    return ring_base[(offset + count - 1) & ring_mask] == offset;
+}
+
+static void vkd3d_shader_debug_ring_print_message(const uint32_t *ring_base, uint32_t ring_mask,
+        uint32_t offset, uint32_t word_count)
+{
+    uint32_t payload_word_count, debug_instance, debug_thread_id[3], fmt, j;
+    char message_buffer[4096];
+    uint64_t shader_hash;
+    size_t len;
+
+#define READ_RING_WORD(off) ring_base[((off) + offset) & ring_mask]
+    shader_hash = (uint64_t)READ_RING_WORD(1) | ((uint64_t)READ_RING_WORD(2) << 32);
+    debug_instance = READ_RING_WORD(3);
+    for (j = 0; j < 3; j++)
+        debug_thread_id[j] = READ_RING_WORD(4 + j);
+    fmt = READ_RING_WORD(7);
+
+    len = snprintf(message_buffer, sizeof(message_buffer), "Shader: %"PRIx64": Instance %u, ID (%u, %u, %u):",
+            shader_hash, debug_instance,
+            debug_thread_id[0], debug_thread_id[1], debug_thread_id[2]);
+
+    payload_word_count = word_count - VKD3D_SHADER_DEBUG_RING_MIN_MESSAGE_WORDS;
+
+    for (j = 0; j < payload_word_count && len + 1 < sizeof(message_buffer); j++)
+    {
+        union
+        {
+            float f32;
+            uint32_t u32;
+            int32_t i32;
+        } u;
+        const char *delim;
+        size_t avail;
+        int written;
+
+        u.u32 = READ_RING_WORD(VKD3D_SHADER_DEBUG_RING_HEADER_WORDS + j);
+        avail = sizeof(message_buffer) - len;
+        delim = j == 0 ? " " : ", ";
+
+#define VKD3D_DEBUG_CHANNEL_FMT_HEX 0u
+#define VKD3D_DEBUG_CHANNEL_FMT_I32 1u
+#define VKD3D_DEBUG_CHANNEL_FMT_F32 2u
+        switch ((fmt >> (2u * j)) & 3u)
+        {
+        case VKD3D_DEBUG_CHANNEL_FMT_HEX:
+            written = snprintf(message_buffer + len, avail, "%s#%x", delim, u.u32);
+            break;
+
+        case VKD3D_DEBUG_CHANNEL_FMT_I32:
+            written = snprintf(message_buffer + len, avail, "%s%d", delim, u.i32);
+            break;
+
+        case VKD3D_DEBUG_CHANNEL_FMT_F32:
+            written = snprintf(message_buffer + len, avail, "%s%f", delim, u.f32);
+            break;
+
+        default:
+            written = snprintf(message_buffer + len, avail, "%s????", delim);
+            break;
+        }
+
+        len = min(len + max(written, 0), sizeof(message_buffer) - 1);
+    }
+#undef READ_RING_WORD
+
+    INFO("%s\n", message_buffer);
+}
+
+static void vkd3d_shader_debug_ring_invalidate(struct vkd3d_shader_debug_ring *ring, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkMappedMemoryRange range;
+
+    /* The ring lives in cached memory, which is not necessarily coherent. */
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.pNext = NULL;
+    range.memory = ring->host_buffer_memory.vk_memory;
+    range.offset = 0;
+    range.size = VK_WHOLE_SIZE;
+    VK_CALL(vkInvalidateMappedMemoryRanges(device->vk_device, 1, &range));
+}
+
 void *vkd3d_shader_debug_ring_thread_main(void *arg)
 {
-    uint32_t last_counter, new_counter, count, i, j, message_word_count, debug_instance, debug_thread_id[3], fmt;
+    uint32_t read_counter, new_counter, available, word_count, ring_mask, ring_words, stall_count, offset;
+    uint32_t kick_count = 0;
     struct vkd3d_shader_debug_ring *ring;
     struct d3d12_device *device = arg;
-    const uint32_t *ring_counter;
     const uint32_t *ring_base;
-    char message_buffer[4096];
+    uint32_t *ring_counter;
     bool is_active = true;
-    uint64_t shader_hash;
-    size_t ring_mask;
 
     ring = &device->debug_ring;
-    ring_mask = ring->ring_size - 1;
+    ring_words = ring->ring_size / sizeof(uint32_t);
+    ring_mask = ring_words - 1;
     ring_counter = ring->mapped;
     ring_base = ring_counter + (ring->ring_offset / sizeof(uint32_t));
-    last_counter = 0;
+    read_counter = 0;
+    stall_count = 0;
 
     vkd3d_set_thread_name("debug-ring");
 
     while (is_active)
     {
+        /* The fence worker kicks the ring whenever submissions complete, which is the only
+         * time new messages become visible. Kicks are counted so that none are missed while
+         * messages are being printed. */
         pthread_mutex_lock(&ring->ring_lock);
-        if (ring->active)
+        while (ring->active && ring->kick_count == kick_count)
             pthread_cond_wait(&ring->ring_cond, &ring->ring_lock);
+        kick_count = ring->kick_count;
         is_active = ring->active;
         pthread_mutex_unlock(&ring->ring_lock);
 
-        new_counter = *ring_counter;
-        if (last_counter != new_counter)
+        vkd3d_shader_debug_ring_invalidate(ring, device);
+        new_counter = vkd3d_atomic_uint32_load_explicit(ring_counter, vkd3d_memory_order_acquire);
+
+        if (new_counter - read_counter > ring_words)
         {
-            count = (new_counter - last_counter) & ring_mask;
+            ERR("Debug ring overflowed, dropped %u words. Increase VKD3D_SHADER_DEBUG_RING_SIZE_LOG2.\n",
+                    new_counter - read_counter);
+            read_counter = new_counter;
+            stall_count = 0;
+        }
 
-            /* Assume that each iteration can safely use 1/4th of the buffer to avoid WAR hazards. */
-            if ((new_counter - last_counter) > (ring->ring_size / 16))
+        while (read_counter != new_counter)
+        {
+            available = new_counter - read_counter;
+
+            if (vkd3d_shader_debug_ring_message_is_complete(ring_base, ring_mask, read_counter, available, &word_count))
             {
-                ERR("Debug ring is probably too small (%u new words this iteration), increase size to avoid risk of dropping messages.\n",
-                    new_counter - last_counter);
+                vkd3d_shader_debug_ring_print_message(ring_base, ring_mask, read_counter, word_count);
+                read_counter += word_count;
+                stall_count = 0;
+                continue;
             }
 
-            for (i = 0; i < count; )
+            /* Messages from command buffers which are still executing will complete later.
+             * If they never do, skip ahead to the next complete one. */
+            if (is_active && ++stall_count < VKD3D_SHADER_DEBUG_RING_MAX_STALLS)
+                break;
+
+            for (offset = read_counter + 1; offset != new_counter; offset++)
             {
-#define READ_RING_WORD(off) ring_base[((off) + i + last_counter) & ring_mask]
-                message_word_count = READ_RING_WORD(0);
-                if (i + message_word_count > count)
-                    break;
-                if (message_word_count < 8 || message_word_count > 16 + 8)
+                if (vkd3d_shader_debug_ring_message_is_complete(ring_base, ring_mask,
+                        offset, new_counter - offset, &word_count))
                     break;
+            }
 
-                shader_hash = (uint64_t)READ_RING_WORD(1) | ((uint64_t)READ_RING_WORD(2) << 32);
-                debug_instance = READ_RING_WORD(3);
-                for (j = 0; j < 3; j++)
-                    debug_thread_id[j] = READ_RING_WORD(4 + j);
-                fmt = READ_RING_WORD(7);
-
-                snprintf(message_buffer, sizeof(message_buffer), "Shader: %"PRIx64": Instance %u, ID (%u, %u, %u):",
-                         shader_hash, debug_instance,
-                         debug_thread_id[0], debug_thread_id[1], debug_thread_id[2]);
-
-                i += 8;
-                message_word_count -= 8;
-
-                for (j = 0; j < message_word_count; j++)
-                {
-                    union
-                    {
-                        float f32;
-                        uint32_t u32;
-                        int32_t i32;
-                    } u;
-                    const char *delim;
-                    size_t len, avail;
-                    u.u32 = READ_RING_WORD(j);
-
-                    len = strlen(message_buffer);
-                    if (len + 1 >= sizeof(message_buffer))
-                        break;
-                    avail = sizeof(message_buffer) - len;
-
-                    delim = j == 0 ? " " : ", ";
-
-#define VKD3D_DEBUG_CHANNEL_FMT_HEX 0u
-#define VKD3D_DEBUG_CHANNEL_FMT_I32 1u
-#define VKD3D_DEBUG_CHANNEL_FMT_F32 2u
-                    switch ((fmt >> (2u * j)) & 3u)
-                    {
-                    case VKD3D_DEBUG_CHANNEL_FMT_HEX:
-                        snprintf(message_buffer + len, avail, "%s#%x", delim, u.u32);
-                        break;
+            WARN("Skipping %u words of incomplete debug ring messages.\n", offset - read_counter);
+            read_counter = offset;
+            stall_count = 0;
+        }
+    }
 
-                    case VKD3D_DEBUG_CHANNEL_FMT_I32:
-                        snprintf(message_buffer + len, avail, "%s%d", delim, u.i32);
-                        break;
+    return NULL;
+}
 
-                    case VKD3D_DEBUG_CHANNEL_FMT_F32:
-                        snprintf(message_buffer + len, avail, "%s%f", delim, u.f32);
-                        break;
+static void vkd3d_shader_debug_ring_init_filter(struct vkd3d_shader_debug_ring *ring)
+{
+    size_t filter_hashes_size = 0;
+    vkd3d_shader_hash_t hash;
+    const char *env;
+    char *endp;
 
-                    default:
-                        snprintf(message_buffer + len, avail, "%s????", delim);
-                        break;
-                    }
-                }
+    if (!(env = getenv("VKD3D_SHADER_DEBUG_RING_FILTER")))
+        return;
 
-                INFO("%s\n", message_buffer);
+    while (*env)
+    {
+        hash = strtoull(env, &endp, 16);
+        if (endp == env)
+            break;
 
-#undef READ_RING_WORD
-                i += message_word_count;
-            }
+        if (vkd3d_array_reserve((void **)&ring->filter_hashes, &filter_hashes_size,
+                ring->filter_hash_count + 1, sizeof(*ring->filter_hashes)))
+        {
+            INFO("Instrumenting shader %016"PRIx64" for debug ring.\n", hash);
+            ring->filter_hashes[ring->filter_hash_count++] = hash;
         }
-        last_counter = new_counter;
+
+        env = *endp == ',' ? endp + 1 : endp;
     }
+}
 
-    return NULL;
+bool vkd3d_shader_debug_ring_instruments_shader(const struct vkd3d_shader_debug_ring *ring,
+        const struct vkd3d_shader_code *code)
+{
+    size_t i;
+
+    if (!ring->active || !(code->meta.flags & VKD3D_SHADER_META_FLAG_REPLACED))
+        return false;
+
+    /* Shaders which are not instrumented see a zero ring address through their
+     * specialization constants, which compiles out all of the logging code. */
+    if (!ring->filter_hash_count)
+        return true;
+
+    for (i = 0; i < ring->filter_hash_count; i++)
+        if (ring->filter_hashes[i] == code->meta.hash)
+            return true;
+
+    return false;
+}
+
+void vkd3d_shader_debug_ring_kick(struct vkd3d_shader_debug_ring *ring)
+{
+    if (!ring->active)
+        return;
+
+    pthread_mutex_lock(&ring->ring_lock);
+    ring->kick_count++;
+    pthread_cond_signal(&ring->ring_cond);
+    pthread_mutex_unlock(&ring->ring_lock);
 }
 
 HRESULT vkd3d_shader_debug_ring_init(struct vkd3d_shader_debug_ring *ring,
@@ -189,9 +310,12 @@ HRESULT vkd3d_shader_debug_ring_init(struct vkd3d_shader_debug_ring *ring,
 
     WARN("Enabling shader debug ring of size: %zu.\n", ring->ring_size);
 
+    vkd3d_shader_debug_ring_init_filter(ring);
+
     if (!device->device_info.buffer_device_address_features.bufferDeviceAddress)
     {
         ERR("Buffer device address must be supported to use VKD3D_SHADER_DEBUG_RING feature.\n");
+        vkd3d_free(ring->filter_hashes);
         return E_INVALIDARG;
     }
 
@@ -261,6 +385,7 @@ err_free_buffers:
     VK_CALL(vkDestroyBuffer(device->vk_device, ring->device_atomic_buffer, NULL));
     vkd3d_free_device_memory(device, &ring->host_buffer_memory);
     vkd3d_free_device_memory(device, &ring->device_atomic_buffer_memory);
+    vkd3d_free(ring->filter_hashes);
     memset(ring, 0, sizeof(*ring));
     return E_OUTOFMEMORY;
 }
@@ -274,6 +399,7 @@ void vkd3d_shader_debug_ring_cleanup(struct vkd3d_shader_debug_ring *ring,
 
     pthread_mutex_lock(&ring->ring_lock);
     ring->active = false;
+    ring->kick_count++;
     pthread_cond_signal(&ring->ring_cond);
     pthread_mutex_unlock(&ring->ring_lock);
     pthread_join(ring->ring_thread, NULL);
@@ -284,6 +410,7 @@ void vkd3d_shader_debug_ring_cleanup(struct vkd3d_shader_debug_ring *ring,
     VK_CALL(vkDestroyBuffer(device->vk_device, ring->device_atomic_buffer, NULL));
     vkd3d_free_device_memory(device, &ring->host_buffer_memory);
     vkd3d_free_device_memory(device, &ring->device_atomic_buffer_memory);
+    vkd3d_free(ring->filter_hashes);
 }
 
 void vkd3d_shader_debug_ring_end_command_buffer(struct d3d12_command_list *list)
@@ -294,7 +421,7 @@ void vkd3d_shader_debug_ring_end_command_buffer(struct d3d12_command_list *list)
     VkMemoryBarrier barrier;
 
     if (list->device->debug_ring.active &&
-        list->has_replaced_shaders &&
+        list->uses_debug_ring &&
         (list->type == D3D12_COMMAND_LIST_TYPE_DIRECT || list->type == D3D12_COMMAND_LIST_TYPE_COMPUTE))
     {
         barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
@@ -308,7 +435,8 @@ void vkd3d_shader_debug_ring_end_command_buffer(struct d3d12_command_list *list)
 
         buffer_copy.sType = VK_STRUCTURE_TYPE_BUFFER_COPY_2_KHR;
         buffer_copy.pNext = NULL;
-        buffer_copy.size = list->device->debug_ring.ring_offset;
+        /* The host only reads the message counter. */
+        buffer_copy.size = sizeof(uint32_t);
         buffer_copy.dstOffset = 0;
         buffer_copy.srcOffset = 0;
 
@@ -30,6 +30,15 @@ static bool descriptor_debug_active_qa_checks;
 static bool descriptor_debug_active_log;
 static FILE *descriptor_debug_file;
 
+/* Logging every descriptor write is far too slow for long captures.
+ * The heap filter and sample rate only affect the log, heap info used by
+ * GPU-assisted checks is always kept exact. */
+#define VKD3D_DESCRIPTOR_DEBUG_MAX_LOG_HEAPS 16
+static uint64_t descriptor_debug_log_heaps[VKD3D_DESCRIPTOR_DEBUG_MAX_LOG_HEAPS];
+static unsigned int descriptor_debug_log_heap_count;
+static uint32_t descriptor_debug_log_sample_rate = 1;
+static uint32_t descriptor_debug_log_sample_counter;
+
 struct vkd3d_descriptor_qa_global_info
 {
     struct vkd3d_descriptor_qa_global_buffer_data *data;
@@ -89,6 +98,28 @@ static void vkd3d_descriptor_debug_init_once(void)
             descriptor_debug_active_log = true;
     }
 
+    if (descriptor_debug_active_log && (env = getenv("VKD3D_DESCRIPTOR_QA_LOG_HEAPS")))
+    {
+        char *endp;
+
+        while (*env && descriptor_debug_log_heap_count < VKD3D_DESCRIPTOR_DEBUG_MAX_LOG_HEAPS)
+        {
+            descriptor_debug_log_heaps[descriptor_debug_log_heap_count] = strtoull(env, &endp, 0);
+            if (endp == env)
+                break;
+            descriptor_debug_log_heap_count++;
+            env = *endp == ',' ? endp + 1 : endp;
+        }
+
+        INFO("Logging descriptor updates for %u heap(s) only.\n", descriptor_debug_log_heap_count);
+    }
+
+    if (descriptor_debug_active_log && (env = getenv("VKD3D_DESCRIPTOR_QA_LOG_SAMPLE_RATE")))
+    {
+        descriptor_debug_log_sample_rate = max(1, strtoul(env, NULL, 0));
+        INFO("Logging 1 out of %u descriptor updates.\n", descriptor_debug_log_sample_rate);
+    }
+
     if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_DESCRIPTOR_QA_CHECKS)
     {
         INFO("Enabling descriptor QA checks!\n");
@@ -111,6 +142,34 @@ bool vkd3d_descriptor_debug_active_qa_checks(void)
     return descriptor_debug_active_qa_checks;
 }
 
+bool vkd3d_descriptor_debug_active(void)
+{
+    return descriptor_debug_active_log || descriptor_debug_active_qa_checks;
+}
+
+static bool vkd3d_descriptor_debug_log_heap_selected(uint64_t heap_cookie)
+{
+    unsigned int i;
+
+    if (!descriptor_debug_log_heap_count)
+        return true;
+
+    for (i = 0; i < descriptor_debug_log_heap_count; i++)
+        if (descriptor_debug_log_heaps[i] == heap_cookie)
+            return true;
+
+    return false;
+}
+
+static bool vkd3d_descriptor_debug_log_sampled(void)
+{
+    if (descriptor_debug_log_sample_rate <= 1)
+        return true;
+
+    return vkd3d_atomic_uint32_increment(&descriptor_debug_log_sample_counter,
+            vkd3d_memory_order_relaxed) % descriptor_debug_log_sample_rate == 0;
+}
+
 VkDeviceSize vkd3d_descriptor_debug_heap_info_size(unsigned int num_descriptors)
 {
     return offsetof(struct vkd3d_descriptor_qa_heap_buffer_data, desc) + num_descriptors *
@@ -505,7 +564,8 @@ void vkd3d_descriptor_debug_write_descriptor(struct vkd3d_descriptor_qa_heap_buf
         heap->desc[offset].descriptor_type = type_flags;
     }
 
-    if (!vkd3d_descriptor_debug_active_log())
+    if (!vkd3d_descriptor_debug_active_log() || !vkd3d_descriptor_debug_log_heap_selected(heap_cookie) ||
+            !vkd3d_descriptor_debug_log_sampled())
         return;
     APPEND_SNPRINTF("WRITE HEAP %"PRIu64" || OFFSET = %u || TYPE = %s || COOKIE = #%"PRIu64,
             heap_cookie, offset, debug_descriptor_type(type_flags), cookie);
@@ -524,6 +584,11 @@ void vkd3d_descriptor_debug_copy_descriptor(
 
     if (!vkd3d_descriptor_debug_active_log())
         return;
+    if (!vkd3d_descriptor_debug_log_heap_selected(dst_heap_cookie) &&
+            !vkd3d_descriptor_debug_log_heap_selected(src_heap_cookie))
+        return;
+    if (!vkd3d_descriptor_debug_log_sampled())
+        return;
     APPEND_SNPRINTF("COPY DST HEAP %"PRIu64" || DST OFFSET = %u || COOKIE = #%"PRIu64" || SRC HEAP %"PRIu64" || SRC OFFSET = %u",
             dst_heap_cookie, dst_offset, cookie, src_heap_cookie, src_offset);
     FLUSH_BUFFER();
@@ -80,6 +80,10 @@ static const struct vkd3d_optional_extension_info optional_device_extensions[] =
     VK_EXTENSION(KHR_SHADER_ATOMIC_INT64, KHR_shader_atomic_int64),
     VK_EXTENSION(KHR_BIND_MEMORY_2, KHR_bind_memory2),
     VK_EXTENSION(KHR_COPY_COMMANDS_2, KHR_copy_commands2),
+    VK_EXTENSION(KHR_SYNCHRONIZATION_2, KHR_synchronization2),
+    VK_EXTENSION(KHR_DYNAMIC_RENDERING, KHR_dynamic_rendering),
+    VK_EXTENSION_COND(KHR_PRESENT_ID, KHR_present_id, VKD3D_CONFIG_FLAG_LOW_LATENCY),
+    VK_EXTENSION_COND(KHR_PRESENT_WAIT, KHR_present_wait, VKD3D_CONFIG_FLAG_LOW_LATENCY),
     /* EXT extensions */
     VK_EXTENSION(EXT_CALIBRATED_TIMESTAMPS, EXT_calibrated_timestamps),
     VK_EXTENSION(EXT_CONDITIONAL_RENDERING, EXT_conditional_rendering),
@@ -99,7 +103,13 @@ static const struct vkd3d_optional_extension_info optional_device_extensions[] =
     VK_EXTENSION(EXT_TRANSFORM_FEEDBACK, EXT_transform_feedback),
     VK_EXTENSION(EXT_VERTEX_ATTRIBUTE_DIVISOR, EXT_vertex_attribute_divisor),
     VK_EXTENSION(EXT_EXTENDED_DYNAMIC_STATE, EXT_extended_dynamic_state),
+    VK_EXTENSION(EXT_EXTENDED_DYNAMIC_STATE_2, EXT_extended_dynamic_state2),
+    VK_EXTENSION(EXT_VERTEX_INPUT_DYNAMIC_STATE, EXT_vertex_input_dynamic_state),
+    VK_EXTENSION(EXT_MEMORY_BUDGET, EXT_memory_budget),
+    VK_EXTENSION(EXT_MEMORY_PRIORITY, EXT_memory_priority),
+    VK_EXTENSION(EXT_PAGEABLE_DEVICE_LOCAL_MEMORY, EXT_pageable_device_local_memory),
     VK_EXTENSION(EXT_EXTERNAL_MEMORY_HOST, EXT_external_memory_host),
+    VK_EXTENSION(EXT_HOST_QUERY_RESET, EXT_host_query_reset),
     VK_EXTENSION(EXT_4444_FORMATS, EXT_4444_formats),
     VK_EXTENSION(EXT_SHADER_IMAGE_ATOMIC_INT64, EXT_shader_image_atomic_int64),
     VK_EXTENSION(EXT_SCALAR_BLOCK_LAYOUT, EXT_scalar_block_layout),
@@ -114,6 +124,7 @@ static const struct vkd3d_optional_extension_info optional_device_extensions[] =
     VK_EXTENSION(NVX_IMAGE_VIEW_HANDLE, NVX_image_view_handle),
     VK_EXTENSION(NV_FRAGMENT_SHADER_BARYCENTRIC, NV_fragment_shader_barycentric),
     VK_EXTENSION(NV_COMPUTE_SHADER_DERIVATIVES, NV_compute_shader_derivatives),
+    VK_EXTENSION(NV_DEVICE_GENERATED_COMMANDS, NV_device_generated_commands),
     /* VALVE extensions */
     VK_EXTENSION(VALVE_MUTABLE_DESCRIPTOR_TYPE, VALVE_mutable_descriptor_type),
 };
@@ -619,6 +630,20 @@ static const struct vkd3d_debug_option vkd3d_config_options[] =
     {"memory_allocator_skip_clear", VKD3D_CONFIG_FLAG_MEMORY_ALLOCATOR_SKIP_CLEAR},
     {"recycle_command_pools", VKD3D_CONFIG_FLAG_RECYCLE_COMMAND_POOLS},
     {"pipeline_library_ignore_mismatch_driver", VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_IGNORE_MISMATCH_DRIVER},
+    {"deferred_command_lists", VKD3D_CONFIG_FLAG_DEFERRED_COMMAND_LIST_TRANSLATION},
+    {"bake_bundles", VKD3D_CONFIG_FLAG_BAKE_BUNDLES},
+    {"small_buffer_slabs", VKD3D_CONFIG_FLAG_SMALL_BUFFER_SLABS},
+    {"recycle_committed_resources", VKD3D_CONFIG_FLAG_RECYCLE_COMMITTED_RESOURCES},
+    {"async_pipeline_compile", VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE},
+    {"pipeline_library_compress", VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_COMPRESS},
+    {"pipeline_warmup", VKD3D_CONFIG_FLAG_PIPELINE_WARMUP},
+    {"optimize_spirv", VKD3D_CONFIG_FLAG_OPTIMIZE_SPIRV},
+    {"meta_prewarm", VKD3D_CONFIG_FLAG_META_PREWARM},
+    {"low_latency", VKD3D_CONFIG_FLAG_LOW_LATENCY},
+    {"event_profile", VKD3D_CONFIG_FLAG_EVENT_PROFILE},
+    {"transfer_offload", VKD3D_CONFIG_FLAG_TRANSFER_OFFLOAD},
+    {"hoist_srv_uav", VKD3D_CONFIG_FLAG_HOIST_SRV_UAV},
+    {"huge_pages", VKD3D_CONFIG_FLAG_HUGE_PAGES},
 };
 
 static void vkd3d_config_flags_init_once(void)
@@ -1240,12 +1265,42 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
         vk_prepend_struct(&info->features2, &info->extended_dynamic_state_features);
     }
 
+    if (vulkan_info->EXT_extended_dynamic_state2)
+    {
+        info->extended_dynamic_state2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+        vk_prepend_struct(&info->features2, &info->extended_dynamic_state2_features);
+    }
+
+    if (vulkan_info->EXT_vertex_input_dynamic_state)
+    {
+        info->vertex_input_dynamic_state_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VERTEX_INPUT_DYNAMIC_STATE_FEATURES_EXT;
+        vk_prepend_struct(&info->features2, &info->vertex_input_dynamic_state_features);
+    }
+
+    if (vulkan_info->EXT_memory_priority)
+    {
+        info->memory_priority_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT;
+        vk_prepend_struct(&info->features2, &info->memory_priority_features);
+    }
+
+    if (vulkan_info->EXT_pageable_device_local_memory)
+    {
+        info->pageable_device_local_memory_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT;
+        vk_prepend_struct(&info->features2, &info->pageable_device_local_memory_features);
+    }
+
     if (vulkan_info->EXT_external_memory_host)
     {
         info->external_memory_host_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
         vk_prepend_struct(&info->properties2, &info->external_memory_host_properties);
     }
 
+    if (vulkan_info->EXT_host_query_reset)
+    {
+        info->host_query_reset_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
+        vk_prepend_struct(&info->features2, &info->host_query_reset_features);
+    }
+
     if (vulkan_info->EXT_4444_formats)
     {
         info->ext_4444_formats_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_4444_FORMATS_FEATURES_EXT;
@@ -1346,6 +1401,16 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
         vk_prepend_struct(&info->features2, &info->compute_shader_derivatives_features_nv);
     }
 
+    if (vulkan_info->NV_device_generated_commands)
+    {
+        info->device_generated_commands_features_nv.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEVICE_GENERATED_COMMANDS_FEATURES_NV;
+        info->device_generated_commands_properties_nv.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DEVICE_GENERATED_COMMANDS_PROPERTIES_NV;
+        vk_prepend_struct(&info->features2, &info->device_generated_commands_features_nv);
+        vk_prepend_struct(&info->properties2, &info->device_generated_commands_properties_nv);
+    }
+
     if (vulkan_info->KHR_shader_atomic_int64)
     {
         info->shader_atomic_int64_features.sType =
@@ -1367,6 +1432,32 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
         vk_prepend_struct(&info->features2, &info->scalar_block_layout_features);
     }
 
+    if (vulkan_info->KHR_synchronization2)
+    {
+        info->synchronization2_features.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        vk_prepend_struct(&info->features2, &info->synchronization2_features);
+    }
+
+    if (vulkan_info->KHR_dynamic_rendering)
+    {
+        info->dynamic_rendering_features.sType =
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        vk_prepend_struct(&info->features2, &info->dynamic_rendering_features);
+    }
+
+    if (vulkan_info->KHR_present_id)
+    {
+        info->present_id_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        vk_prepend_struct(&info->features2, &info->present_id_features);
+    }
+
+    if (vulkan_info->KHR_present_wait)
+    {
+        info->present_wait_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        vk_prepend_struct(&info->features2, &info->present_wait_features);
+    }
+
     /* Core in Vulkan 1.1. */
     info->shader_draw_parameters_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DRAW_PARAMETERS_FEATURES;
     vk_prepend_struct(&info->features2, &info->shader_draw_parameters_features);
@@ -1862,6 +1953,10 @@ static HRESULT vkd3d_init_device_caps(struct d3d12_device *device,
     if (!physical_device_info->texel_buffer_alignment_features.texelBufferAlignment)
         vulkan_info->EXT_texel_buffer_alignment = false;
 
+    /* Eviction works by changing memory priorities, which pageable memory depends on. */
+    if (!physical_device_info->memory_priority_features.memoryPriority)
+        physical_device_info->pageable_device_local_memory_features.pageableDeviceLocalMemory = VK_FALSE;
+
     vulkan_info->texel_buffer_alignment_properties = physical_device_info->texel_buffer_alignment_properties;
     vulkan_info->vertex_attrib_zero_divisor = physical_device_info->vertex_divisor_features.vertexAttributeInstanceRateZeroDivisor;
 
@@ -2077,6 +2172,7 @@ static HRESULT d3d12_device_create_vkd3d_queues(struct d3d12_device *device,
 
     device->unique_queue_mask = 0;
     device->queue_family_count = 0;
+    device->buffer_queue_family_count = 0;
     memset(device->queue_families, 0, sizeof(device->queue_families));
     memset(device->queue_family_indices, 0, sizeof(device->queue_family_indices));
 
@@ -2122,9 +2218,14 @@ static HRESULT d3d12_device_create_vkd3d_queues(struct d3d12_device *device,
         info->timestamp_bits = queue_info->vk_properties[i].timestampValidBits;
 
         device->queue_families[i] = info;
-        device->queue_family_indices[device->queue_family_count++] = info->vk_family_index;
 
-        if (info->queue_count && i != VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE)
+        /* The internal transfer family comes last, so it can
+         * be left out of the image sharing list. */
+        device->queue_family_indices[device->buffer_queue_family_count++] = info->vk_family_index;
+        if (i != VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER)
+            device->queue_family_count = device->buffer_queue_family_count;
+
+        if (info->queue_count && i < VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE)
             device->unique_queue_mask |= 1u << i;
     }
 
@@ -2176,8 +2277,20 @@ static HRESULT vkd3d_select_queues(const struct vkd3d_instance *vkd3d_instance,
     info->family_index[VKD3D_QUEUE_FAMILY_COMPUTE] = vkd3d_find_queue(count, queue_properties,
             VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, VK_QUEUE_COMPUTE_BIT);
 
-    info->family_index[VKD3D_QUEUE_FAMILY_SPARSE_BINDING] = vkd3d_find_queue(count, queue_properties,
-            VK_QUEUE_SPARSE_BINDING_BIT, VK_QUEUE_SPARSE_BINDING_BIT);
+    /* Prefer a family which can do nothing but sparse binding and transfers,
+     * so that slow binds never stall queues with rendering work on them. */
+    info->family_index[VKD3D_QUEUE_FAMILY_SPARSE_BINDING] = VK_QUEUE_FAMILY_IGNORED;
+    if (!single_queue)
+    {
+        info->family_index[VKD3D_QUEUE_FAMILY_SPARSE_BINDING] = vkd3d_find_queue(count, queue_properties,
+                VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_SPARSE_BINDING_BIT, VK_QUEUE_SPARSE_BINDING_BIT);
+    }
+
+    if (info->family_index[VKD3D_QUEUE_FAMILY_SPARSE_BINDING] == VK_QUEUE_FAMILY_IGNORED)
+    {
+        info->family_index[VKD3D_QUEUE_FAMILY_SPARSE_BINDING] = vkd3d_find_queue(count, queue_properties,
+                VK_QUEUE_SPARSE_BINDING_BIT, VK_QUEUE_SPARSE_BINDING_BIT);
+    }
 
     if (info->family_index[VKD3D_QUEUE_FAMILY_COMPUTE] == VK_QUEUE_FAMILY_IGNORED)
         info->family_index[VKD3D_QUEUE_FAMILY_COMPUTE] = info->family_index[VKD3D_QUEUE_FAMILY_GRAPHICS];
@@ -2186,6 +2299,18 @@ static HRESULT vkd3d_select_queues(const struct vkd3d_instance *vkd3d_instance,
     info->family_index[VKD3D_QUEUE_FAMILY_TRANSFER] = info->family_index[VKD3D_QUEUE_FAMILY_COMPUTE];
     info->family_index[VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE] = info->family_index[VKD3D_QUEUE_FAMILY_COMPUTE];
 
+    /* Zero-clears of new allocations go to a dedicated DMA family if there is one,
+     * so that they do not compete with internal compute work. */
+    info->family_index[VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER] = VK_QUEUE_FAMILY_IGNORED;
+    if (!single_queue)
+    {
+        info->family_index[VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER] = vkd3d_find_queue(count, queue_properties,
+                VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT, VK_QUEUE_TRANSFER_BIT);
+    }
+
+    if (info->family_index[VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER] == VK_QUEUE_FAMILY_IGNORED)
+        info->family_index[VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER] = info->family_index[VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE];
+
     if (single_queue)
     {
         info->family_index[VKD3D_QUEUE_FAMILY_COMPUTE] = info->family_index[VKD3D_QUEUE_FAMILY_GRAPHICS];
@@ -2410,20 +2535,23 @@ static void d3d12_remove_device_singleton(LUID luid)
     }
 }
 
-static HRESULT d3d12_device_create_scratch_buffer(struct d3d12_device *device, VkDeviceSize size, struct vkd3d_scratch_buffer *scratch)
+static HRESULT d3d12_device_create_scratch_buffer(struct d3d12_device *device, VkDeviceSize size,
+        uint32_t memory_types, struct vkd3d_scratch_buffer *scratch)
 {
-    struct vkd3d_allocate_heap_memory_info alloc_info;
+    struct vkd3d_allocate_memory_info alloc_info;
     HRESULT hr;
 
-    TRACE("device %p, size %llu, scratch %p.\n", device, size, scratch);
+    TRACE("device %p, size %llu, memory_types %#x, scratch %p.\n", device, size, memory_types, scratch);
 
     memset(&alloc_info, 0, sizeof(alloc_info));
-    alloc_info.heap_desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-    alloc_info.heap_desc.SizeInBytes = size;
-    alloc_info.heap_desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-    alloc_info.heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
-
-    if (FAILED(hr = vkd3d_allocate_heap_memory(device, &device->memory_allocator,
+    alloc_info.memory_requirements.memoryTypeBits = memory_types;
+    alloc_info.memory_requirements.alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    alloc_info.memory_requirements.size = size;
+    alloc_info.heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    alloc_info.heap_flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    alloc_info.flags = VKD3D_ALLOCATION_FLAG_GLOBAL_BUFFER;
+
+    if (FAILED(hr = vkd3d_allocate_memory(device, &device->memory_allocator,
             &alloc_info, &scratch->allocation)))
         return hr;
 
@@ -2438,42 +2566,104 @@ static void d3d12_device_destroy_scratch_buffer(struct d3d12_device *device, con
     vkd3d_free_memory(device, &device->memory_allocator, &scratch->allocation);
 }
 
-HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, VkDeviceSize min_size, struct vkd3d_scratch_buffer *scratch)
+static unsigned int vkd3d_scratch_buffer_get_size_class(VkDeviceSize size)
+{
+    unsigned int size_class;
+
+    for (size_class = 0; size_class < VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT; size_class++)
+    {
+        if (size <= (VKD3D_SCRATCH_BUFFER_SIZE << size_class))
+            break;
+    }
+
+    return size_class;
+}
+
+static void d3d12_device_scratch_pool_add_live_size_locked(struct d3d12_device *device, VkDeviceSize size)
+{
+    struct vkd3d_scratch_pool_stats *stats = &device->scratch_pool_stats;
+
+    stats->live_size += size;
+    if (stats->live_size > stats->peak_live_size)
+        stats->peak_live_size = stats->live_size;
+}
+
+HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, VkDeviceSize min_size,
+        uint32_t memory_types, struct vkd3d_scratch_buffer *scratch)
 {
-    if (min_size > VKD3D_SCRATCH_BUFFER_SIZE)
-        return d3d12_device_create_scratch_buffer(device, min_size, scratch);
+    unsigned int size_class = vkd3d_scratch_buffer_get_size_class(min_size);
+    struct vkd3d_scratch_pool *pool;
+    VkDeviceSize size;
+    unsigned int i;
+    HRESULT hr;
+
+    size = size_class < VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT ? VKD3D_SCRATCH_BUFFER_SIZE << size_class : min_size;
 
     pthread_mutex_lock(&device->mutex);
 
-    if (device->scratch_buffer_count)
+    if (size_class < VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT)
     {
-        *scratch = device->scratch_buffers[--device->scratch_buffer_count];
-        scratch->offset = 0;
-        pthread_mutex_unlock(&device->mutex);
-        return S_OK;
+        pool = &device->scratch_pools[size_class];
+
+        for (i = pool->buffer_count; i; i--)
+        {
+            if (!(memory_types & (1u << pool->buffers[i - 1].allocation.device_allocation.vk_memory_type)))
+                continue;
+
+            *scratch = pool->buffers[i - 1];
+            pool->buffers[i - 1] = pool->buffers[--pool->buffer_count];
+            scratch->offset = 0;
+
+            device->scratch_pool_size -= size;
+            device->scratch_pool_stats.reused_count++;
+            d3d12_device_scratch_pool_add_live_size_locked(device, size);
+            pthread_mutex_unlock(&device->mutex);
+            return S_OK;
+        }
     }
-    else
+
+    device->scratch_pool_stats.created_count++;
+    d3d12_device_scratch_pool_add_live_size_locked(device, size);
+    pthread_mutex_unlock(&device->mutex);
+
+    if (FAILED(hr = d3d12_device_create_scratch_buffer(device, size, memory_types, scratch)))
     {
+        pthread_mutex_lock(&device->mutex);
+        device->scratch_pool_stats.live_size -= size;
         pthread_mutex_unlock(&device->mutex);
-        return d3d12_device_create_scratch_buffer(device, VKD3D_SCRATCH_BUFFER_SIZE, scratch);
     }
+
+    return hr;
 }
 
 void d3d12_device_return_scratch_buffer(struct d3d12_device *device, const struct vkd3d_scratch_buffer *scratch)
 {
+    VkDeviceSize size = scratch->allocation.resource.size;
+    unsigned int size_class = vkd3d_scratch_buffer_get_size_class(size);
+    struct vkd3d_scratch_pool *pool;
+
     pthread_mutex_lock(&device->mutex);
 
-    if (scratch->allocation.resource.size == VKD3D_SCRATCH_BUFFER_SIZE &&
-            device->scratch_buffer_count < VKD3D_SCRATCH_BUFFER_COUNT)
-    {
-        device->scratch_buffers[device->scratch_buffer_count++] = *scratch;
-        pthread_mutex_unlock(&device->mutex);
-    }
-    else
+    device->scratch_pool_stats.live_size -= size;
+
+    if (size_class < VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT &&
+            size == (VKD3D_SCRATCH_BUFFER_SIZE << size_class) &&
+            device->scratch_pool_size + size <= VKD3D_SCRATCH_POOL_MAX_SIZE)
     {
-        pthread_mutex_unlock(&device->mutex);
-        d3d12_device_destroy_scratch_buffer(device, scratch);
+        pool = &device->scratch_pools[size_class];
+
+        if (vkd3d_array_reserve((void **)&pool->buffers, &pool->buffers_size,
+                pool->buffer_count + 1, sizeof(*pool->buffers)))
+        {
+            pool->buffers[pool->buffer_count++] = *scratch;
+            device->scratch_pool_size += size;
+            pthread_mutex_unlock(&device->mutex);
+            return;
+        }
     }
+
+    pthread_mutex_unlock(&device->mutex);
+    d3d12_device_destroy_scratch_buffer(device, scratch);
 }
 
 uint64_t d3d12_device_get_descriptor_heap_gpu_va(struct d3d12_device *device)
@@ -2503,31 +2693,36 @@ void d3d12_device_return_descriptor_heap_gpu_va(struct d3d12_device *device, uin
     pthread_mutex_unlock(&device->mutex);
 }
 
-static HRESULT d3d12_device_create_query_pool(struct d3d12_device *device, uint32_t type_index, struct vkd3d_query_pool *pool)
+static uint32_t vkd3d_virtual_query_pool_default_size(uint32_t type_index)
+{
+    /* Expect a large number of occlusion queries
+     * to be used within a single command list */
+    return type_index == VKD3D_QUERY_TYPE_INDEX_OCCLUSION ? 4096 : 128;
+}
+
+static HRESULT d3d12_device_create_query_pool(struct d3d12_device *device, uint32_t type_index,
+        uint32_t query_count, struct vkd3d_query_pool *pool)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkQueryPoolCreateInfo pool_info;
     VkResult vr;
 
-    TRACE("device %p, type_index %u, pool %p.\n", device, type_index, pool);
+    TRACE("device %p, type_index %u, query_count %u, pool %p.\n", device, type_index, query_count, pool);
 
     pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
     pool_info.pNext = NULL;
     pool_info.flags = 0;
+    pool_info.queryCount = query_count;
     pool_info.pipelineStatistics = 0;
 
     switch (type_index)
     {
         case VKD3D_QUERY_TYPE_INDEX_OCCLUSION:
-            /* Expect a large number of occlusion queries
-             * to be used within a single command list */
             pool_info.queryType = VK_QUERY_TYPE_OCCLUSION;
-            pool_info.queryCount = 4096;
             break;
 
         case VKD3D_QUERY_TYPE_INDEX_PIPELINE_STATISTICS:
             pool_info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
-            pool_info.queryCount = 128;
             pool_info.pipelineStatistics =
                     VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
                     VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
@@ -2544,17 +2739,14 @@ static HRESULT d3d12_device_create_query_pool(struct d3d12_device *device, uint3
 
         case VKD3D_QUERY_TYPE_INDEX_TRANSFORM_FEEDBACK:
             pool_info.queryType = VK_QUERY_TYPE_TRANSFORM_FEEDBACK_STREAM_EXT;
-            pool_info.queryCount = 128;
             break;
 
         case VKD3D_QUERY_TYPE_INDEX_RT_COMPACTED_SIZE:
             pool_info.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
-            pool_info.queryCount = 128;
             break;
 
         case VKD3D_QUERY_TYPE_INDEX_RT_SERIALIZE_SIZE:
             pool_info.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_SERIALIZATION_SIZE_KHR;
-            pool_info.queryCount = 128;
             break;
 
         default:
@@ -2568,6 +2760,9 @@ static HRESULT d3d12_device_create_query_pool(struct d3d12_device *device, uint3
         return hresult_from_vk_result(vr);
     }
 
+    if (d3d12_device_use_host_query_reset(device))
+        VK_CALL(vkResetQueryPoolEXT(device->vk_device, pool->vk_query_pool, 0, pool_info.queryCount));
+
     pool->type_index = type_index;
     pool->query_count = pool_info.queryCount;
     pool->next_index = 0;
@@ -2583,47 +2778,183 @@ static void d3d12_device_destroy_query_pool(struct d3d12_device *device, const s
     VK_CALL(vkDestroyQueryPool(device->vk_device, pool->vk_query_pool, NULL));
 }
 
-HRESULT d3d12_device_get_query_pool(struct d3d12_device *device, uint32_t type_index, struct vkd3d_query_pool *pool)
+static uint32_t d3d12_device_get_query_pool_size(struct d3d12_device *device, uint32_t type_index)
+{
+    if (!device->query_pool_sizes[type_index])
+        device->query_pool_sizes[type_index] = vkd3d_virtual_query_pool_default_size(type_index);
+    return device->query_pool_sizes[type_index];
+}
+
+HRESULT d3d12_device_get_query_pool(struct d3d12_device *device, uint32_t type_index,
+        bool grow, struct vkd3d_query_pool *pool)
 {
+    uint32_t query_count, max_query_count;
     size_t i;
 
     pthread_mutex_lock(&device->mutex);
 
-    for (i = 0; i < device->query_pool_count; i++)
+    query_count = d3d12_device_get_query_pool_size(device, type_index);
+
+    /* The caller ran out of queries in a single pool, make new pools larger
+     * so that heavy query users get by with fewer of them. */
+    if (grow)
     {
-        if (device->query_pools[i].type_index == type_index)
+        max_query_count = vkd3d_virtual_query_pool_default_size(type_index) * VKD3D_VIRTUAL_QUERY_POOL_MAX_GROWTH;
+        query_count = min(query_count * 2, max_query_count);
+        device->query_pool_sizes[type_index] = query_count;
+    }
+
+    for (i = 0; i < device->query_pool_count; )
+    {
+        if (device->query_pools[i].type_index != type_index)
+        {
+            i++;
+            continue;
+        }
+
+        *pool = device->query_pools[i];
+        if (--device->query_pool_count != i)
+            device->query_pools[i] = device->query_pools[device->query_pool_count];
+
+        if (pool->query_count >= query_count)
         {
-            *pool = device->query_pools[i];
             pool->next_index = 0;
-            if (--device->query_pool_count != i)
-                device->query_pools[i] = device->query_pools[device->query_pool_count];
+            device->query_pool_stats.reused_count++;
             pthread_mutex_unlock(&device->mutex);
             return S_OK;
         }
+
+        /* Retire pools which have been outgrown rather than recycling them. */
+        device->query_pool_stats.retired_count++;
+        d3d12_device_destroy_query_pool(device, pool);
     }
 
+    device->query_pool_stats.created_count++;
     pthread_mutex_unlock(&device->mutex);
-    return d3d12_device_create_query_pool(device, type_index, pool);
+    return d3d12_device_create_query_pool(device, type_index, query_count, pool);
 }
 
 void d3d12_device_return_query_pool(struct d3d12_device *device, const struct vkd3d_query_pool *pool)
 {
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    /* Pools are only returned once the GPU is done with them,
+     * so resetting here moves the reset off the command buffer. */
+    if (d3d12_device_use_host_query_reset(device))
+        VK_CALL(vkResetQueryPoolEXT(device->vk_device, pool->vk_query_pool, 0, pool->query_count));
+
     pthread_mutex_lock(&device->mutex);
 
-    if (device->query_pool_count < VKD3D_VIRTUAL_QUERY_POOL_COUNT)
+    if (pool->query_count < d3d12_device_get_query_pool_size(device, pool->type_index))
+    {
+        device->query_pool_stats.retired_count++;
+        pthread_mutex_unlock(&device->mutex);
+        d3d12_device_destroy_query_pool(device, pool);
+    }
+    else if (device->query_pool_count < VKD3D_VIRTUAL_QUERY_POOL_COUNT)
     {
         device->query_pools[device->query_pool_count++] = *pool;
         pthread_mutex_unlock(&device->mutex);
     }
     else
     {
+        device->query_pool_stats.overflow_count++;
         pthread_mutex_unlock(&device->mutex);
         d3d12_device_destroy_query_pool(device, pool);
     }
 }
 
+static struct vkd3d_command_pool_cache *d3d12_device_get_command_pool_cache(struct d3d12_device *device,
+        uint32_t vk_family_index)
+{
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_QUEUE_FAMILY_COUNT; i++)
+    {
+        if (device->queue_families[i]->vk_family_index == vk_family_index)
+            return &device->command_pool_caches[i];
+    }
+
+    return NULL;
+}
+
+VkCommandPool d3d12_device_get_cached_command_pool(struct d3d12_device *device, uint32_t vk_family_index)
+{
+    VkCommandPool vk_command_pool = VK_NULL_HANDLE;
+    struct vkd3d_command_pool_cache *cache;
+
+    if (!(cache = d3d12_device_get_command_pool_cache(device, vk_family_index)))
+        return VK_NULL_HANDLE;
+
+    spinlock_acquire(&cache->spinlock);
+
+    if (cache->vk_command_pool_count)
+    {
+        vk_command_pool = cache->vk_command_pools[--cache->vk_command_pool_count];
+        cache->stats.hit_count++;
+    }
+    else
+        cache->stats.miss_count++;
+
+    spinlock_release(&cache->spinlock);
+    return vk_command_pool;
+}
+
+bool d3d12_device_return_command_pool(struct d3d12_device *device, uint32_t vk_family_index,
+        VkCommandPool vk_command_pool, bool trim)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_command_pool_cache *cache;
+    uint32_t max_count;
+    VkResult vr;
+
+    if (!(cache = d3d12_device_get_command_pool_cache(device, vk_family_index)))
+        return false;
+
+    /* Keeping pool memory around is only worth it for apps known to churn allocators. */
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_RECYCLE_COMMAND_POOLS)
+    {
+        max_count = VKD3D_COMMAND_POOL_CACHE_SIZE_RECYCLE;
+        trim = false;
+    }
+    else
+        max_count = VKD3D_COMMAND_POOL_CACHE_SIZE;
+
+    /* Racy, but a stale count only means that we reset a pool we end up destroying. */
+    if (vkd3d_atomic_uint32_load_explicit(&cache->vk_command_pool_count, vkd3d_memory_order_relaxed) >= max_count)
+    {
+        spinlock_acquire(&cache->spinlock);
+        cache->stats.overflow_count++;
+        spinlock_release(&cache->spinlock);
+        return false;
+    }
+
+    if ((vr = VK_CALL(vkResetCommandPool(device->vk_device, vk_command_pool,
+            trim ? VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT : 0))))
+    {
+        WARN("Failed to reset command pool, vr %d.\n", vr);
+        return false;
+    }
+
+    spinlock_acquire(&cache->spinlock);
+
+    if (cache->vk_command_pool_count >= max_count)
+    {
+        cache->stats.overflow_count++;
+        spinlock_release(&cache->spinlock);
+        return false;
+    }
+
+    cache->vk_command_pools[cache->vk_command_pool_count++] = vk_command_pool;
+    if (trim)
+        cache->stats.trim_count++;
+
+    spinlock_release(&cache->spinlock);
+    return true;
+}
+
 /* ID3D12Device */
-extern ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_AddRef(ID3D12DeviceExt *iface);
+extern ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_AddRef(d3d12_device_vkd3d_ext_iface *iface);
 
 HRESULT STDMETHODCALLTYPE d3d12_device_QueryInterface(d3d12_device_iface *iface,
         REFIID riid, void **object)
@@ -2648,7 +2979,8 @@ HRESULT STDMETHODCALLTYPE d3d12_device_QueryInterface(d3d12_device_iface *iface,
         return S_OK;
     }
 
-    if (IsEqualGUID(riid, &IID_ID3D12DeviceExt))
+    if (IsEqualGUID(riid, &IID_ID3D12DeviceExt)
+            || IsEqualGUID(riid, &IID_ID3D12DeviceExt1))
     {
         struct d3d12_device *device = impl_from_ID3D12Device(iface);
         d3d12_device_vkd3d_ext_AddRef(&device->ID3D12DeviceExt_iface);
@@ -2717,16 +3049,80 @@ static void d3d12_device_global_pipeline_cache_cleanup(struct d3d12_device *devi
 static void d3d12_device_destroy(struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    size_t i;
+    size_t i, j;
+
+    /* Warm-up replays pipelines from the disk cache, so it has to stop first. */
+    vkd3d_pipeline_warmup_stop(&device->pipeline_warmup, device);
 
-    for (i = 0; i < device->scratch_buffer_count; i++)
-        d3d12_device_destroy_scratch_buffer(device, &device->scratch_buffers[i]);
+    /* All pipeline states are gone, so the cache can be flushed for the last time. */
+    vkd3d_disk_cache_cleanup(&device->disk_cache, device);
+
+    /* All command lists hold a device reference, so nothing can be left to translate. */
+    vkd3d_command_list_translator_stop(&device->command_list_translator, device);
+    /* Likewise, pipeline states cancel their pending compiles when destroyed. */
+    vkd3d_pipeline_compile_worker_stop(&device->pipeline_compile_worker, device);
+    vkd3d_task_pool_stop(&device->task_pool, device);
+
+    /* Waits for all outstanding fences to be signalled. */
+    vkd3d_fence_worker_stop(&device->fence_worker, device);
+    vkd3d_sparse_worker_stop(&device->sparse_worker, device);
+
+    /* Anything still waiting for the GPU has been handed to the pool by now. */
+    vkd3d_resource_recycle_pool_cleanup(&device->resource_recycle_pool, device);
+
+    if (device->scratch_pool_stats.created_count)
+    {
+        TRACE("Scratch buffers: %"PRIu64" created, %"PRIu64" reused, peak live size %"PRIu64" bytes.\n",
+                device->scratch_pool_stats.created_count, device->scratch_pool_stats.reused_count,
+                (uint64_t)device->scratch_pool_stats.peak_live_size);
+    }
+
+    for (i = 0; i < VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT; i++)
+    {
+        for (j = 0; j < device->scratch_pools[i].buffer_count; j++)
+            d3d12_device_destroy_scratch_buffer(device, &device->scratch_pools[i].buffers[j]);
+        vkd3d_free(device->scratch_pools[i].buffers);
+    }
+
+    if (device->query_pool_stats.created_count)
+    {
+        TRACE("Virtual query pools: %"PRIu64" created, %"PRIu64" reused, %"PRIu64" retired, %"PRIu64" overflowed.\n",
+                device->query_pool_stats.created_count, device->query_pool_stats.reused_count,
+                device->query_pool_stats.retired_count, device->query_pool_stats.overflow_count);
+        TRACE("Final occlusion query pool size %u.\n",
+                d3d12_device_get_query_pool_size(device, VKD3D_QUERY_TYPE_INDEX_OCCLUSION));
+    }
 
     for (i = 0; i < device->query_pool_count; i++)
         d3d12_device_destroy_query_pool(device, &device->query_pools[i]);
 
-    for (i = 0; i < device->cached_command_allocator_count; i++)
-        VK_CALL(vkDestroyCommandPool(device->vk_device, device->cached_command_allocators[i].vk_command_pool, NULL));
+    for (i = 0; i < VKD3D_QUEUE_FAMILY_COUNT; i++)
+    {
+        struct vkd3d_command_pool_cache *cache = &device->command_pool_caches[i];
+
+        if (cache->stats.hit_count || cache->stats.miss_count)
+        {
+            TRACE("Command pools of queue family %u: %"PRIu64" hits, %"PRIu64" misses, "
+                    "%"PRIu64" trimmed, %"PRIu64" overflowed.\n",
+                    device->queue_families[i]->vk_family_index, cache->stats.hit_count, cache->stats.miss_count,
+                    cache->stats.trim_count, cache->stats.overflow_count);
+        }
+
+        for (j = 0; j < cache->vk_command_pool_count; j++)
+            VK_CALL(vkDestroyCommandPool(device->vk_device, cache->vk_command_pools[j], NULL));
+    }
+
+    for (i = 0; i < VKD3D_DESCRIPTOR_POOL_TYPE_COUNT; i++)
+    {
+        for (j = 0; j < device->cached_descriptor_pools[i].vk_descriptor_pool_count; j++)
+        {
+            VK_CALL(vkDestroyDescriptorPool(device->vk_device,
+                    device->cached_descriptor_pools[i].vk_descriptor_pools[j], NULL));
+        }
+    }
+
+    for (i = 0; i < device->cached_bundle_chunks.chunk_count; i++)
+        vkd3d_free(device->cached_bundle_chunks.chunks[i]);
 
     vkd3d_free(device->descriptor_heap_gpu_vas);
 
@@ -2735,13 +3131,20 @@ static void d3d12_device_destroy(struct d3d12_device *device)
     vkd3d_cleanup_format_info(device);
     vkd3d_memory_info_cleanup(&device->memory_info, device);
     vkd3d_shader_debug_ring_cleanup(&device->debug_ring, device);
+    vkd3d_event_profiler_cleanup(&device->event_profiler, device);
     d3d12_device_global_pipeline_cache_cleanup(device);
     vkd3d_sampler_state_cleanup(&device->sampler_state, device);
     vkd3d_view_map_destroy(&device->sampler_map, device);
     vkd3d_meta_ops_cleanup(&device->meta_ops, device);
     vkd3d_bindless_state_cleanup(&device->bindless_state, device);
+    vkd3d_command_object_cache_cleanup(&device->command_object_cache, device);
     vkd3d_render_pass_cache_cleanup(&device->render_pass_cache, device);
+    vkd3d_memory_requirements_cache_cleanup(&device->memory_requirements_cache);
+    vkd3d_root_signature_cache_cleanup(&device->root_signature_cache);
+    vkd3d_shader_code_cache_cleanup(&device->shader_code_cache);
+    vkd3d_transfer_offload_queue_cleanup(&device->transfer_offload_queue, device);
     d3d12_device_destroy_vkd3d_queues(device);
+    vkd3d_residency_tracker_cleanup(&device->residency_tracker, device);
     vkd3d_memory_allocator_cleanup(&device->memory_allocator, device);
     /* Tear down descriptor global info late, so we catch last minute faults after we drain the queues. */
     vkd3d_descriptor_debug_free_global_info(device->descriptor_qa_global_info, device);
@@ -2979,16 +3382,74 @@ static void vkd3d_determine_format_support_for_feature_level(const struct d3d12_
     }
 }
 
-static HRESULT d3d12_device_check_multisample_quality_levels(struct d3d12_device *device,
-        D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS *data)
+static struct vkd3d_format_support_cache_entry *d3d12_device_get_format_support_cache_entry(
+        struct d3d12_device *device, DXGI_FORMAT dxgi_format)
+{
+    if ((unsigned int)dxgi_format >= VKD3D_FORMAT_SUPPORT_CACHE_SIZE)
+        return NULL;
+    return &device->format_support_cache.entries[dxgi_format];
+}
+
+static HRESULT d3d12_device_get_attachment_sample_counts(struct d3d12_device *device,
+        const struct vkd3d_format *format, VkSampleCountFlags *sample_counts)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_format_support_cache_entry *entry;
     VkImageFormatProperties vk_properties;
-    const struct vkd3d_format *format;
-    VkSampleCountFlagBits vk_samples;
     VkImageUsageFlags vk_usage = 0;
     VkResult vr;
 
+    if ((entry = d3d12_device_get_format_support_cache_entry(device, format->dxgi_format)))
+    {
+        spinlock_acquire(&device->format_support_cache.spinlock);
+        if (entry->flags & VKD3D_FORMAT_SUPPORT_CACHE_SAMPLE_COUNTS)
+        {
+            *sample_counts = entry->sample_counts;
+            spinlock_release(&device->format_support_cache.spinlock);
+            return S_OK;
+        }
+        spinlock_release(&device->format_support_cache.spinlock);
+    }
+
+    if (format->vk_aspect_mask & VK_IMAGE_ASPECT_COLOR_BIT)
+        vk_usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    else
+        vk_usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+    vr = VK_CALL(vkGetPhysicalDeviceImageFormatProperties(device->vk_physical_device,
+            format->vk_format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, vk_usage, 0, &vk_properties));
+    if (vr == VK_ERROR_FORMAT_NOT_SUPPORTED)
+    {
+        WARN("Format %#x is not supported.\n", format->dxgi_format);
+        vk_properties.sampleCounts = 0;
+    }
+    else if (vr < 0)
+    {
+        ERR("Failed to get image format properties, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+
+    *sample_counts = vk_properties.sampleCounts;
+
+    if (entry)
+    {
+        spinlock_acquire(&device->format_support_cache.spinlock);
+        entry->sample_counts = vk_properties.sampleCounts;
+        entry->flags |= VKD3D_FORMAT_SUPPORT_CACHE_SAMPLE_COUNTS;
+        spinlock_release(&device->format_support_cache.spinlock);
+    }
+
+    return S_OK;
+}
+
+static HRESULT d3d12_device_check_multisample_quality_levels(struct d3d12_device *device,
+        D3D12_FEATURE_DATA_MULTISAMPLE_QUALITY_LEVELS *data)
+{
+    const struct vkd3d_format *format;
+    VkSampleCountFlags sample_counts;
+    VkSampleCountFlagBits vk_samples;
+    HRESULT hr;
+
     TRACE("Format %#x, sample count %u, flags %#x.\n", data->Format, data->SampleCount, data->Flags);
 
     data->NumQualityLevels = 0;
@@ -3017,25 +3478,10 @@ static HRESULT d3d12_device_check_multisample_quality_levels(struct d3d12_device
     if (data->Flags)
         FIXME("Ignoring flags %#x.\n", data->Flags);
 
-    if (format->vk_aspect_mask & VK_IMAGE_ASPECT_COLOR_BIT)
-        vk_usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    else
-        vk_usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-
-    vr = VK_CALL(vkGetPhysicalDeviceImageFormatProperties(device->vk_physical_device,
-            format->vk_format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, vk_usage, 0, &vk_properties));
-    if (vr == VK_ERROR_FORMAT_NOT_SUPPORTED)
-    {
-        WARN("Format %#x is not supported.\n", format->dxgi_format);
-        goto done;
-    }
-    if (vr < 0)
-    {
-        ERR("Failed to get image format properties, vr %d.\n", vr);
-        return hresult_from_vk_result(vr);
-    }
+    if (FAILED(hr = d3d12_device_get_attachment_sample_counts(device, format, &sample_counts)))
+        return hr;
 
-    if (vk_properties.sampleCounts & vk_samples)
+    if (sample_counts & vk_samples)
         data->NumQualityLevels = 1;
 
 done:
@@ -3119,23 +3565,16 @@ static bool vk_format_is_supported_by_global_read_write_without_format(VkFormat
     return false;
 }
 
-static HRESULT d3d12_device_get_format_support(struct d3d12_device *device, D3D12_FEATURE_DATA_FORMAT_SUPPORT *data)
+static void d3d12_device_query_format_support(struct d3d12_device *device,
+        const struct vkd3d_format *format, D3D12_FEATURE_DATA_FORMAT_SUPPORT *data)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkFormatFeatureFlags2KHR image_features;
     VkFormatProperties3KHR properties3;
-    const struct vkd3d_format *format;
     VkFormatProperties2 properties;
 
     data->Support1 = D3D12_FORMAT_SUPPORT1_NONE;
     data->Support2 = D3D12_FORMAT_SUPPORT2_NONE;
-    if (!(format = vkd3d_get_format(device, data->Format, false)))
-        format = vkd3d_get_format(device, data->Format, true);
-    if (!format)
-    {
-        FIXME("Unhandled format %#x.\n", data->Format);
-        return E_INVALIDARG;
-    }
 
     properties.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
     properties.pNext = NULL;
@@ -3215,6 +3654,46 @@ static HRESULT d3d12_device_get_format_support(struct d3d12_device *device, D3D1
                 | D3D12_FORMAT_SUPPORT2_UAV_ATOMIC_SIGNED_MIN_OR_MAX
                 | D3D12_FORMAT_SUPPORT2_UAV_ATOMIC_UNSIGNED_MIN_OR_MAX;
     }
+}
+
+static HRESULT d3d12_device_get_format_support(struct d3d12_device *device, D3D12_FEATURE_DATA_FORMAT_SUPPORT *data)
+{
+    struct vkd3d_format_support_cache_entry *entry;
+    const struct vkd3d_format *format;
+
+    if ((entry = d3d12_device_get_format_support_cache_entry(device, data->Format)))
+    {
+        spinlock_acquire(&device->format_support_cache.spinlock);
+        if (entry->flags & VKD3D_FORMAT_SUPPORT_CACHE_FORMAT_SUPPORT)
+        {
+            data->Support1 = entry->support1;
+            data->Support2 = entry->support2;
+            spinlock_release(&device->format_support_cache.spinlock);
+            return S_OK;
+        }
+        spinlock_release(&device->format_support_cache.spinlock);
+    }
+
+    if (!(format = vkd3d_get_format(device, data->Format, false)))
+        format = vkd3d_get_format(device, data->Format, true);
+    if (!format)
+    {
+        FIXME("Unhandled format %#x.\n", data->Format);
+        data->Support1 = D3D12_FORMAT_SUPPORT1_NONE;
+        data->Support2 = D3D12_FORMAT_SUPPORT2_NONE;
+        return E_INVALIDARG;
+    }
+
+    d3d12_device_query_format_support(device, format, data);
+
+    if (entry)
+    {
+        spinlock_acquire(&device->format_support_cache.spinlock);
+        entry->support1 = data->Support1;
+        entry->support2 = data->Support2;
+        entry->flags |= VKD3D_FORMAT_SUPPORT_CACHE_FORMAT_SUPPORT;
+        spinlock_release(&device->format_support_cache.spinlock);
+    }
 
     return S_OK;
 }
@@ -3953,14 +4432,13 @@ static inline void d3d12_device_copy_descriptors_cbv_srv_uav_sampler(struct d3d1
         D3D12_DESCRIPTOR_HEAP_TYPE heap_type,
         UINT descriptor_count)
 {
-#ifndef VKD3D_ENABLE_DESCRIPTOR_QA
-    if (descriptor_count == 1)
+    /* QA builds only need the slow path while logging or GPU checks are active. */
+    if (descriptor_count == 1 && !vkd3d_descriptor_debug_active())
     {
         /* Most common path. This path is faster for 1 descriptor. */
         d3d12_desc_copy_single(dst.ptr, src.ptr, device);
     }
     else
-#endif
     {
         d3d12_desc_copy(dst.ptr, src.ptr, descriptor_count, heap_type, device);
     }
@@ -3973,13 +4451,19 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
         const UINT *src_descriptor_range_sizes,
         D3D12_DESCRIPTOR_HEAP_TYPE descriptor_heap_type)
 {
+    VkCopyDescriptorSet vk_copies[VKD3D_DESC_COPY_BATCH_SIZE];
     unsigned int dst_range_idx, dst_idx, src_range_idx, src_idx;
     D3D12_CPU_DESCRIPTOR_HANDLE dst, src, dst_start, src_start;
     unsigned int dst_range_size, src_range_size, copy_count;
+    struct d3d12_desc_copy_batch batch;
     unsigned int increment;
 
     increment = d3d12_device_get_descriptor_handle_increment_size(descriptor_heap_type);
 
+    /* Gather Vulkan copies for every range so the whole call ends up as one
+     * vkUpdateDescriptorSets, with adjacent ranges merged into single copies. */
+    d3d12_desc_copy_batch_init(&batch, vk_copies, ARRAY_SIZE(vk_copies));
+
     dst_range_idx = dst_idx = 0;
     src_range_idx = src_idx = 0;
     while (dst_range_idx < dst_descriptor_range_count && src_range_idx < src_descriptor_range_count)
@@ -3999,8 +4483,8 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
         {
             case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
             case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
-                d3d12_desc_copy(dst.ptr, src.ptr, copy_count,
-                        descriptor_heap_type, device);
+                d3d12_desc_copy_batched(dst.ptr, src.ptr, copy_count,
+                        descriptor_heap_type, device, &batch);
                 break;
             case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
             case D3D12_DESCRIPTOR_HEAP_TYPE_DSV:
@@ -4026,6 +4510,8 @@ static inline void d3d12_device_copy_descriptors(struct d3d12_device *device,
             src_idx = 0;
         }
     }
+
+    d3d12_desc_copy_batch_flush(&batch, device);
 }
 
 static void STDMETHODCALLTYPE d3d12_device_CopyDescriptors(d3d12_device_iface *iface,
@@ -4242,18 +4728,21 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_OpenSharedHandleByName(d3d12_devic
 static HRESULT STDMETHODCALLTYPE d3d12_device_MakeResident(d3d12_device_iface *iface,
         UINT object_count, ID3D12Pageable * const *objects)
 {
-    FIXME_ONCE("iface %p, object_count %u, objects %p stub!\n",
-            iface, object_count, objects);
+    struct d3d12_device *device = impl_from_ID3D12Device(iface);
 
-    return S_OK;
+    TRACE("iface %p, object_count %u, objects %p.\n", iface, object_count, objects);
+
+    return vkd3d_residency_make_resident(device, object_count, objects, D3D12_RESIDENCY_FLAG_NONE, NULL, 0);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_device_Evict(d3d12_device_iface *iface,
         UINT object_count, ID3D12Pageable * const *objects)
 {
-    FIXME_ONCE("iface %p, object_count %u, objects %p stub!\n",
-            iface, object_count, objects);
+    struct d3d12_device *device = impl_from_ID3D12Device(iface);
 
+    TRACE("iface %p, object_count %u, objects %p.\n", iface, object_count, objects);
+
+    vkd3d_residency_evict(device, object_count, objects);
     return S_OK;
 }
 
@@ -4339,7 +4828,8 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CreateCommandSignature(d3d12_devic
     TRACE("iface %p, desc %p, root_signature %p, iid %s, command_signature %p.\n",
             iface, desc, root_signature, debugstr_guid(iid), command_signature);
 
-    if (FAILED(hr = d3d12_command_signature_create(device, desc, &object)))
+    if (FAILED(hr = d3d12_command_signature_create(device,
+            impl_from_ID3D12RootSignature(root_signature), desc, &object)))
         return hr;
 
     return return_interface(&object->ID3D12CommandSignature_iface,
@@ -4550,10 +5040,16 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_EnqueueMakeResident(d3d12_device_i
         D3D12_RESIDENCY_FLAGS flags, UINT num_objects, ID3D12Pageable *const *objects,
         ID3D12Fence *fence_to_signal, UINT64 fence_value_to_signal)
 {
-    FIXME_ONCE("iface %p, flags %#x, num_objects %u, objects %p, fence_to_signal %p, fence_value_to_signal %"PRIu64" stub!\n",
+    struct d3d12_device *device = impl_from_ID3D12Device(iface);
+    struct d3d12_fence *fence = impl_from_ID3D12Fence(fence_to_signal);
+
+    TRACE("iface %p, flags %#x, num_objects %u, objects %p, fence_to_signal %p, fence_value_to_signal %"PRIu64".\n",
             iface, flags, num_objects, objects, fence_to_signal, fence_value_to_signal);
 
-    return ID3D12Fence_Signal(fence_to_signal, fence_value_to_signal);
+    if (!fence)
+        return E_INVALIDARG;
+
+    return vkd3d_residency_make_resident(device, num_objects, objects, flags, fence, fence_value_to_signal);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_device_CreateCommandList1(d3d12_device_iface *iface,
@@ -4825,10 +5321,21 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_SetBackgroundProcessingMode(d3d12_
 static HRESULT STDMETHODCALLTYPE d3d12_device_AddToStateObject(d3d12_device_iface *iface, const D3D12_STATE_OBJECT_DESC *addition,
         ID3D12StateObject *state_object, REFIID riid, void **new_state_object)
 {
-    FIXME("iface %p, addition %p, state_object %p, riid %s, new_state_object %p stub!\n",
+    struct d3d12_device *device = impl_from_ID3D12Device(iface);
+    struct d3d12_state_object *parent, *state;
+    HRESULT hr;
+
+    TRACE("iface %p, addition %p, state_object %p, riid %s, new_state_object %p.\n",
             iface, addition, state_object, debugstr_guid(riid), new_state_object);
 
-    return E_NOTIMPL;
+    if (!addition || !state_object)
+        return E_INVALIDARG;
+
+    parent = impl_from_ID3D12StateObject(state_object);
+    if (FAILED(hr = d3d12_state_object_add(device, addition, parent, &state)))
+        return hr;
+
+    return return_interface(&state->ID3D12StateObject_iface, &IID_ID3D12StateObject, riid, new_state_object);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_device_CreateProtectedResourceSession1(d3d12_device_iface *iface,
@@ -5960,12 +6467,117 @@ static bool d3d12_device_supports_feature_level(struct d3d12_device *device, D3D
     return feature_level <= device->d3d12_caps.max_feature_level;
 }
 
-extern CONST_VTBL struct ID3D12DeviceExtVtbl d3d12_device_vkd3d_ext_vtbl;
+extern CONST_VTBL struct ID3D12DeviceExt1Vtbl d3d12_device_vkd3d_ext_vtbl;
+
+static HRESULT d3d12_device_memory_info_init(struct d3d12_device *device)
+{
+    return vkd3d_memory_info_init(&device->memory_info, device);
+}
+
+static void d3d12_device_memory_info_cleanup(struct d3d12_device *device)
+{
+    vkd3d_memory_info_cleanup(&device->memory_info, device);
+}
+
+static HRESULT d3d12_device_meta_ops_init(struct d3d12_device *device)
+{
+    return vkd3d_meta_ops_init(&device->meta_ops, device);
+}
+
+static void d3d12_device_meta_ops_cleanup(struct d3d12_device *device)
+{
+    vkd3d_meta_ops_cleanup(&device->meta_ops, device);
+}
+
+/* Init stages which only depend on the Vulkan device and do not touch state
+ * owned by any other stage, so they can run on the task pool while the
+ * calling thread works through the remaining stages. */
+static const struct d3d12_device_async_init_stage_info
+{
+    HRESULT (*init)(struct d3d12_device *device);
+    void (*cleanup)(struct d3d12_device *device);
+}
+d3d12_device_async_init_stages[] =
+{
+    /* Probes memory types with dummy resources. */
+    {d3d12_device_memory_info_init, d3d12_device_memory_info_cleanup},
+    /* Compiles the meta pipelines which are not created lazily. */
+    {d3d12_device_meta_ops_init, d3d12_device_meta_ops_cleanup},
+    {d3d12_device_global_pipeline_cache_init, d3d12_device_global_pipeline_cache_cleanup},
+};
+
+struct d3d12_device_async_init_stage
+{
+    const struct d3d12_device_async_init_stage_info *info;
+    struct d3d12_device *device;
+    HRESULT hr;
+};
+
+struct d3d12_device_async_init
+{
+    struct vkd3d_task_group group;
+    struct d3d12_device_async_init_stage stages[ARRAY_SIZE(d3d12_device_async_init_stages)];
+};
+
+static void d3d12_device_async_init_main(void *userdata)
+{
+    struct d3d12_device_async_init_stage *stage = userdata;
+
+    stage->hr = stage->info->init(stage->device);
+}
+
+static void d3d12_device_begin_async_init(struct d3d12_device *device, struct d3d12_device_async_init *init)
+{
+    size_t i;
+
+    memset(init, 0, sizeof(*init));
+
+    for (i = 0; i < ARRAY_SIZE(init->stages); i++)
+    {
+        init->stages[i].info = &d3d12_device_async_init_stages[i];
+        init->stages[i].device = device;
+        init->stages[i].hr = E_FAIL;
+
+        vkd3d_task_pool_submit(&device->task_pool, VKD3D_TASK_TYPE_DEVICE_INIT, VKD3D_TASK_PRIORITY_HIGH,
+                &init->group, d3d12_device_async_init_main, &init->stages[i]);
+    }
+}
+
+static HRESULT d3d12_device_wait_async_init(struct d3d12_device *device, struct d3d12_device_async_init *init)
+{
+    size_t i;
+
+    vkd3d_task_pool_wait(&device->task_pool, &init->group);
+
+    for (i = 0; i < ARRAY_SIZE(init->stages); i++)
+    {
+        if (FAILED(init->stages[i].hr))
+            return init->stages[i].hr;
+    }
+
+    return S_OK;
+}
+
+static void d3d12_device_cleanup_async_init(struct d3d12_device *device, struct d3d12_device_async_init *init)
+{
+    size_t i;
+
+    /* Stages may still be running if a serial stage failed. */
+    vkd3d_task_pool_wait(&device->task_pool, &init->group);
+
+    for (i = ARRAY_SIZE(init->stages); i--; )
+    {
+        if (SUCCEEDED(init->stages[i].hr))
+            init->stages[i].info->cleanup(device);
+    }
+}
 
 static HRESULT d3d12_device_init(struct d3d12_device *device,
         struct vkd3d_instance *instance, const struct vkd3d_device_create_info *create_info)
 {
     const struct vkd3d_vk_device_procs *vk_procs;
+    struct d3d12_device_async_init async_init;
+    unsigned int i;
     HRESULT hr;
     int rc;
 
@@ -5995,6 +6607,9 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
         hr = hresult_from_errno(rc);
         goto out_free_instance;
     }
+
+    for (i = 0; i < VKD3D_QUEUE_FAMILY_COUNT; i++)
+        spinlock_init(&device->command_pool_caches[i].spinlock);
     
     device->ID3D12DeviceExt_iface.lpVtbl = &d3d12_device_vkd3d_ext_vtbl;
 
@@ -6007,38 +6622,76 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     if (FAILED(hr = vkd3d_memory_allocator_init(&device->memory_allocator, device)))
         goto out_free_private_store;
 
-    if (FAILED(hr = vkd3d_init_format_info(device)))
+    if (FAILED(hr = vkd3d_residency_tracker_init(&device->residency_tracker, device)))
         goto out_free_memory_allocator;
 
-    if (FAILED(hr = vkd3d_memory_info_init(&device->memory_info, device)))
-        goto out_cleanup_format_info;
+    if (FAILED(hr = vkd3d_transfer_offload_queue_init(&device->transfer_offload_queue, device)))
+        goto out_cleanup_residency_tracker;
+
+    /* Started early so that independent init stages can run in parallel. */
+    if (FAILED(hr = vkd3d_task_pool_start(&device->task_pool, device)))
+        goto out_cleanup_transfer_offload_queue;
+
+    d3d12_device_begin_async_init(device, &async_init);
+
+    if (FAILED(hr = vkd3d_init_format_info(device)))
+        goto out_cleanup_async_init;
 
     if (FAILED(hr = vkd3d_bindless_state_init(&device->bindless_state, device)))
-        goto out_cleanup_memory_info;
+        goto out_cleanup_format_info;
 
-    if (FAILED(hr = vkd3d_view_map_init(&device->sampler_map)))
+    if (FAILED(hr = vkd3d_view_map_init_sharded(&device->sampler_map, VKD3D_SAMPLER_MAP_SHARD_COUNT)))
         goto out_cleanup_bindless_state;
 
     if (FAILED(hr = vkd3d_sampler_state_init(&device->sampler_state, device)))
         goto out_cleanup_view_map;
 
-    if (FAILED(hr = vkd3d_meta_ops_init(&device->meta_ops, device)))
+    /* Everything below may allocate memory or use meta pipelines. */
+    if (FAILED(hr = d3d12_device_wait_async_init(device, &async_init)))
         goto out_cleanup_sampler_state;
 
     if (FAILED(hr = vkd3d_shader_debug_ring_init(&device->debug_ring, device)))
-        goto out_cleanup_meta_ops;
+        goto out_cleanup_sampler_state;
 
-    if (FAILED(hr = d3d12_device_global_pipeline_cache_init(device)))
+    if (FAILED(hr = vkd3d_event_profiler_init(&device->event_profiler, device)))
         goto out_cleanup_debug_ring;
 
     if (vkd3d_descriptor_debug_active_qa_checks())
     {
         if (FAILED(hr = vkd3d_descriptor_debug_alloc_global_info(&device->descriptor_qa_global_info,
                 VKD3D_DESCRIPTOR_DEBUG_DEFAULT_NUM_COOKIES, device)))
-            goto out_cleanup_global_pipeline_cache;
+            goto out_cleanup_event_profiler;
     }
 
+    if (FAILED(hr = vkd3d_resource_recycle_pool_init(&device->resource_recycle_pool)))
+        goto out_cleanup_descriptor_qa_global_info;
+
+    if (FAILED(hr = vkd3d_fence_worker_start(&device->fence_worker, device)))
+        goto out_cleanup_resource_recycle_pool;
+
+    if (FAILED(hr = vkd3d_sparse_worker_start(&device->sparse_worker, device)))
+        goto out_stop_fence_worker;
+
+    if (FAILED(hr = vkd3d_command_list_translator_start(&device->command_list_translator, device)))
+        goto out_stop_sparse_worker;
+
+    if (FAILED(hr = vkd3d_pipeline_compile_worker_start(&device->pipeline_compile_worker, device)))
+        goto out_stop_command_list_translator;
+
+    if (FAILED(hr = vkd3d_shader_code_cache_init(&device->shader_code_cache)))
+        goto out_stop_pipeline_compile_worker;
+
+    if (FAILED(hr = vkd3d_command_object_cache_init(&device->command_object_cache)))
+        goto out_cleanup_shader_code_cache;
+
     vkd3d_render_pass_cache_init(&device->render_pass_cache);
+    vkd3d_memory_requirements_cache_init(&device->memory_requirements_cache);
+    memset(&device->format_support_cache, 0, sizeof(device->format_support_cache));
+    vkd3d_root_signature_cache_init(&device->root_signature_cache);
+
+    /* Meta pipelines are otherwise created the first time a command list needs them. */
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_META_PREWARM)
+        vkd3d_meta_ops_prewarm(&device->meta_ops);
 
     if ((device->parent = create_info->parent))
         IUnknown_AddRef(device->parent);
@@ -6047,6 +6700,8 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
 
     vkd3d_init_shader_extensions(device);
     vkd3d_compute_shader_interface_key(device);
+    /* Depends on the shader interface key to validate the cache file. */
+    vkd3d_disk_cache_init(&device->disk_cache, device);
 
 #ifdef VKD3D_ENABLE_RENDERDOC
     if (vkd3d_renderdoc_active() && vkd3d_renderdoc_global_capture_enabled())
@@ -6055,22 +6710,39 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
 
     return S_OK;
 
-out_cleanup_global_pipeline_cache:
-    d3d12_device_global_pipeline_cache_cleanup(device);
+out_cleanup_shader_code_cache:
+    vkd3d_shader_code_cache_cleanup(&device->shader_code_cache);
+out_stop_pipeline_compile_worker:
+    vkd3d_pipeline_compile_worker_stop(&device->pipeline_compile_worker, device);
+out_stop_command_list_translator:
+    vkd3d_command_list_translator_stop(&device->command_list_translator, device);
+out_stop_sparse_worker:
+    vkd3d_sparse_worker_stop(&device->sparse_worker, device);
+out_stop_fence_worker:
+    vkd3d_fence_worker_stop(&device->fence_worker, device);
+out_cleanup_resource_recycle_pool:
+    vkd3d_resource_recycle_pool_cleanup(&device->resource_recycle_pool, device);
+out_cleanup_descriptor_qa_global_info:
+    vkd3d_descriptor_debug_free_global_info(device->descriptor_qa_global_info, device);
+out_cleanup_event_profiler:
+    vkd3d_event_profiler_cleanup(&device->event_profiler, device);
 out_cleanup_debug_ring:
     vkd3d_shader_debug_ring_cleanup(&device->debug_ring, device);
-out_cleanup_meta_ops:
-    vkd3d_meta_ops_cleanup(&device->meta_ops, device);
 out_cleanup_sampler_state:
     vkd3d_sampler_state_cleanup(&device->sampler_state, device);
 out_cleanup_view_map:
     vkd3d_view_map_destroy(&device->sampler_map, device);
 out_cleanup_bindless_state:
     vkd3d_bindless_state_cleanup(&device->bindless_state, device);
-out_cleanup_memory_info:
-    vkd3d_memory_info_cleanup(&device->memory_info, device);
 out_cleanup_format_info:
     vkd3d_cleanup_format_info(device);
+out_cleanup_async_init:
+    d3d12_device_cleanup_async_init(device, &async_init);
+    vkd3d_task_pool_stop(&device->task_pool, device);
+out_cleanup_transfer_offload_queue:
+    vkd3d_transfer_offload_queue_cleanup(&device->transfer_offload_queue, device);
+out_cleanup_residency_tracker:
+    vkd3d_residency_tracker_cleanup(&device->residency_tracker, device);
 out_free_memory_allocator:
     vkd3d_memory_allocator_cleanup(&device->memory_allocator, device);
 out_free_private_store:
@@ -6164,6 +6836,10 @@ HRESULT d3d12_device_create(struct vkd3d_instance *instance,
 
     pthread_mutex_unlock(&d3d12_device_map_mutex);
 
+    /* Needs a fully initialized device, since it creates pipeline states. */
+    if (FAILED(hr = vkd3d_pipeline_warmup_start(&object->pipeline_warmup, object)))
+        WARN("Failed to start pipeline warm-up, hr %#x.\n", hr);
+
     *device = object;
 
     return S_OK;
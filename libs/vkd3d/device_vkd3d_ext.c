@@ -20,18 +20,18 @@
 
 #include "vkd3d_private.h"
 
-static inline struct d3d12_device *d3d12_device_from_ID3D12DeviceExt(ID3D12DeviceExt *iface)
+static inline struct d3d12_device *d3d12_device_from_ID3D12DeviceExt(d3d12_device_vkd3d_ext_iface *iface)
 {
     return CONTAINING_RECORD(iface, struct d3d12_device, ID3D12DeviceExt_iface);
 }
 
-ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_AddRef(ID3D12DeviceExt *iface)
+ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_AddRef(d3d12_device_vkd3d_ext_iface *iface)
 {
     struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
     return d3d12_device_add_ref(device);
 }
 
-static ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_Release(ID3D12DeviceExt *iface)
+static ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_Release(d3d12_device_vkd3d_ext_iface *iface)
 {
     struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
     return d3d12_device_release(device);
@@ -40,7 +40,7 @@ static ULONG STDMETHODCALLTYPE d3d12_device_vkd3d_ext_Release(ID3D12DeviceExt *i
 extern HRESULT STDMETHODCALLTYPE d3d12_device_QueryInterface(d3d12_device_iface *iface,
         REFIID riid, void **object);
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_QueryInterface(ID3D12DeviceExt *iface,
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_QueryInterface(d3d12_device_vkd3d_ext_iface *iface,
         REFIID iid, void **out)
 {
     struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
@@ -48,7 +48,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_QueryInterface(ID3D12Dev
     return d3d12_device_QueryInterface(&device->ID3D12Device_iface, iid, out);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetVulkanHandles(ID3D12DeviceExt *iface, VkInstance *vk_instance, VkPhysicalDevice *vk_physical_device, VkDevice *vk_device)
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetVulkanHandles(d3d12_device_vkd3d_ext_iface *iface, VkInstance *vk_instance, VkPhysicalDevice *vk_physical_device, VkDevice *vk_device)
 {
     struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
     TRACE("iface %p, vk_instance %p, vk_physical_device %u, vk_device %p \n", iface, vk_instance, vk_physical_device, vk_device);
@@ -61,7 +61,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetVulkanHandles(ID3D12D
     return S_OK;
 }
 
-static BOOL STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetExtensionSupport(ID3D12DeviceExt *iface, D3D12_VK_EXTENSION extension)
+static BOOL STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetExtensionSupport(d3d12_device_vkd3d_ext_iface *iface, D3D12_VK_EXTENSION extension)
 {
     const struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
     bool ret_val = false;
@@ -82,7 +82,7 @@ static BOOL STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetExtensionSupport(ID3D12D
     return ret_val;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CreateCubinComputeShaderWithName(ID3D12DeviceExt *iface, const void *cubin_data,
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CreateCubinComputeShaderWithName(d3d12_device_vkd3d_ext_iface *iface, const void *cubin_data,
        UINT32 cubin_size, UINT32 block_x, UINT32 block_y, UINT32 block_z, const char *shader_name, D3D12_CUBIN_DATA_HANDLE **out_handle)
 {
     VkCuFunctionCreateInfoNVX functionCreateInfo = { VK_STRUCTURE_TYPE_CU_FUNCTION_CREATE_INFO_NVX };
@@ -129,7 +129,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CreateCubinComputeShader
     return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_DestroyCubinComputeShader(ID3D12DeviceExt *iface, D3D12_CUBIN_DATA_HANDLE *handle)
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_DestroyCubinComputeShader(d3d12_device_vkd3d_ext_iface *iface, D3D12_CUBIN_DATA_HANDLE *handle)
 {   
     const struct vkd3d_vk_device_procs *vk_procs;
     struct d3d12_device *device;
@@ -149,7 +149,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_DestroyCubinComputeShade
     return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetCudaTextureObject(ID3D12DeviceExt *iface, D3D12_CPU_DESCRIPTOR_HANDLE srv_handle,
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetCudaTextureObject(d3d12_device_vkd3d_ext_iface *iface, D3D12_CPU_DESCRIPTOR_HANDLE srv_handle,
        D3D12_CPU_DESCRIPTOR_HANDLE sampler_handle, UINT32 *cuda_texture_handle)
 {
     VkImageViewHandleInfoNVX imageViewHandleInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_HANDLE_INFO_NVX };
@@ -177,7 +177,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetCudaTextureObject(ID3
     return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetCudaSurfaceObject(ID3D12DeviceExt *iface, D3D12_CPU_DESCRIPTOR_HANDLE uav_handle, 
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetCudaSurfaceObject(d3d12_device_vkd3d_ext_iface *iface, D3D12_CPU_DESCRIPTOR_HANDLE uav_handle, 
         UINT32 *cuda_surface_handle)
 {
     VkImageViewHandleInfoNVX imageViewHandleInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_HANDLE_INFO_NVX };
@@ -202,7 +202,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetCudaSurfaceObject(ID3
 
 extern VKD3D_THREAD_LOCAL struct D3D12_UAV_INFO *d3d12_uav_info;
 
-static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CaptureUAVInfo(ID3D12DeviceExt *iface, D3D12_UAV_INFO *uav_info)
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CaptureUAVInfo(d3d12_device_vkd3d_ext_iface *iface, D3D12_UAV_INFO *uav_info)
 {
     if (!uav_info)
        return E_INVALIDARG;
@@ -215,7 +215,136 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CaptureUAVInfo(ID3D12Dev
     return S_OK;
 }
 
-CONST_VTBL struct ID3D12DeviceExtVtbl d3d12_device_vkd3d_ext_vtbl =
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetMemoryAllocatorStats(d3d12_device_vkd3d_ext_iface *iface,
+        D3D12_VK_MEMORY_ALLOCATOR_STATS *stats)
+{
+    struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
+
+    TRACE("iface %p, stats %p.\n", iface, stats);
+
+    if (!stats)
+        return E_INVALIDARG;
+
+    vkd3d_memory_allocator_get_stats(&device->memory_allocator, device, stats);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetWriteWatch(d3d12_device_vkd3d_ext_iface *iface,
+        UINT32 flags, void *base_address, SIZE_T region_size, void **addresses, UINT64 *address_count, UINT32 *granularity)
+{
+    TRACE("iface %p, flags %#x, base_address %p, region_size %#lx, addresses %p, address_count %p, granularity %p.\n",
+            iface, flags, base_address, (unsigned long)region_size, addresses, address_count, granularity);
+
+    if (!base_address || !addresses || !address_count || !granularity)
+        return E_INVALIDARG;
+
+    if (flags & ~D3D12_VK_WRITE_WATCH_FLAG_RESET)
+        FIXME("Unhandled flags %#x.\n", flags);
+
+    return vkd3d_get_write_watch(flags, base_address, region_size, addresses, address_count, granularity);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetPipelineWarmupProgress(d3d12_device_vkd3d_ext_iface *iface,
+        UINT32 *completed_count, UINT32 *total_count)
+{
+    struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
+
+    TRACE("iface %p, completed_count %p, total_count %p.\n", iface, completed_count, total_count);
+
+    if (!completed_count || !total_count)
+        return E_INVALIDARG;
+
+    /* Both counts stay 0 if there is nothing to warm up. */
+    vkd3d_pipeline_warmup_get_progress(&device->pipeline_warmup, completed_count, total_count);
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_GetGpuEventTimings(d3d12_device_vkd3d_ext_iface *iface,
+        UINT64 frame_index, D3D12_VK_GPU_EVENT_TIMING *timings, UINT32 *count)
+{
+    struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
+
+    TRACE("iface %p, frame_index %"PRIu64", timings %p, count %p.\n", iface, frame_index, timings, count);
+
+    if (!count)
+        return E_INVALIDARG;
+
+    return vkd3d_event_profiler_get_timings(&device->event_profiler, device, frame_index, timings, count);
+}
+
+static struct vkd3d_upload_ring *vkd3d_upload_ring_from_handle(D3D12_VK_UPLOAD_RING ring)
+{
+    return (struct vkd3d_upload_ring *)ring;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_CreateUploadRing(d3d12_device_vkd3d_ext_iface *iface,
+        UINT64 size, D3D12_VK_UPLOAD_RING_PLACEMENT *placement, D3D12_VK_UPLOAD_RING *ring)
+{
+    struct d3d12_device *device = d3d12_device_from_ID3D12DeviceExt(iface);
+    struct vkd3d_upload_ring *object;
+    HRESULT hr;
+
+    TRACE("iface %p, size %#"PRIx64", placement %p, ring %p.\n", iface, size, placement, ring);
+
+    if (!size || !ring)
+        return E_INVALIDARG;
+
+    if (FAILED(hr = vkd3d_upload_ring_create(device, size, &object)))
+        return hr;
+
+    if (placement)
+        *placement = object->placement;
+    *ring = (D3D12_VK_UPLOAD_RING)object;
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_DestroyUploadRing(d3d12_device_vkd3d_ext_iface *iface,
+        D3D12_VK_UPLOAD_RING ring)
+{
+    TRACE("iface %p, ring %p.\n", iface, ring);
+
+    if (!ring)
+        return E_INVALIDARG;
+
+    vkd3d_upload_ring_destroy(vkd3d_upload_ring_from_handle(ring));
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_AllocateFromUploadRing(d3d12_device_vkd3d_ext_iface *iface,
+        D3D12_VK_UPLOAD_RING ring, UINT64 size, UINT64 alignment, D3D12_VK_UPLOAD_RING_ALLOCATION *allocation)
+{
+    TRACE("iface %p, ring %p, size %#"PRIx64", alignment %#"PRIx64", allocation %p.\n",
+            iface, ring, size, alignment, allocation);
+
+    if (!ring || !allocation)
+        return E_INVALIDARG;
+
+    return vkd3d_upload_ring_allocate(vkd3d_upload_ring_from_handle(ring), size, alignment, allocation);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_FlushUploadRing(d3d12_device_vkd3d_ext_iface *iface,
+        D3D12_VK_UPLOAD_RING ring, ID3D12GraphicsCommandList *command_list)
+{
+    TRACE("iface %p, ring %p, command_list %p.\n", iface, ring, command_list);
+
+    if (!ring || !command_list)
+        return E_INVALIDARG;
+
+    return vkd3d_upload_ring_flush(vkd3d_upload_ring_from_handle(ring), command_list);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_device_vkd3d_ext_RetireUploadRingFrame(d3d12_device_vkd3d_ext_iface *iface,
+        D3D12_VK_UPLOAD_RING ring, ID3D12CommandQueue *queue)
+{
+    TRACE("iface %p, ring %p, queue %p.\n", iface, ring, queue);
+
+    if (!ring || !queue)
+        return E_INVALIDARG;
+
+    return vkd3d_upload_ring_retire_frame(vkd3d_upload_ring_from_handle(ring), queue);
+}
+
+CONST_VTBL struct ID3D12DeviceExt1Vtbl d3d12_device_vkd3d_ext_vtbl =
 {
     /* IUnknown methods */
     d3d12_device_vkd3d_ext_QueryInterface,
@@ -229,6 +358,17 @@ CONST_VTBL struct ID3D12DeviceExtVtbl d3d12_device_vkd3d_ext_vtbl =
     d3d12_device_vkd3d_ext_DestroyCubinComputeShader,
     d3d12_device_vkd3d_ext_GetCudaTextureObject,
     d3d12_device_vkd3d_ext_GetCudaSurfaceObject,
-    d3d12_device_vkd3d_ext_CaptureUAVInfo
+    d3d12_device_vkd3d_ext_CaptureUAVInfo,
+
+    /* ID3D12DeviceExt1 methods */
+    d3d12_device_vkd3d_ext_GetMemoryAllocatorStats,
+    d3d12_device_vkd3d_ext_GetWriteWatch,
+    d3d12_device_vkd3d_ext_GetPipelineWarmupProgress,
+    d3d12_device_vkd3d_ext_GetGpuEventTimings,
+    d3d12_device_vkd3d_ext_CreateUploadRing,
+    d3d12_device_vkd3d_ext_DestroyUploadRing,
+    d3d12_device_vkd3d_ext_AllocateFromUploadRing,
+    d3d12_device_vkd3d_ext_FlushUploadRing,
+    d3d12_device_vkd3d_ext_RetireUploadRingFrame,
 };
 
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_private.h"
+
+/* Times BeginEvent/EndEvent regions with timestamp queries. Every region gets a pair of
+ * queries out of a single pool, which are reset through the command list's query ranges, so
+ * that regions also work inside render passes and in command lists executed repeatedly.
+ * Results are read back without waiting whenever a frame is presented, oldest first. */
+
+/* Regions which never complete, e.g. because their command list was never submitted,
+ * or EndEvent was called in another command list, are dropped after this long. */
+#define VKD3D_EVENT_PROFILER_REGION_TIMEOUT_NS (1000ull * 1000ull * 1000ull) /* 1 s */
+#define VKD3D_EVENT_PROFILER_LOG_INTERVAL_NS (1000ull * 1000ull * 1000ull) /* 1 s */
+
+HRESULT vkd3d_event_profiler_init(struct vkd3d_event_profiler *profiler, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkQueryPoolCreateInfo pool_info;
+    const char *env;
+    VkResult vr;
+    int rc;
+
+    memset(profiler, 0, sizeof(*profiler));
+
+    if (!(vkd3d_config_flags & VKD3D_CONFIG_FLAG_EVENT_PROFILE))
+        return S_OK;
+
+    if (!device->vk_info.device_limits.timestampComputeAndGraphics)
+    {
+        WARN("Timestamps are not supported on all queues, not enabling event profiler.\n");
+        return S_OK;
+    }
+
+    if ((rc = pthread_mutex_init(&profiler->lock, NULL)))
+        return hresult_from_errno(rc);
+
+    if (!(profiler->regions = vkd3d_calloc(VKD3D_EVENT_PROFILER_REGION_COUNT, sizeof(*profiler->regions))) ||
+            !(profiler->results = vkd3d_calloc(VKD3D_EVENT_PROFILER_RESULT_COUNT, sizeof(*profiler->results))))
+    {
+        vkd3d_free(profiler->regions);
+        pthread_mutex_destroy(&profiler->lock);
+        return E_OUTOFMEMORY;
+    }
+
+    pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    pool_info.pNext = NULL;
+    pool_info.flags = 0;
+    pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    pool_info.queryCount = 2 * VKD3D_EVENT_PROFILER_REGION_COUNT;
+    pool_info.pipelineStatistics = 0;
+
+    if ((vr = VK_CALL(vkCreateQueryPool(device->vk_device, &pool_info, NULL, &profiler->vk_query_pool))) < 0)
+    {
+        ERR("Failed to create query pool, vr %d.\n", vr);
+        vkd3d_free(profiler->results);
+        vkd3d_free(profiler->regions);
+        pthread_mutex_destroy(&profiler->lock);
+        return hresult_from_vk_result(vr);
+    }
+
+    if ((env = getenv("VKD3D_EVENT_PROFILE_LOG")))
+    {
+        if ((profiler->log_file = fopen(env, "w")))
+            fprintf(profiler->log_file, "frame,type,depth,name,cpu_timestamp,gpu_timestamp,duration_ns\n");
+        else
+            ERR("Failed to open file: %s.\n", env);
+    }
+
+    INFO("Enabling GPU event profiler.\n");
+    profiler->active = true;
+    return S_OK;
+}
+
+void vkd3d_event_profiler_cleanup(struct vkd3d_event_profiler *profiler, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    if (!profiler->active)
+        return;
+
+    if (profiler->dropped_count)
+        TRACE("Dropped %"PRIu64" event regions.\n", profiler->dropped_count);
+
+    if (profiler->log_file)
+        fclose(profiler->log_file);
+
+    VK_CALL(vkDestroyQueryPool(device->vk_device, profiler->vk_query_pool, NULL));
+    vkd3d_free(profiler->results);
+    vkd3d_free(profiler->regions);
+    pthread_mutex_destroy(&profiler->lock);
+}
+
+static uint32_t vkd3d_event_profiler_allocate_region(struct vkd3d_event_profiler *profiler,
+        struct d3d12_command_list *list, const char *name)
+{
+    const struct vkd3d_queue_family_info *queue_family;
+    struct vkd3d_event_profiler_region *region;
+    uint32_t index;
+
+    queue_family = d3d12_device_get_vkd3d_queue_family(list->device, list->type);
+    if (!queue_family->timestamp_bits)
+        return VKD3D_EVENT_PROFILER_INVALID_REGION;
+
+    pthread_mutex_lock(&profiler->lock);
+
+    if (profiler->region_head - profiler->region_tail >= VKD3D_EVENT_PROFILER_REGION_COUNT)
+    {
+        profiler->dropped_count++;
+        pthread_mutex_unlock(&profiler->lock);
+        return VKD3D_EVENT_PROFILER_INVALID_REGION;
+    }
+
+    index = profiler->region_head++ % VKD3D_EVENT_PROFILER_REGION_COUNT;
+    region = &profiler->regions[index];
+    region->frame_index = profiler->frame_index;
+    region->begin_time_ns = vkd3d_profiling_get_tick_count();
+    region->timestamp_mask = queue_family->timestamp_bits >= 64 ? UINT64_MAX :
+            ((1ull << queue_family->timestamp_bits) - 1);
+    region->type = list->type;
+    region->depth = list->event_region_count;
+    snprintf(region->name, sizeof(region->name), "%s", name);
+
+    pthread_mutex_unlock(&profiler->lock);
+    return index;
+}
+
+void vkd3d_event_profiler_begin_region(struct vkd3d_event_profiler *profiler,
+        struct d3d12_command_list *list, const char *name)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    uint32_t index = VKD3D_EVENT_PROFILER_INVALID_REGION;
+
+    if (!vkd3d_array_reserve((void **)&list->event_regions, &list->event_regions_size,
+            list->event_region_count + 1, sizeof(*list->event_regions)))
+    {
+        ERR("Failed to allocate event region.\n");
+        return;
+    }
+
+    /* Secondary command buffers for bundles cannot carry query resets. */
+    if (!list->is_baking_bundle)
+        index = vkd3d_event_profiler_allocate_region(profiler, list, name);
+
+    /* Keep invalid regions on the stack so that nesting stays balanced. */
+    list->event_regions[list->event_region_count++] = index;
+
+    if (index == VKD3D_EVENT_PROFILER_INVALID_REGION)
+        return;
+
+    d3d12_command_list_reset_query(list, profiler->vk_query_pool, 2 * index + 0);
+    d3d12_command_list_reset_query(list, profiler->vk_query_pool, 2 * index + 1);
+
+    VK_CALL(vkCmdWriteTimestamp(list->vk_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            profiler->vk_query_pool, 2 * index + 0));
+}
+
+void vkd3d_event_profiler_end_region(struct vkd3d_event_profiler *profiler, struct d3d12_command_list *list)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    uint32_t index;
+
+    if (!list->event_region_count)
+    {
+        WARN("EndEvent without matching BeginEvent.\n");
+        return;
+    }
+
+    index = list->event_regions[--list->event_region_count];
+
+    if (index == VKD3D_EVENT_PROFILER_INVALID_REGION)
+        return;
+
+    VK_CALL(vkCmdWriteTimestamp(list->vk_command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            profiler->vk_query_pool, 2 * index + 1));
+}
+
+static uint64_t vkd3d_event_profiler_cpu_timestamp(uint64_t gpu_timestamp,
+        uint64_t calibration_gpu, uint64_t calibration_cpu, double cpu_ticks_per_gpu_tick)
+{
+    double offset;
+
+    if (!calibration_cpu)
+        return 0;
+
+    /* The region may have started before or after the calibration point. */
+    if (gpu_timestamp >= calibration_gpu)
+        offset = (double)(gpu_timestamp - calibration_gpu) * cpu_ticks_per_gpu_tick;
+    else
+        offset = -(double)(calibration_gpu - gpu_timestamp) * cpu_ticks_per_gpu_tick;
+
+    return (uint64_t)((double)calibration_cpu + offset);
+}
+
+/* Must be called with the profiler lock held. */
+static void vkd3d_event_profiler_resolve_regions(struct vkd3d_event_profiler *profiler,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    float timestamp_period = device->vk_info.device_limits.timestampPeriod;
+    uint64_t calibration_gpu, calibration_cpu, now;
+    const struct vkd3d_event_profiler_region *region;
+    double cpu_ticks_per_gpu_tick = 0.0;
+    D3D12_VK_GPU_EVENT_TIMING *result;
+    uint64_t values[4], ticks;
+    uint32_t index;
+    VkResult vr;
+
+    if (profiler->region_tail == profiler->region_head)
+        return;
+
+    if (FAILED(d3d12_device_get_clock_calibration(device, &calibration_gpu, &calibration_cpu)))
+        calibration_cpu = 0;
+
+#ifdef _WIN32
+    if (calibration_cpu)
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        cpu_ticks_per_gpu_tick = (double)timestamp_period * (double)frequency.QuadPart / 1e9;
+    }
+#endif
+
+    now = vkd3d_profiling_get_tick_count();
+
+    while (profiler->region_tail != profiler->region_head)
+    {
+        index = profiler->region_tail % VKD3D_EVENT_PROFILER_REGION_COUNT;
+        region = &profiler->regions[index];
+
+        /* Each query is followed by its availability. */
+        vr = VK_CALL(vkGetQueryPoolResults(device->vk_device, profiler->vk_query_pool, 2 * index, 2,
+                sizeof(values), values, 2 * sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT));
+
+        if (vr < 0 || !values[1] || !values[3])
+        {
+            if (vr >= 0 && now - region->begin_time_ns < VKD3D_EVENT_PROFILER_REGION_TIMEOUT_NS)
+                break;
+
+            profiler->dropped_count++;
+            profiler->region_tail++;
+            continue;
+        }
+
+        ticks = (values[2] - values[0]) & region->timestamp_mask;
+
+        result = &profiler->results[profiler->result_count++ % VKD3D_EVENT_PROFILER_RESULT_COUNT];
+        result->frameIndex = region->frame_index;
+        result->commandListType = region->type;
+        result->depth = region->depth;
+        result->gpuTimestamp = values[0];
+        result->cpuTimestamp = vkd3d_event_profiler_cpu_timestamp(values[0],
+                calibration_gpu, calibration_cpu, cpu_ticks_per_gpu_tick);
+        result->durationNs = (uint64_t)((double)ticks * timestamp_period);
+        memcpy(result->name, region->name, sizeof(result->name));
+
+        profiler->region_tail++;
+    }
+}
+
+/* Must be called with the profiler lock held. */
+static void vkd3d_event_profiler_log_results(struct vkd3d_event_profiler *profiler)
+{
+    const D3D12_VK_GPU_EVENT_TIMING *result;
+    uint64_t now;
+
+    now = vkd3d_profiling_get_tick_count();
+    if (now - profiler->last_log_time_ns < VKD3D_EVENT_PROFILER_LOG_INTERVAL_NS)
+        return;
+    profiler->last_log_time_ns = now;
+
+    /* Results which have already been overwritten are lost. */
+    if (profiler->result_count - profiler->logged_count > VKD3D_EVENT_PROFILER_RESULT_COUNT)
+        profiler->logged_count = profiler->result_count - VKD3D_EVENT_PROFILER_RESULT_COUNT;
+
+    for (; profiler->logged_count < profiler->result_count; profiler->logged_count++)
+    {
+        result = &profiler->results[profiler->logged_count % VKD3D_EVENT_PROFILER_RESULT_COUNT];
+        fprintf(profiler->log_file, "%"PRIu64",%u,%u,\"%s\",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+                result->frameIndex, result->commandListType, result->depth, result->name,
+                result->cpuTimestamp, result->gpuTimestamp, result->durationNs);
+    }
+
+    fflush(profiler->log_file);
+}
+
+void vkd3d_event_profiler_next_frame(struct vkd3d_event_profiler *profiler, struct d3d12_device *device)
+{
+    if (!profiler->active)
+        return;
+
+    pthread_mutex_lock(&profiler->lock);
+
+    vkd3d_event_profiler_resolve_regions(profiler, device);
+    profiler->frame_index++;
+
+    if (profiler->log_file)
+        vkd3d_event_profiler_log_results(profiler);
+
+    pthread_mutex_unlock(&profiler->lock);
+}
+
+HRESULT vkd3d_event_profiler_get_timings(struct vkd3d_event_profiler *profiler, struct d3d12_device *device,
+        uint64_t frame_index, D3D12_VK_GPU_EVENT_TIMING *timings, uint32_t *count)
+{
+    const D3D12_VK_GPU_EVENT_TIMING *result;
+    uint32_t max_count = *count;
+    uint64_t i, first;
+
+    if (!profiler->active)
+        return E_NOTIMPL;
+
+    pthread_mutex_lock(&profiler->lock);
+
+    vkd3d_event_profiler_resolve_regions(profiler, device);
+
+    first = profiler->result_count - min(profiler->result_count, (uint64_t)VKD3D_EVENT_PROFILER_RESULT_COUNT);
+    *count = 0;
+
+    for (i = first; i < profiler->result_count; i++)
+    {
+        result = &profiler->results[i % VKD3D_EVENT_PROFILER_RESULT_COUNT];
+
+        if (frame_index != D3D12_VK_GPU_EVENT_ALL_FRAMES && result->frameIndex != frame_index)
+            continue;
+
+        /* With no output array, only count the matching results. */
+        if (timings)
+        {
+            if (*count >= max_count)
+                break;
+            timings[*count] = *result;
+        }
+
+        (*count)++;
+    }
+
+    pthread_mutex_unlock(&profiler->lock);
+    return S_OK;
+}
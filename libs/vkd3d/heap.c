@@ -59,6 +59,7 @@ static void d3d12_heap_destroy(struct d3d12_heap *heap)
 {
     TRACE("Destroying heap %p.\n", heap);
 
+    vkd3d_residency_release_allocation(heap->device, heap->residency_count, &heap->allocation);
     vkd3d_free_memory(heap->device, &heap->device->memory_allocator, &heap->allocation);
     vkd3d_private_store_destroy(&heap->private_store);
     d3d12_device_release(heap->device);
@@ -225,6 +226,7 @@ static HRESULT d3d12_heap_init(struct d3d12_heap *heap, struct d3d12_device *dev
     memset(heap, 0, sizeof(*heap));
     heap->ID3D12Heap_iface.lpVtbl = &d3d12_heap_vtbl;
     heap->refcount = 1;
+    heap->residency_count = 1;
     heap->desc = *desc;
     heap->device = device;
 
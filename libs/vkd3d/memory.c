@@ -20,9 +20,23 @@
 
 #include "vkd3d_private.h"
 #include "vkd3d_descriptor_debug.h"
-
-static void vkd3d_memory_allocator_wait_allocation(struct vkd3d_memory_allocator *allocator,
-        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation);
+#include <stdio.h>
+
+#if !defined(_WIN32) && defined(__linux__)
+#include <linux/fs.h>
+#include <linux/userfaultfd.h>
+/* Asynchronous userfaultfd write-protection combined with PAGEMAP_SCAN gives us
+ * per-page dirty tracking without signal handlers, available since Linux 6.7. */
+#if defined(PAGEMAP_SCAN) && defined(UFFD_FEATURE_WP_ASYNC)
+#define VKD3D_WRITE_WATCH_PAGEMAP_SCAN
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
 
 static uint32_t vkd3d_select_memory_types(struct d3d12_device *device, const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags)
 {
@@ -140,9 +154,7 @@ static HRESULT vkd3d_create_global_buffer(struct d3d12_device *device, VkDeviceS
 
 void vkd3d_free_device_memory(struct d3d12_device *device, const struct vkd3d_device_memory_allocation *allocation)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkDeviceSize *type_current;
-    bool budget_sensitive;
+    struct vkd3d_deferred_destroy entry;
 
     if (allocation->vk_memory == VK_NULL_HANDLE)
     {
@@ -150,7 +162,44 @@ void vkd3d_free_device_memory(struct d3d12_device *device, const struct vkd3d_de
         return;
     }
 
+    entry.type = VKD3D_DEFERRED_DESTROY_DEVICE_MEMORY;
+    entry.device_allocation = *allocation;
+    vkd3d_deferred_destroy(device, &entry);
+}
+
+static void vkd3d_memory_info_update_usage(struct vkd3d_memory_info *info,
+        const struct vkd3d_device_memory_allocation *allocation, bool allocate)
+{
+    struct vkd3d_memory_type_usage *usage = &info->type_usage[allocation->vk_memory_type];
+
+    pthread_mutex_lock(&info->budget_lock);
+
+    if (allocate)
+    {
+        usage->allocated_bytes += allocation->size;
+        usage->allocation_count++;
+    }
+    else
+    {
+        usage->allocated_bytes -= allocation->size;
+        usage->allocation_count--;
+
+        if (allocation->is_fallback)
+            usage->fallback_bytes -= allocation->size;
+    }
+
+    pthread_mutex_unlock(&info->budget_lock);
+}
+
+void vkd3d_free_device_memory_immediate(struct d3d12_device *device, const struct vkd3d_device_memory_allocation *allocation)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkDeviceSize *type_current;
+    bool budget_sensitive;
+
+    vkd3d_memory_info_discard_flushes(&device->memory_info, allocation->vk_memory);
     VK_CALL(vkFreeMemory(device->vk_device, allocation->vk_memory, NULL));
+    vkd3d_memory_info_update_usage(&device->memory_info, allocation, false);
     budget_sensitive = !!(device->memory_info.budget_sensitive_mask & (1u << allocation->vk_memory_type));
     if (budget_sensitive)
     {
@@ -253,6 +302,8 @@ static HRESULT vkd3d_try_allocate_device_memory(struct d3d12_device *device,
         {
             allocation->vk_memory_type = type_index;
             allocation->size = size;
+            allocation->is_fallback = false;
+            vkd3d_memory_info_update_usage(memory_info, allocation, true);
             return S_OK;
         }
         else if (type_flags & optional_flags)
@@ -297,6 +348,14 @@ HRESULT vkd3d_allocate_device_memory(struct d3d12_device *device,
             WARN("Memory allocation failed, falling back to system memory.\n");
             hr = vkd3d_try_allocate_device_memory(device, size,
                     type_flags & ~optional_flags, type_mask, pNext, allocation);
+
+            if (SUCCEEDED(hr))
+            {
+                allocation->is_fallback = true;
+                pthread_mutex_lock(&device->memory_info.budget_lock);
+                device->memory_info.type_usage[allocation->vk_memory_type].fallback_bytes += size;
+                pthread_mutex_unlock(&device->memory_info.budget_lock);
+            }
         }
         else if (device->memory_properties.memoryHeapCount > 1)
         {
@@ -366,10 +425,61 @@ static HRESULT vkd3d_allocation_assign_gpu_address(struct vkd3d_memory_allocatio
     return S_OK;
 }
 
+#ifdef VKD3D_WRITE_WATCH_PAGEMAP_SCAN
+static pthread_once_t vkd3d_write_watch_once = PTHREAD_ONCE_INIT;
+static int vkd3d_write_watch_uffd = -1;
+static int vkd3d_write_watch_pagemap_fd = -1;
+static size_t vkd3d_write_watch_page_size;
+
+static void vkd3d_write_watch_init_once(void)
+{
+    struct uffdio_api api;
+    int uffd, pagemap_fd;
+
+    vkd3d_write_watch_page_size = sysconf(_SC_PAGESIZE);
+
+    if ((uffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK | UFFD_USER_MODE_ONLY)) < 0)
+    {
+        WARN("Failed to create userfaultfd, errno %d.\n", errno);
+        return;
+    }
+
+    memset(&api, 0, sizeof(api));
+    api.api = UFFD_API;
+    api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+
+    if (ioctl(uffd, UFFDIO_API, &api) < 0 || (api.features & UFFD_FEATURE_WP_ASYNC) != UFFD_FEATURE_WP_ASYNC)
+    {
+        WARN("Asynchronous userfaultfd write protection not supported, errno %d.\n", errno);
+        close(uffd);
+        return;
+    }
+
+    if ((pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC)) < 0)
+    {
+        WARN("Failed to open pagemap, errno %d.\n", errno);
+        close(uffd);
+        return;
+    }
+
+    vkd3d_write_watch_uffd = uffd;
+    vkd3d_write_watch_pagemap_fd = pagemap_fd;
+}
+
+static bool vkd3d_write_watch_init(void)
+{
+    pthread_once(&vkd3d_write_watch_once, vkd3d_write_watch_init_once);
+    return vkd3d_write_watch_uffd >= 0;
+}
+#endif
+
 static void *vkd3d_allocate_write_watch_pointer(const D3D12_HEAP_PROPERTIES *properties, VkDeviceSize size)
 {
-#ifdef _WIN32
-    DWORD protect;
+#if defined(_WIN32) || defined(VKD3D_WRITE_WATCH_PAGEMAP_SCAN)
+#ifndef _WIN32
+    struct uffdio_register reg;
+#endif
+    bool write_combine;
     void *ptr;
 
     switch (properties->Type)
@@ -377,7 +487,7 @@ static void *vkd3d_allocate_write_watch_pointer(const D3D12_HEAP_PROPERTIES *pro
     case D3D12_HEAP_TYPE_DEFAULT:
         return NULL;
     case D3D12_HEAP_TYPE_UPLOAD:
-        protect = PAGE_READWRITE | PAGE_WRITECOMBINE;
+        write_combine = true;
         break;
     case D3D12_HEAP_TYPE_READBACK:
         /* WRITE_WATCH fails for this type in native D3D12,
@@ -391,10 +501,10 @@ static void *vkd3d_allocate_write_watch_pointer(const D3D12_HEAP_PROPERTIES *pro
         case D3D12_CPU_PAGE_PROPERTY_NOT_AVAILABLE:
             return NULL;
         case D3D12_CPU_PAGE_PROPERTY_WRITE_COMBINE:
-            protect = PAGE_READWRITE | PAGE_WRITECOMBINE;
+            write_combine = true;
             break;
         case D3D12_CPU_PAGE_PROPERTY_WRITE_BACK:
-            protect = PAGE_READWRITE;
+            write_combine = false;
             break;
         default:
             ERR("Invalid CPU page property %#x.\n", properties->CPUPageProperty);
@@ -406,11 +516,46 @@ static void *vkd3d_allocate_write_watch_pointer(const D3D12_HEAP_PROPERTIES *pro
         return NULL;
     }
 
-    if (!(ptr = VirtualAlloc(NULL, (SIZE_T)size, MEM_COMMIT | MEM_RESERVE | MEM_WRITE_WATCH, protect)))
+#ifdef _WIN32
+    if (!(ptr = VirtualAlloc(NULL, (SIZE_T)size, MEM_COMMIT | MEM_RESERVE | MEM_WRITE_WATCH,
+            PAGE_READWRITE | (write_combine ? PAGE_WRITECOMBINE : 0))))
     {
         ERR("Failed to allocate write watch pointer %#x.\n", GetLastError());
         return NULL;
     }
+#else
+    /* Memory is imported into Vulkan, so caching is decided by the memory type */
+    (void)write_combine;
+
+    if (!vkd3d_write_watch_init())
+    {
+        ERR("WRITE_WATCH not supported by this kernel.\n");
+        return NULL;
+    }
+
+    size = align(size, vkd3d_write_watch_page_size);
+
+    if ((ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+    {
+        ERR("Failed to allocate write watch pointer, errno %d.\n", errno);
+        return NULL;
+    }
+
+    /* With asynchronous write protection, the kernel resolves write faults
+     * by itself and marks the page as written, which PAGEMAP_SCAN reports.
+     * Protection is only armed once the pointer is imported, see below. */
+    memset(&reg, 0, sizeof(reg));
+    reg.range.start = (uintptr_t)ptr;
+    reg.range.len = size;
+    reg.mode = UFFDIO_REGISTER_MODE_WP;
+
+    if (ioctl(vkd3d_write_watch_uffd, UFFDIO_REGISTER, &reg) < 0)
+    {
+        ERR("Failed to register write watch pointer, errno %d.\n", errno);
+        munmap(ptr, size);
+        return NULL;
+    }
+#endif
 
     return ptr;
 #else
@@ -422,27 +567,138 @@ static void *vkd3d_allocate_write_watch_pointer(const D3D12_HEAP_PROPERTIES *pro
 #endif
 }
 
-static void vkd3d_free_write_watch_pointer(void *pointer)
+/* Importing host memory pins the pages for writing, which counts as a write
+ * to every page. Start tracking from a clean state once the import is done. */
+static bool vkd3d_arm_write_watch_pointer(void *pointer, VkDeviceSize size)
+{
+#ifdef _WIN32
+    if (ResetWriteWatch(pointer, (SIZE_T)size))
+    {
+        ERR("Failed to reset write watch pointer.\n");
+        return false;
+    }
+
+    return true;
+#elif defined(VKD3D_WRITE_WATCH_PAGEMAP_SCAN)
+    struct uffdio_writeprotect writeprotect;
+
+    memset(&writeprotect, 0, sizeof(writeprotect));
+    writeprotect.range.start = (uintptr_t)pointer;
+    writeprotect.range.len = align(size, vkd3d_write_watch_page_size);
+    writeprotect.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+
+    if (ioctl(vkd3d_write_watch_uffd, UFFDIO_WRITEPROTECT, &writeprotect) < 0)
+    {
+        ERR("Failed to write-protect write watch pointer, errno %d.\n", errno);
+        return false;
+    }
+
+    return true;
+#else
+    (void)pointer;
+    (void)size;
+    return false;
+#endif
+}
+
+static void vkd3d_free_write_watch_pointer(void *pointer, VkDeviceSize size)
 {
 #ifdef _WIN32
+    (void)size;
+
     if (!VirtualFree(pointer, 0, MEM_RELEASE))
         ERR("Failed to free write watch pointer %#x.\n", GetLastError());
+#elif defined(VKD3D_WRITE_WATCH_PAGEMAP_SCAN)
+    /* Unmapping implicitly unregisters the range from userfaultfd */
+    if (munmap(pointer, align(size, vkd3d_write_watch_page_size)) < 0)
+        ERR("Failed to free write watch pointer, errno %d.\n", errno);
 #else
     /* Not supported on other platforms. */
     (void)pointer;
+    (void)size;
 #endif
 }
 
-static void vkd3d_memory_allocation_free(const struct vkd3d_memory_allocation *allocation, struct d3d12_device *device, struct vkd3d_memory_allocator *allocator)
+HRESULT vkd3d_get_write_watch(UINT32 flags, void *base_address, SIZE_T region_size,
+        void **addresses, UINT64 *address_count, UINT32 *granularity)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+#ifdef _WIN32
+    ULONG_PTR count = *address_count;
+    ULONG page_size;
+
+    if (GetWriteWatch((flags & D3D12_VK_WRITE_WATCH_FLAG_RESET) ? WRITE_WATCH_FLAG_RESET : 0,
+            base_address, region_size, addresses, &count, &page_size))
+        return E_INVALIDARG;
 
+    *address_count = count;
+    *granularity = page_size;
+    return S_OK;
+#elif defined(VKD3D_WRITE_WATCH_PAGEMAP_SCAN)
+    struct page_region regions[64];
+    struct pm_scan_arg scan;
+    uint64_t count = 0;
+    uintptr_t address;
+    int i, region_count;
+
+    if (!vkd3d_write_watch_init())
+        return E_NOTIMPL;
+
+    memset(&scan, 0, sizeof(scan));
+    scan.size = sizeof(scan);
+    scan.flags = PM_SCAN_CHECK_WPASYNC;
+    scan.start = (uintptr_t)base_address & ~(uintptr_t)(vkd3d_write_watch_page_size - 1);
+    scan.end = align((uintptr_t)base_address + region_size, vkd3d_write_watch_page_size);
+    scan.vec = (uintptr_t)regions;
+    scan.vec_len = ARRAY_SIZE(regions);
+    scan.category_mask = PAGE_IS_WRITTEN;
+    scan.return_mask = PAGE_IS_WRITTEN;
+
+    /* Re-protect written pages atomically with the scan, so that writes
+     * racing with the query are reported by the next query instead. */
+    if (flags & D3D12_VK_WRITE_WATCH_FLAG_RESET)
+        scan.flags |= PM_SCAN_WP_MATCHING;
+
+    while (count < *address_count && scan.start < scan.end)
+    {
+        scan.max_pages = *address_count - count;
+
+        if ((region_count = ioctl(vkd3d_write_watch_pagemap_fd, PAGEMAP_SCAN, &scan)) < 0)
+        {
+            WARN("Failed to scan pagemap, errno %d.\n", errno);
+            return E_INVALIDARG;
+        }
+
+        for (i = 0; i < region_count; i++)
+        {
+            for (address = regions[i].start; address < regions[i].end; address += vkd3d_write_watch_page_size)
+                addresses[count++] = (void *)address;
+        }
+
+        scan.start = scan.walk_end;
+    }
+
+    *address_count = count;
+    *granularity = vkd3d_write_watch_page_size;
+    return S_OK;
+#else
+    (void)flags;
+    (void)base_address;
+    (void)region_size;
+    (void)addresses;
+    (void)address_count;
+    (void)granularity;
+    return E_NOTIMPL;
+#endif
+}
+
+static void vkd3d_memory_allocation_free(const struct vkd3d_memory_allocation *allocation, struct d3d12_device *device, struct vkd3d_memory_allocator *allocator)
+{
     TRACE("allocation %p, device %p, allocator %p.\n", allocation, device, allocator);
 
     vkd3d_descriptor_debug_unregister_cookie(device->descriptor_qa_global_info, allocation->resource.cookie);
 
     if (allocation->flags & VKD3D_ALLOCATION_FLAG_ALLOW_WRITE_WATCH)
-        vkd3d_free_write_watch_pointer(allocation->cpu_address);
+        vkd3d_free_write_watch_pointer(allocation->cpu_address, allocation->device_allocation.size);
 
     if ((allocation->flags & VKD3D_ALLOCATION_FLAG_GPU_ADDRESS) && allocation->resource.va)
     {
@@ -459,7 +715,7 @@ static void vkd3d_memory_allocation_free(const struct vkd3d_memory_allocation *a
     }
 
     if (allocation->flags & VKD3D_ALLOCATION_FLAG_GLOBAL_BUFFER)
-        VK_CALL(vkDestroyBuffer(device->vk_device, allocation->resource.vk_buffer, NULL));
+        vkd3d_deferred_destroy_buffer(device, allocation->resource.vk_buffer);
 
     vkd3d_free_device_memory(device, &allocation->device_allocation);
 }
@@ -570,6 +826,8 @@ static HRESULT vkd3d_memory_allocation_init(struct vkd3d_memory_allocation *allo
 
     if (FAILED(hr))
     {
+        if (allocation->flags & VKD3D_ALLOCATION_FLAG_ALLOW_WRITE_WATCH)
+            vkd3d_free_write_watch_pointer(host_ptr, memory_requirements.size);
         VK_CALL(vkDestroyBuffer(device->vk_device, allocation->resource.vk_buffer, NULL));
         return hr;
     }
@@ -583,6 +841,13 @@ static HRESULT vkd3d_memory_allocation_init(struct vkd3d_memory_allocation *allo
 
         /* No need to call map here, we already know the pointer. */
         allocation->cpu_address = host_ptr;
+
+        if ((allocation->flags & VKD3D_ALLOCATION_FLAG_ALLOW_WRITE_WATCH) &&
+                !vkd3d_arm_write_watch_pointer(host_ptr, memory_requirements.size))
+        {
+            vkd3d_memory_allocation_free(allocation, device, allocator);
+            return E_OUTOFMEMORY;
+        }
     }
     else if (type_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
     {
@@ -633,178 +898,293 @@ static HRESULT vkd3d_memory_allocation_init(struct vkd3d_memory_allocation *allo
     return S_OK;
 }
 
-static void vkd3d_memory_chunk_insert_range(struct vkd3d_memory_chunk *chunk,
-        size_t index, VkDeviceSize offset, VkDeviceSize length)
+static void vkd3d_memory_tlsf_mapping(VkDeviceSize size, uint32_t *fl, uint32_t *sl)
 {
-    if (!vkd3d_array_reserve((void**)&chunk->free_ranges, &chunk->free_ranges_size,
-            chunk->free_ranges_count + 1, sizeof(*chunk->free_ranges)))
+    unsigned int msb;
+
+    if (size < (1u << VKD3D_MEMORY_TLSF_MIN_SIZE_BITS))
     {
-        ERR("Failed to insert free range.\n");
-        return;
+        *fl = 0;
+        *sl = (uint32_t)size >> (VKD3D_MEMORY_TLSF_MIN_SIZE_BITS - VKD3D_MEMORY_TLSF_SL_BITS);
+    }
+    else
+    {
+        /* Chunks never exceed 4 GiB, so block sizes fit into 32 bits */
+        msb = vkd3d_log2i((uint32_t)size);
+        *fl = msb - VKD3D_MEMORY_TLSF_MIN_SIZE_BITS + 1;
+        *sl = ((uint32_t)size >> (msb - VKD3D_MEMORY_TLSF_SL_BITS)) ^ VKD3D_MEMORY_TLSF_SL_COUNT;
     }
+}
+
+static bool vkd3d_memory_tlsf_mapping_search(VkDeviceSize size, uint32_t *fl, uint32_t *sl)
+{
+    unsigned int round_bits = VKD3D_MEMORY_TLSF_MIN_SIZE_BITS - VKD3D_MEMORY_TLSF_SL_BITS;
+
+    if (size >= (1ull << 32))
+        return false;
+
+    /* Round up to the next list boundary so that any block in the
+     * returned list is guaranteed to be large enough */
+    if (size >= (1u << VKD3D_MEMORY_TLSF_MIN_SIZE_BITS))
+        round_bits = vkd3d_log2i((uint32_t)size) - VKD3D_MEMORY_TLSF_SL_BITS;
 
-    memmove(&chunk->free_ranges[index + 1], &chunk->free_ranges[index],
-            sizeof(*chunk->free_ranges) * (chunk->free_ranges_count - index));
+    size += (1ull << round_bits) - 1;
 
-    chunk->free_ranges[index].offset = offset;
-    chunk->free_ranges[index].length = length;
-    chunk->free_ranges_count++;
+    if (size >= (1ull << 32))
+        return false;
+
+    vkd3d_memory_tlsf_mapping(size, fl, sl);
+    return *fl < VKD3D_MEMORY_TLSF_FL_COUNT;
 }
 
-static void vkd3d_memory_chunk_remove_range(struct vkd3d_memory_chunk *chunk, size_t index)
+static uint32_t vkd3d_memory_chunk_find_free_block(struct vkd3d_memory_chunk *chunk, uint32_t fl, uint32_t sl)
 {
-    chunk->free_ranges_count--;
+    uint32_t sl_map, fl_map;
+
+    sl_map = chunk->sl_bitmaps[fl] & (~0u << sl);
+
+    if (!sl_map)
+    {
+        fl_map = chunk->fl_bitmap & (~0u << (fl + 1));
+
+        if (!fl_map)
+            return VKD3D_MEMORY_BLOCK_NONE;
+
+        fl = vkd3d_bitmask_tzcnt32(fl_map);
+        sl_map = chunk->sl_bitmaps[fl];
+    }
 
-    memmove(&chunk->free_ranges[index], &chunk->free_ranges[index + 1],
-            sizeof(*chunk->free_ranges) * (chunk->free_ranges_count - index));
+    sl = vkd3d_bitmask_tzcnt32(sl_map);
+    return chunk->free_lists[fl][sl];
 }
 
-static HRESULT vkd3d_memory_chunk_allocate_range(struct vkd3d_memory_chunk *chunk, const VkMemoryRequirements *memory_requirements,
-        struct vkd3d_memory_allocation *allocation)
+static void vkd3d_memory_chunk_insert_free_block(struct vkd3d_memory_chunk *chunk, uint32_t index)
 {
-    struct vkd3d_memory_free_range *pick_range;
-    VkDeviceSize l_length, r_length;
-    size_t i, pick_index;
-
-    if (!chunk->free_ranges_count)
-        return E_OUTOFMEMORY;
+    struct vkd3d_memory_block *block = &chunk->blocks[index];
+    uint32_t fl, sl, head;
 
-    pick_index = chunk->free_ranges_count;
-    pick_range = NULL;
+    vkd3d_memory_tlsf_mapping(block->length, &fl, &sl);
+    head = chunk->free_lists[fl][sl];
 
-    for (i = 0; i < chunk->free_ranges_count; i++)
-    {
-        struct vkd3d_memory_free_range *range = &chunk->free_ranges[i];
+    block->is_free = true;
+    block->prev_free = VKD3D_MEMORY_BLOCK_NONE;
+    block->next_free = head;
 
-        if (range->offset + range->length < align(range->offset, memory_requirements->alignment) + memory_requirements->size)
-            continue;
+    if (head != VKD3D_MEMORY_BLOCK_NONE)
+        chunk->blocks[head].prev_free = index;
 
-        /* Exact fit leaving no gaps */
-        if (range->length == memory_requirements->size)
-        {
-            pick_index = i;
-            pick_range = range;
-            break;
-        }
+    chunk->free_lists[fl][sl] = index;
+    chunk->fl_bitmap |= 1u << fl;
+    chunk->sl_bitmaps[fl] |= 1u << sl;
+}
 
-        /* Alignment is almost always going to be 64 KiB, so
-         * don't worry too much about misalignment gaps here */
-        if (!pick_range || range->length > pick_range->length)
-        {
-            pick_index = i;
-            pick_range = range;
-        }
-    }
+static void vkd3d_memory_chunk_remove_free_block(struct vkd3d_memory_chunk *chunk, uint32_t index)
+{
+    struct vkd3d_memory_block *block = &chunk->blocks[index];
+    uint32_t fl, sl;
 
-    if (!pick_range)
-        return E_OUTOFMEMORY;
+    vkd3d_memory_tlsf_mapping(block->length, &fl, &sl);
 
-    /* Adjust offsets and addresses of the base allocation */
-    vkd3d_memory_allocation_slice(allocation, &chunk->allocation,
-            align(pick_range->offset, memory_requirements->alignment),
-            memory_requirements->size);
-    allocation->chunk = chunk;
+    if (block->prev_free != VKD3D_MEMORY_BLOCK_NONE)
+        chunk->blocks[block->prev_free].next_free = block->next_free;
+    else
+        chunk->free_lists[fl][sl] = block->next_free;
 
-    /* Remove allocated range from the free list */
-    l_length = allocation->offset - pick_range->offset;
-    r_length = pick_range->offset + pick_range->length
-            - allocation->offset - allocation->resource.size;
+    if (block->next_free != VKD3D_MEMORY_BLOCK_NONE)
+        chunk->blocks[block->next_free].prev_free = block->prev_free;
 
-    if (l_length)
+    if (chunk->free_lists[fl][sl] == VKD3D_MEMORY_BLOCK_NONE)
     {
-        pick_range->length = l_length;
+        chunk->sl_bitmaps[fl] &= ~(1u << sl);
 
-        if (r_length)
-        {
-            vkd3d_memory_chunk_insert_range(chunk, pick_index + 1,
-                allocation->offset + allocation->resource.size, r_length);
-        }
+        if (!chunk->sl_bitmaps[fl])
+            chunk->fl_bitmap &= ~(1u << fl);
     }
-    else if (r_length)
+
+    block->is_free = false;
+}
+
+static bool vkd3d_memory_chunk_reserve_blocks(struct vkd3d_memory_chunk *chunk, size_t count)
+{
+    size_t available = 0;
+    uint32_t index;
+
+    for (index = chunk->unused_blocks; index != VKD3D_MEMORY_BLOCK_NONE && available < count;
+            index = chunk->blocks[index].next_free)
+        available++;
+
+    return available >= count || vkd3d_array_reserve((void**)&chunk->blocks, &chunk->blocks_size,
+            chunk->blocks_count + count - available, sizeof(*chunk->blocks));
+}
+
+/* Storage must have been reserved with vkd3d_memory_chunk_reserve_blocks */
+static uint32_t vkd3d_memory_chunk_create_block(struct vkd3d_memory_chunk *chunk,
+        VkDeviceSize offset, VkDeviceSize length)
+{
+    struct vkd3d_memory_block *block;
+    uint32_t index;
+
+    if (chunk->unused_blocks != VKD3D_MEMORY_BLOCK_NONE)
     {
-        pick_range->offset = allocation->offset + allocation->resource.size;
-        pick_range->length = r_length;
+        index = chunk->unused_blocks;
+        chunk->unused_blocks = chunk->blocks[index].next_free;
     }
     else
-    {
-        vkd3d_memory_chunk_remove_range(chunk, pick_index);
-    }
+        index = chunk->blocks_count++;
+
+    block = &chunk->blocks[index];
+    memset(block, 0, sizeof(*block));
+    block->offset = offset;
+    block->length = length;
+    block->prev_phys = VKD3D_MEMORY_BLOCK_NONE;
+    block->next_phys = VKD3D_MEMORY_BLOCK_NONE;
+    block->prev_free = VKD3D_MEMORY_BLOCK_NONE;
+    block->next_free = VKD3D_MEMORY_BLOCK_NONE;
+    return index;
+}
 
-    return S_OK;
+static void vkd3d_memory_chunk_destroy_block(struct vkd3d_memory_chunk *chunk, uint32_t index)
+{
+    chunk->blocks[index].next_free = chunk->unused_blocks;
+    chunk->unused_blocks = index;
 }
 
-static size_t vkd3d_memory_chunk_find_range(struct vkd3d_memory_chunk *chunk, VkDeviceSize offset)
+static bool vkd3d_memory_block_fits(const struct vkd3d_memory_block *block, const VkMemoryRequirements *memory_requirements)
 {
-    struct vkd3d_memory_free_range *range;
-    size_t index, hi, lo;
+    return block->offset + block->length >= align(block->offset, memory_requirements->alignment) + memory_requirements->size;
+}
 
-    lo = 0;
-    hi = chunk->free_ranges_count;
+static uint32_t vkd3d_memory_chunk_find_block(struct vkd3d_memory_chunk *chunk, const VkMemoryRequirements *memory_requirements)
+{
+    uint32_t fl, sl, index;
 
-    while (lo < hi)
+    /* Most blocks start at suitably aligned offsets already, so try
+     * the exact size first and only pad for alignment if needed. */
+    if (vkd3d_memory_tlsf_mapping_search(memory_requirements->size, &fl, &sl))
     {
-        index = lo + (hi - lo) / 2;
-        range = &chunk->free_ranges[index];
+        index = vkd3d_memory_chunk_find_free_block(chunk, fl, sl);
 
-        if (range->offset > offset)
-            hi = index;
-        else
-            lo = index + 1;
+        if (index == VKD3D_MEMORY_BLOCK_NONE || vkd3d_memory_block_fits(&chunk->blocks[index], memory_requirements))
+            return index;
     }
 
-    return lo;
+    if (memory_requirements->alignment <= 1 || !vkd3d_memory_tlsf_mapping_search(
+            memory_requirements->size + memory_requirements->alignment - 1, &fl, &sl))
+        return VKD3D_MEMORY_BLOCK_NONE;
+
+    return vkd3d_memory_chunk_find_free_block(chunk, fl, sl);
 }
 
-static void vkd3d_memory_chunk_free_range(struct vkd3d_memory_chunk *chunk, const struct vkd3d_memory_allocation *allocation)
+static HRESULT vkd3d_memory_chunk_allocate_range(struct vkd3d_memory_chunk *chunk, const VkMemoryRequirements *memory_requirements,
+        struct vkd3d_memory_allocation *allocation)
 {
-    struct vkd3d_memory_free_range *range;
-    bool adjacent_l, adjacent_r;
-    size_t index;
+    VkDeviceSize offset, l_length, r_length;
+    struct vkd3d_memory_block *block;
+    uint32_t index, new_index;
 
-    index = vkd3d_memory_chunk_find_range(chunk, allocation->offset);
+    if (!chunk->fl_bitmap)
+        return E_OUTOFMEMORY;
 
-    adjacent_l = false;
-    adjacent_r = false;
+    if ((index = vkd3d_memory_chunk_find_block(chunk, memory_requirements)) == VKD3D_MEMORY_BLOCK_NONE)
+        return E_OUTOFMEMORY;
 
-    if (index > 0)
+    /* Splitting may create up to two new blocks */
+    if (!vkd3d_memory_chunk_reserve_blocks(chunk, 2))
     {
-        range = &chunk->free_ranges[index - 1];
-        adjacent_l = range->offset + range->length == allocation->offset;
+        ERR("Failed to reserve memory blocks.\n");
+        return E_OUTOFMEMORY;
     }
 
-    if (index < chunk->free_ranges_count)
+    vkd3d_memory_chunk_remove_free_block(chunk, index);
+
+    block = &chunk->blocks[index];
+    offset = align(block->offset, memory_requirements->alignment);
+    l_length = offset - block->offset;
+    r_length = block->offset + block->length - offset - memory_requirements->size;
+
+    if (l_length)
     {
-        range = &chunk->free_ranges[index];
-        adjacent_r = range->offset == allocation->offset + allocation->resource.size;
+        new_index = vkd3d_memory_chunk_create_block(chunk, block->offset, l_length);
+        chunk->blocks[new_index].prev_phys = block->prev_phys;
+        chunk->blocks[new_index].next_phys = index;
+
+        if (block->prev_phys != VKD3D_MEMORY_BLOCK_NONE)
+            chunk->blocks[block->prev_phys].next_phys = new_index;
+
+        block->prev_phys = new_index;
+        vkd3d_memory_chunk_insert_free_block(chunk, new_index);
     }
 
-    if (adjacent_l)
+    if (r_length)
     {
-        range = &chunk->free_ranges[index - 1];
-        range->length += allocation->resource.size;
+        new_index = vkd3d_memory_chunk_create_block(chunk, offset + memory_requirements->size, r_length);
+        chunk->blocks[new_index].prev_phys = index;
+        chunk->blocks[new_index].next_phys = block->next_phys;
 
-        if (adjacent_r)
-        {
-            range->length += chunk->free_ranges[index].length;
-            vkd3d_memory_chunk_remove_range(chunk, index);
-        }
+        if (block->next_phys != VKD3D_MEMORY_BLOCK_NONE)
+            chunk->blocks[block->next_phys].prev_phys = new_index;
+
+        block->next_phys = new_index;
+        vkd3d_memory_chunk_insert_free_block(chunk, new_index);
     }
-    else if (adjacent_r)
+
+    block->offset = offset;
+    block->length = memory_requirements->size;
+    chunk->allocation_count++;
+
+    /* Adjust offsets and addresses of the base allocation */
+    vkd3d_memory_allocation_slice(allocation, &chunk->allocation,
+            offset, memory_requirements->size);
+    allocation->chunk = chunk;
+    allocation->chunk_block = index;
+    return S_OK;
+}
+
+static void vkd3d_memory_chunk_merge_blocks(struct vkd3d_memory_chunk *chunk, uint32_t index, uint32_t next_index)
+{
+    struct vkd3d_memory_block *block = &chunk->blocks[index];
+    struct vkd3d_memory_block *next = &chunk->blocks[next_index];
+
+    block->length += next->length;
+    block->next_phys = next->next_phys;
+
+    if (next->next_phys != VKD3D_MEMORY_BLOCK_NONE)
+        chunk->blocks[next->next_phys].prev_phys = index;
+
+    vkd3d_memory_chunk_destroy_block(chunk, next_index);
+}
+
+static void vkd3d_memory_chunk_free_range(struct vkd3d_memory_chunk *chunk, const struct vkd3d_memory_allocation *allocation)
+{
+    uint32_t index = allocation->chunk_block;
+    struct vkd3d_memory_block *block;
+    uint32_t neighbour;
+
+    block = &chunk->blocks[index];
+    neighbour = block->next_phys;
+
+    if (neighbour != VKD3D_MEMORY_BLOCK_NONE && chunk->blocks[neighbour].is_free)
     {
-        range = &chunk->free_ranges[index];
-        range->offset = allocation->offset;
-        range->length += allocation->resource.size;
+        vkd3d_memory_chunk_remove_free_block(chunk, neighbour);
+        vkd3d_memory_chunk_merge_blocks(chunk, index, neighbour);
     }
-    else
+
+    neighbour = block->prev_phys;
+
+    if (neighbour != VKD3D_MEMORY_BLOCK_NONE && chunk->blocks[neighbour].is_free)
     {
-        vkd3d_memory_chunk_insert_range(chunk, index,
-                allocation->offset, allocation->resource.size);
+        vkd3d_memory_chunk_remove_free_block(chunk, neighbour);
+        vkd3d_memory_chunk_merge_blocks(chunk, neighbour, index);
+        index = neighbour;
     }
+
+    vkd3d_memory_chunk_insert_free_block(chunk, index);
+    chunk->allocation_count--;
 }
 
 static bool vkd3d_memory_chunk_is_free(struct vkd3d_memory_chunk *chunk)
 {
-    return chunk->free_ranges_count == 1 && chunk->free_ranges[0].length == chunk->allocation.resource.size;
+    return !chunk->allocation_count;
 }
 
 static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
@@ -819,14 +1199,24 @@ static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, struct vkd
         return E_OUTOFMEMORY;
 
     memset(object, 0, sizeof(*object));
+    memset(object->free_lists, 0xff, sizeof(object->free_lists));
+    object->unused_blocks = VKD3D_MEMORY_BLOCK_NONE;
+
+    if (!vkd3d_memory_chunk_reserve_blocks(object, 1))
+    {
+        vkd3d_free(object);
+        return E_OUTOFMEMORY;
+    }
 
     if (FAILED(hr = vkd3d_memory_allocation_init(&object->allocation, device, allocator, info)))
     {
+        vkd3d_free(object->blocks);
         vkd3d_free(object);
         return hr;
     }
 
-    vkd3d_memory_chunk_insert_range(object, 0, 0, object->allocation.resource.size);
+    vkd3d_memory_chunk_insert_free_block(object,
+            vkd3d_memory_chunk_create_block(object, 0, object->allocation.resource.size));
     *chunk = object;
 
     TRACE("Created chunk %p (allocation %p).\n", object, &object->allocation);
@@ -837,66 +1227,181 @@ static void vkd3d_memory_chunk_destroy(struct vkd3d_memory_chunk *chunk, struct
 {
     TRACE("chunk %p, device %p, allocator %p.\n", chunk, device, allocator);
 
-    if (chunk->allocation.clear_semaphore_value)
-        vkd3d_memory_allocator_wait_allocation(allocator, device, &chunk->allocation);
-
     vkd3d_memory_allocation_free(&chunk->allocation, device, allocator);
-    vkd3d_free(chunk->free_ranges);
+    vkd3d_free(chunk->blocks);
     vkd3d_free(chunk);
 }
 
 static void vkd3d_memory_allocator_remove_chunk(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device, struct vkd3d_memory_chunk *chunk)
 {
-    size_t i;
+    struct vkd3d_memory_chunk_list *list = &allocator->chunk_lists[chunk->allocation.device_allocation.vk_memory_type];
 
-    for (i = 0; i < allocator->chunks_count; i++)
-    {
-        if (allocator->chunks[i] == chunk)
-        {
-            allocator->chunks[i] = allocator->chunks[--allocator->chunks_count];
-            break;
-        }
-    }
+    list->chunks[chunk->list_index] = list->chunks[--list->chunks_count];
+    list->chunks[chunk->list_index]->list_index = chunk->list_index;
 
     vkd3d_memory_chunk_destroy(chunk, device, allocator);
 }
 
-static void vkd3d_memory_allocator_cleanup_clear_queue(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
+/* Heap flags which do not affect whether a chunk can be used */
+static const D3D12_HEAP_FLAGS vkd3d_memory_chunk_heap_flag_mask =
+        ~(D3D12_HEAP_FLAG_CREATE_NOT_ZEROED | D3D12_HEAP_FLAG_CREATE_NOT_RESIDENT);
+
+/* Small suballocations freed by a thread are kept around for that
+ * thread to reuse, so streaming threads rarely touch the shard locks.
+ * There is deliberately no thread exit hook, since a key destructor would
+ * outlive the library if it is unloaded. Whatever an exiting thread still
+ * caches, at most VKD3D_MEMORY_THREAD_CACHE_SIZE small ranges, is
+ * reclaimed when the allocator destroys its chunks. */
+#define VKD3D_MEMORY_THREAD_CACHE_SIZE (8u)
+#define VKD3D_MEMORY_THREAD_CACHE_MAX_ALLOCATION_SIZE (64ull << 10) /* 64 KiB */
+
+struct vkd3d_memory_thread_cache
 {
-    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    LONG64 allocator_cookie;
+    struct vkd3d_memory_allocation allocations[VKD3D_MEMORY_THREAD_CACHE_SIZE];
+    uint32_t count;
+};
 
-    VK_CALL(vkDestroyCommandPool(device->vk_device, clear_queue->vk_command_pool, NULL));
-    VK_CALL(vkDestroySemaphore(device->vk_device, clear_queue->vk_semaphore, NULL));
+static VKD3D_THREAD_LOCAL struct vkd3d_memory_thread_cache vkd3d_memory_thread_cache;
 
-    vkd3d_free(clear_queue->allocations);
-    pthread_mutex_destroy(&clear_queue->mutex);
-}
+/* Live allocators, so that a thread cache can find the owner of its
+ * entries. An allocator leaves the list before its chunks are destroyed. */
+static pthread_mutex_t vkd3d_memory_allocator_list_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct list vkd3d_memory_allocator_list = LIST_INIT(vkd3d_memory_allocator_list);
 
-static HRESULT vkd3d_memory_allocator_init_clear_queue(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
+static void vkd3d_memory_allocator_free_suballocation(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation);
+
+static void vkd3d_memory_thread_cache_flush(struct vkd3d_memory_thread_cache *cache)
 {
-    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkSemaphoreTypeCreateInfoKHR semaphore_type_info;
-    VkCommandBufferAllocateInfo command_buffer_info;
-    VkCommandPoolCreateInfo command_pool_info;
-    VkSemaphoreCreateInfo semaphore_info;
-    VkResult vr;
-    HRESULT hr;
-    int rc;
+    struct vkd3d_memory_allocator *allocator;
+    uint32_t i;
 
-    /* vkd3d_memory_allocator_init will memset the entire
-     * clear_queue struct to zero prior to calling this */
-    clear_queue->last_known_value = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT;
-    clear_queue->next_signal_value = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT + 1;
+    if (!cache->count)
+        return;
 
-    if ((rc = pthread_mutex_init(&allocator->mutex, NULL)))
-        return hresult_from_errno(rc);
+    pthread_mutex_lock(&vkd3d_memory_allocator_list_mutex);
+
+    LIST_FOR_EACH_ENTRY(allocator, &vkd3d_memory_allocator_list, struct vkd3d_memory_allocator, entry)
+    {
+        if (allocator->cookie != cache->allocator_cookie)
+            continue;
+
+        for (i = 0; i < cache->count; i++)
+            vkd3d_memory_allocator_free_suballocation(allocator, allocator->device, &cache->allocations[i]);
+        break;
+    }
+
+    pthread_mutex_unlock(&vkd3d_memory_allocator_list_mutex);
+    cache->count = 0;
+}
+
+static void vkd3d_memory_allocator_stop_clear_thread(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+
+    if (!clear_queue->thread_running)
+        return;
+
+    pthread_mutex_lock(&clear_queue->mutex);
+    clear_queue->stopping = true;
+    condvar_reltime_signal(&clear_queue->cond);
+    pthread_mutex_unlock(&clear_queue->mutex);
+
+    vkd3d_join_thread(device->vkd3d_instance, &clear_queue->thread);
+    clear_queue->thread_running = false;
+}
+
+static void vkd3d_memory_allocator_cleanup_clear_queue(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    condvar_reltime_destroy(&clear_queue->cond);
+
+    VK_CALL(vkDestroyCommandPool(device->vk_device, clear_queue->vk_command_pool, NULL));
+    VK_CALL(vkDestroySemaphore(device->vk_device, clear_queue->vk_semaphore, NULL));
+
+    vkd3d_free(clear_queue->allocations);
+    pthread_mutex_destroy(&clear_queue->mutex);
+}
+
+#define VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES (256ull << 20) /* 256 MiB */
+/* Submit clears early during long loads without any ExecuteCommandLists
+ * calls, so that the DMA queue works in the background. */
+#define VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_TIME_NS (2000000ull) /* 2 ms */
+
+static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device);
+
+static void *vkd3d_memory_clear_queue_main(void *userdata)
+{
+    struct vkd3d_memory_allocator *allocator = userdata;
+    struct vkd3d_memory_clear_queue *clear_queue;
+    uint64_t now, deadline;
+    VKD3D_REGION_DECL(flush_clears_deadline);
+
+    vkd3d_set_thread_name("vkd3d_clear");
+    clear_queue = &allocator->clear_queue;
+
+    pthread_mutex_lock(&clear_queue->mutex);
+
+    while (!clear_queue->stopping)
+    {
+        if (!clear_queue->allocations_count)
+        {
+            condvar_reltime_wait(&clear_queue->cond, &clear_queue->mutex);
+            continue;
+        }
+
+        deadline = clear_queue->first_pending_time_ns + VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_TIME_NS;
+        now = vkd3d_profiling_get_tick_count();
+
+        if (now < deadline)
+        {
+            condvar_reltime_wait_timeout_ns(&clear_queue->cond, &clear_queue->mutex, deadline - now);
+            continue;
+        }
+
+        VKD3D_REGION_BEGIN_DETAIL(flush_clears_deadline);
+        vkd3d_memory_allocator_flush_clears_locked(allocator, allocator->device);
+        VKD3D_REGION_END_DETAIL(flush_clears_deadline);
+    }
+
+    pthread_mutex_unlock(&clear_queue->mutex);
+    return NULL;
+}
+
+static HRESULT vkd3d_memory_allocator_init_clear_queue(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkSemaphoreTypeCreateInfoKHR semaphore_type_info;
+    VkCommandBufferAllocateInfo command_buffer_info;
+    VkCommandPoolCreateInfo command_pool_info;
+    VkSemaphoreCreateInfo semaphore_info;
+    VkResult vr;
+    HRESULT hr;
+    int rc;
+
+    /* vkd3d_memory_allocator_init will memset the entire
+     * clear_queue struct to zero prior to calling this */
+    clear_queue->last_known_value = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT;
+    clear_queue->next_signal_value = VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT + 1;
+
+    if ((rc = pthread_mutex_init(&clear_queue->mutex, NULL)))
+        return hresult_from_errno(rc);
+
+    if ((rc = condvar_reltime_init(&clear_queue->cond)))
+    {
+        pthread_mutex_destroy(&clear_queue->mutex);
+        return hresult_from_errno(rc);
+    }
 
     command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     command_pool_info.pNext = NULL;
     command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    command_pool_info.queueFamilyIndex = device->queue_families[VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE]->vk_family_index;
+    command_pool_info.queueFamilyIndex = device->queue_families[VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER]->vk_family_index;
 
     if ((vr = VK_CALL(vkCreateCommandPool(device->vk_device, &command_pool_info,
             NULL, &clear_queue->vk_command_pool))) < 0)
@@ -937,6 +1442,14 @@ static HRESULT vkd3d_memory_allocator_init_clear_queue(struct vkd3d_memory_alloc
         goto fail;
     }
 
+    if (FAILED(hr = vkd3d_create_thread(device->vkd3d_instance,
+            vkd3d_memory_clear_queue_main, allocator, &clear_queue->thread)))
+    {
+        ERR("Failed to create clear thread, hr %#x.\n", hr);
+        goto fail;
+    }
+
+    clear_queue->thread_running = true;
     return S_OK;
 
 fail:
@@ -946,38 +1459,103 @@ fail:
 
 HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
+    size_t i, j;
     HRESULT hr;
     int rc;
 
     memset(allocator, 0, sizeof(*allocator));
+    allocator->cookie = vkd3d_allocate_cookie();
+    allocator->device = device;
 
-    if ((rc = pthread_mutex_init(&allocator->mutex, NULL)))
-        return hresult_from_errno(rc);
+    for (i = 0; i < ARRAY_SIZE(allocator->chunk_lists); i++)
+    {
+        if ((rc = pthread_mutex_init(&allocator->chunk_lists[i].mutex, NULL)))
+        {
+            hr = hresult_from_errno(rc);
+            goto fail_chunk_lists;
+        }
 
-    if (FAILED(hr = vkd3d_memory_allocator_init_clear_queue(allocator, device)))
+        allocator->chunk_lists[i].next_chunk_size = VKD3D_MEMORY_CHUNK_SIZE;
+    }
+
+    for (j = 0; j < ARRAY_SIZE(allocator->slab_lists); j++)
     {
-        pthread_mutex_destroy(&allocator->mutex);
-        return hr;
+        if ((rc = pthread_mutex_init(&allocator->slab_lists[j].mutex, NULL)))
+        {
+            hr = hresult_from_errno(rc);
+            goto fail_slab_lists;
+        }
+
+        list_init(&allocator->slab_lists[j].all_slabs);
     }
 
+    if (FAILED(hr = vkd3d_memory_allocator_init_clear_queue(allocator, device)))
+        goto fail_slab_lists;
+
     vkd3d_va_map_init(&allocator->va_map);
 
     allocator->vkd3d_queue = d3d12_device_allocate_vkd3d_queue(device,
-            device->queue_families[VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE]);
+            device->queue_families[VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER]);
+
+    pthread_mutex_lock(&vkd3d_memory_allocator_list_mutex);
+    list_add_tail(&vkd3d_memory_allocator_list, &allocator->entry);
+    pthread_mutex_unlock(&vkd3d_memory_allocator_list_mutex);
     return S_OK;
+
+fail_slab_lists:
+    while (j--)
+        pthread_mutex_destroy(&allocator->slab_lists[j].mutex);
+fail_chunk_lists:
+    while (i--)
+        pthread_mutex_destroy(&allocator->chunk_lists[i].mutex);
+    return hr;
 }
 
 void vkd3d_memory_allocator_cleanup(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
-    size_t i;
+    struct vkd3d_memory_slab_list *slab_list;
+    struct vkd3d_memory_slab *slab, *next;
+    struct vkd3d_memory_chunk_list *list;
+    size_t i, j;
+
+    /* The clear thread must not submit anything while chunks are being destroyed */
+    vkd3d_memory_allocator_stop_clear_thread(allocator, device);
+
+    /* Once removed, thread caches can no longer return ranges to this allocator */
+    pthread_mutex_lock(&vkd3d_memory_allocator_list_mutex);
+    list_remove(&allocator->entry);
+    pthread_mutex_unlock(&vkd3d_memory_allocator_list_mutex);
+
+    /* Slab memory is owned by chunks, so only the slabs themselves need freeing.
+     * Full slabs are not part of the free list, so walk the list of all slabs. */
+    for (i = 0; i < ARRAY_SIZE(allocator->slab_lists); i++)
+    {
+        slab_list = &allocator->slab_lists[i];
+
+        LIST_FOR_EACH_ENTRY_SAFE(slab, next, &slab_list->all_slabs, struct vkd3d_memory_slab, entry)
+            vkd3d_free(slab);
 
-    for (i = 0; i < allocator->chunks_count; i++)
-        vkd3d_memory_chunk_destroy(allocator->chunks[i], device, allocator);
+        vkd3d_free(slab_list->slabs);
+        pthread_mutex_destroy(&slab_list->mutex);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(allocator->chunk_lists); i++)
+    {
+        list = &allocator->chunk_lists[i];
+
+        for (j = 0; j < list->chunks_count; j++)
+            vkd3d_memory_chunk_destroy(list->chunks[j], device, allocator);
+
+        vkd3d_free(list->chunks);
+        pthread_mutex_destroy(&list->mutex);
+    }
+
+    /* Caches of other threads drop their entries on their next flush */
+    if (vkd3d_memory_thread_cache.allocator_cookie == allocator->cookie)
+        vkd3d_memory_thread_cache.count = 0;
 
-    vkd3d_free(allocator->chunks);
     vkd3d_va_map_cleanup(&allocator->va_map);
     vkd3d_memory_allocator_cleanup_clear_queue(allocator, device);
-    pthread_mutex_destroy(&allocator->mutex);
 }
 
 static bool vkd3d_memory_allocator_wait_clear_semaphore(struct vkd3d_memory_allocator *allocator,
@@ -1114,7 +1692,7 @@ static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_al
     submit_info.signalSemaphoreCount = 1;
     submit_info.pSignalSemaphores = &clear_queue->vk_semaphore;
 
-    vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, VK_NULL_HANDLE));
+    vr = vkd3d_queue_submit_locked(allocator->vkd3d_queue, device, vk_queue, 1, &submit_info, VK_NULL_HANDLE);
     vkd3d_queue_release(allocator->vkd3d_queue);
 
     if (vr < 0)
@@ -1160,23 +1738,160 @@ static HRESULT vkd3d_memory_allocator_flush_clears_locked(struct vkd3d_memory_al
     return S_OK;
 }
 
+void vkd3d_memory_allocator_get_stats(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, D3D12_VK_MEMORY_ALLOCATOR_STATS *stats)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_props = &device->memory_properties;
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    struct vkd3d_memory_info *memory_info = &device->memory_info;
+    const struct vkd3d_memory_block *block;
+    struct vkd3d_memory_chunk_list *list;
+    D3D12_VK_MEMORY_TYPE_STATS *type;
+    struct vkd3d_memory_chunk *chunk;
+    size_t i, j, k;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->version = D3D12_VK_MEMORY_ALLOCATOR_STATS_VERSION;
+    stats->memoryTypeCount = min(memory_props->memoryTypeCount, D3D12_VK_MAX_MEMORY_TYPES);
+
+    pthread_mutex_lock(&memory_info->budget_lock);
+    for (i = 0; i < stats->memoryTypeCount; i++)
+    {
+        type = &stats->memoryTypes[i];
+        type->heapIndex = memory_props->memoryTypes[i].heapIndex;
+        type->propertyFlags = memory_props->memoryTypes[i].propertyFlags;
+        type->allocatedBytes = memory_info->type_usage[i].allocated_bytes;
+        type->fallbackBytes = memory_info->type_usage[i].fallback_bytes;
+        type->deviceAllocationCount = memory_info->type_usage[i].allocation_count;
+    }
+    pthread_mutex_unlock(&memory_info->budget_lock);
+
+    for (i = 0; i < stats->memoryTypeCount; i++)
+    {
+        type = &stats->memoryTypes[i];
+        list = &allocator->chunk_lists[i];
+
+        pthread_mutex_lock(&list->mutex);
+        for (j = 0; j < list->chunks_count; j++)
+        {
+            chunk = list->chunks[j];
+            type->chunkCount++;
+            type->chunkBytes += chunk->allocation.resource.size;
+            type->suballocationCount += chunk->allocation_count;
+
+            for (k = 0; k < chunk->blocks_count; k++)
+            {
+                block = &chunk->blocks[k];
+
+                if (!block->is_free)
+                    continue;
+
+                type->chunkFreeBytes += block->length;
+                type->largestFreeBlock = max(type->largestFreeBlock, block->length);
+                type->freeBlockCount++;
+            }
+        }
+        pthread_mutex_unlock(&list->mutex);
+
+        /* Memory that is sitting unused inside chunks is allocated,
+         * but not used by any resource. */
+        type->usedBytes = type->allocatedBytes - min(type->allocatedBytes, type->chunkFreeBytes);
+    }
+
+    pthread_mutex_lock(&clear_queue->mutex);
+    stats->clearBytesPending = clear_queue->num_bytes_pending;
+    stats->clearAllocationsPending = clear_queue->allocations_count;
+    pthread_mutex_unlock(&clear_queue->mutex);
+}
+
+#define VKD3D_MEMORY_STATS_LOG_INTERVAL_NS (1000ull * 1000ull * 1000ull) /* 1 s */
+static pthread_once_t vkd3d_memory_stats_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t vkd3d_memory_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE *vkd3d_memory_stats_file;
+static UINT64 vkd3d_memory_stats_last_time_ns;
+
+static void vkd3d_memory_stats_init_once(void)
+{
+    const char *env;
+
+    env = getenv("VKD3D_MEMORY_STATS_LOG");
+    if (env)
+    {
+        INFO("Enabling VKD3D_MEMORY_STATS_LOG\n");
+        vkd3d_memory_stats_file = fopen(env, "a");
+        if (!vkd3d_memory_stats_file)
+            ERR("Failed to open file: %s.\n", env);
+    }
+}
+
+static void vkd3d_memory_allocator_log_stats(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
+{
+    D3D12_VK_MEMORY_ALLOCATOR_STATS stats;
+    const D3D12_VK_MEMORY_TYPE_STATS *type;
+    uint64_t last_time, now;
+    unsigned int i;
+
+    pthread_once(&vkd3d_memory_stats_once, vkd3d_memory_stats_init_once);
+    if (!vkd3d_memory_stats_file)
+        return;
+
+    /* Only one thread gets to log per interval, losers just skip. */
+    now = vkd3d_profiling_get_tick_count();
+    last_time = vkd3d_atomic_uint64_load_explicit(&vkd3d_memory_stats_last_time_ns, vkd3d_memory_order_relaxed);
+    if (now - last_time < VKD3D_MEMORY_STATS_LOG_INTERVAL_NS)
+        return;
+    if (vkd3d_atomic_uint64_compare_exchange(&vkd3d_memory_stats_last_time_ns, last_time, now,
+            vkd3d_memory_order_relaxed, vkd3d_memory_order_relaxed) != last_time)
+        return;
+
+    vkd3d_memory_allocator_get_stats(allocator, device, &stats);
+
+    pthread_mutex_lock(&vkd3d_memory_stats_lock);
+    fprintf(vkd3d_memory_stats_file, "{\"device\":\"%p\",\"time_ns\":%"PRIu64
+            ",\"clear_bytes_pending\":%"PRIu64",\"clear_allocations_pending\":%u,\"types\":[",
+            (void *)device, now, stats.clearBytesPending, stats.clearAllocationsPending);
+
+    for (i = 0; i < stats.memoryTypeCount; i++)
+    {
+        type = &stats.memoryTypes[i];
+        fprintf(vkd3d_memory_stats_file, "%s{\"type\":%u,\"heap\":%u,\"flags\":%u,"
+                "\"allocated\":%"PRIu64",\"used\":%"PRIu64",\"fallback\":%"PRIu64",\"device_allocations\":%u,"
+                "\"chunks\":%u,\"chunk_bytes\":%"PRIu64",\"chunk_free\":%"PRIu64",\"largest_free\":%"PRIu64","
+                "\"free_blocks\":%u,\"suballocations\":%u}",
+                i ? "," : "", i, type->heapIndex, type->propertyFlags,
+                type->allocatedBytes, type->usedBytes, type->fallbackBytes, type->deviceAllocationCount,
+                type->chunkCount, type->chunkBytes, type->chunkFreeBytes, type->largestFreeBlock,
+                type->freeBlockCount, type->suballocationCount);
+    }
+
+    fprintf(vkd3d_memory_stats_file, "]}\n");
+    fflush(vkd3d_memory_stats_file);
+    pthread_mutex_unlock(&vkd3d_memory_stats_lock);
+}
+
 HRESULT vkd3d_memory_allocator_flush_clears(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device)
 {
     struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    VKD3D_REGION_DECL(flush_clears);
     HRESULT hr;
 
     pthread_mutex_lock(&clear_queue->mutex);
+    VKD3D_REGION_BEGIN_DETAIL(flush_clears);
     hr = vkd3d_memory_allocator_flush_clears_locked(allocator, device);
+    VKD3D_REGION_END_DETAIL(flush_clears);
     pthread_mutex_unlock(&clear_queue->mutex);
+
+    vkd3d_memory_allocator_log_stats(allocator, device);
     return hr;
 }
 
-#define VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES (256ull << 20) /* 256 MiB */
 
 static void vkd3d_memory_allocator_clear_allocation(struct vkd3d_memory_allocator *allocator,
         struct d3d12_device *device, struct vkd3d_memory_allocation *allocation)
 {
     struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    VKD3D_REGION_DECL(flush_clears_early);
+    uint64_t now;
 
     if (allocation->cpu_address)
     {
@@ -1198,77 +1913,127 @@ static void vkd3d_memory_allocator_clear_allocation(struct vkd3d_memory_allocato
 
         allocation->clear_semaphore_value = clear_queue->next_signal_value;
 
-        if (allocation->chunk)
-            allocation->chunk->allocation.clear_semaphore_value = clear_queue->next_signal_value;
+        now = vkd3d_profiling_get_tick_count();
+
+        /* Let the clear thread know about the new deadline */
+        if (!clear_queue->allocations_count)
+        {
+            clear_queue->first_pending_time_ns = now;
+            condvar_reltime_signal(&clear_queue->cond);
+        }
 
         clear_queue->allocations[clear_queue->allocations_count++] = allocation;
         clear_queue->num_bytes_pending += allocation->resource.size;
 
-        if (clear_queue->num_bytes_pending >= VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES)
+        if (clear_queue->num_bytes_pending >= VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_BYTES ||
+                now - clear_queue->first_pending_time_ns >= VKD3D_MEMORY_CLEAR_QUEUE_MAX_PENDING_TIME_NS)
+        {
+            VKD3D_REGION_BEGIN_DETAIL(flush_clears_early);
             vkd3d_memory_allocator_flush_clears_locked(allocator, device);
+            VKD3D_REGION_END_DETAIL(flush_clears_early);
+        }
 
         pthread_mutex_unlock(&clear_queue->mutex);
     }
 }
 
-static void vkd3d_memory_allocator_wait_allocation(struct vkd3d_memory_allocator *allocator,
-        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+static bool vkd3d_memory_clear_queue_remove_locked(struct vkd3d_memory_clear_queue *clear_queue,
+        const struct vkd3d_memory_allocation *allocation)
 {
-    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
-    uint64_t wait_value = allocation->clear_semaphore_value;
     size_t i;
 
-    /* If the clear semaphore has been signaled to the expected value,
-     * the GPU is already done clearing the allocation, and it cannot
-     * be in the clear queue either, so there is nothing to do. */
-    if (vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, wait_value, 0))
-        return;
-
-    /* If the allocation is still in the queue, the GPU has not started
-     * using it yet so we can remove it from the queue and exit. */
-    pthread_mutex_lock(&clear_queue->mutex);
-
     for (i = 0; i < clear_queue->allocations_count; i++)
     {
         if (clear_queue->allocations[i] == allocation)
         {
             clear_queue->allocations[i] = clear_queue->allocations[--clear_queue->allocations_count];
             clear_queue->num_bytes_pending -= allocation->resource.size;
-            pthread_mutex_unlock(&clear_queue->mutex);
-            return;
+            return true;
         }
     }
 
-    /* If this is a chunk and a suballocation from it had been immediately
-     * freed, it is possible that the suballocation got removed from the
-     * clear queue so that the chunk's wait value never gets signaled. Wait
-     * for the last signaled value in that case. */
-    if (wait_value == clear_queue->next_signal_value)
-        wait_value = clear_queue->next_signal_value - 1;
+    return false;
+}
 
+bool vkd3d_memory_allocator_cancel_clear(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+    bool cancelled;
+
+    pthread_mutex_lock(&clear_queue->mutex);
+    cancelled = vkd3d_memory_clear_queue_remove_locked(clear_queue, allocation);
     pthread_mutex_unlock(&clear_queue->mutex);
 
-    /* If this allocation was suballocated from a chunk, we will wait
-     * on the semaphore when the parent chunk itself gets destroyed. */
-    if (allocation->chunk)
+    if (cancelled)
+        TRACE("Cancelled pending clear of allocation %p.\n", allocation);
+
+    return cancelled;
+}
+
+static void vkd3d_memory_allocator_detach_clear(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_clear_queue *clear_queue = &allocator->clear_queue;
+
+    /* If the clear semaphore has been signaled to the expected value,
+     * the GPU is already done clearing the allocation, and it cannot
+     * be in the clear queue either, so there is nothing to do. */
+    if (vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, allocation->clear_semaphore_value, 0))
         return;
 
-    /* Otherwise, we actually have to wait for the GPU. */
-    WARN("Waiting for GPU to clear allocation %p.\n", allocation);
+    /* Pending clears refer to the allocation by address, so remove it from the queue.
+     * There is no need to wait for clears which were already submitted: their submission
+     * advances the clear queue's submission timeline, and the memory is only freed through
+     * deferred destruction. Only the first GPU use of an allocation waits for its clear,
+     * through the semaphore wait added to every queue in flush_clears. */
+    pthread_mutex_lock(&clear_queue->mutex);
+    vkd3d_memory_clear_queue_remove_locked(clear_queue, allocation);
+    pthread_mutex_unlock(&clear_queue->mutex);
+}
+
+static VkDeviceSize vkd3d_memory_allocator_get_max_chunk_size(struct d3d12_device *device, uint32_t type_index)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_props = &device->memory_properties;
+    const struct vkd3d_memory_info *memory_info = &device->memory_info;
+    VkDeviceSize max_size;
+
+    /* Keep individual chunks small relative to the heap so that a single mostly
+     * empty chunk cannot waste a significant portion of memory on small devices. */
+    max_size = memory_props->memoryHeaps[memory_props->memoryTypes[type_index].heapIndex].size / 32;
+
+    if (memory_info->budget_sensitive_mask & (1u << type_index))
+        max_size = min(max_size, memory_info->type_budget[type_index] / 8);
 
-    vkd3d_memory_allocator_wait_clear_semaphore(allocator, device, wait_value, UINT64_MAX);
+    return max(VKD3D_MEMORY_CHUNK_MIN_SIZE, min(max_size, VKD3D_MEMORY_CHUNK_MAX_SIZE));
 }
 
 static HRESULT vkd3d_memory_allocator_try_add_chunk(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags, uint32_t type_mask,
-        VkMemoryPropertyFlags optional_properties, struct vkd3d_memory_chunk **chunk)
+        const VkMemoryRequirements *memory_requirements, uint32_t type_mask, VkMemoryPropertyFlags optional_properties,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        struct vkd3d_memory_allocation *allocation)
 {
+    VkDeviceSize chunk_size, requested_size, max_size;
     struct vkd3d_allocate_memory_info alloc_info;
+    struct vkd3d_memory_chunk_list *list;
     struct vkd3d_memory_chunk *object;
+    uint32_t type_index;
     HRESULT hr;
 
+    if (!type_mask)
+        return E_OUTOFMEMORY;
+
+    /* Memory types are tried in order, so the lowest one
+     * is where the chunk will most likely end up. */
+    type_index = vkd3d_bitmask_tzcnt32(type_mask);
+    max_size = vkd3d_memory_allocator_get_max_chunk_size(device, type_index);
+
+    list = &allocator->chunk_lists[type_index];
+    pthread_mutex_lock(&list->mutex);
+    requested_size = min(list->next_chunk_size, max_size);
+    pthread_mutex_unlock(&list->mutex);
+
     memset(&alloc_info, 0, sizeof(alloc_info));
-    alloc_info.memory_requirements.size = VKD3D_MEMORY_CHUNK_SIZE;
     alloc_info.memory_requirements.alignment = 0;
     alloc_info.memory_requirements.memoryTypeBits = type_mask;
     alloc_info.heap_properties = *heap_properties;
@@ -1279,18 +2044,53 @@ static HRESULT vkd3d_memory_allocator_try_add_chunk(struct vkd3d_memory_allocato
     if (!(heap_flags & D3D12_HEAP_FLAG_DENY_BUFFERS))
         alloc_info.flags |= VKD3D_ALLOCATION_FLAG_GLOBAL_BUFFER;
 
-    if (!vkd3d_array_reserve((void**)&allocator->chunks, &allocator->chunks_size,
-            allocator->chunks_count + 1, sizeof(*allocator->chunks)))
+    /* Allocate the chunk without holding any lock, the memory type is only
+     * known once this succeeded. Suballocations are always smaller than
+     * VKD3D_VA_BLOCK_SIZE, so they fit into a chunk of any size. If the
+     * driver or budget rejects a large chunk, retry with smaller ones. */
+    for (chunk_size = requested_size; ; chunk_size = max(chunk_size / 2, VKD3D_MEMORY_CHUNK_MIN_SIZE))
+    {
+        alloc_info.memory_requirements.size = chunk_size;
+
+        if (SUCCEEDED(hr = vkd3d_memory_chunk_create(device, allocator, &alloc_info, &object)))
+            break;
+
+        if (chunk_size <= VKD3D_MEMORY_CHUNK_MIN_SIZE)
+            return hr;
+    }
+
+    type_index = object->allocation.device_allocation.vk_memory_type;
+    list = &allocator->chunk_lists[type_index];
+    pthread_mutex_lock(&list->mutex);
+
+    /* Grow geometrically so that streaming workloads need few device
+     * allocations, unless we just had to settle for a smaller chunk. */
+    if (chunk_size < requested_size)
+        list->next_chunk_size = chunk_size;
+    else
+        list->next_chunk_size = min(chunk_size * 2, vkd3d_memory_allocator_get_max_chunk_size(device, type_index));
+
+    if (!vkd3d_array_reserve((void**)&list->chunks, &list->chunks_size,
+            list->chunks_count + 1, sizeof(*list->chunks)))
     {
         ERR("Failed to allocate space for new chunk.\n");
+        pthread_mutex_unlock(&list->mutex);
+        vkd3d_memory_chunk_destroy(object, device, allocator);
         return E_OUTOFMEMORY;
     }
 
-    if (FAILED(hr = vkd3d_memory_chunk_create(device, allocator, &alloc_info, &object)))
-        return hr;
+    object->list_index = list->chunks_count;
+    list->chunks[list->chunks_count++] = object;
 
-    allocator->chunks[allocator->chunks_count++] = *chunk = object;
-    return S_OK;
+    /* Suballocate before releasing the lock so that a concurrent
+     * free cannot observe the new chunk as unused. */
+    hr = vkd3d_memory_chunk_allocate_range(object, memory_requirements, allocation);
+
+    if (FAILED(hr))
+        vkd3d_memory_allocator_remove_chunk(allocator, device, object);
+
+    pthread_mutex_unlock(&list->mutex);
+    return hr;
 }
 
 static HRESULT vkd3d_memory_allocator_try_suballocate_memory(struct vkd3d_memory_allocator *allocator,
@@ -1299,97 +2099,375 @@ static HRESULT vkd3d_memory_allocator_try_suballocate_memory(struct vkd3d_memory
         const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
         struct vkd3d_memory_allocation *allocation)
 {
-    const D3D12_HEAP_FLAGS heap_flag_mask = ~(D3D12_HEAP_FLAG_CREATE_NOT_ZEROED | D3D12_HEAP_FLAG_CREATE_NOT_RESIDENT);
+    struct vkd3d_memory_chunk_list *list;
     struct vkd3d_memory_chunk *chunk;
+    uint32_t iter_mask;
     HRESULT hr;
     size_t i;
 
     type_mask &= device->memory_info.global_mask;
     type_mask &= memory_requirements->memoryTypeBits;
+    heap_flags &= vkd3d_memory_chunk_heap_flag_mask;
+    iter_mask = type_mask;
 
-    for (i = 0; i < allocator->chunks_count; i++)
+    /* Only look at chunks of supported memory types */
+    while (iter_mask)
     {
-        chunk = allocator->chunks[i];
+        list = &allocator->chunk_lists[vkd3d_bitmask_iter32(&iter_mask)];
+        hr = E_OUTOFMEMORY;
 
-        /* Match flags since otherwise the backing buffer
-         * may not support our required usage flags */
-        if (chunk->allocation.heap_type != heap_properties->Type ||
-                chunk->allocation.heap_flags != (heap_flags & heap_flag_mask))
-            continue;
+        pthread_mutex_lock(&list->mutex);
 
-        /* Filter out unsupported memory types */
-        if (!(type_mask & (1u << chunk->allocation.device_allocation.vk_memory_type)))
-            continue;
+        for (i = 0; i < list->chunks_count; i++)
+        {
+            chunk = list->chunks[i];
+
+            /* Match flags since otherwise the backing buffer
+             * may not support our required usage flags */
+            if (chunk->allocation.heap_type != heap_properties->Type ||
+                    chunk->allocation.heap_flags != heap_flags)
+                continue;
+
+            if (SUCCEEDED(hr = vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation)))
+                break;
+        }
 
-        if (SUCCEEDED(hr = vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation)))
+        pthread_mutex_unlock(&list->mutex);
+
+        if (SUCCEEDED(hr))
             return hr;
     }
 
     /* Try allocating a new chunk on one of the supported memory type
      * before the caller falls back to potentially slower memory */
-    if (FAILED(hr = vkd3d_memory_allocator_try_add_chunk(allocator, device, heap_properties,
-            heap_flags & heap_flag_mask, type_mask, optional_properties, &chunk)))
-        return hr;
+    return vkd3d_memory_allocator_try_add_chunk(allocator, device, memory_requirements,
+            type_mask, optional_properties, heap_properties, heap_flags, allocation);
+}
+
+static void vkd3d_memory_allocator_free_suballocation(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_chunk *chunk = allocation->chunk;
+    struct vkd3d_memory_chunk_list *list;
 
-    return vkd3d_memory_chunk_allocate_range(chunk, memory_requirements, allocation);
+    list = &allocator->chunk_lists[chunk->allocation.device_allocation.vk_memory_type];
+
+    pthread_mutex_lock(&list->mutex);
+    vkd3d_memory_chunk_free_range(chunk, allocation);
+
+    if (vkd3d_memory_chunk_is_free(chunk))
+    {
+        vkd3d_memory_allocator_remove_chunk(allocator, device, chunk);
+        list->next_chunk_size = max(list->next_chunk_size / 2, VKD3D_MEMORY_CHUNK_MIN_SIZE);
+    }
+    pthread_mutex_unlock(&list->mutex);
 }
 
-void vkd3d_free_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
-        const struct vkd3d_memory_allocation *allocation)
+static bool vkd3d_memory_allocator_cache_free(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
 {
-    if (allocation->device_allocation.vk_memory == VK_NULL_HANDLE)
-        return;
+    struct vkd3d_memory_thread_cache *cache = &vkd3d_memory_thread_cache;
 
-    if (allocation->clear_semaphore_value)
-        vkd3d_memory_allocator_wait_allocation(allocator, device, allocation);
+    if (allocation->resource.size > VKD3D_MEMORY_THREAD_CACHE_MAX_ALLOCATION_SIZE)
+        return false;
 
-    if (allocation->chunk)
+    /* Return entries of a different allocator before switching over */
+    if (cache->allocator_cookie != allocator->cookie)
     {
-        pthread_mutex_lock(&allocator->mutex);
-        vkd3d_memory_chunk_free_range(allocation->chunk, allocation);
+        vkd3d_memory_thread_cache_flush(cache);
+        cache->allocator_cookie = allocator->cookie;
+    }
 
-        if (vkd3d_memory_chunk_is_free(allocation->chunk))
-            vkd3d_memory_allocator_remove_chunk(allocator, device, allocation->chunk);
-        pthread_mutex_unlock(&allocator->mutex);
+    /* Return the oldest entry to its chunk to make room */
+    if (cache->count == ARRAY_SIZE(cache->allocations))
+    {
+        vkd3d_memory_allocator_free_suballocation(allocator, device, &cache->allocations[0]);
+        memmove(&cache->allocations[0], &cache->allocations[1],
+                sizeof(*cache->allocations) * --cache->count);
     }
-    else
-        vkd3d_memory_allocation_free(allocation, device, allocator);
+
+    cache->allocations[cache->count] = *allocation;
+    cache->allocations[cache->count].clear_semaphore_value = 0;
+    cache->count++;
+    return true;
 }
 
-static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
-        const struct vkd3d_allocate_memory_info *info, struct vkd3d_memory_allocation *allocation)
+static bool vkd3d_memory_allocator_cache_allocate(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const VkMemoryRequirements *memory_requirements, uint32_t type_mask,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_thread_cache *cache = &vkd3d_memory_thread_cache;
+    const struct vkd3d_memory_allocation *entry;
+    uint32_t i;
+
+    if (cache->allocator_cookie != allocator->cookie)
+        return false;
+
+    type_mask &= device->memory_info.global_mask;
+    type_mask &= memory_requirements->memoryTypeBits;
+    heap_flags &= vkd3d_memory_chunk_heap_flag_mask;
+
+    /* Prefer the most recently freed range */
+    for (i = cache->count; i--; )
+    {
+        entry = &cache->allocations[i];
+
+        if (entry->resource.size != memory_requirements->size ||
+                entry->heap_type != heap_properties->Type ||
+                entry->heap_flags != heap_flags ||
+                !(type_mask & (1u << entry->device_allocation.vk_memory_type)))
+            continue;
+
+        if (memory_requirements->alignment && (entry->offset & (memory_requirements->alignment - 1)))
+            continue;
+
+        *allocation = *entry;
+        memmove(&cache->allocations[i], &cache->allocations[i + 1],
+                sizeof(*cache->allocations) * (--cache->count - i));
+        return true;
+    }
+
+    return false;
+}
+
+static HRESULT vkd3d_memory_allocator_suballocate_range(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const VkMemoryRequirements *memory_requirements,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        struct vkd3d_memory_allocation *allocation)
 {
     const VkMemoryPropertyFlags optional_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-    VkMemoryRequirements memory_requirements = info->memory_requirements;
     uint32_t required_mask, optional_mask;
     VkMemoryPropertyFlags type_flags;
     HRESULT hr;
-    
-    if (FAILED(hr = vkd3d_select_memory_flags(device, &info->heap_properties, &type_flags)))
+
+    if (FAILED(hr = vkd3d_select_memory_flags(device, heap_properties, &type_flags)))
         return hr;
 
     /* Prefer device-local memory if allowed for this allocation */
     required_mask = vkd3d_find_memory_types_with_flags(device, type_flags & ~optional_flags);
     optional_mask = vkd3d_find_memory_types_with_flags(device, type_flags);
 
-    pthread_mutex_lock(&allocator->mutex);
+    if (vkd3d_memory_allocator_cache_allocate(allocator, device, memory_requirements,
+            optional_mask, heap_properties, heap_flags, allocation))
+        return S_OK;
 
     hr = vkd3d_memory_allocator_try_suballocate_memory(allocator, device,
-            &memory_requirements, optional_mask, 0, &info->heap_properties,
-            info->heap_flags, allocation);
+            memory_requirements, optional_mask, 0, heap_properties,
+            heap_flags, allocation);
+
+    /* Cached ranges may be what keeps the allocation from fitting */
+    if (FAILED(hr) && vkd3d_memory_thread_cache.count &&
+            vkd3d_memory_thread_cache.allocator_cookie == allocator->cookie)
+    {
+        vkd3d_memory_thread_cache_flush(&vkd3d_memory_thread_cache);
+
+        hr = vkd3d_memory_allocator_try_suballocate_memory(allocator, device,
+                memory_requirements, optional_mask, 0, heap_properties,
+                heap_flags, allocation);
+    }
 
     if (FAILED(hr) && (required_mask & ~optional_mask))
     {
         hr = vkd3d_memory_allocator_try_suballocate_memory(allocator, device,
-                &memory_requirements, required_mask & ~optional_mask,
-                optional_flags,
-                &info->heap_properties, info->heap_flags, allocation);
+                memory_requirements, required_mask & ~optional_mask,
+                optional_flags, heap_properties, heap_flags, allocation);
+    }
+
+    return hr;
+}
+
+static bool vkd3d_memory_slab_get_class(const VkMemoryRequirements *memory_requirements, uint32_t *size_class)
+{
+    VkDeviceSize slot_size = max(memory_requirements->size, memory_requirements->alignment);
+
+    if (slot_size > VKD3D_MEMORY_SLAB_MAX_SLOT_SIZE)
+        return false;
+
+    if (slot_size <= (1u << VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS))
+        *size_class = 0;
+    else
+        *size_class = vkd3d_log2i((uint32_t)slot_size - 1) + 1 - VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS;
+
+    return true;
+}
+
+static void vkd3d_memory_slab_list_remove(struct vkd3d_memory_slab_list *list, struct vkd3d_memory_slab *slab)
+{
+    list->slabs[slab->list_index] = list->slabs[--list->slabs_count];
+    list->slabs[slab->list_index]->list_index = slab->list_index;
+}
+
+static bool vkd3d_memory_slab_list_add(struct vkd3d_memory_slab_list *list, struct vkd3d_memory_slab *slab)
+{
+    if (!vkd3d_array_reserve((void**)&list->slabs, &list->slabs_size,
+            list->slabs_count + 1, sizeof(*list->slabs)))
+        return false;
+
+    slab->list_index = list->slabs_count;
+    list->slabs[list->slabs_count++] = slab;
+    return true;
+}
+
+static void vkd3d_memory_slab_allocate_slot(struct vkd3d_memory_slab_list *list, struct vkd3d_memory_slab *slab,
+        VkDeviceSize size, struct vkd3d_memory_allocation *allocation)
+{
+    uint32_t word = 0, slot;
+
+    while (!slab->free_mask[word])
+        word++;
+
+    slot = word * 64 + vkd3d_bitmask_tzcnt64(slab->free_mask[word]);
+    slab->free_mask[word] &= ~(1ull << (slot & 63));
+
+    /* Full slabs leave the list until a slot is freed again */
+    if (!--slab->free_count)
+        vkd3d_memory_slab_list_remove(list, slab);
+
+    vkd3d_memory_allocation_slice(allocation, &slab->allocation,
+            (VkDeviceSize)slot << slab->slot_size_bits, size);
+    allocation->slab = slab;
+}
+
+static HRESULT vkd3d_memory_allocator_slab_allocate(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, uint32_t size_class, const VkMemoryRequirements *memory_requirements,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_slab_list *list = &allocator->slab_lists[size_class];
+    VkMemoryRequirements slab_requirements;
+    struct vkd3d_memory_slab *slab;
+    uint32_t type_mask, i;
+    HRESULT hr;
+
+    type_mask = memory_requirements->memoryTypeBits & device->memory_info.global_mask;
+    heap_flags &= vkd3d_memory_chunk_heap_flag_mask;
+
+    pthread_mutex_lock(&list->mutex);
+
+    /* Recently created slabs are at the end of the list */
+    for (i = list->slabs_count; i--; )
+    {
+        slab = list->slabs[i];
+
+        if (slab->allocation.heap_type != heap_properties->Type ||
+                slab->allocation.heap_flags != heap_flags ||
+                !(type_mask & (1u << slab->allocation.device_allocation.vk_memory_type)))
+            continue;
+
+        vkd3d_memory_slab_allocate_slot(list, slab, memory_requirements->size, allocation);
+        pthread_mutex_unlock(&list->mutex);
+        return S_OK;
+    }
+
+    if (!(slab = vkd3d_malloc(sizeof(*slab))))
+    {
+        pthread_mutex_unlock(&list->mutex);
+        return E_OUTOFMEMORY;
     }
 
-    pthread_mutex_unlock(&allocator->mutex);
+    memset(slab, 0, sizeof(*slab));
+    slab->slot_size_bits = VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS + size_class;
+    slab->slot_count = VKD3D_MEMORY_SLAB_SIZE >> slab->slot_size_bits;
+    slab->free_count = slab->slot_count;
+
+    for (i = 0; i < slab->slot_count; i += 64)
+        slab->free_mask[i / 64] = slab->slot_count - i >= 64 ? ~0ull : (1ull << (slab->slot_count - i)) - 1;
+
+    slab_requirements.size = VKD3D_MEMORY_SLAB_SIZE;
+    slab_requirements.alignment = VKD3D_MEMORY_SLAB_MAX_SLOT_SIZE;
+    slab_requirements.memoryTypeBits = memory_requirements->memoryTypeBits;
+
+    if (FAILED(hr = vkd3d_memory_allocator_suballocate_range(allocator, device,
+            &slab_requirements, heap_properties, heap_flags, &slab->allocation)))
+        goto fail;
+
+    if (!vkd3d_memory_slab_list_add(list, slab))
+    {
+        ERR("Failed to allocate space for new slab.\n");
+        vkd3d_memory_allocator_free_suballocation(allocator, device, &slab->allocation);
+        hr = E_OUTOFMEMORY;
+        goto fail;
+    }
+
+    list_add_tail(&list->all_slabs, &slab->entry);
+    vkd3d_memory_slab_allocate_slot(list, slab, memory_requirements->size, allocation);
+    pthread_mutex_unlock(&list->mutex);
+    return S_OK;
+
+fail:
+    pthread_mutex_unlock(&list->mutex);
+    vkd3d_free(slab);
     return hr;
 }
 
+static void vkd3d_memory_allocator_slab_free(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_slab *slab = allocation->slab;
+    struct vkd3d_memory_slab_list *list;
+    uint32_t slot;
+
+    list = &allocator->slab_lists[slab->slot_size_bits - VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS];
+    slot = (allocation->offset - slab->allocation.offset) >> slab->slot_size_bits;
+
+    pthread_mutex_lock(&list->mutex);
+
+    slab->free_mask[slot / 64] |= 1ull << (slot & 63);
+
+    if (!slab->free_count++ && !vkd3d_memory_slab_list_add(list, slab))
+    {
+        /* The slab simply stays out of the list */
+        ERR("Failed to return slab to free list.\n");
+    }
+    else if (slab->free_count == slab->slot_count && list->slabs_count > 1)
+    {
+        /* Keep the last slab of a class around to avoid thrashing */
+        vkd3d_memory_slab_list_remove(list, slab);
+        list_remove(&slab->entry);
+        vkd3d_memory_allocator_free_suballocation(allocator, device, &slab->allocation);
+        vkd3d_free(slab);
+    }
+
+    pthread_mutex_unlock(&list->mutex);
+}
+
+void vkd3d_free_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    if (allocation->device_allocation.vk_memory == VK_NULL_HANDLE)
+        return;
+
+    if (allocation->clear_semaphore_value)
+        vkd3d_memory_allocator_detach_clear(allocator, device, allocation);
+
+    if (allocation->slab)
+        vkd3d_memory_allocator_slab_free(allocator, device, allocation);
+    else if (allocation->chunk)
+    {
+        if (!vkd3d_memory_allocator_cache_free(allocator, device, allocation))
+            vkd3d_memory_allocator_free_suballocation(allocator, device, allocation);
+    }
+    else
+        vkd3d_memory_allocation_free(allocation, device, allocator);
+}
+
+static HRESULT vkd3d_suballocate_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_allocate_memory_info *info, struct vkd3d_memory_allocation *allocation)
+{
+    uint32_t size_class;
+
+    if (vkd3d_memory_slab_get_class(&info->memory_requirements, &size_class))
+    {
+        if (SUCCEEDED(vkd3d_memory_allocator_slab_allocate(allocator, device, size_class,
+                &info->memory_requirements, &info->heap_properties, info->heap_flags, allocation)))
+            return S_OK;
+    }
+
+    return vkd3d_memory_allocator_suballocate_range(allocator, device,
+            &info->memory_requirements, &info->heap_properties, info->heap_flags, allocation);
+}
+
 HRESULT vkd3d_allocate_memory(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
         const struct vkd3d_allocate_memory_info *info, struct vkd3d_memory_allocation *allocation)
 {
@@ -1404,13 +2482,78 @@ HRESULT vkd3d_allocate_memory(struct d3d12_device *device, struct vkd3d_memory_a
     if (FAILED(hr))
         return hr;
 
+    /* Write watch memory is freshly mapped and therefore zeroed already,
+     * and clearing it on the CPU would report every page as written. */
     if (!(info->heap_flags & D3D12_HEAP_FLAG_CREATE_NOT_ZEROED) &&
+            !(allocation->flags & VKD3D_ALLOCATION_FLAG_ALLOW_WRITE_WATCH) &&
             !(vkd3d_config_flags & VKD3D_CONFIG_FLAG_MEMORY_ALLOCATOR_SKIP_CLEAR))
         vkd3d_memory_allocator_clear_allocation(allocator, device, allocation);
 
     return hr;
 }
 
+void vkd3d_memory_allocation_move(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
+        struct vkd3d_memory_allocation *dst, struct vkd3d_memory_allocation *src)
+{
+    /* Both the clear queue and the VA map refer to the allocation by address. */
+    if (src->clear_semaphore_value)
+        vkd3d_memory_allocator_detach_clear(allocator, device, src);
+
+    *dst = *src;
+    dst->clear_semaphore_value = 0;
+
+    if ((src->flags & VKD3D_ALLOCATION_FLAG_GPU_ADDRESS) && src->resource.va)
+    {
+        vkd3d_va_map_remove(&allocator->va_map, &src->resource);
+        vkd3d_va_map_insert(&allocator->va_map, &dst->resource);
+    }
+
+    memset(src, 0, sizeof(*src));
+}
+
+HRESULT vkd3d_memory_allocation_init_recycled(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
+        struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_allocate_memory_info info;
+    HRESULT hr;
+
+    /* A recycled allocation must not be mistaken for its previous owner,
+     * so give it a new identity the same way vkd3d_memory_allocation_init() does. */
+    vkd3d_descriptor_debug_unregister_cookie(device->descriptor_qa_global_info, allocation->resource.cookie);
+
+    if (allocation->resource.view_map)
+    {
+        vkd3d_view_map_destroy(allocation->resource.view_map, device);
+        vkd3d_free(allocation->resource.view_map);
+        allocation->resource.view_map = NULL;
+    }
+
+    allocation->resource.cookie = vkd3d_allocate_cookie();
+
+    memset(&info, 0, sizeof(info));
+    info.memory_requirements.size = allocation->device_allocation.size;
+    vkd3d_descriptor_debug_register_allocation_cookie(device->descriptor_qa_global_info,
+            allocation->resource.cookie, &info);
+
+    /* Buffer device addresses are a property of the VkBuffer and stay the same. */
+    if ((allocation->flags & VKD3D_ALLOCATION_FLAG_GPU_ADDRESS) && allocation->resource.va &&
+            !device->device_info.buffer_device_address_features.bufferDeviceAddress)
+    {
+        vkd3d_va_map_remove(&allocator->va_map, &allocation->resource);
+        vkd3d_va_map_free_fake_va(&allocator->va_map, allocation->resource.va, allocation->resource.size);
+
+        if (FAILED(hr = vkd3d_allocation_assign_gpu_address(allocation, device, allocator)))
+            return hr;
+    }
+
+    /* Same rules as for a fresh allocation, see vkd3d_allocate_memory(). */
+    if (!(allocation->heap_flags & D3D12_HEAP_FLAG_CREATE_NOT_ZEROED) &&
+            !(vkd3d_config_flags & VKD3D_CONFIG_FLAG_MEMORY_ALLOCATOR_SKIP_CLEAR))
+        vkd3d_memory_allocator_clear_allocation(allocator, device, allocation);
+
+    return S_OK;
+}
+
 static bool vkd3d_heap_allocation_accept_deferred_resource_placements(struct d3d12_device *device,
         const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags)
 {
@@ -1464,6 +2607,13 @@ HRESULT vkd3d_allocate_heap_memory(struct d3d12_device *device, struct vkd3d_mem
 HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
         VkMemoryPropertyFlags type_flags,
         struct vkd3d_device_memory_allocation *allocation)
+{
+    return vkd3d_allocate_buffer_memory_masked(device, vk_buffer, type_flags, UINT32_MAX, allocation);
+}
+
+HRESULT vkd3d_allocate_buffer_memory_masked(struct d3d12_device *device, VkBuffer vk_buffer,
+        VkMemoryPropertyFlags type_flags, uint32_t type_mask,
+        struct vkd3d_device_memory_allocation *allocation)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkMemoryRequirements memory_requirements;
@@ -1482,7 +2632,7 @@ HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_bu
     VK_CALL(vkGetBufferMemoryRequirements(device->vk_device, vk_buffer, &memory_requirements));
 
     if (FAILED(hr = vkd3d_allocate_device_memory(device, memory_requirements.size,
-            type_flags, memory_requirements.memoryTypeBits, &flags_info, allocation)))
+            type_flags, memory_requirements.memoryTypeBits & type_mask, &flags_info, allocation)))
         return hr;
 
     bind_info.sType = VK_STRUCTURE_TYPE_BIND_BUFFER_MEMORY_INFO;
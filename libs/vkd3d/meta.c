@@ -131,12 +131,74 @@ static VkResult vkd3d_meta_create_compute_pipeline(struct d3d12_device *device,
     vkd3d_meta_make_shader_stage(&pipeline_info.stage,
             VK_SHADER_STAGE_COMPUTE_BIT, module, "main", specialization_info);
 
-    vr = VK_CALL(vkCreateComputePipelines(device->vk_device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, pipeline));
+    vr = VK_CALL(vkCreateComputePipelines(device->vk_device, device->meta_ops.common.vk_pipeline_cache,
+            1, &pipeline_info, NULL, pipeline));
     VK_CALL(vkDestroyShaderModule(device->vk_device, module, NULL));
 
     return vr;
 }
 
+struct vkd3d_meta_spirv_code
+{
+    const uint32_t *code;
+    size_t code_size;
+};
+
+static VkPipeline vkd3d_meta_load_pipeline(VkPipeline *vk_pipeline)
+{
+    VkPipeline pipeline;
+    uint64_t value;
+
+    STATIC_ASSERT(sizeof(VkPipeline) == sizeof(uint64_t));
+    value = vkd3d_atomic_uint64_load_explicit((uint64_t *)vk_pipeline, vkd3d_memory_order_acquire);
+    memcpy(&pipeline, &value, sizeof(pipeline));
+    return pipeline;
+}
+
+static void vkd3d_meta_publish_pipeline(VkPipeline *vk_pipeline, VkPipeline pipeline)
+{
+    uint64_t value;
+
+    memcpy(&value, &pipeline, sizeof(value));
+    vkd3d_atomic_uint64_store_explicit((uint64_t *)vk_pipeline, value, vkd3d_memory_order_release);
+}
+
+/* Compute pipelines are created on first use rather than at device creation. Once
+ * published, a pipeline never changes, so lookups only need an acquire load. */
+static VkPipeline vkd3d_meta_get_compute_pipeline(struct vkd3d_meta_ops *meta_ops, VkPipeline *vk_pipeline,
+        const uint32_t *code, size_t code_size, VkPipelineLayout layout,
+        const VkSpecializationInfo *specialization_info)
+{
+    struct vkd3d_meta_ops_common *common = &meta_ops->common;
+    VkPipeline pipeline;
+    VkResult vr;
+    int rc;
+
+    if ((pipeline = vkd3d_meta_load_pipeline(vk_pipeline)))
+        return pipeline;
+
+    if ((rc = pthread_mutex_lock(&common->pipeline_mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return VK_NULL_HANDLE;
+    }
+
+    if (!(pipeline = *vk_pipeline))
+    {
+        if ((vr = vkd3d_meta_create_compute_pipeline(meta_ops->device, code_size, code,
+                layout, specialization_info, &pipeline)) < 0)
+        {
+            ERR("Failed to create compute pipeline, vr %d.\n", vr);
+            pipeline = VK_NULL_HANDLE;
+        }
+        else
+            vkd3d_meta_publish_pipeline(vk_pipeline, pipeline);
+    }
+
+    pthread_mutex_unlock(&common->pipeline_mutex);
+    return pipeline;
+}
+
 static VkResult vkd3d_meta_create_render_pass(struct d3d12_device *device, VkSampleCountFlagBits samples,
         const struct vkd3d_format *format, VkImageLayout layout, VkRenderPass *vk_render_pass)
 {
@@ -317,7 +379,7 @@ static VkResult vkd3d_meta_create_graphics_pipeline(struct vkd3d_meta_ops *meta_
     }
 
     if ((vr = VK_CALL(vkCreateGraphicsPipelines(meta_ops->device->vk_device,
-            VK_NULL_HANDLE, 1, &pipeline_info, NULL, vk_pipeline))))
+            meta_ops->common.vk_pipeline_cache, 1, &pipeline_info, NULL, vk_pipeline))))
         ERR("Failed to create graphics pipeline, vr %d.\n", vr);
 
     return vr;
@@ -344,55 +406,6 @@ HRESULT vkd3d_clear_uav_ops_init(struct vkd3d_clear_uav_ops *meta_clear_uav_ops,
       { &meta_clear_uav_ops->vk_set_layout_image,      &meta_clear_uav_ops->vk_pipeline_layout_image,      VK_DESCRIPTOR_TYPE_STORAGE_IMAGE },
     };
 
-    struct {
-      VkPipeline *pipeline;
-      VkPipelineLayout *pipeline_layout;
-      const uint32_t *code;
-      size_t code_size;
-    }
-    pipelines[] =
-    {
-      { &meta_clear_uav_ops->clear_float.buffer,
-        &meta_clear_uav_ops->vk_pipeline_layout_buffer,
-        SPIRV_CODE(cs_clear_uav_buffer_float) },
-      { &meta_clear_uav_ops->clear_float.image_1d,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_1d_float) },
-      { &meta_clear_uav_ops->clear_float.image_1d_array,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_1d_array_float) },
-      { &meta_clear_uav_ops->clear_float.image_2d,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_2d_float) },
-      { &meta_clear_uav_ops->clear_float.image_2d_array,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_2d_array_float) },
-      { &meta_clear_uav_ops->clear_float.image_3d,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_3d_float) },
-      { &meta_clear_uav_ops->clear_uint.buffer,
-        &meta_clear_uav_ops->vk_pipeline_layout_buffer,
-        SPIRV_CODE(cs_clear_uav_buffer_uint) },
-      { &meta_clear_uav_ops->clear_uint.buffer_raw,
-        &meta_clear_uav_ops->vk_pipeline_layout_buffer_raw,
-        SPIRV_CODE(cs_clear_uav_buffer_raw) },
-      { &meta_clear_uav_ops->clear_uint.image_1d,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_1d_uint) },
-      { &meta_clear_uav_ops->clear_uint.image_1d_array,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_1d_array_uint) },
-      { &meta_clear_uav_ops->clear_uint.image_2d,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_2d_uint) },
-      { &meta_clear_uav_ops->clear_uint.image_2d_array,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_2d_array_uint) },
-      { &meta_clear_uav_ops->clear_uint.image_3d,
-        &meta_clear_uav_ops->vk_pipeline_layout_image,
-        SPIRV_CODE(cs_clear_uav_image_3d_uint) },
-    };
-
     memset(meta_clear_uav_ops, 0, sizeof(*meta_clear_uav_ops));
 
     set_binding.binding = 0;
@@ -426,16 +439,17 @@ HRESULT vkd3d_clear_uav_ops_init(struct vkd3d_clear_uav_ops *meta_clear_uav_ops,
         }
     }
 
-    for (i = 0; i < ARRAY_SIZE(pipelines); i++)
+    /* Batched clears address their destinations through the record list. */
+    push_constant_range.size = sizeof(struct vkd3d_clear_uav_batch_args);
+
+    if ((vr = vkd3d_meta_create_pipeline_layout(device, 0, NULL, 1, &push_constant_range,
+            &meta_clear_uav_ops->vk_pipeline_layout_buffer_raw_batch)) < 0)
     {
-        if ((vr = vkd3d_meta_create_compute_pipeline(device, pipelines[i].code_size, pipelines[i].code,
-                *pipelines[i].pipeline_layout, NULL, pipelines[i].pipeline)) < 0)
-        {
-            ERR("Failed to create compute pipeline %u, vr %d.", i, vr);
-            goto fail;
-        }
+        ERR("Failed to create batch pipeline layout, vr %d.", vr);
+        goto fail;
     }
 
+    /* The pipelines themselves are created on first use. */
     return S_OK;
 fail:
     vkd3d_clear_uav_ops_cleanup(meta_clear_uav_ops, device);
@@ -458,6 +472,7 @@ void vkd3d_clear_uav_ops_cleanup(struct vkd3d_clear_uav_ops *meta_clear_uav_ops,
     VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, meta_clear_uav_ops->vk_set_layout_image, NULL));
 
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_clear_uav_ops->vk_pipeline_layout_buffer_raw, NULL));
+    VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_clear_uav_ops->vk_pipeline_layout_buffer_raw_batch, NULL));
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_clear_uav_ops->vk_pipeline_layout_buffer, NULL));
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_clear_uav_ops->vk_pipeline_layout_image, NULL));
 
@@ -465,6 +480,7 @@ void vkd3d_clear_uav_ops_cleanup(struct vkd3d_clear_uav_ops *meta_clear_uav_ops,
     {
         VK_CALL(vkDestroyPipeline(device->vk_device, pipeline_sets[i]->buffer, NULL));
         VK_CALL(vkDestroyPipeline(device->vk_device, pipeline_sets[i]->buffer_raw, NULL));
+        VK_CALL(vkDestroyPipeline(device->vk_device, pipeline_sets[i]->buffer_raw_batch, NULL));
         VK_CALL(vkDestroyPipeline(device->vk_device, pipeline_sets[i]->image_1d, NULL));
         VK_CALL(vkDestroyPipeline(device->vk_device, pipeline_sets[i]->image_2d, NULL));
         VK_CALL(vkDestroyPipeline(device->vk_device, pipeline_sets[i]->image_3d, NULL));
@@ -479,13 +495,42 @@ struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_buffer_uav_pipeline(struct
     struct vkd3d_clear_uav_ops *meta_clear_uav_ops = &meta_ops->clear_uav;
     struct vkd3d_clear_uav_pipeline info;
 
-    const struct vkd3d_clear_uav_pipelines *pipelines = (as_uint || raw)
-            ? &meta_clear_uav_ops->clear_uint
-            : &meta_clear_uav_ops->clear_float;
+    if (raw)
+    {
+        info.vk_set_layout = meta_clear_uav_ops->vk_set_layout_buffer_raw;
+        info.vk_pipeline_layout = meta_clear_uav_ops->vk_pipeline_layout_buffer_raw;
+        info.vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, &meta_clear_uav_ops->clear_uint.buffer_raw,
+                SPIRV_CODE(cs_clear_uav_buffer_raw), info.vk_pipeline_layout, NULL);
+    }
+    else
+    {
+        info.vk_set_layout = meta_clear_uav_ops->vk_set_layout_buffer;
+        info.vk_pipeline_layout = meta_clear_uav_ops->vk_pipeline_layout_buffer;
 
-    info.vk_set_layout = raw ? meta_clear_uav_ops->vk_set_layout_buffer_raw : meta_clear_uav_ops->vk_set_layout_buffer;
-    info.vk_pipeline_layout = raw ? meta_clear_uav_ops->vk_pipeline_layout_buffer_raw : meta_clear_uav_ops->vk_pipeline_layout_buffer;
-    info.vk_pipeline = raw ? pipelines->buffer_raw : pipelines->buffer;
+        if (as_uint)
+        {
+            info.vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, &meta_clear_uav_ops->clear_uint.buffer,
+                    SPIRV_CODE(cs_clear_uav_buffer_uint), info.vk_pipeline_layout, NULL);
+        }
+        else
+        {
+            info.vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, &meta_clear_uav_ops->clear_float.buffer,
+                    SPIRV_CODE(cs_clear_uav_buffer_float), info.vk_pipeline_layout, NULL);
+        }
+    }
+
+    return info;
+}
+
+struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_buffer_uav_batch_pipeline(struct vkd3d_meta_ops *meta_ops)
+{
+    struct vkd3d_clear_uav_ops *meta_clear_uav_ops = &meta_ops->clear_uav;
+    struct vkd3d_clear_uav_pipeline info;
+
+    info.vk_set_layout = VK_NULL_HANDLE;
+    info.vk_pipeline_layout = meta_clear_uav_ops->vk_pipeline_layout_buffer_raw_batch;
+    info.vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, &meta_clear_uav_ops->clear_uint.buffer_raw_batch,
+            SPIRV_CODE(cs_clear_uav_buffer_raw_batch), info.vk_pipeline_layout, NULL);
     return info;
 }
 
@@ -493,9 +538,30 @@ struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_image_uav_pipeline(struct v
         VkImageViewType image_view_type, bool as_uint)
 {
     struct vkd3d_clear_uav_ops *meta_clear_uav_ops = &meta_ops->clear_uav;
+    struct vkd3d_clear_uav_pipelines *pipelines;
     struct vkd3d_clear_uav_pipeline info;
+    const struct vkd3d_meta_spirv_code *code;
+    VkPipeline *vk_pipeline;
+
+    static const struct vkd3d_meta_spirv_code float_code[] =
+    {
+        [VK_IMAGE_VIEW_TYPE_1D]       = { SPIRV_CODE(cs_clear_uav_image_1d_float) },
+        [VK_IMAGE_VIEW_TYPE_2D]       = { SPIRV_CODE(cs_clear_uav_image_2d_float) },
+        [VK_IMAGE_VIEW_TYPE_3D]       = { SPIRV_CODE(cs_clear_uav_image_3d_float) },
+        [VK_IMAGE_VIEW_TYPE_1D_ARRAY] = { SPIRV_CODE(cs_clear_uav_image_1d_array_float) },
+        [VK_IMAGE_VIEW_TYPE_2D_ARRAY] = { SPIRV_CODE(cs_clear_uav_image_2d_array_float) },
+    };
 
-    const struct vkd3d_clear_uav_pipelines *pipelines = as_uint
+    static const struct vkd3d_meta_spirv_code uint_code[] =
+    {
+        [VK_IMAGE_VIEW_TYPE_1D]       = { SPIRV_CODE(cs_clear_uav_image_1d_uint) },
+        [VK_IMAGE_VIEW_TYPE_2D]       = { SPIRV_CODE(cs_clear_uav_image_2d_uint) },
+        [VK_IMAGE_VIEW_TYPE_3D]       = { SPIRV_CODE(cs_clear_uav_image_3d_uint) },
+        [VK_IMAGE_VIEW_TYPE_1D_ARRAY] = { SPIRV_CODE(cs_clear_uav_image_1d_array_uint) },
+        [VK_IMAGE_VIEW_TYPE_2D_ARRAY] = { SPIRV_CODE(cs_clear_uav_image_2d_array_uint) },
+    };
+
+    pipelines = as_uint
             ? &meta_clear_uav_ops->clear_uint
             : &meta_clear_uav_ops->clear_float;
 
@@ -505,25 +571,29 @@ struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_image_uav_pipeline(struct v
     switch (image_view_type)
     {
         case VK_IMAGE_VIEW_TYPE_1D:
-            info.vk_pipeline = pipelines->image_1d;
+            vk_pipeline = &pipelines->image_1d;
             break;
         case VK_IMAGE_VIEW_TYPE_2D:
-            info.vk_pipeline = pipelines->image_2d;
+            vk_pipeline = &pipelines->image_2d;
             break;
         case VK_IMAGE_VIEW_TYPE_3D:
-            info.vk_pipeline = pipelines->image_3d;
+            vk_pipeline = &pipelines->image_3d;
             break;
         case VK_IMAGE_VIEW_TYPE_1D_ARRAY:
-            info.vk_pipeline = pipelines->image_1d_array;
+            vk_pipeline = &pipelines->image_1d_array;
             break;
         case VK_IMAGE_VIEW_TYPE_2D_ARRAY:
-            info.vk_pipeline = pipelines->image_2d_array;
+            vk_pipeline = &pipelines->image_2d_array;
             break;
         default:
             ERR("Unhandled view type %d.\n", image_view_type);
             info.vk_pipeline = VK_NULL_HANDLE;
+            return info;
     }
 
+    code = as_uint ? &uint_code[image_view_type] : &float_code[image_view_type];
+    info.vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, vk_pipeline,
+            code->code, code->code_size, info.vk_pipeline_layout, NULL);
     return info;
 }
 
@@ -982,16 +1052,34 @@ const struct vkd3d_format *vkd3d_meta_get_copy_image_attachment_format(struct vk
     return vkd3d_get_format(meta_ops->device, dxgi_format, false);
 }
 
+static void vkd3d_meta_ops_common_cleanup(struct vkd3d_meta_ops_common *meta_ops_common, struct d3d12_device *device);
+
 static HRESULT vkd3d_meta_ops_common_init(struct vkd3d_meta_ops_common *meta_ops_common, struct d3d12_device *device)
 {
     VkResult vr;
+    int rc;
+
+    memset(meta_ops_common, 0, sizeof(*meta_ops_common));
+
+    if ((rc = pthread_mutex_init(&meta_ops_common->pipeline_mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    /* Shared by all meta pipelines, which are mostly created lazily. */
+    if ((vr = vkd3d_create_pipeline_cache(device, 0, NULL, &meta_ops_common->vk_pipeline_cache)) < 0)
+    {
+        ERR("Failed to create pipeline cache, vr %d.\n", vr);
+        goto fail;
+    }
 
     if (device->vk_info.EXT_shader_viewport_index_layer)
     {
         if ((vr = vkd3d_meta_create_shader_module(device, SPIRV_CODE(vs_fullscreen_layer), &meta_ops_common->vk_module_fullscreen_vs)) < 0)
         {
             ERR("Failed to create shader modules, vr %d.\n", vr);
-            return hresult_from_vk_result(vr);
+            goto fail;
         }
     }
     else
@@ -1000,11 +1088,15 @@ static HRESULT vkd3d_meta_ops_common_init(struct vkd3d_meta_ops_common *meta_ops
             (vr = vkd3d_meta_create_shader_module(device, SPIRV_CODE(gs_fullscreen), &meta_ops_common->vk_module_fullscreen_gs)) < 0)
         {
             ERR("Failed to create shader modules, vr %d.\n", vr);
-            return hresult_from_vk_result(vr);
+            goto fail;
         }
     }
 
     return S_OK;
+
+fail:
+    vkd3d_meta_ops_common_cleanup(meta_ops_common, device);
+    return hresult_from_vk_result(vr);
 }
 
 static void vkd3d_meta_ops_common_cleanup(struct vkd3d_meta_ops_common *meta_ops_common, struct d3d12_device *device)
@@ -1013,6 +1105,8 @@ static void vkd3d_meta_ops_common_cleanup(struct vkd3d_meta_ops_common *meta_ops
 
     VK_CALL(vkDestroyShaderModule(device->vk_device, meta_ops_common->vk_module_fullscreen_vs, NULL));
     VK_CALL(vkDestroyShaderModule(device->vk_device, meta_ops_common->vk_module_fullscreen_gs, NULL));
+    VK_CALL(vkDestroyPipelineCache(device->vk_device, meta_ops_common->vk_pipeline_cache, NULL));
+    pthread_mutex_destroy(&meta_ops_common->pipeline_mutex);
 }
 
 HRESULT vkd3d_swapchain_ops_init(struct vkd3d_swapchain_ops *meta_swapchain_ops, struct d3d12_device *device)
@@ -1161,8 +1255,6 @@ HRESULT vkd3d_query_ops_init(struct vkd3d_query_ops *meta_query_ops,
         struct d3d12_device *device)
 {
     VkPushConstantRange push_constant_range;
-    VkSpecializationInfo spec_info;
-    uint32_t field_count;
     VkResult vr;
 
     static const VkDescriptorSetLayoutBinding gather_bindings[] =
@@ -1178,8 +1270,6 @@ HRESULT vkd3d_query_ops_init(struct vkd3d_query_ops *meta_query_ops,
         { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT },
     };
 
-    static const VkSpecializationMapEntry spec_map = { 0, 0, sizeof(uint32_t) };
-
     if ((vr = vkd3d_meta_create_descriptor_set_layout(device,
             ARRAY_SIZE(gather_bindings), gather_bindings,
             &meta_query_ops->vk_gather_set_layout)) < 0)
@@ -1193,20 +1283,7 @@ HRESULT vkd3d_query_ops_init(struct vkd3d_query_ops *meta_query_ops,
             1, &push_constant_range, &meta_query_ops->vk_gather_pipeline_layout)) < 0)
         goto fail;
 
-    spec_info.mapEntryCount = 1;
-    spec_info.pMapEntries = &spec_map;
-    spec_info.dataSize = sizeof(field_count);
-    spec_info.pData = &field_count;
-
-    field_count = 1;
-    if ((vr = vkd3d_meta_create_compute_pipeline(device, sizeof(cs_resolve_query), cs_resolve_query,
-            meta_query_ops->vk_gather_pipeline_layout, &spec_info, &meta_query_ops->vk_gather_occlusion_pipeline)) < 0)
-        goto fail;
-
-    field_count = 2;
-    if ((vr = vkd3d_meta_create_compute_pipeline(device, sizeof(cs_resolve_query), cs_resolve_query,
-            meta_query_ops->vk_gather_pipeline_layout, &spec_info, &meta_query_ops->vk_gather_so_statistics_pipeline)) < 0)
-        goto fail;
+    /* Gather pipelines are created on first use, see vkd3d_meta_get_query_gather_pipeline(). */
 
     push_constant_range.size = sizeof(struct vkd3d_query_resolve_args);
 
@@ -1223,6 +1300,13 @@ HRESULT vkd3d_query_ops_init(struct vkd3d_query_ops *meta_query_ops,
             meta_query_ops->vk_resolve_pipeline_layout, NULL, &meta_query_ops->vk_resolve_binary_pipeline)) < 0)
         goto fail;
 
+    /* Batched resolves address their queries through the record list. */
+    push_constant_range.size = sizeof(struct vkd3d_query_resolve_batch_args);
+
+    if ((vr = vkd3d_meta_create_pipeline_layout(device, 0, NULL,
+            1, &push_constant_range, &meta_query_ops->vk_resolve_batch_pipeline_layout)) < 0)
+        goto fail;
+
     return S_OK;
 
 fail:
@@ -1244,12 +1328,22 @@ void vkd3d_query_ops_cleanup(struct vkd3d_query_ops *meta_query_ops,
     VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, meta_query_ops->vk_resolve_set_layout, NULL));
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_query_ops->vk_resolve_pipeline_layout, NULL));
     VK_CALL(vkDestroyPipeline(device->vk_device, meta_query_ops->vk_resolve_binary_pipeline, NULL));
+
+    VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_query_ops->vk_resolve_batch_pipeline_layout, NULL));
+    VK_CALL(vkDestroyPipeline(device->vk_device, meta_query_ops->vk_resolve_binary_batch_pipeline, NULL));
 }
 
 bool vkd3d_meta_get_query_gather_pipeline(struct vkd3d_meta_ops *meta_ops,
         D3D12_QUERY_HEAP_TYPE heap_type, struct vkd3d_query_gather_info *info)
 {
-    const struct vkd3d_query_ops *query_ops = &meta_ops->query;
+    struct vkd3d_query_ops *query_ops = &meta_ops->query;
+    VkSpecializationInfo spec_info;
+    const uint32_t *field_count;
+    VkPipeline *vk_pipeline;
+
+    static const VkSpecializationMapEntry spec_map = { 0, 0, sizeof(uint32_t) };
+    static const uint32_t occlusion_field_count = 1;
+    static const uint32_t so_statistics_field_count = 2;
 
     info->vk_set_layout = query_ops->vk_gather_set_layout;
     info->vk_pipeline_layout = query_ops->vk_gather_pipeline_layout;
@@ -1257,45 +1351,66 @@ bool vkd3d_meta_get_query_gather_pipeline(struct vkd3d_meta_ops *meta_ops,
     switch (heap_type)
     {
         case D3D12_QUERY_HEAP_TYPE_OCCLUSION:
-            info->vk_pipeline = query_ops->vk_gather_occlusion_pipeline;
-            return true;
+            vk_pipeline = &query_ops->vk_gather_occlusion_pipeline;
+            field_count = &occlusion_field_count;
+            break;
         case D3D12_QUERY_HEAP_TYPE_SO_STATISTICS:
-            info->vk_pipeline = query_ops->vk_gather_so_statistics_pipeline;
-            return true;
+            vk_pipeline = &query_ops->vk_gather_so_statistics_pipeline;
+            field_count = &so_statistics_field_count;
+            break;
         default:
             ERR("No pipeline for query heap type %u.\n", heap_type);
             return false;
     }
+
+    spec_info.mapEntryCount = 1;
+    spec_info.pMapEntries = &spec_map;
+    spec_info.dataSize = sizeof(*field_count);
+    spec_info.pData = field_count;
+
+    info->vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, vk_pipeline,
+            SPIRV_CODE(cs_resolve_query), query_ops->vk_gather_pipeline_layout, &spec_info);
+    return info->vk_pipeline != VK_NULL_HANDLE;
 }
 
+VkPipeline vkd3d_meta_get_query_resolve_binary_batch_pipeline(struct vkd3d_meta_ops *meta_ops)
+{
+    struct vkd3d_query_ops *query_ops = &meta_ops->query;
+
+    return vkd3d_meta_get_compute_pipeline(meta_ops, &query_ops->vk_resolve_binary_batch_pipeline,
+            SPIRV_CODE(cs_resolve_binary_queries_batch), query_ops->vk_resolve_batch_pipeline_layout, NULL);
+}
+
+struct vkd3d_predicate_command_spec_data
+{
+    uint32_t arg_count;
+    VkBool32 arg_indirect;
+};
+
+static const struct vkd3d_predicate_command_spec_data vkd3d_predicate_command_spec_data[] =
+{
+    { 4, VK_FALSE }, /* VKD3D_PREDICATE_OP_DRAW */
+    { 5, VK_FALSE }, /* VKD3D_PREDICATE_OP_DRAW_INDEXED */
+    { 1, VK_FALSE }, /* VKD3D_PREDICATE_OP_DRAW_INDIRECT */
+    { 1, VK_TRUE  }, /* VKD3D_PREDICATE_OP_DRAW_INDIRECT_COUNT */
+    { 3, VK_FALSE }, /* VKD3D_PREDICATE_OP_DISPATCH */
+    { 3, VK_TRUE  }, /* VKD3D_PREDICATE_OP_DISPATCH_INDIRECT */
+};
+
+static const VkSpecializationMapEntry vkd3d_predicate_command_spec_map[] =
+{
+    { 0, offsetof(struct vkd3d_predicate_command_spec_data, arg_count), sizeof(uint32_t) },
+    { 1, offsetof(struct vkd3d_predicate_command_spec_data, arg_indirect), sizeof(VkBool32) },
+};
+
 HRESULT vkd3d_predicate_ops_init(struct vkd3d_predicate_ops *meta_predicate_ops,
         struct d3d12_device *device)
 {
     VkPushConstantRange push_constant_range;
-    VkSpecializationInfo spec_info;
     VkResult vr;
     size_t i;
 
-    static const struct spec_data
-    {
-        uint32_t arg_count;
-        VkBool32 arg_indirect;
-    }
-    spec_data[] =
-    {
-        { 4, VK_FALSE }, /* VKD3D_PREDICATE_OP_DRAW */
-        { 5, VK_FALSE }, /* VKD3D_PREDICATE_OP_DRAW_INDEXED */
-        { 1, VK_FALSE }, /* VKD3D_PREDICATE_OP_DRAW_INDIRECT */
-        { 1, VK_TRUE  }, /* VKD3D_PREDICATE_OP_DRAW_INDIRECT_COUNT */
-        { 3, VK_FALSE }, /* VKD3D_PREDICATE_OP_DISPATCH */
-        { 3, VK_TRUE  }, /* VKD3D_PREDICATE_OP_DISPATCH_INDIRECT */
-    };
-
-    static const VkSpecializationMapEntry spec_map[] =
-    {
-        { 0, offsetof(struct spec_data, arg_count), sizeof(uint32_t) },
-        { 1, offsetof(struct spec_data, arg_indirect), sizeof(VkBool32) },
-    };
+    STATIC_ASSERT(ARRAY_SIZE(vkd3d_predicate_command_spec_data) == VKD3D_PREDICATE_COMMAND_COUNT);
 
     memset(meta_predicate_ops, 0, sizeof(*meta_predicate_ops));
     push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
@@ -1311,23 +1426,12 @@ HRESULT vkd3d_predicate_ops_init(struct vkd3d_predicate_ops *meta_predicate_ops,
             &push_constant_range, &meta_predicate_ops->vk_resolve_pipeline_layout)) < 0)
         return hresult_from_vk_result(vr);
 
-    spec_info.mapEntryCount = ARRAY_SIZE(spec_map);
-    spec_info.pMapEntries = spec_map;
-    spec_info.dataSize = sizeof(struct spec_data);
-
-    for (i = 0; i < ARRAY_SIZE(spec_data); i++)
-    {
-        spec_info.pData = &spec_data[i];
-
-        if ((vr = vkd3d_meta_create_compute_pipeline(device, sizeof(cs_predicate_command), cs_predicate_command,
-                meta_predicate_ops->vk_command_pipeline_layout, &spec_info, &meta_predicate_ops->vk_command_pipelines[i])) < 0)
-            goto fail;
-
-        meta_predicate_ops->data_sizes[i] = spec_data[i].arg_count * sizeof(uint32_t);
-    }
+    /* Command pipelines are created on first use, see vkd3d_meta_get_predicate_pipeline(). */
+    for (i = 0; i < ARRAY_SIZE(vkd3d_predicate_command_spec_data); i++)
+        meta_predicate_ops->data_sizes[i] = vkd3d_predicate_command_spec_data[i].arg_count * sizeof(uint32_t);
 
     if ((vr = vkd3d_meta_create_compute_pipeline(device, sizeof(cs_resolve_predicate), cs_resolve_predicate,
-            meta_predicate_ops->vk_resolve_pipeline_layout, &spec_info, &meta_predicate_ops->vk_resolve_pipeline)) < 0)
+            meta_predicate_ops->vk_resolve_pipeline_layout, NULL, &meta_predicate_ops->vk_resolve_pipeline)) < 0)
         goto fail;
 
     return S_OK;
@@ -1354,13 +1458,69 @@ void vkd3d_predicate_ops_cleanup(struct vkd3d_predicate_ops *meta_predicate_ops,
 void vkd3d_meta_get_predicate_pipeline(struct vkd3d_meta_ops *meta_ops,
         enum vkd3d_predicate_command_type command_type, struct vkd3d_predicate_command_info *info)
 {
-    const struct vkd3d_predicate_ops *predicate_ops = &meta_ops->predicate;
+    struct vkd3d_predicate_ops *predicate_ops = &meta_ops->predicate;
+    VkSpecializationInfo spec_info;
+
+    spec_info.mapEntryCount = ARRAY_SIZE(vkd3d_predicate_command_spec_map);
+    spec_info.pMapEntries = vkd3d_predicate_command_spec_map;
+    spec_info.dataSize = sizeof(struct vkd3d_predicate_command_spec_data);
+    spec_info.pData = &vkd3d_predicate_command_spec_data[command_type];
 
     info->vk_pipeline_layout = predicate_ops->vk_command_pipeline_layout;
-    info->vk_pipeline = predicate_ops->vk_command_pipelines[command_type];
+    info->vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, &predicate_ops->vk_command_pipelines[command_type],
+            SPIRV_CODE(cs_predicate_command), predicate_ops->vk_command_pipeline_layout, &spec_info);
     info->data_size = predicate_ops->data_sizes[command_type];
 }
 
+static const struct vkd3d_meta_spirv_code vkd3d_execute_indirect_code[] =
+{
+    { SPIRV_CODE(cs_execute_indirect_patch) },
+    { SPIRV_CODE(cs_execute_indirect_dispatch) },
+};
+
+HRESULT vkd3d_execute_indirect_ops_init(struct vkd3d_execute_indirect_ops *meta_indirect_ops,
+        struct d3d12_device *device)
+{
+    VkPushConstantRange push_constant_range;
+    VkResult vr;
+
+    STATIC_ASSERT(ARRAY_SIZE(vkd3d_execute_indirect_code) == VKD3D_EXECUTE_INDIRECT_TYPE_COUNT);
+
+    memset(meta_indirect_ops, 0, sizeof(*meta_indirect_ops));
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.offset = 0;
+    push_constant_range.size = sizeof(struct vkd3d_execute_indirect_args);
+
+    /* Pipelines are created on first use, see vkd3d_meta_get_execute_indirect_pipeline(). */
+    if ((vr = vkd3d_meta_create_pipeline_layout(device, 0, NULL, 1,
+            &push_constant_range, &meta_indirect_ops->vk_pipeline_layout)) < 0)
+        return hresult_from_vk_result(vr);
+
+    return S_OK;
+}
+
+void vkd3d_execute_indirect_ops_cleanup(struct vkd3d_execute_indirect_ops *meta_indirect_ops,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_EXECUTE_INDIRECT_TYPE_COUNT; i++)
+        VK_CALL(vkDestroyPipeline(device->vk_device, meta_indirect_ops->vk_pipelines[i], NULL));
+    VK_CALL(vkDestroyPipelineLayout(device->vk_device, meta_indirect_ops->vk_pipeline_layout, NULL));
+}
+
+void vkd3d_meta_get_execute_indirect_pipeline(struct vkd3d_meta_ops *meta_ops,
+        enum vkd3d_execute_indirect_type type, struct vkd3d_execute_indirect_info *info)
+{
+    struct vkd3d_execute_indirect_ops *indirect_ops = &meta_ops->execute_indirect;
+
+    info->vk_pipeline_layout = indirect_ops->vk_pipeline_layout;
+    info->vk_pipeline = vkd3d_meta_get_compute_pipeline(meta_ops, &indirect_ops->vk_pipelines[type],
+            vkd3d_execute_indirect_code[type].code, vkd3d_execute_indirect_code[type].code_size,
+            indirect_ops->vk_pipeline_layout, NULL);
+}
+
 HRESULT vkd3d_meta_ops_init(struct vkd3d_meta_ops *meta_ops, struct d3d12_device *device)
 {
     HRESULT hr;
@@ -1386,8 +1546,13 @@ HRESULT vkd3d_meta_ops_init(struct vkd3d_meta_ops *meta_ops, struct d3d12_device
     if (FAILED(hr = vkd3d_predicate_ops_init(&meta_ops->predicate, device)))
         goto fail_predicate_ops;
 
+    if (FAILED(hr = vkd3d_execute_indirect_ops_init(&meta_ops->execute_indirect, device)))
+        goto fail_execute_indirect_ops;
+
     return S_OK;
 
+fail_execute_indirect_ops:
+    vkd3d_predicate_ops_cleanup(&meta_ops->predicate, device);
 fail_predicate_ops:
     vkd3d_query_ops_cleanup(&meta_ops->query, device);
 fail_query_ops:
@@ -1402,8 +1567,77 @@ fail_common:
     return hr;
 }
 
+static void vkd3d_meta_ops_prewarm_main(void *userdata)
+{
+    struct vkd3d_execute_indirect_info execute_indirect_info;
+    struct vkd3d_predicate_command_info predicate_info;
+    struct vkd3d_query_gather_info query_info;
+    struct vkd3d_meta_ops *meta_ops = userdata;
+    unsigned int i, j;
+
+    static const VkImageViewType view_types[] =
+    {
+        VK_IMAGE_VIEW_TYPE_1D,
+        VK_IMAGE_VIEW_TYPE_2D,
+        VK_IMAGE_VIEW_TYPE_3D,
+        VK_IMAGE_VIEW_TYPE_1D_ARRAY,
+        VK_IMAGE_VIEW_TYPE_2D_ARRAY,
+    };
+
+    static const D3D12_QUERY_HEAP_TYPE query_heap_types[] =
+    {
+        D3D12_QUERY_HEAP_TYPE_OCCLUSION,
+        D3D12_QUERY_HEAP_TYPE_SO_STATISTICS,
+    };
+
+    /* The getters create anything which does not exist yet and are safe
+     * to race with command lists doing the same. */
+    for (i = 0; i < 2; i++)
+    {
+        vkd3d_meta_get_clear_buffer_uav_pipeline(meta_ops, !!i, false);
+
+        for (j = 0; j < ARRAY_SIZE(view_types); j++)
+            vkd3d_meta_get_clear_image_uav_pipeline(meta_ops, view_types[j], !!i);
+    }
+
+    vkd3d_meta_get_clear_buffer_uav_pipeline(meta_ops, true, true);
+
+    for (i = 0; i < ARRAY_SIZE(query_heap_types); i++)
+        vkd3d_meta_get_query_gather_pipeline(meta_ops, query_heap_types[i], &query_info);
+
+    /* Batch pipelines access memory through buffer device addresses. */
+    if (meta_ops->device->device_info.buffer_device_address_features.bufferDeviceAddress)
+    {
+        vkd3d_meta_get_clear_buffer_uav_batch_pipeline(meta_ops);
+        vkd3d_meta_get_query_resolve_binary_batch_pipeline(meta_ops);
+    }
+
+    for (i = 0; i < VKD3D_PREDICATE_COMMAND_COUNT; i++)
+        vkd3d_meta_get_predicate_pipeline(meta_ops, i, &predicate_info);
+
+    for (i = 0; i < VKD3D_EXECUTE_INDIRECT_TYPE_COUNT; i++)
+        vkd3d_meta_get_execute_indirect_pipeline(meta_ops, i, &execute_indirect_info);
+
+    TRACE("Created meta pipelines for device %p.\n", meta_ops->device);
+}
+
+void vkd3d_meta_ops_prewarm(struct vkd3d_meta_ops *meta_ops)
+{
+    struct vkd3d_task_pool *pool = &meta_ops->device->task_pool;
+
+    /* Without worker threads this would only move the cost back into device creation. */
+    if (!vkd3d_task_pool_is_active(pool))
+        return;
+
+    /* Never waited on, the pool drains all tasks before its threads exit. Command lists
+     * create meta pipelines on demand anyway, so this must not delay application work. */
+    vkd3d_task_pool_submit(pool, VKD3D_TASK_TYPE_META_PREWARM, VKD3D_TASK_PRIORITY_LOW,
+            &meta_ops->prewarm_group, vkd3d_meta_ops_prewarm_main, meta_ops);
+}
+
 HRESULT vkd3d_meta_ops_cleanup(struct vkd3d_meta_ops *meta_ops, struct d3d12_device *device)
 {
+    vkd3d_execute_indirect_ops_cleanup(&meta_ops->execute_indirect, device);
     vkd3d_predicate_ops_cleanup(&meta_ops->predicate, device);
     vkd3d_query_ops_cleanup(&meta_ops->query, device);
     vkd3d_swapchain_ops_cleanup(&meta_ops->swapchain, device);
@@ -117,12 +117,18 @@ static void d3d12_state_object_cleanup(struct d3d12_state_object *object)
     }
     vkd3d_free(object->exports);
     vkd3d_free(object->entry_points);
+    hash_map_clear(&object->export_map);
+    hash_map_clear(&object->entry_point_map);
 
     for (i = 0; i < object->collections_count; i++)
         d3d12_state_object_dec_ref(object->collections[i]);
     vkd3d_free(object->collections);
 
     VK_CALL(vkDestroyPipeline(object->device->vk_device, object->pipeline, NULL));
+    VK_CALL(vkDestroyPipeline(object->device->vk_device, object->pipeline_library, NULL));
+
+    if (object->global_root_signature)
+        ID3D12RootSignature_Release(object->global_root_signature);
 
     VK_CALL(vkDestroyPipelineLayout(object->device->vk_device,
             object->local_static_sampler.pipeline_layout, NULL));
@@ -200,6 +206,121 @@ static HRESULT STDMETHODCALLTYPE d3d12_state_object_GetDevice(ID3D12StateObject
     return d3d12_device_query_interface(state_object->device, iid, device);
 }
 
+/* Export names are resolved through hash maps keyed on the name, since applications look up
+ * identifiers for thousands of exports. Where several candidates share a name, the lowest
+ * index wins, which matches what a linear search in declaration order would find. */
+struct d3d12_state_object_name_key
+{
+    const WCHAR *name;
+    size_t length;
+};
+
+struct d3d12_state_object_name_entry
+{
+    struct hash_map_entry entry;
+    const WCHAR *name;
+    size_t length;
+    uint32_t index;
+};
+
+static uint32_t d3d12_state_object_name_hash(const void *key)
+{
+    const struct d3d12_state_object_name_key *k = key;
+    uint64_t hash = hash_fnv1_init();
+    size_t i;
+
+    for (i = 0; i < k->length; i++)
+        hash = hash_fnv1_iterate_u32(hash, k->name[i]);
+    return hash_uint64(hash);
+}
+
+static bool d3d12_state_object_name_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct d3d12_state_object_name_entry *e = (const struct d3d12_state_object_name_entry *)entry;
+    const struct d3d12_state_object_name_key *k = key;
+
+    return k->length == e->length && !memcmp(k->name, e->name, k->length * sizeof(*k->name));
+}
+
+static void d3d12_state_object_name_map_init(struct hash_map *map)
+{
+    hash_map_init(map, d3d12_state_object_name_hash, d3d12_state_object_name_compare,
+            sizeof(struct d3d12_state_object_name_entry));
+}
+
+static bool d3d12_state_object_name_map_insert(struct hash_map *map, const WCHAR *name, uint32_t index)
+{
+    struct d3d12_state_object_name_entry entry;
+    struct d3d12_state_object_name_key key;
+
+    if (!name)
+        return true;
+
+    key.name = name;
+    key.length = vkd3d_wcslen(name);
+
+    entry.name = key.name;
+    entry.length = key.length;
+    entry.index = index;
+
+    /* An existing entry for the same name is kept, since it has the lower index. */
+    return !!hash_map_insert(map, &key, &entry.entry);
+}
+
+static uint32_t d3d12_state_object_name_map_find_n(const struct hash_map *map,
+        const WCHAR *name, size_t length)
+{
+    const struct d3d12_state_object_name_entry *entry;
+    struct d3d12_state_object_name_key key;
+
+    key.name = name;
+    key.length = length;
+
+    if (!(entry = (const struct d3d12_state_object_name_entry *)hash_map_find(map, &key)))
+        return UINT32_MAX;
+    return entry->index;
+}
+
+static uint32_t d3d12_state_object_name_map_find(const struct hash_map *map, const WCHAR *name)
+{
+    if (!name)
+        return UINT32_MAX;
+    return d3d12_state_object_name_map_find_n(map, name, vkd3d_wcslen(name));
+}
+
+/* Returns the lowest index which matches either name of the entry point. */
+static uint32_t d3d12_state_object_name_map_find_entry(const struct hash_map *map,
+        const struct vkd3d_shader_library_entry_point *entry)
+{
+    uint32_t mangled_index = d3d12_state_object_name_map_find(map, entry->mangled_entry_point);
+    uint32_t plain_index = d3d12_state_object_name_map_find(map, entry->plain_entry_point);
+
+    return min(mangled_index, plain_index);
+}
+
+static HRESULT d3d12_state_object_build_export_maps(struct d3d12_state_object *object)
+{
+    size_t i;
+
+    for (i = 0; i < object->exports_count; i++)
+    {
+        if (!d3d12_state_object_name_map_insert(&object->export_map, object->exports[i].mangled_export, i) ||
+                !d3d12_state_object_name_map_insert(&object->export_map, object->exports[i].plain_export, i))
+            return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < object->entry_points_count; i++)
+    {
+        if (!d3d12_state_object_name_map_insert(&object->entry_point_map,
+                        object->entry_points[i].mangled_entry_point, i) ||
+                !d3d12_state_object_name_map_insert(&object->entry_point_map,
+                        object->entry_points[i].plain_entry_point, i))
+            return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
+
 static bool vkd3d_export_equal(LPCWSTR export, const struct vkd3d_shader_library_entry_point *entry)
 {
     return vkd3d_export_strequal(export, entry->mangled_entry_point) ||
@@ -210,7 +331,8 @@ static uint32_t d3d12_state_object_get_export_index(struct d3d12_state_object *o
         const WCHAR *export_name, const WCHAR **out_subtype)
 {
     const WCHAR *subtype = NULL;
-    size_t i, n;
+    uint32_t index;
+    size_t n;
 
     /* Need to check for hitgroup::{closesthit,anyhit,intersection}. */
     n = 0;
@@ -220,17 +342,11 @@ static uint32_t d3d12_state_object_get_export_index(struct d3d12_state_object *o
     if (export_name[n] == ':')
         subtype = export_name + n;
 
-    for (i = 0; i < object->exports_count; i++)
-    {
-        if (vkd3d_export_strequal_substr(export_name, n, object->exports[i].mangled_export) ||
-                vkd3d_export_strequal_substr(export_name, n, object->exports[i].plain_export))
-        {
-            *out_subtype = subtype;
-            return i;
-        }
-    }
+    index = d3d12_state_object_name_map_find_n(&object->export_map, export_name, n);
+    if (index != UINT32_MAX)
+        *out_subtype = subtype;
 
-    return UINT32_MAX;
+    return index;
 }
 
 static void * STDMETHODCALLTYPE d3d12_state_object_properties_GetShaderIdentifier(ID3D12StateObjectProperties *iface,
@@ -394,6 +510,14 @@ struct d3d12_state_object_pipeline_data
     VkPipeline *vk_libraries;
     size_t vk_libraries_size;
     size_t vk_libraries_count;
+
+    /* The state object this one was derived from through AddToStateObject, if any. */
+    struct d3d12_state_object *parent;
+
+    /* Name lookups into entry_points, associations and hit_groups. */
+    struct hash_map entry_point_map;
+    struct hash_map association_map;
+    struct hash_map hit_group_import_map;
 };
 
 static void d3d12_state_object_pipeline_data_cleanup(struct d3d12_state_object_pipeline_data *data,
@@ -421,6 +545,29 @@ static void d3d12_state_object_pipeline_data_cleanup(struct d3d12_state_object_p
     vkd3d_free(data->associations);
     vkd3d_free(data->collections);
     vkd3d_free(data->vk_libraries);
+
+    hash_map_clear(&data->entry_point_map);
+    hash_map_clear(&data->association_map);
+    hash_map_clear(&data->hit_group_import_map);
+}
+
+static void d3d12_state_object_pipeline_data_add_collection(struct d3d12_state_object_pipeline_data *data,
+        struct d3d12_state_object *object, VkPipeline vk_library,
+        unsigned int num_exports, const D3D12_EXPORT_DESC *exports)
+{
+    vkd3d_array_reserve((void **)&data->collections, &data->collections_size,
+            data->collections_count + 1, sizeof(*data->collections));
+
+    data->collections[data->collections_count].object = object;
+    data->collections[data->collections_count].num_exports = num_exports;
+    data->collections[data->collections_count].exports = exports;
+
+    vkd3d_array_reserve((void **)&data->vk_libraries, &data->vk_libraries_size,
+            data->vk_libraries_count + 1, sizeof(*data->vk_libraries));
+    data->vk_libraries[data->vk_libraries_count] = vk_library;
+
+    data->collections_count += 1;
+    data->vk_libraries_count += 1;
 }
 
 static HRESULT d3d12_state_object_parse_subobjects(struct d3d12_state_object *object,
@@ -437,7 +584,8 @@ static HRESULT d3d12_state_object_parse_subobjects(struct d3d12_state_object *ob
             {
                 const D3D12_STATE_OBJECT_CONFIG *object_config = obj->pDesc;
                 object->flags = object_config->Flags;
-                if (object->flags & ~D3D12_STATE_OBJECT_FLAG_ALLOW_EXTERNAL_DEPENDENCIES_ON_LOCAL_DEFINITIONS)
+                if (object->flags & ~(D3D12_STATE_OBJECT_FLAG_ALLOW_EXTERNAL_DEPENDENCIES_ON_LOCAL_DEFINITIONS |
+                        D3D12_STATE_OBJECT_FLAG_ALLOW_STATE_OBJECT_ADDITIONS))
                 {
                     FIXME("Object config flag #%x is not supported.\n", object->flags);
                     return E_INVALIDARG;
@@ -448,7 +596,8 @@ static HRESULT d3d12_state_object_parse_subobjects(struct d3d12_state_object *ob
             case D3D12_STATE_SUBOBJECT_TYPE_GLOBAL_ROOT_SIGNATURE:
             {
                 const D3D12_GLOBAL_ROOT_SIGNATURE *rs = obj->pDesc;
-                if (data->global_root_signature)
+                /* Additions may repeat the global root signature of their parent. */
+                if (data->global_root_signature && data->global_root_signature != rs->pGlobalRootSignature)
                 {
                     /* Simplicity for now. */
                     FIXME("More than one global root signature is used.\n");
@@ -588,19 +737,11 @@ static HRESULT d3d12_state_object_parse_subobjects(struct d3d12_state_object *ob
             case D3D12_STATE_SUBOBJECT_TYPE_EXISTING_COLLECTION:
             {
                 const D3D12_EXISTING_COLLECTION_DESC *collection = obj->pDesc;
-                vkd3d_array_reserve((void **)&data->collections, &data->collections_size,
-                        data->collections_count + 1, sizeof(*data->collections));
+                struct d3d12_state_object *collection_object;
 
-                data->collections[data->collections_count].object = impl_from_ID3D12StateObject(collection->pExistingCollection);
-                data->collections[data->collections_count].num_exports = collection->NumExports;
-                data->collections[data->collections_count].exports = collection->pExports;
-
-                vkd3d_array_reserve((void **)&data->vk_libraries, &data->vk_libraries_size,
-                        data->vk_libraries_count + 1, sizeof(*data->vk_libraries));
-                data->vk_libraries[data->vk_libraries_count] = data->collections[data->collections_count].object->pipeline;
-
-                data->collections_count += 1;
-                data->vk_libraries_count += 1;
+                collection_object = impl_from_ID3D12StateObject(collection->pExistingCollection);
+                d3d12_state_object_pipeline_data_add_collection(data, collection_object,
+                        collection_object->pipeline, collection->NumExports, collection->pExports);
                 break;
             }
 
@@ -626,19 +767,17 @@ static HRESULT d3d12_state_object_parse_subobjects(struct d3d12_state_object *ob
 }
 
 static uint32_t d3d12_state_object_pipeline_data_find_entry_inner(
-        const struct vkd3d_shader_library_entry_point *entry_points,
-        size_t count, const WCHAR *import)
+        const struct hash_map *entry_point_map, const WCHAR *import)
 {
-    uint32_t i;
+    uint32_t index;
 
     if (!import)
         return VK_SHADER_UNUSED_KHR;
 
-    for (i = 0; i < count; i++)
-        if (vkd3d_export_equal(import, &entry_points[i]))
-            return i;
+    if ((index = d3d12_state_object_name_map_find(entry_point_map, import)) == UINT32_MAX)
+        return VK_SHADER_UNUSED_KHR;
 
-    return VK_SHADER_UNUSED_KHR;
+    return index;
 }
 
 static uint32_t d3d12_state_object_pipeline_data_find_entry(
@@ -653,7 +792,7 @@ static uint32_t d3d12_state_object_pipeline_data_find_entry(
     if (!import)
         return VK_SHADER_UNUSED_KHR;
 
-    index = d3d12_state_object_pipeline_data_find_entry_inner(data->entry_points, data->entry_points_count, import);
+    index = d3d12_state_object_pipeline_data_find_entry_inner(&data->entry_point_map, import);
     if (index != VK_SHADER_UNUSED_KHR)
         return index;
 
@@ -662,9 +801,8 @@ static uint32_t d3d12_state_object_pipeline_data_find_entry(
     /* Try to look in collections. */
     for (i = 0; i < data->collections_count; i++)
     {
-        index = d3d12_state_object_pipeline_data_find_entry_inner(data->collections[i].object->entry_points,
-                data->collections[i].object->entry_points_count,
-                import);
+        index = d3d12_state_object_pipeline_data_find_entry_inner(
+                &data->collections[i].object->entry_point_map, import);
         if (index != VK_SHADER_UNUSED_KHR)
             return offset + index;
 
@@ -783,25 +921,41 @@ static VkDeviceSize d3d12_state_object_pipeline_data_compute_default_stack_size(
     return pipeline_stack_size;
 }
 
+static HRESULT d3d12_state_object_pipeline_data_build_association_maps(
+        struct d3d12_state_object_pipeline_data *data)
+{
+    const D3D12_HIT_GROUP_DESC *hit_group;
+    size_t i;
+
+    for (i = 0; i < data->associations_count; i++)
+        if (!d3d12_state_object_name_map_insert(&data->association_map, data->associations[i].export, i))
+            return E_OUTOFMEMORY;
+
+    for (i = 0; i < data->hit_groups_count; i++)
+    {
+        hit_group = data->hit_groups[i];
+        if (!d3d12_state_object_name_map_insert(&data->hit_group_import_map, hit_group->ClosestHitShaderImport, i) ||
+                !d3d12_state_object_name_map_insert(&data->hit_group_import_map, hit_group->AnyHitShaderImport, i) ||
+                !d3d12_state_object_name_map_insert(&data->hit_group_import_map, hit_group->IntersectionShaderImport, i))
+            return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
+
 static struct d3d12_root_signature *d3d12_state_object_find_associated_root_signature_entry(
         struct d3d12_state_object_pipeline_data *data,
         const struct vkd3d_shader_library_entry_point *entry)
 {
-    size_t i;
-    for (i = 0; i < data->associations_count; i++)
-        if (vkd3d_export_equal(data->associations[i].export, entry))
-            return data->associations[i].root_signature;
-    return NULL;
+    uint32_t index = d3d12_state_object_name_map_find_entry(&data->association_map, entry);
+    return index != UINT32_MAX ? data->associations[index].root_signature : NULL;
 }
 
 static struct d3d12_root_signature *d3d12_state_object_find_associated_root_signature_export(
         struct d3d12_state_object_pipeline_data *data, LPCWSTR export)
 {
-    size_t i;
-    for (i = 0; i < data->associations_count; i++)
-        if (vkd3d_export_strequal(data->associations[i].export, export))
-            return data->associations[i].root_signature;
-    return NULL;
+    uint32_t index = d3d12_state_object_name_map_find(&data->association_map, export);
+    return index != UINT32_MAX ? data->associations[index].root_signature : NULL;
 }
 
 static struct d3d12_root_signature *d3d12_state_object_pipeline_data_get_local_root_signature(
@@ -817,8 +971,11 @@ static struct d3d12_root_signature *d3d12_state_object_pipeline_data_get_local_r
     /* If we didn't find an association for this entry point, we might have an association
      * in a hit group export.
      * FIXME: Is it possible to have multiple hit groups, all referring to same entry point, while using
-     * different root signatures for the different instances of the entry point? :| */
-    for (i = 0; i < data->hit_groups_count && !rs; i++)
+     * different root signatures for the different instances of the entry point? :|
+     * The first hit group which imports the entry point comes from the map,
+     * later ones only need to be scanned if that one has no association. */
+    i = rs ? data->hit_groups_count : d3d12_state_object_name_map_find_entry(&data->hit_group_import_map, entry);
+    for (; i < data->hit_groups_count && !rs; i++)
     {
         hit_group = data->hit_groups[i];
         if (vkd3d_export_equal(hit_group->ClosestHitShaderImport, entry) ||
@@ -951,6 +1108,229 @@ static void d3d12_state_object_append_local_static_samplers(
     *out_vk_bindings_count = vk_bindings_count;
 }
 
+struct d3d12_state_object_entry_compile
+{
+    struct vkd3d_shader_interface_info shader_interface;
+    struct vkd3d_shader_interface_local_info shader_interface_local;
+    struct vkd3d_shader_resource_binding *local_bindings;
+    uint32_t stage_index;
+};
+
+/* A run of entry points from the same DXIL library. Each task parses its library once on the
+ * thread it runs on, since a parsed library is tied to that thread's DXIL allocator context. */
+struct d3d12_state_object_export_compile
+{
+    struct d3d12_state_object *object;
+    struct d3d12_state_object_pipeline_data *data;
+    const struct d3d12_state_object_entry_compile *entry_compiles;
+    const struct vkd3d_shader_compile_arguments *compile_args;
+    size_t entry_begin;
+    size_t entry_end;
+    HRESULT hr;
+};
+
+static void d3d12_state_object_compile_exports_main(void *userdata)
+{
+    struct d3d12_state_object_export_compile *compile = userdata;
+    const struct d3d12_state_object_entry_compile *entry_compile;
+    struct d3d12_state_object_pipeline_data *data = compile->data;
+    struct d3d12_device *device = compile->object->device;
+    const struct D3D12_DXIL_LIBRARY_DESC *library_desc;
+    struct vkd3d_shader_library_entry_point *entry;
+    struct vkd3d_shader_dxil_library *library;
+    VkPipelineShaderStageCreateInfo *stage;
+    struct vkd3d_shader_code spirv;
+    struct vkd3d_shader_code dxil;
+    size_t i;
+
+    compile->hr = S_OK;
+
+    library_desc = data->dxil_libraries[data->entry_points[compile->entry_begin].identifier];
+    dxil.code = library_desc->DXILLibrary.pShaderBytecode;
+    dxil.size = library_desc->DXILLibrary.BytecodeLength;
+
+    if (vkd3d_shader_dxil_library_create(&dxil, &library) != VKD3D_OK)
+    {
+        ERR("Failed to parse DXIL library for export: %s\n",
+                data->entry_points[compile->entry_begin].real_entry_point);
+        compile->hr = E_OUTOFMEMORY;
+        return;
+    }
+
+    for (i = compile->entry_begin; i < compile->entry_end; i++)
+    {
+        entry = &data->entry_points[i];
+        entry_compile = &compile->entry_compiles[i];
+        stage = &data->stages[entry_compile->stage_index];
+
+        memset(&spirv, 0, sizeof(spirv));
+        if (vkd3d_shader_compile_dxil_library_export(library, entry->real_entry_point, &spirv,
+                &entry_compile->shader_interface, &entry_compile->shader_interface_local,
+                compile->compile_args) != VKD3D_OK)
+        {
+            ERR("Failed to convert DXIL export: %s\n", entry->real_entry_point);
+            compile->hr = E_OUTOFMEMORY;
+            break;
+        }
+
+        if (!d3d12_device_validate_shader_meta(device, &spirv.meta))
+        {
+            vkd3d_shader_free_shader_code(&spirv);
+            compile->hr = E_INVALIDARG;
+            break;
+        }
+
+        stage->module = create_shader_module(device, spirv.code, spirv.size);
+
+        if ((spirv.meta.flags & VKD3D_SHADER_META_FLAG_USES_SUBGROUP_SIZE) &&
+                device->device_info.subgroup_size_control_features.subgroupSizeControl)
+        {
+            stage->flags |= VK_PIPELINE_SHADER_STAGE_CREATE_ALLOW_VARYING_SUBGROUP_SIZE_BIT_EXT;
+        }
+
+        vkd3d_shader_free_shader_code(&spirv);
+        if (!stage->module)
+        {
+            compile->hr = E_OUTOFMEMORY;
+            break;
+        }
+    }
+
+    vkd3d_shader_dxil_library_free(library);
+}
+
+static HRESULT d3d12_state_object_compile_exports(struct d3d12_state_object *object,
+        struct d3d12_state_object_pipeline_data *data,
+        const struct d3d12_state_object_entry_compile *entry_compiles,
+        const struct vkd3d_shader_compile_arguments *compile_args)
+{
+    struct vkd3d_task_pool *pool = &object->device->task_pool;
+    struct d3d12_state_object_export_compile *compiles = NULL;
+    size_t compiles_count = 0, compiles_size = 0;
+    struct vkd3d_task_group group;
+    size_t run_begin, run_end, chunk_size;
+    size_t i, task_count;
+    HRESULT hr = S_OK;
+
+    /* Splitting a library across more tasks means parsing it more than once,
+     * so only split as far as there are threads to run the pieces. */
+    task_count = pool->thread_count + 1;
+
+    for (run_begin = 0; run_begin < data->entry_points_count; run_begin = run_end)
+    {
+        for (run_end = run_begin + 1; run_end < data->entry_points_count; run_end++)
+            if (data->entry_points[run_end].identifier != data->entry_points[run_begin].identifier)
+                break;
+
+        chunk_size = (run_end - run_begin + task_count - 1) / task_count;
+
+        for (i = run_begin; i < run_end; i += chunk_size)
+        {
+            if (!vkd3d_array_reserve((void **)&compiles, &compiles_size,
+                    compiles_count + 1, sizeof(*compiles)))
+            {
+                vkd3d_free(compiles);
+                return E_OUTOFMEMORY;
+            }
+
+            compiles[compiles_count].object = object;
+            compiles[compiles_count].data = data;
+            compiles[compiles_count].entry_compiles = entry_compiles;
+            compiles[compiles_count].compile_args = compile_args;
+            compiles[compiles_count].entry_begin = i;
+            compiles[compiles_count].entry_end = min(i + chunk_size, run_end);
+            compiles[compiles_count].hr = S_OK;
+            compiles_count++;
+        }
+    }
+
+    memset(&group, 0, sizeof(group));
+    for (i = 0; i < compiles_count; i++)
+        vkd3d_task_pool_submit(pool, VKD3D_TASK_TYPE_STATE_OBJECT_COMPILE, VKD3D_TASK_PRIORITY_HIGH,
+                &group, d3d12_state_object_compile_exports_main, &compiles[i]);
+    vkd3d_task_pool_wait(pool, &group);
+
+    for (i = 0; i < compiles_count && SUCCEEDED(hr); i++)
+        hr = compiles[i].hr;
+
+    vkd3d_free(compiles);
+    return hr;
+}
+
+struct d3d12_state_object_deferred_join
+{
+    struct d3d12_device *device;
+    VkDeferredOperationKHR vk_operation;
+};
+
+static void d3d12_state_object_deferred_join_main(void *userdata)
+{
+    struct d3d12_state_object_deferred_join *join = userdata;
+    const struct vkd3d_vk_device_procs *vk_procs = &join->device->vk_procs;
+    VkResult vr;
+
+    /* THREAD_IDLE means there may be more work later, THREAD_DONE or SUCCESS that there is none. */
+    while ((vr = VK_CALL(vkDeferredOperationJoinKHR(join->device->vk_device, join->vk_operation))) ==
+            VK_THREAD_IDLE_KHR)
+        vkd3d_pause();
+}
+
+static VkResult d3d12_state_object_create_vk_pipeline(struct d3d12_state_object *object,
+        const VkRayTracingPipelineCreateInfoKHR *create_info, VkPipeline *vk_pipeline)
+{
+    struct vkd3d_task_pool *pool = &object->device->task_pool;
+    const struct vkd3d_vk_device_procs *vk_procs = &object->device->vk_procs;
+    struct d3d12_state_object_deferred_join join;
+    struct vkd3d_task_group group;
+    uint32_t concurrency, i;
+    VkResult vr;
+
+    /* Without helper threads there is nobody to share the driver compile with. */
+    if (!object->device->vk_info.KHR_deferred_host_operations || !vkd3d_task_pool_is_active(pool))
+    {
+        return VK_CALL(vkCreateRayTracingPipelinesKHR(object->device->vk_device, VK_NULL_HANDLE,
+                VK_NULL_HANDLE, 1, create_info, NULL, vk_pipeline));
+    }
+
+    join.device = object->device;
+    if ((vr = VK_CALL(vkCreateDeferredOperationKHR(object->device->vk_device, NULL, &join.vk_operation))))
+    {
+        WARN("Failed to create deferred operation, vr %d.\n", vr);
+        return VK_CALL(vkCreateRayTracingPipelinesKHR(object->device->vk_device, VK_NULL_HANDLE,
+                VK_NULL_HANDLE, 1, create_info, NULL, vk_pipeline));
+    }
+
+    vr = VK_CALL(vkCreateRayTracingPipelinesKHR(object->device->vk_device, join.vk_operation,
+            VK_NULL_HANDLE, 1, create_info, NULL, vk_pipeline));
+
+    if (vr == VK_OPERATION_DEFERRED_KHR)
+    {
+        concurrency = VK_CALL(vkGetDeferredOperationMaxConcurrencyKHR(object->device->vk_device,
+                join.vk_operation));
+        concurrency = min(concurrency, pool->thread_count + 1);
+        TRACE("Joining deferred pipeline compile on %u threads.\n", max(concurrency, 1u));
+
+        /* The calling thread always joins as well, so it is never left waiting on a busy pool. */
+        memset(&group, 0, sizeof(group));
+        for (i = 1; i < concurrency; i++)
+        {
+            vkd3d_task_pool_submit(pool, VKD3D_TASK_TYPE_DEFERRED_OPERATION_JOIN, VKD3D_TASK_PRIORITY_HIGH,
+                    &group, d3d12_state_object_deferred_join_main, &join);
+        }
+        d3d12_state_object_deferred_join_main(&join);
+        vkd3d_task_pool_wait(pool, &group);
+
+        while ((vr = VK_CALL(vkGetDeferredOperationResultKHR(object->device->vk_device,
+                join.vk_operation))) == VK_NOT_READY)
+            d3d12_state_object_deferred_join_main(&join);
+    }
+    else if (vr == VK_OPERATION_NOT_DEFERRED_KHR)
+        vr = VK_SUCCESS;
+
+    VK_CALL(vkDestroyDeferredOperationKHR(object->device->vk_device, join.vk_operation, NULL));
+    return vr;
+}
+
 static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *object,
         struct d3d12_state_object_pipeline_data *data)
 {
@@ -961,6 +1341,7 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
     struct vkd3d_shader_interface_info shader_interface_info;
     VkRayTracingPipelineCreateInfoKHR pipeline_create_info;
     struct vkd3d_shader_resource_binding *local_bindings;
+    struct d3d12_state_object_entry_compile *entry_compiles;
     struct vkd3d_shader_compile_arguments compile_args;
     struct d3d12_state_object_collection *collection;
     VkPipelineDynamicStateCreateInfo dynamic_state;
@@ -975,8 +1356,6 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
     VkPipelineShaderStageCreateInfo *stage;
     uint32_t pgroup_offset, pstage_offset;
     unsigned int num_groups_to_export;
-    struct vkd3d_shader_code spirv;
-    struct vkd3d_shader_code dxil;
     size_t i, j;
     VkResult vr;
     HRESULT hr;
@@ -1023,6 +1402,16 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
     local_static_sampler_bindings_size = 0;
     object->local_static_sampler.set_index = global_signature ? global_signature->num_set_layouts : 0;
 
+    if (FAILED(hr = d3d12_state_object_pipeline_data_build_association_maps(data)))
+        return hr;
+
+    entry_compiles = NULL;
+    if (data->entry_points_count &&
+            !(entry_compiles = vkd3d_calloc(data->entry_points_count, sizeof(*entry_compiles))))
+        return E_OUTOFMEMORY;
+
+    /* Interfaces and groups are resolved in order here, since promoted root signature state
+     * accumulates across entry points. Only the translation itself is done in parallel. */
     for (i = 0; i < data->entry_points_count; i++)
     {
         entry = &data->entry_points[i];
@@ -1108,39 +1497,37 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
         stage->pName = "main";
         stage->pSpecializationInfo = NULL;
 
-        memset(&dxil, 0, sizeof(dxil));
-        memset(&spirv, 0, sizeof(spirv));
-
-        /* TODO: If we're exporting multiple entry points from one DXIL library,
-         * we can amortize the parsing cost. */
-        dxil.code = data->dxil_libraries[entry->identifier]->DXILLibrary.pShaderBytecode;
-        dxil.size = data->dxil_libraries[entry->identifier]->DXILLibrary.BytecodeLength;
+        entry_compiles[i].shader_interface = shader_interface_info;
+        entry_compiles[i].shader_interface_local = shader_interface_local_info;
+        entry_compiles[i].local_bindings = local_bindings;
+        entry_compiles[i].stage_index = data->stages_count;
 
-        if (vkd3d_shader_compile_dxil_export(&dxil, entry->real_entry_point, &spirv,
-                &shader_interface_info, &shader_interface_local_info, &compile_args) != VKD3D_OK)
-        {
-            ERR("Failed to convert DXIL export: %s\n", entry->real_entry_point);
-            vkd3d_free(local_bindings);
-            return E_OUTOFMEMORY;
-        }
-
-        vkd3d_free(local_bindings);
-        if (!d3d12_device_validate_shader_meta(object->device, &spirv.meta))
-            return E_INVALIDARG;
+        /* Modules are filled in below, cleanup handles the ones which never got created. */
+        data->stages_count++;
+    }
 
-        stage->module = create_shader_module(object->device, spirv.code, spirv.size);
+    if (data->entry_points_count)
+        hr = d3d12_state_object_compile_exports(object, data, entry_compiles, &compile_args);
+    else
+        hr = S_OK;
 
-        if ((spirv.meta.flags & VKD3D_SHADER_META_FLAG_USES_SUBGROUP_SIZE) &&
-                object->device->device_info.subgroup_size_control_features.subgroupSizeControl)
-        {
-            stage->flags |= VK_PIPELINE_SHADER_STAGE_CREATE_ALLOW_VARYING_SUBGROUP_SIZE_BIT_EXT;
-        }
+    for (i = 0; i < data->entry_points_count; i++)
+        vkd3d_free(entry_compiles[i].local_bindings);
+    vkd3d_free(entry_compiles);
 
-        vkd3d_shader_free_shader_code(&spirv);
-        if (!stage->module)
-            return E_OUTOFMEMORY;
+    /* Names of entry points which were exported as general groups have been moved
+     * to the export table by now, so those can no longer be imported by hit groups. */
+    for (i = 0; i < data->entry_points_count && SUCCEEDED(hr); i++)
+    {
+        if (!d3d12_state_object_name_map_insert(&data->entry_point_map, data->entry_points[i].mangled_entry_point, i) ||
+                !d3d12_state_object_name_map_insert(&data->entry_point_map, data->entry_points[i].plain_entry_point, i))
+            hr = E_OUTOFMEMORY;
+    }
 
-        data->stages_count++;
+    if (FAILED(hr))
+    {
+        vkd3d_free(local_static_sampler_bindings);
+        return hr;
     }
 
     for (i = 0; i < data->hit_groups_count; i++)
@@ -1270,6 +1657,14 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
         pstage_offset += collection->object->stages_count;
     }
 
+    if (local_static_sampler_bindings_count && data->parent)
+    {
+        /* The pipeline layout would no longer match the one the parent library was compiled with. */
+        FIXME("Local static samplers are not supported in state object additions.\n");
+        vkd3d_free(local_static_sampler_bindings);
+        return E_NOTIMPL;
+    }
+
     if (local_static_sampler_bindings_count)
     {
         if (FAILED(hr = vkd3d_create_descriptor_set_layout(object->device, 0, local_static_sampler_bindings_count,
@@ -1361,8 +1756,32 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
     dynamic_state.dynamicStateCount = 1;
     dynamic_state.pDynamicStates = dynamic_states;
 
-    vr = VK_CALL(vkCreateRayTracingPipelinesKHR(object->device->vk_device, VK_NULL_HANDLE,
-            VK_NULL_HANDLE, 1, &pipeline_create_info, NULL, &object->pipeline));
+    if (object->type == D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE &&
+            (object->flags & D3D12_STATE_OBJECT_FLAG_ALLOW_STATE_OBJECT_ADDITIONS))
+    {
+        /* Compile everything into a library first, so that additions only have to compile their own
+         * shaders and can link against this one. The pipeline itself is a plain link of that library,
+         * which keeps group indices identical to the non-library path. */
+        pipeline_create_info.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+        vr = d3d12_state_object_create_vk_pipeline(object, &pipeline_create_info, &object->pipeline_library);
+        if (vr)
+            return hresult_from_vk_result(vr);
+
+        pipeline_create_info.flags &= ~VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+        pipeline_create_info.pGroups = NULL;
+        pipeline_create_info.groupCount = 0;
+        pipeline_create_info.pStages = NULL;
+        pipeline_create_info.stageCount = 0;
+        library_info.libraryCount = 1;
+        library_info.pLibraries = &object->pipeline_library;
+
+        object->shader_config = *data->shader_config;
+        object->pipeline_config = data->pipeline_config;
+        object->global_root_signature = data->global_root_signature;
+        ID3D12RootSignature_AddRef(object->global_root_signature);
+    }
+
+    vr = d3d12_state_object_create_vk_pipeline(object, &pipeline_create_info, &object->pipeline);
     if (vr)
         return hresult_from_vk_result(vr);
 
@@ -1399,8 +1818,9 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
         }
     }
 
-    /* Always set this, since parent needs to be able to offset pStages[]. */
-    object->stages_count = data->stages_count;
+    /* Always set this, since parent needs to be able to offset pStages[].
+     * Stages of linked libraries are part of our pStages[] index space as well. */
+    object->stages_count = pstage_offset;
 
     /* If parent object can depend on individual shaders, keep the entry point list around. */
     if (object->flags & D3D12_STATE_OBJECT_FLAG_ALLOW_EXTERNAL_DEPENDENCIES_ON_LOCAL_DEFINITIONS)
@@ -1411,12 +1831,13 @@ static HRESULT d3d12_state_object_compile_pipeline(struct d3d12_state_object *ob
         data->entry_points_count = 0;
     }
 
-    return S_OK;
+    return d3d12_state_object_build_export_maps(object);
 }
 
 static HRESULT d3d12_state_object_init(struct d3d12_state_object *object,
         struct d3d12_device *device,
-        const D3D12_STATE_OBJECT_DESC *desc)
+        const D3D12_STATE_OBJECT_DESC *desc,
+        struct d3d12_state_object *parent)
 {
     struct d3d12_state_object_pipeline_data data;
     HRESULT hr = S_OK;
@@ -1426,11 +1847,34 @@ static HRESULT d3d12_state_object_init(struct d3d12_state_object *object,
     object->internal_refcount = 1;
     object->device = device;
     object->type = desc->Type;
+    d3d12_state_object_name_map_init(&object->export_map);
+    d3d12_state_object_name_map_init(&object->entry_point_map);
+
     memset(&data, 0, sizeof(data));
+    d3d12_state_object_name_map_init(&data.entry_point_map);
+    d3d12_state_object_name_map_init(&data.association_map);
+    d3d12_state_object_name_map_init(&data.hit_group_import_map);
+
+    if (parent)
+    {
+        /* Additions inherit the pipeline wide configuration of their parent. */
+        data.parent = parent;
+        data.pipeline_config = parent->pipeline_config;
+        data.has_pipeline_config = true;
+        data.shader_config = &parent->shader_config;
+        data.global_root_signature = parent->global_root_signature;
+    }
 
     if (FAILED(hr = d3d12_state_object_parse_subobjects(object, desc, &data)))
         goto fail;
 
+    if (parent)
+    {
+        object->flags |= parent->flags;
+        /* All of the parent's exports are visible in the addition. */
+        d3d12_state_object_pipeline_data_add_collection(&data, parent, parent->pipeline_library, 0, NULL);
+    }
+
     if (FAILED(hr = d3d12_state_object_compile_pipeline(object, &data)))
         goto fail;
 
@@ -1456,7 +1900,7 @@ HRESULT d3d12_state_object_create(struct d3d12_device *device, const D3D12_STATE
     if (!(object = vkd3d_calloc(1, sizeof(*object))))
         return E_OUTOFMEMORY;
 
-    hr = d3d12_state_object_init(object, device, desc);
+    hr = d3d12_state_object_init(object, device, desc, NULL);
     if (FAILED(hr))
     {
         vkd3d_free(object);
@@ -1466,3 +1910,77 @@ HRESULT d3d12_state_object_create(struct d3d12_device *device, const D3D12_STATE
     *state_object = object;
     return S_OK;
 }
+
+static HRESULT d3d12_state_object_validate_inherited_identifiers(struct d3d12_state_object *object,
+        struct d3d12_state_object *parent)
+{
+    const struct d3d12_state_object_identifier *parent_export;
+    uint32_t index;
+    size_t i;
+
+    /* D3D12 requires identifiers of existing exports to stay valid, and shader tables
+     * built for the parent are reused as is. Vulkan does not guarantee that a group
+     * handle survives linking of the library it came from, so verify it here. */
+    for (i = 0; i < parent->exports_count; i++)
+    {
+        parent_export = &parent->exports[i];
+
+        index = d3d12_state_object_name_map_find(&object->export_map, parent_export->mangled_export);
+        if (index == UINT32_MAX)
+            index = d3d12_state_object_name_map_find(&object->export_map, parent_export->plain_export);
+        if (index == UINT32_MAX)
+            continue;
+
+        if (memcmp(object->exports[index].identifier, parent_export->identifier, sizeof(parent_export->identifier)))
+        {
+            FIXME("Shader identifiers changed when linking the parent library, cannot support AddToStateObject.\n");
+            return E_NOTIMPL;
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT d3d12_state_object_add(struct d3d12_device *device, const D3D12_STATE_OBJECT_DESC *desc,
+        struct d3d12_state_object *parent, struct d3d12_state_object **state_object)
+{
+    struct d3d12_state_object *object;
+    HRESULT hr;
+
+    if (desc->Type != D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE ||
+            parent->type != D3D12_STATE_OBJECT_TYPE_RAYTRACING_PIPELINE)
+    {
+        WARN("Only raytracing pipelines can be extended.\n");
+        return E_INVALIDARG;
+    }
+
+    if (!(parent->flags & D3D12_STATE_OBJECT_FLAG_ALLOW_STATE_OBJECT_ADDITIONS) || !parent->pipeline_library)
+    {
+        WARN("Parent state object was not created with ALLOW_STATE_OBJECT_ADDITIONS.\n");
+        return E_INVALIDARG;
+    }
+
+    if (parent->local_static_sampler.set_layout)
+    {
+        FIXME("Extending state objects which use local static samplers is not supported.\n");
+        return E_NOTIMPL;
+    }
+
+    if (!(object = vkd3d_calloc(1, sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    if (FAILED(hr = d3d12_state_object_init(object, device, desc, parent)))
+    {
+        vkd3d_free(object);
+        return hr;
+    }
+
+    if (FAILED(hr = d3d12_state_object_validate_inherited_identifiers(object, parent)))
+    {
+        d3d12_state_object_release(object);
+        return hr;
+    }
+
+    *state_object = object;
+    return S_OK;
+}
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_private.h"
+
+/* Resident allocations keep the Vulkan default priority. */
+#define VKD3D_RESIDENCY_PRIORITY_RESIDENT 0.5f
+#define VKD3D_RESIDENCY_PRIORITY_EVICTED  0.0f
+
+struct vkd3d_residency_promotion
+{
+    struct d3d12_device *device;
+    struct d3d12_fence *fence;
+    uint64_t fence_value;
+    size_t vk_memory_count;
+    VkDeviceMemory vk_memory[];
+};
+
+HRESULT vkd3d_residency_tracker_init(struct vkd3d_residency_tracker *tracker, struct d3d12_device *device)
+{
+    int rc;
+
+    memset(tracker, 0, sizeof(*tracker));
+
+    if ((rc = pthread_mutex_init(&tracker->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    return S_OK;
+}
+
+void vkd3d_residency_tracker_cleanup(struct vkd3d_residency_tracker *tracker, struct d3d12_device *device)
+{
+    unsigned int i;
+
+    /* Objects restore their priority when destroyed, so nothing should be left. */
+    for (i = 0; i < ARRAY_SIZE(tracker->evicted_size); i++)
+    {
+        if (tracker->evicted_size[i])
+            WARN("%"PRIu64" bytes of evicted memory left in heap %u.\n", tracker->evicted_size[i], i);
+    }
+
+    pthread_mutex_destroy(&tracker->mutex);
+}
+
+static bool vkd3d_residency_get_object(ID3D12Pageable *object,
+        int32_t **residency_count, const struct vkd3d_memory_allocation **allocation)
+{
+    extern CONST_VTBL struct ID3D12Resource2Vtbl d3d12_resource_vtbl;
+    extern CONST_VTBL struct ID3D12Heap1Vtbl d3d12_heap_vtbl;
+    struct d3d12_resource *resource;
+    struct d3d12_heap *heap;
+
+    if (!object)
+        return false;
+
+    if (object->lpVtbl == (const void *)&d3d12_heap_vtbl)
+    {
+        heap = impl_from_ID3D12Heap((ID3D12Heap *)object);
+        *residency_count = &heap->residency_count;
+        *allocation = &heap->allocation;
+        return true;
+    }
+
+    if (object->lpVtbl == (const void *)&d3d12_resource_vtbl)
+    {
+        resource = impl_from_ID3D12Resource((ID3D12Resource *)object);
+
+        /* Placed resources are resident along with their heap, reserved
+         * resources along with the heaps their tiles are mapped to. */
+        if (!(resource->flags & VKD3D_RESOURCE_COMMITTED) || !(resource->flags & VKD3D_RESOURCE_ALLOCATION))
+            return false;
+
+        *residency_count = &resource->residency_count;
+        *allocation = &resource->mem;
+        return true;
+    }
+
+    /* Other pageables, e.g. descriptor heaps or pipeline states, live in memory we never page. */
+    return false;
+}
+
+static bool vkd3d_residency_allocation_is_pageable(const struct vkd3d_memory_allocation *allocation)
+{
+    /* Suballocations share their VkDeviceMemory with unrelated objects. */
+    return allocation->device_allocation.vk_memory && !allocation->chunk && !allocation->slab;
+}
+
+static uint32_t vkd3d_residency_get_heap_index(struct d3d12_device *device,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    return device->memory_properties.memoryTypes[allocation->device_allocation.vk_memory_type].heapIndex;
+}
+
+static void vkd3d_residency_set_priority(struct d3d12_device *device, VkDeviceMemory vk_memory, float priority)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    /* Without pageable memory, priorities are fixed at allocation time and
+     * eviction only affects the bookkeeping. */
+    if (device->device_info.pageable_device_local_memory_features.pageableDeviceLocalMemory)
+        VK_CALL(vkSetDeviceMemoryPriorityEXT(device->vk_device, vk_memory, priority));
+}
+
+static bool vkd3d_residency_query_budget(struct d3d12_device *device,
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT *budget)
+{
+    const struct vkd3d_vk_instance_procs *vk_procs = &device->vkd3d_instance->vk_procs;
+    VkPhysicalDeviceMemoryProperties2 properties;
+
+    if (!device->vk_info.EXT_memory_budget)
+        return false;
+
+    memset(budget, 0, sizeof(*budget));
+    budget->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties.pNext = budget;
+
+    VK_CALL(vkGetPhysicalDeviceMemoryProperties2(device->vk_physical_device, &properties));
+    return true;
+}
+
+static bool vkd3d_residency_check_budget_locked(struct d3d12_device *device, UINT object_count,
+        ID3D12Pageable * const *objects, bool deny_overbudget)
+{
+    VkDeviceSize promote_size[VK_MAX_MEMORY_HEAPS] = { 0 };
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget;
+    const struct vkd3d_memory_allocation *allocation;
+    int32_t *residency_count;
+    bool within_budget;
+    uint32_t i;
+
+    for (i = 0; i < object_count; i++)
+    {
+        if (vkd3d_residency_get_object(objects[i], &residency_count, &allocation) &&
+                *residency_count <= 0 && vkd3d_residency_allocation_is_pageable(allocation))
+            promote_size[vkd3d_residency_get_heap_index(device, allocation)] += allocation->device_allocation.size;
+    }
+
+    if (!vkd3d_residency_query_budget(device, &budget))
+        return true;
+
+    within_budget = true;
+
+    for (i = 0; i < device->memory_properties.memoryHeapCount; i++)
+    {
+        if (!promote_size[i] || budget.heapUsage[i] + promote_size[i] <= budget.heapBudget[i])
+            continue;
+
+        if (deny_overbudget || (vkd3d_config_flags & VKD3D_CONFIG_FLAG_LOG_MEMORY_BUDGET))
+        {
+            INFO("Making %"PRIu64" KiB resident in heap %u exceeds budget, usage %"PRIu64" MiB, budget %"PRIu64" MiB.\n",
+                    promote_size[i] / 1024, i, budget.heapUsage[i] / (1024 * 1024), budget.heapBudget[i] / (1024 * 1024));
+        }
+
+        within_budget = false;
+    }
+
+    return within_budget;
+}
+
+static void vkd3d_residency_promotion_apply(const struct vkd3d_residency_promotion *promotion)
+{
+    size_t i;
+
+    for (i = 0; i < promotion->vk_memory_count; i++)
+        vkd3d_residency_set_priority(promotion->device, promotion->vk_memory[i], VKD3D_RESIDENCY_PRIORITY_RESIDENT);
+}
+
+static void vkd3d_residency_promote_main(void *userdata)
+{
+    struct vkd3d_residency_promotion *promotion = userdata;
+    struct d3d12_device *device = promotion->device;
+
+    vkd3d_residency_promotion_apply(promotion);
+
+    /* Destroyed objects wait for this, so all memory is still valid up to here. */
+    vkd3d_atomic_uint32_decrement(&device->residency_tracker.enqueue_count, vkd3d_memory_order_release);
+
+    if (promotion->fence)
+    {
+        d3d12_fence_signal_cpu_timeline_semaphore(promotion->fence, promotion->fence_value);
+        d3d12_fence_dec_ref(promotion->fence);
+    }
+
+    vkd3d_free(promotion);
+}
+
+static void vkd3d_residency_wait_enqueued(struct d3d12_device *device)
+{
+    struct vkd3d_residency_tracker *tracker = &device->residency_tracker;
+
+    if (vkd3d_atomic_uint32_load_explicit(&tracker->enqueue_count, vkd3d_memory_order_acquire))
+        vkd3d_task_pool_wait(&device->task_pool, &tracker->enqueue_group);
+}
+
+HRESULT vkd3d_residency_make_resident(struct d3d12_device *device, UINT object_count,
+        ID3D12Pageable * const *objects, D3D12_RESIDENCY_FLAGS flags, struct d3d12_fence *fence, uint64_t fence_value)
+{
+    struct vkd3d_residency_tracker *tracker = &device->residency_tracker;
+    const struct vkd3d_memory_allocation *allocation;
+    struct vkd3d_residency_promotion *promotion;
+    int32_t *residency_count;
+    uint32_t heap_index, i;
+
+    if (!(promotion = vkd3d_malloc(offsetof(struct vkd3d_residency_promotion, vk_memory[object_count]))))
+        return E_OUTOFMEMORY;
+
+    promotion->device = device;
+    promotion->fence = fence;
+    promotion->fence_value = fence_value;
+    promotion->vk_memory_count = 0;
+
+    pthread_mutex_lock(&tracker->mutex);
+
+    if (!vkd3d_residency_check_budget_locked(device, object_count, objects,
+            !!(flags & D3D12_RESIDENCY_FLAG_DENY_OVERBUDGET)) && (flags & D3D12_RESIDENCY_FLAG_DENY_OVERBUDGET))
+    {
+        pthread_mutex_unlock(&tracker->mutex);
+        vkd3d_free(promotion);
+        return E_OUTOFMEMORY;
+    }
+
+    for (i = 0; i < object_count; i++)
+    {
+        if (!vkd3d_residency_get_object(objects[i], &residency_count, &allocation))
+        {
+            TRACE("Ignoring object %p.\n", objects[i]);
+            continue;
+        }
+
+        if ((*residency_count)++ > 0 || !vkd3d_residency_allocation_is_pageable(allocation))
+            continue;
+
+        heap_index = vkd3d_residency_get_heap_index(device, allocation);
+        assert(tracker->evicted_size[heap_index] >= allocation->device_allocation.size);
+        tracker->evicted_size[heap_index] -= allocation->device_allocation.size;
+        promotion->vk_memory[promotion->vk_memory_count++] = allocation->device_allocation.vk_memory;
+    }
+
+    pthread_mutex_unlock(&tracker->mutex);
+
+    if (!fence)
+    {
+        vkd3d_residency_promotion_apply(promotion);
+        vkd3d_free(promotion);
+        return S_OK;
+    }
+
+    /* Raising priorities can be slow since drivers may migrate memory right away,
+     * so EnqueueMakeResident leaves it to a worker which then signals the fence.
+     * The Evict and destruction paths wait for the worker, which keeps priority
+     * updates in order and all memory alive while it is being promoted. */
+    d3d12_fence_inc_ref(fence);
+    vkd3d_atomic_uint32_increment(&tracker->enqueue_count, vkd3d_memory_order_relaxed);
+    vkd3d_task_pool_submit(&device->task_pool, VKD3D_TASK_TYPE_RESIDENCY, VKD3D_TASK_PRIORITY_HIGH,
+            &tracker->enqueue_group, vkd3d_residency_promote_main, promotion);
+    return S_OK;
+}
+
+void vkd3d_residency_evict(struct d3d12_device *device, UINT object_count, ID3D12Pageable * const *objects)
+{
+    struct vkd3d_residency_tracker *tracker = &device->residency_tracker;
+    const struct vkd3d_memory_allocation *allocation;
+    int32_t *residency_count;
+    uint32_t i;
+
+    vkd3d_residency_wait_enqueued(device);
+
+    pthread_mutex_lock(&tracker->mutex);
+
+    for (i = 0; i < object_count; i++)
+    {
+        if (!vkd3d_residency_get_object(objects[i], &residency_count, &allocation))
+        {
+            TRACE("Ignoring object %p.\n", objects[i]);
+            continue;
+        }
+
+        if (*residency_count <= 0)
+        {
+            WARN("Object %p is already evicted.\n", objects[i]);
+            continue;
+        }
+
+        if (--(*residency_count) || !vkd3d_residency_allocation_is_pageable(allocation))
+            continue;
+
+        tracker->evicted_size[vkd3d_residency_get_heap_index(device, allocation)] += allocation->device_allocation.size;
+        vkd3d_residency_set_priority(device, allocation->device_allocation.vk_memory, VKD3D_RESIDENCY_PRIORITY_EVICTED);
+    }
+
+    pthread_mutex_unlock(&tracker->mutex);
+}
+
+void vkd3d_residency_release_allocation(struct d3d12_device *device, int32_t residency_count,
+        const struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_residency_tracker *tracker = &device->residency_tracker;
+
+    vkd3d_residency_wait_enqueued(device);
+
+    if (residency_count > 0 || !vkd3d_residency_allocation_is_pageable(allocation))
+        return;
+
+    pthread_mutex_lock(&tracker->mutex);
+    tracker->evicted_size[vkd3d_residency_get_heap_index(device, allocation)] -= allocation->device_allocation.size;
+    pthread_mutex_unlock(&tracker->mutex);
+
+    /* Recycled memory is handed out again, so it must not stay demoted. */
+    vkd3d_residency_set_priority(device, allocation->device_allocation.vk_memory, VKD3D_RESIDENCY_PRIORITY_RESIDENT);
+}
@@ -20,6 +20,11 @@
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
 
 #include <float.h>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "vkd3d_private.h"
 #include "vkd3d_rw_spinlock.h"
@@ -177,10 +182,10 @@ HRESULT vkd3d_create_buffer(struct d3d12_device *device,
         return E_INVALIDARG;
     }
 
-    if (device->queue_family_count > 1)
+    if (device->buffer_queue_family_count > 1)
     {
         buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
-        buffer_info.queueFamilyIndexCount = device->queue_family_count;
+        buffer_info.queueFamilyIndexCount = device->buffer_queue_family_count;
         buffer_info.pQueueFamilyIndices = device->queue_family_indices;
     }
     else
@@ -720,6 +725,103 @@ static HRESULT vkd3d_create_image(struct d3d12_device *device,
     return hresult_from_vk_result(vr);
 }
 
+/* The cache only grows, so put a bound on the number of distinct descriptions. */
+#define VKD3D_MEMORY_REQUIREMENTS_CACHE_MAX_ENTRIES 4096
+
+struct vkd3d_memory_requirements_entry
+{
+    struct hash_map_entry entry;
+    D3D12_RESOURCE_DESC1 desc;
+    VkMemoryRequirements requirements;
+};
+
+static uint32_t vkd3d_memory_requirements_entry_hash(const void *key)
+{
+    const D3D12_RESOURCE_DESC1 *desc = key;
+    uint64_t hash;
+
+    hash = hash_fnv1_init();
+    hash = hash_fnv1_iterate_u32(hash, desc->Dimension);
+    hash = hash_fnv1_iterate_u64(hash, desc->Width);
+    hash = hash_fnv1_iterate_u32(hash, desc->Height);
+    hash = hash_fnv1_iterate_u32(hash, desc->DepthOrArraySize);
+    hash = hash_fnv1_iterate_u32(hash, desc->MipLevels);
+    hash = hash_fnv1_iterate_u32(hash, desc->Format);
+    hash = hash_fnv1_iterate_u32(hash, desc->SampleDesc.Count);
+    hash = hash_fnv1_iterate_u32(hash, desc->SampleDesc.Quality);
+    hash = hash_fnv1_iterate_u32(hash, desc->Layout);
+    hash = hash_fnv1_iterate_u32(hash, desc->Flags);
+    hash = hash_fnv1_iterate_u32(hash, desc->SamplerFeedbackMipRegion.Width);
+    hash = hash_fnv1_iterate_u32(hash, desc->SamplerFeedbackMipRegion.Height);
+    hash = hash_fnv1_iterate_u32(hash, desc->SamplerFeedbackMipRegion.Depth);
+    return hash_uint64(hash);
+}
+
+static bool d3d12_resource_desc_equal_ignore_alignment(const D3D12_RESOURCE_DESC1 *a, const D3D12_RESOURCE_DESC1 *b)
+{
+    return a->Dimension == b->Dimension &&
+            a->Width == b->Width &&
+            a->Height == b->Height &&
+            a->DepthOrArraySize == b->DepthOrArraySize &&
+            a->MipLevels == b->MipLevels &&
+            a->Format == b->Format &&
+            a->SampleDesc.Count == b->SampleDesc.Count &&
+            a->SampleDesc.Quality == b->SampleDesc.Quality &&
+            a->Layout == b->Layout &&
+            a->Flags == b->Flags &&
+            a->SamplerFeedbackMipRegion.Width == b->SamplerFeedbackMipRegion.Width &&
+            a->SamplerFeedbackMipRegion.Height == b->SamplerFeedbackMipRegion.Height &&
+            a->SamplerFeedbackMipRegion.Depth == b->SamplerFeedbackMipRegion.Depth;
+}
+
+static bool vkd3d_memory_requirements_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_memory_requirements_entry *e = (const struct vkd3d_memory_requirements_entry *)entry;
+
+    /* Alignment is deliberately ignored, it does not affect the image we create. */
+    return d3d12_resource_desc_equal_ignore_alignment(key, &e->desc);
+}
+
+void vkd3d_memory_requirements_cache_init(struct vkd3d_memory_requirements_cache *cache)
+{
+    cache->spinlock = 0;
+    hash_map_init(&cache->map, &vkd3d_memory_requirements_entry_hash,
+            &vkd3d_memory_requirements_entry_compare, sizeof(struct vkd3d_memory_requirements_entry));
+}
+
+void vkd3d_memory_requirements_cache_cleanup(struct vkd3d_memory_requirements_cache *cache)
+{
+    hash_map_clear(&cache->map);
+}
+
+static bool vkd3d_memory_requirements_cache_find(struct vkd3d_memory_requirements_cache *cache,
+        const D3D12_RESOURCE_DESC1 *desc, VkMemoryRequirements *requirements)
+{
+    const struct vkd3d_memory_requirements_entry *e;
+
+    spinlock_acquire(&cache->spinlock);
+    if ((e = (const struct vkd3d_memory_requirements_entry *)hash_map_find(&cache->map, desc)))
+        *requirements = e->requirements;
+    spinlock_release(&cache->spinlock);
+
+    return !!e;
+}
+
+static void vkd3d_memory_requirements_cache_insert(struct vkd3d_memory_requirements_cache *cache,
+        const D3D12_RESOURCE_DESC1 *desc, const VkMemoryRequirements *requirements)
+{
+    struct vkd3d_memory_requirements_entry entry;
+
+    entry.desc = *desc;
+    entry.requirements = *requirements;
+
+    spinlock_acquire(&cache->spinlock);
+    /* If another thread raced us, the existing entry is identical anyway. */
+    if (cache->map.used_count < VKD3D_MEMORY_REQUIREMENTS_CACHE_MAX_ENTRIES)
+        hash_map_insert(&cache->map, desc, &entry.entry);
+    spinlock_release(&cache->spinlock);
+}
+
 HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC1 *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info)
 {
@@ -741,12 +843,17 @@ HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         desc = &validated_desc;
     }
 
-    /* XXX: We have to create an image to get its memory requirements. */
-    if (FAILED(hr = vkd3d_create_image(device, &heap_properties, 0, desc, NULL, &vk_image)))
-        return hr;
+    if (!vkd3d_memory_requirements_cache_find(&device->memory_requirements_cache, desc, &requirements))
+    {
+        /* XXX: We have to create an image to get its memory requirements. */
+        if (FAILED(hr = vkd3d_create_image(device, &heap_properties, 0, desc, NULL, &vk_image)))
+            return hr;
+
+        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, &requirements));
+        VK_CALL(vkDestroyImage(device->vk_device, vk_image, NULL));
 
-    VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, &requirements));
-    VK_CALL(vkDestroyImage(device->vk_device, vk_image, NULL));
+        vkd3d_memory_requirements_cache_insert(&device->memory_requirements_cache, desc, &requirements);
+    }
 
     allocation_info->SizeInBytes = requirements.size;
     allocation_info->Alignment = requirements.alignment;
@@ -762,7 +869,7 @@ HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         allocation_info->Alignment = target_alignment;
     }
 
-    return hr;
+    return S_OK;
 }
 
 struct vkd3d_view_entry
@@ -888,28 +995,83 @@ static bool vkd3d_view_entry_compare(const void *key, const struct hash_map_entr
     }
 }
 
+static void vkd3d_view_map_shard_init(struct vkd3d_view_map_shard *shard)
+{
+    shard->spinlock = 0;
+    hash_map_init(&shard->map, &vkd3d_view_entry_hash, &vkd3d_view_entry_compare, sizeof(struct vkd3d_view_entry));
+}
+
 HRESULT vkd3d_view_map_init(struct vkd3d_view_map *view_map)
 {
-    view_map->spinlock = 0;
-    hash_map_init(&view_map->map, &vkd3d_view_entry_hash, &vkd3d_view_entry_compare, sizeof(struct vkd3d_view_entry));
+    view_map->shards = NULL;
+    view_map->shard_mask = 0;
+    vkd3d_view_map_shard_init(&view_map->shard);
+    return S_OK;
+}
+
+HRESULT vkd3d_view_map_init_sharded(struct vkd3d_view_map *view_map, uint32_t shard_count)
+{
+    uint32_t i;
+
+    assert(shard_count && !(shard_count & (shard_count - 1)));
+
+    vkd3d_view_map_init(view_map);
+
+    if (shard_count == 1)
+        return S_OK;
+
+    if (!(view_map->shards = vkd3d_malloc_aligned(shard_count * sizeof(*view_map->shards), 64)))
+        return E_OUTOFMEMORY;
+
+    for (i = 0; i < shard_count; i++)
+        vkd3d_view_map_shard_init(&view_map->shards[i].shard);
+    view_map->shard_mask = shard_count - 1;
     return S_OK;
 }
 
+static inline struct vkd3d_view_map_shard *vkd3d_view_map_get_shard(struct vkd3d_view_map *view_map,
+        const struct vkd3d_view_key *key)
+{
+    if (!view_map->shards)
+        return &view_map->shard;
+
+    /* The hash map itself indexes with the hash modulo its size, so use the upper bits here
+     * to keep shard selection and bucket selection reasonably independent. */
+    return &view_map->shards[(vkd3d_view_entry_hash(key) >> 16) & view_map->shard_mask].shard;
+}
+
 static void vkd3d_view_destroy(struct vkd3d_view *view, struct d3d12_device *device);
 
-void vkd3d_view_map_destroy(struct vkd3d_view_map *view_map, struct d3d12_device *device)
+static void vkd3d_view_map_shard_destroy(struct vkd3d_view_map_shard *shard, struct d3d12_device *device)
 {
     uint32_t i;
 
-    for (i = 0; i < view_map->map.entry_count; i++)
+    for (i = 0; i < shard->map.entry_count; i++)
     {
-        struct vkd3d_view_entry *e = (struct vkd3d_view_entry *)hash_map_get_entry(&view_map->map, i);
+        struct vkd3d_view_entry *e = (struct vkd3d_view_entry *)hash_map_get_entry(&shard->map, i);
 
         if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
             vkd3d_view_destroy(e->view, device);
     }
 
-    hash_map_clear(&view_map->map);
+    hash_map_clear(&shard->map);
+}
+
+void vkd3d_view_map_destroy(struct vkd3d_view_map *view_map, struct d3d12_device *device)
+{
+    uint32_t i;
+
+    vkd3d_view_map_shard_destroy(&view_map->shard, device);
+
+    if (view_map->shards)
+    {
+        for (i = 0; i <= view_map->shard_mask; i++)
+            vkd3d_view_map_shard_destroy(&view_map->shards[i].shard, device);
+
+        vkd3d_free_aligned(view_map->shards);
+        view_map->shards = NULL;
+        view_map->shard_mask = 0;
+    }
 }
 
 static struct vkd3d_view *vkd3d_view_create(enum vkd3d_view_type type);
@@ -917,26 +1079,77 @@ static struct vkd3d_view *vkd3d_view_create(enum vkd3d_view_type type);
 static HRESULT d3d12_create_sampler(struct d3d12_device *device,
         const D3D12_SAMPLER_DESC *desc, VkSampler *vk_sampler);
 
+/* LOD is snapped to mipmapPrecisionBits fractional bits by the device, so anything
+ * finer than that cannot be observed. Applications which animate LOD bias or min LOD
+ * clamp for dynamic resolution or texture streaming would otherwise create a new
+ * sampler or image view for every distinct float they pass in. */
+static inline float vkd3d_quantize_lod(float lod, float scale)
+{
+    /* Pass through huge values such as D3D12_FLOAT32_MAX, as well as NaN. */
+    if (!(fabsf(lod) < 256.0f))
+        return lod;
+
+    return floorf(lod * scale + 0.5f) / scale;
+}
+
+static const struct vkd3d_view_key *vkd3d_view_key_normalize(struct d3d12_device *device,
+        const struct vkd3d_view_key *key, struct vkd3d_view_key *normalized_key)
+{
+    uint32_t precision_bits;
+    float scale;
+
+    /* Quantizing finer than the device is always safe, so clamp the reported
+     * precision to the guaranteed minimum. The upper bound keeps the scaled
+     * value exact in single precision. */
+    precision_bits = device->vk_info.device_limits.mipmapPrecisionBits;
+    precision_bits = max(precision_bits, 4u);
+    precision_bits = min(precision_bits, 16u);
+    scale = (float)(1u << precision_bits);
+
+    switch (key->view_type)
+    {
+        case VKD3D_VIEW_TYPE_IMAGE:
+            *normalized_key = *key;
+            normalized_key->u.texture.miplevel_clamp = vkd3d_quantize_lod(key->u.texture.miplevel_clamp, scale);
+            return normalized_key;
+
+        case VKD3D_VIEW_TYPE_SAMPLER:
+            *normalized_key = *key;
+            normalized_key->u.sampler.MipLODBias = vkd3d_quantize_lod(key->u.sampler.MipLODBias, scale);
+            normalized_key->u.sampler.MinLOD = vkd3d_quantize_lod(key->u.sampler.MinLOD, scale);
+            normalized_key->u.sampler.MaxLOD = vkd3d_quantize_lod(key->u.sampler.MaxLOD, scale);
+            return normalized_key;
+
+        default:
+            return key;
+    }
+}
+
 struct vkd3d_view *vkd3d_view_map_create_view(struct vkd3d_view_map *view_map,
         struct d3d12_device *device, const struct vkd3d_view_key *key)
 {
+    struct vkd3d_view_key normalized_key;
+    struct vkd3d_view_map_shard *shard;
     struct vkd3d_view_entry entry, *e;
     struct vkd3d_view *redundant_view;
     struct vkd3d_view *view;
     bool success;
 
+    key = vkd3d_view_key_normalize(device, key, &normalized_key);
+    shard = vkd3d_view_map_get_shard(view_map, key);
+
     /* In the steady state, we will be reading existing entries from a view map.
      * Prefer read-write spinlocks here to reduce contention as much as possible. */
-    rw_spinlock_acquire_read(&view_map->spinlock);
+    rw_spinlock_acquire_read(&shard->spinlock);
 
-    if ((e = (struct vkd3d_view_entry *)hash_map_find(&view_map->map, key)))
+    if ((e = (struct vkd3d_view_entry *)hash_map_find(&shard->map, key)))
     {
         view = e->view;
-        rw_spinlock_release_read(&view_map->spinlock);
+        rw_spinlock_release_read(&shard->spinlock);
         return view;
     }
 
-    rw_spinlock_release_read(&view_map->spinlock);
+    rw_spinlock_release_read(&shard->spinlock);
 
     switch (key->view_type)
     {
@@ -972,9 +1185,9 @@ struct vkd3d_view *vkd3d_view_map_create_view(struct vkd3d_view_map *view_map,
     entry.key = *key;
     entry.view = view;
 
-    rw_spinlock_acquire_write(&view_map->spinlock);
+    rw_spinlock_acquire_write(&shard->spinlock);
 
-    if (!(e = (struct vkd3d_view_entry *)hash_map_insert(&view_map->map, key, &entry.entry)))
+    if (!(e = (struct vkd3d_view_entry *)hash_map_insert(&shard->map, key, &entry.entry)))
         ERR("Failed to insert view into hash map.\n");
 
     if (e->view != view)
@@ -983,18 +1196,18 @@ struct vkd3d_view *vkd3d_view_map_create_view(struct vkd3d_view_map *view_map,
          * This can happen between releasing reader lock, and acquiring writer lock. */
         redundant_view = view;
         view = e->view;
-        rw_spinlock_release_write(&view_map->spinlock);
+        rw_spinlock_release_write(&shard->spinlock);
         vkd3d_view_decref(redundant_view, device);
     }
     else
     {
         /* If we start emitting too many typed SRVs, we will eventually crash on NV, since
          * VkBufferView objects appear to consume GPU resources. */
-        if ((view_map->map.used_count % 1024) == 0)
-            ERR("Intense view map pressure! Got %u views in hash map %p.\n", view_map->map.used_count, &view_map->map);
+        if ((shard->map.used_count % 1024) == 0)
+            ERR("Intense view map pressure! Got %u views in hash map %p.\n", shard->map.used_count, &shard->map);
 
         view = e->view;
-        rw_spinlock_release_write(&view_map->spinlock);
+        rw_spinlock_release_write(&shard->spinlock);
     }
 
     return view;
@@ -1047,6 +1260,55 @@ static bool vkd3d_sampler_entry_compare(const void *key, const struct hash_map_e
             k->desc.MaxLOD == e->desc.MaxLOD;
 }
 
+struct vkd3d_static_sampler_set_key
+{
+    uint32_t binding_count;
+    const VkDescriptorSetLayoutBinding *bindings;
+};
+
+struct vkd3d_static_sampler_set_entry
+{
+    struct hash_map_entry entry;
+    struct vkd3d_static_sampler_set *set;
+};
+
+static uint32_t vkd3d_static_sampler_set_entry_hash(const void *key)
+{
+    const struct vkd3d_static_sampler_set_key *k = key;
+    uint32_t hash, i;
+
+    hash = k->binding_count;
+
+    for (i = 0; i < k->binding_count; i++)
+    {
+        hash = hash_combine(hash, k->bindings[i].binding);
+        hash = hash_combine(hash, k->bindings[i].stageFlags);
+        hash = hash_combine(hash, hash_uint64((uint64_t)k->bindings[i].pImmutableSamplers[0]));
+    }
+
+    return hash;
+}
+
+static bool vkd3d_static_sampler_set_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_static_sampler_set_entry *e = (const struct vkd3d_static_sampler_set_entry *)entry;
+    const struct vkd3d_static_sampler_set_key *k = key;
+    uint32_t i;
+
+    if (k->binding_count != e->set->binding_count)
+        return false;
+
+    for (i = 0; i < k->binding_count; i++)
+    {
+        if (k->bindings[i].binding != e->set->bindings[i].binding ||
+                k->bindings[i].stageFlags != e->set->bindings[i].stageFlags ||
+                k->bindings[i].pImmutableSamplers[0] != e->set->vk_samplers[i])
+            return false;
+    }
+
+    return true;
+}
+
 HRESULT vkd3d_sampler_state_init(struct vkd3d_sampler_state *state,
         struct d3d12_device *device)
 {
@@ -1058,6 +1320,8 @@ HRESULT vkd3d_sampler_state_init(struct vkd3d_sampler_state *state,
         return hresult_from_errno(rc);
 
     hash_map_init(&state->map, &vkd3d_sampler_entry_hash, &vkd3d_sampler_entry_compare, sizeof(struct vkd3d_sampler_entry));
+    hash_map_init(&state->set_map, &vkd3d_static_sampler_set_entry_hash,
+            &vkd3d_static_sampler_set_entry_compare, sizeof(struct vkd3d_static_sampler_set_entry));
     return S_OK;
 }
 
@@ -1082,6 +1346,21 @@ void vkd3d_sampler_state_cleanup(struct vkd3d_sampler_state *state,
 
     hash_map_clear(&state->map);
 
+    /* Sets are owned by root signatures, so anything left here was leaked by the application.
+     * The descriptor sets themselves go away with the pools. */
+    for (i = 0; i < state->set_map.entry_count; i++)
+    {
+        struct vkd3d_static_sampler_set_entry *e = (struct vkd3d_static_sampler_set_entry *)hash_map_get_entry(&state->set_map, i);
+
+        if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
+        {
+            VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, e->set->vk_set_layout, NULL));
+            vkd3d_free(e->set);
+        }
+    }
+
+    hash_map_clear(&state->set_map);
+
     pthread_mutex_destroy(&state->mutex);
 }
 
@@ -1143,7 +1422,7 @@ static VkResult vkd3d_sampler_state_create_descriptor_pool(struct d3d12_device *
     return VK_CALL(vkCreateDescriptorPool(device->vk_device, &pool_info, NULL, vk_pool));
 }
 
-HRESULT vkd3d_sampler_state_allocate_descriptor_set(struct vkd3d_sampler_state *state,
+static HRESULT vkd3d_sampler_state_allocate_descriptor_set_locked(struct vkd3d_sampler_state *state,
         struct d3d12_device *device, VkDescriptorSetLayout vk_layout, VkDescriptorSet *vk_set,
         VkDescriptorPool *vk_pool)
 {
@@ -1151,13 +1430,6 @@ HRESULT vkd3d_sampler_state_allocate_descriptor_set(struct vkd3d_sampler_state *
     VkResult vr = VK_ERROR_OUT_OF_POOL_MEMORY;
     VkDescriptorSetAllocateInfo alloc_info;
     size_t i;
-    int rc;
-
-    if ((rc = pthread_mutex_lock(&state->mutex)))
-    {
-        ERR("Failed to lock mutex, rc %d.\n", rc);
-        return hresult_from_errno(rc);
-    }
 
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     alloc_info.pNext = NULL;
@@ -1181,16 +1453,12 @@ HRESULT vkd3d_sampler_state_allocate_descriptor_set(struct vkd3d_sampler_state *
         vr = vkd3d_sampler_state_create_descriptor_pool(device, &alloc_info.descriptorPool);
 
         if (vr != VK_SUCCESS)
-        {
-            pthread_mutex_unlock(&state->mutex);
             return hresult_from_vk_result(vr);
-        }
 
         if (!vkd3d_array_reserve((void **)&state->vk_descriptor_pools, &state->vk_descriptor_pools_size,
                 state->vk_descriptor_pool_count + 1, sizeof(*state->vk_descriptor_pools)))
         {
             VK_CALL(vkDestroyDescriptorPool(device->vk_device, alloc_info.descriptorPool, NULL));
-            pthread_mutex_unlock(&state->mutex);
             return E_OUTOFMEMORY;
         }
 
@@ -1199,10 +1467,27 @@ HRESULT vkd3d_sampler_state_allocate_descriptor_set(struct vkd3d_sampler_state *
         *vk_pool = alloc_info.descriptorPool;
     }
 
-    pthread_mutex_unlock(&state->mutex);
     return hresult_from_vk_result(vr);
 }
 
+HRESULT vkd3d_sampler_state_allocate_descriptor_set(struct vkd3d_sampler_state *state,
+        struct d3d12_device *device, VkDescriptorSetLayout vk_layout, VkDescriptorSet *vk_set,
+        VkDescriptorPool *vk_pool)
+{
+    HRESULT hr;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&state->mutex)))
+    {
+        ERR("Failed to lock mutex, rc %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    hr = vkd3d_sampler_state_allocate_descriptor_set_locked(state, device, vk_layout, vk_set, vk_pool);
+    pthread_mutex_unlock(&state->mutex);
+    return hr;
+}
+
 void vkd3d_sampler_state_free_descriptor_set(struct vkd3d_sampler_state *state,
         struct d3d12_device *device, VkDescriptorSet vk_set, VkDescriptorPool vk_pool)
 {
@@ -1217,6 +1502,126 @@ void vkd3d_sampler_state_free_descriptor_set(struct vkd3d_sampler_state *state,
     pthread_mutex_unlock(&state->mutex);
 }
 
+HRESULT vkd3d_sampler_state_acquire_static_sampler_set(struct vkd3d_sampler_state *state,
+        struct d3d12_device *device, uint32_t binding_count, const VkDescriptorSetLayoutBinding *bindings,
+        struct vkd3d_static_sampler_set **sampler_set)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_static_sampler_set_entry entry, *e;
+    struct vkd3d_static_sampler_set_key key;
+    struct vkd3d_static_sampler_set *set;
+    uint32_t i;
+    HRESULT hr;
+    int rc;
+
+    key.binding_count = binding_count;
+    key.bindings = bindings;
+
+    if ((rc = pthread_mutex_lock(&state->mutex)))
+    {
+        ERR("Failed to lock mutex, rc %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    /* Root signatures commonly differ only in their tables and root parameters,
+     * while declaring the same set of static samplers. Since the set is immutable,
+     * one layout and descriptor set can serve all of them. */
+    if ((e = (struct vkd3d_static_sampler_set_entry *)hash_map_find(&state->set_map, &key)))
+    {
+        e->set->refcount++;
+        *sampler_set = e->set;
+        pthread_mutex_unlock(&state->mutex);
+        return S_OK;
+    }
+
+    if (!(set = vkd3d_malloc(sizeof(*set) + binding_count * (sizeof(*set->bindings) + sizeof(*set->vk_samplers)))))
+    {
+        pthread_mutex_unlock(&state->mutex);
+        return E_OUTOFMEMORY;
+    }
+
+    memset(set, 0, sizeof(*set));
+    set->refcount = 1;
+    set->binding_count = binding_count;
+    set->bindings = (VkDescriptorSetLayoutBinding *)(set + 1);
+    set->vk_samplers = (VkSampler *)(set->bindings + binding_count);
+
+    for (i = 0; i < binding_count; i++)
+    {
+        set->bindings[i] = bindings[i];
+        set->vk_samplers[i] = bindings[i].pImmutableSamplers[0];
+        set->bindings[i].pImmutableSamplers = &set->vk_samplers[i];
+    }
+
+    if (FAILED(hr = vkd3d_create_descriptor_set_layout(device, 0,
+            binding_count, set->bindings, &set->vk_set_layout)))
+        goto fail;
+
+    if (FAILED(hr = vkd3d_sampler_state_allocate_descriptor_set_locked(state, device,
+            set->vk_set_layout, &set->vk_set, &set->vk_pool)))
+        goto fail_layout;
+
+    entry.set = set;
+
+    if (!hash_map_insert(&state->set_map, &key, &entry.entry))
+    {
+        ERR("Failed to insert static sampler set into hash map.\n");
+        hr = E_OUTOFMEMORY;
+        goto fail_set;
+    }
+
+    TRACE("Created static sampler set %p with %u samplers.\n", set, binding_count);
+
+    *sampler_set = set;
+    pthread_mutex_unlock(&state->mutex);
+    return S_OK;
+
+fail_set:
+    VK_CALL(vkFreeDescriptorSets(device->vk_device, set->vk_pool, 1, &set->vk_set));
+fail_layout:
+    VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, set->vk_set_layout, NULL));
+fail:
+    pthread_mutex_unlock(&state->mutex);
+    vkd3d_free(set);
+    return hr;
+}
+
+void vkd3d_sampler_state_release_static_sampler_set(struct vkd3d_sampler_state *state,
+        struct d3d12_device *device, struct vkd3d_static_sampler_set *set)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_static_sampler_set_key key;
+    struct hash_map_entry *e;
+    int rc;
+
+    if (!set)
+        return;
+
+    if ((rc = pthread_mutex_lock(&state->mutex)))
+    {
+        ERR("Failed to lock mutex, rc %d.\n", rc);
+        return;
+    }
+
+    if (--set->refcount)
+    {
+        pthread_mutex_unlock(&state->mutex);
+        return;
+    }
+
+    key.binding_count = set->binding_count;
+    key.bindings = set->bindings;
+
+    if ((e = hash_map_find(&state->set_map, &key)))
+        hash_map_remove(&state->set_map, e);
+
+    VK_CALL(vkFreeDescriptorSets(device->vk_device, set->vk_pool, 1, &set->vk_set));
+    VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, set->vk_set_layout, NULL));
+    pthread_mutex_unlock(&state->mutex);
+
+    vkd3d_free(set);
+}
+
 static void d3d12_resource_get_tiling(struct d3d12_device *device, struct d3d12_resource *resource,
         UINT *total_tile_count, D3D12_PACKED_MIP_INFO *packed_mip_info, D3D12_TILE_SHAPE *tile_shape,
         D3D12_SUBRESOURCE_TILING *tilings, VkSparseImageMemoryRequirements *vk_info)
@@ -1561,13 +1966,26 @@ static void d3d12_resource_invalidate_range(struct d3d12_resource *resource,
 static void d3d12_resource_flush_range(struct d3d12_resource *resource,
         UINT subresource, const D3D12_RANGE *written_range)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &resource->device->vk_procs;
     VkMappedMemoryRange mapped_range;
 
     if (!d3d12_resource_get_mapped_memory_range(resource, subresource, written_range, &mapped_range))
         return;
 
-    VK_CALL(vkFlushMappedMemoryRanges(resource->device->vk_device, 1, &mapped_range));
+    /* Writes only need to be visible to work submitted after Unmap */
+    vkd3d_memory_info_queue_flush(&resource->device->memory_info, &mapped_range);
+}
+
+static void d3d12_resource_init_coherent_map(struct d3d12_resource *resource, struct d3d12_device *device)
+{
+    VkMemoryPropertyFlags flags;
+
+    if (!resource->mem.cpu_address || (resource->flags & VKD3D_RESOURCE_RESERVED))
+        return;
+
+    flags = device->memory_properties.memoryTypes[resource->mem.device_allocation.vk_memory_type].propertyFlags;
+
+    if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        resource->flags |= VKD3D_RESOURCE_COHERENT_MAP;
 }
 
 static void d3d12_resource_get_map_ptr(struct d3d12_resource *resource, void **data)
@@ -1594,6 +2012,14 @@ static HRESULT STDMETHODCALLTYPE d3d12_resource_Map(d3d12_resource_iface *iface,
     TRACE("iface %p, sub_resource %u, read_range %p, data %p.\n",
             iface, sub_resource, read_range, data);
 
+    /* Persistently mapped buffer in coherent memory, nothing to validate or invalidate */
+    if ((resource->flags & VKD3D_RESOURCE_COHERENT_MAP) && !sub_resource)
+    {
+        if (data)
+            *data = resource->mem.cpu_address;
+        return S_OK;
+    }
+
     if (!d3d12_resource_is_cpu_accessible(resource))
     {
         WARN("Resource is not CPU accessible.\n");
@@ -1640,6 +2066,9 @@ static void STDMETHODCALLTYPE d3d12_resource_Unmap(d3d12_resource_iface *iface,
     TRACE("iface %p, sub_resource %u, written_range %p.\n",
             iface, sub_resource, written_range);
 
+    if ((resource->flags & VKD3D_RESOURCE_COHERENT_MAP) && !sub_resource)
+        return;
+
     sub_resource_count = d3d12_resource_get_sub_resource_count(resource);
     if (sub_resource >= sub_resource_count)
     {
@@ -1679,6 +2108,14 @@ static D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE d3d12_resource_GetGPUVirtualA
     return resource->res.va;
 }
 
+static bool d3d12_resource_is_host_cached(const struct d3d12_resource *resource)
+{
+    const struct d3d12_device *device = resource->device;
+
+    return !!(device->memory_properties.memoryTypes[resource->mem.device_allocation.vk_memory_type].propertyFlags &
+            VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+}
+
 static HRESULT STDMETHODCALLTYPE d3d12_resource_WriteToSubresource(d3d12_resource_iface *iface,
         UINT dst_sub_resource, const D3D12_BOX *dst_box, const void *src_data,
         UINT src_row_pitch, UINT src_slice_pitch)
@@ -1753,7 +2190,9 @@ static HRESULT STDMETHODCALLTYPE d3d12_resource_WriteToSubresource(d3d12_resourc
 
     vkd3d_format_copy_data(resource->format, src_data, src_row_pitch, src_slice_pitch,
             dst_data, vk_layout.rowPitch, vk_layout.depthPitch, dst_box->right - dst_box->left,
-            dst_box->bottom - dst_box->top, dst_box->back - dst_box->front);
+            dst_box->bottom - dst_box->top, dst_box->back - dst_box->front,
+            d3d12_resource_is_host_cached(resource) ?
+                    VKD3D_FORMAT_COPY_MODE_DEFAULT : VKD3D_FORMAT_COPY_MODE_STREAMING_WRITE);
 
     return S_OK;
 }
@@ -1832,7 +2271,9 @@ static HRESULT STDMETHODCALLTYPE d3d12_resource_ReadFromSubresource(d3d12_resour
 
     vkd3d_format_copy_data(resource->format, src_data, vk_layout.rowPitch, vk_layout.depthPitch,
             dst_data, dst_row_pitch, dst_slice_pitch, src_box->right - src_box->left,
-            src_box->bottom - src_box->top, src_box->back - src_box->front);
+            src_box->bottom - src_box->top, src_box->back - src_box->front,
+            d3d12_resource_is_host_cached(resource) ?
+                    VKD3D_FORMAT_COPY_MODE_DEFAULT : VKD3D_FORMAT_COPY_MODE_STREAMING_READ);
 
     return S_OK;
 }
@@ -2375,7 +2816,7 @@ static HRESULT d3d12_resource_bind_sparse_metadata(struct d3d12_resource *resour
         goto cleanup;
     }
 
-    if ((vr = VK_CALL(vkQueueBindSparse(vk_queue, 1, &bind_info, VK_NULL_HANDLE))) < 0)
+    if ((vr = vkd3d_queue_bind_sparse_locked(vkd3d_queue, device, vk_queue, &bind_info)) < 0)
     {
         ERR("Failed to bind sparse metadata to image, vr %d.\n", vr);
         hr = hresult_from_vk_result(vr);
@@ -2395,121 +2836,465 @@ cleanup:
     if (vkd3d_queue && vk_queue)
         vkd3d_queue_release(vkd3d_queue);
 
-    vkd3d_free(sparse_requirements);
-    vkd3d_free(memory_binds);
-    return hr;
+    vkd3d_free(sparse_requirements);
+    vkd3d_free(memory_binds);
+    return hr;
+}
+
+static HRESULT d3d12_resource_init_sparse_info(struct d3d12_resource *resource,
+        struct d3d12_device *device, struct d3d12_sparse_info *sparse)
+{
+    VkSparseImageMemoryRequirements vk_memory_requirements;
+    HRESULT hr;
+
+    memset(sparse, 0, sizeof(*sparse));
+
+    if (!(resource->flags & VKD3D_RESOURCE_RESERVED))
+        return S_OK;
+
+    sparse->tiling_count = d3d12_resource_desc_get_sub_resource_count_per_plane(&resource->desc);
+    sparse->tile_count = 0;
+
+    if (!(sparse->tilings = vkd3d_malloc(sparse->tiling_count * sizeof(*sparse->tilings))))
+    {
+        ERR("Failed to allocate subresource tiling info array.\n");
+        return E_OUTOFMEMORY;
+    }
+
+    d3d12_resource_get_tiling(device, resource, &sparse->tile_count, &sparse->packed_mips,
+            &sparse->tile_shape, sparse->tilings, &vk_memory_requirements);
+
+    /* Tile regions are derived from the tiling info whenever they are needed, and
+     * the tile map only stores mapped runs, so nothing here scales with tile count. */
+    sparse->block_extent = vk_memory_requirements.formatProperties.imageGranularity;
+    sparse->aspect_mask = vk_memory_requirements.formatProperties.aspectMask;
+    sparse->mip_tail_offset = vk_memory_requirements.imageMipTailOffset;
+    sparse->mip_tail_size = vk_memory_requirements.imageMipTailSize;
+
+    if (FAILED(hr = d3d12_resource_bind_sparse_metadata(resource, device, sparse)))
+        return hr;
+
+    return S_OK;
+}
+
+void d3d12_sparse_info_get_buffer_region(const struct d3d12_resource *resource,
+        uint32_t tile_index, struct d3d12_sparse_buffer_region *region)
+{
+    const struct d3d12_sparse_info *sparse = &resource->sparse;
+    VkDeviceSize offset;
+
+    if (d3d12_resource_is_buffer(resource))
+    {
+        offset = VKD3D_TILE_SIZE * (VkDeviceSize)tile_index;
+        region->offset = offset;
+        region->length = align(min(VKD3D_TILE_SIZE, resource->desc.Width - offset), VKD3D_TILE_SIZE);
+    }
+    else
+    {
+        offset = VKD3D_TILE_SIZE * (VkDeviceSize)(tile_index - sparse->packed_mips.StartTileIndexInOverallResource);
+        region->offset = sparse->mip_tail_offset + offset;
+        region->length = align(min(VKD3D_TILE_SIZE, sparse->mip_tail_size - offset), VKD3D_TILE_SIZE);
+    }
+}
+
+void d3d12_sparse_info_get_image_region(const struct d3d12_resource *resource,
+        uint32_t tile_index, struct d3d12_sparse_image_region *region)
+{
+    const struct d3d12_sparse_info *sparse = &resource->sparse;
+    unsigned int standard_mips = sparse->packed_mips.NumStandardMips;
+    unsigned int mip_count = resource->desc.MipLevels;
+    const D3D12_SUBRESOURCE_TILING *tiling;
+    unsigned int lo, hi, mid, subresource;
+    VkExtent3D mip_extent;
+    uint32_t local_index;
+
+    assert(standard_mips);
+
+    /* Standard subresources are laid out back to back in subresource order, so
+     * look for the last one that starts at or before the tile. Packed mips
+     * have no tiling of their own and are skipped by the index mapping. */
+    lo = 0;
+    hi = (sparse->tiling_count / mip_count) * standard_mips;
+
+    while (hi - lo > 1)
+    {
+        mid = lo + (hi - lo) / 2;
+        subresource = (mid / standard_mips) * mip_count + (mid % standard_mips);
+
+        if (sparse->tilings[subresource].StartTileIndexInOverallResource <= tile_index)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    subresource = (lo / standard_mips) * mip_count + (lo % standard_mips);
+    tiling = &sparse->tilings[subresource];
+    local_index = tile_index - tiling->StartTileIndexInOverallResource;
+
+    assert(local_index < tiling->WidthInTiles * tiling->HeightInTiles * tiling->DepthInTiles);
+
+    region->subresource.aspectMask = sparse->aspect_mask;
+    region->subresource.mipLevel = subresource % mip_count;
+    region->subresource.arrayLayer = subresource / mip_count;
+    region->subresource_index = subresource;
+
+    region->offset.x = (local_index % tiling->WidthInTiles) * sparse->block_extent.width;
+    region->offset.y = ((local_index / tiling->WidthInTiles) % tiling->HeightInTiles) * sparse->block_extent.height;
+    region->offset.z = (local_index / (tiling->WidthInTiles * tiling->HeightInTiles)) * sparse->block_extent.depth;
+
+    mip_extent.width = d3d12_resource_desc_get_width(&resource->desc, region->subresource.mipLevel);
+    mip_extent.height = d3d12_resource_desc_get_height(&resource->desc, region->subresource.mipLevel);
+    mip_extent.depth = d3d12_resource_desc_get_depth(&resource->desc, region->subresource.mipLevel);
+
+    region->extent.width = min(sparse->block_extent.width, mip_extent.width - region->offset.x);
+    region->extent.height = min(sparse->block_extent.height, mip_extent.height - region->offset.y);
+    region->extent.depth = min(sparse->block_extent.depth, mip_extent.depth - region->offset.z);
+}
+
+size_t d3d12_sparse_info_find_run(const struct d3d12_sparse_info *sparse, uint32_t tile_index)
+{
+    size_t lo = 0, hi = sparse->run_count, mid;
+
+    /* Returns the first run that ends after the given tile. */
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+
+        if (sparse->runs[mid].tile_index + sparse->runs[mid].tile_count <= tile_index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+static bool d3d12_sparse_tile_run_can_merge(const struct d3d12_sparse_tile_run *a,
+        const struct d3d12_sparse_tile_run *b)
+{
+    return a->tile_index + a->tile_count == b->tile_index &&
+            a->vk_memory == b->vk_memory && a->vk_stride == b->vk_stride &&
+            a->vk_offset + a->vk_stride * a->tile_count == b->vk_offset;
+}
+
+static void d3d12_sparse_tile_run_truncate(struct d3d12_sparse_tile_run *run,
+        uint32_t tile_index, uint32_t tile_count)
+{
+    run->vk_offset += run->vk_stride * (tile_index - run->tile_index);
+    run->tile_index = tile_index;
+    run->tile_count = tile_count;
+
+    /* A single tile is bound at its offset either way, so runs of one tile
+     * use the regular stride in order to merge with their neighbours. */
+    if (tile_count == 1)
+        run->vk_stride = VKD3D_TILE_SIZE;
+}
+
+bool d3d12_sparse_info_map_tiles(struct d3d12_sparse_info *sparse, uint32_t tile_index, uint32_t tile_count,
+        VkDeviceMemory vk_memory, VkDeviceSize vk_offset, VkDeviceSize vk_stride)
+{
+    struct d3d12_sparse_tile_run pieces[3];
+    unsigned int piece_count, i, j;
+    size_t first, last, new_count;
+    uint32_t end;
+
+    if (tile_index >= sparse->tile_count)
+        return true;
+
+    tile_count = min(tile_count, sparse->tile_count - tile_index);
+    end = tile_index + tile_count;
+
+    if (!tile_count)
+        return true;
+
+    /* Replace all runs overlapping the range with the parts of the first and last
+     * run that stick out of it, plus the new run, and merge those with each other
+     * as well as with the adjacent runs where possible. */
+    first = d3d12_sparse_info_find_run(sparse, tile_index);
+    last = first;
+
+    while (last < sparse->run_count && sparse->runs[last].tile_index < end)
+        last++;
+
+    piece_count = 0;
+
+    if (first < last && sparse->runs[first].tile_index < tile_index)
+    {
+        pieces[piece_count] = sparse->runs[first];
+        d3d12_sparse_tile_run_truncate(&pieces[piece_count], pieces[piece_count].tile_index,
+                tile_index - pieces[piece_count].tile_index);
+        piece_count++;
+    }
+
+    if (vk_memory)
+    {
+        pieces[piece_count].tile_index = tile_index;
+        pieces[piece_count].tile_count = tile_count;
+        pieces[piece_count].vk_memory = vk_memory;
+        pieces[piece_count].vk_offset = vk_offset;
+        pieces[piece_count].vk_stride = tile_count == 1 ? VKD3D_TILE_SIZE : vk_stride;
+        piece_count++;
+    }
+
+    if (first < last && sparse->runs[last - 1].tile_index + sparse->runs[last - 1].tile_count > end)
+    {
+        pieces[piece_count] = sparse->runs[last - 1];
+        d3d12_sparse_tile_run_truncate(&pieces[piece_count], end,
+                pieces[piece_count].tile_index + pieces[piece_count].tile_count - end);
+        piece_count++;
+    }
+
+    if (piece_count && first && d3d12_sparse_tile_run_can_merge(&sparse->runs[first - 1], &pieces[0]))
+    {
+        pieces[0].tile_count += sparse->runs[first - 1].tile_count;
+        pieces[0].tile_index = sparse->runs[first - 1].tile_index;
+        pieces[0].vk_offset = sparse->runs[first - 1].vk_offset;
+        first--;
+    }
+
+    if (piece_count && last < sparse->run_count &&
+            d3d12_sparse_tile_run_can_merge(&pieces[piece_count - 1], &sparse->runs[last]))
+    {
+        pieces[piece_count - 1].tile_count += sparse->runs[last].tile_count;
+        last++;
+    }
+
+    for (i = 0, j = 0; i < piece_count; i++)
+    {
+        if (j && d3d12_sparse_tile_run_can_merge(&pieces[j - 1], &pieces[i]))
+            pieces[j - 1].tile_count += pieces[i].tile_count;
+        else
+            pieces[j++] = pieces[i];
+    }
+
+    piece_count = j;
+
+    if (!piece_count && first == last)
+        return true;
+
+    new_count = sparse->run_count - (last - first) + piece_count;
+
+    if (!vkd3d_array_reserve((void **)&sparse->runs, &sparse->runs_size,
+            new_count, sizeof(*sparse->runs)))
+    {
+        ERR("Failed to allocate tile map.\n");
+        return false;
+    }
+
+    memmove(&sparse->runs[first + piece_count], &sparse->runs[last],
+            (sparse->run_count - last) * sizeof(*sparse->runs));
+    memcpy(&sparse->runs[first], pieces, piece_count * sizeof(*pieces));
+    sparse->run_count = new_count;
+    return true;
+}
+
+/* Keep the pool small, anything in it is memory the application cannot use. */
+#define VKD3D_RESOURCE_RECYCLE_POOL_MAX_COUNT 64
+#define VKD3D_RESOURCE_RECYCLE_POOL_MAX_SIZE (256ull * 1024ull * 1024ull)
+
+HRESULT vkd3d_resource_recycle_pool_init(struct vkd3d_resource_recycle_pool *pool)
+{
+    int rc;
+
+    memset(pool, 0, sizeof(*pool));
+
+    if ((rc = pthread_mutex_init(&pool->mutex, NULL)))
+        return hresult_from_errno(rc);
+
+    return S_OK;
+}
+
+static void vkd3d_recycled_resource_free(struct d3d12_device *device, struct vkd3d_recycled_resource *entry)
+{
+    vkd3d_deferred_destroy_image(device, entry->vk_image);
+    vkd3d_free_memory(device, &device->memory_allocator, &entry->mem);
+
+    if (entry->vrs_view)
+        vkd3d_deferred_destroy_image_view(device, entry->vrs_view);
+
+    vkd3d_free(entry);
+}
+
+void vkd3d_resource_recycle_pool_cleanup(struct vkd3d_resource_recycle_pool *pool, struct d3d12_device *device)
+{
+    size_t i;
+
+    for (i = 0; i < pool->entry_count; i++)
+        vkd3d_recycled_resource_free(device, pool->entries[i]);
+
+    vkd3d_free(pool->entries);
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+void vkd3d_resource_recycle_pool_insert(struct d3d12_device *device, struct vkd3d_recycled_resource *entry)
+{
+    struct vkd3d_resource_recycle_pool *pool = &device->resource_recycle_pool;
+
+    /* This runs on the fence worker, so the pool is only trimmed by application threads. */
+    pthread_mutex_lock(&pool->mutex);
+
+    if (!vkd3d_array_reserve((void **)&pool->entries, &pool->entries_size,
+            pool->entry_count + 1, sizeof(*pool->entries)))
+    {
+        ERR("Failed to insert recycled resource.\n");
+        pthread_mutex_unlock(&pool->mutex);
+        vkd3d_recycled_resource_free(device, entry);
+        return;
+    }
+
+    pool->entries[pool->entry_count++] = entry;
+    pool->total_size += entry->mem.device_allocation.size;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void vkd3d_resource_recycle_pool_trim(struct d3d12_device *device)
+{
+    struct vkd3d_resource_recycle_pool *pool = &device->resource_recycle_pool;
+    struct vkd3d_recycled_resource *entry;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->mutex);
+
+        if (pool->entry_count <= VKD3D_RESOURCE_RECYCLE_POOL_MAX_COUNT &&
+                pool->total_size <= VKD3D_RESOURCE_RECYCLE_POOL_MAX_SIZE)
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+
+        entry = pool->entries[0];
+        memmove(&pool->entries[0], &pool->entries[1], (pool->entry_count - 1) * sizeof(*pool->entries));
+        pool->entry_count--;
+        pool->total_size -= entry->mem.device_allocation.size;
+        pthread_mutex_unlock(&pool->mutex);
+
+        vkd3d_recycled_resource_free(device, entry);
+    }
+}
+
+static bool vkd3d_heap_properties_equal(const D3D12_HEAP_PROPERTIES *a, const D3D12_HEAP_PROPERTIES *b)
+{
+    return a->Type == b->Type &&
+            a->CPUPageProperty == b->CPUPageProperty &&
+            a->MemoryPoolPreference == b->MemoryPoolPreference;
 }
 
-static HRESULT d3d12_resource_init_sparse_info(struct d3d12_resource *resource,
-        struct d3d12_device *device, struct d3d12_sparse_info *sparse)
+static struct vkd3d_recycled_resource *vkd3d_resource_recycle_pool_take(struct d3d12_device *device,
+        const D3D12_RESOURCE_DESC1 *desc, const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags)
 {
-    VkSparseImageMemoryRequirements vk_memory_requirements;
-    unsigned int i, subresource;
-    VkOffset3D tile_offset;
-    HRESULT hr;
+    struct vkd3d_resource_recycle_pool *pool = &device->resource_recycle_pool;
+    struct vkd3d_recycled_resource *entry = NULL;
+    size_t i;
 
-    memset(sparse, 0, sizeof(*sparse));
+    pthread_mutex_lock(&pool->mutex);
 
-    if (!(resource->flags & VKD3D_RESOURCE_RESERVED))
-        return S_OK;
+    /* Prefer the most recently destroyed resource, it is the least likely to have been paged out. */
+    for (i = pool->entry_count; i; i--)
+    {
+        entry = pool->entries[i - 1];
 
-    sparse->tiling_count = d3d12_resource_desc_get_sub_resource_count_per_plane(&resource->desc);
-    sparse->tile_count = 0;
+        if (entry->heap_flags == heap_flags && entry->desc.Alignment == desc->Alignment &&
+                d3d12_resource_desc_equal_ignore_alignment(&entry->desc, desc) &&
+                vkd3d_heap_properties_equal(&entry->heap_properties, heap_properties))
+        {
+            memmove(&pool->entries[i - 1], &pool->entries[i], (pool->entry_count - i) * sizeof(*pool->entries));
+            pool->entry_count--;
+            pool->total_size -= entry->mem.device_allocation.size;
+            break;
+        }
 
-    if (!(sparse->tilings = vkd3d_malloc(sparse->tiling_count * sizeof(*sparse->tilings))))
-    {
-        ERR("Failed to allocate subresource tiling info array.\n");
-        return E_OUTOFMEMORY;
+        entry = NULL;
     }
 
-    d3d12_resource_get_tiling(device, resource, &sparse->tile_count, &sparse->packed_mips,
-            &sparse->tile_shape, sparse->tilings, &vk_memory_requirements);
+    pthread_mutex_unlock(&pool->mutex);
+    return entry;
+}
 
-    if (!(sparse->tiles = vkd3d_malloc(sparse->tile_count * sizeof(*sparse->tiles))))
-    {
-        ERR("Failed to allocate tile mapping array.\n");
-        return E_OUTOFMEMORY;
-    }
+static bool d3d12_resource_can_recycle(const struct d3d12_resource *resource)
+{
+    /* Only resources which own their memory are worth it, suballocations are cheap to redo.
+     * A resource which failed creation still holds its public reference and is not reusable. */
+    return (vkd3d_config_flags & VKD3D_CONFIG_FLAG_RECYCLE_COMMITTED_RESOURCES) && !resource->refcount &&
+            (resource->flags & VKD3D_RESOURCE_COMMITTED) && (resource->flags & VKD3D_RESOURCE_ALLOCATION) &&
+            !(resource->flags & (VKD3D_RESOURCE_RESERVED | VKD3D_RESOURCE_EXTERNAL | VKD3D_RESOURCE_LINEAR_TILING)) &&
+            !(resource->heap_flags & (D3D12_HEAP_FLAG_SHARED | D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER)) &&
+            resource->mem.device_allocation.vk_memory && !resource->mem.chunk && !resource->mem.slab &&
+            !(resource->mem.flags & VKD3D_ALLOCATION_FLAG_ALLOW_WRITE_WATCH) &&
+            resource->mem.device_allocation.size <= VKD3D_RESOURCE_RECYCLE_POOL_MAX_SIZE;
+}
 
-    tile_offset.x = 0;
-    tile_offset.y = 0;
-    tile_offset.z = 0;
-    subresource = 0;
+static bool d3d12_resource_recycle(struct d3d12_resource *resource, struct d3d12_device *device)
+{
+    struct vkd3d_recycled_resource *entry;
+    struct vkd3d_deferred_destroy destroy;
 
-    for (i = 0; i < sparse->tile_count; i++)
-    {
-        if (d3d12_resource_is_buffer(resource))
-        {
-            VkDeviceSize offset = VKD3D_TILE_SIZE * i;
-            sparse->tiles[i].buffer.offset = offset;
-            sparse->tiles[i].buffer.length = align(min(VKD3D_TILE_SIZE, resource->desc.Width - offset),
-                    VKD3D_TILE_SIZE);
-        }
-        else if (sparse->packed_mips.NumPackedMips && i >= sparse->packed_mips.StartTileIndexInOverallResource)
-        {
-            VkDeviceSize offset = VKD3D_TILE_SIZE * (i - sparse->packed_mips.StartTileIndexInOverallResource);
-            sparse->tiles[i].buffer.offset = vk_memory_requirements.imageMipTailOffset + offset;
-            sparse->tiles[i].buffer.length = align(min(VKD3D_TILE_SIZE, vk_memory_requirements.imageMipTailSize - offset),
-                    VKD3D_TILE_SIZE);
-        }
-        else
-        {
-            struct d3d12_sparse_image_region *region = &sparse->tiles[i].image;
-            VkExtent3D block_extent = vk_memory_requirements.formatProperties.imageGranularity;
-            VkExtent3D mip_extent;
+    if (!d3d12_resource_can_recycle(resource))
+        return false;
 
-            assert(subresource < sparse->tiling_count && sparse->tilings[subresource].WidthInTiles &&
-                    sparse->tilings[subresource].HeightInTiles && sparse->tilings[subresource].DepthInTiles);
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
+        return false;
 
-            region->subresource.aspectMask = vk_memory_requirements.formatProperties.aspectMask;
-            region->subresource.mipLevel = subresource % resource->desc.MipLevels;
-            region->subresource.arrayLayer = subresource / resource->desc.MipLevels;
-            region->subresource_index = subresource;
+    entry->desc = resource->desc;
+    entry->heap_properties = resource->heap_properties;
+    entry->heap_flags = resource->heap_flags;
+    entry->vk_image = d3d12_resource_is_texture(resource) ? resource->res.vk_image : VK_NULL_HANDLE;
+    entry->vrs_view = resource->vrs_view;
+    entry->common_layout = resource->common_layout;
+    entry->flags = resource->flags & VKD3D_RESOURCE_SIMULTANEOUS_ACCESS;
+    vkd3d_memory_allocation_move(device, &device->memory_allocator, &entry->mem, &resource->mem);
 
-            region->offset.x = tile_offset.x * block_extent.width;
-            region->offset.y = tile_offset.y * block_extent.height;
-            region->offset.z = tile_offset.z * block_extent.depth;
+    TRACE("Recycling resource %p, %"PRIu64" bytes.\n", resource, entry->mem.device_allocation.size);
 
-            mip_extent.width = d3d12_resource_desc_get_width(&resource->desc, region->subresource.mipLevel);
-            mip_extent.height = d3d12_resource_desc_get_height(&resource->desc, region->subresource.mipLevel);
-            mip_extent.depth = d3d12_resource_desc_get_depth(&resource->desc, region->subresource.mipLevel);
+    /* Only hand it out again once the GPU is done with it. */
+    destroy.type = VKD3D_DEFERRED_DESTROY_RECYCLED_RESOURCE;
+    destroy.recycled_resource = entry;
+    vkd3d_deferred_destroy(device, &destroy);
 
-            region->extent.width = min(block_extent.width, mip_extent.width - region->offset.x);
-            region->extent.height = min(block_extent.height, mip_extent.height - region->offset.y);
-            region->extent.depth = min(block_extent.depth, mip_extent.depth - region->offset.z);
+    vkd3d_resource_recycle_pool_trim(device);
+    return true;
+}
 
-            if (++tile_offset.x == (int32_t)sparse->tilings[subresource].WidthInTiles)
-            {
-                tile_offset.x = 0;
-                if (++tile_offset.y == (int32_t)sparse->tilings[subresource].HeightInTiles)
-                {
-                    tile_offset.y = 0;
-                    if (++tile_offset.z == (int32_t)sparse->tilings[subresource].DepthInTiles)
-                    {
-                        tile_offset.z = 0;
-
-                        /* Find next subresource that is not part of the packed mip tail */
-                        while ((++subresource % resource->desc.MipLevels) >= sparse->packed_mips.NumStandardMips)
-                            continue;
-                    }
-                }
-            }
-        }
+static HRESULT d3d12_resource_init_recycled(struct d3d12_resource *object, struct d3d12_device *device,
+        bool *recycled)
+{
+    struct vkd3d_recycled_resource *entry;
+    D3D12_RESOURCE_DESC1 desc;
+
+    *recycled = false;
+
+    desc = object->desc;
+    if (d3d12_resource_is_texture(object) && !desc.MipLevels)
+        desc.MipLevels = max_miplevel_count(&desc);
+
+    if (!(entry = vkd3d_resource_recycle_pool_take(device, &desc,
+            &object->heap_properties, object->heap_flags)))
+        return S_OK;
+
+    TRACE("Reusing recycled resource for %p, %"PRIu64" bytes.\n", object, entry->mem.device_allocation.size);
+
+    /* Only the Vulkan objects and the memory are reused, everything else
+     * goes through the same setup as a newly created resource. */
+    object->desc = desc;
+    vkd3d_memory_allocation_move(device, &device->memory_allocator, &object->mem, &entry->mem);
 
-        sparse->tiles[i].vk_memory = VK_NULL_HANDLE;
-        sparse->tiles[i].vk_offset = 0;
+    if (d3d12_resource_is_texture(object))
+    {
+        object->res.vk_image = entry->vk_image;
+        object->vrs_view = entry->vrs_view;
+        object->common_layout = entry->common_layout;
+        object->flags |= entry->flags;
+        object->initial_layout_transition = 1;
     }
 
-    if (FAILED(hr = d3d12_resource_bind_sparse_metadata(resource, device, sparse)))
-        return hr;
+    vkd3d_free(entry);
+    *recycled = true;
 
-    return S_OK;
+    return vkd3d_memory_allocation_init_recycled(device, &device->memory_allocator, &object->mem);
 }
 
 static void d3d12_resource_destroy(struct d3d12_resource *resource, struct d3d12_device *device)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-
     vkd3d_view_map_destroy(&resource->view_map, resource->device);
 
     vkd3d_descriptor_debug_unregister_cookie(device->descriptor_qa_global_info, resource->res.cookie);
@@ -2520,7 +3305,7 @@ static void d3d12_resource_destroy(struct d3d12_resource *resource, struct d3d12
     if (resource->flags & VKD3D_RESOURCE_RESERVED)
     {
         vkd3d_free_device_memory(device, &resource->sparse.vk_metadata_memory);
-        vkd3d_free(resource->sparse.tiles);
+        vkd3d_free(resource->sparse.runs);
         vkd3d_free(resource->sparse.tilings);
 
         if (resource->res.va)
@@ -2532,16 +3317,22 @@ static void d3d12_resource_destroy(struct d3d12_resource *resource, struct d3d12
         }
     }
 
-    if (d3d12_resource_is_texture(resource))
-        VK_CALL(vkDestroyImage(device->vk_device, resource->res.vk_image, NULL));
-    else if (resource->flags & VKD3D_RESOURCE_RESERVED)
-        VK_CALL(vkDestroyBuffer(device->vk_device, resource->res.vk_buffer, NULL));
+    if ((resource->flags & VKD3D_RESOURCE_COMMITTED) && (resource->flags & VKD3D_RESOURCE_ALLOCATION))
+        vkd3d_residency_release_allocation(device, resource->residency_count, &resource->mem);
+
+    if (!d3d12_resource_recycle(resource, device))
+    {
+        if (d3d12_resource_is_texture(resource))
+            vkd3d_deferred_destroy_image(device, resource->res.vk_image);
+        else if (resource->flags & VKD3D_RESOURCE_RESERVED)
+            vkd3d_deferred_destroy_buffer(device, resource->res.vk_buffer);
 
-    if ((resource->flags & VKD3D_RESOURCE_ALLOCATION) && resource->mem.device_allocation.vk_memory)
-        vkd3d_free_memory(device, &device->memory_allocator, &resource->mem);
+        if ((resource->flags & VKD3D_RESOURCE_ALLOCATION) && resource->mem.device_allocation.vk_memory)
+            vkd3d_free_memory(device, &device->memory_allocator, &resource->mem);
 
-    if (resource->vrs_view)
-        VK_CALL(vkDestroyImageView(device->vk_device, resource->vrs_view, NULL));
+        if (resource->vrs_view)
+            vkd3d_deferred_destroy_image_view(device, resource->vrs_view);
+    }
 
     vkd3d_private_store_destroy(&resource->private_store);
     d3d12_device_release(resource->device);
@@ -2610,6 +3401,7 @@ static HRESULT d3d12_resource_create(struct d3d12_device *device, uint32_t flags
 
     object->refcount = 1;
     object->internal_refcount = 1;
+    object->residency_count = 1;
     object->desc = *desc;
     object->device = device;
     object->flags = flags;
@@ -2643,12 +3435,17 @@ HRESULT d3d12_resource_create_committed(struct d3d12_device *device, const D3D12
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     struct d3d12_resource *object;
+    bool recycled = false;
     HRESULT hr;
 
     if (FAILED(hr = d3d12_resource_create(device, VKD3D_RESOURCE_COMMITTED | VKD3D_RESOURCE_ALLOCATION,
             desc, heap_properties, heap_flags, initial_state, optimized_clear_value, &object)))
         return hr;
 
+    if ((vkd3d_config_flags & VKD3D_CONFIG_FLAG_RECYCLE_COMMITTED_RESOURCES) &&
+            FAILED(hr = d3d12_resource_init_recycled(object, device, &recycled)))
+        goto fail;
+
     if (d3d12_resource_is_texture(object))
     {
         VkMemoryDedicatedRequirements dedicated_requirements;
@@ -2660,72 +3457,75 @@ HRESULT d3d12_resource_create_committed(struct d3d12_device *device, const D3D12
         bool use_dedicated_allocation;
         VkResult vr;
 
-        if (FAILED(hr = d3d12_resource_create_vk_resource(object, device)))
-            goto fail;
+        if (!recycled)
+        {
+            if (FAILED(hr = d3d12_resource_create_vk_resource(object, device)))
+                goto fail;
 
-        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
-        image_info.pNext = NULL;
-        image_info.image = object->res.vk_image;
+            image_info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+            image_info.pNext = NULL;
+            image_info.image = object->res.vk_image;
 
-        dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
-        dedicated_requirements.pNext = NULL;
+            dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+            dedicated_requirements.pNext = NULL;
 
-        memory_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
-        memory_requirements.pNext = &dedicated_requirements;
+            memory_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+            memory_requirements.pNext = &dedicated_requirements;
 
-        VK_CALL(vkGetImageMemoryRequirements2(device->vk_device, &image_info, &memory_requirements));
+            VK_CALL(vkGetImageMemoryRequirements2(device->vk_device, &image_info, &memory_requirements));
 
-        if (!(use_dedicated_allocation = dedicated_requirements.prefersDedicatedAllocation))
-        {
-            const uint32_t type_mask = memory_requirements.memoryRequirements.memoryTypeBits & device->memory_info.global_mask;
-            const struct vkd3d_memory_info_domain *domain = d3d12_device_get_memory_info_domain(device, heap_properties);
-            use_dedicated_allocation = (type_mask & domain->buffer_type_mask) != type_mask;
-        }
+            if (!(use_dedicated_allocation = dedicated_requirements.prefersDedicatedAllocation))
+            {
+                const uint32_t type_mask = memory_requirements.memoryRequirements.memoryTypeBits & device->memory_info.global_mask;
+                const struct vkd3d_memory_info_domain *domain = d3d12_device_get_memory_info_domain(device, heap_properties);
+                use_dedicated_allocation = (type_mask & domain->buffer_type_mask) != type_mask;
+            }
 
-        memset(&allocate_info, 0, sizeof(allocate_info));
-        allocate_info.memory_requirements = memory_requirements.memoryRequirements;
-        allocate_info.heap_properties = *heap_properties;
-        allocate_info.heap_flags = heap_flags;
+            memset(&allocate_info, 0, sizeof(allocate_info));
+            allocate_info.memory_requirements = memory_requirements.memoryRequirements;
+            allocate_info.heap_properties = *heap_properties;
+            allocate_info.heap_flags = heap_flags;
 
-        if (desc->Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
-            allocate_info.heap_flags |= D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
-        else
-            allocate_info.heap_flags |= D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+            if (desc->Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+                allocate_info.heap_flags |= D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+            else
+                allocate_info.heap_flags |= D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
 
-        if (use_dedicated_allocation)
-        {
-            dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
-            dedicated_info.pNext = NULL;
-            dedicated_info.image = object->res.vk_image;
-            dedicated_info.buffer = VK_NULL_HANDLE;
-            allocate_info.pNext = &dedicated_info;
-            allocate_info.flags = VKD3D_ALLOCATION_FLAG_DEDICATED;
-        }
-        else
-        {
-            /* We want to allow suballocations and we need the allocation to
-             * be cleared to zero, which only works if we allow buffers */
-            allocate_info.heap_flags &= ~D3D12_HEAP_FLAG_DENY_BUFFERS;
-            allocate_info.flags = VKD3D_ALLOCATION_FLAG_GLOBAL_BUFFER;
-        }
+            if (use_dedicated_allocation)
+            {
+                dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+                dedicated_info.pNext = NULL;
+                dedicated_info.image = object->res.vk_image;
+                dedicated_info.buffer = VK_NULL_HANDLE;
+                allocate_info.pNext = &dedicated_info;
+                allocate_info.flags = VKD3D_ALLOCATION_FLAG_DEDICATED;
+            }
+            else
+            {
+                /* We want to allow suballocations and we need the allocation to
+                 * be cleared to zero, which only works if we allow buffers */
+                allocate_info.heap_flags &= ~D3D12_HEAP_FLAG_DENY_BUFFERS;
+                allocate_info.flags = VKD3D_ALLOCATION_FLAG_GLOBAL_BUFFER;
+            }
 
-        if (FAILED(hr = vkd3d_allocate_memory(device, &device->memory_allocator, &allocate_info, &object->mem)))
-            goto fail;
+            if (FAILED(hr = vkd3d_allocate_memory(device, &device->memory_allocator, &allocate_info, &object->mem)))
+                goto fail;
 
-        bind_info.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO;
-        bind_info.pNext = NULL;
-        bind_info.image = object->res.vk_image;
-        bind_info.memory = object->mem.device_allocation.vk_memory;
-        bind_info.memoryOffset = object->mem.offset;
+            bind_info.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO;
+            bind_info.pNext = NULL;
+            bind_info.image = object->res.vk_image;
+            bind_info.memory = object->mem.device_allocation.vk_memory;
+            bind_info.memoryOffset = object->mem.offset;
 
-        if ((vr = VK_CALL(vkBindImageMemory2KHR(device->vk_device, 1, &bind_info))))
-        {
-            ERR("Failed to bind image memory, vr %d.\n", vr);
-            hr = hresult_from_vk_result(vr);
-            goto fail;
+            if ((vr = VK_CALL(vkBindImageMemory2KHR(device->vk_device, 1, &bind_info))))
+            {
+                ERR("Failed to bind image memory, vr %d.\n", vr);
+                hr = hresult_from_vk_result(vr);
+                goto fail;
+            }
         }
 
-        if (vkd3d_resource_can_be_vrs(device, heap_properties, desc))
+        if (!object->vrs_view && vkd3d_resource_can_be_vrs(device, heap_properties, desc))
         {
             /* Make the implicit VRS view here... */
             if (FAILED(hr = vkd3d_resource_make_vrs_view(device, object->res.vk_image, &object->vrs_view)))
@@ -2736,18 +3536,29 @@ HRESULT d3d12_resource_create_committed(struct d3d12_device *device, const D3D12
     {
         struct vkd3d_allocate_heap_memory_info allocate_info;
 
-        memset(&allocate_info, 0, sizeof(allocate_info));
-        allocate_info.heap_desc.Properties = *heap_properties;
-        allocate_info.heap_desc.Alignment = desc->Alignment ? desc->Alignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
-        allocate_info.heap_desc.SizeInBytes = align(desc->Width, allocate_info.heap_desc.Alignment);
-        allocate_info.heap_desc.Flags = heap_flags | D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        if (!recycled)
+        {
+            memset(&allocate_info, 0, sizeof(allocate_info));
+            allocate_info.heap_desc.Properties = *heap_properties;
+            allocate_info.heap_desc.Alignment = desc->Alignment ? desc->Alignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
 
-        if (FAILED(hr = vkd3d_allocate_heap_memory(device,
-                &device->memory_allocator, &allocate_info, &object->mem)))
-            goto fail;
+            /* Small buffers, typically constant buffers, can be packed into slabs */
+            if ((vkd3d_config_flags & VKD3D_CONFIG_FLAG_SMALL_BUFFER_SLABS) &&
+                    !desc->Alignment && desc->Width <= VKD3D_MEMORY_SLAB_MAX_SLOT_SIZE &&
+                    !(heap_flags & D3D12_HEAP_FLAG_ALLOW_WRITE_WATCH))
+                allocate_info.heap_desc.Alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+            allocate_info.heap_desc.SizeInBytes = align(desc->Width, allocate_info.heap_desc.Alignment);
+            allocate_info.heap_desc.Flags = heap_flags | D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+            if (FAILED(hr = vkd3d_allocate_heap_memory(device,
+                    &device->memory_allocator, &allocate_info, &object->mem)))
+                goto fail;
+        }
 
         object->res.vk_buffer = object->mem.resource.vk_buffer;
         object->res.va = object->mem.resource.va;
+        d3d12_resource_init_coherent_map(object, device);
     }
 
     *resource = object;
@@ -2868,6 +3679,7 @@ HRESULT d3d12_resource_create_placed(struct d3d12_device *device, const D3D12_RE
     {
         object->res.vk_buffer = object->mem.resource.vk_buffer;
         object->res.va = object->mem.resource.va;
+        d3d12_resource_init_coherent_map(object, device);
     }
 
     if (vkd3d_resource_can_be_vrs(device, &heap->desc.Properties, desc))
@@ -3046,18 +3858,62 @@ void vkd3d_view_decref(struct vkd3d_view *view, struct d3d12_device *device)
         vkd3d_view_destroy(view, device);
 }
 
-void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
-        struct d3d12_device *device)
+void d3d12_desc_copy_batch_flush(struct d3d12_desc_copy_batch *batch, struct d3d12_device *device)
 {
-    VkCopyDescriptorSet vk_copies[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    if (batch->copy_count)
+    {
+        VK_CALL(vkUpdateDescriptorSets(device->vk_device, 0, NULL, batch->copy_count, batch->vk_copies));
+        batch->copy_count = 0;
+    }
+}
+
+static inline void d3d12_desc_copy_batch_add(struct d3d12_desc_copy_batch *batch, struct d3d12_device *device,
+        VkDescriptorSet src_set, VkDescriptorSet dst_set, uint32_t binding,
+        uint32_t src_offset, uint32_t dst_offset, uint32_t count)
+{
+    VkCopyDescriptorSet *vk_copy;
+
+    /* Copies are executed in order, and the metadata has already been copied in that same order.
+     * Growing anything but the last entry would move descriptors ahead of copies which may read
+     * them, so only extend a copy which directly continues the previous one. */
+    if (batch->copy_count)
+    {
+        vk_copy = &batch->vk_copies[batch->copy_count - 1];
+
+        if (vk_copy->srcSet == src_set && vk_copy->dstSet == dst_set && vk_copy->srcBinding == binding &&
+                vk_copy->srcArrayElement + vk_copy->descriptorCount == src_offset &&
+                vk_copy->dstArrayElement + vk_copy->descriptorCount == dst_offset)
+        {
+            vk_copy->descriptorCount += count;
+            return;
+        }
+    }
+
+    if (batch->copy_count == batch->copy_size)
+        d3d12_desc_copy_batch_flush(batch, device);
+
+    vk_copy = &batch->vk_copies[batch->copy_count++];
+    vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
+    vk_copy->pNext = NULL;
+    vk_copy->srcSet = src_set;
+    vk_copy->srcBinding = binding;
+    vk_copy->srcArrayElement = src_offset;
+    vk_copy->dstSet = dst_set;
+    vk_copy->dstBinding = binding;
+    vk_copy->dstArrayElement = dst_offset;
+    vk_copy->descriptorCount = count;
+}
+
+static void d3d12_desc_copy_single_batched(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
+        struct d3d12_device *device, struct d3d12_desc_copy_batch *batch)
+{
     struct vkd3d_descriptor_binding binding;
     uint32_t set_mask, set_info_index;
     struct d3d12_desc_split src, dst;
     const VkDescriptorSet *src_sets;
     const VkDescriptorSet *dst_sets;
-    VkCopyDescriptorSet *vk_copy;
-    uint32_t copy_count = 0;
     uint32_t flags;
 
     src = d3d12_desc_decode_va(src_va);
@@ -3074,17 +3930,8 @@ void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descript
          * and also, we don't get a dependency chain on the CTZ loop -> index, which causes OoO bubbles
          * it seems. */
         binding = src.types->single_binding;
-
-        vk_copy = &vk_copies[copy_count++];
-        vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-        vk_copy->pNext = NULL;
-        vk_copy->srcSet = src_sets[binding.set];
-        vk_copy->srcBinding = binding.binding;
-        vk_copy->srcArrayElement = src.offset;
-        vk_copy->dstSet = dst_sets[binding.set];
-        vk_copy->dstBinding = binding.binding;
-        vk_copy->dstArrayElement = dst.offset;
-        vk_copy->descriptorCount = 1;
+        d3d12_desc_copy_batch_add(batch, device, src_sets[binding.set], dst_sets[binding.set],
+                binding.binding, src.offset, dst.offset, 1);
     }
     else
     {
@@ -3093,17 +3940,8 @@ void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descript
         {
             set_info_index = vkd3d_bitmask_iter32(&set_mask);
             binding = vkd3d_bindless_state_binding_from_info_index(&device->bindless_state, set_info_index);
-
-            vk_copy = &vk_copies[copy_count++];
-            vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-            vk_copy->pNext = NULL;
-            vk_copy->srcSet = src_sets[binding.set];
-            vk_copy->srcBinding = binding.binding;
-            vk_copy->srcArrayElement = src.offset;
-            vk_copy->dstSet = dst_sets[binding.set];
-            vk_copy->dstBinding = binding.binding;
-            vk_copy->dstArrayElement = dst.offset;
-            vk_copy->descriptorCount = 1;
+            d3d12_desc_copy_batch_add(batch, device, src_sets[binding.set], dst_sets[binding.set],
+                    binding.binding, src.offset, dst.offset, 1);
         }
     }
 
@@ -3119,23 +3957,11 @@ void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descript
         {
             binding = vkd3d_bindless_state_find_set(
                     &device->bindless_state, VKD3D_BINDLESS_SET_UAV | VKD3D_BINDLESS_SET_AUX_BUFFER);
-
-            vk_copy = &vk_copies[copy_count++];
-            vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-            vk_copy->pNext = NULL;
-            vk_copy->srcSet = src_sets[binding.set];
-            vk_copy->srcBinding = binding.binding;
-            vk_copy->srcArrayElement = src.offset;
-            vk_copy->dstSet = dst_sets[binding.set];
-            vk_copy->dstBinding = binding.binding;
-            vk_copy->dstArrayElement = dst.offset;
-            vk_copy->descriptorCount = 1;
+            d3d12_desc_copy_batch_add(batch, device, src_sets[binding.set], dst_sets[binding.set],
+                    binding.binding, src.offset, dst.offset, 1);
         }
     }
 
-    if (copy_count)
-        VK_CALL(vkUpdateDescriptorSets(device->vk_device, 0, NULL, copy_count, vk_copies));
-
     if (flags & VKD3D_DESCRIPTOR_FLAG_BUFFER_OFFSET)
     {
         const struct vkd3d_bound_buffer_range *src_buffer_ranges = src.heap->buffer_ranges.host_ptr;
@@ -3147,43 +3973,123 @@ void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descript
     *dst.view = *src.view;
 }
 
-void d3d12_desc_copy_range(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
-        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device)
+void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
+        struct d3d12_device *device)
 {
     VkCopyDescriptorSet vk_copies[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct d3d12_desc_copy_batch batch;
+
+    d3d12_desc_copy_batch_init(&batch, vk_copies, ARRAY_SIZE(vk_copies));
+    d3d12_desc_copy_single_batched(dst_va, src_va, device, &batch);
+    d3d12_desc_copy_batch_flush(&batch, device);
+}
+
+/* Past this point the destination metadata is unlikely to stay in cache anyway,
+ * so prefer non-temporal stores to avoid evicting the source stream. */
+#define VKD3D_DESC_COPY_STREAMING_THRESHOLD 4096u
+
+/* Copies types and view metadata in one pass and returns the union of set_info_mask. */
+static uint32_t d3d12_desc_copy_metadata(const struct d3d12_desc_split *dst,
+        const struct d3d12_desc_split *src, unsigned int count)
+{
+    uint32_t set_info_mask = 0;
+    unsigned int i = 0;
+
+#ifdef __SSE2__
+    __m128i mask_acc, t, v0, v1, v2, v3;
+    bool streaming;
+
+    streaming = count >= VKD3D_DESC_COPY_STREAMING_THRESHOLD &&
+            !((uintptr_t)dst->view & 15) && !((uintptr_t)dst->types & 7);
+
+    /* Process descriptors in pairs so that types are moved 16 bytes at a time.
+     * Peel one descriptor if needed to get the destination types aligned. */
+    if (streaming && ((uintptr_t)dst->types & 15) && count)
+    {
+        set_info_mask |= src->types[0].set_info_mask;
+        dst->types[0] = src->types[0];
+        dst->view[0] = src->view[0];
+        i = 1;
+    }
+
+    mask_acc = _mm_setzero_si128();
+
+    if (streaming)
+    {
+        for (; i + 2 <= count; i += 2)
+        {
+            t = _mm_loadu_si128((const __m128i *)&src->types[i]);
+            v0 = _mm_loadu_si128((const __m128i *)&src->view[i] + 0);
+            v1 = _mm_loadu_si128((const __m128i *)&src->view[i] + 1);
+            v2 = _mm_loadu_si128((const __m128i *)&src->view[i] + 2);
+            v3 = _mm_loadu_si128((const __m128i *)&src->view[i] + 3);
+            mask_acc = _mm_or_si128(mask_acc, t);
+            _mm_stream_si128((__m128i *)&dst->types[i], t);
+            _mm_stream_si128((__m128i *)&dst->view[i] + 0, v0);
+            _mm_stream_si128((__m128i *)&dst->view[i] + 1, v1);
+            _mm_stream_si128((__m128i *)&dst->view[i] + 2, v2);
+            _mm_stream_si128((__m128i *)&dst->view[i] + 3, v3);
+        }
+
+        _mm_sfence();
+    }
+    else
+    {
+        for (; i + 2 <= count; i += 2)
+        {
+            t = _mm_loadu_si128((const __m128i *)&src->types[i]);
+            v0 = _mm_loadu_si128((const __m128i *)&src->view[i] + 0);
+            v1 = _mm_loadu_si128((const __m128i *)&src->view[i] + 1);
+            v2 = _mm_loadu_si128((const __m128i *)&src->view[i] + 2);
+            v3 = _mm_loadu_si128((const __m128i *)&src->view[i] + 3);
+            mask_acc = _mm_or_si128(mask_acc, t);
+            _mm_storeu_si128((__m128i *)&dst->types[i], t);
+            _mm_storeu_si128((__m128i *)&dst->view[i] + 0, v0);
+            _mm_storeu_si128((__m128i *)&dst->view[i] + 1, v1);
+            _mm_storeu_si128((__m128i *)&dst->view[i] + 2, v2);
+            _mm_storeu_si128((__m128i *)&dst->view[i] + 3, v3);
+        }
+    }
+
+    /* Each 16 byte lane holds two metadata_types, pick out set_info_mask from both. */
+    set_info_mask |= (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(mask_acc,
+            offsetof(struct vkd3d_descriptor_metadata_types, set_info_mask))) & 0xff;
+    set_info_mask |= (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(mask_acc,
+            sizeof(struct vkd3d_descriptor_metadata_types) +
+            offsetof(struct vkd3d_descriptor_metadata_types, set_info_mask))) & 0xff;
+#endif
+
+    for (; i < count; i++)
+    {
+        set_info_mask |= src->types[i].set_info_mask;
+        dst->types[i] = src->types[i];
+        dst->view[i] = src->view[i];
+    }
+
+    return set_info_mask;
+}
+
+static void d3d12_desc_copy_range(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
+        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device,
+        struct d3d12_desc_copy_batch *batch)
+{
     struct vkd3d_descriptor_binding binding;
     struct d3d12_desc_split src, dst;
-    VkCopyDescriptorSet *vk_copy;
-    uint32_t set_info_mask = 0;
-    uint32_t copy_count = 0;
+    uint32_t set_info_mask;
     uint32_t set_info_index;
-    unsigned int i;
 
     src = d3d12_desc_decode_va(src_va);
     dst = d3d12_desc_decode_va(dst_va);
 
-    for (i = 0; i < count; i++)
-        set_info_mask |= src.types[i].set_info_mask;
-
-    memcpy(dst.view, src.view, sizeof(*dst.view) * count);
-    memcpy(dst.types, src.types, sizeof(*dst.types) * count);
+    set_info_mask = d3d12_desc_copy_metadata(&dst, &src, count);
 
     while (set_info_mask)
     {
         set_info_index = vkd3d_bitmask_iter32(&set_info_mask);
         binding = vkd3d_bindless_state_binding_from_info_index(&device->bindless_state, set_info_index);
-
-        vk_copy = &vk_copies[copy_count++];
-        vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-        vk_copy->pNext = NULL;
-        vk_copy->srcSet = src.heap->vk_descriptor_sets[binding.set];
-        vk_copy->srcBinding = binding.binding;
-        vk_copy->srcArrayElement = src.offset;
-        vk_copy->dstSet = dst.heap->vk_descriptor_sets[binding.set];
-        vk_copy->dstBinding = binding.binding;
-        vk_copy->dstArrayElement = dst.offset;
-        vk_copy->descriptorCount = count;
+        d3d12_desc_copy_batch_add(batch, device,
+                src.heap->vk_descriptor_sets[binding.set], dst.heap->vk_descriptor_sets[binding.set],
+                binding.binding, src.offset, dst.offset, count);
     }
 
     if (heap_type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)
@@ -3197,17 +4103,9 @@ void d3d12_desc_copy_range(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descripto
         else
         {
             binding = vkd3d_bindless_state_find_set(&device->bindless_state, VKD3D_BINDLESS_SET_UAV | VKD3D_BINDLESS_SET_AUX_BUFFER);
-
-            vk_copy = &vk_copies[copy_count++];
-            vk_copy->sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
-            vk_copy->pNext = NULL;
-            vk_copy->srcSet = src.heap->vk_descriptor_sets[binding.set];
-            vk_copy->srcBinding = binding.binding;
-            vk_copy->srcArrayElement = src.offset;
-            vk_copy->dstSet = dst.heap->vk_descriptor_sets[binding.set];
-            vk_copy->dstBinding = binding.binding;
-            vk_copy->dstArrayElement = dst.offset;
-            vk_copy->descriptorCount = count;
+            d3d12_desc_copy_batch_add(batch, device,
+                    src.heap->vk_descriptor_sets[binding.set], dst.heap->vk_descriptor_sets[binding.set],
+                    binding.binding, src.offset, dst.offset, count);
         }
 
         if (device->bindless_state.flags & (VKD3D_TYPED_OFFSET_BUFFER | VKD3D_SSBO_OFFSET_BUFFER))
@@ -3217,17 +4115,16 @@ void d3d12_desc_copy_range(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descripto
             memcpy(dst_ranges + dst.offset, src_ranges + src.offset, sizeof(*dst_ranges) * count);
         }
     }
-
-    if (copy_count)
-        VK_CALL(vkUpdateDescriptorSets(device->vk_device, 0, NULL, copy_count, vk_copies));
 }
 
-void d3d12_desc_copy(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
-        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device)
+void d3d12_desc_copy_batched(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
+        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device,
+        struct d3d12_desc_copy_batch *batch)
 {
     unsigned int i;
 
 #ifdef VKD3D_ENABLE_DESCRIPTOR_QA
+    if (vkd3d_descriptor_debug_active())
     {
         struct d3d12_desc_split dst, src;
         dst = d3d12_desc_decode_va(dst_va);
@@ -3236,27 +4133,38 @@ void d3d12_desc_copy(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t
         for (i = 0; i < count; i++)
         {
             vkd3d_descriptor_debug_copy_descriptor(
-                    dst.heap->descriptor_heap_info.host_ptr, dst.heap->cookie, dst.offset,
-                    src.heap->descriptor_heap_info.host_ptr, src.heap->cookie, src.offset,
+                    dst.heap->descriptor_heap_info.host_ptr, dst.heap->cookie, dst.offset + i,
+                    src.heap->descriptor_heap_info.host_ptr, src.heap->cookie, src.offset + i,
                     src.view[i].cookie);
         }
     }
 #endif
 
     if (device->bindless_state.flags & VKD3D_BINDLESS_MUTABLE_TYPE)
-        d3d12_desc_copy_range(dst_va, src_va, count, heap_type, device);
+        d3d12_desc_copy_range(dst_va, src_va, count, heap_type, device, batch);
     else
     {
         /* This path is quite rare. Could potentially amortize d3d12_desc_decode_va(). */
         for (i = 0; i < count; i++)
         {
-            d3d12_desc_copy_single(dst_va, src_va, device);
+            d3d12_desc_copy_single_batched(dst_va, src_va, device, batch);
             dst_va += VKD3D_RESOURCE_DESC_INCREMENT;
             src_va += VKD3D_RESOURCE_DESC_INCREMENT;
         }
     }
 }
 
+void d3d12_desc_copy(vkd3d_cpu_descriptor_va_t dst_va, vkd3d_cpu_descriptor_va_t src_va,
+        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device)
+{
+    VkCopyDescriptorSet vk_copies[VKD3D_DESC_COPY_BATCH_SIZE];
+    struct d3d12_desc_copy_batch batch;
+
+    d3d12_desc_copy_batch_init(&batch, vk_copies, ARRAY_SIZE(vk_copies));
+    d3d12_desc_copy_batched(dst_va, src_va, count, heap_type, device, &batch);
+    d3d12_desc_copy_batch_flush(&batch, device);
+}
+
 bool vkd3d_create_raw_r32ui_vk_buffer_view(struct d3d12_device *device,
         VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range, VkBufferView *vk_view)
 {
@@ -3389,6 +4297,7 @@ static bool vkd3d_create_buffer_view_for_resource(struct d3d12_device *device,
     const struct vkd3d_format *format;
     struct vkd3d_view_key key;
     VkDeviceSize element_size;
+    bool raw_whole_buffer;
 
     if (view_format == DXGI_FORMAT_R32_TYPELESS && (flags & VKD3D_VIEW_RAW_BUFFER))
     {
@@ -3412,13 +4321,29 @@ static bool vkd3d_create_buffer_view_for_resource(struct d3d12_device *device,
 
     assert(d3d12_resource_is_buffer(resource));
 
+    /* With offset buffers, structured and raw views of a resource almost always
+     * quantize to one view covering the whole buffer. Skip hashing for that case. */
+    raw_whole_buffer = format->dxgi_format == DXGI_FORMAT_R32_UINT && element_size == format->byte_count &&
+            !offset && size == resource->desc.Width / element_size;
+
+    if (raw_whole_buffer && (*view = vkd3d_atomic_ptr_load_explicit(&resource->raw_buffer_view,
+            vkd3d_memory_order_acquire)))
+        return true;
+
     key.view_type = VKD3D_VIEW_TYPE_BUFFER;
     key.u.buffer.buffer = resource->res.vk_buffer;
     key.u.buffer.format = format;
     key.u.buffer.offset = resource->mem.offset + offset * element_size;
     key.u.buffer.size = size * element_size;
 
-    return !!(*view = vkd3d_view_map_create_view(&resource->view_map, device, &key));
+    if (!(*view = vkd3d_view_map_create_view(&resource->view_map, device, &key)))
+        return false;
+
+    /* The view map hands out the same view for the same key, so racing stores are benign. */
+    if (raw_whole_buffer)
+        vkd3d_atomic_ptr_store_explicit(&resource->raw_buffer_view, *view, vkd3d_memory_order_release);
+
+    return true;
 }
 
 static void vkd3d_set_view_swizzle_for_format(VkComponentMapping *components,
@@ -4661,23 +5586,6 @@ void d3d12_desc_create_uav(vkd3d_cpu_descriptor_va_t desc_va, struct d3d12_devic
         vkd3d_create_texture_uav(desc_va, device, resource, desc);
 }
 
-bool vkd3d_create_raw_buffer_view(struct d3d12_device *device,
-        D3D12_GPU_VIRTUAL_ADDRESS gpu_address, VkBufferView *vk_buffer_view)
-{
-    const struct vkd3d_unique_resource *resource;
-    uint64_t range;
-    uint64_t offset;
-
-    resource = vkd3d_va_map_deref(&device->memory_allocator.va_map, gpu_address);
-    assert(resource && resource->va && resource->size);
-
-    offset = gpu_address - resource->va;
-    range = min(resource->size - offset, device->vk_info.device_limits.maxStorageBufferRange);
-
-    return vkd3d_create_raw_r32ui_vk_buffer_view(device, resource->vk_buffer,
-            offset, range, vk_buffer_view);
-}
-
 /* samplers */
 static VkFilter vk_filter_from_d3d12(D3D12_FILTER_TYPE type)
 {
@@ -5184,7 +6092,7 @@ static ULONG STDMETHODCALLTYPE d3d12_descriptor_heap_Release(ID3D12DescriptorHea
 
         d3d12_descriptor_heap_cleanup(heap);
         vkd3d_private_store_destroy(&heap->private_store);
-        vkd3d_free_aligned(heap);
+        vkd3d_free_huge(heap, heap->host_huge_pages);
 
         d3d12_device_release(device);
     }
@@ -5359,6 +6267,9 @@ static HRESULT d3d12_descriptor_heap_create_descriptor_pool(struct d3d12_descrip
     return S_OK;
 }
 
+/* Null descriptors are written in slices so that the temporary info arrays stay small. */
+#define VKD3D_DESCRIPTOR_HEAP_ZERO_SLICE_SIZE 65536u
+
 static void d3d12_descriptor_heap_zero_initialize(struct d3d12_descriptor_heap *descriptor_heap,
         VkDescriptorType vk_descriptor_type, VkDescriptorSet vk_descriptor_set,
         uint32_t binding_index, uint32_t descriptor_count)
@@ -5368,21 +6279,24 @@ static void d3d12_descriptor_heap_zero_initialize(struct d3d12_descriptor_heap *
     VkDescriptorBufferInfo *buffer_infos = NULL;
     VkDescriptorImageInfo *image_infos = NULL;
     VkBufferView *buffer_view_infos = NULL;
+    uint32_t i, offset, slice_count;
     VkWriteDescriptorSet write;
-    uint32_t i;
+
+    if (!descriptor_count)
+        return;
 
     /* Clear out descriptor heap with the largest possible descriptor type we know of when using mutable descriptor type.
      * Purely for defensive purposes. */
     if (vk_descriptor_type == VK_DESCRIPTOR_TYPE_MUTABLE_VALVE)
         vk_descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
 
+    slice_count = min(descriptor_count, VKD3D_DESCRIPTOR_HEAP_ZERO_SLICE_SIZE);
+
     write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     write.pNext = NULL;
     write.descriptorType = vk_descriptor_type;
     write.dstSet = vk_descriptor_set;
     write.dstBinding = binding_index;
-    write.dstArrayElement = 0;
-    write.descriptorCount = descriptor_count;
     write.pTexelBufferView = NULL;
     write.pImageInfo = NULL;
     write.pBufferInfo = NULL;
@@ -5391,21 +6305,24 @@ static void d3d12_descriptor_heap_zero_initialize(struct d3d12_descriptor_heap *
     {
     case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
     case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
-        image_infos = vkd3d_calloc(descriptor_count, sizeof(*image_infos));
+        if (!(image_infos = vkd3d_calloc(slice_count, sizeof(*image_infos))))
+            goto fail;
         write.pImageInfo = image_infos;
         break;
 
     case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
     case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
-        buffer_infos = vkd3d_calloc(descriptor_count, sizeof(*buffer_infos));
+        if (!(buffer_infos = vkd3d_calloc(slice_count, sizeof(*buffer_infos))))
+            goto fail;
         write.pBufferInfo = buffer_infos;
-        for (i = 0; i < descriptor_count; i++)
+        for (i = 0; i < slice_count; i++)
             buffer_infos[i].range = VK_WHOLE_SIZE;
         break;
 
     case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
     case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-        buffer_view_infos = vkd3d_calloc(descriptor_count, sizeof(*buffer_view_infos));
+        if (!(buffer_view_infos = vkd3d_calloc(slice_count, sizeof(*buffer_view_infos))))
+            goto fail;
         write.pTexelBufferView = buffer_view_infos;
         break;
 
@@ -5413,10 +6330,22 @@ static void d3d12_descriptor_heap_zero_initialize(struct d3d12_descriptor_heap *
         break;
     }
 
-    VK_CALL(vkUpdateDescriptorSets(device->vk_device, 1, &write, 0, NULL));
+    /* The same null infos are reused for every slice. Updates to one set must be
+     * externally synchronized, so the slices are written from this thread only. */
+    for (offset = 0; offset < descriptor_count; offset += slice_count)
+    {
+        write.dstArrayElement = offset;
+        write.descriptorCount = min(slice_count, descriptor_count - offset);
+        VK_CALL(vkUpdateDescriptorSets(device->vk_device, 1, &write, 0, NULL));
+    }
+
     vkd3d_free(image_infos);
     vkd3d_free(buffer_view_infos);
     vkd3d_free(buffer_infos);
+    return;
+
+fail:
+    ERR("Failed to allocate null descriptor infos.\n");
 }
 
 static HRESULT d3d12_descriptor_heap_create_descriptor_set(struct d3d12_descriptor_heap *descriptor_heap,
@@ -5779,6 +6708,7 @@ HRESULT d3d12_descriptor_heap_create(struct d3d12_device *device,
     struct d3d12_descriptor_heap *object;
     unsigned int num_descriptor_bits = 0;
     unsigned int num_descriptors_pot = 0;
+    bool huge_pages = false;
     size_t required_size;
     size_t alignment;
     HRESULT hr;
@@ -5839,16 +6769,25 @@ HRESULT d3d12_descriptor_heap_create(struct d3d12_device *device,
         alignment = D3D12_DESC_ALIGNMENT;
     }
 
-    if (!(object = vkd3d_malloc_aligned(required_size, alignment)))
+    /* Copies decode descriptors at random offsets into the metadata, which
+     * misses the TLB constantly on large heaps with regular pages. */
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_HUGE_PAGES)
+        object = vkd3d_malloc_huge(required_size, alignment, &huge_pages);
+    else
+        object = vkd3d_malloc_aligned(required_size, alignment);
+
+    if (!object)
         return E_OUTOFMEMORY;
     memset(object, 0, required_size);
 
     if (FAILED(hr = d3d12_descriptor_heap_init(object, device, desc)))
     {
-        vkd3d_free_aligned(object);
+        vkd3d_free_huge(object, huge_pages);
         return hr;
     }
 
+    object->host_huge_pages = huge_pages;
+
     if (desc->Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || desc->Type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER)
     {
         /* See comments above on how this is supposed to work */
@@ -5863,8 +6802,8 @@ HRESULT d3d12_descriptor_heap_create(struct d3d12_device *device,
 
     TRACE("Created descriptor heap %p.\n", object);
 
-#ifdef VKD3D_ENABLE_DESCRIPTOR_QA
     object->cookie = vkd3d_allocate_cookie();
+#ifdef VKD3D_ENABLE_DESCRIPTOR_QA
     vkd3d_descriptor_debug_register_heap(object->descriptor_heap_info.host_ptr, object->cookie, desc);
 #endif
 
@@ -5875,7 +6814,6 @@ HRESULT d3d12_descriptor_heap_create(struct d3d12_device *device,
 
 void d3d12_descriptor_heap_cleanup(struct d3d12_descriptor_heap *descriptor_heap)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &descriptor_heap->device->vk_procs;
     struct d3d12_device *device = descriptor_heap->device;
 
     if (!descriptor_heap->device_allocation.vk_memory)
@@ -5884,10 +6822,10 @@ void d3d12_descriptor_heap_cleanup(struct d3d12_descriptor_heap *descriptor_heap
     if (descriptor_heap->gpu_va != 0)
         d3d12_device_return_descriptor_heap_gpu_va(device, descriptor_heap->gpu_va);
 
-    VK_CALL(vkDestroyBuffer(device->vk_device, descriptor_heap->vk_buffer, NULL));
+    vkd3d_deferred_destroy_buffer(device, descriptor_heap->vk_buffer);
     vkd3d_free_device_memory(device, &descriptor_heap->device_allocation);
 
-    VK_CALL(vkDestroyDescriptorPool(device->vk_device, descriptor_heap->vk_descriptor_pool, NULL));
+    vkd3d_deferred_destroy_descriptor_pool(device, descriptor_heap->vk_descriptor_pool);
 
     vkd3d_descriptor_debug_unregister_heap(descriptor_heap->cookie);
 }
@@ -6114,6 +7052,10 @@ HRESULT d3d12_query_heap_create(struct d3d12_device *device, const D3D12_QUERY_H
             return hr;
         }
 
+        /* Used by batched binary occlusion query resolves. */
+        if (device->device_info.buffer_device_address_features.bufferDeviceAddress)
+            object->va = vkd3d_get_buffer_device_address(device, object->vk_buffer);
+
         /* Explicit initialization is not required for these since
          * we can expect the buffer to be zero-initialized. */
         object->initialized = 1;
@@ -6298,9 +7240,78 @@ static void vkd3d_memory_info_init_budgets(struct vkd3d_memory_info *info,
 void vkd3d_memory_info_cleanup(struct vkd3d_memory_info *info,
         struct d3d12_device *device)
 {
+    /* The memory allocator is torn down later and may still free memory */
+    vkd3d_free(info->pending_flushes);
+    info->pending_flushes = NULL;
+    info->pending_flush_count = 0;
+    pthread_mutex_destroy(&info->flush_lock);
     pthread_mutex_destroy(&info->budget_lock);
 }
 
+void vkd3d_memory_info_queue_flush(struct vkd3d_memory_info *info, const VkMappedMemoryRange *range)
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&info->flush_lock);
+    count = info->pending_flush_count;
+
+    if (vkd3d_array_reserve((void **)&info->pending_flushes, &info->pending_flushes_size,
+            count + 1, sizeof(*info->pending_flushes)))
+    {
+        info->pending_flushes[count] = *range;
+        vkd3d_atomic_uint32_store_explicit(&info->pending_flush_count, count + 1, vkd3d_memory_order_relaxed);
+    }
+    else
+        ERR("Failed to queue memory flush.\n");
+
+    pthread_mutex_unlock(&info->flush_lock);
+}
+
+void vkd3d_memory_info_flush_pending(struct vkd3d_memory_info *info, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkResult vr;
+
+    /* Unmap happens-before the submission on the application side,
+     * so a relaxed check is enough to skip the lock in the common case. */
+    if (!vkd3d_atomic_uint32_load_explicit(&info->pending_flush_count, vkd3d_memory_order_relaxed))
+        return;
+
+    pthread_mutex_lock(&info->flush_lock);
+
+    if (info->pending_flush_count)
+    {
+        if ((vr = VK_CALL(vkFlushMappedMemoryRanges(device->vk_device,
+                info->pending_flush_count, info->pending_flushes))) < 0)
+            ERR("Failed to flush mapped memory ranges, vr %d.\n", vr);
+
+        vkd3d_atomic_uint32_store_explicit(&info->pending_flush_count, 0, vkd3d_memory_order_relaxed);
+    }
+
+    pthread_mutex_unlock(&info->flush_lock);
+}
+
+void vkd3d_memory_info_discard_flushes(struct vkd3d_memory_info *info, VkDeviceMemory vk_memory)
+{
+    uint32_t i, count;
+
+    if (!vkd3d_atomic_uint32_load_explicit(&info->pending_flush_count, vkd3d_memory_order_relaxed))
+        return;
+
+    /* Memory that is freed can no longer be used by the GPU, so dropping
+     * its pending flushes is fine, but flushing freed memory is not. */
+    pthread_mutex_lock(&info->flush_lock);
+
+    for (i = 0, count = 0; i < info->pending_flush_count; i++)
+    {
+        if (info->pending_flushes[i].memory != vk_memory)
+            info->pending_flushes[count++] = info->pending_flushes[i];
+    }
+
+    vkd3d_atomic_uint32_store_explicit(&info->pending_flush_count, count, vkd3d_memory_order_relaxed);
+    pthread_mutex_unlock(&info->flush_lock);
+}
+
 HRESULT vkd3d_memory_info_init(struct vkd3d_memory_info *info,
         struct d3d12_device *device)
 {
@@ -6327,6 +7338,12 @@ HRESULT vkd3d_memory_info_init(struct vkd3d_memory_info *info,
     if (pthread_mutex_init(&info->budget_lock, NULL) != 0)
         return E_OUTOFMEMORY;
 
+    if (pthread_mutex_init(&info->flush_lock, NULL) != 0)
+    {
+        pthread_mutex_destroy(&info->budget_lock);
+        return E_OUTOFMEMORY;
+    }
+
     memset(&buffer_info, 0, sizeof(buffer_info));
     buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buffer_info.size = 65536;
@@ -61,13 +61,12 @@ static void d3d12_root_signature_cleanup(struct d3d12_root_signature *root_signa
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
 
-    vkd3d_sampler_state_free_descriptor_set(&device->sampler_state, device,
-            root_signature->vk_sampler_set, root_signature->vk_sampler_pool);
+    vkd3d_sampler_state_release_static_sampler_set(&device->sampler_state, device,
+            root_signature->static_sampler_set);
 
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, root_signature->graphics.vk_pipeline_layout, NULL));
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, root_signature->compute.vk_pipeline_layout, NULL));
     VK_CALL(vkDestroyPipelineLayout(device->vk_device, root_signature->raygen.vk_pipeline_layout, NULL));
-    VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, root_signature->vk_sampler_descriptor_layout, NULL));
     VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, root_signature->vk_root_descriptor_layout, NULL));
 
     vkd3d_free(root_signature->parameters);
@@ -75,6 +74,195 @@ static void d3d12_root_signature_cleanup(struct d3d12_root_signature *root_signa
     vkd3d_free(root_signature->root_constants);
     vkd3d_free(root_signature->static_samplers);
     vkd3d_free(root_signature->static_samplers_desc);
+    vkd3d_free(root_signature->blob);
+}
+
+struct vkd3d_root_signature_cache_entry
+{
+    struct hash_map_entry entry;
+    vkd3d_shader_hash_t hash;
+    struct d3d12_root_signature *root_signature;
+};
+
+static uint32_t vkd3d_root_signature_cache_entry_hash(const void *key)
+{
+    return hash_uint64(*(const vkd3d_shader_hash_t *)key);
+}
+
+static bool vkd3d_root_signature_cache_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_root_signature_cache_entry *e = (const struct vkd3d_root_signature_cache_entry *)entry;
+    return e->hash == *(const vkd3d_shader_hash_t *)key;
+}
+
+struct vkd3d_root_signature_desc_cache_entry
+{
+    struct hash_map_entry entry;
+    vkd3d_shader_hash_t hash;
+    void *chunk;
+    size_t chunk_size;
+    struct vkd3d_versioned_root_signature_desc *desc;
+};
+
+/* Only a handful of distinct root signatures are expected, this just bounds the memory
+ * spent on applications which generate them. */
+#define VKD3D_ROOT_SIGNATURE_DESC_CACHE_MAX_COUNT 4096
+
+void vkd3d_root_signature_cache_init(struct vkd3d_root_signature_cache *cache)
+{
+    cache->spinlock = 0;
+    hash_map_init(&cache->map, &vkd3d_root_signature_cache_entry_hash,
+            &vkd3d_root_signature_cache_entry_compare, sizeof(struct vkd3d_root_signature_cache_entry));
+    hash_map_init(&cache->desc_map, &vkd3d_root_signature_cache_entry_hash,
+            &vkd3d_root_signature_cache_entry_compare, sizeof(struct vkd3d_root_signature_desc_cache_entry));
+}
+
+void vkd3d_root_signature_cache_cleanup(struct vkd3d_root_signature_cache *cache)
+{
+    struct vkd3d_root_signature_desc_cache_entry *e;
+    uint32_t i;
+
+    for (i = 0; i < cache->desc_map.entry_count; i++)
+    {
+        e = (struct vkd3d_root_signature_desc_cache_entry *)hash_map_get_entry(&cache->desc_map, i);
+
+        if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
+        {
+            vkd3d_shader_free_root_signature(e->desc);
+            vkd3d_free(e->desc);
+            vkd3d_free(e->chunk);
+        }
+    }
+
+    hash_map_clear(&cache->desc_map);
+    hash_map_clear(&cache->map);
+}
+
+static const struct vkd3d_versioned_root_signature_desc *vkd3d_root_signature_cache_find_desc(
+        struct vkd3d_root_signature_cache *cache, vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *chunk)
+{
+    const struct vkd3d_versioned_root_signature_desc *desc = NULL;
+    const struct vkd3d_root_signature_desc_cache_entry *e;
+
+    /* Cached descs are never modified or freed before the device, so they can be used outside the lock. */
+    spinlock_acquire(&cache->spinlock);
+    if ((e = (const struct vkd3d_root_signature_desc_cache_entry *)hash_map_find(&cache->desc_map, &hash)) &&
+            e->chunk_size == chunk->size && !memcmp(e->chunk, chunk->code, chunk->size))
+        desc = e->desc;
+    spinlock_release(&cache->spinlock);
+
+    return desc;
+}
+
+static bool vkd3d_root_signature_cache_insert_desc(struct vkd3d_root_signature_cache *cache,
+        vkd3d_shader_hash_t hash, const struct vkd3d_shader_code *chunk,
+        const struct vkd3d_versioned_root_signature_desc *desc)
+{
+    struct vkd3d_root_signature_desc_cache_entry entry;
+    bool inserted = false;
+
+    if (!(entry.chunk = vkd3d_malloc(chunk->size)))
+        return false;
+
+    if (!(entry.desc = vkd3d_malloc(sizeof(*entry.desc))))
+    {
+        vkd3d_free(entry.chunk);
+        return false;
+    }
+
+    memcpy(entry.chunk, chunk->code, chunk->size);
+    entry.chunk_size = chunk->size;
+    entry.hash = hash;
+    *entry.desc = *desc;
+
+    /* If another thread parsed the same root signature first, or the hash collides,
+     * the caller keeps ownership of its desc. */
+    spinlock_acquire(&cache->spinlock);
+    if (cache->desc_map.used_count < VKD3D_ROOT_SIGNATURE_DESC_CACHE_MAX_COUNT &&
+            !hash_map_find(&cache->desc_map, &hash))
+        inserted = !!hash_map_insert(&cache->desc_map, &hash, &entry.entry);
+    spinlock_release(&cache->spinlock);
+
+    if (!inserted)
+    {
+        vkd3d_free(entry.desc);
+        vkd3d_free(entry.chunk);
+    }
+
+    return inserted;
+}
+
+static bool d3d12_root_signature_try_add_ref(struct d3d12_root_signature *root_signature)
+{
+    uint32_t cur_refcount, cas_refcount;
+
+    /* Never resurrect a root signature which is already being destroyed. */
+    cur_refcount = vkd3d_atomic_uint32_load_explicit((uint32_t*)&root_signature->refcount, vkd3d_memory_order_relaxed);
+
+    while (cur_refcount)
+    {
+        cas_refcount = vkd3d_atomic_uint32_compare_exchange((uint32_t*)&root_signature->refcount, cur_refcount,
+                cur_refcount + 1, vkd3d_memory_order_acquire, vkd3d_memory_order_relaxed);
+
+        if (cas_refcount == cur_refcount)
+            return true;
+
+        cur_refcount = cas_refcount;
+    }
+
+    return false;
+}
+
+static struct d3d12_root_signature *vkd3d_root_signature_cache_find(struct vkd3d_root_signature_cache *cache,
+        vkd3d_shader_hash_t hash, const void *blob, size_t blob_size)
+{
+    struct d3d12_root_signature *root_signature = NULL;
+    const struct vkd3d_root_signature_cache_entry *e;
+
+    spinlock_acquire(&cache->spinlock);
+    if ((e = (const struct vkd3d_root_signature_cache_entry *)hash_map_find(&cache->map, &hash)) &&
+            e->root_signature && e->root_signature->blob_size == blob_size &&
+            !memcmp(e->root_signature->blob, blob, blob_size) &&
+            d3d12_root_signature_try_add_ref(e->root_signature))
+        root_signature = e->root_signature;
+    spinlock_release(&cache->spinlock);
+
+    return root_signature;
+}
+
+static void vkd3d_root_signature_cache_insert(struct vkd3d_root_signature_cache *cache,
+        struct d3d12_root_signature *root_signature)
+{
+    struct vkd3d_root_signature_cache_entry *e, entry;
+
+    spinlock_acquire(&cache->spinlock);
+    if ((e = (struct vkd3d_root_signature_cache_entry *)hash_map_find(&cache->map, &root_signature->compatibility_hash)))
+    {
+        /* Entries cannot be removed from the map, so reuse stale ones. If we raced with
+         * another thread creating the same root signature, keep the existing object. */
+        if (!e->root_signature || !vkd3d_atomic_uint32_load_explicit((uint32_t*)&e->root_signature->refcount,
+                vkd3d_memory_order_relaxed))
+            e->root_signature = root_signature;
+    }
+    else
+    {
+        entry.hash = root_signature->compatibility_hash;
+        entry.root_signature = root_signature;
+        hash_map_insert(&cache->map, &entry.hash, &entry.entry);
+    }
+    spinlock_release(&cache->spinlock);
+}
+
+static void vkd3d_root_signature_cache_remove(struct vkd3d_root_signature_cache *cache,
+        struct d3d12_root_signature *root_signature)
+{
+    struct vkd3d_root_signature_cache_entry *e;
+
+    spinlock_acquire(&cache->spinlock);
+    if ((e = (struct vkd3d_root_signature_cache_entry *)hash_map_find(&cache->map, &root_signature->compatibility_hash)) &&
+            e->root_signature == root_signature)
+        e->root_signature = NULL;
+    spinlock_release(&cache->spinlock);
 }
 
 static ULONG STDMETHODCALLTYPE d3d12_root_signature_Release(ID3D12RootSignature *iface)
@@ -87,6 +275,7 @@ static ULONG STDMETHODCALLTYPE d3d12_root_signature_Release(ID3D12RootSignature
     if (!refcount)
     {
         struct d3d12_device *device = root_signature->device;
+        vkd3d_root_signature_cache_remove(&device->root_signature_cache, root_signature);
         vkd3d_private_store_destroy(&root_signature->private_store);
         d3d12_root_signature_cleanup(root_signature, device);
         vkd3d_free(root_signature);
@@ -334,6 +523,7 @@ struct d3d12_root_signature_info
     uint32_t push_descriptor_count;
     uint32_t root_constant_count;
     uint32_t hoist_descriptor_count;
+    uint32_t hoist_va_descriptor_count;
     bool has_raw_va_aux_buffer;
     bool has_ssbo_offset_buffer;
     bool has_typed_offset_buffer;
@@ -363,6 +553,25 @@ static bool d3d12_descriptor_range_can_hoist_cbv_descriptor(
             (vkd3d_config_flags & VKD3D_CONFIG_FLAG_FORCE_STATIC_CBV);
 }
 
+static bool d3d12_descriptor_range_can_hoist_srv_uav_descriptor(
+        struct d3d12_device *device, const D3D12_DESCRIPTOR_RANGE1 *range)
+{
+    /* SRVs and UAVs are hoisted to raw VA root descriptors, which only works for
+     * raw and structured buffers. The shader interface restricts the binding to those,
+     * other kinds of resources still go through the descriptor heap. */
+    if (!(device->bindless_state.flags & VKD3D_HOIST_STATIC_TABLE_SRV_UAV) ||
+            (range->RangeType != D3D12_DESCRIPTOR_RANGE_TYPE_SRV &&
+            range->RangeType != D3D12_DESCRIPTOR_RANGE_TYPE_UAV) ||
+            range->NumDescriptors != 1)
+    {
+        return false;
+    }
+
+    /* Descriptors are latched at draw time, and root descriptors have no bounds checking. */
+    return !(range->Flags & (D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE |
+            D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_STATIC_KEEPING_BUFFER_BOUNDS_CHECKS));
+}
+
 static void d3d12_root_signature_info_count_srv_uav_table(struct d3d12_root_signature_info *info,
         struct d3d12_device *device)
 {
@@ -397,6 +606,11 @@ static HRESULT d3d12_root_signature_info_count_descriptors(struct d3d12_root_sig
     {
         case D3D12_DESCRIPTOR_RANGE_TYPE_SRV:
         case D3D12_DESCRIPTOR_RANGE_TYPE_UAV:
+            if (!(desc->Flags & D3D12_ROOT_SIGNATURE_FLAG_LOCAL_ROOT_SIGNATURE) &&
+                    d3d12_descriptor_range_can_hoist_srv_uav_descriptor(device, range))
+            {
+                info->hoist_va_descriptor_count += 1;
+            }
             d3d12_root_signature_info_count_srv_uav_table(info, device);
             break;
         case D3D12_DESCRIPTOR_RANGE_TYPE_CBV:
@@ -421,6 +635,9 @@ static HRESULT d3d12_root_signature_info_count_descriptors(struct d3d12_root_sig
 static HRESULT d3d12_root_signature_info_from_desc(struct d3d12_root_signature_info *info,
         struct d3d12_device *device, const D3D12_ROOT_SIGNATURE_DESC1 *desc)
 {
+    uint32_t max_push_constant_words;
+    uint32_t max_hoist_va_descriptors;
+    uint32_t max_push_descriptors;
     bool local_root_signature;
     unsigned int i, j;
     HRESULT hr;
@@ -495,14 +712,40 @@ static HRESULT d3d12_root_signature_info_from_desc(struct d3d12_root_signature_i
 
     if (!local_root_signature)
     {
-        info->push_descriptor_count += info->hoist_descriptor_count;
+        max_push_descriptors = device->vk_info.KHR_push_descriptor
+                ? device->device_info.push_descriptor_properties.maxPushDescriptors : 0;
+
         info->hoist_descriptor_count = min(info->hoist_descriptor_count, VKD3D_MAX_HOISTED_DESCRIPTORS);
         info->hoist_descriptor_count = min(info->hoist_descriptor_count, D3D12_MAX_ROOT_COST - desc->NumParameters);
+
+        /* Hoisting is only a win as long as the root descriptor set can still be pushed.
+         * Otherwise we would force a descriptor set allocation and update on every draw. */
+        if (info->push_descriptor_count <= max_push_descriptors)
+        {
+            info->hoist_descriptor_count = min(info->hoist_descriptor_count,
+                    max_push_descriptors - info->push_descriptor_count);
+        }
+
+        info->push_descriptor_count += info->hoist_descriptor_count;
         info->binding_count += info->hoist_descriptor_count;
         info->binding_count += desc->NumStaticSamplers;
+
+        /* Hoisted raw VAs live next to the root descriptor VAs in push constants. The root cost
+         * is an upper bound for the push constant size, so only hoist as long as that still fits
+         * and we do not have to fall back to an inline uniform block. */
+        max_push_constant_words = device->device_info.properties2.properties.limits.maxPushConstantsSize / sizeof(uint32_t);
+        max_hoist_va_descriptors = max_push_constant_words > info->cost
+                ? (max_push_constant_words - info->cost) / 2 : 0;
+
+        info->hoist_va_descriptor_count = min(info->hoist_va_descriptor_count, max_hoist_va_descriptors);
+        info->hoist_va_descriptor_count = min(info->hoist_va_descriptor_count,
+                VKD3D_MAX_HOISTED_DESCRIPTORS - info->hoist_descriptor_count);
+        info->hoist_va_descriptor_count = min(info->hoist_va_descriptor_count,
+                D3D12_MAX_ROOT_COST - desc->NumParameters - info->hoist_descriptor_count);
+        info->binding_count += info->hoist_va_descriptor_count;
     }
 
-    info->parameter_count = desc->NumParameters + info->hoist_descriptor_count;
+    info->parameter_count = desc->NumParameters + info->hoist_descriptor_count + info->hoist_va_descriptor_count;
     return S_OK;
 }
 
@@ -550,7 +793,7 @@ static HRESULT d3d12_root_signature_init_push_constants(struct d3d12_root_signat
         const D3D12_ROOT_SIGNATURE_DESC1 *desc, const struct d3d12_root_signature_info *info,
         struct VkPushConstantRange *push_constant_range)
 {
-    unsigned int i, j;
+    unsigned int i, j, k;
 
     /* Stages set later. */
     push_constant_range->stageFlags = 0;
@@ -569,6 +812,26 @@ static HRESULT d3d12_root_signature_init_push_constants(struct d3d12_root_signat
         }
     }
 
+    /* Hoisted SRV and UAV descriptors follow the actual root descriptors */
+    for (i = 0, j = 0; i < desc->NumParameters && j < info->hoist_va_descriptor_count; ++i)
+    {
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
+
+        if (p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+            continue;
+
+        for (k = 0; k < p->DescriptorTable.NumDescriptorRanges && j < info->hoist_va_descriptor_count; ++k)
+        {
+            if (d3d12_descriptor_range_can_hoist_srv_uav_descriptor(root_signature->device,
+                    &p->DescriptorTable.pDescriptorRanges[k]))
+            {
+                push_constant_range->stageFlags |= vkd3d_vk_stage_flags_from_visibility(p->ShaderVisibility);
+                push_constant_range->size += sizeof(VkDeviceSize);
+                ++j;
+            }
+        }
+    }
+
     /* Append actual root constants */
     for (i = 0, j = 0; i < desc->NumParameters; ++i)
     {
@@ -989,6 +1252,12 @@ static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_sign
                     param->parameter_type = D3D12_ROOT_PARAMETER_TYPE_CBV;
                     param->descriptor.binding = binding;
 
+                    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_LOG)
+                    {
+                        INFO("Hoisting CBV b%u, space %u in table %u to push descriptor.\n",
+                                range->BaseShaderRegister, range->RegisterSpace, i);
+                    }
+
                     context->binding_index += 1;
                     context->vk_binding += 1;
                     hoisted_parameter_index += 1;
@@ -1046,6 +1315,67 @@ static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_sign
             context->vk_binding += 1;
     }
 
+    /* Hoisted raw VAs must come after the actual root descriptors, since the order of
+     * root descriptor bindings has to match the order of VAs in push constant space. */
+    for (i = 0; i < desc->NumParameters && info->hoist_va_descriptor_count; ++i)
+    {
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
+        unsigned int range_descriptor_offset = 0;
+
+        if (p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+            continue;
+
+        for (k = 0; k < p->DescriptorTable.NumDescriptorRanges && info->hoist_va_descriptor_count; k++)
+        {
+            range = &p->DescriptorTable.pDescriptorRanges[k];
+            if (range->OffsetInDescriptorsFromTableStart != D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND)
+                range_descriptor_offset = range->OffsetInDescriptorsFromTableStart;
+
+            if (d3d12_descriptor_range_can_hoist_srv_uav_descriptor(root_signature->device, range))
+            {
+                root_signature->root_descriptor_raw_va_mask |= 1ull << hoisted_parameter_index;
+                hoist_desc = &root_signature->hoist_info.desc[root_signature->hoist_info.num_desc];
+                hoist_desc->table_index = i;
+                hoist_desc->parameter_index = hoisted_parameter_index;
+                hoist_desc->table_offset = range_descriptor_offset;
+                root_signature->hoist_info.num_desc++;
+
+                /* The table binding still serves typed buffers, textures and UAV counters. */
+                binding = &root_signature->bindings[context->binding_index];
+                binding->type = vkd3d_descriptor_type_from_d3d12_range_type(range->RangeType);
+                binding->register_space = range->RegisterSpace;
+                binding->register_index = range->BaseShaderRegister;
+                binding->register_count = 1;
+                binding->descriptor_table = 0;  /* ignored */
+                binding->descriptor_offset = 0; /* ignored */
+                binding->shader_visibility = vkd3d_shader_visibility_from_d3d12(p->ShaderVisibility);
+                binding->flags = VKD3D_SHADER_BINDING_FLAG_BUFFER | VKD3D_SHADER_BINDING_FLAG_RAW_SSBO |
+                        VKD3D_SHADER_BINDING_FLAG_RAW_VA | VKD3D_SHADER_BINDING_FLAG_RAW_BUFFER_ONLY;
+                binding->binding.binding = 0; /* ignored */
+                binding->binding.set = 0; /* ignored */
+
+                param = &root_signature->parameters[hoisted_parameter_index];
+                param->parameter_type = range->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SRV
+                        ? D3D12_ROOT_PARAMETER_TYPE_SRV : D3D12_ROOT_PARAMETER_TYPE_UAV;
+                param->descriptor.binding = binding;
+
+                if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_LOG)
+                {
+                    INFO("Hoisting %s %c%u, space %u in table %u to raw VA root descriptor.\n",
+                            range->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SRV ? "SRV" : "UAV",
+                            range->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SRV ? 't' : 'u',
+                            range->BaseShaderRegister, range->RegisterSpace, i);
+                }
+
+                context->binding_index += 1;
+                hoisted_parameter_index += 1;
+                info->hoist_va_descriptor_count -= 1;
+            }
+
+            range_descriptor_offset += range->NumDescriptors;
+        }
+    }
+
     if (root_signature->flags & VKD3D_ROOT_SIGNATURE_USE_INLINE_UNIFORM_BLOCK)
     {
         vk_binding = &vk_binding_info[j++];
@@ -1145,13 +1475,13 @@ static HRESULT d3d12_root_signature_init_static_samplers(struct d3d12_root_signa
         context->vk_binding += 1;
     }
 
-    if (FAILED(hr = vkd3d_create_descriptor_set_layout(root_signature->device, 0,
-            desc->NumStaticSamplers, vk_binding_info, &root_signature->vk_sampler_descriptor_layout)))
+    if (FAILED(hr = vkd3d_sampler_state_acquire_static_sampler_set(&root_signature->device->sampler_state,
+            root_signature->device, desc->NumStaticSamplers, vk_binding_info,
+            &root_signature->static_sampler_set)))
         goto cleanup;
 
-    hr = vkd3d_sampler_state_allocate_descriptor_set(&root_signature->device->sampler_state,
-            root_signature->device, root_signature->vk_sampler_descriptor_layout,
-            &root_signature->vk_sampler_set, &root_signature->vk_sampler_pool);
+    *vk_set_layout = root_signature->static_sampler_set->vk_set_layout;
+    root_signature->vk_sampler_set = root_signature->static_sampler_set->vk_set;
 
 cleanup:
     vkd3d_free(vk_binding_info);
@@ -1299,7 +1629,8 @@ static HRESULT d3d12_root_signature_init_global(struct d3d12_root_signature *roo
 
     if (root_signature->push_constant_range.size <= vk_device_properties->limits.maxPushConstantsSize)
     {
-        if (info.push_descriptor_count > device->device_info.push_descriptor_properties.maxPushDescriptors)
+        if (info.push_descriptor_count && (!device->vk_info.KHR_push_descriptor ||
+                info.push_descriptor_count > device->device_info.push_descriptor_properties.maxPushDescriptors))
             root_signature->flags |= VKD3D_ROOT_SIGNATURE_USE_ROOT_DESCRIPTOR_SET;
     }
     else if (device->device_info.inline_uniform_block_features.inlineUniformBlock)
@@ -1420,6 +1751,7 @@ static HRESULT d3d12_root_signature_init(struct d3d12_root_signature *root_signa
     memset(root_signature, 0, sizeof(*root_signature));
     root_signature->ID3D12RootSignature_iface.lpVtbl = &d3d12_root_signature_vtbl;
     root_signature->refcount = 1;
+    root_signature->cookie = vkd3d_allocate_cookie();
 
     root_signature->d3d12_flags = desc->Flags;
     /* needed by some methods, increment ref count later */
@@ -1455,11 +1787,45 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
         D3D12_VERSIONED_ROOT_SIGNATURE_DESC d3d12;
         struct vkd3d_versioned_root_signature_desc vkd3d;
     } root_signature_desc;
+    const struct vkd3d_versioned_root_signature_desc *cached_desc;
     struct d3d12_root_signature *object;
+    vkd3d_shader_hash_t hash, chunk_hash;
+    struct vkd3d_shader_code chunk;
     HRESULT hr;
     int ret;
 
-    if ((ret = vkd3d_parse_root_signature_v_1_1(&dxbc, &root_signature_desc.vkd3d)) < 0)
+    /* For pipeline libraries, (and later DXR to some degree), we need a way to
+     * compare root signature objects. */
+    hash = vkd3d_shader_hash(&dxbc);
+
+    /* Applications tend to create the same root signature over and over,
+     * e.g. once per PSO. Sharing the object avoids building new Vulkan layouts
+     * and lets SetRootSignature skip redundant rebinds. */
+    if ((object = vkd3d_root_signature_cache_find(&device->root_signature_cache, hash, bytecode, bytecode_length)))
+    {
+        TRACE("Reusing root signature %p.\n", object);
+        *root_signature = object;
+        return S_OK;
+    }
+
+    /* Embedded root signatures are re-created for every PSO which uses them, with a
+     * different shader around the same RTS0 chunk, so cache the parsed desc by chunk. */
+    if (vkd3d_shader_extract_root_signature(&dxbc, &chunk) >= 0)
+    {
+        chunk_hash = vkd3d_shader_hash_fast(&chunk);
+        cached_desc = vkd3d_root_signature_cache_find_desc(&device->root_signature_cache, chunk_hash, &chunk);
+    }
+    else
+    {
+        chunk.code = NULL;
+        chunk.size = 0;
+        chunk_hash = 0;
+        cached_desc = NULL;
+    }
+
+    if (cached_desc)
+        root_signature_desc.vkd3d = *cached_desc;
+    else if ((ret = vkd3d_parse_root_signature_v_1_1(&dxbc, &root_signature_desc.vkd3d)) < 0)
     {
         WARN("Failed to parse root signature, vkd3d result %d.\n", ret);
         return hresult_from_vkd3d_result(ret);
@@ -1467,17 +1833,18 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
 
     if (!(object = vkd3d_malloc(sizeof(*object))))
     {
-        vkd3d_shader_free_root_signature(&root_signature_desc.vkd3d);
+        if (!cached_desc)
+            vkd3d_shader_free_root_signature(&root_signature_desc.vkd3d);
         return E_OUTOFMEMORY;
     }
 
     hr = d3d12_root_signature_init(object, device, &root_signature_desc.d3d12.Desc_1_1);
+    object->compatibility_hash = hash;
 
-    /* For pipeline libraries, (and later DXR to some degree), we need a way to
-     * compare root signature objects. */
-    object->compatibility_hash = vkd3d_shader_hash(&dxbc);
+    if (!cached_desc && (FAILED(hr) || !chunk.code || !vkd3d_root_signature_cache_insert_desc(
+            &device->root_signature_cache, chunk_hash, &chunk, &root_signature_desc.vkd3d)))
+        vkd3d_shader_free_root_signature(&root_signature_desc.vkd3d);
 
-    vkd3d_shader_free_root_signature(&root_signature_desc.vkd3d);
     if (FAILED(hr))
     {
         vkd3d_free(object);
@@ -1486,6 +1853,13 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
 
     TRACE("Created root signature %p.\n", object);
 
+    if ((object->blob = vkd3d_malloc(bytecode_length)))
+    {
+        memcpy(object->blob, bytecode, bytecode_length);
+        object->blob_size = bytecode_length;
+        vkd3d_root_signature_cache_insert(&device->root_signature_cache, object);
+    }
+
     *root_signature = object;
 
     return S_OK;
@@ -1515,13 +1889,26 @@ unsigned int d3d12_root_signature_get_shader_interface_flags(const struct d3d12_
 /* vkd3d_render_pass_cache */
 struct vkd3d_render_pass_entry
 {
+    struct vkd3d_render_pass_entry *next;
     struct vkd3d_render_pass_key key;
+    uint32_t hash;
     VkRenderPass vk_render_pass;
 };
 
 /* Ensure that key is packed, and can be memcmp'd. */
 STATIC_ASSERT(sizeof(struct vkd3d_render_pass_key) == 52);
 
+static uint32_t vkd3d_render_pass_key_hash(const struct vkd3d_render_pass_key *key)
+{
+    const uint32_t *words = (const uint32_t *)key;
+    uint32_t hash = 0;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(*key) / sizeof(uint32_t); i++)
+        hash = hash_combine(hash, words[i]);
+    return hash;
+}
+
 static VkImageLayout vkd3d_render_pass_get_depth_stencil_layout(const struct vkd3d_render_pass_key *key)
 {
     if (!(key->flags & VKD3D_RENDER_PASS_KEY_DEPTH_STENCIL_ENABLE))
@@ -1537,14 +1924,13 @@ static VkImageLayout vkd3d_render_pass_get_depth_stencil_layout(const struct vkd
         return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 }
 
-static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pass_cache *cache,
-        struct d3d12_device *device, const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
+static HRESULT vkd3d_render_pass_create(struct d3d12_device *device,
+        const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
 {
     VkAttachmentReference2KHR attachment_references[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 2];
     VkAttachmentDescription2KHR attachments[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 2];
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkFragmentShadingRateAttachmentInfoKHR vrs_attachment_info;
-    struct vkd3d_render_pass_entry *entry;
     unsigned int index, attachment_index;
     VkSubpassDependency2KHR dependencies[2];
     VkSubpassDescription2KHR sub_pass_desc;
@@ -1554,17 +1940,6 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     unsigned int rt_count;
     VkResult vr;
 
-    if (!vkd3d_array_reserve((void **)&cache->render_passes, &cache->render_passes_size,
-            cache->render_pass_count + 1, sizeof(*cache->render_passes)))
-    {
-        *vk_render_pass = VK_NULL_HANDLE;
-        return E_OUTOFMEMORY;
-    }
-
-    entry = &cache->render_passes[cache->render_pass_count];
-
-    entry->key = *key;
-
     have_depth_stencil = !!(key->flags & VKD3D_RENDER_PASS_KEY_DEPTH_STENCIL_ENABLE);
     rt_count = have_depth_stencil ? key->attachment_count - 1 : key->attachment_count;
     assert(rt_count <= D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT);
@@ -1728,12 +2103,7 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     pass_info.correlatedViewMaskCount = 0;
     pass_info.pCorrelatedViewMasks = NULL;
 
-    if ((vr = VK_CALL(vkCreateRenderPass2KHR(device->vk_device, &pass_info, NULL, vk_render_pass))) >= 0)
-    {
-        entry->vk_render_pass = *vk_render_pass;
-        ++cache->render_pass_count;
-    }
-    else
+    if ((vr = VK_CALL(vkCreateRenderPass2KHR(device->vk_device, &pass_info, NULL, vk_render_pass))) < 0)
     {
         WARN("Failed to create Vulkan render pass, vr %d.\n", vr);
         *vk_render_pass = VK_NULL_HANDLE;
@@ -1742,74 +2112,108 @@ static HRESULT vkd3d_render_pass_cache_create_pass_locked(struct vkd3d_render_pa
     return hresult_from_vk_result(vr);
 }
 
+static const struct vkd3d_render_pass_entry *vkd3d_render_pass_cache_find_entry(
+        const struct vkd3d_render_pass_entry *head, const struct vkd3d_render_pass_entry *end,
+        const struct vkd3d_render_pass_key *key, uint32_t hash)
+{
+    const struct vkd3d_render_pass_entry *entry;
+
+    for (entry = head; entry != end; entry = entry->next)
+    {
+        if (entry->hash == hash && !memcmp(&entry->key, key, sizeof(*key)))
+            return entry;
+    }
+
+    return NULL;
+}
+
 HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device, const struct vkd3d_render_pass_key *key, VkRenderPass *vk_render_pass)
 {
-    size_t searched_count;
-    bool found = false;
-    HRESULT hr = S_OK;
-    size_t i;
+    struct vkd3d_render_pass_entry *head, *searched_head, *entry;
+    const struct vkd3d_render_pass_entry *found;
+    struct vkd3d_render_pass_entry **bucket;
+    uint32_t hash;
+    HRESULT hr;
+
+    hash = vkd3d_render_pass_key_hash(key);
+    bucket = &cache->buckets[hash % VKD3D_RENDER_PASS_CACHE_BUCKET_COUNT];
 
-    rw_spinlock_acquire_read(&cache->lock);
-    for (i = 0; i < cache->render_pass_count; ++i)
+    /* Acquire pairs with the release in the insert path below, so that
+     * a published entry is always observed fully initialized. */
+    searched_head = vkd3d_atomic_ptr_load_explicit(bucket, vkd3d_memory_order_acquire);
+    if ((found = vkd3d_render_pass_cache_find_entry(searched_head, NULL, key, hash)))
     {
-        struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
+        *vk_render_pass = found->vk_render_pass;
+        return S_OK;
+    }
 
-        if (!memcmp(&current->key, key, sizeof(*key)))
-        {
-            *vk_render_pass = current->vk_render_pass;
-            found = true;
-            break;
-        }
+    spinlock_acquire(&cache->lock);
+
+    /* Entries are only prepended, so anything another thread inserted
+     * in the meantime sits in front of the head we already searched. */
+    head = *bucket;
+    if ((found = vkd3d_render_pass_cache_find_entry(head, searched_head, key, hash)))
+    {
+        *vk_render_pass = found->vk_render_pass;
+        spinlock_release(&cache->lock);
+        return S_OK;
     }
-    searched_count = cache->render_pass_count;
-    rw_spinlock_release_read(&cache->lock);
 
-    if (!found)
+    if (!(entry = vkd3d_malloc(sizeof(*entry))))
     {
-        rw_spinlock_acquire_write(&cache->lock);
-        /* If another thread came in and wrote the render pass we want in between the read unlock and write lock,
-         * find it now. */
-        for (i = searched_count; i < cache->render_pass_count; ++i)
-        {
-            struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
+        spinlock_release(&cache->lock);
+        *vk_render_pass = VK_NULL_HANDLE;
+        return E_OUTOFMEMORY;
+    }
 
-            if (!memcmp(&current->key, key, sizeof(*key)))
-            {
-                *vk_render_pass = current->vk_render_pass;
-                rw_spinlock_release_write(&cache->lock);
-                return S_OK;
-            }
-        }
-        hr = vkd3d_render_pass_cache_create_pass_locked(cache, device, key, vk_render_pass);
-        rw_spinlock_release_write(&cache->lock);
+    if (FAILED(hr = vkd3d_render_pass_create(device, key, vk_render_pass)))
+    {
+        spinlock_release(&cache->lock);
+        vkd3d_free(entry);
+        return hr;
     }
 
-    return hr;
+    entry->next = head;
+    entry->key = *key;
+    entry->hash = hash;
+    entry->vk_render_pass = *vk_render_pass;
+    vkd3d_atomic_ptr_store_explicit(bucket, entry, vkd3d_memory_order_release);
+    cache->render_pass_count++;
+
+    spinlock_release(&cache->lock);
+    return S_OK;
 }
 
 void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache)
 {
-    cache->render_passes = NULL;
+    memset(cache->buckets, 0, sizeof(cache->buckets));
     cache->render_pass_count = 0;
-    cache->render_passes_size = 0;
-    cache->lock = 0;
+    spinlock_init(&cache->lock);
 }
 
 void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
         struct d3d12_device *device)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_render_pass_entry *entry, *next;
     unsigned int i;
 
-    for (i = 0; i < cache->render_pass_count; ++i)
+    TRACE("Destroying %zu render passes.\n", cache->render_pass_count);
+
+    for (i = 0; i < ARRAY_SIZE(cache->buckets); ++i)
     {
-        struct vkd3d_render_pass_entry *current = &cache->render_passes[i];
-        VK_CALL(vkDestroyRenderPass(device->vk_device, current->vk_render_pass, NULL));
+        for (entry = cache->buckets[i]; entry; entry = next)
+        {
+            next = entry->next;
+            VK_CALL(vkDestroyRenderPass(device->vk_device, entry->vk_render_pass, NULL));
+            vkd3d_free(entry);
+        }
+
+        cache->buckets[i] = NULL;
     }
 
-    vkd3d_free(cache->render_passes);
-    cache->render_passes = NULL;
+    cache->render_pass_count = 0;
 }
 
 static void d3d12_promote_depth_stencil_desc(D3D12_DEPTH_STENCIL_DESC1 *out, const D3D12_DEPTH_STENCIL_DESC *in)
@@ -1984,39 +2388,288 @@ HRESULT vkd3d_pipeline_state_desc_from_d3d12_stream_desc(struct d3d12_pipeline_s
             VKD3D_HANDLE_SUBOBJECT(DEPTH_STENCIL1, D3D12_DEPTH_STENCIL_DESC1, desc->depth_stencil_state);
             VKD3D_HANDLE_SUBOBJECT(VIEW_INSTANCING, D3D12_VIEW_INSTANCING_DESC, desc->view_instancing_desc);
 
-            default:
-                ERR("Unhandled pipeline subobject type %u.\n", subobject_type);
-                return E_INVALIDARG;
-        }
+            default:
+                ERR("Unhandled pipeline subobject type %u.\n", subobject_type);
+                return E_INVALIDARG;
+        }
+    }
+
+    /* Deduce pipeline type from specified shaders */
+    is_graphics = desc->vs.pShaderBytecode && desc->vs.BytecodeLength;
+    is_compute = desc->cs.pShaderBytecode && desc->cs.BytecodeLength;
+
+    if (is_graphics == is_compute)
+    {
+        ERR("Cannot deduce pipeline type.\n");
+        return E_INVALIDARG;
+    }
+
+    *vk_bind_point = is_graphics
+        ? VK_PIPELINE_BIND_POINT_GRAPHICS
+        : VK_PIPELINE_BIND_POINT_COMPUTE;
+    return S_OK;
+}
+
+#undef VKD3D_HANDLE_SUBOBJECT
+#undef VKD3D_HANDLE_SUBOBJECT_EXPLICIT
+
+struct vkd3d_compiled_pipeline
+{
+    struct list entry;
+    struct vkd3d_pipeline_key key;
+    VkPipeline vk_pipeline;
+    struct vkd3d_render_pass_compatibility render_pass_compat;
+    uint32_t dynamic_state_flags;
+};
+
+static VkPipelineCache d3d12_pipeline_state_get_vk_pipeline_cache(struct d3d12_pipeline_state *state)
+{
+    return state->vk_pso_cache ? state->vk_pso_cache : state->device->global_pipeline_cache;
+}
+
+static bool d3d12_pipeline_state_has_static_pipeline(struct d3d12_pipeline_state *state)
+{
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_COUNT; i++)
+    {
+        if (state->graphics.pipeline[i])
+            return true;
+    }
+
+    return false;
+}
+
+static void vkd3d_pipeline_compile_worker_execute_job(struct vkd3d_pipeline_compile_worker *worker,
+        const struct vkd3d_pipeline_compile_job *job)
+{
+    struct vkd3d_render_pass_compatibility render_pass_compat;
+    struct d3d12_pipeline_state *state = job->state;
+    uint32_t dynamic_state_flags;
+    VkPipeline vk_pipeline;
+
+    TRACE("Compiling fallback pipeline for state %p.\n", state);
+
+    vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state, &job->pipeline->key, job->dsv_format,
+            d3d12_pipeline_state_get_vk_pipeline_cache(state), &render_pass_compat, &dynamic_state_flags,
+            job->pipeline->key.variant_flags);
+
+    if (!vk_pipeline)
+    {
+        /* The entry stays pending, so draws with this state keep being skipped
+         * like they would be if a synchronous compile failed. */
+        ERR("Failed to create fallback pipeline for state %p.\n", state);
+        return;
+    }
+
+    rw_spinlock_acquire_write(&state->lock);
+    job->pipeline->render_pass_compat = render_pass_compat;
+    job->pipeline->dynamic_state_flags = dynamic_state_flags;
+    job->pipeline->vk_pipeline = vk_pipeline;
+    rw_spinlock_release_write(&state->lock);
+}
+
+static void *vkd3d_pipeline_compile_worker_main(void *arg)
+{
+    struct vkd3d_pipeline_compile_worker *worker = arg;
+    struct vkd3d_pipeline_compile_job job;
+    uint32_t slot;
+    int rc;
+
+    vkd3d_set_thread_name("vkd3d_pipeline");
+
+    for (;;)
+    {
+        if ((rc = pthread_mutex_lock(&worker->mutex)))
+        {
+            ERR("Failed to lock mutex, error %d.\n", rc);
+            break;
+        }
+
+        while (!worker->job_count && !worker->should_exit)
+        {
+            if ((rc = pthread_cond_wait(&worker->cond, &worker->mutex)))
+            {
+                ERR("Failed to wait on condition variable, error %d.\n", rc);
+                break;
+            }
+        }
+
+        if (!worker->job_count)
+        {
+            pthread_mutex_unlock(&worker->mutex);
+            break;
+        }
+
+        job = worker->jobs[0];
+        memmove(worker->jobs, worker->jobs + 1, --worker->job_count * sizeof(*worker->jobs));
+
+        /* There are never more active jobs than threads. */
+        for (slot = 0; worker->active_states[slot]; slot++)
+            ;
+        worker->active_states[slot] = job.state;
+        pthread_mutex_unlock(&worker->mutex);
+
+        vkd3d_pipeline_compile_worker_execute_job(worker, &job);
+
+        pthread_mutex_lock(&worker->mutex);
+        worker->active_states[slot] = NULL;
+        pthread_cond_broadcast(&worker->done_cond);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+
+    return NULL;
+}
+
+static void vkd3d_pipeline_compile_worker_enqueue(struct vkd3d_pipeline_compile_worker *worker,
+        const struct vkd3d_pipeline_compile_job *job)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&worker->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    if (!vkd3d_array_reserve((void **)&worker->jobs, &worker->jobs_size,
+            worker->job_count + 1, sizeof(*worker->jobs)))
+    {
+        ERR("Failed to enqueue pipeline compile job.\n");
+        pthread_mutex_unlock(&worker->mutex);
+        return;
+    }
+
+    worker->jobs[worker->job_count++] = *job;
+    pthread_cond_signal(&worker->cond);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+/* Drops queued jobs for a pipeline state and waits for any compile already in flight. */
+static void vkd3d_pipeline_compile_worker_cancel(struct vkd3d_pipeline_compile_worker *worker,
+        struct d3d12_pipeline_state *state)
+{
+    size_t i, j;
+    bool busy;
+
+    if (!vkd3d_pipeline_compile_worker_is_active(worker))
+        return;
+
+    pthread_mutex_lock(&worker->mutex);
+
+    for (i = 0, j = 0; i < worker->job_count; i++)
+    {
+        if (worker->jobs[i].state != state)
+            worker->jobs[j++] = worker->jobs[i];
+    }
+    worker->job_count = j;
+
+    do
+    {
+        for (i = 0, busy = false; i < ARRAY_SIZE(worker->active_states) && !busy; i++)
+            busy = worker->active_states[i] == state;
+
+        if (busy)
+            pthread_cond_wait(&worker->done_cond, &worker->mutex);
+    } while (busy);
+
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+HRESULT vkd3d_pipeline_compile_worker_start(struct vkd3d_pipeline_compile_worker *worker,
+        struct d3d12_device *device)
+{
+    HRESULT hr = S_OK;
+    uint32_t i;
+    int rc;
+
+    TRACE("worker %p.\n", worker);
+
+    memset(worker, 0, sizeof(*worker));
+    worker->device = device;
+
+    if (!(vkd3d_config_flags & VKD3D_CONFIG_FLAG_ASYNC_PIPELINE_COMPILE))
+        return S_OK;
+
+    if ((rc = pthread_mutex_init(&worker->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if ((rc = pthread_cond_init(&worker->cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        hr = hresult_from_errno(rc);
+        goto fail_cond;
+    }
+
+    if ((rc = pthread_cond_init(&worker->done_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        hr = hresult_from_errno(rc);
+        goto fail_done_cond;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(worker->threads); i++)
+    {
+        if (FAILED(hr = vkd3d_create_thread(device->vkd3d_instance,
+                vkd3d_pipeline_compile_worker_main, worker, &worker->threads[i])))
+            break;
+        worker->thread_count++;
+    }
+
+    if (worker->thread_count)
+    {
+        INFO("Compiling fallback pipelines on %u worker threads.\n", worker->thread_count);
+        return S_OK;
+    }
+
+    pthread_cond_destroy(&worker->done_cond);
+fail_done_cond:
+    pthread_cond_destroy(&worker->cond);
+fail_cond:
+    pthread_mutex_destroy(&worker->mutex);
+    return hr;
+}
+
+HRESULT vkd3d_pipeline_compile_worker_stop(struct vkd3d_pipeline_compile_worker *worker,
+        struct d3d12_device *device)
+{
+    HRESULT hr = S_OK;
+    uint32_t i;
+    int rc;
+
+    TRACE("worker %p.\n", worker);
+
+    if (!vkd3d_pipeline_compile_worker_is_active(worker))
+        return S_OK;
+
+    if ((rc = pthread_mutex_lock(&worker->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
 
-    /* Deduce pipeline type from specified shaders */
-    is_graphics = desc->vs.pShaderBytecode && desc->vs.BytecodeLength;
-    is_compute = desc->cs.pShaderBytecode && desc->cs.BytecodeLength;
+    worker->should_exit = true;
+    pthread_cond_broadcast(&worker->cond);
 
-    if (is_graphics == is_compute)
+    pthread_mutex_unlock(&worker->mutex);
+
+    for (i = 0; i < worker->thread_count; i++)
     {
-        ERR("Cannot deduce pipeline type.\n");
-        return E_INVALIDARG;
+        if (FAILED(vkd3d_join_thread(device->vkd3d_instance, &worker->threads[i])))
+            hr = E_FAIL;
     }
 
-    *vk_bind_point = is_graphics
-        ? VK_PIPELINE_BIND_POINT_GRAPHICS
-        : VK_PIPELINE_BIND_POINT_COMPUTE;
-    return S_OK;
-}
-
-#undef VKD3D_HANDLE_SUBOBJECT
-#undef VKD3D_HANDLE_SUBOBJECT_EXPLICIT
+    pthread_mutex_destroy(&worker->mutex);
+    pthread_cond_destroy(&worker->cond);
+    pthread_cond_destroy(&worker->done_cond);
 
-struct vkd3d_compiled_pipeline
-{
-    struct list entry;
-    struct vkd3d_pipeline_key key;
-    VkPipeline vk_pipeline;
-    struct vkd3d_render_pass_compatibility render_pass_compat;
-    uint32_t dynamic_state_flags;
-};
+    vkd3d_free(worker->jobs);
+    worker->thread_count = 0;
+    return hr;
+}
 
 /* ID3D12PipelineState */
 static HRESULT STDMETHODCALLTYPE d3d12_pipeline_state_QueryInterface(ID3D12PipelineState *iface,
@@ -2129,11 +2782,14 @@ static void d3d12_pipeline_state_destroy_graphics(struct d3d12_pipeline_state *s
 
     d3d12_pipeline_state_destroy_shader_modules(state, device);
 
+    vkd3d_pipeline_compile_worker_cancel(&device->pipeline_compile_worker, state);
+
     LIST_FOR_EACH_ENTRY_SAFE(current, e, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
     {
         VK_CALL(vkDestroyPipeline(device->vk_device, current->vk_pipeline, NULL));
         vkd3d_free(current);
     }
+    hash_map_clear(&graphics->compiled_fallback_pipeline_map);
 
     for (i = 0; i < VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_COUNT; i++)
         VK_CALL(vkDestroyPipeline(device->vk_device, graphics->pipeline[i], NULL));
@@ -2278,6 +2934,202 @@ CONST_VTBL struct ID3D12PipelineStateVtbl d3d12_pipeline_state_vtbl =
     d3d12_pipeline_state_GetCachedBlob,
 };
 
+struct vkd3d_shader_code_cache_key
+{
+    vkd3d_shader_hash_t dxbc_hash;
+    uint64_t dxbc_size;
+    /* Covers the shader interface and compile arguments. Device-level state
+     * like shader extensions and quirks is constant for the cache's lifetime. */
+    uint64_t interface_hash;
+};
+
+struct vkd3d_shader_code_cache_entry
+{
+    struct hash_map_entry entry;
+    struct vkd3d_shader_code_cache_key key;
+    struct vkd3d_shader_code code;
+};
+
+static uint32_t vkd3d_shader_code_cache_entry_hash(const void *key)
+{
+    const struct vkd3d_shader_code_cache_key *k = key;
+    return hash_combine(hash_uint64(k->dxbc_hash), hash_uint64(k->interface_hash));
+}
+
+static bool vkd3d_shader_code_cache_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_shader_code_cache_entry *e = (const struct vkd3d_shader_code_cache_entry *)entry;
+    const struct vkd3d_shader_code_cache_key *k = key;
+
+    return e->key.dxbc_hash == k->dxbc_hash &&
+            e->key.dxbc_size == k->dxbc_size &&
+            e->key.interface_hash == k->interface_hash;
+}
+
+HRESULT vkd3d_shader_code_cache_init(struct vkd3d_shader_code_cache *cache)
+{
+    int rc;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if ((rc = rwlock_init(&cache->lock)))
+        return hresult_from_errno(rc);
+
+    hash_map_init(&cache->map, &vkd3d_shader_code_cache_entry_hash,
+            &vkd3d_shader_code_cache_entry_compare, sizeof(struct vkd3d_shader_code_cache_entry));
+    return S_OK;
+}
+
+void vkd3d_shader_code_cache_cleanup(struct vkd3d_shader_code_cache *cache)
+{
+    struct vkd3d_shader_code_cache_entry *e;
+    uint32_t i;
+
+    for (i = 0; i < cache->map.entry_count; i++)
+    {
+        e = (struct vkd3d_shader_code_cache_entry *)hash_map_get_entry(&cache->map, i);
+        if (e->entry.flags & HASH_MAP_ENTRY_OCCUPIED)
+            vkd3d_shader_free_shader_code(&e->code);
+    }
+
+    hash_map_clear(&cache->map);
+    rwlock_destroy(&cache->lock);
+}
+
+static uint64_t vkd3d_shader_code_cache_hash_words(uint64_t h, const void *data, size_t size)
+{
+    const uint32_t *words = data;
+    size_t i;
+
+    /* All hashed structures consist of 32-bit members only. */
+    for (i = 0; i < size / sizeof(*words); i++)
+        h = hash_fnv1_iterate_u32(h, words[i]);
+
+    return h;
+}
+
+static uint64_t vkd3d_shader_code_cache_hash_binding(uint64_t h, const struct vkd3d_shader_descriptor_binding *binding)
+{
+    if (!binding)
+        return hash_fnv1_iterate_u32(h, ~0u);
+    return vkd3d_shader_code_cache_hash_words(h, binding, sizeof(*binding));
+}
+
+static uint64_t vkd3d_shader_code_cache_hash_interface(const struct vkd3d_shader_interface_info *shader_interface,
+        const struct vkd3d_shader_compile_arguments *compile_args)
+{
+    const struct vkd3d_shader_transform_feedback_info *xfb_info = shader_interface->xfb_info;
+    const struct vkd3d_shader_transform_feedback_element *element;
+    uint64_t h = hash_fnv1_init();
+    unsigned int i;
+
+    h = hash_fnv1_iterate_u32(h, shader_interface->flags);
+    h = hash_fnv1_iterate_u32(h, shader_interface->min_ssbo_alignment);
+    h = hash_fnv1_iterate_u32(h, shader_interface->descriptor_tables.offset);
+    h = hash_fnv1_iterate_u32(h, shader_interface->descriptor_tables.count);
+    h = hash_fnv1_iterate_u32(h, shader_interface->binding_count);
+    h = vkd3d_shader_code_cache_hash_words(h, shader_interface->bindings,
+            shader_interface->binding_count * sizeof(*shader_interface->bindings));
+    h = hash_fnv1_iterate_u32(h, shader_interface->push_constant_buffer_count);
+    h = vkd3d_shader_code_cache_hash_words(h, shader_interface->push_constant_buffers,
+            shader_interface->push_constant_buffer_count * sizeof(*shader_interface->push_constant_buffers));
+    h = vkd3d_shader_code_cache_hash_binding(h, shader_interface->push_constant_ubo_binding);
+    h = vkd3d_shader_code_cache_hash_binding(h, shader_interface->offset_buffer_binding);
+#ifdef VKD3D_ENABLE_DESCRIPTOR_QA
+    h = vkd3d_shader_code_cache_hash_binding(h, shader_interface->descriptor_qa_global_binding);
+    h = vkd3d_shader_code_cache_hash_binding(h, shader_interface->descriptor_qa_heap_binding);
+#endif
+    h = hash_fnv1_iterate_u32(h, shader_interface->stage);
+
+    if (xfb_info)
+    {
+        h = hash_fnv1_iterate_u32(h, xfb_info->element_count);
+        for (i = 0; i < xfb_info->element_count; i++)
+        {
+            element = &xfb_info->elements[i];
+            h = hash_fnv1_iterate_u32(h, element->stream_index);
+            h = hash_fnv1_iterate_string(h, element->semantic_name);
+            h = hash_fnv1_iterate_u32(h, element->semantic_index);
+            h = hash_fnv1_iterate_u8(h, element->component_index);
+            h = hash_fnv1_iterate_u8(h, element->component_count);
+            h = hash_fnv1_iterate_u8(h, element->output_slot);
+        }
+        h = hash_fnv1_iterate_u32(h, xfb_info->buffer_stride_count);
+        h = vkd3d_shader_code_cache_hash_words(h, xfb_info->buffer_strides,
+                xfb_info->buffer_stride_count * sizeof(*xfb_info->buffer_strides));
+    }
+    else
+        h = hash_fnv1_iterate_u32(h, ~0u);
+
+    h = hash_fnv1_iterate_u32(h, compile_args->target);
+    h = hash_fnv1_iterate_u32(h, compile_args->parameter_count);
+    h = vkd3d_shader_code_cache_hash_words(h, compile_args->parameters,
+            compile_args->parameter_count * sizeof(*compile_args->parameters));
+    h = hash_fnv1_iterate_u8(h, compile_args->dual_source_blending);
+    h = hash_fnv1_iterate_u32(h, compile_args->output_swizzle_count);
+    h = vkd3d_shader_code_cache_hash_words(h, compile_args->output_swizzles,
+            compile_args->output_swizzle_count * sizeof(*compile_args->output_swizzles));
+
+    return h;
+}
+
+static bool vkd3d_shader_code_dup(struct vkd3d_shader_code *dst, const struct vkd3d_shader_code *src)
+{
+    void *code;
+
+    if (!(code = vkd3d_malloc(src->size)))
+        return false;
+
+    memcpy(code, src->code, src->size);
+    dst->code = code;
+    dst->size = src->size;
+    dst->meta = src->meta;
+    return true;
+}
+
+static bool vkd3d_shader_code_cache_find(struct vkd3d_shader_code_cache *cache,
+        const struct vkd3d_shader_code_cache_key *key, struct vkd3d_shader_code *spirv_code)
+{
+    const struct vkd3d_shader_code_cache_entry *e;
+    bool found = false;
+
+    if (rwlock_lock_read(&cache->lock))
+        return false;
+
+    if ((e = (const struct vkd3d_shader_code_cache_entry *)hash_map_find(&cache->map, key)))
+        found = vkd3d_shader_code_dup(spirv_code, &e->code);
+
+    rwlock_unlock_read(&cache->lock);
+    return found;
+}
+
+static void vkd3d_shader_code_cache_insert(struct vkd3d_shader_code_cache *cache,
+        const struct vkd3d_shader_code_cache_key *key, const struct vkd3d_shader_code *spirv_code)
+{
+    struct vkd3d_shader_code_cache_entry entry;
+
+    memset(&entry, 0, sizeof(entry));
+    entry.key = *key;
+    if (!vkd3d_shader_code_dup(&entry.code, spirv_code))
+        return;
+
+    if (rwlock_lock_write(&cache->lock))
+    {
+        vkd3d_shader_free_shader_code(&entry.code);
+        return;
+    }
+
+    /* Entries live as long as the device, so stop caching once the budget is used up.
+     * Another thread may also have translated the same shader concurrently. */
+    if (cache->total_size + spirv_code->size <= VKD3D_SHADER_CODE_CACHE_MAX_SIZE &&
+            !hash_map_find(&cache->map, key) && hash_map_insert(&cache->map, key, &entry.entry))
+        cache->total_size += spirv_code->size;
+    else
+        vkd3d_shader_free_shader_code(&entry.code);
+
+    rwlock_unlock_write(&cache->lock);
+}
+
 static HRESULT create_shader_stage(struct d3d12_device *device,
         VkPipelineShaderStageCreateInfo *stage_desc, VkShaderStageFlagBits stage,
         VkPipelineShaderStageRequiredSubgroupSizeCreateInfoEXT *required_subgroup_size_info,
@@ -2286,8 +3138,10 @@ static HRESULT create_shader_stage(struct d3d12_device *device,
         const struct vkd3d_shader_compile_arguments *compile_args, struct vkd3d_shader_code *spirv_code)
 {
     struct vkd3d_shader_code dxbc = {code->pShaderBytecode, code->BytecodeLength};
+    struct vkd3d_shader_code_cache_key cache_key;
     vkd3d_shader_hash_t recovered_hash = 0;
     vkd3d_shader_hash_t compiled_hash = 0;
+    bool lookup_cache = false;
     HRESULT hr;
     int ret;
 
@@ -2336,6 +3190,21 @@ static HRESULT create_shader_stage(struct d3d12_device *device,
     else
         hr = E_FAIL;
 
+    /* Many pipelines share shaders, so also look for translations made for other pipeline states. */
+    if (FAILED(hr) && !(vkd3d_config_flags & VKD3D_CONFIG_FLAG_PIPELINE_LIBRARY_SANITIZE_SPIRV))
+    {
+        cache_key.dxbc_hash = vkd3d_shader_hash_fast(&dxbc);
+        cache_key.dxbc_size = dxbc.size;
+        cache_key.interface_hash = vkd3d_shader_code_cache_hash_interface(shader_interface, compile_args);
+        lookup_cache = true;
+
+        if (vkd3d_shader_code_cache_find(&device->shader_code_cache, &cache_key, spirv_code))
+        {
+            TRACE("Reusing SPIR-V for shader %016"PRIx64".\n", cache_key.dxbc_hash);
+            hr = S_OK;
+        }
+    }
+
     if (FAILED(hr))
     {
         TRACE("Calling vkd3d_shader_compile_dxbc.\n");
@@ -2345,6 +3214,15 @@ static HRESULT create_shader_stage(struct d3d12_device *device,
             return hresult_from_vkd3d_result(ret);
         }
         TRACE("Called vkd3d_shader_compile_dxbc.\n");
+
+        /* Optimize before caching so that the cost is only paid once per shader. */
+        if ((vkd3d_config_flags & VKD3D_CONFIG_FLAG_OPTIMIZE_SPIRV) &&
+                !(spirv_code->meta.flags & VKD3D_SHADER_META_FLAG_REPLACED) &&
+                (ret = vkd3d_shader_optimize_spirv(spirv_code)) < 0)
+            WARN("Failed to optimize SPIR-V, vkd3d result %d.\n", ret);
+
+        if (lookup_cache)
+            vkd3d_shader_code_cache_insert(&device->shader_code_cache, &cache_key, spirv_code);
     }
 
     /* Debug compare SPIR-V we got from cache, and SPIR-V we got from compilation. */
@@ -2407,6 +3285,27 @@ static HRESULT create_shader_stage(struct d3d12_device *device,
     return d3d12_pipeline_state_create_shader_module(device, stage_desc, spirv_code);
 }
 
+struct d3d12_shader_stage_compile
+{
+    struct d3d12_device *device;
+    VkPipelineShaderStageCreateInfo *stage_desc;
+    const D3D12_SHADER_BYTECODE *code;
+    const struct d3d12_cached_pipeline_state *cached_state;
+    struct vkd3d_shader_interface_info shader_interface;
+    const struct vkd3d_shader_compile_arguments *compile_args;
+    struct vkd3d_shader_code *spirv_code;
+    HRESULT hr;
+};
+
+static void d3d12_shader_stage_compile_main(void *userdata)
+{
+    struct d3d12_shader_stage_compile *compile = userdata;
+
+    compile->hr = create_shader_stage(compile->device, compile->stage_desc,
+            compile->shader_interface.stage, NULL, compile->code, compile->cached_state,
+            &compile->shader_interface, compile->compile_args, compile->spirv_code);
+}
+
 static void vkd3d_report_pipeline_creation_feedback_results(const VkPipelineCreationFeedbackCreateInfoEXT *feedback)
 {
     uint32_t i;
@@ -2483,7 +3382,7 @@ static HRESULT vkd3d_create_compute_pipeline(struct d3d12_device *device,
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_info.basePipelineIndex = -1;
 
-    if ((spirv_code->meta.flags & VKD3D_SHADER_META_FLAG_REPLACED) && device->debug_ring.active)
+    if (vkd3d_shader_debug_ring_instruments_shader(&device->debug_ring, spirv_code))
     {
         vkd3d_shader_debug_ring_init_spec_constant(device, &spec_info, spirv_code->meta.hash);
         pipeline_info.stage.pSpecializationInfo = &spec_info.spec_info;
@@ -2531,6 +3430,7 @@ static HRESULT d3d12_pipeline_state_init_compute(struct d3d12_pipeline_state *st
 
     state->ID3D12PipelineState_iface.lpVtbl = &d3d12_pipeline_state_vtbl;
     state->refcount = 1;
+    state->cookie = vkd3d_allocate_cookie();
     state->vk_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
 
     if (desc->root_signature)
@@ -3010,6 +3910,20 @@ static unsigned int vkd3d_get_rt_format_swizzle(const struct vkd3d_format *forma
 
 STATIC_ASSERT(sizeof(struct vkd3d_shader_transform_feedback_element) == sizeof(D3D12_SO_DECLARATION_ENTRY));
 
+static const struct vkd3d_format *d3d12_graphics_pipeline_state_get_attachment_dsv_format(
+        const struct d3d12_graphics_pipeline_state *graphics, const struct vkd3d_format *dynamic_dsv_format)
+{
+    if (!dynamic_dsv_format)
+        return NULL;
+
+    if (graphics->dsv_format)
+        return graphics->dsv_format;
+    else if (graphics->null_attachment_mask & dsv_attachment_mask(graphics))
+        return dynamic_dsv_format;
+    else
+        return NULL;
+}
+
 static HRESULT d3d12_graphics_pipeline_state_create_render_pass_for_plane_mask(
         struct d3d12_graphics_pipeline_state *graphics, struct d3d12_device *device,
         uint32_t rtv_active_mask, const struct vkd3d_format *dynamic_dsv_format,
@@ -3018,6 +3932,7 @@ static HRESULT d3d12_graphics_pipeline_state_create_render_pass_for_plane_mask(
         uint32_t *out_plane_optimal_mask,
         uint32_t variant_flags)
 {
+    const struct vkd3d_format *attachment_dsv_format;
     VkFormat dsv_format = VK_FORMAT_UNDEFINED;
     struct vkd3d_render_pass_key key;
     VkImageAspectFlags aspects = 0;
@@ -3028,18 +3943,10 @@ static HRESULT d3d12_graphics_pipeline_state_create_render_pass_for_plane_mask(
     key.rtv_active_mask = rtv_active_mask;
     key.flags = 0;
 
-    if (dynamic_dsv_format)
+    if ((attachment_dsv_format = d3d12_graphics_pipeline_state_get_attachment_dsv_format(graphics, dynamic_dsv_format)))
     {
-        if (graphics->dsv_format)
-        {
-            dsv_format = graphics->dsv_format->vk_format;
-            aspects = graphics->dsv_format->vk_aspect_mask;
-        }
-        else if (graphics->null_attachment_mask & dsv_attachment_mask(graphics))
-        {
-            dsv_format = dynamic_dsv_format->vk_format;
-            aspects = dynamic_dsv_format->vk_aspect_mask;
-        }
+        dsv_format = attachment_dsv_format->vk_format;
+        aspects = attachment_dsv_format->vk_aspect_mask;
     }
 
     if (dsv_format)
@@ -3121,6 +4028,10 @@ static HRESULT d3d12_graphics_pipeline_state_create_render_pass_for_plane_mask(
         *out_plane_optimal_mask = plane_optimal_mask;
     }
 
+    /* With dynamic rendering we only need the plane optimal mask. */
+    if (!vk_render_pass)
+        return S_OK;
+
     return vkd3d_render_pass_cache_find(&device->render_pass_cache, device, &key, vk_render_pass);
 }
 
@@ -3134,6 +4045,15 @@ static HRESULT d3d12_graphics_pipeline_state_create_render_pass(
     uint32_t plane_optimal_mask;
     HRESULT hr;
 
+    if (d3d12_device_use_dynamic_rendering(device))
+    {
+        /* Pipelines only declare attachment formats, so there is no need
+         * for a render pass per possible depth-stencil layout. */
+        memset(render_pass_compat, 0, sizeof(*render_pass_compat));
+        return d3d12_graphics_pipeline_state_create_render_pass_for_plane_mask(graphics, device,
+                rtv_active_mask, dynamic_dsv_format, 0, NULL, out_plane_optimal_mask, variant_flags);
+    }
+
     for (plane_optimal_mask = 0; plane_optimal_mask < ARRAY_SIZE(render_pass_compat->dsv_layouts);
          plane_optimal_mask++)
     {
@@ -3166,6 +4086,11 @@ static bool vk_blend_attachment_needs_blend_constants(const VkPipelineColorBlend
             vk_blend_factor_needs_blend_constants(attachment->dstAlphaBlendFactor));
 }
 
+static bool d3d12_device_supports_dynamic_patch_control_points(struct d3d12_device *device)
+{
+    return device->device_info.extended_dynamic_state2_features.extendedDynamicState2PatchControlPoints;
+}
+
 static uint32_t d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_pipeline_state *state,
         VkPipelineDynamicStateCreateInfo *dynamic_desc, VkDynamicState *dynamic_state_buffer,
         const struct vkd3d_pipeline_key *key)
@@ -3191,6 +4116,8 @@ static uint32_t d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_pi
         { VKD3D_DYNAMIC_STATE_TOPOLOGY,              VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT },
         { VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE,  VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT },
         { VKD3D_DYNAMIC_STATE_FRAGMENT_SHADING_RATE, VK_DYNAMIC_STATE_FRAGMENT_SHADING_RATE_KHR },
+        { VKD3D_DYNAMIC_STATE_VERTEX_INPUT,          VK_DYNAMIC_STATE_VERTEX_INPUT_EXT },
+        { VKD3D_DYNAMIC_STATE_PATCH_CONTROL_POINTS,  VK_DYNAMIC_STATE_PATCH_CONTROL_POINTS_EXT },
     };
 
     dynamic_state_flags = 0;
@@ -3203,15 +4130,25 @@ static uint32_t d3d12_graphics_pipeline_state_init_dynamic_state(struct d3d12_pi
 
     if (graphics->attribute_binding_count)
     {
+        /* Dynamic vertex input also covers strides, so it must not be
+         * combined with the dynamic binding stride state. */
         if (!key || key->dynamic_stride)
             dynamic_state_flags |= VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE;
+        else if (key->dynamic_vertex_input)
+            dynamic_state_flags |= VKD3D_DYNAMIC_STATE_VERTEX_BUFFER | VKD3D_DYNAMIC_STATE_VERTEX_INPUT;
         else
             dynamic_state_flags |= VKD3D_DYNAMIC_STATE_VERTEX_BUFFER;
     }
 
     if (!key || key->dynamic_topology)
+    {
         dynamic_state_flags |= VKD3D_DYNAMIC_STATE_TOPOLOGY;
 
+        if (graphics->primitive_topology_type == D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH &&
+                d3d12_device_supports_dynamic_patch_control_points(state->device))
+            dynamic_state_flags |= VKD3D_DYNAMIC_STATE_PATCH_CONTROL_POINTS;
+    }
+
     if (graphics->ds_desc.stencilTestEnable)
     {
         dynamic_state_flags |= VKD3D_DYNAMIC_STATE_STENCIL_REFERENCE;
@@ -3309,8 +4246,11 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
     const VkPhysicalDeviceFeatures *features = &device->device_info.features2.features;
     bool have_attachment, is_dsv_format_unknown, supports_extended_dynamic_state;
     unsigned int ps_output_swizzle[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    struct d3d12_shader_stage_compile stage_compiles[VKD3D_MAX_SHADER_STAGES];
     struct vkd3d_shader_compile_arguments compile_args, ps_compile_args;
     struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct vkd3d_task_group compile_group;
+    struct d3d12_shader_stage_compile *compile;
     const D3D12_STREAM_OUTPUT_DESC *so_desc = &desc->stream_output;
     VkVertexInputBindingDivisorDescriptionEXT *binding_divisor;
     const struct vkd3d_vulkan_info *vk_info = &device->vk_info;
@@ -3349,6 +4289,7 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
 
     state->ID3D12PipelineState_iface.lpVtbl = &d3d12_pipeline_state_vtbl;
     state->refcount = 1;
+    state->cookie = vkd3d_allocate_cookie();
     state->vk_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
 
     graphics->stage_count = 0;
@@ -3643,28 +4584,49 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
                 goto fail;
         }
 
-        shader_interface.xfb_info = shader_stages[i].stage == xfb_stage ? &xfb_info : NULL;
-        shader_interface.stage = shader_stages[i].stage;
-        if (FAILED(hr = create_shader_stage(device,
-                &graphics->stages[graphics->stage_count],
-                shader_stages[i].stage, NULL, b, &desc->cached_pso, &shader_interface,
-                shader_stages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT ? &ps_compile_args : &compile_args,
-                &graphics->code[graphics->stage_count])))
+        compile = &stage_compiles[graphics->stage_count];
+        compile->device = device;
+        compile->stage_desc = &graphics->stages[graphics->stage_count];
+        compile->code = b;
+        compile->cached_state = &desc->cached_pso;
+        compile->shader_interface = shader_interface;
+        compile->shader_interface.xfb_info = shader_stages[i].stage == xfb_stage ? &xfb_info : NULL;
+        compile->shader_interface.stage = shader_stages[i].stage;
+        compile->compile_args = shader_stages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT ?
+                &ps_compile_args : &compile_args;
+        compile->spirv_code = &graphics->code[graphics->stage_count];
+
+        /* Failed stages are cleaned up along with the compiled ones. */
+        memset(compile->stage_desc, 0, sizeof(*compile->stage_desc));
+        memset(compile->spirv_code, 0, sizeof(*compile->spirv_code));
+        ++graphics->stage_count;
+    }
+
+    /* Stages are translated independently, so shader frontend latency is that of the slowest stage. */
+    memset(&compile_group, 0, sizeof(compile_group));
+    for (i = 0; i < graphics->stage_count; ++i)
+    {
+        vkd3d_task_pool_submit(&device->task_pool, VKD3D_TASK_TYPE_SHADER_COMPILE, VKD3D_TASK_PRIORITY_HIGH,
+                &compile_group, d3d12_shader_stage_compile_main, &stage_compiles[i]);
+    }
+    vkd3d_task_pool_wait(&device->task_pool, &compile_group);
+
+    for (i = 0; i < graphics->stage_count; ++i)
+    {
+        if (FAILED(hr = stage_compiles[i].hr))
             goto fail;
+    }
 
-        if (shader_stages[i].stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT)
-            graphics->patch_vertex_count = graphics->code[graphics->stage_count].meta.patch_vertex_count;
+    for (i = 0; i < graphics->stage_count; ++i)
+    {
+        if (graphics->stages[i].stage == VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT)
+            graphics->patch_vertex_count = graphics->code[i].meta.patch_vertex_count;
 
-        if ((graphics->code[graphics->stage_count].meta.flags & VKD3D_SHADER_META_FLAG_REPLACED) &&
-                device->debug_ring.active)
+        if (vkd3d_shader_debug_ring_instruments_shader(&device->debug_ring, &graphics->code[i]))
         {
-            vkd3d_shader_debug_ring_init_spec_constant(device,
-                    &graphics->spec_info[graphics->stage_count],
-                    graphics->code[graphics->stage_count].meta.hash);
-            graphics->stages[graphics->stage_count].pSpecializationInfo = &graphics->spec_info[graphics->stage_count].spec_info;
+            vkd3d_shader_debug_ring_init_spec_constant(device, &graphics->spec_info[i], graphics->code[i].meta.hash);
+            graphics->stages[i].pSpecializationInfo = &graphics->spec_info[i].spec_info;
         }
-
-        ++graphics->stage_count;
     }
 
     graphics->attribute_count = desc->input_layout.NumElements;
@@ -3865,8 +4827,10 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
         goto fail;
     }
 
+    /* With dynamic patch control points, the hull shader does not have to declare the patch size. */
     supports_extended_dynamic_state = device->device_info.extended_dynamic_state_features.extendedDynamicState &&
-            (desc->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH || graphics->patch_vertex_count != 0) &&
+            (desc->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH || graphics->patch_vertex_count != 0 ||
+                    d3d12_device_supports_dynamic_patch_control_points(device)) &&
             desc->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED;
 
     graphics->pipeline_layout = root_signature->graphics.vk_pipeline_layout;
@@ -3874,26 +4838,28 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
         graphics->pipeline[i] = VK_NULL_HANDLE;
     state->device = device;
 
-    if (supports_extended_dynamic_state)
+    /* Fallback variants go through the same cache as the static ones, so the driver
+     * can reuse compiled stages between variants instead of starting from scratch. */
+    if (!device->global_pipeline_cache)
     {
-        if (!device->global_pipeline_cache)
+        if ((hr = vkd3d_create_pipeline_cache_from_d3d12_desc(device, &desc->cached_pso, &state->vk_pso_cache)) < 0)
         {
-            /* If we have EXT_extended_dynamic_state, we can compile a pipeline right here.
-             * There are still some edge cases where we need to fall back to special pipelines, but that should be very rare. */
-            if ((hr = vkd3d_create_pipeline_cache_from_d3d12_desc(device, &desc->cached_pso, &state->vk_pso_cache)) < 0)
-            {
-                ERR("Failed to create pipeline cache, hr %d.\n", hr);
-                goto fail;
-            }
+            ERR("Failed to create pipeline cache, hr %d.\n", hr);
+            goto fail;
         }
+    }
 
+    if (supports_extended_dynamic_state)
+    {
+        /* If we have EXT_extended_dynamic_state, we can compile a pipeline right here.
+         * There are still some edge cases where we need to fall back to special pipelines, but that should be very rare. */
         for (i = 0; i < VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_COUNT; i++)
         {
             if (!d3d12_is_valid_pipeline_variant(device, i))
                 continue;
 
             if (!(graphics->pipeline[i] = d3d12_pipeline_state_create_pipeline_variant(state, NULL, graphics->dsv_format,
-                    state->vk_pso_cache ? state->vk_pso_cache : device->global_pipeline_cache,
+                    d3d12_pipeline_state_get_vk_pipeline_cache(state),
                     &graphics->render_pass[i], &graphics->dynamic_state_flags, i)))
                 goto fail;
         }
@@ -3913,6 +4879,8 @@ static HRESULT d3d12_pipeline_state_init_graphics(struct d3d12_pipeline_state *s
     }
 
     list_init(&graphics->compiled_fallback_pipelines);
+    hash_map_init(&graphics->compiled_fallback_pipeline_map, vkd3d_pipeline_key_hash,
+            vkd3d_compiled_pipeline_entry_compare, sizeof(struct vkd3d_compiled_pipeline_entry));
 
     if (FAILED(hr = vkd3d_private_store_init(&state->private_store)))
         goto fail;
@@ -3944,6 +4912,24 @@ bool d3d12_pipeline_state_has_replaced_shaders(struct d3d12_pipeline_state *stat
         return false;
 }
 
+bool d3d12_pipeline_state_uses_debug_ring(struct d3d12_pipeline_state *state)
+{
+    const struct vkd3d_shader_debug_ring *ring = &state->device->debug_ring;
+    unsigned int i;
+
+    if (state->vk_bind_point == VK_PIPELINE_BIND_POINT_COMPUTE)
+        return vkd3d_shader_debug_ring_instruments_shader(ring, &state->compute.code);
+    else if (state->vk_bind_point == VK_PIPELINE_BIND_POINT_GRAPHICS)
+    {
+        for (i = 0; i < state->graphics.stage_count; i++)
+            if (vkd3d_shader_debug_ring_instruments_shader(ring, &state->graphics.code[i]))
+                return true;
+        return false;
+    }
+    else
+        return false;
+}
+
 static HRESULT d3d12_pipeline_create_private_root_signature(struct d3d12_device *device,
         VkPipelineBindPoint bind_point, const struct d3d12_pipeline_state_desc *desc,
         ID3D12RootSignature **root_signature)
@@ -3961,6 +4947,8 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
         const struct d3d12_pipeline_state_desc *desc, struct d3d12_pipeline_state **state)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const struct d3d12_pipeline_state_desc *app_desc = desc;
+    struct d3d12_pipeline_state_desc disk_cache_desc;
     struct d3d12_root_signature *root_signature;
     struct d3d12_pipeline_state *object;
     HRESULT hr;
@@ -3999,6 +4987,20 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
             return hr;
         }
     }
+    else if (vkd3d_disk_cache_is_active(&device->disk_cache))
+    {
+        /* Unlike application provided blobs, a stale disk cache entry
+         * is not an error, we just compile the pipeline from scratch. */
+        disk_cache_desc = *desc;
+        if (vkd3d_disk_cache_find_pipeline(&device->disk_cache, &object->pipeline_cache_compat,
+                &disk_cache_desc.cached_pso) &&
+                SUCCEEDED(d3d12_cached_pipeline_state_validate(device, &disk_cache_desc.cached_pso,
+                        &object->pipeline_cache_compat)))
+        {
+            TRACE("Found pipeline state in disk cache.\n");
+            desc = &disk_cache_desc;
+        }
+    }
 
     switch (bind_point)
     {
@@ -4027,6 +5029,11 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
         return hr;
     }
 
+    if (!desc->cached_pso.blob.CachedBlobSizeInBytes)
+        vkd3d_disk_cache_store_pipeline(&device->disk_cache, object);
+    if (!app_desc->cached_pso.blob.CachedBlobSizeInBytes)
+        vkd3d_pipeline_warmup_record(&device->disk_cache, bind_point, app_desc, &object->pipeline_cache_compat);
+
     /* The strategy here is that we need to keep the SPIR-V alive somehow.
      * If we don't need to serialize SPIR-V from the PSO, then we don't need to keep the code alive as pointer/size pairs.
      * The scenarios for this case is when we choose to not serialize SPIR-V at all with VKD3D_CONFIG,
@@ -4043,8 +5050,10 @@ HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindP
         d3d12_pipeline_state_destroy_shader_modules(object, device);
 
     /* We don't expect to serialize the PSO blob if we loaded it from cache.
-     * Free the cache now to save on memory. */
-    if (desc->cached_pso.blob.CachedBlobSizeInBytes)
+     * Free the cache now to save on memory, unless every draw will need a fallback
+     * variant, which the cache may already contain from an earlier run. */
+    if (desc->cached_pso.blob.CachedBlobSizeInBytes &&
+            !(d3d12_pipeline_state_is_graphics(object) && !d3d12_pipeline_state_has_static_pipeline(object)))
     {
         VK_CALL(vkDestroyPipelineCache(device->vk_device, object->vk_pso_cache, NULL));
         object->vk_pso_cache = VK_NULL_HANDLE;
@@ -4152,26 +5161,66 @@ enum VkPrimitiveTopology vk_topology_from_d3d12_topology(D3D12_PRIMITIVE_TOPOLOG
     }
 }
 
+struct vkd3d_compiled_pipeline_entry
+{
+    struct hash_map_entry entry;
+    struct vkd3d_compiled_pipeline *pipeline;
+};
+
+static uint32_t vkd3d_pipeline_key_hash(const void *key)
+{
+    const uint32_t *words = key;
+    uint32_t hash = 0;
+    size_t i;
+
+    /* Keys are zero-initialized, so padding is well-defined. */
+    STATIC_ASSERT(!(sizeof(struct vkd3d_pipeline_key) % sizeof(uint32_t)));
+
+    for (i = 0; i < sizeof(struct vkd3d_pipeline_key) / sizeof(uint32_t); i++)
+        hash = hash_combine(hash, words[i]);
+
+    return hash;
+}
+
+static bool vkd3d_compiled_pipeline_entry_compare(const void *key, const struct hash_map_entry *entry)
+{
+    const struct vkd3d_compiled_pipeline_entry *e = (const struct vkd3d_compiled_pipeline_entry *)entry;
+    return !memcmp(key, &e->pipeline->key, sizeof(struct vkd3d_pipeline_key));
+}
+
 static VkPipeline d3d12_pipeline_state_find_compiled_pipeline(struct d3d12_pipeline_state *state,
         const struct vkd3d_pipeline_key *key,
         const struct vkd3d_render_pass_compatibility **render_pass_compat,
         uint32_t *dynamic_state_flags)
 {
-    const struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    VkPipeline vk_pipeline = VK_NULL_HANDLE;
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    const struct vkd3d_compiled_pipeline_entry *e;
     struct vkd3d_compiled_pipeline *current;
+    VkPipeline vk_pipeline = VK_NULL_HANDLE;
 
     *render_pass_compat = NULL;
 
+    /* Draws tend to hit the same variant over and over. Only fully compiled
+     * pipelines are published here, and those are immutable until the PSO dies. */
+    current = vkd3d_atomic_ptr_load_explicit(&graphics->last_fallback_pipeline, vkd3d_memory_order_acquire);
+    if (current && !memcmp(&current->key, key, sizeof(*key)))
+    {
+        *render_pass_compat = &current->render_pass_compat;
+        *dynamic_state_flags = current->dynamic_state_flags;
+        return current->vk_pipeline;
+    }
+
     rw_spinlock_acquire_read(&state->lock);
-    LIST_FOR_EACH_ENTRY(current, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
+    if ((e = (const struct vkd3d_compiled_pipeline_entry *)hash_map_find(&graphics->compiled_fallback_pipeline_map, key)))
     {
-        if (!memcmp(&current->key, key, sizeof(*key)))
+        current = e->pipeline;
+
+        /* A null pipeline is still being compiled in the background. */
+        if ((vk_pipeline = current->vk_pipeline))
         {
-            vk_pipeline = current->vk_pipeline;
             *render_pass_compat = &current->render_pass_compat;
             *dynamic_state_flags = current->dynamic_state_flags;
-            break;
+            vkd3d_atomic_ptr_store_explicit(&graphics->last_fallback_pipeline, current, vkd3d_memory_order_release);
         }
     }
     rw_spinlock_release_read(&state->lock);
@@ -4179,14 +5228,32 @@ static VkPipeline d3d12_pipeline_state_find_compiled_pipeline(struct d3d12_pipel
     return vk_pipeline;
 }
 
+/* Must be called with the PSO write lock held. Returns false if
+ * an entry with the same key exists, or if we ran out of memory. */
+static bool d3d12_pipeline_state_insert_compiled_pipeline(struct d3d12_pipeline_state *state,
+        struct vkd3d_compiled_pipeline *compiled_pipeline)
+{
+    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
+    struct vkd3d_compiled_pipeline_entry entry, *e;
+
+    entry.pipeline = compiled_pipeline;
+
+    if (!(e = (struct vkd3d_compiled_pipeline_entry *)hash_map_insert(&graphics->compiled_fallback_pipeline_map,
+            &compiled_pipeline->key, &entry.entry)) || e->pipeline != compiled_pipeline)
+        return false;
+
+    list_add_tail(&graphics->compiled_fallback_pipelines, &compiled_pipeline->entry);
+    return true;
+}
+
 static bool d3d12_pipeline_state_put_pipeline_to_cache(struct d3d12_pipeline_state *state,
         const struct vkd3d_pipeline_key *key, VkPipeline vk_pipeline,
         const struct vkd3d_render_pass_compatibility *render_pass_compat,
         const struct vkd3d_render_pass_compatibility **out_render_pass_compat,
         uint32_t dynamic_state_flags)
 {
-    struct d3d12_graphics_pipeline_state *graphics = &state->graphics;
-    struct vkd3d_compiled_pipeline *compiled_pipeline, *current;
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+    bool inserted;
 
     if (!(compiled_pipeline = vkd3d_malloc(sizeof(*compiled_pipeline))))
         return false;
@@ -4198,22 +5265,44 @@ static bool d3d12_pipeline_state_put_pipeline_to_cache(struct d3d12_pipeline_sta
     *out_render_pass_compat = &compiled_pipeline->render_pass_compat;
 
     rw_spinlock_acquire_write(&state->lock);
+    inserted = d3d12_pipeline_state_insert_compiled_pipeline(state, compiled_pipeline);
+    rw_spinlock_release_write(&state->lock);
+
+    if (!inserted)
+        vkd3d_free(compiled_pipeline);
+    return inserted;
+}
+
+static void d3d12_pipeline_state_compile_pipeline_async(struct d3d12_pipeline_state *state,
+        const struct vkd3d_pipeline_key *key, const struct vkd3d_format *dsv_format)
+{
+    struct vkd3d_compiled_pipeline *compiled_pipeline;
+    struct vkd3d_pipeline_compile_job job;
+    bool inserted;
+
+    if (!(compiled_pipeline = vkd3d_calloc(1, sizeof(*compiled_pipeline))))
+        return;
+
+    /* Add a pending entry so that only the first draw to miss queues a compile. */
+    compiled_pipeline->key = *key;
+
+    rw_spinlock_acquire_write(&state->lock);
+    inserted = d3d12_pipeline_state_insert_compiled_pipeline(state, compiled_pipeline);
+    rw_spinlock_release_write(&state->lock);
 
-    LIST_FOR_EACH_ENTRY(current, &graphics->compiled_fallback_pipelines, struct vkd3d_compiled_pipeline, entry)
+    if (!inserted)
     {
-        if (!memcmp(&current->key, key, sizeof(*key)))
-        {
-            vkd3d_free(compiled_pipeline);
-            compiled_pipeline = NULL;
-            break;
-        }
+        vkd3d_free(compiled_pipeline);
+        return;
     }
 
-    if (compiled_pipeline)
-        list_add_tail(&graphics->compiled_fallback_pipelines, &compiled_pipeline->entry);
+    if (state->device->device_info.extended_dynamic_state_features.extendedDynamicState)
+        FIXME("Extended dynamic state is supported, but compiling a fallback pipeline late!\n");
 
-    rw_spinlock_release_write(&state->lock);
-    return compiled_pipeline;
+    job.state = state;
+    job.pipeline = compiled_pipeline;
+    job.dsv_format = dsv_format;
+    vkd3d_pipeline_compile_worker_enqueue(&state->device->pipeline_compile_worker, &job);
 }
 
 VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_state *state,
@@ -4230,8 +5319,11 @@ VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_st
     VkPipelineShaderStageCreateInfo stages[VKD3D_MAX_SHADER_STAGES];
     VkPipelineTessellationStateCreateInfo tessellation_info;
     VkPipelineDepthStencilStateCreateInfo fallback_ds_desc;
+    VkFormat rtv_formats[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
     VkPipelineCreationFeedbackCreateInfoEXT feedback_info;
     VkPipelineDynamicStateCreateInfo dynamic_create_info;
+    const struct vkd3d_format *attachment_dsv_format;
+    VkPipelineRenderingCreateInfoKHR rendering_info;
     VkPipelineVertexInputStateCreateInfo input_desc;
     VkPipelineInputAssemblyStateCreateInfo ia_desc;
     struct d3d12_device *device = state->device;
@@ -4248,7 +5340,7 @@ VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_st
     *dynamic_state_flags = d3d12_graphics_pipeline_state_init_dynamic_state(state, &dynamic_create_info,
             dynamic_state_buffer, key);
 
-    if (key && !key->dynamic_stride)
+    if (key && !key->dynamic_stride && !key->dynamic_vertex_input)
     {
         /* If not using extended dynamic state, set static vertex stride. */
         for (i = 0; i < graphics->attribute_binding_count; i++)
@@ -4288,7 +5380,7 @@ VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_st
     tessellation_info.flags = 0;
     tessellation_info.patchControlPoints = key && !key->dynamic_topology ?
             max(key->topology - D3D_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST + 1, 1) :
-            graphics->patch_vertex_count;
+            max(graphics->patch_vertex_count, 1);
 
     vp_desc.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     vp_desc.pNext = NULL;
@@ -4350,6 +5442,31 @@ VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_st
     /* Any of these is fine from a compatibility PoV. */
     pipeline_desc.renderPass = render_pass_compat->dsv_layouts[0];
 
+    if (d3d12_device_use_dynamic_rendering(device))
+    {
+        /* Must match the attachments set up in d3d12_command_list_begin_render_pass(). */
+        for (i = 0; i < graphics->rt_count; i++)
+            rtv_formats[i] = (rtv_active_mask & (1u << i)) ? graphics->rtv_formats[i] : VK_FORMAT_UNDEFINED;
+
+        attachment_dsv_format = d3d12_graphics_pipeline_state_get_attachment_dsv_format(graphics, dsv_format);
+
+        rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+        rendering_info.pNext = NULL;
+        rendering_info.viewMask = 0;
+        rendering_info.colorAttachmentCount = graphics->rt_count;
+        rendering_info.pColorAttachmentFormats = rtv_formats;
+        rendering_info.depthAttachmentFormat = attachment_dsv_format &&
+                (attachment_dsv_format->vk_aspect_mask & VK_IMAGE_ASPECT_DEPTH_BIT) ?
+                attachment_dsv_format->vk_format : VK_FORMAT_UNDEFINED;
+        rendering_info.stencilAttachmentFormat = attachment_dsv_format &&
+                (attachment_dsv_format->vk_aspect_mask & VK_IMAGE_ASPECT_STENCIL_BIT) ?
+                attachment_dsv_format->vk_format : VK_FORMAT_UNDEFINED;
+        vk_prepend_struct(&pipeline_desc, &rendering_info);
+
+        if (variant_flags & VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_VRS_ATTACHMENT)
+            pipeline_desc.flags |= VK_PIPELINE_CREATE_RENDERING_FRAGMENT_SHADING_RATE_ATTACHMENT_BIT_KHR;
+    }
+
     if (key)
     {
         /* In a fallback pipeline, we might have to re-create shader modules.
@@ -4442,6 +5559,16 @@ static bool d3d12_pipeline_state_can_use_dynamic_stride(struct d3d12_pipeline_st
     return true;
 }
 
+bool d3d12_pipeline_state_uses_dynamic_vertex_stride(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state)
+{
+    /* Mirrors the choice made in d3d12_pipeline_state_get_or_create_pipeline(),
+     * so callers can tell whether the next draw binds dynamic strides before recording it. */
+    return state->graphics.attribute_binding_count &&
+            state->device->device_info.extended_dynamic_state_features.extendedDynamicState &&
+            d3d12_pipeline_state_can_use_dynamic_stride(state, dyn_state);
+}
+
 VkPipeline d3d12_pipeline_state_get_pipeline(struct d3d12_pipeline_state *state,
         const struct vkd3d_dynamic_state *dyn_state,
         uint32_t rtv_nonnull_mask, const struct vkd3d_format *dsv_format,
@@ -4482,6 +5609,7 @@ VkPipeline d3d12_pipeline_state_get_pipeline(struct d3d12_pipeline_state *state,
 
     /* It should be illegal to use different patch size for topology compared to pipeline, but be safe here. */
     if (dyn_state->vk_primitive_topology == VK_PRIMITIVE_TOPOLOGY_PATCH_LIST &&
+        !(graphics->dynamic_state_flags & VKD3D_DYNAMIC_STATE_PATCH_CONTROL_POINTS) &&
         (dyn_state->primitive_topology - D3D_PRIMITIVE_TOPOLOGY_1_CONTROL_POINT_PATCHLIST + 1) != graphics->patch_vertex_count)
     {
         if (graphics->patch_vertex_count)
@@ -4522,7 +5650,8 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     extended_dynamic_state = device->device_info.extended_dynamic_state_features.extendedDynamicState;
 
     if (extended_dynamic_state &&
-        graphics->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH &&
+        (graphics->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH ||
+                d3d12_device_supports_dynamic_patch_control_points(device)) &&
         graphics->primitive_topology_type != D3D12_PRIMITIVE_TOPOLOGY_TYPE_UNDEFINED)
         pipeline_key.dynamic_topology = true;
     else
@@ -4537,6 +5666,12 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
     {
         pipeline_key.dynamic_stride = true;
     }
+    else if (device->device_info.vertex_input_dynamic_state_features.vertexInputDynamicState)
+    {
+        /* Strides that are too small for dynamic binding strides are fine with dynamic vertex input,
+         * so a single fallback pipeline covers all of them instead of one variant per stride combination. */
+        pipeline_key.dynamic_vertex_input = true;
+    }
     else
     {
         for (i = 0; i < graphics->attribute_binding_count; ++i)
@@ -4563,12 +5698,19 @@ VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_sta
         return vk_pipeline;
     }
 
+    if (vkd3d_pipeline_compile_worker_is_active(&device->pipeline_compile_worker))
+    {
+        TRACE("Fallback pipeline is not ready yet, skipping draw.\n");
+        d3d12_pipeline_state_compile_pipeline_async(state, &pipeline_key, dsv_format);
+        return VK_NULL_HANDLE;
+    }
+
     if (extended_dynamic_state)
         FIXME("Extended dynamic state is supported, but compiling a fallback pipeline late!\n");
 
     vk_pipeline = d3d12_pipeline_state_create_pipeline_variant(state,
-            &pipeline_key, dsv_format, VK_NULL_HANDLE, &new_render_pass_compat, dynamic_state_flags,
-            variant_flags);
+            &pipeline_key, dsv_format, d3d12_pipeline_state_get_vk_pipeline_cache(state),
+            &new_render_pass_compat, dynamic_state_flags, variant_flags);
 
     if (!vk_pipeline)
     {
@@ -4914,6 +6056,16 @@ static uint32_t vkd3d_bindless_state_get_bindless_flags(struct d3d12_device *dev
         flags &= ~VKD3D_BINDLESS_MUTABLE_TYPE_RAW_SSBO;
     }
 
+    /* Raw buffer descriptors only keep their VkDescriptorBufferInfo around
+     * if they are not also written as a typed descriptor. */
+    if ((vkd3d_config_flags & VKD3D_CONFIG_FLAG_HOIST_SRV_UAV) &&
+            (flags & VKD3D_RAW_VA_ROOT_DESCRIPTOR_SRV_UAV) &&
+            (flags & VKD3D_BINDLESS_MUTABLE_TYPE_RAW_SSBO))
+    {
+        INFO("Hoisting static buffer SRVs and UAVs to root descriptors.\n");
+        flags |= VKD3D_HOIST_STATIC_TABLE_SRV_UAV;
+    }
+
     return flags;
 }
 
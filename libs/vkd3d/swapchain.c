@@ -164,6 +164,71 @@ struct d3d12_swapchain_state
 
 typedef IDXGISwapChain4 dxgi_swapchain_iface;
 
+/* Bounds how far Present() can run ahead of the present thread. */
+#define VKD3D_SWAPCHAIN_MAX_QUEUED_PRESENTS 16
+
+/* In low latency mode, gives up on waiting for a frame to be displayed after this long,
+ * e.g. when the window is hidden and the presentation engine holds on to the image. */
+#define VKD3D_SWAPCHAIN_PRESENT_WAIT_TIMEOUT_NS 100000000ull
+
+struct d3d12_swapchain_present_request
+{
+    uint64_t frame_number;
+    uint64_t queue_time_ns;
+    unsigned int sync_interval;
+    unsigned int user_index;
+    /* Set by the present thread in low latency mode, 0 if the frame was not waited for. */
+    uint64_t display_time_ns;
+};
+
+struct d3d12_swapchain_present_stats
+{
+    uint64_t present_count;
+    uint64_t last_present_time_ns;
+    /* Time from the Present() call until vkQueuePresentKHR() returned. */
+    uint64_t total_latency_ns;
+    uint64_t max_latency_ns;
+    /* Time between consecutive presents. */
+    uint64_t total_interval_ns;
+    uint64_t max_interval_ns;
+    /* Low latency mode only. Time from the Present() call until the frame was displayed. */
+    uint64_t display_count;
+    uint64_t last_display_time_ns;
+    uint64_t total_display_latency_ns;
+    uint64_t max_display_latency_ns;
+};
+
+/* Presentation is done by a dedicated thread. Present() queues a request along with a
+ * callback on the command queue, which hands the request over to the thread once all work
+ * submitted before the Present() call has reached the Vulkan queue. While requests are
+ * outstanding, the thread owns the Vulkan swapchain, so anything else touching it must
+ * drain the thread first. */
+struct d3d12_swapchain_present_state
+{
+    union vkd3d_thread_handle thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool thread_running;
+    bool stopping;
+
+    struct d3d12_swapchain_present_request requests[VKD3D_SWAPCHAIN_MAX_QUEUED_PRESENTS];
+    uint64_t queued_count;
+    uint64_t ready_count;
+    uint64_t completed_count;
+
+    /* Result of the most recent request which did not succeed, returned by the next Present(). */
+    HRESULT status;
+    uint32_t occluded;
+
+    /* Signal the frame latency fence once a frame is displayed, using VK_KHR_present_wait.
+     * In this mode, the fence is only ever signalled from the present thread. */
+    bool low_latency;
+    /* Present ID of the most recent successful present on the current Vulkan swapchain. */
+    uint64_t last_present_id;
+
+    struct d3d12_swapchain_present_stats stats;
+};
+
 struct d3d12_swapchain
 {
     dxgi_swapchain_iface IDXGISwapChain_iface;
@@ -192,6 +257,9 @@ struct d3d12_swapchain
     unsigned int vk_swapchain_height;
     VkPresentModeKHR present_mode;
     bool is_suboptimal;
+    /* User buffers match the Vulkan swapchain images in format and size,
+     * so presenting can use a plain image copy rather than the fullscreen blit. */
+    bool direct_copy;
 
     struct
     {
@@ -220,6 +288,8 @@ struct d3d12_swapchain
     uint64_t frame_number;
     uint32_t frame_latency;
     uint32_t frame_id;
+
+    struct d3d12_swapchain_present_state present;
 };
 
 static inline const struct vkd3d_vk_device_procs* d3d12_swapchain_procs(struct d3d12_swapchain* swapchain)
@@ -983,6 +1053,93 @@ static HRESULT d3d12_swapchain_create_user_buffers(struct d3d12_swapchain *swapc
     return S_OK;
 }
 
+static VkResult d3d12_swapchain_record_swapchain_copy(struct d3d12_swapchain *swapchain,
+        VkCommandBuffer vk_cmd_buffer, unsigned int dst_index, unsigned int src_index)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = d3d12_swapchain_procs(swapchain);
+    VkImageMemoryBarrier image_barriers[2];
+    VkCommandBufferBeginInfo begin_info;
+    VkImageCopy copy_region;
+    unsigned int i;
+    VkResult vr;
+
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = NULL;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin_info.pInheritanceInfo = NULL;
+
+    if ((vr = VK_CALL(vkBeginCommandBuffer(vk_cmd_buffer, &begin_info))) < 0)
+    {
+        WARN("Failed to begin command buffer, vr %d.\n", vr);
+        return vr;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(image_barriers); i++)
+    {
+        image_barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        image_barriers[i].pNext = NULL;
+        image_barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        image_barriers[i].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        image_barriers[i].subresourceRange.baseMipLevel = 0;
+        image_barriers[i].subresourceRange.levelCount = 1;
+        image_barriers[i].subresourceRange.baseArrayLayer = 0;
+        image_barriers[i].subresourceRange.layerCount = 1;
+    }
+
+    /* The user image sits in its common layout while in the PRESENT state,
+     * the swapchain image contents are discarded. */
+    image_barriers[0].image = swapchain->vk_images[src_index];
+    image_barriers[0].srcAccessMask = 0;
+    image_barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    image_barriers[1].image = swapchain->vk_swapchain_images[dst_index];
+    image_barriers[1].srcAccessMask = 0;
+    image_barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+
+    /* The acquire semaphore wait happens at COLOR_ATTACHMENT_OUTPUT,
+     * so the swapchain image transition has to chain with that stage. */
+    VK_CALL(vkCmdPipelineBarrier(vk_cmd_buffer,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL,
+            ARRAY_SIZE(image_barriers), image_barriers));
+
+    memset(&copy_region, 0, sizeof(copy_region));
+    copy_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    copy_region.srcSubresource.layerCount = 1;
+    copy_region.dstSubresource = copy_region.srcSubresource;
+    copy_region.extent.width = swapchain->vk_swapchain_width;
+    copy_region.extent.height = swapchain->vk_swapchain_height;
+    copy_region.extent.depth = 1;
+
+    VK_CALL(vkCmdCopyImage(vk_cmd_buffer,
+            swapchain->vk_images[src_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            swapchain->vk_swapchain_images[dst_index], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &copy_region));
+
+    image_barriers[0].srcAccessMask = 0;
+    image_barriers[0].dstAccessMask = 0;
+    image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    image_barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    image_barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barriers[1].dstAccessMask = 0;
+    image_barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    image_barriers[1].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    VK_CALL(vkCmdPipelineBarrier(vk_cmd_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0, 0, NULL, 0, NULL, ARRAY_SIZE(image_barriers), image_barriers));
+
+    if ((vr = VK_CALL(vkEndCommandBuffer(vk_cmd_buffer))) < 0)
+        WARN("Failed to end command buffer, vr %d.\n", vr);
+
+    return vr;
+}
+
 static VkResult d3d12_swapchain_record_swapchain_blit(struct d3d12_swapchain *swapchain,
         VkCommandBuffer vk_cmd_buffer, unsigned int dst_index, unsigned int src_index)
 {
@@ -1298,7 +1455,8 @@ static VkResult d3d12_swapchain_unsignal_acquire_semaphore(struct d3d12_swapchai
     assert(swapchain->vk_acquire_semaphores_signaled[frame_id]);
     submit_info.pWaitSemaphores = &swapchain->vk_acquire_semaphores[frame_id];
 
-    if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, vk_fence))))
+    if ((vr = vkd3d_queue_submit_locked(swapchain->command_queue->vkd3d_queue,
+            swapchain->command_queue->device, vk_queue, 1, &submit_info, vk_fence)))
     {
         ERR("Failed to submit unsignal operation, vr %d\n", vr);
         goto end;
@@ -1511,6 +1669,19 @@ static HRESULT d3d12_swapchain_create_vulkan_swapchain(struct d3d12_swapchain *s
         return DXGI_ERROR_UNSUPPORTED;
     }
 
+    /* There is no valid way to let the application render into swapchain images directly,
+     * since D3D12 back buffers are rendered to before the matching image could be acquired,
+     * but when nothing needs to be converted or scaled we can skip the fullscreen draw. */
+    swapchain->direct_copy = vk_format == vk_swapchain_format &&
+            width == swapchain->desc.Width && height == swapchain->desc.Height &&
+            swapchain->command_queue->desc.Type == D3D12_COMMAND_LIST_TYPE_DIRECT &&
+            (surface_caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+    if (swapchain->direct_copy)
+        usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    TRACE("Using %s for presentation.\n", swapchain->direct_copy ? "image copies" : "fullscreen blits");
+
     /* Having a pending acquired image while using oldSwapchain seems to cause strange deadlocks
      * on Wine + NV Linux.
      * Using oldSwapchain does not buy us anything and can only lead to weirdness, so just destroy
@@ -1557,6 +1728,7 @@ static HRESULT d3d12_swapchain_create_vulkan_swapchain(struct d3d12_swapchain *s
 
     swapchain->vk_image_index = INVALID_VK_IMAGE_INDEX;
     swapchain->is_suboptimal = false;
+    swapchain->present.last_present_id = 0;
 
     if (swapchain->vk_swapchain != VK_NULL_HANDLE)
     {
@@ -1632,10 +1804,59 @@ static ULONG STDMETHODCALLTYPE d3d12_swapchain_AddRef(dxgi_swapchain_iface *ifac
     return refcount;
 }
 
+static void d3d12_swapchain_drain_presents(struct d3d12_swapchain *swapchain)
+{
+    struct d3d12_swapchain_present_state *present = &swapchain->present;
+
+    pthread_mutex_lock(&present->lock);
+    while (present->completed_count < present->queued_count)
+        pthread_cond_wait(&present->cond, &present->lock);
+    pthread_mutex_unlock(&present->lock);
+}
+
+static void d3d12_swapchain_stop_present_thread(struct d3d12_swapchain *swapchain)
+{
+    struct d3d12_swapchain_present_state *present = &swapchain->present;
+    const struct d3d12_swapchain_present_stats *stats = &present->stats;
+
+    if (!present->thread_running)
+        return;
+
+    /* Requests pending on the command queue still hold a pointer to the swapchain. */
+    d3d12_swapchain_drain_presents(swapchain);
+
+    pthread_mutex_lock(&present->lock);
+    present->stopping = true;
+    pthread_cond_broadcast(&present->cond);
+    pthread_mutex_unlock(&present->lock);
+
+    vkd3d_join_thread(d3d12_swapchain_device(swapchain)->vkd3d_instance, &present->thread);
+    present->thread_running = false;
+
+    if (stats->present_count > 1)
+    {
+        TRACE("Presented %"PRIu64" frames, latency avg %.3f ms, max %.3f ms, interval avg %.3f ms, max %.3f ms.\n",
+                stats->present_count,
+                1e-6 * (double)stats->total_latency_ns / (double)stats->present_count,
+                1e-6 * (double)stats->max_latency_ns,
+                1e-6 * (double)stats->total_interval_ns / (double)(stats->present_count - 1),
+                1e-6 * (double)stats->max_interval_ns);
+    }
+
+    if (stats->display_count)
+    {
+        TRACE("Displayed %"PRIu64" frames, present to display latency avg %.3f ms, max %.3f ms.\n",
+                stats->display_count,
+                1e-6 * (double)stats->total_display_latency_ns / (double)stats->display_count,
+                1e-6 * (double)stats->max_display_latency_ns);
+    }
+}
+
 static void d3d12_swapchain_destroy(struct d3d12_swapchain *swapchain)
 {
     const struct vkd3d_vk_device_procs *vk_procs = d3d12_swapchain_procs(swapchain);
 
+    d3d12_swapchain_stop_present_thread(swapchain);
     d3d12_swapchain_destroy_buffers(swapchain, TRUE);
     d3d12_swapchain_destroy_framebuffers(swapchain);
 
@@ -1666,6 +1887,8 @@ static void d3d12_swapchain_destroy(struct d3d12_swapchain *swapchain)
     if (swapchain->factory)
         IDXGIFactory_Release(swapchain->factory);
 
+    pthread_cond_destroy(&swapchain->present.cond);
+    pthread_mutex_destroy(&swapchain->present.lock);
     DeleteCriticalSection(&swapchain->mutex);
 }
 
@@ -1774,12 +1997,14 @@ static HRESULT d3d12_swapchain_set_sync_interval(struct d3d12_swapchain *swapcha
     return d3d12_swapchain_recreate_vulkan_swapchain(swapchain);
 }
 
-static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain, VkQueue vk_queue)
+static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain, VkQueue vk_queue,
+        unsigned int user_index, uint64_t present_id, uint64_t *latency_physical_value)
 {
     /* Blit meta pass uses COLOR_ATTACHMENT_OUTPUT_BIT external subpass dependency. */
     const VkPipelineStageFlags acquire_wait_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     const struct vkd3d_vk_device_procs *vk_procs = d3d12_swapchain_procs(swapchain);
     VkDevice vk_device = d3d12_swapchain_device(swapchain)->vk_device;
+    VkPresentIdKHR present_id_info;
     VkCommandBuffer vk_cmd_buffer;
     VkPresentInfoKHR present_info;
     VkSubmitInfo submit_info;
@@ -1835,6 +2060,15 @@ static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain,
     present_info.pImageIndices = &swapchain->vk_image_index;
     present_info.pResults = NULL;
 
+    if (swapchain->present.low_latency)
+    {
+        present_id_info.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        present_id_info.pNext = NULL;
+        present_id_info.swapchainCount = 1;
+        present_id_info.pPresentIds = &present_id;
+        present_info.pNext = &present_id_info;
+    }
+
     vk_cmd_buffer = swapchain->vk_cmd_buffers[swapchain->vk_image_index];
 
     if ((vr = VK_CALL(vkWaitForFences(vk_device, 1, &swapchain->vk_blit_fences[swapchain->vk_image_index],
@@ -1850,8 +2084,12 @@ static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain,
         return vr;
     }
 
-    if ((vr = d3d12_swapchain_record_swapchain_blit(swapchain,
-            vk_cmd_buffer, swapchain->vk_image_index, swapchain->current_buffer_index)) < 0)
+    if (swapchain->direct_copy)
+        vr = d3d12_swapchain_record_swapchain_copy(swapchain, vk_cmd_buffer, swapchain->vk_image_index, user_index);
+    else
+        vr = d3d12_swapchain_record_swapchain_blit(swapchain, vk_cmd_buffer, swapchain->vk_image_index, user_index);
+
+    if (vr < 0)
         return vr;
 
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -1866,7 +2104,22 @@ static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain,
     submit_info.pSignalSemaphores = &swapchain->vk_present_semaphores[swapchain->vk_image_index];
 
     VK_CALL(vkResetFences(vk_device, 1, &swapchain->vk_blit_fences[swapchain->vk_image_index]));
-    if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, swapchain->vk_blit_fences[swapchain->vk_image_index]))) < 0)
+
+    /* Outside of low latency mode, the frame stops counting against the latency
+     * target once the blit completes, so let the blit signal the fence itself. */
+    if (!swapchain->present.low_latency && !*latency_physical_value)
+    {
+        vr = d3d12_fence_submit_signal_locked(impl_from_ID3D12Fence(swapchain->frame_latency_fence), present_id,
+                swapchain->command_queue->vkd3d_queue, vk_queue, &submit_info,
+                swapchain->vk_blit_fences[swapchain->vk_image_index], latency_physical_value);
+    }
+    else
+    {
+        vr = vkd3d_queue_submit_locked(swapchain->command_queue->vkd3d_queue, swapchain->command_queue->device,
+                vk_queue, 1, &submit_info, swapchain->vk_blit_fences[swapchain->vk_image_index]);
+    }
+
+    if (vr < 0)
     {
         ERR("Failed to blit swapchain buffer, vr %d.\n", vr);
         return vr;
@@ -1879,6 +2132,7 @@ static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain,
 
     if ((vr = VK_CALL(vkQueuePresentKHR(vk_queue, &present_info))) >= 0)
     {
+        swapchain->present.last_present_id = present_id;
         swapchain->frame_id = (swapchain->frame_id + 1) % swapchain->buffer_count;
         swapchain->vk_image_index = INVALID_VK_IMAGE_INDEX;
 
@@ -1924,79 +2178,278 @@ static VkResult d3d12_swapchain_queue_present(struct d3d12_swapchain *swapchain,
     return vr;
 }
 
-static HRESULT d3d12_swapchain_present(struct d3d12_swapchain *swapchain,
-        unsigned int sync_interval, unsigned int flags)
+static void d3d12_swapchain_wait_for_display(struct d3d12_swapchain *swapchain,
+        struct d3d12_swapchain_present_request *request)
 {
-    VkQueue vk_queue;
+    const struct vkd3d_vk_device_procs *vk_procs = d3d12_swapchain_procs(swapchain);
+    VkDevice vk_device = d3d12_swapchain_device(swapchain)->vk_device;
     VkResult vr;
-    HRESULT hr;
 
-    if (sync_interval > 4)
-    {
-        WARN("Invalid sync interval %u.\n", sync_interval);
-        return DXGI_ERROR_INVALID_CALL;
-    }
+    /* Frames which were dropped or presented on a swapchain we have since replaced
+     * cannot be waited for. */
+    if (swapchain->vk_swapchain == VK_NULL_HANDLE || swapchain->present.last_present_id != request->frame_number)
+        return;
 
-    if (flags & ~(DXGI_PRESENT_TEST | DXGI_PRESENT_ALLOW_TEARING))
-        FIXME("Unimplemented flags %#x.\n", flags);
+    vr = VK_CALL(vkWaitForPresentKHR(vk_device, swapchain->vk_swapchain,
+            request->frame_number, VKD3D_SWAPCHAIN_PRESENT_WAIT_TIMEOUT_NS));
+
+    if (vr == VK_SUCCESS || vr == VK_SUBOPTIMAL_KHR)
+        request->display_time_ns = vkd3d_profiling_get_tick_count();
+    else if (vr == VK_TIMEOUT)
+        TRACE("Timed out waiting for frame %"PRIu64" to be displayed.\n", request->frame_number);
+    else
+        WARN("Failed to wait for present, vr %d.\n", vr);
+}
+
+static bool d3d12_swapchain_enqueue_latency_signal(struct d3d12_swapchain *swapchain, uint64_t physical_value)
+{
+    if (!physical_value)
+        return false;
+
+    d3d12_fence_enqueue_gpu_signal(impl_from_ID3D12Fence(swapchain->frame_latency_fence),
+            physical_value, swapchain->command_queue->vkd3d_queue);
+    return true;
+}
+
+static HRESULT d3d12_swapchain_process_present_request(struct d3d12_swapchain *swapchain,
+        struct d3d12_swapchain_present_request *request)
+{
+    struct vkd3d_queue *vkd3d_queue = swapchain->command_queue->vkd3d_queue;
+    uint64_t latency_physical_value = 0;
+    bool latency_signalled = false;
+    VkQueue vk_queue;
+    HRESULT hr = S_OK;
+    VkResult vr;
 
     if (swapchain->vk_swapchain == VK_NULL_HANDLE)
     {
         /* We're in a minimized state where we cannot present. However, we might be able to present now, so check that. */
         if (!d3d12_swapchain_has_nonzero_surface_size(swapchain))
-            return DXGI_STATUS_OCCLUDED;
+        {
+            vkd3d_atomic_uint32_store_explicit(&swapchain->present.occluded, 1, vkd3d_memory_order_relaxed);
+            hr = DXGI_STATUS_OCCLUDED;
+            goto signal;
+        }
     }
 
-    if (flags & DXGI_PRESENT_TEST)
-        return S_OK;
+    vkd3d_atomic_uint32_store_explicit(&swapchain->present.occluded, 0, vkd3d_memory_order_relaxed);
 
-    if (FAILED(hr = d3d12_swapchain_set_sync_interval(swapchain, sync_interval)))
-        return hr;
+    if (FAILED(hr = d3d12_swapchain_set_sync_interval(swapchain, request->sync_interval)))
+        goto signal;
 
-    if (!(vk_queue = vkd3d_acquire_vk_queue(d3d12_swapchain_queue_iface(swapchain))))
+    /* The request only becomes ready once all prior work on the command queue has been
+     * submitted, so unlike external users, there is no need to drain the queue here. */
+    if (!(vk_queue = vkd3d_queue_acquire(vkd3d_queue)))
     {
         ERR("Failed to acquire Vulkan queue.\n");
-        return E_FAIL;
+        hr = E_FAIL;
+        goto signal;
     }
 
-    vr = d3d12_swapchain_queue_present(swapchain, vk_queue);
+    vr = d3d12_swapchain_queue_present(swapchain, vk_queue, request->user_index,
+            request->frame_number, &latency_physical_value);
     if (vr == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        vkd3d_release_vk_queue(d3d12_swapchain_queue_iface(swapchain));
+        vkd3d_queue_release(vkd3d_queue);
+
+        /* The blit may have been submitted even though presenting failed */
+        latency_signalled = d3d12_swapchain_enqueue_latency_signal(swapchain, latency_physical_value);
 
         TRACE("Recreating Vulkan swapchain.\n");
 
         d3d12_swapchain_destroy_buffers(swapchain, FALSE);
         if (FAILED(hr = d3d12_swapchain_recreate_vulkan_swapchain(swapchain)))
-            return hr;
+            goto signal;
 
-        if (!(vk_queue = vkd3d_acquire_vk_queue(d3d12_swapchain_queue_iface(swapchain))))
+        if (!(vk_queue = vkd3d_queue_acquire(vkd3d_queue)))
         {
             ERR("Failed to acquire Vulkan queue.\n");
-            return E_FAIL;
+            hr = E_FAIL;
+            goto signal;
         }
 
-        if ((vr = d3d12_swapchain_queue_present(swapchain, vk_queue)) < 0)
+        if ((vr = d3d12_swapchain_queue_present(swapchain, vk_queue, request->user_index,
+                request->frame_number, &latency_physical_value)) < 0)
             ERR("Failed to present after recreating swapchain, vr %d.\n", vr);
     }
 
-    vkd3d_release_vk_queue(d3d12_swapchain_queue_iface(swapchain));
+    vkd3d_queue_release(vkd3d_queue);
+
+    if (!latency_signalled)
+        latency_signalled = d3d12_swapchain_enqueue_latency_signal(swapchain, latency_physical_value);
 
     if (vr < 0)
     {
         ERR("Failed to queue present, vr %d.\n", vr);
-        return hresult_from_vk_result(vr);
+        hr = hresult_from_vk_result(vr);
     }
 
-    ++swapchain->frame_number;
+signal:
+    /* Always signal, even for dropped frames, so that the frame latency wait cannot hang.
+     * In low latency mode, the frame counts against the latency target until it is
+     * displayed, not just until the GPU is done with it. Displaying the frame implies
+     * that the blit has completed, so signalling from the CPU keeps the fence ordered. */
+    if (swapchain->present.low_latency)
+    {
+        d3d12_swapchain_wait_for_display(swapchain, request);
 
-    if (FAILED(hr = ID3D12CommandQueue_Signal(d3d12_swapchain_queue_iface(swapchain),
-            swapchain->frame_latency_fence, swapchain->frame_number)))
+        if (FAILED(ID3D12Fence_Signal(swapchain->frame_latency_fence, request->frame_number)))
+            ERR("Failed to signal frame latency fence.\n");
+    }
+    else if (!latency_signalled)
     {
-        ERR("Failed to signal frame latency fence, hr %#x.\n", hr);
-        return hr;
+        /* No blit was submitted for this frame. Signal on the Vulkan queue directly,
+         * which keeps the fence ordered behind earlier blits. Going through the command
+         * queue would also order it behind any work submitted after the Present() call. */
+        if ((vk_queue = vkd3d_queue_acquire(vkd3d_queue)))
+        {
+            if ((vr = d3d12_fence_submit_signal_locked(impl_from_ID3D12Fence(swapchain->frame_latency_fence),
+                    request->frame_number, vkd3d_queue, vk_queue, NULL, VK_NULL_HANDLE, &latency_physical_value)) < 0)
+                ERR("Failed to signal frame latency fence, vr %d.\n", vr);
+            vkd3d_queue_release(vkd3d_queue);
+
+            d3d12_swapchain_enqueue_latency_signal(swapchain, latency_physical_value);
+        }
+        else
+            ERR("Failed to acquire Vulkan queue.\n");
+    }
+
+    return hr;
+}
+
+static void d3d12_swapchain_present_update_stats(struct d3d12_swapchain *swapchain,
+        const struct d3d12_swapchain_present_request *request)
+{
+    struct d3d12_swapchain_present_stats *stats = &swapchain->present.stats;
+    uint64_t now_ns, latency_ns, interval_ns;
+
+    now_ns = vkd3d_profiling_get_tick_count();
+    latency_ns = now_ns - request->queue_time_ns;
+
+    stats->total_latency_ns += latency_ns;
+    stats->max_latency_ns = max(stats->max_latency_ns, latency_ns);
+
+    if (stats->present_count)
+    {
+        interval_ns = now_ns - stats->last_present_time_ns;
+        stats->total_interval_ns += interval_ns;
+        stats->max_interval_ns = max(stats->max_interval_ns, interval_ns);
+    }
+
+    stats->present_count++;
+    stats->last_present_time_ns = now_ns;
+
+    if (request->display_time_ns)
+    {
+        latency_ns = request->display_time_ns - request->queue_time_ns;
+        stats->total_display_latency_ns += latency_ns;
+        stats->max_display_latency_ns = max(stats->max_display_latency_ns, latency_ns);
+        stats->display_count++;
+        stats->last_display_time_ns = request->display_time_ns;
+    }
+}
+
+static void *d3d12_swapchain_present_main(void *userdata)
+{
+    struct d3d12_swapchain_present_state *present;
+    struct d3d12_swapchain_present_request request;
+    struct d3d12_swapchain *swapchain = userdata;
+    HRESULT hr;
+
+    vkd3d_set_thread_name("vkd3d_present");
+    present = &swapchain->present;
+
+    pthread_mutex_lock(&present->lock);
+
+    for (;;)
+    {
+        while (!present->stopping && present->completed_count == present->ready_count)
+            pthread_cond_wait(&present->cond, &present->lock);
+
+        if (present->completed_count == present->ready_count)
+            break;
+
+        request = present->requests[present->completed_count % VKD3D_SWAPCHAIN_MAX_QUEUED_PRESENTS];
+        pthread_mutex_unlock(&present->lock);
+
+        hr = d3d12_swapchain_process_present_request(swapchain, &request);
+
+        pthread_mutex_lock(&present->lock);
+
+        if (hr != S_OK)
+            present->status = hr;
+        else
+            d3d12_swapchain_present_update_stats(swapchain, &request);
+
+        present->completed_count++;
+        pthread_cond_broadcast(&present->cond);
+    }
+
+    pthread_mutex_unlock(&present->lock);
+    return NULL;
+}
+
+static void d3d12_swapchain_present_ready(void *userdata)
+{
+    struct d3d12_swapchain *swapchain = userdata;
+
+    pthread_mutex_lock(&swapchain->present.lock);
+    swapchain->present.ready_count++;
+    pthread_cond_broadcast(&swapchain->present.cond);
+    pthread_mutex_unlock(&swapchain->present.lock);
+}
+
+static HRESULT d3d12_swapchain_present(struct d3d12_swapchain *swapchain,
+        unsigned int sync_interval, unsigned int flags)
+{
+    struct d3d12_swapchain_present_state *present = &swapchain->present;
+    struct d3d12_swapchain_present_request *request;
+    HRESULT hr, status;
+
+    if (sync_interval > 4)
+    {
+        WARN("Invalid sync interval %u.\n", sync_interval);
+        return DXGI_ERROR_INVALID_CALL;
+    }
+
+    if (flags & ~(DXGI_PRESENT_TEST | DXGI_PRESENT_ALLOW_TEARING))
+        FIXME("Unimplemented flags %#x.\n", flags);
+
+    if (vkd3d_atomic_uint32_load_explicit(&present->occluded, vkd3d_memory_order_relaxed))
+    {
+        /* The present thread found the window minimized. Surface queries don't need any
+         * synchronization with it, so check whether we can present again from here. */
+        if (!d3d12_swapchain_has_nonzero_surface_size(swapchain))
+            return DXGI_STATUS_OCCLUDED;
     }
 
+    if (flags & DXGI_PRESENT_TEST)
+        return S_OK;
+
+    pthread_mutex_lock(&present->lock);
+
+    while (present->queued_count - present->completed_count >= VKD3D_SWAPCHAIN_MAX_QUEUED_PRESENTS)
+        pthread_cond_wait(&present->cond, &present->lock);
+
+    request = &present->requests[present->queued_count % VKD3D_SWAPCHAIN_MAX_QUEUED_PRESENTS];
+    request->frame_number = ++swapchain->frame_number;
+    request->queue_time_ns = vkd3d_profiling_get_tick_count();
+    request->sync_interval = sync_interval;
+    request->user_index = swapchain->current_buffer_index;
+    request->display_time_ns = 0;
+    present->queued_count++;
+
+    status = present->status;
+    present->status = S_OK;
+
+    pthread_mutex_unlock(&present->lock);
+
+    d3d12_command_queue_enqueue_callback(swapchain->command_queue, d3d12_swapchain_present_ready, swapchain);
+
+    /* Event regions recorded from here on belong to the next frame. */
+    vkd3d_event_profiler_next_frame(&d3d12_swapchain_device(swapchain)->event_profiler,
+            d3d12_swapchain_device(swapchain));
+
     if (FAILED(hr = d3d12_fence_set_event_on_completion(impl_from_ID3D12Fence(swapchain->frame_latency_fence),
             swapchain->frame_number, swapchain->frame_latency_event, VKD3D_WAITING_EVENT_TYPE_SEMAPHORE)))
     {
@@ -2008,19 +2461,26 @@ static HRESULT d3d12_swapchain_present(struct d3d12_swapchain *swapchain,
         WaitForSingleObject(swapchain->frame_latency_event, INFINITE);
 
     swapchain->current_buffer_index = (swapchain->current_buffer_index + 1) % swapchain->desc.BufferCount;
-    return hresult_from_vk_result(vr);
+
+    /* Errors from earlier presents are only reported here, and occlusion
+     * is reported synchronously above once the present thread has seen it. */
+    return status == DXGI_STATUS_OCCLUDED ? S_OK : status;
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_swapchain_Present(dxgi_swapchain_iface *iface, UINT sync_interval, UINT flags)
 {
     struct d3d12_swapchain *swapchain = d3d12_swapchain_from_IDXGISwapChain(iface);
+    VKD3D_REGION_DECL(Present);
     HRESULT hr;
 
     TRACE("iface %p, sync_interval %u, flags %#x.\n", iface, sync_interval, flags);
 
+    /* Also gives profiling tools a frame counter. */
+    VKD3D_REGION_BEGIN(Present);
     EnterCriticalSection(&swapchain->mutex);
     hr = d3d12_swapchain_present(swapchain, sync_interval, flags);
     LeaveCriticalSection(&swapchain->mutex);
+    VKD3D_REGION_END(Present);
     return hr;
 }
 
@@ -2257,6 +2717,10 @@ static HRESULT d3d12_swapchain_resize_buffers(struct d3d12_swapchain *swapchain,
             && desc->Format == new_desc.Format && desc->BufferCount == new_desc.BufferCount)
         return S_OK;
 
+    /* Queued presents may still read the user buffers. New ones cannot be
+     * queued in the meantime, since Present() takes the swapchain lock. */
+    d3d12_swapchain_drain_presents(swapchain);
+
     d3d12_swapchain_destroy_buffers(swapchain, TRUE);
     swapchain->desc = new_desc;
     return d3d12_swapchain_recreate_vulkan_swapchain(swapchain);
@@ -2307,17 +2771,30 @@ static HRESULT STDMETHODCALLTYPE d3d12_swapchain_GetContainingOutput(dxgi_swapch
 static HRESULT STDMETHODCALLTYPE d3d12_swapchain_GetFrameStatistics(dxgi_swapchain_iface *iface,
         DXGI_FRAME_STATISTICS *stats)
 {
-    FIXME_ONCE("iface %p, stats %p stub!\n", iface, stats);
+    TRACE("iface %p, stats %p.\n", iface, stats);
 
-    return E_NOTIMPL;
+    if (!stats)
+        return E_INVALIDARG;
+
+    /* Vulkan does not tell us which vblank a frame was displayed on, so we cannot
+     * report refresh counts. Applications handle this like a disjoint sequence. */
+    return DXGI_ERROR_FRAME_STATISTICS_DISJOINT;
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_swapchain_GetLastPresentCount(dxgi_swapchain_iface *iface,
         UINT *last_present_count)
 {
-    FIXME_ONCE("iface %p, last_present_count %p stub!\n", iface, last_present_count);
+    struct d3d12_swapchain *swapchain = d3d12_swapchain_from_IDXGISwapChain(iface);
 
-    return E_NOTIMPL;
+    TRACE("iface %p, last_present_count %p.\n", iface, last_present_count);
+
+    if (!last_present_count)
+        return E_INVALIDARG;
+
+    pthread_mutex_lock(&swapchain->present.lock);
+    *last_present_count = swapchain->present.queued_count;
+    pthread_mutex_unlock(&swapchain->present.lock);
+    return S_OK;
 }
 
 /* IDXGISwapChain1 methods */
@@ -2726,11 +3203,14 @@ static HRESULT d3d12_swapchain_init(struct d3d12_swapchain *swapchain, IDXGIFact
     VkInstance vk_instance;
     IDXGIAdapter *adapter;
     IDXGIOutput *target;
+    const char *latency_env;
     VkBool32 supported;
     VkResult vr;
     HRESULT hr;
 
     InitializeCriticalSection(&swapchain->mutex);
+    pthread_mutex_init(&swapchain->present.lock, NULL);
+    pthread_cond_init(&swapchain->present.cond, NULL);
 
     if (window == GetDesktopWindow())
     {
@@ -2857,6 +3337,27 @@ static HRESULT d3d12_swapchain_init(struct d3d12_swapchain *swapchain, IDXGIFact
     if (swapchain_desc->Flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT)
         swapchain->frame_latency = 1;
 
+    if (vkd3d_config_flags & VKD3D_CONFIG_FLAG_LOW_LATENCY)
+    {
+        if (queue->device->device_info.present_id_features.presentId &&
+                queue->device->device_info.present_wait_features.presentWait)
+        {
+            swapchain->present.low_latency = true;
+            swapchain->frame_latency = 1;
+
+            if ((latency_env = getenv("VKD3D_SWAPCHAIN_LATENCY_FRAMES")))
+            {
+                swapchain->frame_latency = strtoul(latency_env, NULL, 0);
+                swapchain->frame_latency = max(swapchain->frame_latency, 1);
+                swapchain->frame_latency = min(swapchain->frame_latency, DXGI_MAX_SWAP_CHAIN_BUFFERS);
+            }
+
+            INFO("Using low latency presentation, target latency %u frames.\n", swapchain->frame_latency);
+        }
+        else
+            WARN("Low latency presentation requires VK_KHR_present_id and VK_KHR_present_wait.\n");
+    }
+
     if (FAILED(hr = ID3D12Device9_CreateFence(d3d12_swapchain_device_iface(swapchain), DXGI_MAX_SWAP_CHAIN_BUFFERS,
             0, &IID_ID3D12Fence, (void **)&swapchain->frame_latency_fence)))
     {
@@ -2873,6 +3374,16 @@ static HRESULT d3d12_swapchain_init(struct d3d12_swapchain *swapchain, IDXGIFact
         return hr;
     }
 
+    if (FAILED(hr = vkd3d_create_thread(queue->device->vkd3d_instance,
+            d3d12_swapchain_present_main, swapchain, &swapchain->present.thread)))
+    {
+        ERR("Failed to create present thread, hr %#x.\n", hr);
+        d3d12_swapchain_destroy(swapchain);
+        return hr;
+    }
+
+    swapchain->present.thread_running = true;
+
     if (FAILED(hr = d3d12_swapchain_set_fullscreen(swapchain, target, TRUE)))
     {
         ERR("Failed to enter fullscreen.");
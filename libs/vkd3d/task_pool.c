@@ -0,0 +1,346 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_private.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef VKD3D_ENABLE_PROFILING
+static const char * const vkd3d_task_type_names[] =
+{
+    "task_shader_compile",
+    "task_state_object_compile",
+    "task_deferred_operation_join",
+    "task_meta_prewarm",
+    "task_device_init",
+    "task_residency",
+};
+
+STATIC_ASSERT(ARRAY_SIZE(vkd3d_task_type_names) == VKD3D_TASK_TYPE_COUNT);
+
+static uint32_t vkd3d_task_type_latches[VKD3D_TASK_TYPE_COUNT];
+static spinlock_t vkd3d_task_type_locks[VKD3D_TASK_TYPE_COUNT];
+#endif
+
+static uint32_t vkd3d_task_pool_get_thread_count(void)
+{
+    long cpu_count;
+
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    cpu_count = info.dwNumberOfProcessors;
+#else
+    cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    /* Leave one core to the application thread which waits on the results. */
+    cpu_count -= 1;
+
+    if (cpu_count < 2)
+        return 2;
+    if (cpu_count > VKD3D_TASK_POOL_MAX_THREAD_COUNT)
+        return VKD3D_TASK_POOL_MAX_THREAD_COUNT;
+    return cpu_count;
+}
+
+static void vkd3d_task_pool_execute_task_locked(struct vkd3d_task_pool *pool, const struct vkd3d_task *task)
+{
+#ifdef VKD3D_ENABLE_PROFILING
+    unsigned int region_index;
+    uint64_t begin_ticks;
+#endif
+
+    pthread_mutex_unlock(&pool->mutex);
+
+#ifdef VKD3D_ENABLE_PROFILING
+    if (!(region_index = vkd3d_atomic_uint32_load_explicit(&vkd3d_task_type_latches[task->type],
+            vkd3d_memory_order_acquire)))
+    {
+        region_index = vkd3d_profiling_register_region(vkd3d_task_type_names[task->type],
+                &vkd3d_task_type_locks[task->type], &vkd3d_task_type_latches[task->type]);
+    }
+
+    begin_ticks = region_index ? vkd3d_profiling_get_tick_count() : 0;
+#endif
+
+    task->func(task->userdata);
+
+#ifdef VKD3D_ENABLE_PROFILING
+    if (region_index)
+        vkd3d_profiling_notify_work(region_index, begin_ticks, vkd3d_profiling_get_tick_count(), 1);
+#endif
+
+    pthread_mutex_lock(&pool->mutex);
+
+    if (!--task->group->pending_count)
+        pthread_cond_broadcast(&pool->done_cond);
+}
+
+static void vkd3d_task_queue_remove(struct vkd3d_task_queue *queue, size_t index, struct vkd3d_task *task)
+{
+    struct vkd3d_task *tasks = queue->tasks + queue->task_head;
+
+    *task = tasks[index];
+
+    /* Tasks are mostly taken from the front, which only moves the head. */
+    if (!index)
+        queue->task_head++;
+    else
+        memmove(tasks + index, tasks + index + 1, (queue->task_count - index - 1) * sizeof(*tasks));
+
+    if (!--queue->task_count)
+        queue->task_head = 0;
+}
+
+static bool vkd3d_task_pool_pop_locked(struct vkd3d_task_pool *pool, struct vkd3d_task *task)
+{
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_TASK_PRIORITY_COUNT; i++)
+    {
+        if (pool->queues[i].task_count)
+        {
+            vkd3d_task_queue_remove(&pool->queues[i], 0, task);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool vkd3d_task_pool_pop_group_locked(struct vkd3d_task_pool *pool,
+        const struct vkd3d_task_group *group, struct vkd3d_task *task)
+{
+    struct vkd3d_task_queue *queue;
+    unsigned int i;
+    size_t j;
+
+    for (i = 0; i < VKD3D_TASK_PRIORITY_COUNT; i++)
+    {
+        queue = &pool->queues[i];
+
+        for (j = 0; j < queue->task_count; j++)
+        {
+            if (queue->tasks[queue->task_head + j].group == group)
+            {
+                vkd3d_task_queue_remove(queue, j, task);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+static void *vkd3d_task_pool_main(void *arg)
+{
+    struct vkd3d_task_pool *pool = arg;
+    struct vkd3d_task task;
+    int rc;
+
+    vkd3d_set_thread_name("vkd3d_worker");
+
+    if ((rc = pthread_mutex_lock(&pool->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return NULL;
+    }
+
+    for (;;)
+    {
+        if (vkd3d_task_pool_pop_locked(pool, &task))
+        {
+            vkd3d_task_pool_execute_task_locked(pool, &task);
+            continue;
+        }
+
+        if (pool->should_exit)
+            break;
+
+        if ((rc = pthread_cond_wait(&pool->cond, &pool->mutex)))
+        {
+            ERR("Failed to wait on condition variable, error %d.\n", rc);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+void vkd3d_task_pool_submit(struct vkd3d_task_pool *pool, enum vkd3d_task_type type,
+        enum vkd3d_task_priority priority, struct vkd3d_task_group *group,
+        void (*func)(void *userdata), void *userdata)
+{
+    struct vkd3d_task_queue *queue = &pool->queues[priority];
+    struct vkd3d_task *task;
+
+    if (!vkd3d_task_pool_is_active(pool))
+    {
+        func(userdata);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    /* Reclaim the consumed front of the queue before growing it. */
+    if (queue->task_head && queue->task_head + queue->task_count == queue->tasks_size)
+    {
+        memmove(queue->tasks, queue->tasks + queue->task_head, queue->task_count * sizeof(*queue->tasks));
+        queue->task_head = 0;
+    }
+
+    if (!vkd3d_array_reserve((void **)&queue->tasks, &queue->tasks_size,
+            queue->task_head + queue->task_count + 1, sizeof(*queue->tasks)))
+    {
+        pthread_mutex_unlock(&pool->mutex);
+        func(userdata);
+        return;
+    }
+
+    task = &queue->tasks[queue->task_head + queue->task_count++];
+    task->func = func;
+    task->userdata = userdata;
+    task->group = group;
+    task->type = type;
+    group->pending_count++;
+
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void vkd3d_task_pool_wait(struct vkd3d_task_pool *pool, struct vkd3d_task_group *group)
+{
+    struct vkd3d_task task;
+
+    if (!vkd3d_task_pool_is_active(pool))
+        return;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while (group->pending_count)
+    {
+        /* Take over our own tasks that no worker picked up yet. Running tasks of
+         * other groups here would only delay the caller. */
+        if (vkd3d_task_pool_pop_group_locked(pool, group, &task))
+            vkd3d_task_pool_execute_task_locked(pool, &task);
+        else
+            pthread_cond_wait(&pool->done_cond, &pool->mutex);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+HRESULT vkd3d_task_pool_start(struct vkd3d_task_pool *pool, struct d3d12_device *device)
+{
+    uint32_t thread_count, i;
+    HRESULT hr = S_OK;
+    int rc;
+
+    TRACE("pool %p.\n", pool);
+
+    memset(pool, 0, sizeof(*pool));
+
+    if ((rc = pthread_mutex_init(&pool->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if ((rc = pthread_cond_init(&pool->cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        hr = hresult_from_errno(rc);
+        goto fail_cond;
+    }
+
+    if ((rc = pthread_cond_init(&pool->done_cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        hr = hresult_from_errno(rc);
+        goto fail_done_cond;
+    }
+
+    thread_count = vkd3d_task_pool_get_thread_count();
+
+    for (i = 0; i < thread_count; i++)
+    {
+        if (FAILED(vkd3d_create_thread(device->vkd3d_instance,
+                vkd3d_task_pool_main, pool, &pool->threads[i])))
+            break;
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count)
+    {
+        TRACE("Started %u worker threads.\n", pool->thread_count);
+        return S_OK;
+    }
+
+    /* Without threads, tasks are simply executed on the submitting thread. */
+    WARN("Failed to create worker threads.\n");
+    pthread_cond_destroy(&pool->done_cond);
+fail_done_cond:
+    pthread_cond_destroy(&pool->cond);
+fail_cond:
+    pthread_mutex_destroy(&pool->mutex);
+    return hr;
+}
+
+HRESULT vkd3d_task_pool_stop(struct vkd3d_task_pool *pool, struct d3d12_device *device)
+{
+    HRESULT hr = S_OK;
+    uint32_t i;
+    int rc;
+
+    TRACE("pool %p.\n", pool);
+
+    if (!vkd3d_task_pool_is_active(pool))
+        return S_OK;
+
+    if ((rc = pthread_mutex_lock(&pool->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    pool->should_exit = true;
+    pthread_cond_broadcast(&pool->cond);
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->thread_count; i++)
+    {
+        if (FAILED(vkd3d_join_thread(device->vkd3d_instance, &pool->threads[i])))
+            hr = E_FAIL;
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    pthread_cond_destroy(&pool->done_cond);
+
+    for (i = 0; i < VKD3D_TASK_PRIORITY_COUNT; i++)
+        vkd3d_free(pool->queues[i].tasks);
+    pool->thread_count = 0;
+    return hr;
+}
@@ -0,0 +1,401 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#include "vkd3d_private.h"
+
+static uint32_t vkd3d_upload_ring_get_largest_device_local_heap(struct d3d12_device *device)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_properties = &device->memory_properties;
+    VkDeviceSize largest_size = 0;
+    uint32_t heap_index = 0;
+    uint32_t i;
+
+    for (i = 0; i < memory_properties->memoryHeapCount; i++)
+    {
+        if ((memory_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) &&
+                memory_properties->memoryHeaps[i].size > largest_size)
+        {
+            largest_size = memory_properties->memoryHeaps[i].size;
+            heap_index = i;
+        }
+    }
+
+    return heap_index;
+}
+
+static uint32_t vkd3d_upload_ring_get_type_mask(struct d3d12_device *device,
+        VkMemoryPropertyFlags required_flags, VkMemoryPropertyFlags forbidden_flags, uint32_t heap_index)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_properties = &device->memory_properties;
+    VkMemoryPropertyFlags flags;
+    uint32_t i, mask = 0;
+
+    for (i = 0; i < memory_properties->memoryTypeCount; i++)
+    {
+        flags = memory_properties->memoryTypes[i].propertyFlags;
+
+        if ((flags & required_flags) != required_flags || (flags & forbidden_flags))
+            continue;
+
+        if (heap_index != UINT32_MAX && memory_properties->memoryTypes[i].heapIndex != heap_index)
+            continue;
+
+        mask |= 1u << i;
+    }
+
+    return mask;
+}
+
+static HRESULT vkd3d_upload_ring_create_buffer(struct d3d12_device *device, VkDeviceSize size,
+        D3D12_HEAP_TYPE heap_type, VkMemoryPropertyFlags type_flags, uint32_t type_mask,
+        VkBuffer *vk_buffer, struct vkd3d_device_memory_allocation *allocation)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC1 buffer_desc;
+    HRESULT hr;
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = heap_type;
+
+    memset(&buffer_desc, 0, sizeof(buffer_desc));
+    buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    buffer_desc.Width = size;
+    buffer_desc.Height = 1;
+    buffer_desc.DepthOrArraySize = 1;
+    buffer_desc.MipLevels = 1;
+    buffer_desc.SampleDesc.Count = 1;
+    buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+    if (FAILED(hr = vkd3d_create_buffer(device, &heap_properties,
+            D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, &buffer_desc, vk_buffer)))
+        return hr;
+
+    if (FAILED(hr = vkd3d_allocate_buffer_memory_masked(device, *vk_buffer,
+            type_flags, type_mask, allocation)))
+    {
+        VK_CALL(vkDestroyBuffer(device->vk_device, *vk_buffer, NULL));
+        *vk_buffer = VK_NULL_HANDLE;
+    }
+
+    return hr;
+}
+
+static HRESULT vkd3d_upload_ring_init_device_local(struct vkd3d_upload_ring *ring)
+{
+    const VkMemoryPropertyFlags type_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    struct d3d12_device *device = ring->device;
+    uint32_t type_mask;
+
+    /* Only take this path if host-visible VRAM covers the whole VRAM heap (resizable BAR or UMA).
+     * A small BAR window is better left to the application's render targets and upload heaps. */
+    type_mask = vkd3d_upload_ring_get_type_mask(device, type_flags, 0,
+            vkd3d_upload_ring_get_largest_device_local_heap(device));
+
+    if (!type_mask)
+        return E_NOTIMPL;
+
+    return vkd3d_upload_ring_create_buffer(device, ring->size, D3D12_HEAP_TYPE_UPLOAD,
+            type_flags, type_mask, &ring->host_buffer, &ring->host_allocation);
+}
+
+static HRESULT vkd3d_upload_ring_init_system_memory_copy(struct vkd3d_upload_ring *ring)
+{
+    const VkMemoryPropertyFlags type_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    struct d3d12_device *device = ring->device;
+    uint32_t type_mask;
+    HRESULT hr;
+
+    /* Keep the staging side out of any BAR window. */
+    if (!(type_mask = vkd3d_upload_ring_get_type_mask(device, type_flags,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, UINT32_MAX)))
+        type_mask = UINT32_MAX;
+
+    if (FAILED(hr = vkd3d_upload_ring_create_buffer(device, ring->size, D3D12_HEAP_TYPE_UPLOAD,
+            type_flags, type_mask, &ring->host_buffer, &ring->host_allocation)))
+        return hr;
+
+    return vkd3d_upload_ring_create_buffer(device, ring->size, D3D12_HEAP_TYPE_DEFAULT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, UINT32_MAX, &ring->device_buffer, &ring->device_allocation);
+}
+
+static void vkd3d_upload_ring_cleanup_buffers(struct vkd3d_upload_ring *ring)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &ring->device->vk_procs;
+    struct d3d12_device *device = ring->device;
+
+    if (ring->device_buffer)
+    {
+        VK_CALL(vkDestroyBuffer(device->vk_device, ring->device_buffer, NULL));
+        vkd3d_free_device_memory(device, &ring->device_allocation);
+        ring->device_buffer = VK_NULL_HANDLE;
+    }
+
+    if (ring->host_buffer)
+    {
+        VK_CALL(vkDestroyBuffer(device->vk_device, ring->host_buffer, NULL));
+        vkd3d_free_device_memory(device, &ring->host_allocation);
+        ring->host_buffer = VK_NULL_HANDLE;
+    }
+}
+
+HRESULT vkd3d_upload_ring_create(struct d3d12_device *device, VkDeviceSize size,
+        struct vkd3d_upload_ring **out_ring)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_upload_ring *ring;
+    void *host_ptr;
+    VkResult vr;
+    HRESULT hr;
+    int rc;
+
+    if (!(ring = vkd3d_calloc(1, sizeof(*ring))))
+        return E_OUTOFMEMORY;
+
+    ring->device = device;
+    ring->size = align64(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    if ((rc = pthread_mutex_init(&ring->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        vkd3d_free(ring);
+        return hresult_from_errno(rc);
+    }
+
+    if (SUCCEEDED(hr = vkd3d_upload_ring_init_device_local(ring)))
+    {
+        ring->placement = D3D12_VK_UPLOAD_RING_PLACEMENT_DEVICE_LOCAL;
+    }
+    else
+    {
+        vkd3d_upload_ring_cleanup_buffers(ring);
+
+        if (FAILED(hr = vkd3d_upload_ring_init_system_memory_copy(ring)))
+        {
+            ERR("Failed to allocate upload ring memory, hr %#x.\n", hr);
+            goto fail;
+        }
+
+        ring->placement = D3D12_VK_UPLOAD_RING_PLACEMENT_SYSTEM_MEMORY_COPY;
+    }
+
+    if ((vr = VK_CALL(vkMapMemory(device->vk_device, ring->host_allocation.vk_memory,
+            0, VK_WHOLE_SIZE, 0, &host_ptr))))
+    {
+        ERR("Failed to map upload ring, vr %d.\n", vr);
+        hr = hresult_from_vk_result(vr);
+        goto fail;
+    }
+
+    ring->host_ptr = host_ptr;
+    ring->gpu_va = vkd3d_get_buffer_device_address(device,
+            ring->device_buffer ? ring->device_buffer : ring->host_buffer);
+
+    if (FAILED(hr = d3d12_fence_create(device, 0, D3D12_FENCE_FLAG_NONE, &ring->fence)))
+    {
+        ERR("Failed to create upload ring fence, hr %#x.\n", hr);
+        goto fail;
+    }
+
+    TRACE("Created %"PRIu64" byte upload ring, placement %u.\n", ring->size, ring->placement);
+
+    *out_ring = ring;
+    return S_OK;
+
+fail:
+    vkd3d_upload_ring_cleanup_buffers(ring);
+    pthread_mutex_destroy(&ring->mutex);
+    vkd3d_free(ring);
+    return hr;
+}
+
+void vkd3d_upload_ring_destroy(struct vkd3d_upload_ring *ring)
+{
+    /* The application must not destroy the ring while the GPU still reads from it,
+     * but be safe and drain the frames which are still in flight. */
+    if (ring->fence_value)
+        d3d12_fence_set_event_on_completion(ring->fence, ring->fence_value, NULL, VKD3D_WAITING_EVENT_TYPE_EVENT);
+
+    TRACE("Destroying upload ring, peak usage %"PRIu64" of %"PRIu64" bytes.\n", ring->peak_usage, ring->size);
+
+    ID3D12Fence1_Release(&ring->fence->ID3D12Fence_iface);
+    vkd3d_upload_ring_cleanup_buffers(ring);
+    pthread_mutex_destroy(&ring->mutex);
+    vkd3d_free(ring);
+}
+
+static bool vkd3d_upload_ring_reclaim_locked(struct vkd3d_upload_ring *ring, bool wait)
+{
+    struct vkd3d_upload_ring_frame *frame;
+    uint64_t completed_value;
+    bool reclaimed = false;
+
+    if (wait && ring->frame_count)
+    {
+        frame = &ring->frames[ring->frame_head];
+        d3d12_fence_set_event_on_completion(ring->fence, frame->fence_value, NULL, VKD3D_WAITING_EVENT_TYPE_EVENT);
+    }
+
+    completed_value = ID3D12Fence1_GetCompletedValue(&ring->fence->ID3D12Fence_iface);
+
+    while (ring->frame_count)
+    {
+        frame = &ring->frames[ring->frame_head];
+
+        if (frame->fence_value > completed_value)
+            break;
+
+        ring->tail = frame->end_offset;
+        ring->frame_head = (ring->frame_head + 1) % VKD3D_UPLOAD_RING_MAX_FRAME_COUNT;
+        ring->frame_count--;
+        reclaimed = true;
+    }
+
+    return reclaimed;
+}
+
+HRESULT vkd3d_upload_ring_allocate(struct vkd3d_upload_ring *ring, VkDeviceSize size,
+        VkDeviceSize alignment, D3D12_VK_UPLOAD_RING_ALLOCATION *allocation)
+{
+    uint64_t offset, lap_offset;
+
+    if (!alignment)
+        alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+
+    if (!size || size > ring->size || (alignment & (alignment - 1)) || alignment > ring->size)
+        return E_INVALIDARG;
+
+    pthread_mutex_lock(&ring->mutex);
+
+    for (;;)
+    {
+        offset = align64(ring->head, alignment);
+        lap_offset = offset % ring->size;
+
+        /* Allocations are contiguous, so skip the rest of the lap if the allocation does not fit. */
+        if (lap_offset + size > ring->size)
+            offset += ring->size - lap_offset;
+
+        if (offset + size - ring->tail <= ring->size)
+            break;
+
+        /* Wait for the GPU only if nothing completed, and only
+         * if the space is held by frames which were submitted. */
+        if (!vkd3d_upload_ring_reclaim_locked(ring, false) &&
+                !vkd3d_upload_ring_reclaim_locked(ring, true))
+        {
+            pthread_mutex_unlock(&ring->mutex);
+            WARN("Upload ring is full, %"PRIu64" of %"PRIu64" bytes are used by the current frame.\n",
+                    ring->head - ring->tail, ring->size);
+            return E_OUTOFMEMORY;
+        }
+    }
+
+    ring->head = offset + size;
+    ring->peak_usage = max(ring->peak_usage, ring->head - ring->tail);
+    pthread_mutex_unlock(&ring->mutex);
+
+    allocation->cpuAddress = ring->host_ptr + offset % ring->size;
+    allocation->gpuAddress = ring->gpu_va + offset % ring->size;
+    allocation->size = size;
+    return S_OK;
+}
+
+HRESULT vkd3d_upload_ring_flush(struct vkd3d_upload_ring *ring, ID3D12GraphicsCommandList *command_list)
+{
+    uint64_t begin, end, lap_begin;
+    VkBufferCopy regions[2];
+    uint32_t region_count;
+    HRESULT hr;
+
+    /* Zero-copy placement, the GPU sees CPU writes directly. */
+    if (ring->placement == D3D12_VK_UPLOAD_RING_PLACEMENT_DEVICE_LOCAL)
+        return S_OK;
+
+    pthread_mutex_lock(&ring->mutex);
+
+    /* Anything before the tail was retired without being flushed and is gone already. */
+    begin = max(ring->flush_offset, ring->tail);
+    end = ring->head;
+    region_count = 0;
+
+    if (begin != end)
+    {
+        lap_begin = begin % ring->size;
+
+        regions[0].srcOffset = lap_begin;
+        regions[0].dstOffset = lap_begin;
+        regions[0].size = min(end - begin, ring->size - lap_begin);
+        region_count++;
+
+        if (regions[0].size < end - begin)
+        {
+            regions[1].srcOffset = 0;
+            regions[1].dstOffset = 0;
+            regions[1].size = end - begin - regions[0].size;
+            region_count++;
+        }
+    }
+
+    if (SUCCEEDED(hr = d3d12_command_list_copy_buffer_ranges(command_list,
+            ring->host_buffer, ring->device_buffer, region_count, regions)))
+        ring->flush_offset = end;
+
+    pthread_mutex_unlock(&ring->mutex);
+    return hr;
+}
+
+HRESULT vkd3d_upload_ring_retire_frame(struct vkd3d_upload_ring *ring, ID3D12CommandQueue *queue)
+{
+    struct vkd3d_upload_ring_frame *frame;
+    uint64_t frame_begin;
+    HRESULT hr;
+
+    pthread_mutex_lock(&ring->mutex);
+
+    frame_begin = ring->frame_count ? ring->frames[(ring->frame_head + ring->frame_count - 1) %
+            VKD3D_UPLOAD_RING_MAX_FRAME_COUNT].end_offset : ring->tail;
+
+    /* Nothing was allocated since the last frame, so there is nothing to track. */
+    if (frame_begin == ring->head)
+    {
+        pthread_mutex_unlock(&ring->mutex);
+        return S_OK;
+    }
+
+    if (ring->frame_count == VKD3D_UPLOAD_RING_MAX_FRAME_COUNT)
+        vkd3d_upload_ring_reclaim_locked(ring, true);
+
+    if (FAILED(hr = ID3D12CommandQueue_Signal(queue, (ID3D12Fence *)&ring->fence->ID3D12Fence_iface,
+            ring->fence_value + 1)))
+    {
+        pthread_mutex_unlock(&ring->mutex);
+        return hr;
+    }
+
+    frame = &ring->frames[(ring->frame_head + ring->frame_count) % VKD3D_UPLOAD_RING_MAX_FRAME_COUNT];
+    frame->end_offset = ring->head;
+    frame->fence_value = ++ring->fence_value;
+    ring->frame_count++;
+
+    pthread_mutex_unlock(&ring->mutex);
+    return S_OK;
+}
@@ -19,6 +19,7 @@
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
 
 #include "vkd3d_private.h"
+#include "vkd3d_memcpy.h"
 
 #include <errno.h>
 
@@ -615,26 +616,62 @@ VkFormat vkd3d_internal_get_vk_format(const struct d3d12_device *device, DXGI_FO
 
 void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *src,
         unsigned int src_row_pitch, unsigned int src_slice_pitch, uint8_t *dst, unsigned int dst_row_pitch,
-        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d)
+        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d,
+        enum vkd3d_format_copy_mode mode)
 {
-    unsigned int row_block_count, row_count, row_size, slice, row;
+    unsigned int row_block_count, row_count, slice, row;
     unsigned int slice_count = d;
+    bool stream_load = false;
     const uint8_t *src_row;
     uint8_t *dst_row;
+    size_t row_size;
 
     row_block_count = (w + format->block_width - 1) / format->block_width;
     row_count = (h + format->block_height - 1) / format->block_height;
-    row_size = row_block_count * format->byte_count * format->block_byte_count;
+    row_size = (size_t)row_block_count * format->byte_count * format->block_byte_count;
+
+    /* Tightly packed on both sides, e.g. full-width BC or RGBA8 slices */
+    if (src_row_pitch == row_size && dst_row_pitch == row_size &&
+            (slice_count == 1 || (src_slice_pitch == row_size * row_count && dst_slice_pitch == src_slice_pitch)))
+    {
+        row_size *= (size_t)row_count * slice_count;
+        row_count = 1;
+        slice_count = 1;
+    }
+
+    if (mode == VKD3D_FORMAT_COPY_MODE_STREAMING_READ)
+    {
+        stream_load = vkd3d_memcpy_stream_load_supported();
+        vkd3d_memcpy_stream_load_fence();
+    }
 
     for (slice = 0; slice < slice_count; ++slice)
     {
         for (row = 0; row < row_count; ++row)
         {
-            src_row = &src[slice * src_slice_pitch + row * src_row_pitch];
-            dst_row = &dst[slice * dst_slice_pitch + row * dst_row_pitch];
-            memcpy(dst_row, src_row, row_size);
+            src_row = &src[(size_t)slice * src_slice_pitch + (size_t)row * src_row_pitch];
+            dst_row = &dst[(size_t)slice * dst_slice_pitch + (size_t)row * dst_row_pitch];
+
+            switch (mode)
+            {
+                case VKD3D_FORMAT_COPY_MODE_STREAMING_WRITE:
+                    vkd3d_memcpy_stream_store(dst_row, src_row, row_size);
+                    break;
+
+                case VKD3D_FORMAT_COPY_MODE_STREAMING_READ:
+                    vkd3d_memcpy_stream_load(dst_row, src_row, row_size, stream_load);
+                    break;
+
+                default:
+                    memcpy(dst_row, src_row, row_size);
+                    break;
+            }
         }
     }
+
+    /* Make non-temporal stores globally visible before returning */
+    if (mode == VKD3D_FORMAT_COPY_MODE_STREAMING_WRITE)
+        vkd3d_memcpy_stream_store_fence();
 }
 
 VKD3D_EXPORT VkFormat vkd3d_get_vk_format(DXGI_FORMAT format)
@@ -33,7 +33,9 @@ static inline VkDeviceAddress vkd3d_va_map_get_block_address(VkDeviceAddress va)
 static struct vkd3d_va_block *vkd3d_va_map_find_block(struct vkd3d_va_map *va_map, VkDeviceAddress va)
 {
     VkDeviceAddress next_address = vkd3d_va_map_get_next_address(va);
+    VkDeviceAddress block_address = vkd3d_va_map_get_block_address(va);
     struct vkd3d_va_tree *tree = &va_map->va_tree;
+    struct vkd3d_va_block_page *page;
 
     while (next_address && tree)
     {
@@ -44,44 +46,110 @@ static struct vkd3d_va_block *vkd3d_va_map_find_block(struct vkd3d_va_map *va_ma
     if (!tree)
         return NULL;
 
-    return &tree->blocks[vkd3d_va_map_get_block_address(va)];
+    page = vkd3d_atomic_ptr_load_explicit(&tree->pages[block_address >> VKD3D_VA_BLOCK_PAGE_BITS], vkd3d_memory_order_acquire);
+
+    if (!page)
+        return NULL;
+
+    return &page->blocks[block_address & VKD3D_VA_BLOCK_PAGE_MASK];
 }
 
-static struct vkd3d_va_block *vkd3d_va_map_get_block(struct vkd3d_va_map *va_map, VkDeviceAddress va)
+#define VKD3D_VA_NODE_POOL_CHUNK_SIZE VKD3D_HUGE_PAGE_SIZE
+#define VKD3D_VA_NODE_POOL_ALIGNMENT 64
+
+static void *vkd3d_va_node_pool_alloc_locked(struct vkd3d_va_node_pool *pool, size_t size)
 {
-    VkDeviceAddress next_address = vkd3d_va_map_get_next_address(va);
-    struct vkd3d_va_tree *tree, **tree_ptr;
-    
-    tree = &va_map->va_tree;
+    struct vkd3d_va_node_chunk *chunk;
+    void *node;
 
-    while (next_address)
+    size = align(size, VKD3D_VA_NODE_POOL_ALIGNMENT);
+
+    if (!pool->chunks_count || pool->offset + size > VKD3D_VA_NODE_POOL_CHUNK_SIZE)
     {
-        tree_ptr = &tree->next[next_address & VKD3D_VA_NEXT_MASK];
-        tree = vkd3d_atomic_ptr_load_explicit(tree_ptr, vkd3d_memory_order_acquire);
+        if (!vkd3d_array_reserve((void **)&pool->chunks, &pool->chunks_size,
+                pool->chunks_count + 1, sizeof(*pool->chunks)))
+            return NULL;
 
-        if (!tree)
+        chunk = &pool->chunks[pool->chunks_count];
+        if (!(chunk->ptr = vkd3d_malloc_huge(VKD3D_VA_NODE_POOL_CHUNK_SIZE,
+                VKD3D_VA_NODE_POOL_CHUNK_SIZE, &chunk->huge_pages)))
         {
-            void *orig;
-            tree = vkd3d_calloc(1, sizeof(*tree));
-            orig = vkd3d_atomic_ptr_compare_exchange(tree_ptr, NULL, tree, vkd3d_memory_order_release, vkd3d_memory_order_acquire);
+            ERR("Failed to allocate VA tree chunk.\n");
+            return NULL;
+        }
 
-            if (orig)
-            {
-                vkd3d_free(tree);
-                tree = orig;
-            }
+        memset(chunk->ptr, 0, VKD3D_VA_NODE_POOL_CHUNK_SIZE);
+        pool->chunks_count++;
+        pool->offset = 0;
+    }
+
+    node = (uint8_t *)pool->chunks[pool->chunks_count - 1].ptr + pool->offset;
+    pool->offset += size;
+    return node;
+}
+
+static void *vkd3d_va_map_get_or_create_node(struct vkd3d_va_map *va_map, void **node_ptr, size_t size)
+{
+    struct vkd3d_va_node_pool *pool = &va_map->node_pool;
+    void *node, *orig;
+
+    if ((node = vkd3d_atomic_ptr_load_explicit(node_ptr, vkd3d_memory_order_acquire)))
+        return node;
+
+    if (pool->enabled)
+    {
+        /* Pool memory cannot be returned, so serialize creation instead of
+         * racing on the compare-exchange below. */
+        pthread_mutex_lock(&pool->mutex);
+        if (!(node = vkd3d_atomic_ptr_load_explicit(node_ptr, vkd3d_memory_order_relaxed)))
+        {
+            if ((node = vkd3d_va_node_pool_alloc_locked(pool, size)))
+                vkd3d_atomic_ptr_store_explicit(node_ptr, node, vkd3d_memory_order_release);
         }
+        pthread_mutex_unlock(&pool->mutex);
+        return node;
+    }
 
-        next_address >>= VKD3D_VA_NEXT_BITS;
+    node = vkd3d_calloc(1, size);
+    orig = vkd3d_atomic_ptr_compare_exchange(node_ptr, NULL, node, vkd3d_memory_order_release, vkd3d_memory_order_acquire);
+
+    if (orig)
+    {
+        vkd3d_free(node);
+        node = orig;
     }
+
+    return node;
+}
+
+static struct vkd3d_va_block *vkd3d_va_map_get_block(struct vkd3d_va_map *va_map, VkDeviceAddress va)
+{
+    VkDeviceAddress next_address = vkd3d_va_map_get_next_address(va);
+    VkDeviceAddress block_address = vkd3d_va_map_get_block_address(va);
+    struct vkd3d_va_block_page *page;
+    struct vkd3d_va_tree *tree;
     
-    return &tree->blocks[vkd3d_va_map_get_block_address(va)];
+    tree = &va_map->va_tree;
+
+    while (next_address)
+    {
+        tree = vkd3d_va_map_get_or_create_node(va_map,
+                (void **)&tree->next[next_address & VKD3D_VA_NEXT_MASK], sizeof(*tree));
+        next_address >>= VKD3D_VA_NEXT_BITS;
+    }
+
+    page = vkd3d_va_map_get_or_create_node(va_map,
+            (void **)&tree->pages[block_address >> VKD3D_VA_BLOCK_PAGE_BITS], sizeof(*page));
+    return &page->blocks[block_address & VKD3D_VA_BLOCK_PAGE_MASK];
 }
 
 static void vkd3d_va_map_cleanup_tree(struct vkd3d_va_tree *tree)
 {
     unsigned int i;
 
+    for (i = 0; i < ARRAY_SIZE(tree->pages); i++)
+        vkd3d_free(tree->pages[i]);
+
     for (i = 0; i < ARRAY_SIZE(tree->next); i++)
     {
         if (tree->next[i])
@@ -92,11 +160,11 @@ static void vkd3d_va_map_cleanup_tree(struct vkd3d_va_tree *tree)
     }
 }
 
-static struct vkd3d_unique_resource *vkd3d_va_map_find_small_entry(struct vkd3d_va_map *va_map,
+static struct vkd3d_unique_resource *vkd3d_va_map_find_small_entry(const struct vkd3d_va_small_table *table,
         VkDeviceAddress va, size_t *index)
 {
     struct vkd3d_unique_resource *resource = NULL;
-    size_t hi = va_map->small_entries_count;
+    size_t hi = table ? table->count : 0;
     size_t lo = 0;
 
     while (lo < hi)
@@ -104,7 +172,7 @@ static struct vkd3d_unique_resource *vkd3d_va_map_find_small_entry(struct vkd3d_
         struct vkd3d_unique_resource *r;
         size_t i = lo + (hi - lo) / 2;
 
-        r = va_map->small_entries[i];
+        r = table->entries[i];
 
         if (va < r->va)
             hi = i;
@@ -123,8 +191,84 @@ static struct vkd3d_unique_resource *vkd3d_va_map_find_small_entry(struct vkd3d_
     return resource;
 }
 
+static VKD3D_THREAD_LOCAL uint32_t vkd3d_va_map_reader_shard_index = UINT32_MAX;
+static uint32_t vkd3d_va_map_reader_shard_counter;
+
+static struct vkd3d_va_map_reader_shard *vkd3d_va_map_get_reader_shard(struct vkd3d_va_map *va_map)
+{
+    if (vkd3d_va_map_reader_shard_index == UINT32_MAX)
+    {
+        vkd3d_va_map_reader_shard_index = vkd3d_atomic_uint32_increment(
+                &vkd3d_va_map_reader_shard_counter, vkd3d_memory_order_relaxed) % VKD3D_VA_MAP_READER_SHARD_COUNT;
+    }
+
+    return &va_map->reader_shards[vkd3d_va_map_reader_shard_index];
+}
+
+static struct vkd3d_unique_resource *vkd3d_va_map_deref_small_entry(struct vkd3d_va_map *va_map, VkDeviceAddress va)
+{
+    struct vkd3d_va_map_reader_shard *shard = vkd3d_va_map_get_reader_shard(va_map);
+    const struct vkd3d_va_small_table *table;
+    struct vkd3d_unique_resource *resource;
+    uint32_t epoch;
+
+    /* The counter increment must be ordered before the table load, pairs
+     * with the table store and counter loads in vkd3d_va_map_publish_small_table. */
+    epoch = vkd3d_atomic_uint32_load_explicit(&va_map->reader_epoch, vkd3d_memory_order_relaxed) & 1;
+    vkd3d_atomic_uint32_increment(&shard->counts[epoch], vkd3d_memory_order_seq_cst);
+
+    table = vkd3d_atomic_ptr_load_explicit(&va_map->small_table, vkd3d_memory_order_seq_cst);
+    resource = vkd3d_va_map_find_small_entry(table, va, NULL);
+
+    vkd3d_atomic_uint32_decrement(&shard->counts[epoch], vkd3d_memory_order_release);
+    return resource;
+}
+
+static void vkd3d_va_map_wait_readers(struct vkd3d_va_map *va_map, uint32_t epoch)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(va_map->reader_shards); i++)
+    {
+        while (vkd3d_atomic_uint32_load_explicit(&va_map->reader_shards[i].counts[epoch], vkd3d_memory_order_seq_cst))
+            vkd3d_pause();
+    }
+}
+
+/* Must be called with va_map->mutex held. */
+static void vkd3d_va_map_publish_small_table(struct vkd3d_va_map *va_map, struct vkd3d_va_small_table *table)
+{
+    struct vkd3d_va_small_table *old_table = va_map->small_table;
+    unsigned int i;
+    uint32_t epoch;
+
+    vkd3d_atomic_ptr_store_explicit(&va_map->small_table, table, vkd3d_memory_order_seq_cst);
+
+    /* Any reader that registered before the new table became visible may
+     * still be using the old one. Flip the epoch before draining each
+     * counter so that a steady stream of new readers cannot starve us,
+     * and do it twice to also catch readers which sampled a stale epoch. */
+    for (i = 0; i < 2; i++)
+    {
+        epoch = vkd3d_atomic_uint32_increment(&va_map->reader_epoch, vkd3d_memory_order_seq_cst);
+        vkd3d_va_map_wait_readers(va_map, (epoch - 1) & 1);
+    }
+
+    vkd3d_free(old_table);
+}
+
+static struct vkd3d_va_small_table *vkd3d_va_map_create_small_table(size_t count)
+{
+    struct vkd3d_va_small_table *table;
+
+    if ((table = vkd3d_malloc(offsetof(struct vkd3d_va_small_table, entries) + count * sizeof(*table->entries))))
+        table->count = count;
+    return table;
+}
+
 void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resource *resource)
 {
+    struct vkd3d_va_small_table *table, *new_table;
     VkDeviceAddress block_va, min_va, max_va;
     struct vkd3d_va_block *block;
     size_t index;
@@ -156,25 +300,37 @@ void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resour
     else
     {
         pthread_mutex_lock(&va_map->mutex);
+        table = va_map->small_table;
 
-        if (!vkd3d_va_map_find_small_entry(va_map, resource->va, &index))
+        if (!vkd3d_va_map_find_small_entry(table, resource->va, &index))
         {
-            vkd3d_array_reserve((void**)&va_map->small_entries, &va_map->small_entries_size,
-                    va_map->small_entries_count + 1, sizeof(*va_map->small_entries));
-
-            memmove(&va_map->small_entries[index + 1], &va_map->small_entries[index],
-                    sizeof(*va_map->small_entries) * (va_map->small_entries_count - index));
-
-            va_map->small_entries[index] = resource;
-            va_map->small_entries_count += 1;
+            if ((new_table = vkd3d_va_map_create_small_table((table ? table->count : 0) + 1)))
+            {
+                if (table)
+                {
+                    memcpy(&new_table->entries[0], &table->entries[0], sizeof(*table->entries) * index);
+                    memcpy(&new_table->entries[index + 1], &table->entries[index],
+                            sizeof(*table->entries) * (table->count - index));
+                }
+
+                new_table->entries[index] = resource;
+                vkd3d_va_map_publish_small_table(va_map, new_table);
+            }
+            else
+                ERR("Failed to allocate VA table.\n");
         }
 
         pthread_mutex_unlock(&va_map->mutex);
     }
+
+    /* Must happen after the resource is unreachable, so that a cache which
+     * observes the new generation can never resolve to the removed resource. */
+    vkd3d_atomic_uint32_increment(&va_map->generation, vkd3d_memory_order_release);
 }
 
 void vkd3d_va_map_remove(struct vkd3d_va_map *va_map, const struct vkd3d_unique_resource *resource)
 {
+    struct vkd3d_va_small_table *table, *new_table;
     VkDeviceAddress block_va, min_va, max_va;
     struct vkd3d_va_block *block;
     size_t index;
@@ -206,13 +362,19 @@ void vkd3d_va_map_remove(struct vkd3d_va_map *va_map, const struct vkd3d_unique_
     else
     {
         pthread_mutex_lock(&va_map->mutex);
+        table = va_map->small_table;
 
-        if (vkd3d_va_map_find_small_entry(va_map, resource->va, &index) == resource)
+        if (vkd3d_va_map_find_small_entry(table, resource->va, &index) == resource)
         {
-            va_map->small_entries_count -= 1;
-
-            memmove(&va_map->small_entries[index], &va_map->small_entries[index + 1],
-                    sizeof(*va_map->small_entries) * (va_map->small_entries_count - index));
+            if ((new_table = vkd3d_va_map_create_small_table(table->count - 1)))
+            {
+                memcpy(&new_table->entries[0], &table->entries[0], sizeof(*table->entries) * index);
+                memcpy(&new_table->entries[index], &table->entries[index + 1],
+                        sizeof(*table->entries) * (new_table->count - index));
+                vkd3d_va_map_publish_small_table(va_map, new_table);
+            }
+            else
+                ERR("Failed to allocate VA table.\n");
         }
 
         pthread_mutex_unlock(&va_map->mutex);
@@ -233,18 +395,20 @@ static struct vkd3d_unique_resource *vkd3d_va_map_deref_mutable(struct vkd3d_va_
     }
 
     if (!resource)
-    {
-        pthread_mutex_lock(&va_map->mutex);
-        resource = vkd3d_va_map_find_small_entry(va_map, va, NULL);
-        pthread_mutex_unlock(&va_map->mutex);
-    }
+        resource = vkd3d_va_map_deref_small_entry(va_map, va);
 
     return resource;
 }
 
 const struct vkd3d_unique_resource *vkd3d_va_map_deref(struct vkd3d_va_map *va_map, VkDeviceAddress va)
 {
-    return vkd3d_va_map_deref_mutable(va_map, va);
+    const struct vkd3d_unique_resource *resource;
+    VKD3D_REGION_DECL(va_map_deref);
+
+    VKD3D_REGION_BEGIN_DETAIL(va_map_deref);
+    resource = vkd3d_va_map_deref_mutable(va_map, va);
+    VKD3D_REGION_END_DETAIL(va_map_deref);
+    return resource;
 }
 
 VkAccelerationStructureKHR vkd3d_va_map_place_acceleration_structure(struct vkd3d_va_map *va_map,
@@ -300,14 +464,114 @@ VkAccelerationStructureKHR vkd3d_va_map_place_acceleration_structure(struct vkd3
     return view->vk_acceleration_structure;
 }
 
+VkAccelerationStructureKHR vkd3d_va_map_place_acceleration_structure_cached(struct vkd3d_va_map *va_map,
+        struct d3d12_device *device, struct vkd3d_va_map_as_cache *cache,
+        VkDeviceAddress va)
+{
+    struct vkd3d_va_map_as_cache_entry *entry;
+    VkAccelerationStructureKHR vk_as;
+    uint32_t generation;
+
+    /* Load the generation before resolving, so that an entry added here
+     * is stale as soon as a concurrent removal completes. */
+    generation = vkd3d_atomic_uint32_load_explicit(&va_map->generation, vkd3d_memory_order_acquire);
+    if (cache->generation != generation)
+    {
+        memset(cache->entries, 0, sizeof(cache->entries));
+        cache->generation = generation;
+    }
+
+    /* Acceleration structures are 256 byte aligned. */
+    entry = &cache->entries[(va >> 8) % VKD3D_VA_MAP_AS_CACHE_SIZE];
+    if (entry->va == va && entry->vk_acceleration_structure)
+        return entry->vk_acceleration_structure;
+
+    if ((vk_as = vkd3d_va_map_place_acceleration_structure(va_map, device, va)))
+    {
+        entry->va = va;
+        entry->vk_acceleration_structure = vk_as;
+    }
+
+    return vk_as;
+}
+
 #define VKD3D_FAKE_VA_ALIGNMENT (65536)
 
+static int vkd3d_va_range_compare_address(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_va_range *range = RB_ENTRY_VALUE(entry, const struct vkd3d_va_range, address_entry);
+    const VkDeviceAddress *base = key;
+
+    if (*base != range->base)
+        return *base < range->base ? -1 : 1;
+    return 0;
+}
+
+static int vkd3d_va_range_compare_size(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_va_range *range = RB_ENTRY_VALUE(entry, const struct vkd3d_va_range, size_entry);
+    const struct vkd3d_va_range *other = key;
+
+    /* Order by base address within the same size to keep keys unique */
+    if (other->size != range->size)
+        return other->size < range->size ? -1 : 1;
+    if (other->base != range->base)
+        return other->base < range->base ? -1 : 1;
+    return 0;
+}
+
+static struct vkd3d_va_range *vkd3d_va_allocator_find_best_fit(struct vkd3d_va_allocator *allocator, VkDeviceSize size)
+{
+    struct rb_entry *entry = allocator->free_ranges_by_size.root;
+    struct vkd3d_va_range *best = NULL, *range;
+
+    while (entry)
+    {
+        range = RB_ENTRY_VALUE(entry, struct vkd3d_va_range, size_entry);
+
+        if (range->size >= size)
+        {
+            best = range;
+            entry = entry->left;
+        }
+        else
+            entry = entry->right;
+    }
+
+    return best;
+}
+
+static void vkd3d_va_allocator_find_neighbours(struct vkd3d_va_allocator *allocator, VkDeviceAddress va,
+        struct vkd3d_va_range **prev, struct vkd3d_va_range **next)
+{
+    struct rb_entry *entry = allocator->free_ranges_by_address.root;
+    struct vkd3d_va_range *range;
+
+    *prev = NULL;
+    *next = NULL;
+
+    while (entry)
+    {
+        range = RB_ENTRY_VALUE(entry, struct vkd3d_va_range, address_entry);
+
+        if (range->base <= va)
+        {
+            *prev = range;
+            entry = entry->right;
+        }
+        else
+        {
+            *next = range;
+            entry = entry->left;
+        }
+    }
+}
+
 VkDeviceAddress vkd3d_va_map_alloc_fake_va(struct vkd3d_va_map *va_map, VkDeviceSize size)
 {
     struct vkd3d_va_allocator *allocator = &va_map->va_allocator;
-    struct vkd3d_va_range range;
+    struct vkd3d_va_range *range;
     VkDeviceAddress va;
-    size_t i;
     int rc;
 
     if ((rc = pthread_mutex_lock(&allocator->mutex)))
@@ -316,33 +580,28 @@ VkDeviceAddress vkd3d_va_map_alloc_fake_va(struct vkd3d_va_map *va_map, VkDevice
         return 0;
     }
 
-    memset(&range, 0, sizeof(range));
     size = align(size, VKD3D_FAKE_VA_ALIGNMENT);
 
-    /* The free list is ordered in such a way that the largest range
-     * is always first, so we don't have to iterate over the list */
-    if (allocator->free_range_count)
-        range = allocator->free_ranges[0];
-
-    if (range.size >= size)
+    /* Use the smallest free range that fits in order to keep large ranges
+     * intact, and only grow the address space if nothing fits. */
+    if ((range = vkd3d_va_allocator_find_best_fit(allocator, size)))
     {
-        va = range.base;
-
-        range.base += size;
-        range.size -= size;
+        va = range->base;
+        rb_remove(&allocator->free_ranges_by_size, &range->size_entry);
 
-        for (i = 0; i < allocator->free_range_count - 1; i++)
+        if (range->size > size)
         {
-            if (allocator->free_ranges[i + 1].size > range.size)
-                allocator->free_ranges[i] = allocator->free_ranges[i + 1];
-            else
-                break;
+            /* Shrinking the range from the bottom does not change its
+             * position relative to other ranges in the address tree. */
+            range->base += size;
+            range->size -= size;
+            rb_put(&allocator->free_ranges_by_size, range, &range->size_entry);
         }
-
-        if (range.size)
-            allocator->free_ranges[i] = range;
         else
-            allocator->free_range_count--;
+        {
+            rb_remove(&allocator->free_ranges_by_address, &range->address_entry);
+            vkd3d_free(range);
+        }
     }
     else
     {
@@ -357,8 +616,7 @@ VkDeviceAddress vkd3d_va_map_alloc_fake_va(struct vkd3d_va_map *va_map, VkDevice
 void vkd3d_va_map_free_fake_va(struct vkd3d_va_map *va_map, VkDeviceAddress va, VkDeviceSize size)
 {
     struct vkd3d_va_allocator *allocator = &va_map->va_allocator;
-    size_t range_idx, range_shift, i;
-    struct vkd3d_va_range new_range;
+    struct vkd3d_va_range *prev, *next, *range;
     int rc;
 
     if ((rc = pthread_mutex_lock(&allocator->mutex)))
@@ -367,64 +625,78 @@ void vkd3d_va_map_free_fake_va(struct vkd3d_va_map *va_map, VkDeviceAddress va,
         return;
     }
 
-    new_range.base = va;
-    new_range.size = align(size, VKD3D_FAKE_VA_ALIGNMENT);
+    size = align(size, VKD3D_FAKE_VA_ALIGNMENT);
+    vkd3d_va_allocator_find_neighbours(allocator, va, &prev, &next);
 
-    range_idx = allocator->free_range_count;
-    range_shift = 0;
+    if (prev && prev->base + prev->size != va)
+        prev = NULL;
+    if (next && next->base != va + size)
+        next = NULL;
 
-    /* Find and effectively delete any free range adjacent to new_range */
-    for (i = 0; i < allocator->free_range_count; i++)
+    if (prev)
     {
-        const struct vkd3d_va_range *cur_range = &allocator->free_ranges[i];
-
-        if (range_shift)
-            allocator->free_ranges[i - range_shift] = *cur_range;
+        /* Extend the preceding range, absorbing the following one if possible */
+        range = prev;
+        rb_remove(&allocator->free_ranges_by_size, &range->size_entry);
+        range->size += size;
 
-        if (cur_range->base == new_range.base + new_range.size || cur_range->base + cur_range->size == new_range.base)
+        if (next)
         {
-            if (range_idx == allocator->free_range_count)
-                range_idx = i;
-            else
-                range_shift++;
-
-            new_range.base = min(new_range.base, cur_range->base);
-            new_range.size += cur_range->size;
+            rb_remove(&allocator->free_ranges_by_size, &next->size_entry);
+            rb_remove(&allocator->free_ranges_by_address, &next->address_entry);
+            range->size += next->size;
+            vkd3d_free(next);
         }
     }
-
-    if (range_idx == allocator->free_range_count)
+    else if (next)
     {
-        /* range_idx will be valid and point to the last element afterwards */
-        if (!(vkd3d_array_reserve((void **)&allocator->free_ranges, &allocator->free_ranges_size,
-                allocator->free_range_count + 1, sizeof(*allocator->free_ranges))))
+        /* Growing the range downwards keeps its position in the address tree */
+        range = next;
+        rb_remove(&allocator->free_ranges_by_size, &range->size_entry);
+        range->base = va;
+        range->size += size;
+    }
+    else
+    {
+        if (!(range = vkd3d_malloc(sizeof(*range))))
         {
             ERR("Failed to add free range.\n");
             pthread_mutex_unlock(&allocator->mutex);
             return;
         }
 
-        allocator->free_range_count += 1;
+        range->base = va;
+        range->size = size;
+        rb_put(&allocator->free_ranges_by_address, &range->base, &range->address_entry);
     }
-    else
-        allocator->free_range_count -= range_shift;
 
-    /* Move ranges smaller than our new free range back to keep the list ordered */
-    while (range_idx && allocator->free_ranges[range_idx - 1].size < new_range.size)
+    /* Return the range to the top of the address space if it ends there */
+    if (range->base + range->size == allocator->next_va)
     {
-        allocator->free_ranges[range_idx] = allocator->free_ranges[range_idx - 1];
-        range_idx--;
+        allocator->next_va = range->base;
+        rb_remove(&allocator->free_ranges_by_address, &range->address_entry);
+        vkd3d_free(range);
     }
+    else
+        rb_put(&allocator->free_ranges_by_size, range, &range->size_entry);
 
-    allocator->free_ranges[range_idx] = new_range;
     pthread_mutex_unlock(&allocator->mutex);
 }
 
+static void vkd3d_va_range_free(struct rb_entry *entry, void *context)
+{
+    vkd3d_free(RB_ENTRY_VALUE(entry, struct vkd3d_va_range, address_entry));
+}
+
 void vkd3d_va_map_init(struct vkd3d_va_map *va_map)
 {
     memset(va_map, 0, sizeof(*va_map));
     pthread_mutex_init(&va_map->mutex, NULL);
+    pthread_mutex_init(&va_map->node_pool.mutex, NULL);
+    va_map->node_pool.enabled = !!(vkd3d_config_flags & VKD3D_CONFIG_FLAG_HUGE_PAGES);
     pthread_mutex_init(&va_map->va_allocator.mutex, NULL);
+    rb_init(&va_map->va_allocator.free_ranges_by_address, vkd3d_va_range_compare_address);
+    rb_init(&va_map->va_allocator.free_ranges_by_size, vkd3d_va_range_compare_size);
 
     /* Make sure we never return 0 as a valid VA */
     va_map->va_allocator.next_va = VKD3D_VA_BLOCK_SIZE;
@@ -432,11 +704,23 @@ void vkd3d_va_map_init(struct vkd3d_va_map *va_map)
 
 void vkd3d_va_map_cleanup(struct vkd3d_va_map *va_map)
 {
-    vkd3d_va_map_cleanup_tree(&va_map->va_tree);
+    struct vkd3d_va_node_pool *pool = &va_map->node_pool;
+    size_t i;
+
+    if (pool->enabled)
+    {
+        for (i = 0; i < pool->chunks_count; i++)
+            vkd3d_free_huge(pool->chunks[i].ptr, pool->chunks[i].huge_pages);
+        vkd3d_free(pool->chunks);
+    }
+    else
+        vkd3d_va_map_cleanup_tree(&va_map->va_tree);
+
+    pthread_mutex_destroy(&pool->mutex);
 
     pthread_mutex_destroy(&va_map->va_allocator.mutex);
     pthread_mutex_destroy(&va_map->mutex);
-    vkd3d_free(va_map->va_allocator.free_ranges);
-    vkd3d_free(va_map->small_entries);
+    rb_destroy(&va_map->va_allocator.free_ranges_by_address, vkd3d_va_range_free, NULL);
+    vkd3d_free(va_map->small_table);
 }
 
@@ -34,6 +34,7 @@
 #include "vkd3d_version.h"
 #include "vkd3d_shader.h"
 #include "vkd3d_threads.h"
+#include "vkd3d_sharded_rwlock.h"
 #include "vkd3d_platform.h"
 #include "vkd3d_swapchain_factory.h"
 #include "vkd3d_command_list_vkd3d_ext.h"
@@ -43,6 +44,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 #define VK_CALL(f) (vk_procs->f)
 
@@ -128,6 +130,10 @@ struct vkd3d_vulkan_info
     bool KHR_shader_atomic_int64;
     bool KHR_bind_memory2;
     bool KHR_copy_commands2;
+    bool KHR_synchronization2;
+    bool KHR_dynamic_rendering;
+    bool KHR_present_id;
+    bool KHR_present_wait;
     /* EXT device extensions */
     bool EXT_calibrated_timestamps;
     bool EXT_conditional_rendering;
@@ -147,7 +153,13 @@ struct vkd3d_vulkan_info
     bool EXT_transform_feedback;
     bool EXT_vertex_attribute_divisor;
     bool EXT_extended_dynamic_state;
+    bool EXT_extended_dynamic_state2;
+    bool EXT_vertex_input_dynamic_state;
+    bool EXT_memory_budget;
+    bool EXT_memory_priority;
+    bool EXT_pageable_device_local_memory;
     bool EXT_external_memory_host;
+    bool EXT_host_query_reset;
     bool EXT_4444_formats;
     bool EXT_shader_image_atomic_int64;
     bool EXT_scalar_block_layout;
@@ -162,6 +174,7 @@ struct vkd3d_vulkan_info
     bool NVX_image_view_handle;
     bool NV_fragment_shader_barycentric;
     bool NV_compute_shader_derivatives;
+    bool NV_device_generated_commands;
     /* VALVE extensions */
     bool VALVE_mutable_descriptor_type;
 
@@ -218,17 +231,44 @@ struct vkd3d_waiting_fence
     uint64_t value;
 };
 
+/* A single device-wide worker waits for all pending fences at once with a wait-any,
+ * so a fence which completes early does not sit behind a slow one. */
 struct vkd3d_fence_worker
 {
     union vkd3d_thread_handle thread;
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     bool should_exit;
+    bool is_waiting_on_gpu;
 
     uint32_t enqueued_fence_count;
     struct vkd3d_waiting_fence *enqueued_fences;
     size_t enqueued_fences_size;
 
+    /* Host-signalled timeline semaphore, part of every wait-any,
+     * used to interrupt the wait when new fences are enqueued. */
+    VkSemaphore wake_semaphore;
+    uint64_t wake_value;
+
+    VkSemaphore *wait_semaphores;
+    size_t wait_semaphores_size;
+    uint64_t *wait_values;
+    size_t wait_values_size;
+
+    /* Vulkan objects released by the application. They are destroyed on the worker
+     * thread once every queue has completed the work submitted before the release. */
+    uint32_t is_running;
+    struct vkd3d_deferred_destroy *enqueued_destroys;
+    size_t enqueued_destroys_size;
+    size_t enqueued_destroy_count;
+
+    struct vkd3d_deferred_destroy_batch *destroy_batches;
+    size_t destroy_batches_size;
+    size_t destroy_batch_count;
+
+    struct vkd3d_queue **queues;
+    uint32_t queue_count;
+
     struct d3d12_device *device;
 };
 
@@ -237,6 +277,95 @@ HRESULT vkd3d_fence_worker_start(struct vkd3d_fence_worker *worker,
 HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
         struct d3d12_device *device);
 
+struct vkd3d_sparse_bind_state
+{
+    VkSparseBufferMemoryBindInfo *buffer_infos;
+    VkSparseImageOpaqueMemoryBindInfo *opaque_infos;
+    VkSparseImageMemoryBindInfo *image_infos;
+    VkSparseMemoryBind *memory_binds;
+    VkSparseImageMemoryBind *image_binds;
+    uint32_t buffer_info_count;
+    uint32_t opaque_info_count;
+    uint32_t image_info_count;
+    uint32_t memory_bind_count;
+    uint32_t image_bind_count;
+};
+
+void vkd3d_sparse_bind_state_cleanup(struct vkd3d_sparse_bind_state *state);
+
+struct vkd3d_sparse_bind_job
+{
+    struct vkd3d_sparse_bind_state state;
+    /* Timeline of the command queue which recorded the bind.
+     * The bind waits for wait_value and signals wait_value + 1. */
+    VkSemaphore vk_semaphore;
+    uint64_t wait_value;
+};
+
+/* Performs sparse binds on a dedicated sparse queue, so that
+ * slow binds do not hold up the graphics submission threads. */
+struct vkd3d_sparse_worker
+{
+    union vkd3d_thread_handle thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool should_exit;
+
+    struct vkd3d_sparse_bind_job *jobs;
+    size_t jobs_size;
+    size_t job_count;
+
+    /* NULL if the device does not expose a dedicated sparse queue family. */
+    struct vkd3d_queue *vkd3d_queue;
+    struct d3d12_device *device;
+};
+
+HRESULT vkd3d_sparse_worker_start(struct vkd3d_sparse_worker *worker,
+        struct d3d12_device *device);
+HRESULT vkd3d_sparse_worker_stop(struct vkd3d_sparse_worker *worker,
+        struct d3d12_device *device);
+void vkd3d_sparse_worker_enqueue(struct vkd3d_sparse_worker *worker,
+        const struct vkd3d_sparse_bind_job *job);
+
+static inline bool vkd3d_sparse_worker_is_active(const struct vkd3d_sparse_worker *worker)
+{
+    return worker->vkd3d_queue != NULL;
+}
+
+#define VKD3D_COMMAND_LIST_TRANSLATOR_THREAD_COUNT 4
+
+/* Translates command lists recorded in deferred mode to Vulkan commands
+ * on a small pool of worker threads once the application closes them. */
+struct vkd3d_command_list_translator
+{
+    union vkd3d_thread_handle threads[VKD3D_COMMAND_LIST_TRANSLATOR_THREAD_COUNT];
+    uint32_t thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t done_cond;
+    bool should_exit;
+
+    struct d3d12_command_list **lists;
+    size_t lists_size;
+    size_t list_count;
+
+    struct d3d12_device *device;
+};
+
+HRESULT vkd3d_command_list_translator_start(struct vkd3d_command_list_translator *translator,
+        struct d3d12_device *device);
+HRESULT vkd3d_command_list_translator_stop(struct vkd3d_command_list_translator *translator,
+        struct d3d12_device *device);
+bool vkd3d_command_list_translator_enqueue(struct vkd3d_command_list_translator *translator,
+        struct d3d12_command_list *list);
+void vkd3d_command_list_translator_wait(struct vkd3d_command_list_translator *translator,
+        uint32_t *pending_count);
+
+static inline bool vkd3d_command_list_translator_is_active(const struct vkd3d_command_list_translator *translator)
+{
+    return translator->thread_count != 0;
+}
+
 /* 2 MiB is a good threshold, because it's huge page size. */
 #define VKD3D_VA_BLOCK_SIZE_BITS (21)
 #define VKD3D_VA_BLOCK_SIZE (1ull << VKD3D_VA_BLOCK_SIZE_BITS)
@@ -246,6 +375,13 @@ HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
 #define VKD3D_VA_BLOCK_COUNT (1ull << VKD3D_VA_BLOCK_BITS)
 #define VKD3D_VA_BLOCK_MASK (VKD3D_VA_BLOCK_COUNT - 1)
 
+/* Blocks are allocated in pages on first use, so that mostly unused
+ * trees do not cost 32 MiB of memory each. */
+#define VKD3D_VA_BLOCK_PAGE_BITS (10)
+#define VKD3D_VA_BLOCK_PAGE_SIZE (1ull << VKD3D_VA_BLOCK_PAGE_BITS)
+#define VKD3D_VA_BLOCK_PAGE_MASK (VKD3D_VA_BLOCK_PAGE_SIZE - 1)
+#define VKD3D_VA_BLOCK_PAGE_COUNT (1ull << (VKD3D_VA_BLOCK_BITS - VKD3D_VA_BLOCK_PAGE_BITS))
+
 #define VKD3D_VA_NEXT_BITS (12)
 #define VKD3D_VA_NEXT_COUNT (1ull << VKD3D_VA_NEXT_BITS)
 #define VKD3D_VA_NEXT_MASK (VKD3D_VA_NEXT_COUNT - 1)
@@ -264,14 +400,23 @@ struct vkd3d_va_block
     struct vkd3d_va_entry r;
 };
 
+struct vkd3d_va_block_page
+{
+    struct vkd3d_va_block blocks[VKD3D_VA_BLOCK_PAGE_SIZE];
+};
+
 struct vkd3d_va_tree
 {
-    struct vkd3d_va_block blocks[VKD3D_VA_BLOCK_COUNT];
+    struct vkd3d_va_block_page *pages[VKD3D_VA_BLOCK_PAGE_COUNT];
     struct vkd3d_va_tree *next[VKD3D_VA_NEXT_COUNT];
 };
 
+/* Free ranges are indexed both by address, to find neighbours to
+ * merge with, and by size, for best-fit allocation. */
 struct vkd3d_va_range
 {
+    struct rb_entry address_entry;
+    struct rb_entry size_entry;
     VkDeviceAddress base;
     VkDeviceSize size;
 };
@@ -280,23 +425,82 @@ struct vkd3d_va_allocator
 {
     pthread_mutex_t mutex;
 
-    struct vkd3d_va_range *free_ranges;
-    size_t free_ranges_size;
-    size_t free_range_count;
+    struct rb_tree free_ranges_by_address;
+    struct rb_tree free_ranges_by_size;
 
     VkDeviceAddress next_va;
 };
 
+/* Immutable, sorted snapshot of all resources smaller than a VA block.
+ * Writers replace the whole table, so readers never need to lock. */
+struct vkd3d_va_small_table
+{
+    size_t count;
+    struct vkd3d_unique_resource *entries[];
+};
+
+#define VKD3D_VA_MAP_READER_SHARD_COUNT (16u)
+
+/* Readers register themselves in one of two counters depending on the
+ * current epoch, so that writers can wait for all readers which may
+ * still observe a retired table. Padded to avoid false sharing. */
+struct vkd3d_va_map_reader_shard
+{
+    uint32_t counts[2];
+    uint32_t padding[14];
+};
+
+struct vkd3d_va_node_chunk
+{
+    void *ptr;
+    bool huge_pages;
+};
+
+/* With huge pages enabled, tree nodes are sub-allocated from large chunks,
+ * so that lookups across the tree touch fewer TLB entries. Nodes are never
+ * freed individually. */
+struct vkd3d_va_node_pool
+{
+    pthread_mutex_t mutex;
+    bool enabled;
+
+    struct vkd3d_va_node_chunk *chunks;
+    size_t chunks_size;
+    size_t chunks_count;
+    size_t offset;
+};
+
 struct vkd3d_va_map
 {
     struct vkd3d_va_tree va_tree;
+    struct vkd3d_va_node_pool node_pool;
     struct vkd3d_va_allocator va_allocator;
 
+    /* Serializes writers of small_table */
     pthread_mutex_t mutex;
 
-    struct vkd3d_unique_resource **small_entries;
-    size_t small_entries_size;
-    size_t small_entries_count;
+    struct vkd3d_va_small_table *small_table;
+    uint32_t reader_epoch;
+    struct vkd3d_va_map_reader_shard reader_shards[VKD3D_VA_MAP_READER_SHARD_COUNT];
+
+    /* Bumped whenever a resource is removed, which invalidates all acceleration structure caches. */
+    uint32_t generation;
+};
+
+#define VKD3D_VA_MAP_AS_CACHE_SIZE (64u)
+
+/* Direct-mapped cache of recently placed acceleration structures.
+ * Owned by a single thread, so it needs no synchronization of its own. */
+struct vkd3d_va_map_as_cache_entry
+{
+    VkDeviceAddress va;
+    VkAccelerationStructureKHR vk_acceleration_structure;
+};
+
+struct vkd3d_va_map_as_cache
+{
+    uint32_t generation;
+    struct vkd3d_va_map_as_cache_entry entries[VKD3D_VA_MAP_AS_CACHE_SIZE];
 };
 
 void vkd3d_va_map_insert(struct vkd3d_va_map *va_map, struct vkd3d_unique_resource *resource);
@@ -305,6 +509,9 @@ const struct vkd3d_unique_resource *vkd3d_va_map_deref(struct vkd3d_va_map *va_m
 VkAccelerationStructureKHR vkd3d_va_map_place_acceleration_structure(struct vkd3d_va_map *va_map,
         struct d3d12_device *device,
         VkDeviceAddress va);
+VkAccelerationStructureKHR vkd3d_va_map_place_acceleration_structure_cached(struct vkd3d_va_map *va_map,
+        struct d3d12_device *device, struct vkd3d_va_map_as_cache *cache,
+        VkDeviceAddress va);
 VkDeviceAddress vkd3d_va_map_alloc_fake_va(struct vkd3d_va_map *va_map, VkDeviceSize size);
 void vkd3d_va_map_free_fake_va(struct vkd3d_va_map *va_map, VkDeviceAddress va, VkDeviceSize size);
 void vkd3d_va_map_init(struct vkd3d_va_map *va_map);
@@ -346,11 +553,14 @@ struct vkd3d_render_pass_key
 
 struct vkd3d_render_pass_entry;
 
+#define VKD3D_RENDER_PASS_CACHE_BUCKET_COUNT 256
+
+/* Entries are only ever added and are immutable once published, so lookups
+ * walk the bucket chains without locking. The lock only serializes inserts. */
 struct vkd3d_render_pass_cache
 {
-    struct vkd3d_render_pass_entry *render_passes;
+    struct vkd3d_render_pass_entry *buckets[VKD3D_RENDER_PASS_CACHE_BUCKET_COUNT];
     size_t render_pass_count;
-    size_t render_passes_size;
     spinlock_t lock;
 };
 
@@ -560,6 +770,8 @@ struct d3d12_fence
     VkSemaphore timeline_semaphore;
 
     uint64_t max_pending_virtual_timeline_value;
+    /* Only modified with the fence lock held, but published with release
+     * stores so that it can be polled without the lock. */
     uint64_t virtual_value;
     uint64_t physical_value;
     uint64_t counter;
@@ -568,15 +780,19 @@ struct d3d12_fence
     size_t pending_updates_size;
 
     pthread_mutex_t mutex;
-    pthread_cond_t cond;
-    pthread_cond_t null_event_cond;
+
+    /* Futex word which is bumped whenever max_pending_virtual_timeline_value changes.
+     * Both fields are only modified with the fence lock held. */
+    uint32_t pending_value_seq;
+    uint32_t pending_value_waiter_count;
 
     struct vkd3d_waiting_event
     {
         uint64_t value;
         HANDLE event;
         enum vkd3d_waiting_event_type type;
-        bool *latch;
+        /* Futex word for NULL events, waited on without holding the fence lock. */
+        uint32_t *latch;
     } *events;
     size_t events_size;
     size_t event_count;
@@ -604,6 +820,13 @@ HRESULT d3d12_fence_create(struct d3d12_device *device,
         uint64_t initial_value, D3D12_FENCE_FLAGS flags, struct d3d12_fence **fence);
 HRESULT d3d12_fence_set_event_on_completion(struct d3d12_fence *fence,
         UINT64 value, HANDLE event, enum vkd3d_waiting_event_type type);
+HRESULT d3d12_fence_signal_cpu_timeline_semaphore(struct d3d12_fence *fence, uint64_t value);
+VkResult d3d12_fence_submit_signal_locked(struct d3d12_fence *fence, uint64_t value,
+        struct vkd3d_queue *queue, VkQueue vk_queue, const VkSubmitInfo *submit, VkFence vk_fence,
+        uint64_t *physical_value);
+void d3d12_fence_enqueue_gpu_signal(struct d3d12_fence *fence, uint64_t physical_value, struct vkd3d_queue *queue);
+void d3d12_fence_inc_ref(struct d3d12_fence *fence);
+void d3d12_fence_dec_ref(struct d3d12_fence *fence);
 
 enum vkd3d_allocation_flag
 {
@@ -615,9 +838,14 @@ enum vkd3d_allocation_flag
     VKD3D_ALLOCATION_FLAG_DEDICATED         = (1u << 5),
 };
 
+/* Chunks start out at VKD3D_MEMORY_CHUNK_SIZE and grow or shrink
+ * per memory type, within the heap-dependent [MIN, MAX] range. */
 #define VKD3D_MEMORY_CHUNK_SIZE (VKD3D_VA_BLOCK_SIZE * 8)
+#define VKD3D_MEMORY_CHUNK_MIN_SIZE (VKD3D_VA_BLOCK_SIZE * 2)
+#define VKD3D_MEMORY_CHUNK_MAX_SIZE (VKD3D_VA_BLOCK_SIZE * 128)
 
 struct vkd3d_memory_chunk;
+struct vkd3d_memory_slab;
 
 struct vkd3d_allocate_memory_info
 {
@@ -668,8 +896,49 @@ struct vkd3d_device_memory_allocation
     VkDeviceMemory vk_memory;
     uint32_t vk_memory_type;
     VkDeviceSize size;
+    bool is_fallback;
+};
+
+enum vkd3d_deferred_destroy_type
+{
+    VKD3D_DEFERRED_DESTROY_IMAGE,
+    VKD3D_DEFERRED_DESTROY_BUFFER,
+    VKD3D_DEFERRED_DESTROY_IMAGE_VIEW,
+    VKD3D_DEFERRED_DESTROY_DESCRIPTOR_POOL,
+    VKD3D_DEFERRED_DESTROY_DEVICE_MEMORY,
+    VKD3D_DEFERRED_DESTROY_RECYCLED_RESOURCE,
+};
+
+struct vkd3d_recycled_resource;
+
+struct vkd3d_deferred_destroy
+{
+    enum vkd3d_deferred_destroy_type type;
+    union
+    {
+        VkImage vk_image;
+        VkBuffer vk_buffer;
+        VkImageView vk_image_view;
+        VkDescriptorPool vk_descriptor_pool;
+        struct vkd3d_device_memory_allocation device_allocation;
+        struct vkd3d_recycled_resource *recycled_resource;
+    };
 };
 
+struct vkd3d_deferred_destroy_batch
+{
+    struct vkd3d_deferred_destroy *entries;
+    size_t entry_count;
+    /* Submission timeline value of each device queue at the time the batch was closed. */
+    uint64_t *queue_values;
+};
+
+void vkd3d_deferred_destroy(struct d3d12_device *device, const struct vkd3d_deferred_destroy *entry);
+void vkd3d_deferred_destroy_image(struct d3d12_device *device, VkImage vk_image);
+void vkd3d_deferred_destroy_buffer(struct d3d12_device *device, VkBuffer vk_buffer);
+void vkd3d_deferred_destroy_image_view(struct d3d12_device *device, VkImageView vk_image_view);
+void vkd3d_deferred_destroy_descriptor_pool(struct d3d12_device *device, VkDescriptorPool vk_descriptor_pool);
+
 struct vkd3d_memory_allocation
 {
     struct vkd3d_unique_resource resource;
@@ -684,6 +953,9 @@ struct vkd3d_memory_allocation
     uint64_t clear_semaphore_value;
 
     struct vkd3d_memory_chunk *chunk;
+    uint32_t chunk_block;
+
+    struct vkd3d_memory_slab *slab;
 };
 
 static inline void vkd3d_memory_allocation_slice(struct vkd3d_memory_allocation *dst,
@@ -698,18 +970,80 @@ static inline void vkd3d_memory_allocation_slice(struct vkd3d_memory_allocation
         dst->cpu_address = void_ptr_offset(dst->cpu_address, offset);
 }
 
-struct vkd3d_memory_free_range
+/* Chunks are managed with a two-level segregated fit allocator. The first
+ * level splits block sizes by power of two, the second level subdivides
+ * each of those linearly. Sizes below the minimum share the first list. */
+#define VKD3D_MEMORY_TLSF_SL_BITS (4u)
+#define VKD3D_MEMORY_TLSF_SL_COUNT (1u << VKD3D_MEMORY_TLSF_SL_BITS)
+#define VKD3D_MEMORY_TLSF_MIN_SIZE_BITS (8u)
+#define VKD3D_MEMORY_TLSF_FL_COUNT (24u)
+#define VKD3D_MEMORY_BLOCK_NONE (~0u)
+
+struct vkd3d_memory_block
 {
     VkDeviceSize offset;
     VkDeviceSize length;
+    uint32_t prev_phys;
+    uint32_t next_phys;
+    uint32_t prev_free;
+    uint32_t next_free;
+    bool is_free;
 };
 
 struct vkd3d_memory_chunk
 {
     struct vkd3d_memory_allocation allocation;
-    struct vkd3d_memory_free_range *free_ranges;
-    size_t free_ranges_size;
-    size_t free_ranges_count;
+    size_t list_index;
+
+    struct vkd3d_memory_block *blocks;
+    size_t blocks_size;
+    size_t blocks_count;
+    uint32_t unused_blocks;
+    size_t allocation_count;
+
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmaps[VKD3D_MEMORY_TLSF_FL_COUNT];
+    uint32_t free_lists[VKD3D_MEMORY_TLSF_FL_COUNT][VKD3D_MEMORY_TLSF_SL_COUNT];
+};
+
+struct vkd3d_memory_chunk_list
+{
+    pthread_mutex_t mutex;
+    struct vkd3d_memory_chunk **chunks;
+    size_t chunks_size;
+    size_t chunks_count;
+    /* Doubles whenever a chunk is added, halves whenever one drains */
+    VkDeviceSize next_chunk_size;
+};
+
+/* Small allocations are served from fixed-size slots of slabs,
+ * which are themselves suballocated from regular chunks. */
+#define VKD3D_MEMORY_SLAB_SIZE (64ull << 10) /* 64 KiB */
+#define VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS (8u)
+#define VKD3D_MEMORY_SLAB_CLASS_COUNT (5u) /* 256 B to 4 KiB */
+#define VKD3D_MEMORY_SLAB_MAX_SLOT_SIZE (1ull << (VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS + VKD3D_MEMORY_SLAB_CLASS_COUNT - 1))
+#define VKD3D_MEMORY_SLAB_MAX_SLOT_COUNT (VKD3D_MEMORY_SLAB_SIZE >> VKD3D_MEMORY_SLAB_MIN_SLOT_SIZE_BITS)
+
+struct vkd3d_memory_slab
+{
+    struct vkd3d_memory_allocation allocation;
+    struct list entry;
+    size_t list_index;
+    uint32_t slot_size_bits;
+    uint32_t slot_count;
+    uint32_t free_count;
+    uint64_t free_mask[VKD3D_MEMORY_SLAB_MAX_SLOT_COUNT / 64];
+};
+
+struct vkd3d_memory_slab_list
+{
+    pthread_mutex_t mutex;
+    /* Every slab of the class, including full ones */
+    struct list all_slabs;
+    /* Only holds slabs which have free slots */
+    struct vkd3d_memory_slab **slabs;
+    size_t slabs_size;
+    size_t slabs_count;
 };
 
 #define VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT (16u)
@@ -718,6 +1052,12 @@ struct vkd3d_memory_clear_queue
 {
     pthread_mutex_t mutex;
 
+    /* Submits pending clears once the oldest one reaches its deadline */
+    condvar_reltime_t cond;
+    union vkd3d_thread_handle thread;
+    bool thread_running;
+    bool stopping;
+
     VkCommandBuffer vk_command_buffers[VKD3D_MEMORY_CLEAR_COMMAND_BUFFER_COUNT];
     VkCommandPool vk_command_pool;
     VkSemaphore vk_semaphore;
@@ -726,6 +1066,7 @@ struct vkd3d_memory_clear_queue
     UINT64 next_signal_value;
 
     VkDeviceSize num_bytes_pending;
+    uint64_t first_pending_time_ns;
     uint32_t command_buffer_index;
 
     struct vkd3d_memory_allocation **allocations;
@@ -735,11 +1076,16 @@ struct vkd3d_memory_clear_queue
 
 struct vkd3d_memory_allocator
 {
-    pthread_mutex_t mutex;
+    /* Identifies the allocator in per-thread allocation caches */
+    LONG64 cookie;
+    /* Lets thread caches return ranges to the allocator that owns them */
+    struct list entry;
+    struct d3d12_device *device;
 
-    struct vkd3d_memory_chunk **chunks;
-    size_t chunks_size;
-    size_t chunks_count;
+    /* Indexed by Vulkan memory type, each with its own lock */
+    struct vkd3d_memory_chunk_list chunk_lists[VK_MAX_MEMORY_TYPES];
+    /* Indexed by slot size class */
+    struct vkd3d_memory_slab_list slab_lists[VKD3D_MEMORY_SLAB_CLASS_COUNT];
 
     struct vkd3d_va_map va_map;
 
@@ -757,6 +1103,16 @@ HRESULT vkd3d_allocate_heap_memory(struct d3d12_device *device, struct vkd3d_mem
 HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device);
 void vkd3d_memory_allocator_cleanup(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device);
 HRESULT vkd3d_memory_allocator_flush_clears(struct vkd3d_memory_allocator *allocator, struct d3d12_device *device);
+bool vkd3d_memory_allocator_cancel_clear(struct vkd3d_memory_allocator *allocator,
+        const struct vkd3d_memory_allocation *allocation);
+void vkd3d_memory_allocation_move(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
+        struct vkd3d_memory_allocation *dst, struct vkd3d_memory_allocation *src);
+HRESULT vkd3d_memory_allocation_init_recycled(struct d3d12_device *device, struct vkd3d_memory_allocator *allocator,
+        struct vkd3d_memory_allocation *allocation);
+void vkd3d_memory_allocator_get_stats(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, D3D12_VK_MEMORY_ALLOCATOR_STATS *stats);
+HRESULT vkd3d_get_write_watch(UINT32 flags, void *base_address, SIZE_T region_size,
+        void **addresses, UINT64 *address_count, UINT32 *granularity);
 
 /* ID3D12Heap */
 typedef ID3D12Heap1 d3d12_heap_iface;
@@ -765,6 +1121,8 @@ struct d3d12_heap
 {
     d3d12_heap_iface ID3D12Heap_iface;
     LONG refcount;
+    /* Protected by the device residency tracker */
+    int32_t residency_count;
 
     D3D12_HEAP_DESC desc;
     struct vkd3d_memory_allocation allocation;
@@ -802,6 +1160,7 @@ enum vkd3d_resource_flag
     VKD3D_RESOURCE_EXTERNAL               = (1u << 5),
     VKD3D_RESOURCE_ACCELERATION_STRUCTURE = (1u << 6),
     VKD3D_RESOURCE_SIMULTANEOUS_ACCESS    = (1u << 7),
+    VKD3D_RESOURCE_COHERENT_MAP           = (1u << 8),
 };
 
 struct d3d12_sparse_image_region
@@ -818,38 +1177,79 @@ struct d3d12_sparse_buffer_region
     VkDeviceSize length;
 };
 
-struct d3d12_sparse_tile
+/* A run of consecutive tiles mapped to the same memory object. Each tile after the first
+ * is bound at vk_offset + vk_stride * n, where the stride is either VKD3D_TILE_SIZE, or 0
+ * for runs that map every tile to a single heap tile. Unmapped tiles have no run. */
+struct d3d12_sparse_tile_run
 {
-    union
-    {
-        struct d3d12_sparse_image_region image;
-        struct d3d12_sparse_buffer_region buffer;
-    };
+    uint32_t tile_index;
+    uint32_t tile_count;
     VkDeviceMemory vk_memory;
     VkDeviceSize vk_offset;
+    VkDeviceSize vk_stride;
 };
 
 struct d3d12_sparse_info
 {
     uint32_t tile_count;
     uint32_t tiling_count;
-    struct d3d12_sparse_tile *tiles;
     D3D12_TILE_SHAPE tile_shape;
     D3D12_PACKED_MIP_INFO packed_mips;
     D3D12_SUBRESOURCE_TILING *tilings;
     struct vkd3d_device_memory_allocation vk_metadata_memory;
+
+    /* Sorted by tile index, never overlapping. */
+    struct d3d12_sparse_tile_run *runs;
+    size_t runs_size;
+    size_t run_count;
+
+    /* Needed to compute tile regions on demand. */
+    VkExtent3D block_extent;
+    VkImageAspectFlags aspect_mask;
+    VkDeviceSize mip_tail_offset;
+    VkDeviceSize mip_tail_size;
 };
 
-struct vkd3d_view_map
+void d3d12_sparse_info_get_image_region(const struct d3d12_resource *resource,
+        uint32_t tile_index, struct d3d12_sparse_image_region *region);
+void d3d12_sparse_info_get_buffer_region(const struct d3d12_resource *resource,
+        uint32_t tile_index, struct d3d12_sparse_buffer_region *region);
+size_t d3d12_sparse_info_find_run(const struct d3d12_sparse_info *sparse, uint32_t tile_index);
+bool d3d12_sparse_info_map_tiles(struct d3d12_sparse_info *sparse, uint32_t tile_index, uint32_t tile_count,
+        VkDeviceMemory vk_memory, VkDeviceSize vk_offset, VkDeviceSize vk_stride);
+
+struct vkd3d_view_map_shard
 {
     spinlock_t spinlock;
     struct hash_map map;
+};
+
+/* Keeps separately allocated shards on their own cache lines */
+union vkd3d_view_map_shard_slot
+{
+    struct vkd3d_view_map_shard shard;
+    char padding[64];
+};
+STATIC_ASSERT(sizeof(struct vkd3d_view_map_shard) <= 64);
+
+/* Per-resource maps use the embedded shard. Device-wide maps which see
+ * concurrent descriptor creation from many threads can be split into
+ * multiple shards selected by key hash, so that readers do not all
+ * bounce the same lock cache line. */
+#define VKD3D_SAMPLER_MAP_SHARD_COUNT 16u
+
+struct vkd3d_view_map
+{
+    union vkd3d_view_map_shard_slot *shards;
+    uint32_t shard_mask;
+    struct vkd3d_view_map_shard shard;
 #ifdef VKD3D_ENABLE_DESCRIPTOR_QA
     uint64_t resource_cookie;
 #endif
 };
 
 HRESULT vkd3d_view_map_init(struct vkd3d_view_map *view_map);
+HRESULT vkd3d_view_map_init_sharded(struct vkd3d_view_map *view_map, uint32_t shard_count);
 void vkd3d_view_map_destroy(struct vkd3d_view_map *view_map, struct d3d12_device *device);
 
 /* ID3D12Resource */
@@ -860,6 +1260,8 @@ struct d3d12_resource
     d3d12_resource_iface ID3D12Resource_iface;
     LONG refcount;
     LONG internal_refcount;
+    /* Only meaningful for committed resources, protected by the device residency tracker */
+    int32_t residency_count;
 
     D3D12_RESOURCE_DESC1 desc;
     D3D12_HEAP_PROPERTIES heap_properties;
@@ -878,6 +1280,9 @@ struct d3d12_resource
 
     struct d3d12_sparse_info sparse;
     struct vkd3d_view_map view_map;
+    /* Whole-buffer R32_UINT view owned by view_map. Structured and raw buffer
+     * views quantize to this in the common case, so it bypasses the map. */
+    struct vkd3d_view *raw_buffer_view;
 
     struct d3d12_device *device;
 
@@ -952,9 +1357,14 @@ HRESULT vkd3d_allocate_device_memory(struct d3d12_device *device,
         void *pNext, struct vkd3d_device_memory_allocation *allocation);
 void vkd3d_free_device_memory(struct d3d12_device *device,
         const struct vkd3d_device_memory_allocation *allocation);
+void vkd3d_free_device_memory_immediate(struct d3d12_device *device,
+        const struct vkd3d_device_memory_allocation *allocation);
 HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
         VkMemoryPropertyFlags type_flags,
         struct vkd3d_device_memory_allocation *allocation);
+HRESULT vkd3d_allocate_buffer_memory_masked(struct d3d12_device *device, VkBuffer vk_buffer,
+        VkMemoryPropertyFlags type_flags, uint32_t type_mask,
+        struct vkd3d_device_memory_allocation *allocation);
 HRESULT vkd3d_allocate_image_memory(struct d3d12_device *device, VkImage vk_image,
         VkMemoryPropertyFlags type_flags,
         struct vkd3d_device_memory_allocation *allocation);
@@ -964,6 +1374,70 @@ HRESULT vkd3d_create_buffer(struct d3d12_device *device,
 HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC1 *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info);
 
+/* Memory requirements of images created through GetResourceAllocationInfo(),
+ * so that we only have to create a throwaway image once per description. */
+struct vkd3d_memory_requirements_cache
+{
+    spinlock_t spinlock;
+    struct hash_map map;
+};
+
+void vkd3d_memory_requirements_cache_init(struct vkd3d_memory_requirements_cache *cache);
+void vkd3d_memory_requirements_cache_cleanup(struct vkd3d_memory_requirements_cache *cache);
+
+/* DXGI format values are dense and stay below this. */
+#define VKD3D_FORMAT_SUPPORT_CACHE_SIZE 256
+
+enum vkd3d_format_support_cache_flag
+{
+    VKD3D_FORMAT_SUPPORT_CACHE_FORMAT_SUPPORT = (1u << 0),
+    VKD3D_FORMAT_SUPPORT_CACHE_SAMPLE_COUNTS  = (1u << 1),
+};
+
+struct vkd3d_format_support_cache_entry
+{
+    uint32_t flags;
+    D3D12_FORMAT_SUPPORT1 support1;
+    D3D12_FORMAT_SUPPORT2 support2;
+    VkSampleCountFlags sample_counts;
+};
+
+/* Lazily filled results of format queries, so that repeated CheckFeatureSupport
+ * calls do not go through the Vulkan driver again. */
+struct vkd3d_format_support_cache
+{
+    spinlock_t spinlock;
+    struct vkd3d_format_support_cache_entry entries[VKD3D_FORMAT_SUPPORT_CACHE_SIZE];
+};
+
+/* Committed resource which was destroyed by the application, and whose image or
+ * buffer and memory are kept around for a resource with the same description. */
+struct vkd3d_recycled_resource
+{
+    D3D12_RESOURCE_DESC1 desc;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_HEAP_FLAGS heap_flags;
+    struct vkd3d_memory_allocation mem;
+    VkImage vk_image;
+    VkImageView vrs_view;
+    VkImageLayout common_layout;
+    uint32_t flags;
+};
+
+struct vkd3d_resource_recycle_pool
+{
+    pthread_mutex_t mutex;
+    /* Oldest entry first. */
+    struct vkd3d_recycled_resource **entries;
+    size_t entries_size;
+    size_t entry_count;
+    VkDeviceSize total_size;
+};
+
+HRESULT vkd3d_resource_recycle_pool_init(struct vkd3d_resource_recycle_pool *pool);
+void vkd3d_resource_recycle_pool_cleanup(struct vkd3d_resource_recycle_pool *pool, struct d3d12_device *device);
+void vkd3d_resource_recycle_pool_insert(struct d3d12_device *device, struct vkd3d_recycled_resource *entry);
+
 enum vkd3d_view_type
 {
     VKD3D_VIEW_TYPE_BUFFER,
@@ -1087,6 +1561,29 @@ STATIC_ASSERT(sizeof(struct vkd3d_descriptor_metadata_view) == 32);
 
 typedef uintptr_t vkd3d_cpu_descriptor_va_t;
 
+/* Gathers VkCopyDescriptorSet entries so that a whole CopyDescriptors call
+ * can be submitted with a single vkUpdateDescriptorSets. */
+#define VKD3D_DESC_COPY_BATCH_SIZE 128u
+
+struct d3d12_desc_copy_batch
+{
+    VkCopyDescriptorSet *vk_copies;
+    uint32_t copy_count;
+    uint32_t copy_size;
+};
+
+static inline void d3d12_desc_copy_batch_init(struct d3d12_desc_copy_batch *batch,
+        VkCopyDescriptorSet *vk_copies, uint32_t copy_size)
+{
+    batch->vk_copies = vk_copies;
+    batch->copy_count = 0;
+    batch->copy_size = copy_size;
+}
+
+void d3d12_desc_copy_batch_flush(struct d3d12_desc_copy_batch *batch, struct d3d12_device *device);
+void d3d12_desc_copy_batched(vkd3d_cpu_descriptor_va_t dst, vkd3d_cpu_descriptor_va_t src,
+        unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device,
+        struct d3d12_desc_copy_batch *batch);
 void d3d12_desc_copy(vkd3d_cpu_descriptor_va_t dst, vkd3d_cpu_descriptor_va_t src,
         unsigned int count, D3D12_DESCRIPTOR_HEAP_TYPE heap_type, struct d3d12_device *device);
 void d3d12_desc_copy_single(vkd3d_cpu_descriptor_va_t dst,
@@ -1102,8 +1599,6 @@ void d3d12_desc_create_uav(vkd3d_cpu_descriptor_va_t descriptor, struct d3d12_de
 void d3d12_desc_create_sampler(vkd3d_cpu_descriptor_va_t sampler,
         struct d3d12_device *device, const D3D12_SAMPLER_DESC *desc);
 
-bool vkd3d_create_raw_buffer_view(struct d3d12_device *device,
-        D3D12_GPU_VIRTUAL_ADDRESS gpu_address, VkBufferView *vk_buffer_view);
 HRESULT d3d12_create_static_sampler(struct d3d12_device *device,
         const D3D12_STATIC_SAMPLER_DESC *desc, VkSampler *vk_sampler);
 
@@ -1187,8 +1682,8 @@ struct d3d12_descriptor_heap
     struct vkd3d_host_visible_buffer_range buffer_ranges;
 #ifdef VKD3D_ENABLE_DESCRIPTOR_QA
     struct vkd3d_host_visible_buffer_range descriptor_heap_info;
-    uint64_t cookie;
 #endif
+    uint64_t cookie;
 
     struct d3d12_null_descriptor_template null_descriptor_template;
 
@@ -1196,6 +1691,9 @@ struct d3d12_descriptor_heap
 
     struct vkd3d_private_store private_store;
 
+    /* The heap itself was allocated with vkd3d_malloc_huge(). */
+    bool host_huge_pages;
+
     /* Here we pack metadata data structures for CBV_SRV_UAV and SAMPLER.
      * For RTV/DSV heaps, we just encode rtv_desc structs inline. */
     DECLSPEC_ALIGN(D3D12_DESC_ALIGNMENT) BYTE descriptors[];
@@ -1269,6 +1767,7 @@ struct d3d12_query_heap
     VkQueryPool vk_query_pool;
     struct vkd3d_device_memory_allocation device_allocation;
     VkBuffer vk_buffer;
+    VkDeviceAddress va;
     uint32_t initialized;
 
     struct d3d12_device *device;
@@ -1346,14 +1845,20 @@ struct d3d12_root_signature
 {
     ID3D12RootSignature ID3D12RootSignature_iface;
     LONG refcount;
+    uint64_t cookie;
 
     vkd3d_shader_hash_t compatibility_hash;
 
+    /* Copy of the serialized blob, used to verify root signature cache hits. */
+    void *blob;
+    size_t blob_size;
+
     struct d3d12_bind_point_layout graphics, compute, raygen;
     VkDescriptorSetLayout vk_sampler_descriptor_layout;
     VkDescriptorSetLayout vk_root_descriptor_layout;
 
-    VkDescriptorPool vk_sampler_pool;
+    /* Shared between all root signatures with identical static samplers. */
+    struct vkd3d_static_sampler_set *static_sampler_set;
     VkDescriptorSet vk_sampler_set;
 
     struct vkd3d_shader_root_parameter *parameters;
@@ -1406,6 +1911,33 @@ struct d3d12_root_signature
 HRESULT d3d12_root_signature_create(struct d3d12_device *device, const void *bytecode,
         size_t bytecode_length, struct d3d12_root_signature **root_signature);
 
+/* Root signatures created from identical blobs share one object, like on native.
+ * Entries hold weak references and are cleared when the root signature dies. */
+struct vkd3d_root_signature_cache
+{
+    spinlock_t spinlock;
+    struct hash_map map;
+    /* Parsed descs by RTS0 chunk, which outlive the root signature objects. */
+    struct hash_map desc_map;
+};
+
+void vkd3d_root_signature_cache_init(struct vkd3d_root_signature_cache *cache);
+void vkd3d_root_signature_cache_cleanup(struct vkd3d_root_signature_cache *cache);
+
+#define VKD3D_SHADER_CODE_CACHE_MAX_SIZE (64u << 20)
+
+/* SPIR-V translated for one pipeline state, reused when another pipeline state
+ * uses the same shader with an identical shader interface and compile arguments. */
+struct vkd3d_shader_code_cache
+{
+    rwlock_t lock;
+    struct hash_map map;
+    size_t total_size;
+};
+
+HRESULT vkd3d_shader_code_cache_init(struct vkd3d_shader_code_cache *cache);
+void vkd3d_shader_code_cache_cleanup(struct vkd3d_shader_code_cache *cache);
+
 static inline struct d3d12_root_signature *impl_from_ID3D12RootSignature(ID3D12RootSignature *iface)
 {
     extern CONST_VTBL struct ID3D12RootSignatureVtbl d3d12_root_signature_vtbl;
@@ -1434,7 +1966,7 @@ HRESULT vkd3d_create_descriptor_set_layout(struct d3d12_device *device,
         VkDescriptorSetLayoutCreateFlags flags, unsigned int binding_count,
         const VkDescriptorSetLayoutBinding *bindings, VkDescriptorSetLayout *set_layout);
 
-#define VKD3D_MAX_DYNAMIC_STATE_COUNT (7)
+#define VKD3D_MAX_DYNAMIC_STATE_COUNT (9)
 
 enum vkd3d_dynamic_state_flag
 {
@@ -1449,6 +1981,8 @@ enum vkd3d_dynamic_state_flag
     VKD3D_DYNAMIC_STATE_SCISSOR_COUNT         = (1 << 8),
     VKD3D_DYNAMIC_STATE_VERTEX_BUFFER_STRIDE  = (1 << 9),
     VKD3D_DYNAMIC_STATE_FRAGMENT_SHADING_RATE = (1 << 10),
+    VKD3D_DYNAMIC_STATE_VERTEX_INPUT          = (1 << 11),
+    VKD3D_DYNAMIC_STATE_PATCH_CONTROL_POINTS  = (1 << 12),
 };
 
 struct vkd3d_shader_debug_ring_spec_constants
@@ -1532,6 +2066,8 @@ struct d3d12_graphics_pipeline_state
     VkPipelineLayout pipeline_layout;
     VkPipeline pipeline[VKD3D_GRAPHICS_PIPELINE_STATIC_VARIANT_COUNT];
     struct list compiled_fallback_pipelines;
+    struct hash_map compiled_fallback_pipeline_map;
+    struct vkd3d_compiled_pipeline *last_fallback_pipeline;
 
     bool xfb_enabled;
 };
@@ -1561,6 +2097,7 @@ struct d3d12_pipeline_state
 {
     ID3D12PipelineState ID3D12PipelineState_iface;
     LONG refcount;
+    uint64_t cookie;
 
     union
     {
@@ -1647,9 +2184,11 @@ struct vkd3d_pipeline_key
     bool dynamic_stride;
     bool dynamic_viewport;
     bool dynamic_topology;
+    bool dynamic_vertex_input;
 };
 
 bool d3d12_pipeline_state_has_replaced_shaders(struct d3d12_pipeline_state *state);
+bool d3d12_pipeline_state_uses_debug_ring(struct d3d12_pipeline_state *state);
 HRESULT d3d12_pipeline_state_create(struct d3d12_device *device, VkPipelineBindPoint bind_point,
         const struct d3d12_pipeline_state_desc *desc, struct d3d12_pipeline_state **state);
 VkPipeline d3d12_pipeline_state_get_or_create_pipeline(struct d3d12_pipeline_state *state,
@@ -1662,46 +2201,236 @@ VkPipeline d3d12_pipeline_state_get_pipeline(struct d3d12_pipeline_state *state,
         uint32_t rtv_nonnull_mask, const struct vkd3d_format *dsv_format,
         const struct vkd3d_render_pass_compatibility **render_pass_compat,
         uint32_t *dynamic_state_flags, uint32_t variant_flags);
+bool d3d12_pipeline_state_uses_dynamic_vertex_stride(struct d3d12_pipeline_state *state,
+        const struct vkd3d_dynamic_state *dyn_state);
 VkPipeline d3d12_pipeline_state_create_pipeline_variant(struct d3d12_pipeline_state *state,
         const struct vkd3d_pipeline_key *key, const struct vkd3d_format *dsv_format, VkPipelineCache vk_cache,
         struct vkd3d_render_pass_compatibility *render_pass_compat,
         uint32_t *dynamic_state_flags, uint32_t variant_flags);
 
-static inline struct d3d12_pipeline_state *impl_from_ID3D12PipelineState(ID3D12PipelineState *iface)
-{
-    extern CONST_VTBL struct ID3D12PipelineStateVtbl d3d12_pipeline_state_vtbl;
-    if (!iface)
-        return NULL;
-    assert(iface->lpVtbl == &d3d12_pipeline_state_vtbl);
-    return CONTAINING_RECORD(iface, struct d3d12_pipeline_state, ID3D12PipelineState_iface);
-}
+#define VKD3D_PIPELINE_COMPILE_THREAD_COUNT 2
 
-/* ID3D12PipelineLibrary */
-typedef ID3D12PipelineLibrary1 d3d12_pipeline_library_iface;
+struct vkd3d_compiled_pipeline;
 
-struct d3d12_pipeline_library
+struct vkd3d_pipeline_compile_job
 {
-    d3d12_pipeline_library_iface ID3D12PipelineLibrary_iface;
-    LONG refcount;
+    struct d3d12_pipeline_state *state;
+    struct vkd3d_compiled_pipeline *pipeline;
+    const struct vkd3d_format *dsv_format;
+};
+
+/* Compiles fallback pipeline variants in the background, so that
+ * draws which miss the static variants do not stall on the compiler. */
+struct vkd3d_pipeline_compile_worker
+{
+    union vkd3d_thread_handle threads[VKD3D_PIPELINE_COMPILE_THREAD_COUNT];
+    uint32_t thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t done_cond;
+    bool should_exit;
+
+    struct vkd3d_pipeline_compile_job *jobs;
+    size_t jobs_size;
+    size_t job_count;
+
+    /* Pipeline states currently being compiled, one slot per thread. */
+    struct d3d12_pipeline_state *active_states[VKD3D_PIPELINE_COMPILE_THREAD_COUNT];
 
     struct d3d12_device *device;
+};
 
-    rwlock_t mutex;
-    struct hash_map pso_map;
-    struct hash_map driver_cache_map;
-    struct hash_map spirv_cache_map;
+HRESULT vkd3d_pipeline_compile_worker_start(struct vkd3d_pipeline_compile_worker *worker,
+        struct d3d12_device *device);
+HRESULT vkd3d_pipeline_compile_worker_stop(struct vkd3d_pipeline_compile_worker *worker,
+        struct d3d12_device *device);
 
-    size_t total_name_table_size;
-    size_t total_blob_size;
+static inline bool vkd3d_pipeline_compile_worker_is_active(const struct vkd3d_pipeline_compile_worker *worker)
+{
+    return worker->thread_count != 0;
+}
 
-    struct vkd3d_private_store private_store;
+#define VKD3D_TASK_POOL_MAX_THREAD_COUNT 16
+
+enum vkd3d_task_type
+{
+    VKD3D_TASK_TYPE_SHADER_COMPILE,
+    VKD3D_TASK_TYPE_STATE_OBJECT_COMPILE,
+    VKD3D_TASK_TYPE_DEFERRED_OPERATION_JOIN,
+    VKD3D_TASK_TYPE_META_PREWARM,
+    VKD3D_TASK_TYPE_DEVICE_INIT,
+    VKD3D_TASK_TYPE_RESIDENCY,
+    VKD3D_TASK_TYPE_COUNT
 };
 
-HRESULT d3d12_pipeline_library_create(struct d3d12_device *device, const void *blob,
-        size_t blob_length, struct d3d12_pipeline_library **pipeline_library);
+enum vkd3d_task_priority
+{
+    /* Someone is waiting for the result, e.g. a pipeline creation call. */
+    VKD3D_TASK_PRIORITY_HIGH,
+    /* Only runs when there is no high priority work left. */
+    VKD3D_TASK_PRIORITY_LOW,
+    VKD3D_TASK_PRIORITY_COUNT
+};
 
-VkResult vkd3d_create_pipeline_cache(struct d3d12_device *device,
-        size_t size, const void *data, VkPipelineCache *cache);
+/* Tracks completion of a set of tasks, which can be waited on. */
+struct vkd3d_task_group
+{
+    /* Protected by the pool mutex. */
+    uint32_t pending_count;
+};
+
+struct vkd3d_task
+{
+    void (*func)(void *userdata);
+    void *userdata;
+    struct vkd3d_task_group *group;
+    enum vkd3d_task_type type;
+};
+
+struct vkd3d_task_queue
+{
+    struct vkd3d_task *tasks;
+    size_t tasks_size;
+    size_t task_head;
+    size_t task_count;
+};
+
+/* Device-wide pool of worker threads for short-lived asynchronous work. Threads
+ * which wait on a group run queued tasks of their own group, so they never
+ * sleep behind unrelated work. The pool drains all tasks before its threads exit. */
+struct vkd3d_task_pool
+{
+    union vkd3d_thread_handle threads[VKD3D_TASK_POOL_MAX_THREAD_COUNT];
+    uint32_t thread_count;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_cond_t done_cond;
+    bool should_exit;
+
+    struct vkd3d_task_queue queues[VKD3D_TASK_PRIORITY_COUNT];
+};
+
+HRESULT vkd3d_task_pool_start(struct vkd3d_task_pool *pool, struct d3d12_device *device);
+HRESULT vkd3d_task_pool_stop(struct vkd3d_task_pool *pool, struct d3d12_device *device);
+void vkd3d_task_pool_submit(struct vkd3d_task_pool *pool, enum vkd3d_task_type type,
+        enum vkd3d_task_priority priority, struct vkd3d_task_group *group,
+        void (*func)(void *userdata), void *userdata);
+void vkd3d_task_pool_wait(struct vkd3d_task_pool *pool, struct vkd3d_task_group *group);
+
+static inline bool vkd3d_task_pool_is_active(const struct vkd3d_task_pool *pool)
+{
+    return pool->thread_count != 0;
+}
+
+/* Residency of heaps and committed resources, which are created resident with
+ * a residency count of one. Only objects which own their VkDeviceMemory can
+ * actually be evicted, which drops their memory priority so that the driver
+ * pages them out first once device local memory is oversubscribed. */
+struct vkd3d_residency_tracker
+{
+    pthread_mutex_t mutex;
+    /* Bytes of evicted allocations, indexed by Vulkan memory heap */
+    VkDeviceSize evicted_size[VK_MAX_MEMORY_HEAPS];
+
+    /* Promotions queued by EnqueueMakeResident */
+    struct vkd3d_task_group enqueue_group;
+    uint32_t enqueue_count;
+};
+
+HRESULT vkd3d_residency_tracker_init(struct vkd3d_residency_tracker *tracker, struct d3d12_device *device);
+void vkd3d_residency_tracker_cleanup(struct vkd3d_residency_tracker *tracker, struct d3d12_device *device);
+/* Without a fence, objects are promoted before this returns. */
+HRESULT vkd3d_residency_make_resident(struct d3d12_device *device, UINT object_count,
+        ID3D12Pageable * const *objects, D3D12_RESIDENCY_FLAGS flags, struct d3d12_fence *fence, uint64_t fence_value);
+void vkd3d_residency_evict(struct d3d12_device *device, UINT object_count, ID3D12Pageable * const *objects);
+/* Called before the memory of a heap or committed resource is freed or recycled. */
+void vkd3d_residency_release_allocation(struct d3d12_device *device, int32_t residency_count,
+        const struct vkd3d_memory_allocation *allocation);
+
+static inline struct d3d12_pipeline_state *impl_from_ID3D12PipelineState(ID3D12PipelineState *iface)
+{
+    extern CONST_VTBL struct ID3D12PipelineStateVtbl d3d12_pipeline_state_vtbl;
+    if (!iface)
+        return NULL;
+    assert(iface->lpVtbl == &d3d12_pipeline_state_vtbl);
+    return CONTAINING_RECORD(iface, struct d3d12_pipeline_state, ID3D12PipelineState_iface);
+}
+
+/* ID3D12PipelineLibrary */
+typedef ID3D12PipelineLibrary1 d3d12_pipeline_library_iface;
+
+struct d3d12_pipeline_library
+{
+    d3d12_pipeline_library_iface ID3D12PipelineLibrary_iface;
+    LONG refcount;
+
+    struct d3d12_device *device;
+
+    /* LoadPipeline is called from many threads at once, StorePipeline rarely. */
+    sharded_rwlock_t mutex;
+    struct hash_map pso_map;
+    struct hash_map driver_cache_map;
+    struct hash_map spirv_cache_map;
+
+    size_t total_name_table_size;
+    size_t total_blob_size;
+
+    struct vkd3d_private_store private_store;
+};
+
+HRESULT d3d12_pipeline_library_create(struct d3d12_device *device, const void *blob,
+        size_t blob_length, struct d3d12_pipeline_library **pipeline_library);
+
+/* Internal pipeline library which is loaded from VKD3D_SHADER_CACHE_PATH at device creation,
+ * and written back in the background whenever new pipelines have been added to it. */
+struct vkd3d_disk_cache
+{
+    struct d3d12_pipeline_library *library;
+    void *file_data;
+    size_t file_size;
+    uint64_t max_size;
+    char path[VKD3D_PATH_MAX];
+
+    union vkd3d_thread_handle thread;
+    pthread_mutex_t mutex;
+    condvar_reltime_t cond;
+    bool should_exit;
+    bool dirty;
+};
+
+void vkd3d_disk_cache_init(struct vkd3d_disk_cache *cache, struct d3d12_device *device);
+void vkd3d_disk_cache_cleanup(struct vkd3d_disk_cache *cache, struct d3d12_device *device);
+bool vkd3d_disk_cache_find_pipeline(struct vkd3d_disk_cache *cache,
+        const struct vkd3d_pipeline_cache_compatibility *compat, struct d3d12_cached_pipeline_state *cached_state);
+void vkd3d_disk_cache_store_pipeline(struct vkd3d_disk_cache *cache, struct d3d12_pipeline_state *state);
+
+static inline bool vkd3d_disk_cache_is_active(const struct vkd3d_disk_cache *cache)
+{
+    return cache->library != NULL;
+}
+
+/* Replays the pipeline descriptions recorded in the disk cache during earlier sessions on a
+ * background thread after device creation, so that compiled pipelines are already cached
+ * by the time the application creates them. */
+struct vkd3d_pipeline_warmup
+{
+    struct d3d12_device *device;
+    union vkd3d_thread_handle thread;
+    bool active;
+    uint32_t should_exit;
+    uint32_t completed_count;
+    uint32_t total_count;
+};
+
+void vkd3d_pipeline_warmup_record(struct vkd3d_disk_cache *cache, VkPipelineBindPoint bind_point,
+        const struct d3d12_pipeline_state_desc *desc, const struct vkd3d_pipeline_cache_compatibility *compat);
+HRESULT vkd3d_pipeline_warmup_start(struct vkd3d_pipeline_warmup *warmup, struct d3d12_device *device);
+void vkd3d_pipeline_warmup_stop(struct vkd3d_pipeline_warmup *warmup, struct d3d12_device *device);
+void vkd3d_pipeline_warmup_get_progress(struct vkd3d_pipeline_warmup *warmup,
+        uint32_t *completed_count, uint32_t *total_count);
+
+VkResult vkd3d_create_pipeline_cache(struct d3d12_device *device,
+        size_t size, const void *data, VkPipelineCache *cache);
 HRESULT vkd3d_create_pipeline_cache_from_d3d12_desc(struct d3d12_device *device,
         const struct d3d12_cached_pipeline_state *state, VkPipelineCache *cache);
 HRESULT vkd3d_get_cached_spirv_code_from_d3d12_desc(
@@ -1732,6 +2461,10 @@ struct d3d12_descriptor_pool_cache
     VkDescriptorPool *descriptor_pools;
     size_t descriptor_pools_size;
     size_t descriptor_pool_count;
+
+    /* Statistics for the current allocator cycle. */
+    uint32_t created_pool_count;
+    uint32_t recycled_pool_count;
 };
 
 enum vkd3d_descriptor_pool_types
@@ -1741,7 +2474,12 @@ enum vkd3d_descriptor_pool_types
 };
 
 #define VKD3D_SCRATCH_BUFFER_SIZE (1ull << 20)
-#define VKD3D_SCRATCH_BUFFER_COUNT (32u)
+/* Pooled scratch buffers come in power of two sizes from 1 MiB to 16 MiB,
+ * larger requests get a dedicated buffer which is freed when returned. */
+#define VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT (5u)
+#define VKD3D_SCRATCH_BUFFER_MAX_POOLED_SIZE (VKD3D_SCRATCH_BUFFER_SIZE << (VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT - 1))
+/* Upper bound for the memory kept around in the device pool. */
+#define VKD3D_SCRATCH_POOL_MAX_SIZE (64ull << 20)
 
 struct vkd3d_scratch_buffer
 {
@@ -1749,6 +2487,21 @@ struct vkd3d_scratch_buffer
     VkDeviceSize offset;
 };
 
+struct vkd3d_scratch_pool
+{
+    struct vkd3d_scratch_buffer *buffers;
+    size_t buffers_size;
+    size_t buffer_count;
+};
+
+struct vkd3d_scratch_pool_stats
+{
+    uint64_t created_count;
+    uint64_t reused_count;
+    VkDeviceSize live_size;
+    VkDeviceSize peak_live_size;
+};
+
 #define VKD3D_QUERY_TYPE_INDEX_OCCLUSION (0u)
 #define VKD3D_QUERY_TYPE_INDEX_PIPELINE_STATISTICS (1u)
 #define VKD3D_QUERY_TYPE_INDEX_TRANSFORM_FEEDBACK (2u)
@@ -1765,6 +2518,61 @@ struct vkd3d_query_pool
     uint32_t next_index;
 };
 
+/* New pools of a type double in size, up to this factor, whenever a command
+ * allocator runs out of queries in one pool, so that heavy query users end up
+ * with a few large pools instead of exhausting the device-level cache. */
+#define VKD3D_VIRTUAL_QUERY_POOL_MAX_GROWTH (16u)
+
+struct vkd3d_query_pool_stats
+{
+    uint64_t reused_count;
+    uint64_t created_count;
+    uint64_t retired_count;
+    uint64_t overflow_count;
+};
+
+/* Framebuffers and buffer views which command lists create while recording are
+ * shared through a device-wide cache, keyed by object cookies rather than Vulkan
+ * handles so that recycled handles never alias. Command allocators hold references
+ * to the objects they use until they are reset, and only unreferenced objects which
+ * went unused for a while are destroyed. Clear render passes never go away. */
+enum vkd3d_cached_command_object_type
+{
+    VKD3D_CACHED_COMMAND_OBJECT_FRAMEBUFFER,
+    VKD3D_CACHED_COMMAND_OBJECT_BUFFER_VIEW,
+};
+
+struct vkd3d_cached_command_object
+{
+    enum vkd3d_cached_command_object_type type;
+    union
+    {
+        VkFramebuffer vk_framebuffer;
+        VkBufferView vk_buffer_view;
+    };
+    uint32_t refcount;
+    uint32_t last_use_epoch;
+};
+
+struct vkd3d_command_object_map
+{
+    struct hash_map map;
+    uint32_t trim_threshold;
+};
+
+struct vkd3d_command_object_cache
+{
+    sharded_rwlock_t lock;
+    struct vkd3d_command_object_map framebuffers;
+    struct vkd3d_command_object_map buffer_views;
+    struct hash_map clear_passes;
+    /* Bumped whenever a command allocator is reset. */
+    uint32_t epoch;
+};
+
+HRESULT vkd3d_command_object_cache_init(struct vkd3d_command_object_cache *cache);
+void vkd3d_command_object_cache_cleanup(struct vkd3d_command_object_cache *cache, struct d3d12_device *device);
+
 /* ID3D12CommandAllocator */
 struct d3d12_command_allocator
 {
@@ -1779,10 +2587,7 @@ struct d3d12_command_allocator
 
     struct d3d12_descriptor_pool_cache descriptor_pool_caches[VKD3D_DESCRIPTOR_POOL_TYPE_COUNT];
 
-    VkRenderPass *passes;
-    size_t passes_size;
-    size_t pass_count;
-
+    /* Framebuffers for temporary views, which are not worth caching */
     VkFramebuffer *framebuffers;
     size_t framebuffers_size;
     size_t framebuffer_count;
@@ -1791,9 +2596,9 @@ struct d3d12_command_allocator
     size_t views_size;
     size_t view_count;
 
-    VkBufferView *buffer_views;
-    size_t buffer_views_size;
-    size_t buffer_view_count;
+    struct vkd3d_cached_command_object **cached_objects;
+    size_t cached_objects_size;
+    size_t cached_object_count;
 
     VkCommandBuffer *command_buffers;
     size_t command_buffers_size;
@@ -1802,6 +2607,8 @@ struct d3d12_command_allocator
     struct vkd3d_scratch_buffer *scratch_buffers;
     size_t scratch_buffers_size;
     size_t scratch_buffer_count;
+    /* Grows whenever one recording cycle needs more than one buffer. */
+    VkDeviceSize scratch_block_size;
 
     struct vkd3d_query_pool *query_pools;
     size_t query_pools_size;
@@ -1810,6 +2617,8 @@ struct d3d12_command_allocator
     struct vkd3d_query_pool active_query_pools[VKD3D_VIRTUAL_QUERY_TYPE_COUNT];
 
     LONG outstanding_submissions_count;
+    /* Command lists from this allocator still being translated in deferred mode. */
+    uint32_t pending_translation_count;
 
     struct d3d12_command_list *current_command_list;
     struct d3d12_device *device;
@@ -1822,6 +2631,9 @@ HRESULT d3d12_command_allocator_create(struct d3d12_device *device,
 bool d3d12_command_allocator_allocate_query_from_type_index(
         struct d3d12_command_allocator *allocator,
         uint32_t type_index, VkQueryPool *query_pool, uint32_t *query_index);
+bool d3d12_command_allocator_allocate_queries_from_type_index(
+        struct d3d12_command_allocator *allocator, uint32_t type_index, uint32_t count,
+        VkQueryPool *query_pool, uint32_t *query_index, uint32_t *query_count);
 
 enum vkd3d_pipeline_dirty_flag
 {
@@ -1856,6 +2668,16 @@ struct vkd3d_pipeline_bindings
 
     uint32_t root_constants[D3D12_MAX_ROOT_COST];
     uint64_t root_constant_dirty_mask;
+
+    /* Root parameters whose shadowed value was set under the current root signature.
+     * Setting such a parameter to the value it already holds is a no-op. */
+    uint64_t root_parameter_valid_mask;
+    D3D12_GPU_VIRTUAL_ADDRESS root_descriptor_vas[D3D12_MAX_ROOT_COST];
+
+    /* Last root descriptor set written when push descriptors cannot be used, along with
+     * a shadow copy of its inline uniform block. New sets copy whatever did not change. */
+    VkDescriptorSet last_root_descriptor_set;
+    uint32_t inline_uniform_block_data[D3D12_MAX_ROOT_COST];
 };
 
 struct vkd3d_dynamic_state
@@ -1876,6 +2698,7 @@ struct vkd3d_dynamic_state
     float max_depth_bounds;
 
     VkBuffer vertex_buffers[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+    uint64_t vertex_buffer_cookies[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     VkDeviceSize vertex_offsets[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     VkDeviceSize vertex_sizes[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
     VkDeviceSize vertex_strides[D3D12_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
@@ -1910,6 +2733,8 @@ struct vkd3d_initial_transition
         {
             struct d3d12_resource *resource;
             bool perform_initial_transition;
+            /* First use writes every subresource, so the zero-clear can be skipped */
+            bool overwrites_resource;
         } resource;
         struct d3d12_query_heap *query_heap;
     };
@@ -1957,7 +2782,16 @@ struct d3d12_resource_tracking
     uint32_t plane_optimal_mask;
 };
 
-#define VKD3D_BUFFER_COPY_TRACKING_BUFFER_COUNT 4
+struct d3d12_resource_tracking_entry
+{
+    struct hash_map_entry hash_entry;
+    const struct d3d12_resource *resource;
+    size_t tracking_index;
+};
+
+/* Written ranges are kept sorted by (vk_buffer, hazard_begin) and never overlap,
+ * so lookups are a binary search. A VK_NULL_HANDLE entry denotes a sparse write
+ * and aliases with everything. */
 struct d3d12_buffer_copy_tracked_buffer
 {
     /* Need to track on VkBuffer level to handle aliasing. For ID3D12Heap, all resources share one VkBuffer. */
@@ -1966,6 +2800,168 @@ struct d3d12_buffer_copy_tracked_buffer
     VkDeviceSize hazard_end;
 };
 
+/* A large copy from an UPLOAD heap into a buffer, which is held back until either
+ * Close(), where it can still be moved to the transfer queue at submission time,
+ * or until a later command of the list depends on the destination. */
+struct vkd3d_transfer_offload_copy
+{
+    VkBuffer src_buffer;
+    VkBuffer dst_buffer;
+    VkBufferCopy region;
+    uint64_t dst_cookie;
+};
+
+struct d3d12_command_list_transfer_offload
+{
+    struct vkd3d_transfer_offload_copy *copies;
+    size_t copies_size;
+    size_t copy_count;
+    /* Cookies of the buffers which barriers and copies of the list referred to so far. */
+    struct hash_map touched_buffers;
+    /* Set once the list did something which prevents moving copies out of it. */
+    bool disabled;
+};
+
+#define MAX_BATCHED_IMAGE_BARRIERS 16
+struct d3d12_command_list_barrier_batch
+{
+    VkImageMemoryBarrier vk_image_barriers[MAX_BATCHED_IMAGE_BARRIERS];
+    /* Stages are tracked per image barrier, so that the synchronization2 path
+     * does not have to make every barrier wait for the union of all stages in the batch. */
+    VkPipelineStageFlags image_src_stage_masks[MAX_BATCHED_IMAGE_BARRIERS];
+    VkPipelineStageFlags image_dst_stage_masks[MAX_BATCHED_IMAGE_BARRIERS];
+    VkMemoryBarrier vk_memory_barrier;
+    uint32_t image_barrier_count;
+    /* Stages for the global memory barrier only. */
+    VkPipelineStageFlags dst_stage_mask, src_stage_mask;
+};
+
+struct vkd3d_clear_attachment
+{
+    VkImageAspectFlags aspect_mask;
+    VkClearValue value;
+};
+
+/* Full-view clears of bound attachments which are folded into the next
+ * render pass. Index D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT is the DSV. */
+struct vkd3d_clear_state
+{
+    uint32_t attachment_mask;
+    struct vkd3d_clear_attachment attachments[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT + 1];
+};
+
+struct d3d12_bundle_command;
+
+/* Commands recorded by a command list in deferred translation mode,
+ * replayed on the list once it is closed. */
+struct d3d12_command_list_deferred_stream
+{
+    void **chunks;
+    size_t chunks_size;
+    size_t chunks_count;
+    size_t chunks_used;
+    size_t chunk_offset;
+
+    struct d3d12_bundle_command *head;
+    struct d3d12_bundle_command *tail;
+
+    /* Set while recorded commands are replayed. Bundle thunks call
+     * through the vtable, so recording methods forward directly then. */
+    bool is_replaying;
+
+    /* Non-zero while the list is queued for translation. */
+    uint32_t pending_translation;
+    struct d3d12_command_allocator *allocator;
+    HRESULT close_hr;
+};
+
+struct d3d12_command_list_buffer_copy_batch
+{
+    VkBuffer src_buffer;
+    VkBuffer dst_buffer;
+    VkBufferCopy2KHR *regions;
+    size_t region_count;
+    size_t regions_size;
+};
+
+struct d3d12_command_list_uav_clear_batch
+{
+    struct vkd3d_clear_uav_batch_record *records;
+    /* Only used when a single record is pending, which takes the regular clear path. */
+    VkDescriptorBufferInfo *buffers;
+    size_t record_count;
+    size_t records_size;
+    size_t buffers_size;
+    uint32_t max_extent;
+};
+
+/* The 32-bit predicate most recently resolved by SetPredication(). The predicate buffer
+ * must stay in PREDICATION state while in use, so this remains valid until the next barrier. */
+struct d3d12_command_list_predicate_cache
+{
+    const struct d3d12_resource *resource;
+    UINT64 offset;
+    D3D12_PREDICATION_OP operation;
+    VkBuffer vk_buffer;
+    VkDeviceSize vk_offset;
+    VkDeviceAddress va;
+    VkConditionalRenderingFlagsEXT flags;
+};
+
+struct d3d12_command_list_query_resolve_batch
+{
+    struct vkd3d_query_resolve_batch_record *records;
+    size_t record_count;
+    size_t records_size;
+    uint32_t max_query_count;
+};
+
+struct d3d12_command_list_acceleration_structure_build
+{
+    /* Build infos point into their own storage, so entries are allocated
+     * individually and keep their address while batched. */
+    struct vkd3d_acceleration_structure_build_info *info;
+    VkDeviceAddress dst_begin, dst_end;
+    VkDeviceAddress scratch_begin, scratch_end;
+    VkDeviceAddress src_begin, src_end;
+};
+
+struct d3d12_command_list_acceleration_structure_build_batch
+{
+    struct d3d12_command_list_acceleration_structure_build *builds;
+    size_t builds_size;
+    /* Entries up to allocated_count own an info allocation, which is reused across batches. */
+    size_t allocated_count;
+    size_t build_count;
+
+    VkAccelerationStructureBuildGeometryInfoKHR *build_infos;
+    size_t build_infos_size;
+    const VkAccelerationStructureBuildRangeInfoKHR **build_range_infos;
+    size_t build_range_infos_size;
+};
+
+struct d3d12_command_list_buffer_image_copy_batch
+{
+    struct d3d12_resource *dst_resource;
+    VkBuffer src_buffer;
+    VkImageLayout dst_layout;
+    VkBufferImageCopy2KHR *regions;
+    size_t regions_size;
+    /* One transition per region into dst_layout. */
+    VkImageMemoryBarrier *vk_image_barriers;
+    size_t vk_image_barriers_size;
+    size_t region_count;
+};
+
+struct d3d12_rendering_info
+{
+    VkRenderingInfoKHR info;
+    VkRenderingAttachmentInfoKHR color_attachments[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    VkRenderingAttachmentInfoKHR depth_attachment;
+    VkRenderingAttachmentInfoKHR stencil_attachment;
+    VkRenderingFragmentShadingRateAttachmentInfoKHR vrs_attachment;
+};
+
 struct d3d12_command_list
 {
     d3d12_command_list_iface ID3D12GraphicsCommandList_iface;
@@ -1978,12 +2974,20 @@ struct d3d12_command_list
     bool is_recording;
     bool is_valid;
     bool debug_capture;
-    bool has_replaced_shaders;
+    bool uses_debug_ring;
     bool has_valid_index_buffer;
     VkCommandBuffer vk_command_buffer;
     VkCommandBuffer vk_init_commands;
+    /* Initial transitions which were still pending at Close(), recorded up front. */
+    VkCommandBuffer vk_transition_commands;
+    /* Offloadable copies, for submissions which cannot use the transfer queue. */
+    VkCommandBuffer vk_offload_commands;
 
     DXGI_FORMAT index_buffer_format;
+    VkBuffer index_buffer;
+    uint64_t index_buffer_cookie;
+    VkDeviceSize index_buffer_offset;
+    VkIndexType index_buffer_type;
 
     struct d3d12_rtv_desc rtvs[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
     struct d3d12_rtv_desc dsv;
@@ -1999,6 +3003,7 @@ struct d3d12_command_list
 
     bool predicate_enabled;
     VkDeviceAddress predicate_va;
+    struct d3d12_command_list_predicate_cache predicate_cache;
 
     VkFramebuffer current_framebuffer;
 
@@ -2011,12 +3016,30 @@ struct d3d12_command_list
     VkPipeline command_buffer_pipeline;
 
     VkRenderPass pso_render_pass;
-    VkRenderPass current_render_pass;
+    bool is_inside_render_pass;
+
+    /* Set while an internal list records a bundle into a secondary command buffer.
+     * Anything that would have to leave the inherited render pass fails the bake. */
+    bool is_baking_bundle;
+    bool bundle_bake_failed;
+
+    /* Attachment setup of the current dynamic rendering instance, used in place of
+     * pso_render_pass to decide whether a new pipeline requires restarting rendering. */
+    uint32_t rendering_attachment_mask;
+    uint32_t rendering_color_count;
+    /* Kept around so that a suspended rendering instance can be resumed. */
+    struct d3d12_rendering_info rendering;
+    /* Once a baked bundle has been executed, rendering instances are begun suspended
+     * so that further bundles can resume them instead of splitting the render pass. */
+    bool suspends_rendering;
+
+    struct vkd3d_clear_state clear_state;
     struct vkd3d_dynamic_state dynamic_state;
     struct vkd3d_pipeline_bindings pipeline_bindings[VKD3D_PIPELINE_BIND_POINT_COUNT];
     VkPipelineBindPoint active_bind_point;
 
     VkDescriptorSet descriptor_heaps[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
+    uint64_t descriptor_heap_cookies[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
 
     struct d3d12_pipeline_state *state;
     struct d3d12_state_object *rt_state;
@@ -2035,6 +3058,11 @@ struct d3d12_command_list
     size_t query_ranges_size;
     size_t query_ranges_count;
 
+    /* Profiler regions of the currently open BeginEvent calls, innermost last. */
+    uint32_t *event_regions;
+    size_t event_regions_size;
+    size_t event_region_count;
+
     struct vkd3d_active_query *active_queries;
     size_t active_queries_size;
     size_t active_queries_count;
@@ -2047,15 +3075,46 @@ struct d3d12_command_list
 
     const struct vkd3d_descriptor_metadata_types *cbv_srv_uav_descriptors_types;
     const struct vkd3d_descriptor_metadata_view *cbv_srv_uav_descriptors_view;
+    const struct vkd3d_bound_buffer_range *cbv_srv_uav_buffer_ranges;
 
     struct d3d12_resource *vrs_image;
 
     struct d3d12_resource_tracking *dsv_resource_tracking;
     size_t dsv_resource_tracking_count;
     size_t dsv_resource_tracking_size;
-
-    struct d3d12_buffer_copy_tracked_buffer tracked_copy_buffers[VKD3D_BUFFER_COPY_TRACKING_BUFFER_COUNT];
-    unsigned int tracked_copy_buffer_count;
+    /* Maps resource to index in dsv_resource_tracking. */
+    struct hash_map dsv_resource_tracking_map;
+
+    struct d3d12_buffer_copy_tracked_buffer *tracked_copy_buffers;
+    size_t tracked_copy_buffer_count;
+    size_t tracked_copy_buffers_size;
+
+    /* Consecutive CopyBufferRegion() calls between the same pair of buffers
+     * are accumulated here and emitted as a single vkCmdCopyBuffer2KHR. */
+    struct d3d12_command_list_buffer_copy_batch pending_buffer_copies;
+    /* Same for buffer to image CopyTextureRegion() calls targeting one image,
+     * which additionally share the layout transitions around the copy. */
+    struct d3d12_command_list_buffer_image_copy_batch pending_buffer_image_copies;
+    /* Raw buffer ClearUnorderedAccessView*() calls are accumulated here
+     * and emitted as a single dispatch over all cleared ranges. */
+    struct d3d12_command_list_uav_clear_batch pending_uav_clears;
+    /* Binary occlusion ResolveQueryData() calls are accumulated here and
+     * emitted as a single dispatch which writes all destinations. */
+    struct d3d12_command_list_query_resolve_batch pending_query_resolves;
+    struct d3d12_command_list_transfer_offload transfer_offload;
+    /* BuildRaytracingAccelerationStructure() calls with disjoint memory are
+     * accumulated here and emitted as one vkCmdBuildAccelerationStructuresKHR. */
+    struct d3d12_command_list_acceleration_structure_build_batch pending_acceleration_structure_builds;
+    struct vkd3d_va_map_as_cache acceleration_structure_cache;
+
+    /* ResourceBarrier() calls are accumulated here and only emitted once
+     * the next command which depends on them is recorded. */
+    struct d3d12_command_list_barrier_batch pending_barriers;
+
+    /* Number of SetRoot*() calls which did not change any state. */
+    unsigned int redundant_root_parameter_count;
+
+    struct d3d12_command_list_deferred_stream deferred;
 
     /* Hackery needed for game workarounds. */
     struct
@@ -2070,6 +3129,16 @@ struct d3d12_command_list
 
 HRESULT d3d12_command_list_create(struct d3d12_device *device,
         UINT node_mask, D3D12_COMMAND_LIST_TYPE type, struct d3d12_command_list **list);
+void d3d12_command_list_flush_deferred_commands(struct d3d12_command_list *list);
+void d3d12_command_list_translate_deferred(struct d3d12_command_list *list);
+void d3d12_command_list_deferred_stream_cleanup(struct d3d12_command_list_deferred_stream *stream);
+void d3d12_command_list_mark_as_invalid(struct d3d12_command_list *list,
+        const char *message, ...);
+bool d3d12_command_allocator_add_view(struct d3d12_command_allocator *allocator,
+        struct vkd3d_view *view);
+bool vk_pipeline_stage_from_wbi_mode(D3D12_WRITEBUFFERIMMEDIATE_MODE mode, VkPipelineStageFlagBits *stage);
+HRESULT d3d12_command_list_copy_buffer_ranges(ID3D12GraphicsCommandList *iface,
+        VkBuffer src_buffer, VkBuffer dst_buffer, uint32_t region_count, const VkBufferCopy *regions);
 bool d3d12_command_list_reset_query(struct d3d12_command_list *list,
         VkQueryPool vk_pool, uint32_t index);
 
@@ -2081,9 +3150,11 @@ struct d3d12_bundle_allocator
     ID3D12CommandAllocator ID3D12CommandAllocator_iface;
     LONG refcount;
 
+    /* Chunks are kept across Reset(). Unused ones are returned to the device. */
     void **chunks;
     size_t chunks_size;
     size_t chunks_count;
+    size_t chunks_used;
     size_t chunk_offset;
 
     struct d3d12_bundle *current_bundle;
@@ -2097,12 +3168,76 @@ HRESULT d3d12_bundle_allocator_create(struct d3d12_device *device,
 
 typedef void (*pfn_d3d12_bundle_command)(d3d12_command_list_iface *command_list, const void *args);
 
+/* Commands are packed back to back in chunks. Each chunk which is not the last one
+ * is terminated by a command with a NULL proc, which links to the next chunk. */
 struct d3d12_bundle_command
 {
     pfn_d3d12_bundle_command proc;
-    struct d3d12_bundle_command *next;
+    union
+    {
+        size_t size;
+        struct d3d12_bundle_command *continuation;
+    };
 };
 
+static inline struct d3d12_bundle_command *d3d12_bundle_command_next(const struct d3d12_bundle_command *command)
+{
+    struct d3d12_bundle_command *next = void_ptr_offset((void *)command, command->size);
+    return next->proc ? next : next->continuation;
+}
+
+/* Every chunk keeps room for its terminator. */
+static inline bool d3d12_bundle_chunk_needs_continuation(size_t chunk_offset, size_t size)
+{
+    return chunk_offset + size + sizeof(struct d3d12_bundle_command) > VKD3D_BUNDLE_CHUNK_SIZE;
+}
+
+static inline void d3d12_bundle_chunk_terminate(void *chunk, size_t chunk_offset,
+        struct d3d12_bundle_command *continuation)
+{
+    struct d3d12_bundle_command *terminator = void_ptr_offset(chunk, chunk_offset);
+
+    terminator->proc = NULL;
+    terminator->continuation = continuation;
+}
+
+/* Everything a baked bundle inherits from the command list executing it.
+ * Objects are identified by cookies, since their handles may be recycled. */
+struct d3d12_bundle_bake_key
+{
+    uint64_t pipeline_state_cookie;
+    const struct vkd3d_format *rtv_formats[D3D12_SIMULTANEOUS_RENDER_TARGET_COUNT];
+    const struct vkd3d_format *dsv_format;
+    uint32_t rtv_nonnull_mask;
+    uint32_t rendering_attachment_mask;
+    uint32_t dsv_plane_optimal_mask;
+    VkSampleCountFlagBits rasterization_samples;
+
+    uint64_t descriptor_heap_cookies[VKD3D_MAX_BINDLESS_DESCRIPTOR_SETS];
+    struct vkd3d_dynamic_state dynamic_state;
+
+    uint64_t index_buffer_cookie;
+    VkDeviceSize index_buffer_offset;
+    VkIndexType index_buffer_type;
+    DXGI_FORMAT index_buffer_format;
+
+    /* Only set if the bundle inherits root arguments. */
+    uint64_t root_signature_cookie;
+    uint64_t root_parameter_valid_mask;
+    uint32_t descriptor_tables[D3D12_MAX_ROOT_COST];
+    uint32_t root_constants[D3D12_MAX_ROOT_COST];
+    D3D12_GPU_VIRTUAL_ADDRESS root_descriptor_vas[D3D12_MAX_ROOT_COST];
+};
+
+struct d3d12_bundle_baked_variant
+{
+    struct d3d12_bundle_bake_key key;
+    /* VK_NULL_HANDLE if the bundle failed to bake with this state. */
+    VkCommandBuffer vk_command_buffer;
+};
+
+#define VKD3D_BUNDLE_MAX_BAKED_VARIANT_COUNT 16
+
 struct d3d12_bundle
 {
     d3d12_command_list_iface ID3D12GraphicsCommandList_iface;
@@ -2115,14 +3250,215 @@ struct d3d12_bundle
     struct d3d12_bundle_command *head;
     struct d3d12_bundle_command *tail;
 
+    /* Determined at Close(). A bakeable bundle only records draws and state,
+     * so it can be pre-translated into a secondary command buffer. */
+    bool is_bakeable;
+    struct d3d12_pipeline_state *bake_pipeline_state;
+    struct d3d12_root_signature *bake_root_signature;
+    /* State commands are replayed on the parent list after executing a baked bundle. */
+    const struct d3d12_bundle_command **state_commands;
+    size_t state_commands_size;
+    size_t state_command_count;
+
+    pthread_mutex_t bake_mutex;
+    struct d3d12_command_allocator *bake_allocator;
+    struct d3d12_command_list *bake_list;
+    struct d3d12_bundle_baked_variant *baked_variants;
+    size_t baked_variants_size;
+    size_t baked_variant_count;
+
     struct vkd3d_private_store private_store;
 };
 
 HRESULT d3d12_bundle_create(struct d3d12_device *device,
         UINT node_mask, D3D12_COMMAND_LIST_TYPE type, struct d3d12_bundle **bundle);
 void d3d12_bundle_execute(struct d3d12_bundle *bundle, d3d12_command_list_iface *list);
+void d3d12_bundle_execute_state_commands(struct d3d12_bundle *bundle, d3d12_command_list_iface *list);
 struct d3d12_bundle *d3d12_bundle_from_iface(ID3D12GraphicsCommandList *iface);
 
+/* Command layouts and replay thunks which command lists in deferred
+ * translation mode record through as well. Thunks call through the
+ * vtable of the command list they are replayed on. */
+struct d3d12_draw_instanced_command
+{
+    struct d3d12_bundle_command head;
+    UINT vertex_count;
+    UINT instance_count;
+    UINT first_vertex;
+    UINT first_instance;
+};
+
+struct d3d12_draw_indexed_instanced_command
+{
+    struct d3d12_bundle_command head;
+    UINT index_count;
+    UINT instance_count;
+    UINT first_index;
+    UINT vertex_offset;
+    UINT first_instance;
+};
+
+struct d3d12_dispatch_command
+{
+    struct d3d12_bundle_command head;
+    UINT x, y, z;
+};
+
+struct d3d12_ia_set_primitive_topology_command
+{
+    struct d3d12_bundle_command command;
+    D3D12_PRIMITIVE_TOPOLOGY topology;
+};
+
+struct d3d12_om_set_blend_factor_command
+{
+    struct d3d12_bundle_command command;
+    FLOAT blend_factor[4];
+};
+
+struct d3d12_om_set_stencil_ref_command
+{
+    struct d3d12_bundle_command command;
+    UINT stencil_ref;
+};
+
+struct d3d12_set_pipeline_state_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12PipelineState *pipeline_state;
+};
+
+struct d3d12_set_root_signature_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12RootSignature *root_signature;
+};
+
+struct d3d12_set_root_descriptor_table_command
+{
+    struct d3d12_bundle_command command;
+    UINT parameter_index;
+    D3D12_GPU_DESCRIPTOR_HANDLE base_descriptor;
+};
+
+struct d3d12_set_root_32bit_constant_command
+{
+    struct d3d12_bundle_command command;
+    UINT parameter_index;
+    UINT data;
+    UINT offset;
+};
+
+struct d3d12_set_root_32bit_constants_command
+{
+    struct d3d12_bundle_command command;
+    UINT parameter_index;
+    UINT constant_count;
+    UINT offset;
+    UINT data[];
+};
+
+struct d3d12_set_root_descriptor_command
+{
+    struct d3d12_bundle_command command;
+    UINT parameter_index;
+    D3D12_GPU_VIRTUAL_ADDRESS address;
+};
+
+struct d3d12_ia_set_index_buffer_command
+{
+    struct d3d12_bundle_command command;
+    D3D12_INDEX_BUFFER_VIEW view;
+};
+
+struct d3d12_ia_set_vertex_buffers_command
+{
+    struct d3d12_bundle_command command;
+    UINT start_slot;
+    UINT view_count;
+    D3D12_VERTEX_BUFFER_VIEW views[];
+};
+
+struct d3d12_debug_marker_command
+{
+    struct d3d12_bundle_command command;
+    UINT metadata;
+    UINT data_size;
+    char data[];
+};
+
+struct d3d12_execute_indirect_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12CommandSignature *signature;
+    UINT max_count;
+    ID3D12Resource *arg_buffer;
+    UINT64 arg_offset;
+    ID3D12Resource *count_buffer;
+    UINT64 count_offset;
+};
+
+struct d3d12_om_set_depth_bounds_command
+{
+    struct d3d12_bundle_command command;
+    FLOAT min;
+    FLOAT max;
+};
+
+struct d3d12_write_buffer_immediate_command
+{
+    struct d3d12_bundle_command command;
+    UINT count;
+    D3D12_WRITEBUFFERIMMEDIATE_PARAMETER *parameters;
+    D3D12_WRITEBUFFERIMMEDIATE_MODE *modes;
+};
+
+struct d3d12_set_pipeline_state1_command
+{
+    struct d3d12_bundle_command command;
+    ID3D12StateObject *state_object;
+};
+
+struct d3d12_dispatch_rays_command
+{
+    struct d3d12_bundle_command command;
+    D3D12_DISPATCH_RAYS_DESC desc;
+};
+
+void d3d12_bundle_exec_draw_instanced(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_draw_indexed_instanced(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_dispatch(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_ia_set_primitive_topology(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_om_set_blend_factor(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_om_set_stencil_ref(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_pipeline_state(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_signature(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_signature(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_descriptor_table(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_descriptor_table(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_32bit_constant(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_32bit_constant(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_32bit_constants(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_32bit_constants(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_cbv(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_cbv(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_srv(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_srv(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_compute_root_uav(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_graphics_root_uav(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_ia_set_index_buffer_null(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_ia_set_index_buffer(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_ia_set_vertex_buffers(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_marker(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_begin_event(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_end_event(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_execute_indirect(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_om_set_depth_bounds(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_write_buffer_immediate(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_set_pipeline_state1(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_dispatch_rays(d3d12_command_list_iface *list, const void *args_v);
+void d3d12_bundle_exec_dispatch_mesh(d3d12_command_list_iface *list, const void *args_v);
+
 struct vkd3d_queue
 {
     /* Access to VkQueue must be externally synchronized. */
@@ -2134,6 +3470,16 @@ struct vkd3d_queue
     VkCommandBuffer barrier_command_buffer;
     VkSemaphore serializing_binary_semaphore;
 
+    /* Signalled by every submission, so that deferred destruction knows when the GPU has caught up. */
+    VkSemaphore submission_timeline;
+    uint64_t submission_value;
+    VkSubmitInfo *submit_infos;
+    size_t submit_infos_size;
+    VkSemaphore *signal_semaphores;
+    size_t signal_semaphores_size;
+    uint64_t *signal_values;
+    size_t signal_values_size;
+
     uint32_t vk_family_index;
     VkQueueFlags vk_queue_flags;
     uint32_t timestamp_bits;
@@ -2146,6 +3492,14 @@ struct vkd3d_queue
     VkPipelineStageFlags *wait_stages;
     size_t wait_stages_size;
     uint32_t wait_count;
+
+    /* Scratch storage for translating submits to VK_KHR_synchronization2. */
+    VkSubmitInfo2KHR *submit2_infos;
+    size_t submit2_infos_size;
+    VkSemaphoreSubmitInfoKHR *semaphore_submit_infos;
+    size_t semaphore_submit_infos_size;
+    VkCommandBufferSubmitInfoKHR *cmd_buffer_submit_infos;
+    size_t cmd_buffer_submit_infos_size;
 };
 
 VkQueue vkd3d_queue_acquire(struct vkd3d_queue *queue);
@@ -2154,6 +3508,30 @@ HRESULT vkd3d_queue_create(struct d3d12_device *device, uint32_t family_index, u
 void vkd3d_queue_destroy(struct vkd3d_queue *queue, struct d3d12_device *device);
 void vkd3d_queue_release(struct vkd3d_queue *queue);
 void vkd3d_queue_add_wait(struct vkd3d_queue *queue, VkSemaphore semaphore, uint64_t value);
+VkResult vkd3d_queue_submit_locked(struct vkd3d_queue *queue, struct d3d12_device *device,
+        VkQueue vk_queue, uint32_t submit_count, const VkSubmitInfo *submits, VkFence vk_fence);
+VkResult vkd3d_queue_bind_sparse_locked(struct vkd3d_queue *queue, struct d3d12_device *device,
+        VkQueue vk_queue, const VkBindSparseInfo *bind_info);
+
+#define VKD3D_TRANSFER_OFFLOAD_COMMAND_BUFFER_COUNT (8u)
+
+/* Executes copies which were split out of direct command lists on a DMA queue. */
+struct vkd3d_transfer_offload_queue
+{
+    pthread_mutex_t mutex;
+
+    /* NULL if offloading is disabled. */
+    struct vkd3d_queue *vkd3d_queue;
+    VkCommandBuffer vk_command_buffers[VKD3D_TRANSFER_OFFLOAD_COMMAND_BUFFER_COUNT];
+    VkCommandPool vk_command_pool;
+    VkSemaphore vk_semaphore;
+
+    uint64_t next_signal_value;
+    uint32_t command_buffer_index;
+};
+
+HRESULT vkd3d_transfer_offload_queue_init(struct vkd3d_transfer_offload_queue *queue, struct d3d12_device *device);
+void vkd3d_transfer_offload_queue_cleanup(struct vkd3d_transfer_offload_queue *queue, struct d3d12_device *device);
 
 enum vkd3d_submission_type
 {
@@ -2162,7 +3540,8 @@ enum vkd3d_submission_type
     VKD3D_SUBMISSION_EXECUTE,
     VKD3D_SUBMISSION_BIND_SPARSE,
     VKD3D_SUBMISSION_STOP,
-    VKD3D_SUBMISSION_DRAIN
+    VKD3D_SUBMISSION_DRAIN,
+    VKD3D_SUBMISSION_CALLBACK,
 };
 
 enum vkd3d_sparse_memory_bind_mode
@@ -2171,12 +3550,16 @@ enum vkd3d_sparse_memory_bind_mode
     VKD3D_SPARSE_MEMORY_BIND_MODE_COPY,
 };
 
+/* Maps tile_count consecutive tiles starting at dst_tile. For UPDATE, tile n is bound to
+ * vk_offset + vk_stride * n, for COPY it takes the mapping of tile src_tile + n. */
 struct vkd3d_sparse_memory_bind
 {
     uint32_t dst_tile;
     uint32_t src_tile;
+    uint32_t tile_count;
     VkDeviceMemory vk_memory;
     VkDeviceSize vk_offset;
+    VkDeviceSize vk_stride;
 };
 
 struct vkd3d_sparse_memory_bind_range
@@ -2199,6 +3582,15 @@ struct d3d12_command_queue_submission_signal
     UINT64 value;
 };
 
+/* A run of initial transitions coming from one command list. If vk_cmd_buffer is not VK_NULL_HANDLE,
+ * it was recorded at Close() and performs every transition in the run, which is only valid
+ * if none of them have been consumed by another submission in the meantime. */
+struct vkd3d_initial_transition_batch
+{
+    VkCommandBuffer vk_cmd_buffer;
+    size_t transition_count;
+};
+
 struct d3d12_command_queue_submission_execute
 {
     VkCommandBuffer *cmd;
@@ -2208,6 +3600,11 @@ struct d3d12_command_queue_submission_execute
 
     struct vkd3d_initial_transition *transitions;
     size_t transition_count;
+    struct vkd3d_initial_transition_batch *transition_batches;
+    size_t transition_batch_count;
+
+    struct vkd3d_transfer_offload_copy *offload_copies;
+    size_t offload_copy_count;
 
     bool debug_capture;
 };
@@ -2221,6 +3618,16 @@ struct d3d12_command_queue_submission_bind_sparse
     struct d3d12_resource *src_resource;
 };
 
+typedef void (*PFN_d3d12_command_queue_callback)(void *userdata);
+
+/* Runs on the submission thread once everything queued before it has been submitted
+ * to the Vulkan queue. Callbacks must not block, since they stall the whole queue. */
+struct d3d12_command_queue_submission_callback
+{
+    PFN_d3d12_command_queue_callback callback;
+    void *userdata;
+};
+
 struct d3d12_command_queue_submission
 {
     enum vkd3d_submission_type type;
@@ -2230,9 +3637,32 @@ struct d3d12_command_queue_submission
         struct d3d12_command_queue_submission_signal signal;
         struct d3d12_command_queue_submission_execute execute;
         struct d3d12_command_queue_submission_bind_sparse bind_sparse;
+        struct d3d12_command_queue_submission_callback callback;
     };
 };
 
+/* Bounded MPSC ring of pending submissions. Producers claim a slot by bumping the write index
+ * and publish it through the per-slot sequence number, so ExecuteCommandLists and friends
+ * never take a lock unless the submission thread is asleep or the ring is full. */
+#define VKD3D_COMMAND_QUEUE_SUBMISSION_RING_SIZE 1024u
+#define VKD3D_COMMAND_QUEUE_SUBMISSION_RING_MASK (VKD3D_COMMAND_QUEUE_SUBMISSION_RING_SIZE - 1u)
+
+struct d3d12_command_queue_submission_slot
+{
+    uint64_t sequence;
+    struct d3d12_command_queue_submission submission;
+};
+
+struct d3d12_command_queue_submission_ring
+{
+    struct d3d12_command_queue_submission_slot *slots;
+    DECLSPEC_ALIGN(64) uint64_t write_index;
+    DECLSPEC_ALIGN(64) uint64_t read_index;
+    uint32_t consumer_idle;
+    uint32_t producer_waiters;
+    uint32_t peak_fill;
+};
+
 struct vkd3d_timeline_semaphore
 {
     VkSemaphore vk_semaphore;
@@ -2264,13 +3694,14 @@ struct d3d12_command_queue
     pthread_cond_t queue_cond;
     pthread_t submission_thread;
 
-    struct d3d12_command_queue_submission *submissions;
-    size_t submissions_count;
-    size_t submissions_size;
+    struct d3d12_command_queue_submission_ring submission_ring;
     uint64_t drain_count;
     uint64_t queue_drain_count;
 
-    struct vkd3d_fence_worker fence_worker;
+    /* Orders binds on the device sparse worker against this queue, if it is active. */
+    VkSemaphore sparse_timeline;
+    uint64_t sparse_timeline_value;
+
     struct vkd3d_private_store private_store;
 
 #ifdef VKD3D_BUILD_STANDALONE_D3D12
@@ -2281,6 +3712,16 @@ struct d3d12_command_queue
 HRESULT d3d12_command_queue_create(struct d3d12_device *device,
         const D3D12_COMMAND_QUEUE_DESC *desc, struct d3d12_command_queue **queue);
 void d3d12_command_queue_submit_stop(struct d3d12_command_queue *queue);
+void d3d12_command_queue_enqueue_callback(struct d3d12_command_queue *queue,
+        PFN_d3d12_command_queue_callback callback, void *userdata);
+
+/* Number of submissions queued up but not yet consumed by the submission thread. */
+static inline uint32_t d3d12_command_queue_get_submission_backlog(struct d3d12_command_queue *queue)
+{
+    uint64_t write_index = vkd3d_atomic_uint64_load_explicit(&queue->submission_ring.write_index, vkd3d_memory_order_relaxed);
+    uint64_t read_index = vkd3d_atomic_uint64_load_explicit(&queue->submission_ring.read_index, vkd3d_memory_order_relaxed);
+    return write_index > read_index ? (uint32_t)(write_index - read_index) : 0;
+}
 
 /* ID3D12CommandSignature */
 struct d3d12_command_signature
@@ -2290,13 +3731,24 @@ struct d3d12_command_signature
 
     D3D12_COMMAND_SIGNATURE_DESC desc;
 
+    /* Only used for signatures which modify state between commands. */
+    struct
+    {
+        VkIndirectCommandsLayoutNV vk_layout;
+        struct d3d12_root_signature *root_signature;
+        uint32_t argument_size;
+        uint32_t vertex_buffer_mask;
+        bool has_index_buffer;
+        bool has_root_parameters;
+    } state_template;
+
     struct d3d12_device *device;
 
     struct vkd3d_private_store private_store;
 };
 
-HRESULT d3d12_command_signature_create(struct d3d12_device *device, const D3D12_COMMAND_SIGNATURE_DESC *desc,
-        struct d3d12_command_signature **signature);
+HRESULT d3d12_command_signature_create(struct d3d12_device *device, struct d3d12_root_signature *root_signature,
+        const D3D12_COMMAND_SIGNATURE_DESC *desc, struct d3d12_command_signature **signature);
 
 static inline struct d3d12_command_signature *impl_from_ID3D12CommandSignature(ID3D12CommandSignature *iface)
 {
@@ -2308,10 +3760,23 @@ static inline struct d3d12_command_signature *impl_from_ID3D12CommandSignature(I
 }
 
 /* Static samplers */
+struct vkd3d_static_sampler_set
+{
+    VkDescriptorSetLayout vk_set_layout;
+    VkDescriptorPool vk_pool;
+    VkDescriptorSet vk_set;
+    uint32_t refcount;
+
+    uint32_t binding_count;
+    VkDescriptorSetLayoutBinding *bindings;
+    VkSampler *vk_samplers;
+};
+
 struct vkd3d_sampler_state
 {
     pthread_mutex_t mutex;
     struct hash_map map;
+    struct hash_map set_map;
 
     VkDescriptorPool *vk_descriptor_pools;
     size_t vk_descriptor_pools_size;
@@ -2332,9 +3797,14 @@ struct vkd3d_shader_debug_ring
     size_t ring_size;
     size_t ring_offset;
 
+    /* Only replaced shaders with these hashes are instrumented if set. */
+    vkd3d_shader_hash_t *filter_hashes;
+    size_t filter_hash_count;
+
     pthread_t ring_thread;
     pthread_mutex_t ring_lock;
     pthread_cond_t ring_cond;
+    uint32_t kick_count;
     bool active;
 };
 
@@ -2349,6 +3819,11 @@ HRESULT vkd3d_sampler_state_allocate_descriptor_set(struct vkd3d_sampler_state *
         VkDescriptorPool *vk_pool);
 void vkd3d_sampler_state_free_descriptor_set(struct vkd3d_sampler_state *state,
         struct d3d12_device *device, VkDescriptorSet vk_set, VkDescriptorPool vk_pool);
+HRESULT vkd3d_sampler_state_acquire_static_sampler_set(struct vkd3d_sampler_state *state,
+        struct d3d12_device *device, uint32_t binding_count, const VkDescriptorSetLayoutBinding *bindings,
+        struct vkd3d_static_sampler_set **sampler_set);
+void vkd3d_sampler_state_release_static_sampler_set(struct vkd3d_sampler_state *state,
+        struct d3d12_device *device, struct vkd3d_static_sampler_set *set);
 
 HRESULT vkd3d_shader_debug_ring_init(struct vkd3d_shader_debug_ring *state,
         struct d3d12_device *device);
@@ -2358,6 +3833,60 @@ void *vkd3d_shader_debug_ring_thread_main(void *arg);
 void vkd3d_shader_debug_ring_init_spec_constant(struct d3d12_device *device,
         struct vkd3d_shader_debug_ring_spec_info *info, vkd3d_shader_hash_t hash);
 void vkd3d_shader_debug_ring_end_command_buffer(struct d3d12_command_list *list);
+bool vkd3d_shader_debug_ring_instruments_shader(const struct vkd3d_shader_debug_ring *ring,
+        const struct vkd3d_shader_code *code);
+void vkd3d_shader_debug_ring_kick(struct vkd3d_shader_debug_ring *ring);
+
+/* GPU timing of PIX event regions */
+#define VKD3D_EVENT_PROFILER_REGION_COUNT (4096u)
+#define VKD3D_EVENT_PROFILER_RESULT_COUNT (16384u)
+#define VKD3D_EVENT_PROFILER_INVALID_REGION (~0u)
+
+struct vkd3d_event_profiler_region
+{
+    uint64_t frame_index;
+    uint64_t begin_time_ns;
+    uint64_t timestamp_mask;
+    D3D12_COMMAND_LIST_TYPE type;
+    uint32_t depth;
+    char name[D3D12_VK_GPU_EVENT_NAME_LENGTH];
+};
+
+struct vkd3d_event_profiler
+{
+    VkQueryPool vk_query_pool;
+    pthread_mutex_t lock;
+
+    /* Each region owns two consecutive timestamp queries. Regions are resolved in
+     * allocation order, between tail and head. */
+    struct vkd3d_event_profiler_region *regions;
+    uint64_t region_head;
+    uint64_t region_tail;
+    uint64_t dropped_count;
+
+    D3D12_VK_GPU_EVENT_TIMING *results;
+    uint64_t result_count;
+    uint64_t logged_count;
+    uint64_t last_log_time_ns;
+    FILE *log_file;
+
+    uint64_t frame_index;
+    bool active;
+};
+
+HRESULT vkd3d_event_profiler_init(struct vkd3d_event_profiler *profiler, struct d3d12_device *device);
+void vkd3d_event_profiler_cleanup(struct vkd3d_event_profiler *profiler, struct d3d12_device *device);
+void vkd3d_event_profiler_begin_region(struct vkd3d_event_profiler *profiler,
+        struct d3d12_command_list *list, const char *name);
+void vkd3d_event_profiler_end_region(struct vkd3d_event_profiler *profiler, struct d3d12_command_list *list);
+void vkd3d_event_profiler_next_frame(struct vkd3d_event_profiler *profiler, struct d3d12_device *device);
+HRESULT vkd3d_event_profiler_get_timings(struct vkd3d_event_profiler *profiler, struct d3d12_device *device,
+        uint64_t frame_index, D3D12_VK_GPU_EVENT_TIMING *timings, uint32_t *count);
+
+static inline bool vkd3d_event_profiler_is_active(const struct vkd3d_event_profiler *profiler)
+{
+    return profiler->active;
+}
 
 /* Bindless */
 enum vkd3d_bindless_flags
@@ -2376,6 +3905,7 @@ enum vkd3d_bindless_flags
     VKD3D_BINDLESS_MUTABLE_TYPE          = (1u << 11),
     VKD3D_HOIST_STATIC_TABLE_CBV         = (1u << 12),
     VKD3D_BINDLESS_MUTABLE_TYPE_RAW_SSBO = (1u << 13),
+    VKD3D_HOIST_STATIC_TABLE_SRV_UAV     = (1u << 14),
 };
 
 #define VKD3D_BINDLESS_SET_MAX_EXTRA_BINDINGS 8
@@ -2462,6 +3992,13 @@ struct vkd3d_memory_info_domain
     uint32_t rt_ds_type_mask;
 };
 
+struct vkd3d_memory_type_usage
+{
+    VkDeviceSize allocated_bytes;
+    VkDeviceSize fallback_bytes;
+    uint32_t allocation_count;
+};
+
 struct vkd3d_memory_info
 {
     uint32_t global_mask;
@@ -2479,13 +4016,25 @@ struct vkd3d_memory_info
     uint32_t budget_sensitive_mask;
     VkDeviceSize type_budget[VK_MAX_MEMORY_TYPES];
     VkDeviceSize type_current[VK_MAX_MEMORY_TYPES];
+    /* Also protected by budget_lock */
+    struct vkd3d_memory_type_usage type_usage[VK_MAX_MEMORY_TYPES];
     pthread_mutex_t budget_lock;
+
+    /* Unmap flushes of non-coherent memory, submitted together
+     * on the next ExecuteCommandLists */
+    pthread_mutex_t flush_lock;
+    VkMappedMemoryRange *pending_flushes;
+    size_t pending_flushes_size;
+    uint32_t pending_flush_count;
 };
 
 HRESULT vkd3d_memory_info_init(struct vkd3d_memory_info *info,
         struct d3d12_device *device);
 void vkd3d_memory_info_cleanup(struct vkd3d_memory_info *info,
         struct d3d12_device *device);
+void vkd3d_memory_info_queue_flush(struct vkd3d_memory_info *info, const VkMappedMemoryRange *range);
+void vkd3d_memory_info_flush_pending(struct vkd3d_memory_info *info, struct d3d12_device *device);
+void vkd3d_memory_info_discard_flushes(struct vkd3d_memory_info *info, VkDeviceMemory vk_memory);
 
 /* meta operations */
 struct vkd3d_clear_uav_args
@@ -2495,10 +4044,28 @@ struct vkd3d_clear_uav_args
     VkExtent2D extent;
 };
 
+/* Raw buffer clears which are batched into a single dispatch,
+ * one workgroup row per record. */
+struct vkd3d_clear_uav_batch_record
+{
+    VkDeviceAddress dst_va;
+    uint32_t dst_offset;
+    uint32_t dst_extent;
+    uint32_t clear_value;
+    uint32_t padding;
+};
+
+struct vkd3d_clear_uav_batch_args
+{
+    VkDeviceAddress records_va;
+    uint32_t record_count;
+};
+
 struct vkd3d_clear_uav_pipelines
 {
     VkPipeline buffer;
     VkPipeline buffer_raw;
+    VkPipeline buffer_raw_batch;
     VkPipeline image_1d;
     VkPipeline image_2d;
     VkPipeline image_3d;
@@ -2513,6 +4080,7 @@ struct vkd3d_clear_uav_ops
     VkDescriptorSetLayout vk_set_layout_image;
 
     VkPipelineLayout vk_pipeline_layout_buffer_raw;
+    VkPipelineLayout vk_pipeline_layout_buffer_raw_batch;
     VkPipelineLayout vk_pipeline_layout_buffer;
     VkPipelineLayout vk_pipeline_layout_image;
 
@@ -2634,6 +4202,22 @@ struct vkd3d_query_resolve_args
     uint32_t query_count;
 };
 
+/* Binary occlusion query resolves which are batched
+ * into a single dispatch, one workgroup row per record. */
+struct vkd3d_query_resolve_batch_record
+{
+    VkDeviceAddress src_va;
+    VkDeviceAddress dst_va;
+    uint32_t query_count;
+    uint32_t padding;
+};
+
+struct vkd3d_query_resolve_batch_args
+{
+    VkDeviceAddress records_va;
+    uint32_t record_count;
+};
+
 struct vkd3d_query_gather_args
 {
     uint32_t query_count;
@@ -2656,6 +4240,8 @@ struct vkd3d_query_ops
     VkDescriptorSetLayout vk_resolve_set_layout;
     VkPipelineLayout vk_resolve_pipeline_layout;
     VkPipeline vk_resolve_binary_pipeline;
+    VkPipelineLayout vk_resolve_batch_pipeline_layout;
+    VkPipeline vk_resolve_binary_batch_pipeline;
 };
 
 HRESULT vkd3d_query_ops_init(struct vkd3d_query_ops *meta_query_ops,
@@ -2718,10 +4304,62 @@ HRESULT vkd3d_predicate_ops_init(struct vkd3d_predicate_ops *meta_predicate_ops,
 void vkd3d_predicate_ops_cleanup(struct vkd3d_predicate_ops *meta_predicate_ops,
         struct d3d12_device *device);
 
+enum vkd3d_execute_indirect_flag
+{
+    VKD3D_EXECUTE_INDIRECT_FLAG_COUNT_BUFFER    = (1u << 0),
+    VKD3D_EXECUTE_INDIRECT_FLAG_PREDICATE       = (1u << 1),
+    VKD3D_EXECUTE_INDIRECT_FLAG_CHUNK_PREDICATE = (1u << 2),
+};
+
+struct vkd3d_execute_indirect_args
+{
+    VkDeviceAddress src_arg_va;
+    VkDeviceAddress dst_arg_va;
+    VkDeviceAddress src_count_va;
+    VkDeviceAddress dst_count_va;
+    VkDeviceAddress predicate_va;
+    uint32_t copy_word_count;
+    uint32_t max_command_count;
+    uint32_t flags; /* vkd3d_execute_indirect_flag */
+    uint32_t arg_word_stride;
+};
+
+enum vkd3d_execute_indirect_type
+{
+    VKD3D_EXECUTE_INDIRECT_TYPE_PATCH,
+    VKD3D_EXECUTE_INDIRECT_TYPE_DISPATCH,
+    VKD3D_EXECUTE_INDIRECT_TYPE_COUNT,
+};
+
+#define VKD3D_EXECUTE_INDIRECT_PATCH_WORKGROUP_SIZE (64u)
+#define VKD3D_EXECUTE_INDIRECT_PATCH_MAX_WORKGROUPS (256u)
+/* Must match cs_execute_indirect_dispatch.comp. */
+#define VKD3D_EXECUTE_INDIRECT_DISPATCH_CHUNK_SIZE (32u)
+
+struct vkd3d_execute_indirect_info
+{
+    VkPipelineLayout vk_pipeline_layout;
+    VkPipeline vk_pipeline;
+};
+
+struct vkd3d_execute_indirect_ops
+{
+    VkPipelineLayout vk_pipeline_layout;
+    VkPipeline vk_pipelines[VKD3D_EXECUTE_INDIRECT_TYPE_COUNT];
+};
+
+HRESULT vkd3d_execute_indirect_ops_init(struct vkd3d_execute_indirect_ops *meta_indirect_ops,
+        struct d3d12_device *device);
+void vkd3d_execute_indirect_ops_cleanup(struct vkd3d_execute_indirect_ops *meta_indirect_ops,
+        struct d3d12_device *device);
+
 struct vkd3d_meta_ops_common
 {
     VkShaderModule vk_module_fullscreen_vs;
     VkShaderModule vk_module_fullscreen_gs;
+    VkPipelineCache vk_pipeline_cache;
+    /* Serializes lazy creation of compute pipelines. */
+    pthread_mutex_t pipeline_mutex;
 };
 
 struct vkd3d_meta_ops
@@ -2733,13 +4371,18 @@ struct vkd3d_meta_ops
     struct vkd3d_swapchain_ops swapchain;
     struct vkd3d_query_ops query;
     struct vkd3d_predicate_ops predicate;
+    struct vkd3d_execute_indirect_ops execute_indirect;
+    struct vkd3d_task_group prewarm_group;
 };
 
 HRESULT vkd3d_meta_ops_init(struct vkd3d_meta_ops *meta_ops, struct d3d12_device *device);
 HRESULT vkd3d_meta_ops_cleanup(struct vkd3d_meta_ops *meta_ops, struct d3d12_device *device);
+/* Creates all lazily created meta pipelines on the shader compile pool. */
+void vkd3d_meta_ops_prewarm(struct vkd3d_meta_ops *meta_ops);
 
 struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_buffer_uav_pipeline(struct vkd3d_meta_ops *meta_ops,
         bool as_uint, bool raw);
+struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_buffer_uav_batch_pipeline(struct vkd3d_meta_ops *meta_ops);
 struct vkd3d_clear_uav_pipeline vkd3d_meta_get_clear_image_uav_pipeline(struct vkd3d_meta_ops *meta_ops,
         VkImageViewType image_view_type, bool as_uint);
 VkExtent3D vkd3d_meta_get_clear_image_uav_workgroup_size(VkImageViewType view_type);
@@ -2761,10 +4404,14 @@ HRESULT vkd3d_meta_get_swapchain_pipeline(struct vkd3d_meta_ops *meta_ops,
 
 bool vkd3d_meta_get_query_gather_pipeline(struct vkd3d_meta_ops *meta_ops,
         D3D12_QUERY_HEAP_TYPE heap_type, struct vkd3d_query_gather_info *info);
+VkPipeline vkd3d_meta_get_query_resolve_binary_batch_pipeline(struct vkd3d_meta_ops *meta_ops);
 
 void vkd3d_meta_get_predicate_pipeline(struct vkd3d_meta_ops *meta_ops,
         enum vkd3d_predicate_command_type command_type, struct vkd3d_predicate_command_info *info);
 
+void vkd3d_meta_get_execute_indirect_pipeline(struct vkd3d_meta_ops *meta_ops,
+        enum vkd3d_execute_indirect_type type, struct vkd3d_execute_indirect_info *info);
+
 enum vkd3d_time_domain_flag
 {
     VKD3D_TIME_DOMAIN_DEVICE = 0x00000001u,
@@ -2797,6 +4444,7 @@ struct vkd3d_physical_device_info
     VkPhysicalDeviceFragmentShadingRatePropertiesKHR fragment_shading_rate_properties;
     VkPhysicalDeviceConservativeRasterizationPropertiesEXT conservative_rasterization_properties;
     VkPhysicalDeviceShaderIntegerDotProductPropertiesKHR shader_integer_dot_product_properties;
+    VkPhysicalDeviceDeviceGeneratedCommandsPropertiesNV device_generated_commands_properties_nv;
 
     VkPhysicalDeviceProperties2KHR properties2;
 
@@ -2818,6 +4466,11 @@ struct vkd3d_physical_device_info
     VkPhysicalDeviceShaderSubgroupExtendedTypesFeaturesKHR subgroup_extended_types_features;
     VkPhysicalDeviceRobustness2FeaturesEXT robustness2_features;
     VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extended_dynamic_state_features;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extended_dynamic_state2_features;
+    VkPhysicalDeviceVertexInputDynamicStateFeaturesEXT vertex_input_dynamic_state_features;
+    VkPhysicalDeviceMemoryPriorityFeaturesEXT memory_priority_features;
+    VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT pageable_device_local_memory_features;
+    VkPhysicalDeviceHostQueryResetFeaturesEXT host_query_reset_features;
     VkPhysicalDeviceMutableDescriptorTypeFeaturesVALVE mutable_descriptor_features;
     VkPhysicalDeviceRayTracingPipelineFeaturesKHR ray_tracing_pipeline_features;
     VkPhysicalDeviceAccelerationStructureFeaturesKHR acceleration_structure_features;
@@ -2825,6 +4478,9 @@ struct vkd3d_physical_device_info
     VkPhysicalDeviceShaderDrawParametersFeatures shader_draw_parameters_features;
     VkPhysicalDeviceSubgroupSizeControlFeaturesEXT subgroup_size_control_features;
     VkPhysicalDeviceSeparateDepthStencilLayoutsFeaturesKHR separate_depth_stencil_layout_features;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features;
+    VkPhysicalDevicePresentIdFeaturesKHR present_id_features;
+    VkPhysicalDevicePresentWaitFeaturesKHR present_wait_features;
     VkPhysicalDeviceShaderIntegerDotProductFeaturesKHR shader_integer_dot_product_features;
     VkPhysicalDeviceFragmentShaderBarycentricFeaturesNV barycentric_features_nv;
     VkPhysicalDeviceRayQueryFeaturesKHR ray_query_features;
@@ -2833,6 +4489,8 @@ struct vkd3d_physical_device_info
     VkPhysicalDeviceShaderImageAtomicInt64FeaturesEXT shader_image_atomic_int64_features;
     VkPhysicalDeviceScalarBlockLayoutFeaturesEXT scalar_block_layout_features;
     VkPhysicalDeviceImageViewMinLodFeaturesEXT image_view_min_lod_features;
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2_features;
+    VkPhysicalDeviceDeviceGeneratedCommandsFeaturesNV device_generated_commands_features_nv;
 
     VkPhysicalDeviceFeatures2 features2;
 
@@ -2869,6 +4527,8 @@ enum vkd3d_queue_family
     VKD3D_QUEUE_FAMILY_SPARSE_BINDING,
     /* Keep internal queues at the end */
     VKD3D_QUEUE_FAMILY_INTERNAL_COMPUTE,
+    /* Only used for buffer operations, must be last */
+    VKD3D_QUEUE_FAMILY_INTERNAL_TRANSFER,
 
     VKD3D_QUEUE_FAMILY_COUNT
 };
@@ -2882,21 +4542,100 @@ struct vkd3d_queue_family_info
     VkQueueFlags vk_queue_flags;
 };
 
-#define VKD3D_CACHED_COMMAND_ALLOCATOR_COUNT 8
-struct vkd3d_cached_command_allocator
+/* Command pools of destroyed allocators are reset and handed to new allocators
+ * of the same queue family. Pools which backed many command buffers are reset
+ * with RELEASE_RESOURCES, so that the cache does not pin their memory. */
+#define VKD3D_COMMAND_POOL_CACHE_SIZE (8u)
+#define VKD3D_COMMAND_POOL_CACHE_SIZE_RECYCLE (64u)
+#define VKD3D_COMMAND_POOL_TRIM_COMMAND_BUFFER_COUNT (16u)
+
+struct vkd3d_command_pool_cache_stats
 {
-    VkCommandPool vk_command_pool;
-    uint32_t vk_family_index;
+    uint64_t hit_count;
+    uint64_t miss_count;
+    uint64_t trim_count;
+    uint64_t overflow_count;
+};
+
+struct vkd3d_command_pool_cache
+{
+    spinlock_t spinlock;
+    VkCommandPool vk_command_pools[VKD3D_COMMAND_POOL_CACHE_SIZE_RECYCLE];
+    uint32_t vk_command_pool_count;
+    struct vkd3d_command_pool_cache_stats stats;
+};
+
+#define VKD3D_CACHED_DESCRIPTOR_POOL_COUNT 64
+struct vkd3d_cached_descriptor_pools
+{
+    VkDescriptorPool vk_descriptor_pools[VKD3D_CACHED_DESCRIPTOR_POOL_COUNT];
+    size_t vk_descriptor_pool_count;
 };
 
+#define VKD3D_CACHED_BUNDLE_CHUNK_COUNT 64
+struct vkd3d_cached_bundle_chunks
+{
+    void *chunks[VKD3D_CACHED_BUNDLE_CHUNK_COUNT];
+    size_t chunk_count;
+};
+
+/* Streaming ring for per-frame upload data. Space is handed out linearly
+ * and returned once the queue has passed the fence of the frame using it. */
+#define VKD3D_UPLOAD_RING_MAX_FRAME_COUNT 16
+
+struct vkd3d_upload_ring_frame
+{
+    uint64_t end_offset;
+    uint64_t fence_value;
+};
+
+struct vkd3d_upload_ring
+{
+    struct d3d12_device *device;
+    D3D12_VK_UPLOAD_RING_PLACEMENT placement;
+    VkDeviceSize size;
+
+    /* Memory the application writes to */
+    VkBuffer host_buffer;
+    struct vkd3d_device_memory_allocation host_allocation;
+    uint8_t *host_ptr;
+
+    /* Copy destination for SYSTEM_MEMORY_COPY, otherwise VK_NULL_HANDLE */
+    VkBuffer device_buffer;
+    struct vkd3d_device_memory_allocation device_allocation;
+    VkDeviceAddress gpu_va;
+
+    struct d3d12_fence *fence;
+    uint64_t fence_value;
+
+    pthread_mutex_t mutex;
+    /* Offsets keep increasing across laps, so head - tail is the space in use. */
+    uint64_t head;
+    uint64_t tail;
+    uint64_t flush_offset;
+    uint64_t peak_usage;
+
+    struct vkd3d_upload_ring_frame frames[VKD3D_UPLOAD_RING_MAX_FRAME_COUNT];
+    uint32_t frame_head;
+    uint32_t frame_count;
+};
+
+HRESULT vkd3d_upload_ring_create(struct d3d12_device *device, VkDeviceSize size,
+        struct vkd3d_upload_ring **ring);
+void vkd3d_upload_ring_destroy(struct vkd3d_upload_ring *ring);
+HRESULT vkd3d_upload_ring_allocate(struct vkd3d_upload_ring *ring, VkDeviceSize size,
+        VkDeviceSize alignment, D3D12_VK_UPLOAD_RING_ALLOCATION *allocation);
+HRESULT vkd3d_upload_ring_flush(struct vkd3d_upload_ring *ring, ID3D12GraphicsCommandList *command_list);
+HRESULT vkd3d_upload_ring_retire_frame(struct vkd3d_upload_ring *ring, ID3D12CommandQueue *queue);
+
 /* ID3D12Device */
 typedef ID3D12Device9 d3d12_device_iface;
 
 struct vkd3d_descriptor_qa_global_info;
 struct vkd3d_descriptor_qa_heap_buffer_data;
 
-/* ID3D12DeviceExt */
-typedef ID3D12DeviceExt d3d12_device_vkd3d_ext_iface;
+/* ID3D12DeviceExt1 */
+typedef ID3D12DeviceExt1 d3d12_device_vkd3d_ext_iface;
 
 struct d3d12_device
 {
@@ -2912,6 +4651,7 @@ struct d3d12_device
 
     pthread_mutex_t mutex;
     struct vkd3d_render_pass_cache render_pass_cache;
+    struct vkd3d_command_object_cache command_object_cache;
 
     VkPhysicalDeviceMemoryProperties memory_properties;
 
@@ -2921,6 +4661,8 @@ struct d3d12_device
     struct vkd3d_queue_family_info *queue_families[VKD3D_QUEUE_FAMILY_COUNT];
     uint32_t queue_family_indices[VKD3D_QUEUE_FAMILY_COUNT];
     uint32_t queue_family_count;
+    /* Includes the internal transfer family, which images never need */
+    uint32_t buffer_queue_family_count;
     uint32_t unique_queue_mask;
 
     struct vkd3d_instance *vkd3d_instance;
@@ -2933,14 +4675,22 @@ struct d3d12_device
 
     struct vkd3d_memory_allocator memory_allocator;
 
-    struct vkd3d_scratch_buffer scratch_buffers[VKD3D_SCRATCH_BUFFER_COUNT];
-    size_t scratch_buffer_count;
+    struct vkd3d_scratch_pool scratch_pools[VKD3D_SCRATCH_BUFFER_SIZE_CLASS_COUNT];
+    VkDeviceSize scratch_pool_size;
+    struct vkd3d_scratch_pool_stats scratch_pool_stats;
 
     struct vkd3d_query_pool query_pools[VKD3D_VIRTUAL_QUERY_POOL_COUNT];
     size_t query_pool_count;
+    uint32_t query_pool_sizes[VKD3D_VIRTUAL_QUERY_TYPE_COUNT];
+    struct vkd3d_query_pool_stats query_pool_stats;
 
-    struct vkd3d_cached_command_allocator cached_command_allocators[VKD3D_CACHED_COMMAND_ALLOCATOR_COUNT];
-    size_t cached_command_allocator_count;
+    /* Indexed like queue_family_indices. Families shared by several entries use the first one. */
+    struct vkd3d_command_pool_cache command_pool_caches[VKD3D_QUEUE_FAMILY_COUNT];
+
+    struct vkd3d_cached_descriptor_pools cached_descriptor_pools[VKD3D_DESCRIPTOR_POOL_TYPE_COUNT];
+    uint32_t descriptor_pool_create_count;
+
+    struct vkd3d_cached_bundle_chunks cached_bundle_chunks;
 
     uint32_t *descriptor_heap_gpu_vas;
     size_t descriptor_heap_gpu_va_count;
@@ -2957,8 +4707,23 @@ struct d3d12_device
     struct vkd3d_memory_info memory_info;
     struct vkd3d_meta_ops meta_ops;
     struct vkd3d_view_map sampler_map;
+    struct vkd3d_memory_requirements_cache memory_requirements_cache;
+    struct vkd3d_format_support_cache format_support_cache;
+    struct vkd3d_root_signature_cache root_signature_cache;
+    struct vkd3d_shader_code_cache shader_code_cache;
+    struct vkd3d_disk_cache disk_cache;
+    struct vkd3d_pipeline_warmup pipeline_warmup;
+    struct vkd3d_resource_recycle_pool resource_recycle_pool;
     struct vkd3d_sampler_state sampler_state;
     struct vkd3d_shader_debug_ring debug_ring;
+    struct vkd3d_event_profiler event_profiler;
+    struct vkd3d_fence_worker fence_worker;
+    struct vkd3d_sparse_worker sparse_worker;
+    struct vkd3d_command_list_translator command_list_translator;
+    struct vkd3d_pipeline_compile_worker pipeline_compile_worker;
+    struct vkd3d_task_pool task_pool;
+    struct vkd3d_residency_tracker residency_tracker;
+    struct vkd3d_transfer_offload_queue transfer_offload_queue;
 #ifdef VKD3D_ENABLE_DESCRIPTOR_QA
     struct vkd3d_descriptor_qa_global_info *descriptor_qa_global_info;
 #endif
@@ -2970,6 +4735,8 @@ HRESULT d3d12_device_create(struct vkd3d_instance *instance,
         const struct vkd3d_device_create_info *create_info, struct d3d12_device **device);
 struct vkd3d_queue_family_info *d3d12_device_get_vkd3d_queue_family(struct d3d12_device *device,
         D3D12_COMMAND_LIST_TYPE type);
+HRESULT d3d12_device_get_clock_calibration(struct d3d12_device *device,
+        uint64_t *gpu_timestamp, uint64_t *cpu_timestamp);
 struct vkd3d_queue *d3d12_device_allocate_vkd3d_queue(struct d3d12_device *device,
         struct vkd3d_queue_family_info *queue_family);
 void d3d12_device_unmap_vkd3d_queue(struct d3d12_device *device,
@@ -3004,11 +4771,16 @@ static inline struct d3d12_device *impl_from_ID3D12Device(d3d12_device_iface *if
 
 bool d3d12_device_validate_shader_meta(struct d3d12_device *device, const struct vkd3d_shader_meta *meta);
 
-HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, VkDeviceSize min_size, struct vkd3d_scratch_buffer *scratch);
+HRESULT d3d12_device_get_scratch_buffer(struct d3d12_device *device, VkDeviceSize min_size,
+        uint32_t memory_types, struct vkd3d_scratch_buffer *scratch);
 void d3d12_device_return_scratch_buffer(struct d3d12_device *device, const struct vkd3d_scratch_buffer *scratch);
 
-HRESULT d3d12_device_get_query_pool(struct d3d12_device *device, uint32_t type_index, struct vkd3d_query_pool *pool);
+HRESULT d3d12_device_get_query_pool(struct d3d12_device *device, uint32_t type_index,
+        bool grow, struct vkd3d_query_pool *pool);
 void d3d12_device_return_query_pool(struct d3d12_device *device, const struct vkd3d_query_pool *pool);
+VkCommandPool d3d12_device_get_cached_command_pool(struct d3d12_device *device, uint32_t vk_family_index);
+bool d3d12_device_return_command_pool(struct d3d12_device *device, uint32_t vk_family_index,
+        VkCommandPool vk_command_pool, bool trim);
 
 uint64_t d3d12_device_get_descriptor_heap_gpu_va(struct d3d12_device *device);
 void d3d12_device_return_descriptor_heap_gpu_va(struct d3d12_device *device, uint64_t va);
@@ -3089,6 +4861,23 @@ static inline bool d3d12_device_use_ssbo_root_descriptors(struct d3d12_device *d
             d3d12_device_get_ssbo_alignment(device) <= 4;
 }
 
+static inline bool d3d12_device_use_synchronization2(const struct d3d12_device *device)
+{
+    return device->device_info.synchronization2_features.synchronization2;
+}
+
+static inline bool d3d12_device_use_dynamic_rendering(const struct d3d12_device *device)
+{
+    return device->device_info.dynamic_rendering_features.dynamicRendering;
+}
+
+/* Virtual query pools are reset on the host before they are handed out,
+ * so queries allocated from them need no reset in the command buffer. */
+static inline bool d3d12_device_use_host_query_reset(const struct d3d12_device *device)
+{
+    return device->device_info.host_query_reset_features.hostQueryReset;
+}
+
 bool d3d12_device_supports_variable_shading_rate_tier_1(struct d3d12_device *device);
 bool d3d12_device_supports_ray_tracing_tier_1_0(const struct d3d12_device *device);
 
@@ -3151,19 +4940,29 @@ struct d3d12_state_object
     D3D12_STATE_OBJECT_FLAGS flags;
     struct d3d12_device *device;
 
-    /* Could potentially be a hashmap. */
     struct d3d12_state_object_identifier *exports;
     size_t exports_size;
     size_t exports_count;
+    /* Maps both mangled and plain export names to an index into exports. */
+    struct hash_map export_map;
 
     struct vkd3d_shader_library_entry_point *entry_points;
     size_t entry_points_count;
+    /* Maps entry point names to an index into entry_points. */
+    struct hash_map entry_point_map;
     size_t stages_count;
     /* Normally stages_count == entry_points_count, but entry_points is the entry points we
      * export externally, and stages_count matches pStages[] size for purposes of index fixups. */
 
     VkPipeline pipeline;
 
+    /* With ALLOW_STATE_OBJECT_ADDITIONS, pipeline is linked from this library, and additions
+     * link against it as well. The configuration is kept around for additions to inherit. */
+    VkPipeline pipeline_library;
+    D3D12_RAYTRACING_SHADER_CONFIG shader_config;
+    D3D12_RAYTRACING_PIPELINE_CONFIG1 pipeline_config;
+    ID3D12RootSignature *global_root_signature;
+
     struct
     {
         VkDescriptorSetLayout set_layout;
@@ -3184,6 +4983,8 @@ struct d3d12_state_object
 
 HRESULT d3d12_state_object_create(struct d3d12_device *device, const D3D12_STATE_OBJECT_DESC *desc,
         struct d3d12_state_object **object);
+HRESULT d3d12_state_object_add(struct d3d12_device *device, const D3D12_STATE_OBJECT_DESC *desc,
+        struct d3d12_state_object *parent, struct d3d12_state_object **object);
 
 static inline struct d3d12_state_object *impl_from_ID3D12StateObject(ID3D12StateObject *iface)
 {
@@ -3238,9 +5039,19 @@ static inline bool vkd3d_format_is_compressed(const struct vkd3d_format *format)
     return format->block_byte_count != 1;
 }
 
+enum vkd3d_format_copy_mode
+{
+    VKD3D_FORMAT_COPY_MODE_DEFAULT = 0,
+    /* Destination is write-combined memory, bypass the cache */
+    VKD3D_FORMAT_COPY_MODE_STREAMING_WRITE,
+    /* Source is mapped memory which is not host-cached */
+    VKD3D_FORMAT_COPY_MODE_STREAMING_READ,
+};
+
 void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *src,
         unsigned int src_row_pitch, unsigned int src_slice_pitch, uint8_t *dst, unsigned int dst_row_pitch,
-        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d);
+        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d,
+        enum vkd3d_format_copy_mode mode);
 
 const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
         DXGI_FORMAT dxgi_format, bool depth_stencil);
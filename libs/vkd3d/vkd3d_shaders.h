@@ -31,6 +31,7 @@ enum vkd3d_meta_copy_mode
 #include <cs_clear_uav_buffer_float.h>
 #include <cs_clear_uav_buffer_uint.h>
 #include <cs_clear_uav_buffer_raw.h>
+#include <cs_clear_uav_buffer_raw_batch.h>
 #include <cs_clear_uav_image_1d_array_float.h>
 #include <cs_clear_uav_image_1d_array_uint.h>
 #include <cs_clear_uav_image_1d_float.h>
@@ -41,8 +42,11 @@ enum vkd3d_meta_copy_mode
 #include <cs_clear_uav_image_2d_uint.h>
 #include <cs_clear_uav_image_3d_float.h>
 #include <cs_clear_uav_image_3d_uint.h>
+#include <cs_execute_indirect_dispatch.h>
+#include <cs_execute_indirect_patch.h>
 #include <cs_predicate_command.h>
 #include <cs_resolve_binary_queries.h>
+#include <cs_resolve_binary_queries_batch.h>
 #include <cs_resolve_predicate.h>
 #include <cs_resolve_query.h>
 #include <vs_fullscreen_layer.h>
@@ -44,6 +44,7 @@ VK_INSTANCE_PFN(vkGetPhysicalDeviceFormatProperties)
 VK_INSTANCE_PFN(vkGetPhysicalDeviceFormatProperties2)
 VK_INSTANCE_PFN(vkGetPhysicalDeviceImageFormatProperties)
 VK_INSTANCE_PFN(vkGetPhysicalDeviceMemoryProperties)
+VK_INSTANCE_PFN(vkGetPhysicalDeviceMemoryProperties2)
 VK_INSTANCE_PFN(vkGetPhysicalDeviceProperties)
 VK_INSTANCE_PFN(vkGetPhysicalDeviceQueueFamilyProperties)
 VK_INSTANCE_PFN(vkGetPhysicalDeviceSparseImageFormatProperties)
@@ -190,6 +191,13 @@ VK_DEVICE_EXT_PFN(vkCmdDrawIndexedIndirectCountKHR)
 /* VK_KHR_push_descriptor */
 VK_DEVICE_EXT_PFN(vkCmdPushDescriptorSetKHR)
 
+/* VK_KHR_deferred_host_operations */
+VK_DEVICE_EXT_PFN(vkCreateDeferredOperationKHR)
+VK_DEVICE_EXT_PFN(vkDestroyDeferredOperationKHR)
+VK_DEVICE_EXT_PFN(vkGetDeferredOperationMaxConcurrencyKHR)
+VK_DEVICE_EXT_PFN(vkGetDeferredOperationResultKHR)
+VK_DEVICE_EXT_PFN(vkDeferredOperationJoinKHR)
+
 /* VK_KHR_ray_tracing_pipeline */
 VK_DEVICE_EXT_PFN(vkCreateRayTracingPipelinesKHR)
 VK_DEVICE_EXT_PFN(vkGetRayTracingShaderGroupHandlesKHR)
@@ -217,6 +225,10 @@ VK_DEVICE_EXT_PFN(vkCmdEndRenderPass2KHR)
 VK_DEVICE_EXT_PFN(vkCmdNextSubpass2KHR)
 VK_DEVICE_EXT_PFN(vkCreateRenderPass2KHR)
 
+/* VK_KHR_dynamic_rendering */
+VK_DEVICE_EXT_PFN(vkCmdBeginRenderingKHR)
+VK_DEVICE_EXT_PFN(vkCmdEndRenderingKHR)
+
 /* VK_KHR_bind_memory2 */
 VK_DEVICE_EXT_PFN(vkBindBufferMemory2KHR)
 VK_DEVICE_EXT_PFN(vkBindImageMemory2KHR)
@@ -229,6 +241,10 @@ VK_DEVICE_EXT_PFN(vkCmdCopyImage2KHR)
 VK_DEVICE_EXT_PFN(vkCmdCopyImageToBuffer2KHR)
 VK_DEVICE_EXT_PFN(vkCmdResolveImage2KHR)
 
+/* VK_KHR_synchronization2 */
+VK_DEVICE_EXT_PFN(vkCmdPipelineBarrier2KHR)
+VK_DEVICE_EXT_PFN(vkQueueSubmit2KHR)
+
 /* VK_EXT_calibrated_timestamps */
 VK_DEVICE_EXT_PFN(vkGetCalibratedTimestampsEXT)
 VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)
@@ -256,9 +272,21 @@ VK_DEVICE_EXT_PFN(vkCmdSetPrimitiveTopologyEXT)
 VK_DEVICE_EXT_PFN(vkCmdSetScissorWithCountEXT)
 VK_DEVICE_EXT_PFN(vkCmdSetViewportWithCountEXT)
 
+/* VK_EXT_extended_dynamic_state2 */
+VK_DEVICE_EXT_PFN(vkCmdSetPatchControlPointsEXT)
+
+/* VK_EXT_vertex_input_dynamic_state */
+VK_DEVICE_EXT_PFN(vkCmdSetVertexInputEXT)
+
+/* VK_EXT_pageable_device_local_memory */
+VK_DEVICE_EXT_PFN(vkSetDeviceMemoryPriorityEXT)
+
 /* VK_EXT_external_memory_host */
 VK_DEVICE_EXT_PFN(vkGetMemoryHostPointerPropertiesEXT)
 
+/* VK_EXT_host_query_reset */
+VK_DEVICE_EXT_PFN(vkResetQueryPoolEXT)
+
 /* VK_KHR_surface */
 VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceSurfacePresentModesKHR)
 VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceSurfaceSupportKHR)
@@ -279,9 +307,18 @@ VK_DEVICE_EXT_PFN(vkGetSwapchainImagesKHR)
 VK_DEVICE_EXT_PFN(vkAcquireNextImageKHR)
 VK_DEVICE_EXT_PFN(vkQueuePresentKHR)
 
+/* VK_KHR_present_wait */
+VK_DEVICE_EXT_PFN(vkWaitForPresentKHR)
+
 /* VK_AMD_buffer_marker */
 VK_DEVICE_EXT_PFN(vkCmdWriteBufferMarkerAMD)
 
+/* VK_NV_device_generated_commands */
+VK_DEVICE_EXT_PFN(vkCreateIndirectCommandsLayoutNV)
+VK_DEVICE_EXT_PFN(vkDestroyIndirectCommandsLayoutNV)
+VK_DEVICE_EXT_PFN(vkGetGeneratedCommandsMemoryRequirementsNV)
+VK_DEVICE_EXT_PFN(vkCmdExecuteGeneratedCommandsNV)
+
 /* VK_NVX_binary_import */
 VK_DEVICE_EXT_PFN(vkCreateCuModuleNVX)
 VK_DEVICE_EXT_PFN(vkCreateCuFunctionNVX)
@@ -18,13 +18,17 @@
 
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
 
+#include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 
 #include "vkd3d_common.h"
+#include "vkd3d_atomic.h"
+#include "vkd3d_threads.h"
 #include "vkd3d_shader.h"
 
 static bool read_shader(struct vkd3d_shader_code *shader, const char *filename)
@@ -103,6 +107,11 @@ static void print_usage(const char *program_name)
     for (i = 0; i < ARRAY_SIZE(compiler_options); ++i)
         fprintf(stderr, " [%s]", compiler_options[i].name);
     fprintf(stderr, " [-o <out_spirv_filename>] <dxbc_filename>\n");
+    fprintf(stderr, "       %s", program_name);
+    for (i = 0; i < ARRAY_SIZE(compiler_options); ++i)
+        fprintf(stderr, " [%s]", compiler_options[i].name);
+    fprintf(stderr, " [--threads <count>] [--csv <filename>] [--json <filename>] [--output-dir <dir>]"
+            " --batch <directory_or_manifest>\n");
 }
 
 struct options
@@ -110,6 +119,12 @@ struct options
     const char *filename;
     const char *output_filename;
     unsigned int compiler_options;
+
+    const char *batch_path;
+    const char *csv_filename;
+    const char *json_filename;
+    const char *output_dir;
+    unsigned int thread_count;
 };
 
 static bool parse_command_line(int argc, char **argv, struct options *options)
@@ -121,14 +136,30 @@ static bool parse_command_line(int argc, char **argv, struct options *options)
         return false;
 
     memset(options, 0, sizeof(*options));
+    options->thread_count = 1;
 
-    for (i = 1; i < argc - 1; ++i)
+    for (i = 1; i < argc; ++i)
     {
-        if (!strcmp(argv[i], "-o"))
+        if (!strcmp(argv[i], "-o") || !strcmp(argv[i], "--batch") || !strcmp(argv[i], "--csv") ||
+                !strcmp(argv[i], "--json") || !strcmp(argv[i], "--output-dir") || !strcmp(argv[i], "--threads"))
         {
-            if (i + 1 >= argc - 1)
+            if (i + 1 >= argc)
                 return false;
-            options->output_filename = argv[++i];
+
+            if (!strcmp(argv[i], "-o"))
+                options->output_filename = argv[i + 1];
+            else if (!strcmp(argv[i], "--batch"))
+                options->batch_path = argv[i + 1];
+            else if (!strcmp(argv[i], "--csv"))
+                options->csv_filename = argv[i + 1];
+            else if (!strcmp(argv[i], "--json"))
+                options->json_filename = argv[i + 1];
+            else if (!strcmp(argv[i], "--output-dir"))
+                options->output_dir = argv[i + 1];
+            else if (!(options->thread_count = strtoul(argv[i + 1], NULL, 0)))
+                return false;
+
+            ++i;
             continue;
         }
 
@@ -140,14 +171,465 @@ static bool parse_command_line(int argc, char **argv, struct options *options)
                 break;
             }
         }
-        if (j == ARRAY_SIZE(compiler_options))
+        if (j < ARRAY_SIZE(compiler_options))
+            continue;
+
+        /* The shader filename is the only positional argument. */
+        if (options->filename || argv[i][0] == '-')
             return false;
+        options->filename = argv[i];
     }
 
-    options->filename = argv[argc - 1];
+    if (options->batch_path)
+        return !options->filename && !options->output_filename;
+    return !!options->filename;
+}
+
+static bool has_suffix(const char *str, const char *suffix)
+{
+    size_t str_len = strlen(str);
+    size_t suffix_len = strlen(suffix);
+    return str_len >= suffix_len && !strcmp(str + str_len - suffix_len, suffix);
+}
+
+/* Reads the program type from the SHDR, SHEX or DXIL chunk. DXIL has to be
+ * compiled against a shader interface for a specific stage. */
+static VkShaderStageFlagBits get_shader_stage(const struct vkd3d_shader_code *shader)
+{
+    const uint32_t *data = shader->code;
+    uint32_t chunk_count, offset, i;
+    const char *chunk;
+
+    if (shader->size < 8 * sizeof(uint32_t) || memcmp(shader->code, "DXBC", 4))
+        return VK_SHADER_STAGE_ALL;
+
+    chunk_count = data[7];
+    if (chunk_count > (shader->size - 8 * sizeof(uint32_t)) / sizeof(uint32_t))
+        return VK_SHADER_STAGE_ALL;
+
+    for (i = 0; i < chunk_count; i++)
+    {
+        offset = data[8 + i];
+        if (offset > shader->size || shader->size - offset < 3 * sizeof(uint32_t))
+            continue;
+
+        chunk = (const char *)shader->code + offset;
+        if (memcmp(chunk, "SHDR", 4) && memcmp(chunk, "SHEX", 4) && memcmp(chunk, "DXIL", 4))
+            continue;
+
+        switch (((const uint32_t *)chunk)[2] >> 16)
+        {
+            case 0: return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case 1: return VK_SHADER_STAGE_VERTEX_BIT;
+            case 2: return VK_SHADER_STAGE_GEOMETRY_BIT;
+            case 3: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+            case 4: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+            case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+            default: return VK_SHADER_STAGE_ALL;
+        }
+    }
+
+    return VK_SHADER_STAGE_ALL;
+}
+
+struct batch_entry
+{
+    char *filename;
+    VkShaderStageFlagBits stage;
+    size_t input_size;
+    size_t output_size;
+    uint64_t compile_time_ns;
+    int result;
+};
+
+struct batch
+{
+    const struct options *options;
+
+    struct batch_entry *entries;
+    size_t entries_size;
+    size_t entry_count;
+
+    uint32_t next_entry;
+
+    struct vkd3d_shader_resource_binding bindings[4 * 8];
+    struct vkd3d_shader_interface_info dxil_interface;
+};
+
+static bool batch_add_file(struct batch *batch, const char *filename)
+{
+    struct batch_entry *entry;
+
+    /* RT libraries need export names and local root signatures, skip them. */
+    if (has_suffix(filename, ".lib.dxil"))
+        return true;
+
+    if (!vkd3d_array_reserve((void **)&batch->entries, &batch->entries_size,
+            batch->entry_count + 1, sizeof(*batch->entries)))
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return false;
+    }
+
+    entry = &batch->entries[batch->entry_count];
+    memset(entry, 0, sizeof(*entry));
+    if (!(entry->filename = malloc(strlen(filename) + 1)))
+    {
+        fprintf(stderr, "Out of memory.\n");
+        return false;
+    }
+    strcpy(entry->filename, filename);
+    batch->entry_count++;
     return true;
 }
 
+static bool batch_add_directory(struct batch *batch, const char *path)
+{
+    struct dirent *dirent;
+    char filename[4096];
+    bool ret = true;
+    DIR *dir;
+
+    if (!(dir = opendir(path)))
+    {
+        fprintf(stderr, "Cannot open directory: '%s'.\n", path);
+        return false;
+    }
+
+    while (ret && (dirent = readdir(dir)))
+    {
+        if (!has_suffix(dirent->d_name, ".dxbc") && !has_suffix(dirent->d_name, ".dxil"))
+            continue;
+
+        snprintf(filename, sizeof(filename), "%s/%s", path, dirent->d_name);
+        ret = batch_add_file(batch, filename);
+    }
+
+    closedir(dir);
+    return ret;
+}
+
+static bool batch_add_manifest(struct batch *batch, const char *path)
+{
+    char line[4096];
+    bool ret = true;
+    size_t len;
+    FILE *f;
+
+    if (!(f = fopen(path, "r")))
+    {
+        fprintf(stderr, "Cannot open manifest for reading: '%s'.\n", path);
+        return false;
+    }
+
+    while (ret && fgets(line, sizeof(line), f))
+    {
+        len = strlen(line);
+        while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+            line[--len] = '\0';
+
+        if (len && line[0] != '#')
+            ret = batch_add_file(batch, line);
+    }
+
+    fclose(f);
+    return ret;
+}
+
+static int compare_entry_filename(const void *a, const void *b)
+{
+    const struct batch_entry *entry_a = a, *entry_b = b;
+    return strcmp(entry_a->filename, entry_b->filename);
+}
+
+static void batch_init_dxil_interface(struct batch *batch)
+{
+    struct vkd3d_shader_resource_binding *binding;
+    unsigned int i;
+
+    /* There is no root signature to compile against, so map every register
+     * space of every descriptor type into a bindless heap. This exercises the
+     * same code paths as the device does by default. */
+    for (i = 0; i < ARRAY_SIZE(batch->bindings); i++)
+    {
+        binding = &batch->bindings[i];
+        memset(binding, 0, sizeof(*binding));
+        binding->type = VKD3D_SHADER_DESCRIPTOR_TYPE_CBV + (i & 3);
+        binding->register_space = i >> 2;
+        binding->register_count = UINT_MAX;
+        binding->shader_visibility = VKD3D_SHADER_VISIBILITY_ALL;
+        binding->flags = VKD3D_SHADER_BINDING_FLAG_BINDLESS |
+                VKD3D_SHADER_BINDING_FLAG_BUFFER | VKD3D_SHADER_BINDING_FLAG_IMAGE;
+        binding->binding.set = i & 3;
+        binding->binding.binding = 0;
+    }
+
+    memset(&batch->dxil_interface, 0, sizeof(batch->dxil_interface));
+    batch->dxil_interface.min_ssbo_alignment = 16;
+    batch->dxil_interface.descriptor_tables.count = 1;
+    batch->dxil_interface.bindings = batch->bindings;
+    batch->dxil_interface.binding_count = ARRAY_SIZE(batch->bindings);
+}
+
+static void batch_compile_entry(struct batch *batch, struct batch_entry *entry)
+{
+    struct vkd3d_shader_interface_info dxil_interface;
+    struct vkd3d_shader_code dxbc, spirv;
+    char filename[4096];
+    const char *name;
+    uint64_t start;
+
+    if (!read_shader(&dxbc, entry->filename))
+    {
+        entry->result = VKD3D_ERROR;
+        return;
+    }
+
+    entry->input_size = dxbc.size;
+    entry->stage = get_shader_stage(&dxbc);
+
+    memset(&spirv, 0, sizeof(spirv));
+    start = vkd3d_profiling_get_tick_count();
+    if (has_suffix(entry->filename, ".dxil"))
+    {
+        dxil_interface = batch->dxil_interface;
+        dxil_interface.stage = entry->stage;
+        entry->result = vkd3d_shader_compile_dxbc(&dxbc, &spirv,
+                batch->options->compiler_options, &dxil_interface, NULL);
+    }
+    else
+    {
+        entry->result = vkd3d_shader_compile_dxbc(&dxbc, &spirv,
+                batch->options->compiler_options, NULL, NULL);
+    }
+    entry->compile_time_ns = vkd3d_profiling_get_tick_count() - start;
+    vkd3d_shader_free_shader_code(&dxbc);
+
+    if (entry->result < 0)
+        return;
+
+    entry->output_size = spirv.size;
+
+    if (batch->options->output_dir)
+    {
+        name = strrchr(entry->filename, '/');
+        name = name ? name + 1 : entry->filename;
+        snprintf(filename, sizeof(filename), "%s/%s.spv", batch->options->output_dir, name);
+        write_shader(&spirv, filename);
+    }
+
+    vkd3d_shader_free_shader_code(&spirv);
+}
+
+static void *batch_thread_main(void *userdata)
+{
+    struct batch *batch = userdata;
+    uint32_t index;
+
+    while ((index = vkd3d_atomic_uint32_increment(&batch->next_entry, vkd3d_memory_order_relaxed) - 1) <
+            batch->entry_count)
+    {
+        batch_compile_entry(batch, &batch->entries[index]);
+    }
+
+    return NULL;
+}
+
+static int compare_uint64(const void *a, const void *b)
+{
+    uint64_t value_a = *(const uint64_t *)a, value_b = *(const uint64_t *)b;
+    return value_a < value_b ? -1 : value_a > value_b ? 1 : 0;
+}
+
+static uint64_t percentile(const uint64_t *sorted, size_t count, unsigned int pct)
+{
+    size_t rank;
+
+    if (!count)
+        return 0;
+
+    /* Nearest-rank method. */
+    rank = (count * pct + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+static void write_json_string(FILE *f, const char *str)
+{
+    fputc('"', f);
+    for (; *str; str++)
+    {
+        if (*str == '"' || *str == '\\')
+            fputc('\\', f);
+        fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+static void batch_write_csv(const struct batch *batch, const char *filename)
+{
+    const struct batch_entry *entry;
+    FILE *f;
+    size_t i;
+
+    if (!(f = fopen(filename, "w")))
+    {
+        fprintf(stderr, "Cannot open file for writing: '%s'.\n", filename);
+        return;
+    }
+
+    fprintf(f, "filename,stage,result,input_size,output_size,compile_time_us\n");
+    for (i = 0; i < batch->entry_count; i++)
+    {
+        entry = &batch->entries[i];
+        fprintf(f, "\"%s\",%#x,%d,%zu,%zu,%.3f\n", entry->filename, entry->stage, entry->result,
+                entry->input_size, entry->output_size, entry->compile_time_ns / 1000.0);
+    }
+
+    fclose(f);
+}
+
+static void batch_write_json(const struct batch *batch, const char *filename,
+        const uint64_t *sorted, size_t success_count, uint64_t wall_time_ns)
+{
+    static const unsigned int percentiles[] = { 50, 90, 99, 100 };
+    const struct batch_entry *entry;
+    FILE *f;
+    size_t i;
+
+    if (!(f = fopen(filename, "w")))
+    {
+        fprintf(stderr, "Cannot open file for writing: '%s'.\n", filename);
+        return;
+    }
+
+    fprintf(f, "{\n  \"threads\": %u,\n  \"shaders\": %zu,\n  \"failures\": %zu,\n  \"wall_time_us\": %.3f,\n",
+            batch->options->thread_count, batch->entry_count, batch->entry_count - success_count,
+            wall_time_ns / 1000.0);
+    fprintf(f, "  \"compile_time_us\": {");
+    for (i = 0; i < ARRAY_SIZE(percentiles); i++)
+    {
+        fprintf(f, "%s\"p%u\": %.3f", i ? ", " : " ", percentiles[i],
+                percentile(sorted, success_count, percentiles[i]) / 1000.0);
+    }
+    fprintf(f, " },\n  \"results\": [\n");
+
+    for (i = 0; i < batch->entry_count; i++)
+    {
+        entry = &batch->entries[i];
+        fprintf(f, "    { \"filename\": ");
+        write_json_string(f, entry->filename);
+        fprintf(f, ", \"stage\": %u, \"result\": %d, \"input_size\": %zu, \"output_size\": %zu, "
+                "\"compile_time_us\": %.3f }%s\n", entry->stage, entry->result,
+                entry->input_size, entry->output_size, entry->compile_time_ns / 1000.0,
+                i + 1 < batch->entry_count ? "," : "");
+    }
+
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+}
+
+static int run_batch(const struct options *options)
+{
+    size_t success_count = 0, input_size = 0, output_size = 0;
+    uint64_t start, wall_time_ns, total_time_ns = 0;
+    pthread_t *threads = NULL;
+    uint64_t *sorted = NULL;
+    unsigned int i, j;
+    struct batch batch;
+    struct stat st;
+    bool ret;
+
+    memset(&batch, 0, sizeof(batch));
+    batch.options = options;
+    batch_init_dxil_interface(&batch);
+
+    if (stat(options->batch_path, &st) == -1)
+    {
+        fprintf(stderr, "Could not stat file: '%s'.\n", options->batch_path);
+        return 1;
+    }
+
+    if (S_ISDIR(st.st_mode))
+        ret = batch_add_directory(&batch, options->batch_path);
+    else
+        ret = batch_add_manifest(&batch, options->batch_path);
+    if (!ret)
+        goto done;
+
+    /* Keep reports stable across runs regardless of readdir order. */
+    qsort(batch.entries, batch.entry_count, sizeof(*batch.entries), compare_entry_filename);
+
+    if (!(threads = calloc(options->thread_count, sizeof(*threads))) ||
+            !(sorted = calloc(batch.entry_count + 1, sizeof(*sorted))))
+    {
+        fprintf(stderr, "Out of memory.\n");
+        ret = false;
+        goto done;
+    }
+
+    start = vkd3d_profiling_get_tick_count();
+    for (i = 0; i < options->thread_count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, batch_thread_main, &batch))
+        {
+            fprintf(stderr, "Failed to create thread.\n");
+            break;
+        }
+    }
+
+    /* If thread creation failed, the calling thread picks up the remaining work. */
+    if (!i)
+        batch_thread_main(&batch);
+    for (j = 0; j < i; j++)
+        pthread_join(threads[j], NULL);
+    wall_time_ns = vkd3d_profiling_get_tick_count() - start;
+
+    for (i = 0; i < batch.entry_count; i++)
+    {
+        const struct batch_entry *entry = &batch.entries[i];
+
+        input_size += entry->input_size;
+        if (entry->result < 0)
+        {
+            fprintf(stderr, "Failed to compile '%s', ret %d.\n", entry->filename, entry->result);
+            continue;
+        }
+
+        output_size += entry->output_size;
+        total_time_ns += entry->compile_time_ns;
+        sorted[success_count++] = entry->compile_time_ns;
+    }
+
+    qsort(sorted, success_count, sizeof(*sorted), compare_uint64);
+
+    printf("Compiled %zu of %zu shaders on %u thread(s) in %.3f ms.\n",
+            success_count, batch.entry_count, options->thread_count, wall_time_ns / 1000000.0);
+    printf("Input %zu bytes, output %zu bytes.\n", input_size, output_size);
+    printf("Compile time (us): mean %.3f, p50 %.3f, p90 %.3f, p99 %.3f, max %.3f.\n",
+            success_count ? total_time_ns / 1000.0 / success_count : 0.0,
+            percentile(sorted, success_count, 50) / 1000.0,
+            percentile(sorted, success_count, 90) / 1000.0,
+            percentile(sorted, success_count, 99) / 1000.0,
+            percentile(sorted, success_count, 100) / 1000.0);
+    if (wall_time_ns)
+        printf("Throughput: %.1f shaders/s.\n", success_count * 1000000000.0 / wall_time_ns);
+
+    if (options->csv_filename)
+        batch_write_csv(&batch, options->csv_filename);
+    if (options->json_filename)
+        batch_write_json(&batch, options->json_filename, sorted, success_count, wall_time_ns);
+
+    ret = success_count == batch.entry_count;
+
+done:
+    for (i = 0; i < batch.entry_count; i++)
+        free(batch.entries[i].filename);
+    free(batch.entries);
+    free(threads);
+    free(sorted);
+    return ret ? 0 : 1;
+}
+
 int main(int argc, char **argv)
 {
     struct vkd3d_shader_code dxbc, spirv;
@@ -160,6 +642,9 @@ int main(int argc, char **argv)
         return 1;
     }
 
+    if (options.batch_path)
+        return run_batch(&options);
+
     if (!read_shader(&dxbc, options.filename))
     {
         fprintf(stderr, "Failed to read DXBC shader.\n");
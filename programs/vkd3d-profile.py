@@ -27,23 +27,54 @@ import os
 import argparse
 import collections
 import struct
+import time
 
-ProfileCase = collections.namedtuple('ProfileCase', 'name iterations ticks')
+ProfileCase = collections.namedtuple('ProfileCase', 'name iterations ticks ticks_max histogram')
+
+BLOCK_SIZE = 256
+HISTOGRAM_BUCKETS = 32
+NAME_OFFSET = 24 + 4 * HISTOGRAM_BUCKETS
+
+# Upper limits of each histogram bucket in ns, must match profiling.c.
+BUCKET_LIMITS = [round(100 * 10 ** (i / 5)) for i in range(HISTOGRAM_BUCKETS - 1)]
 
 
 def is_valid_block(block):
-    if len(block) != 64:
+    if len(block) != BLOCK_SIZE:
         return False
     ticks = struct.unpack('=Q', block[0:8])[0]
     iterations = struct.unpack('=Q', block[8:16])[0]
-    return ticks != 0 and iterations != 0 and block[16] != 0
+    return ticks != 0 and iterations != 0 and block[NAME_OFFSET] != 0
 
 
 def parse_block(block):
     ticks = struct.unpack('=Q', block[0:8])[0]
     iterations = struct.unpack('=Q', block[8:16])[0]
-    name = block[16:].split(b'\0', 1)[0].decode('ascii')
-    return ProfileCase(ticks = ticks, iterations = iterations, name = name)
+    ticks_max = struct.unpack('=Q', block[16:24])[0]
+    histogram = list(struct.unpack('={}I'.format(HISTOGRAM_BUCKETS), block[24:NAME_OFFSET]))
+    name = block[NAME_OFFSET:].split(b'\0', 1)[0].decode('ascii')
+    return ProfileCase(ticks = ticks, iterations = iterations, ticks_max = ticks_max, histogram = histogram, name = name)
+
+
+def histogram_percentile(block, percentile):
+    # Reports the upper limit of the bucket the percentile falls in, so this is an upper bound.
+    total = sum(block.histogram)
+    if total == 0:
+        return 0
+    target = total * percentile / 100.0
+    count = 0
+    for i, bucket in enumerate(block.histogram):
+        count += bucket
+        if count >= target:
+            return min(BUCKET_LIMITS[i], block.ticks_max) if i < len(BUCKET_LIMITS) else block.ticks_max
+    return block.ticks_max
+
+
+def format_bucket(i):
+    lower = BUCKET_LIMITS[i - 1] if i > 0 else 0
+    if i < len(BUCKET_LIMITS):
+        return '[{:.3f}, {:.3f}) us'.format(lower / 1000.0, BUCKET_LIMITS[i] / 1000.0)
+    return '[{:.3f}, inf) us'.format(lower / 1000.0)
 
 
 def filter_name(name, allow):
@@ -62,11 +93,83 @@ def find_record_by_name(blocks, name):
 
 
 def normalize_block(block, iter):
-    return ProfileCase(name = block.name, iterations = block.iterations / iter, ticks = block.ticks / iter)
+    return block._replace(iterations = block.iterations / iter, ticks = block.ticks / iter)
 
 
 def per_iteration_normalize(block):
-    return ProfileCase(name = block.name, iterations = block.iterations, ticks = block.ticks / block.iterations)
+    return block._replace(ticks = block.ticks / block.iterations)
+
+
+def read_blocks(path):
+    blocks = []
+    with open(path, 'rb') as f:
+        for block in iter(lambda: f.read(BLOCK_SIZE), b''):
+            if is_valid_block(block):
+                blocks.append(parse_block(block))
+    return blocks
+
+
+def delta_block(block, prev):
+    if prev is None:
+        return block
+    return ProfileCase(name = block.name, iterations = block.iterations - prev.iterations,
+                       ticks = block.ticks - prev.ticks, ticks_max = block.ticks_max,
+                       histogram = [a - b for a, b in zip(block.histogram, prev.histogram)])
+
+
+def live_view(args):
+    prev_blocks = {}
+    prev_time = None
+    csv = open(args.csv, 'w') if args.csv is not None else None
+
+    if csv is not None:
+        csv.write('time,name,calls,iterations,ticks_us\n')
+
+    try:
+        while True:
+            now = time.monotonic()
+            blocks = { block.name : block for block in read_blocks(args.profile) }
+
+            if prev_time is not None:
+                elapsed = now - prev_time
+                deltas = [delta_block(block, prev_blocks.get(name)) for name, block in blocks.items()]
+                deltas = [block for block in deltas if filter_name(block.name, args.name) and block.iterations != 0]
+
+                frames = 0
+                if args.frame_counter in blocks:
+                    divider = delta_block(blocks[args.frame_counter], prev_blocks.get(args.frame_counter))
+                    frames = sum(divider.histogram)
+
+                if args.sort == 'iterations':
+                    deltas.sort(reverse = True, key = lambda a: a.iterations)
+                else:
+                    deltas.sort(reverse = True, key = lambda a: a.ticks)
+
+                if sys.stdout.isatty():
+                    print('\033[H\033[J', end = '')
+
+                print('Interval {:.2f} s, {:.1f} frames/s'.format(elapsed, frames / elapsed))
+                print('{:<48} {:>12} {:>14} {:>12} {:>12}'.format('Region', 'Calls/s', 'Iterations/s', 'us/s', 'us/frame'))
+                for block in deltas[:args.top]:
+                    calls = sum(block.histogram)
+                    per_frame = '{:12.3f}'.format(block.ticks / 1000.0 / frames) if frames != 0 else '{:>12}'.format('-')
+                    print('{:<48} {:12.1f} {:14.1f} {:12.3f} {}'.format(block.name[:48],
+                          calls / elapsed, block.iterations / elapsed, block.ticks / 1000.0 / elapsed, per_frame))
+
+                if csv is not None:
+                    for block in deltas:
+                        csv.write('{:.3f},{},{},{},{:.3f}\n'.format(now, block.name, sum(block.histogram),
+                                  block.iterations, block.ticks / 1000.0))
+                    csv.flush()
+
+            prev_blocks = blocks
+            prev_time = now
+            time.sleep(args.live)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if csv is not None:
+            csv.close()
 
 
 def main():
@@ -74,18 +177,23 @@ def main():
     parser.add_argument('--divider', type = str, help = 'Represent data in terms of count per divider. Divider is another counter name.')
     parser.add_argument('--per-iteration', action = 'store_true', help = 'Represent ticks in terms of ticks / iteration. Cannot be used with --divider.')
     parser.add_argument('--name', nargs = '+', type = str, help = 'Only display data for certain counters.')
-    parser.add_argument('--sort', type = str, default = 'none', help = 'Sorts input data according to "iterations" or "ticks".')
+    parser.add_argument('--sort', type = str, default = 'none', help = 'Sorts input data according to "iterations", "ticks", "max" or "p99".')
+    parser.add_argument('--histogram', action = 'store_true', help = 'Print the full latency histogram of every counter.')
+    parser.add_argument('--live', type = float, help = 'Sample the profile every LIVE seconds and show per-interval deltas of a running process.')
+    parser.add_argument('--top', type = int, default = 20, help = 'Number of regions to show in live mode.')
+    parser.add_argument('--frame-counter', type = str, default = 'Present', help = 'Counter which is hit once per frame, for per-frame numbers in live mode.')
+    parser.add_argument('--csv', type = str, help = 'In live mode, also log per-interval deltas of all regions to a CSV file.')
     parser.add_argument('profile', help = 'The profile binary blob.')
 
     args = parser.parse_args()
     if not args.profile:
         raise AssertionError('Need profile folder.')
 
-    blocks = []
-    with open(args.profile, 'rb') as f:
-        for block in iter(lambda: f.read(64), b''):
-            if is_valid_block(block):
-                blocks.append(parse_block(block))
+    if args.live is not None:
+        live_view(args)
+        return
+
+    blocks = read_blocks(args.profile)
 
     if args.divider is not None:
         if args.per_iteration:
@@ -102,6 +210,10 @@ def main():
         blocks.sort(reverse = True, key = lambda a: a.iterations)
     elif args.sort == 'ticks':
         blocks.sort(reverse = True, key = lambda a: a.ticks)
+    elif args.sort == 'max':
+        blocks.sort(reverse = True, key = lambda a: a.ticks_max)
+    elif args.sort == 'p99':
+        blocks.sort(reverse = True, key = lambda a: histogram_percentile(a, 99.0))
     elif args.sort != 'none':
         raise AssertionError('Invalid argument for --sort.')
 
@@ -120,5 +232,16 @@ def main():
             else:
                 print('    Total time spent: {:.3f}'.format(block.ticks / 1000.0), "us")
 
+            # Latencies are per call and are not affected by normalization.
+            print('    Calls:', sum(block.histogram))
+            for percentile in [50.0, 99.0, 99.9]:
+                print('    p{}: <= {:.3f}'.format(percentile, histogram_percentile(block, percentile) / 1000.0), "us")
+            print('    Max: {:.3f}'.format(block.ticks_max / 1000.0), "us")
+
+            if args.histogram:
+                for i, bucket in enumerate(block.histogram):
+                    if bucket != 0:
+                        print('        {}: {}'.format(format_bucket(i), bucket))
+
 if __name__ == '__main__':
     main()
@@ -0,0 +1,564 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Streaming-style resource churn: every thread keeps a set of live resources and
+ * keeps replacing random ones with new resources of a similar size distribution.
+ * Memory statistics come from ID3D12DeviceExt1 and are skipped if it is missing. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define INITGUID
+#define VKD3D_TEST_DECLARE_MAIN
+#include "d3d12_crosstest.h"
+#include "d3d12_benchmark.h"
+#include "vkd3d_device_vkd3d_ext.h"
+
+enum output_format
+{
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV,
+};
+
+static struct
+{
+    unsigned int operations;
+    unsigned int live_count;
+    unsigned int max_threads;
+    unsigned int iterations;
+    enum output_format format;
+} options = { 20000, 256, 4, 1, OUTPUT_FORMAT_TEXT };
+
+#define PLACED_HEAP_SIZE (128ull * 1024 * 1024)
+#define STATS_POLL_INTERVAL 64
+
+enum churn_kind
+{
+    CHURN_COMMITTED_BUFFER,
+    CHURN_UPLOAD_BUFFER,
+    CHURN_COMMITTED_TEXTURE,
+    CHURN_PLACED_BUFFER,
+    CHURN_PLACED_TEXTURE,
+    CHURN_KIND_COUNT,
+};
+
+static const struct
+{
+    const char *name;
+    unsigned int weight;
+}
+churn_kinds[] =
+{
+    { "committed_buffer",  30 },
+    { "upload_buffer",     25 },
+    { "committed_texture", 15 },
+    { "placed_buffer",     20 },
+    { "placed_texture",    10 },
+};
+
+STATIC_ASSERT(ARRAY_SIZE(churn_kinds) == CHURN_KIND_COUNT);
+
+static void parse_benchmark_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--operations") && i + 1 < argc)
+            options.operations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--live") && i + 1 < argc)
+            options.live_count = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            options.max_threads = parse_benchmark_uint(argv[++i], 1, MAX_BENCHMARK_THREADS);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            options.iterations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--csv"))
+            options.format = OUTPUT_FORMAT_CSV;
+    }
+}
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    parse_benchmark_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+struct memory_summary
+{
+    UINT64 peak_allocated_bytes;
+    UINT64 peak_used_bytes;
+    UINT64 peak_clear_bytes_pending;
+    UINT64 chunk_bytes;
+    UINT64 chunk_free_bytes;
+    UINT64 largest_free_blocks;
+    UINT32 free_block_count;
+    bool valid;
+};
+
+static void report_begin(void)
+{
+    if (options.format == OUTPUT_FORMAT_CSV)
+    {
+        printf("benchmark,threads,samples,mean_us,p50_us,p90_us,p99_us,max_us,ops_per_sec,"
+                "peak_allocated_bytes,peak_used_bytes,peak_clear_pending_bytes,chunk_free_bytes,fragmentation\n");
+    }
+}
+
+static double memory_summary_get_fragmentation(const struct memory_summary *memory)
+{
+    /* Share of free chunk memory which is not part of the largest free block of its type. */
+    if (!memory->chunk_free_bytes)
+        return 0.0;
+    return 1.0 - (double)memory->largest_free_blocks / (double)memory->chunk_free_bytes;
+}
+
+static void report_result(const char *name, unsigned int thread_count, double *samples, unsigned int count,
+        double elapsed, const struct memory_summary *memory)
+{
+    double mean, p50, p90, p99, max_value, ops_per_sec;
+    unsigned int i;
+
+    if (!count)
+        return;
+
+    qsort(samples, count, sizeof(*samples), compare_double);
+
+    for (i = 0, mean = 0.0; i < count; i++)
+        mean += samples[i];
+    mean /= (double)count;
+
+    p50 = get_percentile(samples, count, 0.50);
+    p90 = get_percentile(samples, count, 0.90);
+    p99 = get_percentile(samples, count, 0.99);
+    max_value = samples[count - 1];
+    ops_per_sec = elapsed > 0.0 ? (double)count / elapsed : 0.0;
+
+    switch (options.format)
+    {
+        case OUTPUT_FORMAT_CSV:
+            printf("%s,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f", name, thread_count, count,
+                    1e6 * mean, 1e6 * p50, 1e6 * p90, 1e6 * p99, 1e6 * max_value, ops_per_sec);
+            if (memory && memory->valid)
+            {
+                printf(",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%.4f\n",
+                        memory->peak_allocated_bytes, memory->peak_used_bytes, memory->peak_clear_bytes_pending,
+                        memory->chunk_free_bytes, memory_summary_get_fragmentation(memory));
+            }
+            else
+                printf(",0,0,0,0,0\n");
+            break;
+
+        default:
+            printf("%s: %u samples on %u thread(s), %.1f ops/s, mean %.3f us, p50 %.3f us, p90 %.3f us, "
+                    "p99 %.3f us, max %.3f us.\n", name, count, thread_count, ops_per_sec,
+                    1e6 * mean, 1e6 * p50, 1e6 * p90, 1e6 * p99, 1e6 * max_value);
+            if (memory && memory->valid)
+            {
+                printf("    peak allocated %"PRIu64" KiB, peak used %"PRIu64" KiB, peak pending clears %"PRIu64" KiB, "
+                        "chunks %"PRIu64" KiB with %"PRIu64" KiB free in %u blocks, fragmentation %.2f%%.\n",
+                        memory->peak_allocated_bytes >> 10, memory->peak_used_bytes >> 10,
+                        memory->peak_clear_bytes_pending >> 10, memory->chunk_bytes >> 10,
+                        memory->chunk_free_bytes >> 10, memory->free_block_count,
+                        100.0 * memory_summary_get_fragmentation(memory));
+            }
+            break;
+    }
+
+    fflush(stdout);
+}
+
+static void memory_summary_update(struct memory_summary *memory, ID3D12DeviceExt1 *device_ext)
+{
+    D3D12_VK_MEMORY_ALLOCATOR_STATS stats;
+    UINT64 allocated = 0, used = 0;
+    unsigned int i;
+
+    if (!device_ext || FAILED(ID3D12DeviceExt1_GetMemoryAllocatorStats(device_ext, &stats)))
+        return;
+
+    memory->chunk_bytes = 0;
+    memory->chunk_free_bytes = 0;
+    memory->largest_free_blocks = 0;
+    memory->free_block_count = 0;
+
+    for (i = 0; i < stats.memoryTypeCount; i++)
+    {
+        allocated += stats.memoryTypes[i].allocatedBytes;
+        used += stats.memoryTypes[i].usedBytes;
+        memory->chunk_bytes += stats.memoryTypes[i].chunkBytes;
+        memory->chunk_free_bytes += stats.memoryTypes[i].chunkFreeBytes;
+        memory->largest_free_blocks += stats.memoryTypes[i].largestFreeBlock;
+        memory->free_block_count += stats.memoryTypes[i].freeBlockCount;
+    }
+
+    memory->peak_allocated_bytes = max(memory->peak_allocated_bytes, allocated);
+    memory->peak_used_bytes = max(memory->peak_used_bytes, used);
+    memory->peak_clear_bytes_pending = max(memory->peak_clear_bytes_pending, stats.clearBytesPending);
+    memory->valid = true;
+}
+
+static uint32_t rng_next(uint32_t *state)
+{
+    /* xorshift32, so that every thread has its own reproducible sequence. */
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static UINT64 pick_log_uniform(uint32_t *rng, unsigned int min_log2, unsigned int max_log2)
+{
+    unsigned int log2 = min_log2 + rng_next(rng) % (max_log2 - min_log2);
+    UINT64 size = 1ull << log2;
+
+    return size + (rng_next(rng) % size);
+}
+
+static UINT64 pick_buffer_size(uint32_t *rng, enum churn_kind kind)
+{
+    unsigned int bucket = rng_next(rng) % 100;
+    UINT64 size;
+
+    /* Mostly constant and vertex data, some streaming blocks and a few very large buffers. */
+    if (bucket < 60)
+        size = pick_log_uniform(rng, 8, 16);
+    else if (bucket < 90 || kind == CHURN_UPLOAD_BUFFER)
+        size = pick_log_uniform(rng, 16, 22);
+    else
+        size = pick_log_uniform(rng, 22, 26);
+
+    return align(size, 256);
+}
+
+static enum churn_kind pick_kind(uint32_t *rng)
+{
+    unsigned int i, value = rng_next(rng) % 100;
+
+    for (i = 0; i < CHURN_KIND_COUNT; i++)
+    {
+        if (value < churn_kinds[i].weight)
+            return i;
+        value -= churn_kinds[i].weight;
+    }
+
+    return CHURN_COMMITTED_BUFFER;
+}
+
+static void init_buffer_desc(D3D12_RESOURCE_DESC *desc, UINT64 size)
+{
+    memset(desc, 0, sizeof(*desc));
+    desc->Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc->Width = size;
+    desc->Height = 1;
+    desc->DepthOrArraySize = 1;
+    desc->MipLevels = 1;
+    desc->Format = DXGI_FORMAT_UNKNOWN;
+    desc->SampleDesc.Count = 1;
+    desc->Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+}
+
+static void init_texture_desc(D3D12_RESOURCE_DESC *desc, uint32_t *rng)
+{
+    static const DXGI_FORMAT formats[] =
+    {
+        DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC7_UNORM, DXGI_FORMAT_R16G16B16A16_FLOAT,
+    };
+
+    memset(desc, 0, sizeof(*desc));
+    desc->Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    /* Streamed textures from 64x64 to 2048x2048 with a full mip chain. */
+    desc->Width = 64u << (rng_next(rng) % 6);
+    desc->Height = 64u << (rng_next(rng) % 6);
+    desc->DepthOrArraySize = 1;
+    desc->MipLevels = 0;
+    desc->Format = formats[rng_next(rng) % ARRAY_SIZE(formats)];
+    desc->SampleDesc.Count = 1;
+    desc->Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+}
+
+struct churn_worker
+{
+    ID3D12Device *device;
+    ID3D12DeviceExt1 *device_ext;
+    ID3D12Heap *buffer_heap;
+    ID3D12Heap *texture_heap;
+    ID3D12Resource **live;
+    uint32_t rng;
+
+    double *create_samples[CHURN_KIND_COUNT];
+    unsigned int create_counts[CHURN_KIND_COUNT];
+    double *map_samples;
+    unsigned int map_count;
+    double *release_samples;
+    unsigned int release_count;
+    unsigned int failure_count;
+
+    struct memory_summary memory;
+};
+
+static HRESULT churn_create_resource(struct churn_worker *worker, enum churn_kind kind, ID3D12Resource **resource)
+{
+    D3D12_RESOURCE_ALLOCATION_INFO info;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC desc;
+    ID3D12Heap *heap;
+    UINT64 offset;
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = kind == CHURN_UPLOAD_BUFFER ? D3D12_HEAP_TYPE_UPLOAD : D3D12_HEAP_TYPE_DEFAULT;
+
+    if (kind == CHURN_COMMITTED_TEXTURE || kind == CHURN_PLACED_TEXTURE)
+        init_texture_desc(&desc, &worker->rng);
+    else
+        init_buffer_desc(&desc, pick_buffer_size(&worker->rng, kind));
+
+    switch (kind)
+    {
+        case CHURN_COMMITTED_BUFFER:
+        case CHURN_COMMITTED_TEXTURE:
+        case CHURN_UPLOAD_BUFFER:
+            return ID3D12Device_CreateCommittedResource(worker->device, &heap_properties, D3D12_HEAP_FLAG_NONE, &desc,
+                    kind == CHURN_UPLOAD_BUFFER ? D3D12_RESOURCE_STATE_GENERIC_READ : D3D12_RESOURCE_STATE_COMMON,
+                    NULL, &IID_ID3D12Resource, (void **)resource);
+
+        case CHURN_PLACED_BUFFER:
+        case CHURN_PLACED_TEXTURE:
+            /* Placed resources alias freely within a per-thread heap, so this only
+             * measures resource creation and VA bookkeeping, not heap allocation. */
+            heap = kind == CHURN_PLACED_BUFFER ? worker->buffer_heap : worker->texture_heap;
+            info = ID3D12Device_GetResourceAllocationInfo(worker->device, 0, 1, &desc);
+            if (!heap || info.SizeInBytes > PLACED_HEAP_SIZE)
+                return E_OUTOFMEMORY;
+            offset = (rng_next(&worker->rng) % (PLACED_HEAP_SIZE - info.SizeInBytes + 1));
+            offset &= ~(max(info.Alignment, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT) - 1);
+            return ID3D12Device_CreatePlacedResource(worker->device, heap, offset, &desc,
+                    D3D12_RESOURCE_STATE_COMMON, NULL, &IID_ID3D12Resource, (void **)resource);
+
+        default:
+            return E_INVALIDARG;
+    }
+}
+
+static void churn_worker_main(void *userdata)
+{
+    struct churn_worker *worker = userdata;
+    ID3D12Resource *resource;
+    enum churn_kind kind;
+    double start_time;
+    unsigned int i;
+    uint32_t slot;
+    void *ptr;
+    HRESULT hr;
+
+    for (i = 0; i < options.operations; i++)
+    {
+        slot = rng_next(&worker->rng) % options.live_count;
+
+        if (worker->live[slot])
+        {
+            start_time = get_time();
+            ID3D12Resource_Release(worker->live[slot]);
+            worker->release_samples[worker->release_count++] = get_time() - start_time;
+            worker->live[slot] = NULL;
+        }
+
+        kind = pick_kind(&worker->rng);
+
+        start_time = get_time();
+        hr = churn_create_resource(worker, kind, &resource);
+        if (FAILED(hr))
+        {
+            worker->failure_count++;
+            continue;
+        }
+        worker->create_samples[kind][worker->create_counts[kind]++] = get_time() - start_time;
+        worker->live[slot] = resource;
+
+        if (kind == CHURN_UPLOAD_BUFFER)
+        {
+            start_time = get_time();
+            hr = ID3D12Resource_Map(resource, 0, NULL, &ptr);
+            if (SUCCEEDED(hr))
+            {
+                *(uint32_t *)ptr = i;
+                ID3D12Resource_Unmap(resource, 0, NULL);
+            }
+            worker->map_samples[worker->map_count++] = get_time() - start_time;
+        }
+
+        if (i % STATS_POLL_INTERVAL == 0)
+            memory_summary_update(&worker->memory, worker->device_ext);
+    }
+
+    memory_summary_update(&worker->memory, worker->device_ext);
+}
+
+static ID3D12Heap *create_placed_heap(ID3D12Device *device, D3D12_HEAP_FLAGS flags)
+{
+    D3D12_HEAP_DESC heap_desc;
+    ID3D12Heap *heap;
+    HRESULT hr;
+
+    memset(&heap_desc, 0, sizeof(heap_desc));
+    heap_desc.SizeInBytes = PLACED_HEAP_SIZE;
+    heap_desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heap_desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heap_desc.Flags = flags;
+
+    hr = ID3D12Device_CreateHeap(device, &heap_desc, &IID_ID3D12Heap, (void **)&heap);
+    ok(SUCCEEDED(hr), "Failed to create heap, hr #%x.\n", hr);
+    return SUCCEEDED(hr) ? heap : NULL;
+}
+
+static void benchmark_churn(ID3D12Device *device, ID3D12DeviceExt1 *device_ext,
+        double *samples, unsigned int thread_count)
+{
+    struct churn_worker workers[MAX_BENCHMARK_THREADS];
+    unsigned int i, j, k, count, total;
+    struct memory_summary memory;
+    double elapsed;
+
+    memset(workers, 0, sizeof(workers));
+
+    for (i = 0; i < thread_count; i++)
+    {
+        workers[i].device = device;
+        workers[i].device_ext = device_ext;
+        workers[i].rng = 0x9e3779b9u * (i + 1);
+        workers[i].live = calloc(options.live_count, sizeof(*workers[i].live));
+        for (j = 0; j < CHURN_KIND_COUNT; j++)
+            workers[i].create_samples[j] = malloc(options.operations * sizeof(double));
+        workers[i].map_samples = malloc(options.operations * sizeof(double));
+        workers[i].release_samples = malloc(options.operations * sizeof(double));
+        workers[i].buffer_heap = create_placed_heap(device, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+        workers[i].texture_heap = create_placed_heap(device, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES);
+    }
+
+    elapsed = run_benchmark_threads(churn_worker_main, workers, sizeof(*workers), thread_count);
+
+    /* Peaks are taken from whichever thread saw the highest value, the final
+     * fragmentation state is the same for all threads. */
+    memset(&memory, 0, sizeof(memory));
+    memory_summary_update(&memory, device_ext);
+    for (i = 0; i < thread_count; i++)
+    {
+        memory.peak_allocated_bytes = max(memory.peak_allocated_bytes, workers[i].memory.peak_allocated_bytes);
+        memory.peak_used_bytes = max(memory.peak_used_bytes, workers[i].memory.peak_used_bytes);
+        memory.peak_clear_bytes_pending = max(memory.peak_clear_bytes_pending, workers[i].memory.peak_clear_bytes_pending);
+    }
+
+    for (k = 0, total = 0; k < CHURN_KIND_COUNT; k++)
+    {
+        for (i = 0, count = 0; i < thread_count; i++)
+        {
+            memcpy(samples + count, workers[i].create_samples[k], workers[i].create_counts[k] * sizeof(*samples));
+            count += workers[i].create_counts[k];
+        }
+        report_result(churn_kinds[k].name, thread_count, samples, count, elapsed, NULL);
+        total += count;
+    }
+
+    for (i = 0, count = 0; i < thread_count; i++)
+    {
+        memcpy(samples + count, workers[i].map_samples, workers[i].map_count * sizeof(*samples));
+        count += workers[i].map_count;
+    }
+    report_result("map", thread_count, samples, count, elapsed, NULL);
+
+    for (i = 0, count = 0; i < thread_count; i++)
+    {
+        memcpy(samples + count, workers[i].release_samples, workers[i].release_count * sizeof(*samples));
+        count += workers[i].release_count;
+    }
+    report_result("release", thread_count, samples, count, elapsed, NULL);
+
+    /* The summary row carries the overall allocation rate and the memory statistics. */
+    for (k = 0, count = 0; k < CHURN_KIND_COUNT; k++)
+    {
+        for (i = 0; i < thread_count; i++)
+        {
+            memcpy(samples + count, workers[i].create_samples[k], workers[i].create_counts[k] * sizeof(*samples));
+            count += workers[i].create_counts[k];
+        }
+    }
+    report_result("churn_create", thread_count, samples, total, elapsed, &memory);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        if (workers[i].failure_count)
+            trace("Thread %u failed to create %u resources.\n", i, workers[i].failure_count);
+
+        for (j = 0; j < options.live_count; j++)
+        {
+            if (workers[i].live[j])
+                ID3D12Resource_Release(workers[i].live[j]);
+        }
+
+        if (workers[i].buffer_heap)
+            ID3D12Heap_Release(workers[i].buffer_heap);
+        if (workers[i].texture_heap)
+            ID3D12Heap_Release(workers[i].texture_heap);
+
+        for (j = 0; j < CHURN_KIND_COUNT; j++)
+            free(workers[i].create_samples[j]);
+        free(workers[i].map_samples);
+        free(workers[i].release_samples);
+        free(workers[i].live);
+    }
+}
+
+static void do_benchmark_run(ID3D12Device *device, ID3D12DeviceExt1 *device_ext, double *samples)
+{
+    unsigned int thread_count;
+
+    for_each_benchmark_thread_count(thread_count, options.max_threads)
+        benchmark_churn(device, device_ext, samples, thread_count);
+}
+
+START_TEST(allocator_performance)
+{
+    ID3D12DeviceExt1 *device_ext = NULL;
+    ID3D12Device *device;
+    double *samples;
+    unsigned int i;
+
+    setup(argc, argv);
+    device = create_device();
+    ok(device != NULL, "Failed to create device.\n");
+
+    if (FAILED(ID3D12Device_QueryInterface(device, &IID_ID3D12DeviceExt1, (void **)&device_ext)))
+        skip("ID3D12DeviceExt1 not available, skipping memory statistics.\n");
+
+    samples = malloc((size_t)options.operations * options.max_threads * sizeof(*samples));
+    ok(samples != NULL, "Failed to allocate samples.\n");
+
+    report_begin();
+    for (i = 0; i < options.iterations; i++)
+        do_benchmark_run(device, device_ext, samples);
+
+    free(samples);
+    if (device_ext)
+        ID3D12DeviceExt1_Release(device_ext);
+    ID3D12Device_Release(device);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Helpers shared by the *_performance benchmarks. The thread helpers are only
+ * available if d3d12_crosstest.h is included first. */
+
+#ifndef __VKD3D_D3D12_BENCHMARK_H
+#define __VKD3D_D3D12_BENCHMARK_H
+
+#include <time.h>
+
+#define MAX_BENCHMARK_THREADS 64
+
+static inline double get_time(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER lc, lf;
+    QueryPerformanceCounter(&lc);
+    QueryPerformanceFrequency(&lf);
+    return (double)lc.QuadPart / (double)lf.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+static inline int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static inline double get_percentile(const double *sorted_samples, unsigned int count, double percentile)
+{
+    unsigned int index = (unsigned int)(percentile * (double)count);
+    return sorted_samples[min(index, count - 1)];
+}
+
+/* Parses a numeric command line value and clamps it to [min_value, max_value]. This
+ * keeps argv[++i] out of the min() and max() macros, which evaluate it twice. */
+static inline unsigned int parse_benchmark_uint(const char *arg, unsigned int min_value, unsigned int max_value)
+{
+    int value = atoi(arg);
+
+    if (value < 0 || (unsigned int)value < min_value)
+        return min_value;
+    return min((unsigned int)value, max_value);
+}
+
+/* Thread counts go 1, 2, 4, ... up to and including max_threads, 0 ends the loop. */
+static inline unsigned int get_next_benchmark_thread_count(unsigned int thread_count, unsigned int max_threads)
+{
+    return thread_count >= max_threads ? 0 : min(2 * thread_count, max_threads);
+}
+
+#define for_each_benchmark_thread_count(thread_count, max_threads) \
+    for (thread_count = 1; thread_count; thread_count = get_next_benchmark_thread_count(thread_count, max_threads))
+
+#ifdef __VKD3D_D3D12_CROSSTEST_H
+/* Runs main_pfn once per worker, each on its own thread. Workers are laid out in an
+ * array with a stride of worker_size bytes. If a thread cannot be created, its work
+ * runs inline so that the results stay complete. Returns the wall time in seconds. */
+static inline double run_benchmark_threads(thread_main_pfn main_pfn, void *workers,
+        size_t worker_size, unsigned int thread_count)
+{
+    HANDLE threads[MAX_BENCHMARK_THREADS];
+    double start_time;
+    unsigned int i;
+
+    assert(thread_count <= MAX_BENCHMARK_THREADS);
+
+    start_time = get_time();
+
+    for (i = 0; i < thread_count; i++)
+    {
+        if (!(threads[i] = create_thread(main_pfn, (char *)workers + i * worker_size)))
+        {
+            ok(false, "Failed to create thread %u.\n", i);
+            main_pfn((char *)workers + i * worker_size);
+        }
+    }
+
+    for (i = 0; i < thread_count; i++)
+    {
+        if (threads[i])
+            ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+    }
+
+    return get_time() - start_time;
+}
+#endif
+
+#endif  /* __VKD3D_D3D12_BENCHMARK_H */
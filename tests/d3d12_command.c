@@ -1164,6 +1164,356 @@ void test_bundle_state_inheritance(void)
     destroy_test_context(&context);
 }
 
+void test_bundle_reuse(void)
+{
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    ID3D12GraphicsCommandList *command_list, *bundle;
+    ID3D12CommandAllocator *bundle_allocator;
+    struct test_context_desc desc;
+    struct test_context context;
+    struct resource_readback rb;
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    unsigned int i, j, x, y;
+    D3D12_VIEWPORT viewport;
+    HRESULT hr;
+
+    static const DWORD ps_color_code[] =
+    {
+#if 0
+        float4 color;
+
+        float4 main(float4 position : SV_POSITION) : SV_Target
+        {
+            return color;
+        }
+#endif
+        0x43425844, 0xd18ead43, 0x8b8264c1, 0x9c0a062d, 0xfc843226, 0x00000001, 0x000000e0, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000000f, 0x505f5653, 0x5449534f, 0x004e4f49,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003,
+        0x00000000, 0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x58454853, 0x00000044, 0x00000050,
+        0x00000011, 0x0100086a, 0x04000059, 0x00208e46, 0x00000000, 0x00000001, 0x03000065, 0x001020f2,
+        0x00000000, 0x06000036, 0x001020f2, 0x00000000, 0x00208e46, 0x00000000, 0x00000000, 0x0100003e,
+    };
+    static const D3D12_SHADER_BYTECODE ps_color = {ps_color_code, sizeof(ps_color_code)};
+    static const struct
+    {
+        struct vec4 color;
+        uint32_t expected;
+        bool use_bundle;
+    }
+    quadrants[] =
+    {
+        {{1.0f, 0.0f, 0.0f, 1.0f}, 0xff0000ff, true},
+        {{0.0f, 1.0f, 0.0f, 1.0f}, 0xff00ff00, true},
+        {{0.0f, 0.0f, 1.0f, 1.0f}, 0xffff0000, false},
+        {{1.0f, 1.0f, 0.0f, 1.0f}, 0xff00ffff, true},
+    };
+
+    memset(&desc, 0, sizeof(desc));
+    desc.rt_format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.no_root_signature = true;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    device = context.device;
+    command_list = context.list;
+    queue = context.queue;
+
+    context.root_signature = create_32bit_constants_root_signature(device,
+            0, 4, D3D12_SHADER_VISIBILITY_PIXEL);
+    context.pipeline_state = create_pipeline_state(device, context.root_signature,
+            desc.rt_format, NULL, &ps_color, NULL);
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+            &IID_ID3D12CommandAllocator, (void **)&bundle_allocator);
+    ok(SUCCEEDED(hr), "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+            bundle_allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&bundle);
+    ok(SUCCEEDED(hr), "Failed to create command list, hr %#x.\n", hr);
+
+    /* The bundle inherits root arguments and viewports, which differ between executions. */
+    ID3D12GraphicsCommandList_SetPipelineState(bundle, context.pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(bundle, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_DrawInstanced(bundle, 3, 1, 0, 0);
+    hr = ID3D12GraphicsCommandList_Close(bundle);
+    ok(SUCCEEDED(hr), "Failed to close bundle, hr %#x.\n", hr);
+
+    /* Execute the bundle from two command lists to reuse whatever was cached the first time. */
+    for (i = 0; i < 2; ++i)
+    {
+        vkd3d_test_set_context("Iteration %u", i);
+
+        ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+        ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+        ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+        ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+        ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+
+        /* Bundles and inline draws are interleaved within the same render pass. */
+        for (j = 0; j < ARRAY_SIZE(quadrants); ++j)
+        {
+            set_viewport(&viewport, (j & 1) * 16.0f, (j >> 1) * 16.0f, 16.0f, 16.0f, 0.0f, 1.0f);
+            ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &viewport);
+            ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstants(command_list, 0, 4, &quadrants[j].color.x, 0);
+
+            if (quadrants[j].use_bundle)
+                ID3D12GraphicsCommandList_ExecuteBundle(command_list, bundle);
+            else
+                ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+        }
+
+        transition_resource_state(command_list, context.render_target,
+                D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        get_texture_readback_with_command_list(context.render_target, 0, &rb, queue, command_list);
+        for (j = 0; j < ARRAY_SIZE(quadrants); ++j)
+        {
+            x = (j & 1) * 16 + 8;
+            y = (j >> 1) * 16 + 8;
+            ok(get_readback_uint(&rb, x, y, 0) == quadrants[j].expected,
+                    "Got unexpected value 0x%08x in quadrant %u, expected 0x%08x.\n",
+                    get_readback_uint(&rb, x, y, 0), j, quadrants[j].expected);
+        }
+        release_resource_readback(&rb);
+
+        reset_command_list(command_list, context.allocator);
+        transition_resource_state(command_list, context.render_target,
+                D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+    vkd3d_test_set_context(NULL);
+
+    ID3D12CommandAllocator_Release(bundle_allocator);
+    ID3D12GraphicsCommandList_Release(bundle);
+    destroy_test_context(&context);
+}
+
+void test_bundle_baked_state_leak(void)
+{
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    ID3D12GraphicsCommandList *command_list, *bundle;
+    ID3D12CommandAllocator *bundle_allocator;
+    struct test_context_desc desc;
+    struct test_context context;
+    struct resource_readback rb;
+    ID3D12CommandQueue *queue;
+    unsigned int i, j, x;
+    D3D12_VIEWPORT viewport;
+    ID3D12Device *device;
+    struct vec4 color;
+    uint32_t expected;
+    HRESULT hr;
+
+    static const DWORD ps_color_code[] =
+    {
+#if 0
+        float4 color;
+
+        float4 main(float4 position : SV_POSITION) : SV_Target
+        {
+            return color;
+        }
+#endif
+        0x43425844, 0xd18ead43, 0x8b8264c1, 0x9c0a062d, 0xfc843226, 0x00000001, 0x000000e0, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000000f, 0x505f5653, 0x5449534f, 0x004e4f49,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003,
+        0x00000000, 0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x58454853, 0x00000044, 0x00000050,
+        0x00000011, 0x0100086a, 0x04000059, 0x00208e46, 0x00000000, 0x00000001, 0x03000065, 0x001020f2,
+        0x00000000, 0x06000036, 0x001020f2, 0x00000000, 0x00208e46, 0x00000000, 0x00000000, 0x0100003e,
+    };
+    static const D3D12_SHADER_BYTECODE ps_color = {ps_color_code, sizeof(ps_color_code)};
+
+    memset(&desc, 0, sizeof(desc));
+    desc.rt_width = 32;
+    desc.rt_height = 4;
+    desc.rt_format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.no_root_signature = true;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    device = context.device;
+    command_list = context.list;
+    queue = context.queue;
+
+    context.root_signature = create_32bit_constants_root_signature(device,
+            0, 4, D3D12_SHADER_VISIBILITY_PIXEL);
+    context.pipeline_state = create_pipeline_state(device, context.root_signature,
+            desc.rt_format, NULL, &ps_color, NULL);
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+            &IID_ID3D12CommandAllocator, (void **)&bundle_allocator);
+    ok(SUCCEEDED(hr), "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_BUNDLE,
+            bundle_allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&bundle);
+    ok(SUCCEEDED(hr), "Failed to create command list, hr %#x.\n", hr);
+
+    /* Only draws and state, so the bundle may be baked. */
+    ID3D12GraphicsCommandList_SetPipelineState(bundle, context.pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(bundle, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_DrawInstanced(bundle, 3, 1, 0, 0);
+    hr = ID3D12GraphicsCommandList_Close(bundle);
+    ok(SUCCEEDED(hr), "Failed to close bundle, hr %#x.\n", hr);
+
+    for (i = 0; i < 2; ++i)
+    {
+        vkd3d_test_set_context("Iteration %u", i);
+
+        /* The pipeline and topology are only set by the first bundle execution, later
+         * inline draws rely on them leaking out of the bundle. Each column uses
+         * different inherited root constants. */
+        ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+        ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+        ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+        ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+
+        for (j = 0; j < 8; ++j)
+        {
+            color.x = j & 1 ? 1.0f : 0.0f;
+            color.y = j & 2 ? 1.0f : 0.0f;
+            color.z = j & 4 ? 1.0f : 0.0f;
+            color.w = 1.0f;
+
+            set_viewport(&viewport, j * 4.0f, 0.0f, 4.0f, 4.0f, 0.0f, 1.0f);
+            ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &viewport);
+            ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstants(command_list, 0, 4, &color.x, 0);
+
+            if (j == 0 || j == 3 || j > 5)
+                ID3D12GraphicsCommandList_ExecuteBundle(command_list, bundle);
+            else
+                ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+        }
+
+        transition_resource_state(command_list, context.render_target,
+                D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        get_texture_readback_with_command_list(context.render_target, 0, &rb, queue, command_list);
+        for (j = 0; j < 8; ++j)
+        {
+            expected = 0xff000000 | (j & 1 ? 0xff : 0) | (j & 2 ? 0xff00 : 0) | (j & 4 ? 0xff0000 : 0);
+            x = j * 4 + 2;
+            ok(get_readback_uint(&rb, x, 2, 0) == expected,
+                    "Got unexpected value 0x%08x in column %u, expected 0x%08x.\n",
+                    get_readback_uint(&rb, x, 2, 0), j, expected);
+        }
+        release_resource_readback(&rb);
+
+        reset_command_list(command_list, context.allocator);
+        transition_resource_state(command_list, context.render_target,
+                D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+    vkd3d_test_set_context(NULL);
+
+    ID3D12CommandAllocator_Release(bundle_allocator);
+    ID3D12GraphicsCommandList_Release(bundle);
+    destroy_test_context(&context);
+}
+
+void test_record_time_rtv_descriptors(void)
+{
+    static const float green[] = {0.0f, 1.0f, 0.0f, 1.0f};
+    static const float blue[] = {0.0f, 0.0f, 1.0f, 1.0f};
+    static const float red[] = {1.0f, 0.0f, 0.0f, 1.0f};
+    ID3D12GraphicsCommandList *command_list, *list2;
+    ID3D12CommandAllocator *allocator2;
+    ID3D12Resource *render_targets[2];
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+    ID3D12DescriptorHeap *rtv_heap;
+    struct test_context_desc desc;
+    ID3D12CommandList *lists[2];
+    struct test_context context;
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    unsigned int i;
+    HRESULT hr;
+
+    /* RTV descriptors are consumed when a command is recorded, so rewriting the
+     * descriptor before the list is closed or executed must not affect it. This
+     * also holds when translation to Vulkan is deferred past Close(). */
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    desc.no_root_signature = true;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    device = context.device;
+    command_list = context.list;
+    queue = context.queue;
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator2);
+    ok(hr == S_OK, "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            allocator2, NULL, &IID_ID3D12GraphicsCommandList, (void **)&list2);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    rtv_heap = create_cpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 1);
+    rtv = get_cpu_rtv_handle(&context, rtv_heap, 0);
+
+    for (i = 0; i < ARRAY_SIZE(render_targets); i++)
+    {
+        render_targets[i] = create_default_texture(device, 4, 4, DXGI_FORMAT_R8G8B8A8_UNORM,
+                D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    }
+
+    ID3D12Device_CreateRenderTargetView(device, render_targets[0], NULL, rtv);
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, rtv, red, 0, NULL);
+    ID3D12Device_CreateRenderTargetView(device, render_targets[1], NULL, rtv);
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, rtv, green, 0, NULL);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+
+    /* The second list runs after the first one within the same submission. */
+    ID3D12GraphicsCommandList_ClearRenderTargetView(list2, rtv, blue, 0, NULL);
+    ID3D12Device_CreateRenderTargetView(device, render_targets[0], NULL, rtv);
+    for (i = 0; i < ARRAY_SIZE(render_targets); i++)
+    {
+        transition_resource_state(list2, render_targets[i],
+                D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    }
+    hr = ID3D12GraphicsCommandList_Close(list2);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+
+    lists[0] = (ID3D12CommandList *)command_list;
+    lists[1] = (ID3D12CommandList *)list2;
+    ID3D12CommandQueue_ExecuteCommandLists(queue, ARRAY_SIZE(lists), lists);
+    wait_queue_idle(device, queue);
+
+    reset_command_list(command_list, context.allocator);
+    check_sub_resource_uint(render_targets[0], 0, queue, command_list, 0xff0000ff, 0);
+    reset_command_list(command_list, context.allocator);
+    check_sub_resource_uint(render_targets[1], 0, queue, command_list, 0xffff0000, 0);
+
+    /* Re-record both lists from reset allocators. */
+    reset_command_list(command_list, context.allocator);
+    reset_command_list(list2, allocator2);
+    transition_resource_state(command_list, render_targets[0],
+            D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, rtv, blue, 0, NULL);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    ID3D12GraphicsCommandList_ClearRenderTargetView(list2, rtv, green, 0, NULL);
+    transition_resource_state(list2, render_targets[0],
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    ID3D12Device_CreateRenderTargetView(device, render_targets[1], NULL, rtv);
+    hr = ID3D12GraphicsCommandList_Close(list2);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    ID3D12CommandQueue_ExecuteCommandLists(queue, ARRAY_SIZE(lists), lists);
+    wait_queue_idle(device, queue);
+
+    reset_command_list(command_list, context.allocator);
+    check_sub_resource_uint(render_targets[0], 0, queue, command_list, 0xff00ff00, 0);
+    reset_command_list(command_list, context.allocator);
+    check_sub_resource_uint(render_targets[1], 0, queue, command_list, 0xffff0000, 0);
+
+    for (i = 0; i < ARRAY_SIZE(render_targets); i++)
+        ID3D12Resource_Release(render_targets[i]);
+    ID3D12DescriptorHeap_Release(rtv_heap);
+    ID3D12GraphicsCommandList_Release(list2);
+    ID3D12CommandAllocator_Release(allocator2);
+    destroy_test_context(&context);
+}
+
 void test_null_vbv(void)
 {
     ID3D12GraphicsCommandList *command_list;
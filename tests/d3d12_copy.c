@@ -1321,3 +1321,119 @@ void test_copy_buffer_overlap(void)
     destroy_test_context(&context);
 }
 
+
+void test_copy_buffer_transfer_offload(void)
+{
+#define OFFLOAD_TEST_ELEMENT_COUNT (256 * 1024)
+    ID3D12Resource *dst_buffers[4];
+    ID3D12Resource *upload_buffer, *small_upload_buffer;
+    ID3D12GraphicsCommandList *command_list, *list2;
+    uint32_t small_data[64], expected, value;
+    struct test_context_desc desc;
+    ID3D12CommandAllocator *allocator2;
+    ID3D12CommandList *lists[2];
+    struct test_context context;
+    struct resource_readback rb;
+    ID3D12CommandQueue *queue;
+    unsigned int i, j, index;
+    uint32_t *src_data;
+    HRESULT hr;
+
+    /* Large copies out of UPLOAD heap buffers on direct lists may be moved to a
+     * transfer queue ahead of the list. Check that the results and the ordering
+     * against other copies into the same buffer are unaffected. */
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    desc.no_root_signature = true;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    command_list = context.list;
+    queue = context.queue;
+
+    hr = ID3D12Device_CreateCommandAllocator(context.device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator2);
+    ok(hr == S_OK, "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(context.device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            allocator2, NULL, &IID_ID3D12GraphicsCommandList, (void **)&list2);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    src_data = malloc(OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data));
+    for (i = 0; i < OFFLOAD_TEST_ELEMENT_COUNT; i++)
+        src_data[i] = i;
+    for (i = 0; i < ARRAY_SIZE(small_data); i++)
+        small_data[i] = 0x80000000u | i;
+
+    upload_buffer = create_upload_buffer(context.device, OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data), src_data);
+    small_upload_buffer = create_upload_buffer(context.device, sizeof(small_data), small_data);
+
+    for (i = 0; i < ARRAY_SIZE(dst_buffers); i++)
+    {
+        dst_buffers[i] = create_default_buffer(context.device, OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data),
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+
+    /* A list that only contains the large copy. */
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffers[0], 0,
+            upload_buffer, 0, OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data));
+
+    /* A later small copy into the same buffer has to land on top of the large one. */
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffers[1], 0,
+            upload_buffer, 0, OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data));
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffers[1], 1024,
+            small_upload_buffer, 0, sizeof(small_data));
+
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(queue, command_list);
+
+    /* Two lists in one submission, which must not be offloaded. */
+    reset_command_list(command_list, context.allocator);
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffers[2], 0,
+            upload_buffer, 0, OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data));
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+
+    ID3D12GraphicsCommandList_CopyBufferRegion(list2, dst_buffers[3], 0,
+            upload_buffer, 0, OFFLOAD_TEST_ELEMENT_COUNT * sizeof(*src_data));
+    hr = ID3D12GraphicsCommandList_Close(list2);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+
+    lists[0] = (ID3D12CommandList *)command_list;
+    lists[1] = (ID3D12CommandList *)list2;
+    ID3D12CommandQueue_ExecuteCommandLists(queue, ARRAY_SIZE(lists), lists);
+    wait_queue_idle(context.device, queue);
+
+    for (i = 0; i < ARRAY_SIZE(dst_buffers); i++)
+    {
+        vkd3d_test_set_context("Buffer %u", i);
+
+        reset_command_list(command_list, context.allocator);
+        transition_resource_state(command_list, dst_buffers[i],
+                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        get_buffer_readback_with_command_list(dst_buffers[i], DXGI_FORMAT_R32_UINT, &rb, queue, command_list);
+
+        expected = value = 0;
+        for (j = 0; j < OFFLOAD_TEST_ELEMENT_COUNT; j++)
+        {
+            index = j - 1024 / sizeof(*src_data);
+            expected = i == 1 && index < ARRAY_SIZE(small_data) ? small_data[index] : src_data[j];
+            if ((value = get_readback_uint(&rb, j, 0, 0)) != expected)
+                break;
+        }
+        ok(j == OFFLOAD_TEST_ELEMENT_COUNT, "Got 0x%08x, expected 0x%08x at %u.\n", value, expected, j);
+
+        release_resource_readback(&rb);
+    }
+    vkd3d_test_set_context(NULL);
+
+    for (i = 0; i < ARRAY_SIZE(dst_buffers); i++)
+        ID3D12Resource_Release(dst_buffers[i]);
+    ID3D12Resource_Release(small_upload_buffer);
+    ID3D12Resource_Release(upload_buffer);
+    ID3D12GraphicsCommandList_Release(list2);
+    ID3D12CommandAllocator_Release(allocator2);
+    free(src_data);
+    destroy_test_context(&context);
+#undef OFFLOAD_TEST_ELEMENT_COUNT
+}
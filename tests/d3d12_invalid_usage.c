@@ -147,6 +147,70 @@ static void test_invalid_resource_barriers(void)
     ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
 }
 
+static void test_invalid_barrier_after_commands(void)
+{
+    ID3D12Resource *src_buffer, *dst_buffer, *texture;
+    ID3D12CommandAllocator *command_allocator;
+    ID3D12GraphicsCommandList *command_list;
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    ULONG refcount;
+    unsigned int i;
+    HRESULT hr;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&command_allocator);
+    ok(hr == S_OK, "Failed to create command allocator, hr %#x.\n", hr);
+
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            command_allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&command_list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    texture = create_default_texture(device, 32, 32, DXGI_FORMAT_R8G8B8A8_UNORM,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+    src_buffer = create_upload_buffer(device, 256, NULL);
+    dst_buffer = create_default_buffer(device, 256, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+
+    /* With deferred command list translation, the invalid barrier is only
+     * recorded when Close() is called, but the error must still be returned from Close(). */
+    for (i = 0; i < 16; ++i)
+        ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffer, 0, src_buffer, 0, 256);
+    transition_resource_state(command_list, texture,
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    for (i = 0; i < 16; ++i)
+        ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffer, 0, src_buffer, 0, 256);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    recreate_command_list(device, command_allocator, &command_list);
+
+    /* A valid list recorded afterwards closes and executes normally. */
+    for (i = 0; i < 16; ++i)
+        ID3D12GraphicsCommandList_CopyBufferRegion(command_list, dst_buffer, 0, src_buffer, 0, 256);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(queue, command_list);
+    wait_queue_idle(device, queue);
+
+    ID3D12CommandAllocator_Release(command_allocator);
+    ID3D12CommandQueue_Release(queue);
+    ID3D12GraphicsCommandList_Release(command_list);
+    ID3D12Resource_Release(dst_buffer);
+    ID3D12Resource_Release(src_buffer);
+    ID3D12Resource_Release(texture);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
 static void test_invalid_copy_texture_region(void)
 {
     ID3D12Resource *dst_texture, *src_texture, *dst_buffer, *src_buffer;
@@ -333,6 +397,7 @@ START_TEST(d3d12_invalid_usage)
     init_adapter_info();
 
     run_test(test_invalid_resource_barriers);
+    run_test(test_invalid_barrier_after_commands);
     run_test(test_invalid_copy_texture_region);
     run_test(test_invalid_unordered_access_views);
 }
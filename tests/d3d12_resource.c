@@ -21,6 +21,7 @@
 
 #define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
 #include "d3d12_crosstest.h"
+#include "vkd3d_device_vkd3d_ext.h"
 
 void test_create_committed_resource(void)
 {
@@ -3389,3 +3390,348 @@ void test_aliasing_barrier_edge_cases(void)
 
     destroy_test_context(&context);
 }
+
+void test_residency(void)
+{
+    ID3D12Resource *committed_buffer, *placed_buffer;
+    ID3D12Resource *buffers[2];
+    ID3D12Pageable *objects[2];
+    struct test_context_desc desc;
+    struct test_context context;
+    struct resource_readback rb;
+    D3D12_HEAP_DESC heap_desc;
+    uint32_t data[16 * 1024];
+    ID3D12Device3 *device3;
+    unsigned int i, j;
+    ID3D12Fence *fence;
+    ID3D12Heap *heap;
+    HRESULT hr;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    desc.no_root_signature = true;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+
+    for (i = 0; i < ARRAY_SIZE(data); i++)
+        data[i] = i;
+
+    memset(&heap_desc, 0, sizeof(heap_desc));
+    heap_desc.SizeInBytes = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+    heap_desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    hr = ID3D12Device_CreateHeap(context.device, &heap_desc, &IID_ID3D12Heap, (void **)&heap);
+    ok(hr == S_OK, "Failed to create heap, hr %#x.\n", hr);
+
+    committed_buffer = create_default_buffer(context.device, sizeof(data),
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    placed_buffer = create_placed_buffer(context.device, heap, 0, sizeof(data),
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+
+    buffers[0] = committed_buffer;
+    buffers[1] = placed_buffer;
+    objects[0] = (ID3D12Pageable *)committed_buffer;
+    objects[1] = (ID3D12Pageable *)heap;
+
+    upload_buffer_data(committed_buffer, 0, sizeof(data), data, context.queue, context.list);
+    reset_command_list(context.list, context.allocator);
+    upload_buffer_data(placed_buffer, 0, sizeof(data), data, context.queue, context.list);
+    reset_command_list(context.list, context.allocator);
+
+    /* Residency is reference counted, the objects stay resident until every
+     * MakeResident is balanced by an Evict. */
+    hr = ID3D12Device_MakeResident(context.device, ARRAY_SIZE(objects), objects);
+    ok(hr == S_OK, "Failed to make objects resident, hr %#x.\n", hr);
+    hr = ID3D12Device_Evict(context.device, ARRAY_SIZE(objects), objects);
+    ok(hr == S_OK, "Failed to evict objects, hr %#x.\n", hr);
+
+    /* Evicted objects have to keep their contents once they are resident again. */
+    hr = ID3D12Device_Evict(context.device, ARRAY_SIZE(objects), objects);
+    ok(hr == S_OK, "Failed to evict objects, hr %#x.\n", hr);
+    hr = ID3D12Device_MakeResident(context.device, ARRAY_SIZE(objects), objects);
+    ok(hr == S_OK, "Failed to make objects resident, hr %#x.\n", hr);
+
+    if (SUCCEEDED(ID3D12Device_QueryInterface(context.device, &IID_ID3D12Device3, (void **)&device3)))
+    {
+        hr = ID3D12Device_CreateFence(context.device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&fence);
+        ok(hr == S_OK, "Failed to create fence, hr %#x.\n", hr);
+
+        hr = ID3D12Device_Evict(context.device, ARRAY_SIZE(objects), objects);
+        ok(hr == S_OK, "Failed to evict objects, hr %#x.\n", hr);
+        hr = ID3D12Device3_EnqueueMakeResident(device3, D3D12_RESIDENCY_FLAG_NONE,
+                ARRAY_SIZE(objects), objects, fence, 1);
+        ok(hr == S_OK, "Failed to enqueue residency change, hr %#x.\n", hr);
+        hr = wait_for_fence(fence, 1);
+        ok(hr == S_OK, "Failed to wait for fence, hr %#x.\n", hr);
+
+        /* A few KiB can not exceed the budget. */
+        hr = ID3D12Device_Evict(context.device, ARRAY_SIZE(objects), objects);
+        ok(hr == S_OK, "Failed to evict objects, hr %#x.\n", hr);
+        hr = ID3D12Device3_EnqueueMakeResident(device3, D3D12_RESIDENCY_FLAG_DENY_OVERBUDGET,
+                ARRAY_SIZE(objects), objects, fence, 2);
+        ok(hr == S_OK, "Failed to enqueue residency change, hr %#x.\n", hr);
+        hr = wait_for_fence(fence, 2);
+        ok(hr == S_OK, "Failed to wait for fence, hr %#x.\n", hr);
+
+        ID3D12Fence_Release(fence);
+        ID3D12Device3_Release(device3);
+    }
+    else
+        skip("ID3D12Device3 not available.\n");
+
+    for (i = 0; i < ARRAY_SIZE(buffers); i++)
+    {
+        vkd3d_test_set_context("Buffer %u", i);
+
+        transition_resource_state(context.list, buffers[i],
+                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        get_buffer_readback_with_command_list(buffers[i], DXGI_FORMAT_R32_UINT, &rb, context.queue, context.list);
+        reset_command_list(context.list, context.allocator);
+
+        for (j = 0; j < ARRAY_SIZE(data); j++)
+        {
+            if (get_readback_uint(&rb, j, 0, 0) != data[j])
+                break;
+        }
+        ok(j == ARRAY_SIZE(data), "Got unexpected value %u at %u.\n",
+                j < ARRAY_SIZE(data) ? get_readback_uint(&rb, j, 0, 0) : 0, j);
+
+        release_resource_readback(&rb);
+    }
+    vkd3d_test_set_context(NULL);
+
+    ID3D12Resource_Release(placed_buffer);
+    ID3D12Resource_Release(committed_buffer);
+    ID3D12Heap_Release(heap);
+    destroy_test_context(&context);
+}
+
+void test_committed_resource_initial_contents(void)
+{
+    static const float red[] = {1.0f, 0.0f, 0.0f, 1.0f};
+    D3D12_TEXTURE_COPY_LOCATION src_location, dst_location;
+    D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+    ID3D12Resource *upload_buffer;
+    ID3D12DescriptorHeap *rtv_heap;
+    ID3D12Resource *textures[3];
+    ID3D12Resource *targets[2];
+    struct test_context_desc desc;
+    struct test_context context;
+    struct resource_readback rb;
+    uint32_t data[64 * 4];
+    unsigned int i;
+    D3D12_BOX box;
+    RECT rect;
+
+    /* Committed resources are zero-initialized. The zero-clear may be skipped
+     * when the first use overwrites the whole resource, so check that partially
+     * written resources still read back as zero everywhere else. */
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    desc.no_root_signature = true;
+    desc.no_pipeline = true;
+    if (!init_test_context(&context, &desc))
+        return;
+
+    for (i = 0; i < ARRAY_SIZE(data); i++)
+        data[i] = 0xdeadbeef;
+    upload_buffer = create_upload_buffer(context.device, sizeof(data), data);
+
+    for (i = 0; i < ARRAY_SIZE(textures); i++)
+    {
+        textures[i] = create_default_texture2d(context.device, 4, 4, 1, 2, DXGI_FORMAT_R8G8B8A8_UNORM,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+
+    src_location.pResource = upload_buffer;
+    src_location.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+    src_location.PlacedFootprint.Offset = 0;
+    src_location.PlacedFootprint.Footprint.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    src_location.PlacedFootprint.Footprint.Depth = 1;
+    src_location.PlacedFootprint.Footprint.RowPitch = D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+    dst_location.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+
+    /* Every subresource of textures[0] is overwritten, only the first mip of
+     * textures[1] and a corner of the first mip of textures[2]. */
+    for (i = 0; i < 2; i++)
+    {
+        src_location.PlacedFootprint.Footprint.Width = 4 >> i;
+        src_location.PlacedFootprint.Footprint.Height = 4 >> i;
+        dst_location.pResource = textures[0];
+        dst_location.SubresourceIndex = i;
+        ID3D12GraphicsCommandList_CopyTextureRegion(context.list, &dst_location, 0, 0, 0, &src_location, NULL);
+    }
+
+    src_location.PlacedFootprint.Footprint.Width = 4;
+    src_location.PlacedFootprint.Footprint.Height = 4;
+    dst_location.pResource = textures[1];
+    dst_location.SubresourceIndex = 0;
+    ID3D12GraphicsCommandList_CopyTextureRegion(context.list, &dst_location, 0, 0, 0, &src_location, NULL);
+
+    set_box(&box, 0, 0, 0, 2, 2, 1);
+    dst_location.pResource = textures[2];
+    ID3D12GraphicsCommandList_CopyTextureRegion(context.list, &dst_location, 1, 1, 0, &src_location, &box);
+
+    /* Render targets whose first use is a full or a partial clear. */
+    rtv_heap = create_cpu_descriptor_heap(context.device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV, ARRAY_SIZE(targets));
+    for (i = 0; i < ARRAY_SIZE(targets); i++)
+    {
+        targets[i] = create_default_texture(context.device, 4, 4, DXGI_FORMAT_R8G8B8A8_UNORM,
+                D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        rtv = get_cpu_rtv_handle(&context, rtv_heap, i);
+        ID3D12Device_CreateRenderTargetView(context.device, targets[i], NULL, rtv);
+    }
+
+    ID3D12GraphicsCommandList_ClearRenderTargetView(context.list, get_cpu_rtv_handle(&context, rtv_heap, 0), red, 0, NULL);
+    set_rect(&rect, 0, 0, 2, 4);
+    ID3D12GraphicsCommandList_ClearRenderTargetView(context.list, get_cpu_rtv_handle(&context, rtv_heap, 1), red, 1, &rect);
+
+    for (i = 0; i < ARRAY_SIZE(textures); i++)
+    {
+        transition_resource_state(context.list, textures[i],
+                D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    }
+    for (i = 0; i < ARRAY_SIZE(targets); i++)
+    {
+        transition_resource_state(context.list, targets[i],
+                D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    }
+
+    check_sub_resource_uint(textures[0], 0, context.queue, context.list, 0xdeadbeef, 0);
+    reset_command_list(context.list, context.allocator);
+    check_sub_resource_uint(textures[0], 1, context.queue, context.list, 0xdeadbeef, 0);
+    reset_command_list(context.list, context.allocator);
+
+    check_sub_resource_uint(textures[1], 0, context.queue, context.list, 0xdeadbeef, 0);
+    reset_command_list(context.list, context.allocator);
+    check_sub_resource_uint(textures[1], 1, context.queue, context.list, 0, 0);
+    reset_command_list(context.list, context.allocator);
+
+    get_texture_readback_with_command_list(textures[2], 0, &rb, context.queue, context.list);
+    set_box(&box, 1, 1, 0, 3, 3, 1);
+    check_readback_data_uint(&rb, &box, 0xdeadbeef, 0);
+    set_box(&box, 0, 0, 0, 4, 1, 1);
+    check_readback_data_uint(&rb, &box, 0, 0);
+    set_box(&box, 0, 3, 0, 4, 4, 1);
+    check_readback_data_uint(&rb, &box, 0, 0);
+    set_box(&box, 0, 1, 0, 1, 3, 1);
+    check_readback_data_uint(&rb, &box, 0, 0);
+    set_box(&box, 3, 1, 0, 4, 3, 1);
+    check_readback_data_uint(&rb, &box, 0, 0);
+    release_resource_readback(&rb);
+    reset_command_list(context.list, context.allocator);
+    check_sub_resource_uint(textures[2], 1, context.queue, context.list, 0, 0);
+    reset_command_list(context.list, context.allocator);
+
+    check_sub_resource_uint(targets[0], 0, context.queue, context.list, 0xff0000ff, 0);
+    reset_command_list(context.list, context.allocator);
+
+    get_texture_readback_with_command_list(targets[1], 0, &rb, context.queue, context.list);
+    set_box(&box, 0, 0, 0, 2, 4, 1);
+    check_readback_data_uint(&rb, &box, 0xff0000ff, 0);
+    set_box(&box, 2, 0, 0, 4, 4, 1);
+    check_readback_data_uint(&rb, &box, 0, 0);
+    release_resource_readback(&rb);
+
+    for (i = 0; i < ARRAY_SIZE(targets); i++)
+        ID3D12Resource_Release(targets[i]);
+    for (i = 0; i < ARRAY_SIZE(textures); i++)
+        ID3D12Resource_Release(textures[i]);
+    ID3D12DescriptorHeap_Release(rtv_heap);
+    ID3D12Resource_Release(upload_buffer);
+    destroy_test_context(&context);
+}
+
+void test_write_watch_device_ext(void)
+{
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC resource_desc;
+    struct test_context_desc desc;
+    struct test_context context;
+    ID3D12DeviceExt1 *device_ext;
+    void *addresses[16];
+    UINT64 address_count;
+    ID3D12Resource *buffer;
+    UINT32 granularity;
+    char *map_ptr;
+    HRESULT hr;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    desc.no_pipeline = true;
+    desc.no_root_signature = true;
+    if (!init_test_context(&context, &desc))
+        return;
+
+    if (FAILED(ID3D12Device_QueryInterface(context.device, &IID_ID3D12DeviceExt1, (void **)&device_ext)))
+    {
+        skip("ID3D12DeviceExt1 not available.\n");
+        destroy_test_context(&context);
+        return;
+    }
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    resource_desc.Alignment = 0;
+    resource_desc.Width = 64 * 1024;
+    resource_desc.Height = 1;
+    resource_desc.DepthOrArraySize = 1;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+    resource_desc.SampleDesc.Count = 1;
+    resource_desc.SampleDesc.Quality = 0;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    resource_desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    hr = ID3D12Device_CreateCommittedResource(context.device, &heap_properties,
+            D3D12_HEAP_FLAG_ALLOW_WRITE_WATCH, &resource_desc, D3D12_RESOURCE_STATE_GENERIC_READ,
+            NULL, &IID_ID3D12Resource, (void **)&buffer);
+    if (FAILED(hr))
+    {
+        skip("Failed to create write watch buffer, hr %#x.\n", hr);
+        ID3D12DeviceExt1_Release(device_ext);
+        destroy_test_context(&context);
+        return;
+    }
+
+    hr = ID3D12Resource_Map(buffer, 0, NULL, (void **)&map_ptr);
+    ok(hr == S_OK, "Got hr %#x, expected %#x.\n", hr, S_OK);
+
+    /* Importing the memory must not count as a write. */
+    address_count = ARRAY_SIZE(addresses);
+    hr = ID3D12DeviceExt1_GetWriteWatch(device_ext, 0, map_ptr, resource_desc.Width,
+            addresses, &address_count, &granularity);
+    ok(hr == S_OK, "Got hr %#x, expected %#x.\n", hr, S_OK);
+    ok(!address_count, "Got %"PRIu64" written pages on a fresh allocation.\n", address_count);
+
+    if (SUCCEEDED(hr) && granularity && resource_desc.Width >= 4 * granularity)
+    {
+        map_ptr[0] = 'a';
+        map_ptr[3 * granularity] = 'b';
+
+        address_count = ARRAY_SIZE(addresses);
+        hr = ID3D12DeviceExt1_GetWriteWatch(device_ext, D3D12_VK_WRITE_WATCH_FLAG_RESET, map_ptr, resource_desc.Width,
+                addresses, &address_count, &granularity);
+        ok(hr == S_OK, "Got hr %#x, expected %#x.\n", hr, S_OK);
+        ok(address_count == 2, "Got %"PRIu64" written pages, expected 2.\n", address_count);
+        if (address_count == 2)
+        {
+            ok(addresses[0] == map_ptr, "Got address %p, expected %p.\n", addresses[0], map_ptr);
+            ok(addresses[1] == &map_ptr[3 * granularity], "Got address %p, expected %p.\n",
+                    addresses[1], &map_ptr[3 * granularity]);
+        }
+
+        address_count = ARRAY_SIZE(addresses);
+        hr = ID3D12DeviceExt1_GetWriteWatch(device_ext, 0, map_ptr, resource_desc.Width,
+                addresses, &address_count, &granularity);
+        ok(hr == S_OK, "Got hr %#x, expected %#x.\n", hr, S_OK);
+        ok(!address_count, "Got %"PRIu64" written pages after reset.\n", address_count);
+    }
+
+    ID3D12Resource_Release(buffer);
+    ID3D12DeviceExt1_Release(device_ext);
+    destroy_test_context(&context);
+}
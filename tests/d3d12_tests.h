@@ -72,7 +72,13 @@ decl_test(test_texture_resource_barriers);
 decl_test(test_device_removed_reason);
 decl_test(test_map_resource);
 decl_test(test_map_placed_resources);
+decl_test(test_residency);
+decl_test(test_committed_resource_initial_contents);
+decl_test(test_write_watch_device_ext);
 decl_test(test_bundle_state_inheritance);
+decl_test(test_bundle_reuse);
+decl_test(test_bundle_baked_state_leak);
+decl_test(test_record_time_rtv_descriptors);
 decl_test(test_shader_instructions);
 decl_test(test_shader_instructions_dxil);
 decl_test(test_compute_shader_instructions);
@@ -102,6 +108,7 @@ decl_test(test_update_compute_descriptor_tables);
 decl_test(test_update_descriptor_tables_after_root_signature_change);
 decl_test(test_copy_descriptors);
 decl_test(test_copy_descriptors_range_sizes);
+decl_test(test_copy_descriptors_batched);
 decl_test(test_copy_rtv_descriptors);
 decl_test(test_descriptors_visibility);
 decl_test(test_create_null_descriptors);
@@ -147,6 +154,7 @@ decl_test(test_copy_texture_buffer);
 decl_test(test_copy_buffer_texture);
 decl_test(test_copy_block_compressed_texture);
 decl_test(test_copy_buffer_overlap);
+decl_test(test_copy_buffer_transfer_offload);
 decl_test(test_separate_bindings);
 decl_test(test_face_culling_dxbc);
 decl_test(test_face_culling_dxil);
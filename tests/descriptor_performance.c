@@ -21,6 +21,110 @@
 #define INITGUID
 #define VKD3D_TEST_DECLARE_MAIN
 #include "d3d12_crosstest.h"
+#include "d3d12_benchmark.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+enum output_format
+{
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV,
+    OUTPUT_FORMAT_JSON,
+};
+
+static struct
+{
+    unsigned int heap_size;
+    unsigned int max_threads;
+    unsigned int iterations;
+    enum output_format format;
+    bool first_result;
+    bool tlb_misses;
+} options = { 1000000, 1, 100, OUTPUT_FORMAT_TEXT, true, false };
+
+/* Counts dTLB read misses of the calling thread. Threaded benchmarks are not covered. */
+static struct
+{
+    int fd;
+    uint64_t begin_count;
+    uint64_t misses;
+    bool valid;
+} tlb_counter = { -1 };
+
+#define SAMPLER_HEAP_SIZE 2048
+#define SCATTERED_RANGES_PER_CALL 64
+
+static void parse_benchmark_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--heap-size") && i + 1 < argc)
+            options.heap_size = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            options.max_threads = parse_benchmark_uint(argv[++i], 1, MAX_BENCHMARK_THREADS);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            options.iterations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--csv"))
+            options.format = OUTPUT_FORMAT_CSV;
+        else if (!strcmp(argv[i], "--json"))
+            options.format = OUTPUT_FORMAT_JSON;
+        else if (!strcmp(argv[i], "--tlb-misses"))
+            options.tlb_misses = true;
+    }
+}
+
+static void tlb_counter_init(void)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    if ((tlb_counter.fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0)) < 0)
+        fprintf(stderr, "Failed to open dTLB miss counter, errno %d. Check kernel.perf_event_paranoid.\n", errno);
+#else
+    fprintf(stderr, "dTLB miss counters are not supported on this platform.\n");
+#endif
+}
+
+static uint64_t tlb_counter_read(void)
+{
+    uint64_t count = 0;
+
+#ifdef __linux__
+    if (read(tlb_counter.fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+#endif
+
+    return count;
+}
+
+static void tlb_counter_begin(void)
+{
+    if (tlb_counter.fd >= 0)
+        tlb_counter.begin_count = tlb_counter_read();
+}
+
+static void tlb_counter_end(void)
+{
+    if (tlb_counter.fd < 0)
+        return;
+
+    tlb_counter.misses = tlb_counter_read() - tlb_counter.begin_count;
+    tlb_counter.valid = true;
+}
 
 static void setup(int argc, char **argv)
 {
@@ -29,6 +133,9 @@ static void setup(int argc, char **argv)
     pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
 
     parse_args(argc, argv);
+    parse_benchmark_args(argc, argv);
+    if (options.tlb_misses)
+        tlb_counter_init();
     enable_d3d12_debug_layer(argc, argv);
     init_adapter_info();
 
@@ -36,18 +143,63 @@ static void setup(int argc, char **argv)
     pfn_D3D12SerializeVersionedRootSignature = get_d3d12_pfn(D3D12SerializeVersionedRootSignature);
 }
 
-static double get_time(void)
+static void report_begin(void)
 {
-#ifdef _WIN32
-    LARGE_INTEGER lc, lf;
-    QueryPerformanceCounter(&lc);
-    QueryPerformanceFrequency(&lf);
-    return (double)lc.QuadPart / (double)lf.QuadPart;
-#else
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
-    return ts.tv_sec + 1e-9 * ts.tv_nsec;
-#endif
+    if (options.format == OUTPUT_FORMAT_CSV)
+        printf("benchmark,threads,descriptors,total_ms,ns_per_descriptor%s\n",
+                options.tlb_misses ? ",dtlb_misses_per_descriptor" : "");
+    else if (options.format == OUTPUT_FORMAT_JSON)
+        printf("[\n");
+}
+
+static void report_end(void)
+{
+    if (options.format == OUTPUT_FORMAT_JSON)
+        printf("\n]\n");
+}
+
+static void report_result(const char *name, unsigned int thread_count, unsigned int count, double seconds)
+{
+    double ns_per_descriptor = 1e9 * seconds / (double)max(count, 1);
+    double tlb_misses_per_descriptor = 0.0;
+    char tlb_misses[64] = "";
+
+    if (tlb_counter.valid)
+        tlb_misses_per_descriptor = (double)tlb_counter.misses / (double)max(count, 1);
+
+    switch (options.format)
+    {
+        case OUTPUT_FORMAT_CSV:
+            if (options.tlb_misses && tlb_counter.valid)
+                snprintf(tlb_misses, sizeof(tlb_misses), ",%.3f", tlb_misses_per_descriptor);
+            else if (options.tlb_misses)
+                strcpy(tlb_misses, ",");
+            printf("%s,%u,%u,%.3f,%.3f%s\n", name, thread_count, count, 1e3 * seconds, ns_per_descriptor, tlb_misses);
+            break;
+
+        case OUTPUT_FORMAT_JSON:
+            if (tlb_counter.valid)
+            {
+                snprintf(tlb_misses, sizeof(tlb_misses), ", \"dtlb_misses_per_descriptor\": %.3f",
+                        tlb_misses_per_descriptor);
+            }
+            printf("%s  { \"benchmark\": \"%s\", \"threads\": %u, \"descriptors\": %u, "
+                    "\"total_ms\": %.3f, \"ns_per_descriptor\": %.3f%s }",
+                    options.first_result ? "" : ",\n", name, thread_count, count,
+                    1e3 * seconds, ns_per_descriptor, tlb_misses);
+            break;
+
+        default:
+            if (tlb_counter.valid)
+                snprintf(tlb_misses, sizeof(tlb_misses), ", %.3f dTLB misses", tlb_misses_per_descriptor);
+            printf("%s: %u descriptors on %u thread(s) took %.3f ms (%.3f ns%s per descriptor).\n",
+                    name, count, thread_count, 1e3 * seconds, ns_per_descriptor, tlb_misses);
+            break;
+    }
+
+    tlb_counter.valid = false;
+    options.first_result = false;
+    fflush(stdout);
 }
 
 static void fill_descriptor_heap_srv(ID3D12Device *device, ID3D12DescriptorHeap *heap,
@@ -108,6 +260,244 @@ static void zero_descriptor_heap(ID3D12Device *device, ID3D12DescriptorHeap *hea
     fill_descriptor_heap_srv(device, heap, NULL, &srv_desc, count);
 }
 
+struct threaded_context;
+
+struct threaded_worker
+{
+    const struct threaded_context *context;
+    unsigned int index;
+    unsigned int first;
+    unsigned int count;
+    unsigned int completed;
+    double start_time;
+    double end_time;
+};
+
+typedef void (*threaded_work_pfn)(struct threaded_worker *worker);
+
+struct threaded_context
+{
+    ID3D12Device *device;
+    ID3D12DescriptorHeap *gpu_heap;
+    ID3D12DescriptorHeap *cpu_heap;
+    ID3D12DescriptorHeap *sampler_heap;
+    ID3D12Resource *texture;
+    const D3D12_SHADER_RESOURCE_VIEW_DESC *srv_desc;
+    unsigned int thread_count;
+    threaded_work_pfn work;
+};
+
+static uint32_t lcg_next(uint32_t *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return *state >> 16;
+}
+
+static D3D12_CPU_DESCRIPTOR_HANDLE offset_cpu_handle(ID3D12Device *device, ID3D12DescriptorHeap *heap,
+        D3D12_DESCRIPTOR_HEAP_TYPE type, unsigned int index)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    handle.ptr += (SIZE_T)index * ID3D12Device_GetDescriptorHandleIncrementSize(device, type);
+    return handle;
+}
+
+static void threaded_create_srv(struct threaded_worker *worker)
+{
+    const struct threaded_context *context = worker->context;
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+    UINT stride, i;
+
+    stride = ID3D12Device_GetDescriptorHandleIncrementSize(context->device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    cpu_handle = offset_cpu_handle(context->device, context->cpu_heap,
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, worker->first);
+
+    for (i = 0; i < worker->count; i++)
+    {
+        ID3D12Device_CreateShaderResourceView(context->device, context->texture, context->srv_desc, cpu_handle);
+        cpu_handle.ptr += stride;
+    }
+
+    worker->completed = worker->count;
+}
+
+static void threaded_copy_descriptors_simple(struct threaded_worker *worker)
+{
+    const struct threaded_context *context = worker->context;
+    D3D12_CPU_DESCRIPTOR_HANDLE gpu, cpu;
+    UINT stride, i;
+
+    stride = ID3D12Device_GetDescriptorHandleIncrementSize(context->device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    gpu = offset_cpu_handle(context->device, context->gpu_heap, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, worker->first);
+    cpu = offset_cpu_handle(context->device, context->cpu_heap, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, worker->first);
+
+    for (i = 0; i < worker->count; i++)
+    {
+        ID3D12Device_CopyDescriptorsSimple(context->device, 1, gpu, cpu, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        gpu.ptr += stride;
+        cpu.ptr += stride;
+    }
+
+    worker->completed = worker->count;
+}
+
+static void threaded_copy_descriptors_scattered(struct threaded_worker *worker)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE dst_ranges[SCATTERED_RANGES_PER_CALL];
+    D3D12_CPU_DESCRIPTOR_HANDLE src_ranges[SCATTERED_RANGES_PER_CALL];
+    const struct threaded_context *context = worker->context;
+    UINT range_sizes[SCATTERED_RANGES_PER_CALL];
+    unsigned int cursor, end, range_count, size;
+    D3D12_CPU_DESCRIPTOR_HANDLE gpu, cpu;
+    uint32_t seed = worker->index + 1;
+    UINT stride;
+
+    stride = ID3D12Device_GetDescriptorHandleIncrementSize(context->device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    gpu = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(context->gpu_heap);
+    cpu = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(context->cpu_heap);
+
+    cursor = worker->first;
+    end = worker->first + worker->count;
+    worker->completed = 0;
+
+    /* Mimic root table updates: short ranges gathered from all over a staging heap,
+     * written mostly contiguously into the shader visible heap. */
+    while (cursor < end)
+    {
+        for (range_count = 0; range_count < SCATTERED_RANGES_PER_CALL && cursor < end; range_count++)
+        {
+            size = min(1 + lcg_next(&seed) % 8, end - cursor);
+            dst_ranges[range_count].ptr = gpu.ptr + (SIZE_T)cursor * stride;
+            src_ranges[range_count].ptr = cpu.ptr +
+                    (SIZE_T)(worker->first + lcg_next(&seed) % (worker->count - size + 1)) * stride;
+            range_sizes[range_count] = size;
+            worker->completed += size;
+            cursor += size + lcg_next(&seed) % 4;
+        }
+
+        ID3D12Device_CopyDescriptors(context->device,
+                range_count, dst_ranges, range_sizes,
+                range_count, src_ranges, range_sizes,
+                D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+}
+
+static void threaded_create_sampler(struct threaded_worker *worker)
+{
+    const struct threaded_context *context = worker->context;
+    unsigned int slots_per_thread, i;
+    D3D12_CPU_DESCRIPTOR_HANDLE base;
+    D3D12_SAMPLER_DESC desc;
+    UINT stride;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.Filter = D3D12_FILTER_ANISOTROPIC;
+    desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    desc.MaxAnisotropy = 16;
+    desc.ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER;
+    desc.MaxLOD = D3D12_FLOAT32_MAX;
+
+    stride = ID3D12Device_GetDescriptorHandleIncrementSize(context->device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+    slots_per_thread = SAMPLER_HEAP_SIZE / context->thread_count;
+    base = offset_cpu_handle(context->device, context->sampler_heap,
+            D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, worker->index * slots_per_thread);
+
+    /* A small set of unique samplers, so this mostly measures sampler map lookups. */
+    for (i = 0; i < worker->count; i++)
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE handle = base;
+        handle.ptr += (SIZE_T)(i % slots_per_thread) * stride;
+        desc.MipLODBias = (float)(i % 16) * 0.25f;
+        ID3D12Device_CreateSampler(context->device, &desc, handle);
+    }
+
+    worker->completed = worker->count;
+}
+
+static void threaded_worker_main(void *userdata)
+{
+    struct threaded_worker *worker = userdata;
+
+    worker->start_time = get_time();
+    worker->context->work(worker);
+    worker->end_time = get_time();
+}
+
+static void run_threaded_benchmark(struct threaded_context *context, const char *name,
+        threaded_work_pfn work, unsigned int thread_count, unsigned int count)
+{
+    struct threaded_worker workers[MAX_BENCHMARK_THREADS];
+    unsigned int i, per_thread, completed;
+    double start_time, end_time;
+
+    context->work = work;
+    context->thread_count = thread_count;
+    per_thread = count / thread_count;
+
+    for (i = 0; i < thread_count; i++)
+    {
+        workers[i].context = context;
+        workers[i].index = i;
+        workers[i].first = i * per_thread;
+        workers[i].count = i + 1 == thread_count ? count - workers[i].first : per_thread;
+        workers[i].completed = 0;
+    }
+
+    run_benchmark_threads(threaded_worker_main, workers, sizeof(*workers), thread_count);
+
+    /* Threads start staggered, so measure from the first start to the last finish. */
+    start_time = workers[0].start_time;
+    end_time = workers[0].end_time;
+    completed = 0;
+
+    for (i = 0; i < thread_count; i++)
+    {
+        start_time = min(start_time, workers[i].start_time);
+        end_time = max(end_time, workers[i].end_time);
+        completed += workers[i].completed;
+    }
+
+    report_result(name, thread_count, completed, end_time - start_time);
+}
+
+static void do_threaded_benchmark_run(ID3D12Device *device, ID3D12DescriptorHeap *gpu_heap,
+        ID3D12DescriptorHeap *cpu_heap, ID3D12Resource *texture, const D3D12_SHADER_RESOURCE_VIEW_DESC *srv_desc)
+{
+    struct threaded_context context;
+    D3D12_DESCRIPTOR_HEAP_DESC heap_desc;
+    unsigned int thread_count;
+    HRESULT hr;
+
+    memset(&context, 0, sizeof(context));
+    context.device = device;
+    context.gpu_heap = gpu_heap;
+    context.cpu_heap = cpu_heap;
+    context.texture = texture;
+    context.srv_desc = srv_desc;
+
+    heap_desc.NumDescriptors = SAMPLER_HEAP_SIZE;
+    heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
+    heap_desc.NodeMask = 0;
+    hr = ID3D12Device_CreateDescriptorHeap(device, &heap_desc, &IID_ID3D12DescriptorHeap, (void**)&context.sampler_heap);
+    ok(SUCCEEDED(hr), "Failed to create descriptor heap, hr #%x.\n", hr);
+
+    for_each_benchmark_thread_count(thread_count, options.max_threads)
+    {
+        run_threaded_benchmark(&context, "threaded_create_srv",
+                threaded_create_srv, thread_count, options.heap_size);
+        run_threaded_benchmark(&context, "threaded_copy_descriptors_simple",
+                threaded_copy_descriptors_simple, thread_count, options.heap_size);
+        run_threaded_benchmark(&context, "threaded_copy_descriptors_scattered",
+                threaded_copy_descriptors_scattered, thread_count, options.heap_size);
+        run_threaded_benchmark(&context, "threaded_create_sampler",
+                threaded_create_sampler, thread_count, options.heap_size);
+    }
+
+    ID3D12DescriptorHeap_Release(context.sampler_heap);
+}
+
 static void do_benchmark_run(ID3D12Device *device)
 {
     D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
@@ -118,7 +508,7 @@ static void do_benchmark_run(ID3D12Device *device)
     ID3D12Resource *texture;
     HRESULT hr;
 
-    heap_desc.NumDescriptors = 1000000;
+    heap_desc.NumDescriptors = options.heap_size;
     heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
     heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
     heap_desc.NodeMask = 0;
@@ -142,88 +532,110 @@ static void do_benchmark_run(ID3D12Device *device)
     srv_desc.Texture2D.PlaneSlice = 0;
     srv_desc.Texture2D.ResourceMinLODClamp = 0.0f;
 
-    /* Benchmark creation of 1 million SRVs in CPU-only heaps. */
+    /* Benchmark creation of SRVs in CPU-only heaps. */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        fill_descriptor_heap_srv(device, cpu_heap, texture, &srv_desc, 1000000);
+        fill_descriptor_heap_srv(device, cpu_heap, texture, &srv_desc, options.heap_size);
         end_time = get_time();
-        printf("Creating 1M SRVs on blank CPU heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("create_srv_cpu_heap_blank", 1, options.heap_size, end_time - start_time);
     }
 
     /* Do the same thing again, but this time on a used heap, so we also have to destroy existing views. */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        fill_descriptor_heap_srv(device, cpu_heap, texture, &srv_desc, 1000000);
+        fill_descriptor_heap_srv(device, cpu_heap, texture, &srv_desc, options.heap_size);
         end_time = get_time();
-        printf("Creating 1M SRVs on dirty CPU heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("create_srv_cpu_heap_dirty", 1, options.heap_size, end_time - start_time);
     }
 
     /* Fill shader visible heaps */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        fill_descriptor_heap_srv(device, gpu_heap, texture, &srv_desc, 1000000);
+        fill_descriptor_heap_srv(device, gpu_heap, texture, &srv_desc, options.heap_size);
         end_time = get_time();
-        printf("Creating 1M SRVs on blank GPU-visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("create_srv_gpu_heap_blank", 1, options.heap_size, end_time - start_time);
     }
 
     /* Do the same thing again, but this time on a used heap, so we also have to destroy existing views. */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        fill_descriptor_heap_srv(device, gpu_heap, texture, &srv_desc, 1000000);
+        fill_descriptor_heap_srv(device, gpu_heap, texture, &srv_desc, options.heap_size);
         end_time = get_time();
-        printf("Creating 1M SRVs on dirty GPU-visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("create_srv_gpu_heap_dirty", 1, options.heap_size, end_time - start_time);
     }
 
     /* Try copying descriptors */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        copy_descriptor_heap(device, gpu_heap, cpu_heap, 1000000);
+        copy_descriptor_heap(device, gpu_heap, cpu_heap, options.heap_size);
         end_time = get_time();
-        printf("Copying 1M SRVs to dirty GPU visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("copy_srv_range_dirty", 1, options.heap_size, end_time - start_time);
     }
 
     /* Try copying descriptors with duplication */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        copy_descriptor_heap(device, gpu_heap, cpu_heap, 1000000);
+        copy_descriptor_heap(device, gpu_heap, cpu_heap, options.heap_size);
         end_time = get_time();
-        printf("Copying 1M SRVs (duplicates) took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("copy_srv_range_duplicates", 1, options.heap_size, end_time - start_time);
     }
 
     /* Create zero descriptors. */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        zero_descriptor_heap(device, gpu_heap, 1000000);
+        zero_descriptor_heap(device, gpu_heap, options.heap_size);
         end_time = get_time();
-        printf("Creating 1M null-SRVs took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("create_null_srv", 1, options.heap_size, end_time - start_time);
     }
 
     /* Try copying descriptors on top of zero-initialized descriptor heap. */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        copy_descriptor_heap(device, gpu_heap, cpu_heap, 1000000);
+        copy_descriptor_heap(device, gpu_heap, cpu_heap, options.heap_size);
         end_time = get_time();
-        printf("Copying 1M SRVs to zeroed GPU visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("copy_srv_range_zeroed", 1, options.heap_size, end_time - start_time);
     }
 
     /* Try copying descriptors one at a time on top of zero-initialized descriptor heap. */
     {
+        tlb_counter_begin();
         start_time = get_time();
-        copy_descriptor_heap_single(device, gpu_heap, cpu_heap, 1000000);
+        copy_descriptor_heap_single(device, gpu_heap, cpu_heap, options.heap_size);
         end_time = get_time();
-        printf("Copying 1M individual SRVs to GPU visible heap (duplicates) took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("copy_srv_single_duplicates", 1, options.heap_size, end_time - start_time);
     }
 
     /* Create zero descriptors. */
-    zero_descriptor_heap(device, gpu_heap, 1000000);
+    zero_descriptor_heap(device, gpu_heap, options.heap_size);
 
     {
+        tlb_counter_begin();
         start_time = get_time();
-        copy_descriptor_heap_single(device, gpu_heap, cpu_heap, 1000000);
+        copy_descriptor_heap_single(device, gpu_heap, cpu_heap, options.heap_size);
         end_time = get_time();
-        printf("Copying 1M individual SRVs to zeroed GPU visible heap took: %.3f ms.\n", 1e3 * (end_time - start_time));
+        tlb_counter_end();
+        report_result("copy_srv_single_zeroed", 1, options.heap_size, end_time - start_time);
     }
 
+    do_threaded_benchmark_run(device, gpu_heap, cpu_heap, texture, &srv_desc);
+
     ID3D12Resource_Release(texture);
     ID3D12DescriptorHeap_Release(cpu_heap);
     ID3D12DescriptorHeap_Release(gpu_heap);
@@ -238,8 +650,10 @@ START_TEST(descriptor_performance)
     device = create_device();
     ok(device != NULL, "Failed to create device.\n");
 
-    for (i = 0; i < 100; i++)
+    report_begin();
+    for (i = 0; i < options.iterations; i++)
         do_benchmark_run(device);
+    report_end();
 
     ID3D12Device_Release(device);
 }
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Compares plain memcpy against the streaming copy kernels used by
+ * WriteToSubresource and ReadFromSubresource, on system memory and on mapped
+ * UPLOAD, READBACK and write-combined CUSTOM heaps. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define INITGUID
+#define VKD3D_TEST_DECLARE_MAIN
+#include "d3d12_crosstest.h"
+#include "d3d12_benchmark.h"
+#include "vkd3d_memcpy.h"
+
+enum output_format
+{
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV,
+};
+
+static struct
+{
+    unsigned int size_mib;
+    unsigned int samples;
+    unsigned int iterations;
+    enum output_format format;
+} options = { 16, 64, 1, OUTPUT_FORMAT_TEXT };
+
+enum copy_op
+{
+    COPY_OP_WRITE_MEMCPY,
+    COPY_OP_WRITE_STREAM,
+    COPY_OP_READ_MEMCPY,
+    COPY_OP_READ_STREAM,
+    COPY_OP_COUNT,
+};
+
+static const char * const copy_op_names[] =
+{
+    "write_memcpy",
+    "write_stream",
+    "read_memcpy",
+    "read_stream",
+};
+
+STATIC_ASSERT(ARRAY_SIZE(copy_op_names) == COPY_OP_COUNT);
+
+struct copy_target
+{
+    const char *name;
+    ID3D12Resource *resource;
+    uint8_t *ptr;
+};
+
+static void parse_benchmark_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--size") && i + 1 < argc)
+            options.size_mib = parse_benchmark_uint(argv[++i], 1, 1024);
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+            options.samples = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            options.iterations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--csv"))
+            options.format = OUTPUT_FORMAT_CSV;
+    }
+}
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    parse_benchmark_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+static void report_begin(void)
+{
+    if (options.format == OUTPUT_FORMAT_CSV)
+        printf("target,operation,size_bytes,samples,mean_us,p50_us,p99_us,mib_per_sec\n");
+}
+
+static void report_result(const char *target, const char *operation, size_t size,
+        double *samples, unsigned int count)
+{
+    double mean, p50, p99, mib_per_sec;
+    unsigned int i;
+
+    if (!count)
+        return;
+
+    qsort(samples, count, sizeof(*samples), compare_double);
+
+    for (i = 0, mean = 0.0; i < count; i++)
+        mean += samples[i];
+    mean /= (double)count;
+
+    p50 = get_percentile(samples, count, 0.50);
+    p99 = get_percentile(samples, count, 0.99);
+    mib_per_sec = p50 > 0.0 ? (double)size / (1024.0 * 1024.0) / p50 : 0.0;
+
+    switch (options.format)
+    {
+        case OUTPUT_FORMAT_CSV:
+            printf("%s,%s,%zu,%u,%.3f,%.3f,%.3f,%.1f\n", target, operation, size, count,
+                    1e6 * mean, 1e6 * p50, 1e6 * p99, mib_per_sec);
+            break;
+
+        default:
+            printf("%s %s: %zu KiB, %u samples, %.1f MiB/s, mean %.3f us, p50 %.3f us, p99 %.3f us.\n",
+                    target, operation, size >> 10, count, mib_per_sec, 1e6 * mean, 1e6 * p50, 1e6 * p99);
+            break;
+    }
+
+    fflush(stdout);
+}
+
+static bool create_mapped_target(ID3D12Device *device, const D3D12_HEAP_PROPERTIES *heap_properties,
+        D3D12_RESOURCE_STATES initial_state, size_t size, const char *name, struct copy_target *target)
+{
+    D3D12_RESOURCE_DESC resource_desc;
+    D3D12_RANGE read_range;
+    void *ptr;
+    HRESULT hr;
+
+    memset(target, 0, sizeof(*target));
+    target->name = name;
+
+    memset(&resource_desc, 0, sizeof(resource_desc));
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    resource_desc.Width = size;
+    resource_desc.Height = 1;
+    resource_desc.DepthOrArraySize = 1;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+    resource_desc.SampleDesc.Count = 1;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    resource_desc.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+
+    if (FAILED(hr = ID3D12Device_CreateCommittedResource(device, heap_properties, D3D12_HEAP_FLAG_NONE,
+            &resource_desc, initial_state, NULL, &IID_ID3D12Resource, (void **)&target->resource)))
+    {
+        skip("Failed to create %s buffer, hr %#x.\n", name, hr);
+        return false;
+    }
+
+    read_range.Begin = 0;
+    read_range.End = size;
+    if (FAILED(hr = ID3D12Resource_Map(target->resource, 0, &read_range, &ptr)))
+    {
+        skip("Failed to map %s buffer, hr %#x.\n", name, hr);
+        ID3D12Resource_Release(target->resource);
+        target->resource = NULL;
+        return false;
+    }
+
+    target->ptr = ptr;
+    return true;
+}
+
+static void destroy_target(struct copy_target *target)
+{
+    if (target->resource)
+    {
+        ID3D12Resource_Unmap(target->resource, 0, NULL);
+        ID3D12Resource_Release(target->resource);
+    }
+}
+
+static void benchmark_target(const struct copy_target *target, uint8_t *src, uint8_t *dst,
+        size_t size, double *samples)
+{
+    bool stream_load = vkd3d_memcpy_stream_load_supported();
+    double start_time;
+    unsigned int op, i;
+
+    for (op = 0; op < COPY_OP_COUNT; op++)
+    {
+        /* Read back the reference pattern in the read tests */
+        if (op == COPY_OP_READ_MEMCPY)
+            memcpy(target->ptr, src, size);
+
+        for (i = 0; i < options.samples; i++)
+        {
+            start_time = get_time();
+
+            switch (op)
+            {
+                case COPY_OP_WRITE_MEMCPY:
+                    memcpy(target->ptr, src, size);
+                    break;
+
+                case COPY_OP_WRITE_STREAM:
+                    vkd3d_memcpy_stream_store(target->ptr, src, size);
+                    vkd3d_memcpy_stream_store_fence();
+                    break;
+
+                case COPY_OP_READ_MEMCPY:
+                    memcpy(dst, target->ptr, size);
+                    break;
+
+                case COPY_OP_READ_STREAM:
+                    vkd3d_memcpy_stream_load_fence();
+                    vkd3d_memcpy_stream_load(dst, target->ptr, size, stream_load);
+                    break;
+            }
+
+            samples[i] = get_time() - start_time;
+        }
+
+        if (op < COPY_OP_READ_MEMCPY)
+            ok(!memcmp(target->ptr, src, size), "%s: %s copy mismatch.\n", target->name, copy_op_names[op]);
+        else
+        {
+            ok(!memcmp(dst, src, size), "%s: %s copy mismatch.\n", target->name, copy_op_names[op]);
+            memset(dst, 0, size);
+        }
+
+        report_result(target->name, copy_op_names[op], size, samples, options.samples);
+    }
+}
+
+static void do_benchmark_run(ID3D12Device *device, uint8_t *src, uint8_t *dst, uint8_t *system,
+        size_t size, double *samples)
+{
+    D3D12_HEAP_PROPERTIES heap_properties;
+    struct copy_target target;
+
+    target.name = "system";
+    target.resource = NULL;
+    target.ptr = system;
+    benchmark_target(&target, src, dst, size, samples);
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+    if (create_mapped_target(device, &heap_properties, D3D12_RESOURCE_STATE_GENERIC_READ, size, "upload", &target))
+    {
+        benchmark_target(&target, src, dst, size, samples);
+        destroy_target(&target);
+    }
+
+    heap_properties.Type = D3D12_HEAP_TYPE_READBACK;
+    if (create_mapped_target(device, &heap_properties, D3D12_RESOURCE_STATE_COPY_DEST, size, "readback", &target))
+    {
+        benchmark_target(&target, src, dst, size, samples);
+        destroy_target(&target);
+    }
+
+    heap_properties.Type = D3D12_HEAP_TYPE_CUSTOM;
+    heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_COMBINE;
+    heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+    if (create_mapped_target(device, &heap_properties, D3D12_RESOURCE_STATE_COMMON, size, "custom_wc", &target))
+    {
+        benchmark_target(&target, src, dst, size, samples);
+        destroy_target(&target);
+    }
+}
+
+START_TEST(memcpy_performance)
+{
+    uint8_t *src, *dst, *system;
+    ID3D12Device *device;
+    double *samples;
+    unsigned int i;
+    size_t size;
+
+    setup(argc, argv);
+    device = create_device();
+    ok(device != NULL, "Failed to create device.\n");
+
+    size = (size_t)options.size_mib << 20;
+    src = malloc(size);
+    dst = calloc(1, size);
+    system = malloc(size);
+    samples = malloc(options.samples * sizeof(*samples));
+    ok(src && dst && system && samples, "Failed to allocate memory.\n");
+
+    for (i = 0; i < size / sizeof(uint32_t); i++)
+        ((uint32_t *)src)[i] = i * 0x9e3779b9u;
+
+    report_begin();
+    for (i = 0; i < options.iterations; i++)
+        do_benchmark_run(device, src, dst, system, size, samples);
+
+    free(samples);
+    free(system);
+    free(dst);
+    free(src);
+    ID3D12Device_Release(device);
+}
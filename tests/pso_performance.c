@@ -0,0 +1,617 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Measures PSO creation from scratch against loading the same PSOs from a
+ * serialized pipeline library on a fresh device.
+ *
+ * Which parts of the library are warm is controlled through VKD3D_CONFIG, since
+ * config flags are only parsed once per process: by default both the SPIR-V and
+ * the VkPipelineCache data are used, pipeline_library_ignore_spirv only keeps the
+ * driver cache warm. The load results are tagged accordingly. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define INITGUID
+#define VKD3D_TEST_DECLARE_MAIN
+#include "d3d12_crosstest.h"
+#include "d3d12_benchmark.h"
+
+enum output_format
+{
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV,
+};
+
+static struct
+{
+    unsigned int graphics_count;
+    unsigned int compute_count;
+    unsigned int max_threads;
+    unsigned int iterations;
+    enum output_format format;
+    const char *vs_path;
+    const char *ps_path;
+    const char *cs_path;
+} options = { 256, 64, 4, 1, OUTPUT_FORMAT_TEXT };
+
+#define MAX_PSO_COUNT 4096
+/* Root signatures only differ in their number of root constants, which is also
+ * what makes compute PSOs built from a single shader unique. */
+#define ROOT_SIGNATURE_VARIANT_COUNT 64
+
+static void parse_benchmark_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--graphics") && i + 1 < argc)
+            options.graphics_count = parse_benchmark_uint(argv[++i], 0, MAX_PSO_COUNT);
+        else if (!strcmp(argv[i], "--compute") && i + 1 < argc)
+            options.compute_count = parse_benchmark_uint(argv[++i], 0, MAX_PSO_COUNT);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            options.max_threads = parse_benchmark_uint(argv[++i], 1, MAX_BENCHMARK_THREADS);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            options.iterations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--vs") && i + 1 < argc)
+            options.vs_path = argv[++i];
+        else if (!strcmp(argv[i], "--ps") && i + 1 < argc)
+            options.ps_path = argv[++i];
+        else if (!strcmp(argv[i], "--cs") && i + 1 < argc)
+            options.cs_path = argv[++i];
+        else if (!strcmp(argv[i], "--csv"))
+            options.format = OUTPUT_FORMAT_CSV;
+    }
+}
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    parse_benchmark_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+static void report_begin(void)
+{
+    if (options.format == OUTPUT_FORMAT_CSV)
+        printf("benchmark,threads,samples,mean_us,p50_us,p90_us,p99_us,max_us,bytes\n");
+}
+
+static void report_result(const char *name, unsigned int thread_count,
+        double *samples, unsigned int count, size_t bytes)
+{
+    double mean, p50, p90, p99, max_value;
+    unsigned int i;
+
+    if (!count)
+        return;
+
+    qsort(samples, count, sizeof(*samples), compare_double);
+
+    for (i = 0, mean = 0.0; i < count; i++)
+        mean += samples[i];
+    mean /= (double)count;
+
+    p50 = get_percentile(samples, count, 0.50);
+    p90 = get_percentile(samples, count, 0.90);
+    p99 = get_percentile(samples, count, 0.99);
+    max_value = samples[count - 1];
+
+    switch (options.format)
+    {
+        case OUTPUT_FORMAT_CSV:
+            printf("%s,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%zu\n", name, thread_count, count,
+                    1e6 * mean, 1e6 * p50, 1e6 * p90, 1e6 * p99, 1e6 * max_value, bytes);
+            break;
+
+        default:
+            printf("%s: %u samples on %u thread(s), mean %.3f us, p50 %.3f us, p90 %.3f us, "
+                    "p99 %.3f us, max %.3f us", name, count, thread_count,
+                    1e6 * mean, 1e6 * p50, 1e6 * p90, 1e6 * p99, 1e6 * max_value);
+            if (bytes)
+                printf(", %zu bytes", bytes);
+            printf(".\n");
+            break;
+    }
+
+    fflush(stdout);
+}
+
+static const char *get_warm_variant_name(void)
+{
+    const char *config = getenv("VKD3D_CONFIG");
+
+    if (config && strstr(config, "pipeline_library_ignore_spirv"))
+        return "warm_driver";
+    return "warm_spirv";
+}
+
+static bool load_shader_file(const char *path, D3D12_SHADER_BYTECODE *bytecode)
+{
+    void *data;
+    long size;
+    FILE *f;
+
+    if (!(f = fopen(path, "rb")))
+    {
+        ok(false, "Failed to open %s.\n", path);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size <= 0 || !(data = malloc(size)) || fread(data, 1, size, f) != (size_t)size)
+    {
+        ok(false, "Failed to read %s.\n", path);
+        fclose(f);
+        return false;
+    }
+
+    fclose(f);
+    bytecode->pShaderBytecode = data;
+    bytecode->BytecodeLength = size;
+    return true;
+}
+
+static void make_pso_name(WCHAR *name, char prefix, unsigned int index)
+{
+    char buffer[16];
+    unsigned int i;
+
+    sprintf(buffer, "%c%u", prefix, index);
+    for (i = 0; buffer[i]; i++)
+        name[i] = buffer[i];
+    name[i] = 0;
+}
+
+struct pso_corpus
+{
+    ID3D12RootSignature *root_signatures[ROOT_SIGNATURE_VARIANT_COUNT];
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC *graphics_descs;
+    D3D12_COMPUTE_PIPELINE_STATE_DESC *compute_descs;
+    unsigned int graphics_count;
+    unsigned int compute_count;
+};
+
+static void pso_corpus_init(struct pso_corpus *corpus, ID3D12Device *device,
+        const D3D12_SHADER_BYTECODE *vs, const D3D12_SHADER_BYTECODE *ps, const D3D12_SHADER_BYTECODE *cs)
+{
+    static const DXGI_FORMAT formats[] =
+    {
+        DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+        DXGI_FORMAT_R10G10B10A2_UNORM, DXGI_FORMAT_R11G11B10_FLOAT, DXGI_FORMAT_R16G16B16A16_FLOAT,
+        DXGI_FORMAT_R16G16_FLOAT, DXGI_FORMAT_R32_FLOAT,
+    };
+    static const D3D12_PRIMITIVE_TOPOLOGY_TYPE topologies[] =
+    {
+        D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE, D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE, D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT,
+    };
+    static const D3D12_CULL_MODE cull_modes[] =
+    {
+        D3D12_CULL_MODE_BACK, D3D12_CULL_MODE_FRONT, D3D12_CULL_MODE_NONE,
+    };
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC *graphics_desc;
+    D3D12_RENDER_TARGET_BLEND_DESC *blend;
+    unsigned int i, variant;
+
+    memset(corpus, 0, sizeof(*corpus));
+
+    for (i = 0; i < ROOT_SIGNATURE_VARIANT_COUNT; i++)
+    {
+        corpus->root_signatures[i] = create_32bit_constants_root_signature(device,
+                0, i + 1, D3D12_SHADER_VISIBILITY_ALL);
+    }
+
+    corpus->graphics_count = options.graphics_count;
+    corpus->compute_count = options.compute_count;
+    corpus->graphics_descs = calloc(max(corpus->graphics_count, 1), sizeof(*corpus->graphics_descs));
+    corpus->compute_descs = calloc(max(corpus->compute_count, 1), sizeof(*corpus->compute_descs));
+
+    /* Walk through state combinations so that every graphics PSO is unique, and fall
+     * back to depth bias once all combinations are used up. */
+    for (i = 0; i < corpus->graphics_count; i++)
+    {
+        graphics_desc = &corpus->graphics_descs[i];
+        variant = i;
+
+        init_pipeline_state_desc(graphics_desc, corpus->root_signatures[i % ROOT_SIGNATURE_VARIANT_COUNT],
+                formats[variant % ARRAY_SIZE(formats)], vs, ps, NULL);
+        variant /= ARRAY_SIZE(formats);
+
+        graphics_desc->PrimitiveTopologyType = topologies[variant % ARRAY_SIZE(topologies)];
+        variant /= ARRAY_SIZE(topologies);
+
+        graphics_desc->RasterizerState.CullMode = cull_modes[variant % ARRAY_SIZE(cull_modes)];
+        variant /= ARRAY_SIZE(cull_modes);
+
+        blend = &graphics_desc->BlendState.RenderTarget[0];
+        switch (variant % 4)
+        {
+            case 1:
+                blend->BlendEnable = TRUE;
+                blend->SrcBlend = D3D12_BLEND_SRC_ALPHA;
+                blend->DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+                blend->BlendOp = D3D12_BLEND_OP_ADD;
+                blend->SrcBlendAlpha = D3D12_BLEND_ONE;
+                blend->DestBlendAlpha = D3D12_BLEND_ZERO;
+                blend->BlendOpAlpha = D3D12_BLEND_OP_ADD;
+                break;
+
+            case 2:
+                blend->BlendEnable = TRUE;
+                blend->SrcBlend = D3D12_BLEND_ONE;
+                blend->DestBlend = D3D12_BLEND_ONE;
+                blend->BlendOp = D3D12_BLEND_OP_ADD;
+                blend->SrcBlendAlpha = D3D12_BLEND_ONE;
+                blend->DestBlendAlpha = D3D12_BLEND_ONE;
+                blend->BlendOpAlpha = D3D12_BLEND_OP_ADD;
+                break;
+
+            case 3:
+                blend->RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_RED |
+                        D3D12_COLOR_WRITE_ENABLE_GREEN | D3D12_COLOR_WRITE_ENABLE_BLUE;
+                break;
+
+            default:
+                break;
+        }
+        variant /= 4;
+
+        graphics_desc->RasterizerState.DepthBias = variant;
+    }
+
+    for (i = 0; i < corpus->compute_count; i++)
+    {
+        corpus->compute_descs[i].pRootSignature = corpus->root_signatures[i % ROOT_SIGNATURE_VARIANT_COUNT];
+        corpus->compute_descs[i].CS = *cs;
+    }
+}
+
+static void pso_corpus_cleanup(struct pso_corpus *corpus)
+{
+    unsigned int i;
+
+    for (i = 0; i < ROOT_SIGNATURE_VARIANT_COUNT; i++)
+    {
+        if (corpus->root_signatures[i])
+            ID3D12RootSignature_Release(corpus->root_signatures[i]);
+    }
+
+    free(corpus->graphics_descs);
+    free(corpus->compute_descs);
+}
+
+struct pso_set
+{
+    ID3D12PipelineState **graphics;
+    ID3D12PipelineState **compute;
+};
+
+static void pso_set_init(struct pso_set *set, const struct pso_corpus *corpus)
+{
+    set->graphics = calloc(max(corpus->graphics_count, 1), sizeof(*set->graphics));
+    set->compute = calloc(max(corpus->compute_count, 1), sizeof(*set->compute));
+}
+
+static void pso_set_cleanup(struct pso_set *set, const struct pso_corpus *corpus)
+{
+    unsigned int i;
+
+    for (i = 0; i < corpus->graphics_count; i++)
+    {
+        if (set->graphics[i])
+            ID3D12PipelineState_Release(set->graphics[i]);
+    }
+
+    for (i = 0; i < corpus->compute_count; i++)
+    {
+        if (set->compute[i])
+            ID3D12PipelineState_Release(set->compute[i]);
+    }
+
+    free(set->graphics);
+    free(set->compute);
+}
+
+struct pso_worker
+{
+    ID3D12Device *device;
+    ID3D12PipelineLibrary *library;
+    const struct pso_corpus *corpus;
+    struct pso_set *set;
+    double *graphics_samples;
+    double *compute_samples;
+    unsigned int thread_index;
+    unsigned int thread_count;
+};
+
+static void pso_worker_main(void *userdata)
+{
+    struct pso_worker *worker = userdata;
+    double start_time;
+    WCHAR name[16];
+    unsigned int i;
+    HRESULT hr;
+
+    /* Interleave the corpus so that every thread gets a similar mix of states. */
+    for (i = worker->thread_index; i < worker->corpus->graphics_count; i += worker->thread_count)
+    {
+        make_pso_name(name, 'G', i);
+
+        start_time = get_time();
+        if (worker->library)
+        {
+            hr = ID3D12PipelineLibrary_LoadGraphicsPipeline(worker->library, name,
+                    &worker->corpus->graphics_descs[i], &IID_ID3D12PipelineState, (void **)&worker->set->graphics[i]);
+        }
+        else
+        {
+            hr = ID3D12Device_CreateGraphicsPipelineState(worker->device,
+                    &worker->corpus->graphics_descs[i], &IID_ID3D12PipelineState, (void **)&worker->set->graphics[i]);
+        }
+        worker->graphics_samples[i] = get_time() - start_time;
+        ok(SUCCEEDED(hr), "Failed to create graphics pipeline %u, hr #%x.\n", i, hr);
+    }
+
+    for (i = worker->thread_index; i < worker->corpus->compute_count; i += worker->thread_count)
+    {
+        make_pso_name(name, 'C', i);
+
+        start_time = get_time();
+        if (worker->library)
+        {
+            hr = ID3D12PipelineLibrary_LoadComputePipeline(worker->library, name,
+                    &worker->corpus->compute_descs[i], &IID_ID3D12PipelineState, (void **)&worker->set->compute[i]);
+        }
+        else
+        {
+            hr = ID3D12Device_CreateComputePipelineState(worker->device,
+                    &worker->corpus->compute_descs[i], &IID_ID3D12PipelineState, (void **)&worker->set->compute[i]);
+        }
+        worker->compute_samples[i] = get_time() - start_time;
+        ok(SUCCEEDED(hr), "Failed to create compute pipeline %u, hr #%x.\n", i, hr);
+    }
+}
+
+static void run_pso_workers(ID3D12Device *device, ID3D12PipelineLibrary *library,
+        const struct pso_corpus *corpus, struct pso_set *set,
+        double *graphics_samples, double *compute_samples, unsigned int thread_count)
+{
+    struct pso_worker workers[MAX_BENCHMARK_THREADS];
+    unsigned int i;
+
+    for (i = 0; i < thread_count; i++)
+    {
+        workers[i].device = device;
+        workers[i].library = library;
+        workers[i].corpus = corpus;
+        workers[i].set = set;
+        workers[i].graphics_samples = graphics_samples;
+        workers[i].compute_samples = compute_samples;
+        workers[i].thread_index = i;
+        workers[i].thread_count = thread_count;
+    }
+
+    run_benchmark_threads(pso_worker_main, workers, sizeof(*workers), thread_count);
+}
+
+struct pso_corpus_shaders
+{
+    const D3D12_SHADER_BYTECODE *vs;
+    const D3D12_SHADER_BYTECODE *ps;
+    const D3D12_SHADER_BYTECODE *cs;
+};
+
+static bool benchmark_cold(const struct pso_corpus_shaders *shaders, unsigned int thread_count,
+        double *graphics_samples, double *compute_samples, void **blob, size_t *blob_size)
+{
+    ID3D12PipelineLibrary *library;
+    struct pso_corpus corpus;
+    ID3D12Device1 *device1;
+    ID3D12Device *device;
+    struct pso_set set;
+    double start_time;
+    unsigned int i;
+    WCHAR name[16];
+    HRESULT hr;
+
+    /* Use a fresh device, so that nothing is cached in-process yet. */
+    if (!(device = create_device()))
+    {
+        ok(false, "Failed to create device.\n");
+        return false;
+    }
+
+    if (FAILED(ID3D12Device_QueryInterface(device, &IID_ID3D12Device1, (void **)&device1)))
+    {
+        skip("ID3D12Device1 not available.\n");
+        ID3D12Device_Release(device);
+        return false;
+    }
+
+    pso_corpus_init(&corpus, device, shaders->vs, shaders->ps, shaders->cs);
+    pso_set_init(&set, &corpus);
+
+    run_pso_workers(device, NULL, &corpus, &set, graphics_samples, compute_samples, thread_count);
+    report_result("graphics_cold", thread_count, graphics_samples, corpus.graphics_count, 0);
+    report_result("compute_cold", thread_count, compute_samples, corpus.compute_count, 0);
+
+    hr = ID3D12Device1_CreatePipelineLibrary(device1, NULL, 0, &IID_ID3D12PipelineLibrary, (void **)&library);
+    ok(SUCCEEDED(hr), "Failed to create pipeline library, hr #%x.\n", hr);
+
+    for (i = 0; i < corpus.graphics_count; i++)
+    {
+        make_pso_name(name, 'G', i);
+        start_time = get_time();
+        hr = set.graphics[i] ? ID3D12PipelineLibrary_StorePipeline(library, name, set.graphics[i]) : S_OK;
+        graphics_samples[i] = get_time() - start_time;
+        ok(SUCCEEDED(hr), "Failed to store graphics pipeline %u, hr #%x.\n", i, hr);
+    }
+
+    for (i = 0; i < corpus.compute_count; i++)
+    {
+        make_pso_name(name, 'C', i);
+        start_time = get_time();
+        hr = set.compute[i] ? ID3D12PipelineLibrary_StorePipeline(library, name, set.compute[i]) : S_OK;
+        compute_samples[i] = get_time() - start_time;
+        ok(SUCCEEDED(hr), "Failed to store compute pipeline %u, hr #%x.\n", i, hr);
+    }
+
+    report_result("graphics_store", 1, graphics_samples, corpus.graphics_count, 0);
+    report_result("compute_store", 1, compute_samples, corpus.compute_count, 0);
+
+    start_time = get_time();
+    *blob_size = ID3D12PipelineLibrary_GetSerializedSize(library);
+    *blob = malloc(*blob_size);
+    hr = ID3D12PipelineLibrary_Serialize(library, *blob, *blob_size);
+    graphics_samples[0] = get_time() - start_time;
+    ok(SUCCEEDED(hr), "Failed to serialize pipeline library, hr #%x.\n", hr);
+    report_result("library_serialize", 1, graphics_samples, 1, *blob_size);
+
+    ID3D12PipelineLibrary_Release(library);
+    pso_set_cleanup(&set, &corpus);
+    pso_corpus_cleanup(&corpus);
+    ID3D12Device1_Release(device1);
+    ID3D12Device_Release(device);
+    return SUCCEEDED(hr);
+}
+
+static void benchmark_warm(const struct pso_corpus_shaders *shaders, unsigned int thread_count,
+        double *graphics_samples, double *compute_samples, const void *blob, size_t blob_size)
+{
+    const char *variant = get_warm_variant_name();
+    ID3D12PipelineLibrary *library;
+    struct pso_corpus corpus;
+    ID3D12Device1 *device1;
+    ID3D12Device *device;
+    struct pso_set set;
+    double start_time;
+    char name[64];
+    HRESULT hr;
+
+    /* A second device only sees what made it into the serialized blob. */
+    if (!(device = create_device()))
+    {
+        ok(false, "Failed to create device.\n");
+        return;
+    }
+
+    if (FAILED(ID3D12Device_QueryInterface(device, &IID_ID3D12Device1, (void **)&device1)))
+    {
+        ID3D12Device_Release(device);
+        return;
+    }
+
+    start_time = get_time();
+    hr = ID3D12Device1_CreatePipelineLibrary(device1, blob, blob_size, &IID_ID3D12PipelineLibrary, (void **)&library);
+    graphics_samples[0] = get_time() - start_time;
+    ok(SUCCEEDED(hr), "Failed to create pipeline library from blob, hr #%x.\n", hr);
+
+    if (SUCCEEDED(hr))
+    {
+        report_result("library_load", 1, graphics_samples, 1, blob_size);
+
+        pso_corpus_init(&corpus, device, shaders->vs, shaders->ps, shaders->cs);
+        pso_set_init(&set, &corpus);
+
+        run_pso_workers(device, library, &corpus, &set, graphics_samples, compute_samples, thread_count);
+        sprintf(name, "graphics_%s", variant);
+        report_result(name, thread_count, graphics_samples, corpus.graphics_count, 0);
+        sprintf(name, "compute_%s", variant);
+        report_result(name, thread_count, compute_samples, corpus.compute_count, 0);
+
+        pso_set_cleanup(&set, &corpus);
+        pso_corpus_cleanup(&corpus);
+        ID3D12PipelineLibrary_Release(library);
+    }
+
+    ID3D12Device1_Release(device1);
+    ID3D12Device_Release(device);
+}
+
+static void do_benchmark_run(const struct pso_corpus_shaders *shaders,
+        double *graphics_samples, double *compute_samples)
+{
+    unsigned int thread_count;
+    size_t blob_size;
+    void *blob;
+
+    for_each_benchmark_thread_count(thread_count, options.max_threads)
+    {
+        blob = NULL;
+
+        if (benchmark_cold(shaders, thread_count, graphics_samples, compute_samples, &blob, &blob_size))
+            benchmark_warm(shaders, thread_count, graphics_samples, compute_samples, blob, blob_size);
+
+        free(blob);
+    }
+}
+
+START_TEST(pso_performance)
+{
+#if 0
+    [numthreads(1,1,1)]
+    void main() { }
+#endif
+    static const DWORD cs_code[] =
+    {
+        0x43425844, 0x1acc3ad0, 0x71c7b057, 0xc72c4306, 0xf432cb57, 0x00000001, 0x00000074, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000020, 0x00050050, 0x00000008, 0x0100086a,
+        0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x0100003e,
+    };
+    D3D12_SHADER_BYTECODE vs = { NULL, 0 }, ps = { NULL, 0 }, cs = SHADER_BYTECODE(cs_code);
+    struct pso_corpus_shaders shaders;
+    double *graphics_samples;
+    double *compute_samples;
+    unsigned int i;
+
+    setup(argc, argv);
+
+    /* Built-in shaders are used for anything that is not given on the command line. */
+    shaders.vs = options.vs_path && load_shader_file(options.vs_path, &vs) ? &vs : NULL;
+    shaders.ps = options.ps_path && load_shader_file(options.ps_path, &ps) ? &ps : NULL;
+    if (options.cs_path)
+        load_shader_file(options.cs_path, &cs);
+    shaders.cs = &cs;
+
+    graphics_samples = malloc(max(options.graphics_count, 1) * sizeof(*graphics_samples));
+    compute_samples = malloc(max(options.compute_count, 1) * sizeof(*compute_samples));
+    ok(graphics_samples && compute_samples, "Failed to allocate samples.\n");
+
+    report_begin();
+    for (i = 0; i < options.iterations; i++)
+        do_benchmark_run(&shaders, graphics_samples, compute_samples);
+
+    free(graphics_samples);
+    free(compute_samples);
+
+    if (vs.pShaderBytecode)
+        free((void *)vs.pShaderBytecode);
+    if (ps.pShaderBytecode)
+        free((void *)ps.pShaderBytecode);
+    if (cs.pShaderBytecode != cs_code)
+        free((void *)cs.pShaderBytecode);
+}
@@ -0,0 +1,409 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define INITGUID
+#define VKD3D_TEST_DECLARE_MAIN
+#include "d3d12_crosstest.h"
+#include "d3d12_benchmark.h"
+
+enum output_format
+{
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV,
+};
+
+static struct
+{
+    unsigned int samples;
+    unsigned int max_threads;
+    unsigned int iterations;
+    enum output_format format;
+} options = { 10000, 4, 1, OUTPUT_FORMAT_TEXT };
+
+/* Lists are executed in batches and only waited on once per batch, so that the
+ * queue stays busy and we measure submission rather than round trips. */
+#define LIST_BATCH_SIZE 64
+#define SMALL_LIST_COPY_COUNT 4
+#define SMALL_LIST_BUFFER_SIZE 4096
+
+static void parse_benchmark_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+            options.samples = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            options.max_threads = parse_benchmark_uint(argv[++i], 1, MAX_BENCHMARK_THREADS);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            options.iterations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--csv"))
+            options.format = OUTPUT_FORMAT_CSV;
+    }
+}
+
+static void setup(int argc, char **argv)
+{
+    pfn_D3D12CreateDevice = get_d3d12_pfn(D3D12CreateDevice);
+    pfn_D3D12EnableExperimentalFeatures = get_d3d12_pfn(D3D12EnableExperimentalFeatures);
+    pfn_D3D12GetDebugInterface = get_d3d12_pfn(D3D12GetDebugInterface);
+
+    parse_args(argc, argv);
+    parse_benchmark_args(argc, argv);
+    enable_d3d12_debug_layer(argc, argv);
+    init_adapter_info();
+}
+
+static void report_begin(void)
+{
+    if (options.format == OUTPUT_FORMAT_CSV)
+        printf("benchmark,threads,samples,mean_us,p50_us,p90_us,p99_us,max_us\n");
+}
+
+static void report_result(const char *name, unsigned int thread_count, double *samples, unsigned int count)
+{
+    double mean, p50, p90, p99, max_value;
+    unsigned int i;
+
+    if (!count)
+        return;
+
+    qsort(samples, count, sizeof(*samples), compare_double);
+
+    for (i = 0, mean = 0.0; i < count; i++)
+        mean += samples[i];
+    mean /= (double)count;
+
+    p50 = get_percentile(samples, count, 0.50);
+    p90 = get_percentile(samples, count, 0.90);
+    p99 = get_percentile(samples, count, 0.99);
+    max_value = samples[count - 1];
+
+    switch (options.format)
+    {
+        case OUTPUT_FORMAT_CSV:
+            printf("%s,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f\n", name, thread_count, count,
+                    1e6 * mean, 1e6 * p50, 1e6 * p90, 1e6 * p99, 1e6 * max_value);
+            break;
+
+        default:
+            printf("%s: %u samples on %u thread(s), mean %.3f us, p50 %.3f us, p90 %.3f us, "
+                    "p99 %.3f us, max %.3f us.\n", name, count, thread_count,
+                    1e6 * mean, 1e6 * p50, 1e6 * p90, 1e6 * p99, 1e6 * max_value);
+            break;
+    }
+
+    fflush(stdout);
+}
+
+struct list_batch
+{
+    ID3D12CommandAllocator *allocators[LIST_BATCH_SIZE];
+    ID3D12GraphicsCommandList *lists[LIST_BATCH_SIZE];
+    ID3D12Resource *src_buffer;
+    ID3D12Resource *dst_buffer;
+};
+
+static void list_batch_init(struct list_batch *batch, ID3D12Device *device, bool small)
+{
+    unsigned int i, j;
+    HRESULT hr;
+
+    memset(batch, 0, sizeof(*batch));
+
+    if (small)
+    {
+        batch->src_buffer = create_default_buffer(device, SMALL_LIST_BUFFER_SIZE,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+        batch->dst_buffer = create_default_buffer(device, SMALL_LIST_BUFFER_SIZE,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+
+    for (i = 0; i < LIST_BATCH_SIZE; i++)
+    {
+        hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+                &IID_ID3D12CommandAllocator, (void **)&batch->allocators[i]);
+        ok(SUCCEEDED(hr), "Failed to create command allocator, hr #%x.\n", hr);
+
+        hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+                batch->allocators[i], NULL, &IID_ID3D12GraphicsCommandList, (void **)&batch->lists[i]);
+        ok(SUCCEEDED(hr), "Failed to create command list, hr #%x.\n", hr);
+
+        /* A handful of tiny copies, roughly what a small pass submits. */
+        if (small)
+        {
+            for (j = 0; j < SMALL_LIST_COPY_COUNT; j++)
+            {
+                ID3D12GraphicsCommandList_CopyBufferRegion(batch->lists[i], batch->dst_buffer,
+                        j * 256, batch->src_buffer, j * 256, 256);
+            }
+        }
+
+        hr = ID3D12GraphicsCommandList_Close(batch->lists[i]);
+        ok(SUCCEEDED(hr), "Failed to close command list, hr #%x.\n", hr);
+    }
+}
+
+static void list_batch_cleanup(struct list_batch *batch)
+{
+    unsigned int i;
+
+    for (i = 0; i < LIST_BATCH_SIZE; i++)
+    {
+        ID3D12GraphicsCommandList_Release(batch->lists[i]);
+        ID3D12CommandAllocator_Release(batch->allocators[i]);
+    }
+
+    if (batch->src_buffer)
+        ID3D12Resource_Release(batch->src_buffer);
+    if (batch->dst_buffer)
+        ID3D12Resource_Release(batch->dst_buffer);
+}
+
+static void execute_lists(ID3D12Device *device, ID3D12CommandQueue *queue,
+        struct list_batch *batch, double *samples, unsigned int count)
+{
+    ID3D12CommandList *list;
+    double start_time;
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+    {
+        list = (ID3D12CommandList *)batch->lists[i % LIST_BATCH_SIZE];
+
+        start_time = get_time();
+        ID3D12CommandQueue_ExecuteCommandLists(queue, 1, &list);
+        samples[i] = get_time() - start_time;
+
+        /* Lists can only be resubmitted once the previous execution has completed. */
+        if ((i + 1) % LIST_BATCH_SIZE == 0)
+            wait_queue_idle(device, queue);
+    }
+
+    wait_queue_idle(device, queue);
+}
+
+static void benchmark_ecl(ID3D12Device *device, ID3D12CommandQueue *queue, double *samples)
+{
+    struct list_batch batch;
+
+    list_batch_init(&batch, device, false);
+    execute_lists(device, queue, &batch, samples, options.samples);
+    report_result("ecl_empty", 1, samples, options.samples);
+    list_batch_cleanup(&batch);
+
+    list_batch_init(&batch, device, true);
+    execute_lists(device, queue, &batch, samples, options.samples);
+    report_result("ecl_small", 1, samples, options.samples);
+    list_batch_cleanup(&batch);
+}
+
+static void benchmark_signal_wake(ID3D12Device *device, ID3D12CommandQueue *queue, double *samples)
+{
+    struct list_batch batch;
+    ID3D12CommandList *list;
+    double start_time;
+    ID3D12Fence *fence;
+    unsigned int i;
+    HANDLE event;
+    HRESULT hr;
+
+    hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&fence);
+    ok(SUCCEEDED(hr), "Failed to create fence, hr #%x.\n", hr);
+    event = create_event();
+    ok(!!event, "Failed to create event.\n");
+
+    /* Time from the queue signal until the waiting thread wakes up, which covers the
+     * submission thread, the fence worker and the event. */
+    for (i = 0; i < options.samples; i++)
+    {
+        start_time = get_time();
+        ID3D12CommandQueue_Signal(queue, fence, i + 1);
+        ID3D12Fence_SetEventOnCompletion(fence, i + 1, event);
+        wait_event(event, INFINITE);
+        samples[i] = get_time() - start_time;
+    }
+
+    report_result("signal_wake", 1, samples, options.samples);
+
+    /* Same, but with an empty list in front, so the signal has to wait for a real submission. */
+    list_batch_init(&batch, device, false);
+
+    for (i = 0; i < options.samples; i++)
+    {
+        list = (ID3D12CommandList *)batch.lists[i % LIST_BATCH_SIZE];
+
+        start_time = get_time();
+        ID3D12CommandQueue_ExecuteCommandLists(queue, 1, &list);
+        ID3D12CommandQueue_Signal(queue, fence, options.samples + i + 1);
+        ID3D12Fence_SetEventOnCompletion(fence, options.samples + i + 1, event);
+        wait_event(event, INFINITE);
+        samples[i] = get_time() - start_time;
+    }
+
+    report_result("ecl_signal_wake", 1, samples, options.samples);
+
+    list_batch_cleanup(&batch);
+    destroy_event(event);
+    ID3D12Fence_Release(fence);
+}
+
+static void benchmark_cross_queue_wait(ID3D12Device *device, ID3D12CommandQueue *queue, double *samples)
+{
+    ID3D12Fence *fence, *return_fence;
+    ID3D12CommandQueue *other_queue;
+    double start_time;
+    unsigned int i;
+    HANDLE event;
+    HRESULT hr;
+
+    other_queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_COMPUTE, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+
+    hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&fence);
+    ok(SUCCEEDED(hr), "Failed to create fence, hr #%x.\n", hr);
+    hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&return_fence);
+    ok(SUCCEEDED(hr), "Failed to create fence, hr #%x.\n", hr);
+    event = create_event();
+    ok(!!event, "Failed to create event.\n");
+
+    /* One queue signals, the other waits and signals back, and the CPU waits for the reply. */
+    for (i = 0; i < options.samples; i++)
+    {
+        start_time = get_time();
+        ID3D12CommandQueue_Wait(other_queue, fence, i + 1);
+        ID3D12CommandQueue_Signal(other_queue, return_fence, i + 1);
+        ID3D12CommandQueue_Signal(queue, fence, i + 1);
+        ID3D12Fence_SetEventOnCompletion(return_fence, i + 1, event);
+        wait_event(event, INFINITE);
+        samples[i] = get_time() - start_time;
+    }
+
+    report_result("cross_queue_wait", 1, samples, options.samples);
+
+    destroy_event(event);
+    ID3D12Fence_Release(return_fence);
+    ID3D12Fence_Release(fence);
+    ID3D12CommandQueue_Release(other_queue);
+}
+
+struct threaded_worker
+{
+    ID3D12Device *device;
+    ID3D12CommandQueue *queue;
+    struct list_batch batch;
+    ID3D12Fence *fence;
+    double *samples;
+    unsigned int count;
+};
+
+static void threaded_ecl_main(void *userdata)
+{
+    struct threaded_worker *worker = userdata;
+    ID3D12CommandList *list;
+    double start_time;
+    unsigned int i;
+
+    /* Every thread tracks its own lists with its own fence, since waiting for the shared
+     * queue to go idle would serialize the threads. */
+    for (i = 0; i < worker->count; i++)
+    {
+        list = (ID3D12CommandList *)worker->batch.lists[i % LIST_BATCH_SIZE];
+
+        start_time = get_time();
+        ID3D12CommandQueue_ExecuteCommandLists(worker->queue, 1, &list);
+        worker->samples[i] = get_time() - start_time;
+
+        if ((i + 1) % LIST_BATCH_SIZE == 0 || i + 1 == worker->count)
+        {
+            ID3D12CommandQueue_Signal(worker->queue, worker->fence, i + 1);
+            wait_for_fence(worker->fence, i + 1);
+        }
+    }
+}
+
+static void benchmark_threaded_ecl(ID3D12Device *device, ID3D12CommandQueue *queue,
+        double *samples, unsigned int thread_count)
+{
+    struct threaded_worker workers[MAX_BENCHMARK_THREADS];
+    unsigned int i, per_thread;
+    HRESULT hr;
+
+    per_thread = max(options.samples / thread_count, 1);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        workers[i].device = device;
+        workers[i].queue = queue;
+        workers[i].samples = samples + i * per_thread;
+        workers[i].count = per_thread;
+        list_batch_init(&workers[i].batch, device, false);
+
+        hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE, &IID_ID3D12Fence, (void **)&workers[i].fence);
+        ok(SUCCEEDED(hr), "Failed to create fence, hr #%x.\n", hr);
+    }
+
+    run_benchmark_threads(threaded_ecl_main, workers, sizeof(*workers), thread_count);
+
+    report_result("threaded_ecl", thread_count, samples, per_thread * thread_count);
+
+    for (i = 0; i < thread_count; i++)
+    {
+        list_batch_cleanup(&workers[i].batch);
+        ID3D12Fence_Release(workers[i].fence);
+    }
+}
+
+static void do_benchmark_run(ID3D12Device *device, ID3D12CommandQueue *queue, double *samples)
+{
+    unsigned int thread_count;
+
+    benchmark_ecl(device, queue, samples);
+    benchmark_signal_wake(device, queue, samples);
+    benchmark_cross_queue_wait(device, queue, samples);
+
+    for_each_benchmark_thread_count(thread_count, options.max_threads)
+        benchmark_threaded_ecl(device, queue, samples, thread_count);
+}
+
+START_TEST(submission_performance)
+{
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    double *samples;
+    unsigned int i;
+
+    setup(argc, argv);
+    device = create_device();
+    ok(device != NULL, "Failed to create device.\n");
+
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+    /* The threaded run hands out at least one sample per thread. */
+    samples = malloc(max(options.samples, options.max_threads) * sizeof(*samples));
+    ok(samples != NULL, "Failed to allocate samples.\n");
+
+    report_begin();
+    for (i = 0; i < options.iterations; i++)
+        do_benchmark_run(device, queue, samples);
+
+    free(samples);
+    ID3D12CommandQueue_Release(queue);
+    ID3D12Device_Release(device);
+}
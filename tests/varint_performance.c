@@ -0,0 +1,262 @@
+/*
+ * Copyright 2023 Valve Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Measures the SPIR-V varint codec used by pipeline caches and libraries. The
+ * vectorized decoder is compared against the scalar reference decoder, on a
+ * synthetic SPIR-V-like word stream or on a SPIR-V file given with --spirv. */
+
+#define VKD3D_DBG_CHANNEL VKD3D_DBG_CHANNEL_API
+
+#define VKD3D_TEST_DECLARE_MAIN
+#include "vkd3d_test.h"
+#include "vkd3d_varint.h"
+#include "d3d12_benchmark.h"
+
+enum output_format
+{
+    OUTPUT_FORMAT_TEXT,
+    OUTPUT_FORMAT_CSV,
+};
+
+static struct
+{
+    unsigned int word_count;
+    unsigned int samples;
+    unsigned int iterations;
+    enum output_format format;
+    const char *spirv_path;
+} options = { 256 * 1024, 100, 1, OUTPUT_FORMAT_TEXT, NULL };
+
+static void parse_benchmark_args(int argc, char **argv)
+{
+    int i;
+
+    for (i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--words") && i + 1 < argc)
+            options.word_count = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+            options.samples = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+            options.iterations = parse_benchmark_uint(argv[++i], 1, UINT_MAX);
+        else if (!strcmp(argv[i], "--spirv") && i + 1 < argc)
+            options.spirv_path = argv[++i];
+        else if (!strcmp(argv[i], "--csv"))
+            options.format = OUTPUT_FORMAT_CSV;
+    }
+}
+
+static void report_begin(void)
+{
+    if (options.format == OUTPUT_FORMAT_CSV)
+        printf("benchmark,samples,words,bytes,mean_us,p50_us,p99_us,ns_per_word,mib_per_sec\n");
+}
+
+static void report_result(const char *name, double *samples, unsigned int count, size_t word_count, size_t bytes)
+{
+    double mean, p50, p99;
+    unsigned int i;
+
+    qsort(samples, count, sizeof(*samples), compare_double);
+
+    for (i = 0, mean = 0.0; i < count; i++)
+        mean += samples[i];
+    mean /= (double)count;
+
+    p50 = get_percentile(samples, count, 0.50);
+    p99 = get_percentile(samples, count, 0.99);
+
+    /* Throughput is given in encoded bytes, which is what the decoder walks. */
+    switch (options.format)
+    {
+        case OUTPUT_FORMAT_CSV:
+            printf("%s,%u,%zu,%zu,%.3f,%.3f,%.3f,%.3f,%.1f\n", name, count, word_count, bytes,
+                    1e6 * mean, 1e6 * p50, 1e6 * p99, 1e9 * p50 / (double)word_count,
+                    (double)bytes / (p50 * 1024.0 * 1024.0));
+            break;
+
+        default:
+            printf("%s: %u samples of %zu words (%zu bytes), mean %.3f us, p50 %.3f us, p99 %.3f us, "
+                    "%.3f ns/word, %.1f MiB/s.\n", name, count, word_count, bytes,
+                    1e6 * mean, 1e6 * p50, 1e6 * p99, 1e9 * p50 / (double)word_count,
+                    (double)bytes / (p50 * 1024.0 * 1024.0));
+            break;
+    }
+
+    fflush(stdout);
+}
+
+static uint32_t rng_next(uint32_t *state)
+{
+    /* xorshift32, so that the corpus is reproducible. */
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static uint32_t *create_synthetic_words(size_t word_count)
+{
+    uint32_t rng = 0x9e3779b9u;
+    unsigned int bucket;
+    uint32_t *words;
+    size_t i;
+
+    if (!(words = malloc(word_count * sizeof(*words))))
+        return NULL;
+
+    /* Roughly what compiled DXIL looks like: mostly small IDs and literals,
+     * opcode words with a word count in the upper half, and a few constants. */
+    for (i = 0; i < word_count; i++)
+    {
+        bucket = rng_next(&rng) % 100;
+        if (bucket < 70)
+            words[i] = rng_next(&rng) & 0x7f;
+        else if (bucket < 85)
+            words[i] = rng_next(&rng) & 0x3fff;
+        else if (bucket < 95)
+            words[i] = ((rng_next(&rng) % 8 + 1) << 16) | (rng_next(&rng) % 400);
+        else
+            words[i] = rng_next(&rng);
+    }
+
+    return words;
+}
+
+static uint32_t *load_spirv_words(const char *path, size_t *word_count)
+{
+    uint32_t *words;
+    long size;
+    FILE *f;
+
+    if (!(f = fopen(path, "rb")))
+    {
+        ok(false, "Failed to open %s.\n", path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (size < (long)sizeof(*words) || !(words = malloc(size)) || fread(words, 1, size, f) != (size_t)size)
+    {
+        ok(false, "Failed to read %s.\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    fclose(f);
+    *word_count = size / sizeof(*words);
+    return words;
+}
+
+typedef bool (*decode_varint_pfn)(uint32_t *words, size_t words_size, const uint8_t *buffer, size_t buffer_size);
+
+static void benchmark_decode(const char *name, decode_varint_pfn decode, const uint32_t *reference,
+        size_t word_count, const uint8_t *encoded, size_t encoded_size, double *samples)
+{
+    uint32_t *words;
+    double start_time;
+    unsigned int i;
+    bool ret;
+
+    words = malloc(word_count * sizeof(*words));
+    ok(words != NULL, "Failed to allocate words.\n");
+    if (!words)
+        return;
+
+    for (i = 0; i < options.samples; i++)
+    {
+        start_time = get_time();
+        ret = decode(words, word_count, encoded, encoded_size);
+        samples[i] = get_time() - start_time;
+        ok(ret, "Failed to decode varint stream.\n");
+    }
+
+    ok(!memcmp(words, reference, word_count * sizeof(*words)), "Decoded words do not match.\n");
+    report_result(name, samples, options.samples, word_count, encoded_size);
+
+    /* A truncated stream has to be rejected by either decoder. */
+    ok(!decode(words, word_count, encoded, encoded_size - 1), "Truncated stream was accepted.\n");
+
+    free(words);
+}
+
+static void do_benchmark_run(const uint32_t *words, size_t word_count, double *samples)
+{
+    uint8_t *encoded, *end;
+    size_t encoded_size;
+    double start_time;
+    unsigned int i;
+
+    encoded_size = vkd3d_compute_size_varint(words, word_count);
+    encoded = malloc(encoded_size);
+    ok(encoded != NULL, "Failed to allocate encoded buffer.\n");
+    if (!encoded)
+        return;
+
+    end = encoded;
+    for (i = 0; i < options.samples; i++)
+    {
+        start_time = get_time();
+        end = vkd3d_encode_varint(encoded, words, word_count);
+        samples[i] = get_time() - start_time;
+    }
+
+    ok(end == encoded + encoded_size, "Got encoded size %zu, expected %zu.\n",
+            (size_t)(end - encoded), encoded_size);
+    report_result("encode", samples, options.samples, word_count, encoded_size);
+
+    benchmark_decode("decode_scalar", vkd3d_decode_varint_scalar, words, word_count,
+            encoded, encoded_size, samples);
+    /* Without SSE2, this is the scalar decoder as well. */
+    benchmark_decode("decode", vkd3d_decode_varint, words, word_count,
+            encoded, encoded_size, samples);
+
+    free(encoded);
+}
+
+START_TEST(varint_performance)
+{
+    double *samples;
+    size_t word_count;
+    uint32_t *words;
+    unsigned int i;
+
+    parse_benchmark_args(argc, argv);
+
+    if (options.spirv_path)
+        words = load_spirv_words(options.spirv_path, &word_count);
+    else
+        words = create_synthetic_words((word_count = options.word_count));
+
+    samples = malloc(options.samples * sizeof(*samples));
+    ok(words && samples, "Failed to allocate benchmark data.\n");
+
+    if (words && samples)
+    {
+        report_begin();
+        for (i = 0; i < options.iterations; i++)
+            do_benchmark_run(words, word_count, samples);
+    }
+
+    free(samples);
+    free(words);
+}